@@ -48,6 +48,22 @@ if(NON_RELEASE_CRASH_REPORTING)
   add_compile_definitions( LL_SEND_CRASH_REPORTS=1)
 endif()
 
+# LLSD maps as sorted vectors: less memory, but inserting or erasing a key
+# invalidates every iterator of the map (see llsd.h)
+set(LLSD_FLAT_MAP OFF CACHE BOOL "Store LLSD maps as sorted vectors instead of std::maps")
+
+if(LLSD_FLAT_MAP)
+  add_compile_definitions( LLSD_FLAT_MAP=1)
+endif()
+
+# The hottest UUID-keyed maps as LLUUIDHashMaps rather than std::maps (see
+# lluuidhashmap.h)
+set(LL_UUID_HASH_MAP OFF CACHE BOOL "Keep the object list, inventory and avatar name maps in LLUUIDHashMaps")
+
+if(LL_UUID_HASH_MAP)
+  add_compile_definitions( LL_UUID_HASH_MAP=1)
+endif()
+
 # Don't bother with a MinSizeRel or Debug builds.
 set(CMAKE_CONFIGURATION_TYPES "RelWithDebInfo;Release" CACHE STRING "Supported build types." FORCE)
 
@@ -28,6 +28,7 @@
 
 #include "llavatarappearance.h"
 #include "llavatarappearancedefines.h"
+#include "llavatardefinitioncache.h"
 #include "llavatarjointmesh.h"
 #include "llstl.h"
 #include "lldir.h"
@@ -270,6 +271,7 @@ LLAvatarAppearance::~LLAvatarAppearance()
         }
     }
 
+    mFlatSkeleton.clear();
     if (mRoot)
     {
         mRoot->removeAllChildren();
@@ -318,8 +320,16 @@ void LLAvatarAppearance::initClass(const std::string& avatar_file_name_arg, cons
     {
         avatar_file_name = gDirUtilp->getExpandedFilename(LL_PATH_CHARACTER,AVATAR_DEFAULT_CHAR + "_lad.xml");
     }
+    // The parsed files come from the cache while they are unchanged
+    std::string cache_path;
+    if (LLFile::isdir(gDirUtilp->getCacheDir()))
+    {
+        cache_path = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "avatar_definitions.bin");
+    }
+    LLAvatarDefinitionCache definition_cache(cache_path);
+
     LLXmlTree xml_tree;
-    bool success = xml_tree.parseFile( avatar_file_name, false );
+    bool success = definition_cache.loadTree( avatar_file_name, xml_tree );
     if (!success)
     {
         LL_ERRS() << "Problem reading avatar configuration file:" << avatar_file_name << LL_ENDL;
@@ -375,10 +385,11 @@ void LLAvatarAppearance::initClass(const std::string& avatar_file_name_arg, cons
     std::string skeleton_path;
     LLXmlTree skeleton_xml_tree;
     skeleton_path = gDirUtilp->getExpandedFilename(LL_PATH_CHARACTER,skeleton_file_name);
-    if (!parseSkeletonFile(skeleton_path, skeleton_xml_tree))
+    if (!parseSkeletonFile(skeleton_path, skeleton_xml_tree, &definition_cache))
     {
         LL_ERRS() << "Error parsing skeleton file: " << skeleton_path << LL_ENDL;
     }
+    definition_cache.save();
 
     // Process XML data
 
@@ -549,12 +560,12 @@ void LLAvatarAppearance::computeBodySize()
 //-----------------------------------------------------------------------------
 // parseSkeletonFile()
 //-----------------------------------------------------------------------------
-bool LLAvatarAppearance::parseSkeletonFile(const std::string& filename, LLXmlTree& skeleton_xml_tree)
+bool LLAvatarAppearance::parseSkeletonFile(const std::string& filename, LLXmlTree& skeleton_xml_tree, LLAvatarDefinitionCache* cache)
 {
     //-------------------------------------------------------------------------
     // parse the file
     //-------------------------------------------------------------------------
-    bool parsesuccess = skeleton_xml_tree.parseFile( filename, false );
+    bool parsesuccess = cache ? cache->loadTree( filename, skeleton_xml_tree ) : skeleton_xml_tree.parseFile( filename, false );
 
     if (!parsesuccess)
     {
@@ -1326,6 +1337,46 @@ LLPolyMesh* LLAvatarAppearance::getUpperBodyMesh()
     return mMeshLOD[MESH_ID_UPPER_BODY]->mMeshParts[0]->getMesh();
 }
 
+//-----------------------------------------------------------------------------
+// LLAvatarAppearance::beginMorphBatch()
+//-----------------------------------------------------------------------------
+void LLAvatarAppearance::beginMorphBatch()
+{
+    if (mMorphBatchDepth++ > 0)
+    {
+        return;
+    }
+    for (polymesh_map_t::value_type& mesh_pair : mPolyMeshes)
+    {
+        LLPolyMesh* mesh = mesh_pair.second;
+        if (!mesh->isLOD())
+        {
+            mesh->beginMorphBatch();
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// LLAvatarAppearance::endMorphBatch()
+//-----------------------------------------------------------------------------
+void LLAvatarAppearance::endMorphBatch(const std::string& queue_name)
+{
+    llassert(mMorphBatchDepth > 0);
+    if (--mMorphBatchDepth > 0)
+    {
+        return;
+    }
+    std::vector<LLPolyMesh*> meshes;
+    for (polymesh_map_t::value_type& mesh_pair : mPolyMeshes)
+    {
+        if (!mesh_pair.second->isLOD())
+        {
+            meshes.push_back(mesh_pair.second);
+        }
+    }
+    LLPolyMesh::endMorphBatches(meshes, queue_name);
+}
+
 
 
 // virtual
@@ -31,6 +31,7 @@
 #include "llavatarappearancedefines.h"
 #include "llavatarjointmesh.h"
 #include "lldriverparam.h"
+#include "llflatskeleton.h"
 #include "lltexlayer.h"
 #include "llviewervisualparam.h"
 #include "llxmltree.h"
@@ -40,6 +41,7 @@ class LLTexGlobalColor;
 class LLTexGlobalColorInfo;
 class LLWearableData;
 class LLAvatarBoneInfo;
+class LLAvatarDefinitionCache;
 class LLAvatarSkeletonInfo;
 
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -135,6 +137,11 @@ public:
     F32                 getPelvisToFoot() const { return mPelvisToFoot; }
     /*virtual*/ LLJoint*    getRootJoint() { return mRoot; }
 
+    // Same as mRoot->updateWorldMatrixChildren(), in one linear pass over
+    // the flattened skeleton
+    void                updateWorldMatrices() { mFlatSkeleton.updateWorldMatrices(mRoot); }
+    const LLFlatSkeleton& getFlatSkeleton() const { return mFlatSkeleton; }
+
     LLVector3           mHeadOffset{}; // current head position
     LLAvatarJoint*      mRoot{ nullptr };
 
@@ -156,7 +163,7 @@ public:
 
 
 protected:
-    static bool         parseSkeletonFile(const std::string& filename, LLXmlTree& skeleton_xml_tree);
+    static bool         parseSkeletonFile(const std::string& filename, LLXmlTree& skeleton_xml_tree, LLAvatarDefinitionCache* cache = NULL);
     virtual void        buildCharacter();
     virtual bool        loadAvatar();
 
@@ -167,6 +174,7 @@ protected:
     void                clearSkeleton();
     bool                mIsBuilt{ false }; // state of deferred character building
     avatar_joint_list_t mSkeleton;
+    LLFlatSkeleton      mFlatSkeleton;
     LLVector3OverrideMap    mPelvisFixups;
     joint_alias_map_t   mJointAliasMap;
 
@@ -256,10 +264,19 @@ public:
 protected:
     virtual void    dirtyMesh(S32 priority) = 0; // Dirty the avatar mesh, with priority
 
+public:
+    // Morphs applied between these accumulate into the meshes and the
+    // normals are computed once at the end, see LLPolyMesh::beginMorphBatch().
+    // Batches nest, the outermost end does the normals on the named work
+    // queue if it is running.
+    void            beginMorphBatch();
+    void            endMorphBatch(const std::string& queue_name);
+
 protected:
     typedef std::multimap<std::string, LLPolyMesh*> polymesh_map_t;
     polymesh_map_t                                  mPolyMeshes;
     avatar_joint_list_t                             mMeshLOD;
+    S32                                             mMorphBatchDepth{ 0 };
 
     // mesh entries and backed textures
     static LLAvatarAppearanceDefines::LLAvatarAppearanceDictionary* sAvatarDictionary;
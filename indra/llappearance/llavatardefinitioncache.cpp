@@ -0,0 +1,293 @@
+/**
+ * @file llavatardefinitioncache.cpp
+ * @brief Binary cache of the parsed avatar definition files.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llavatardefinitioncache.h"
+
+#include "hbxxh.h"
+#include "lldir.h"
+#include "llfile.h"
+#include "lluuid.h"
+#include "llxmltree.h"
+
+#if LL_WINDOWS
+#include "llwin32headers.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // Bump when this layout or the one of LLXmlTree::writeBinary() changes
+    const U32 CACHE_VERSION = 1;
+    const char CACHE_MAGIC[8] = { 'L', 'L', 'A', 'V', 'D', 'E', 'F', 'S' };
+    const U32 CACHE_BYTE_ORDER = 0x01020304;
+    const size_t MAX_NAME_LENGTH = 64;
+
+    // The file starts with a header and a table of the entries, followed
+    // by the data of the entries
+    struct FileHeader
+    {
+        char    mMagic[8];
+        U32     mVersion;
+        U32     mByteOrder;     // the cache is only read on the machine that wrote it
+        U32     mNumEntries;
+        U32     mPadding;
+    };
+
+    struct FileEntry
+    {
+        char    mName[MAX_NAME_LENGTH];     // NUL terminated
+        U64     mHash;
+        U64     mOffset;
+        U64     mSize;
+    };
+}
+
+LLAvatarDefinitionCache::LLAvatarDefinitionCache(const std::string& cache_path)
+:   mCachePath(cache_path),
+    mDirty(false),
+    mNumHits(0),
+    mNumMisses(0),
+    mMapped(NULL),
+    mMappedSize(0)
+#if LL_WINDOWS
+    , mMapping(NULL)
+#endif
+{
+    if (mCachePath.empty() || !map())
+    {
+        return;
+    }
+
+    FileHeader header;
+    bool valid = mMappedSize >= sizeof(FileHeader);
+    if (valid)
+    {
+        memcpy(&header, mMapped, sizeof(FileHeader));
+        valid = !memcmp(header.mMagic, CACHE_MAGIC, sizeof(CACHE_MAGIC))
+            && header.mVersion == CACHE_VERSION
+            && header.mByteOrder == CACHE_BYTE_ORDER
+            && header.mNumEntries <= (mMappedSize - sizeof(FileHeader)) / sizeof(FileEntry);
+    }
+    for (U32 i = 0; valid && i < header.mNumEntries; i++)
+    {
+        FileEntry file_entry;
+        memcpy(&file_entry, mMapped + sizeof(FileHeader) + i * sizeof(FileEntry), sizeof(FileEntry));
+        valid = file_entry.mName[MAX_NAME_LENGTH - 1] == '\0'
+            && file_entry.mOffset <= mMappedSize
+            && file_entry.mSize <= mMappedSize - file_entry.mOffset;
+        if (valid)
+        {
+            Entry& entry = mEntries[file_entry.mName];
+            entry.mHash = file_entry.mHash;
+            entry.mData = mMapped + file_entry.mOffset;
+            entry.mSize = (size_t)file_entry.mSize;
+        }
+    }
+
+    if (!valid)
+    {
+        LL_WARNS() << "Ignoring invalid avatar definition cache: " << mCachePath << LL_ENDL;
+        mEntries.clear();
+        unmap();
+    }
+}
+
+LLAvatarDefinitionCache::~LLAvatarDefinitionCache()
+{
+    unmap();
+}
+
+bool LLAvatarDefinitionCache::loadTree(const std::string& source_path, LLXmlTree& tree)
+{
+    LL_PROFILE_ZONE_SCOPED;
+    // Hashing the file costs a small part of parsing it
+    const std::string contents = LLFile::getContents(source_path);
+    if (contents.empty())
+    {
+        return tree.parseFile(source_path, false);
+    }
+    const U64 hash = HBXXH64::digest(contents);
+    const std::string name = gDirUtilp->getBaseFileName(source_path);
+
+    auto found = mEntries.find(name);
+    if (found != mEntries.end() && found->second.mHash == hash
+        && tree.parseBinary(found->second.mData, found->second.mSize))
+    {
+        mNumHits++;
+        return true;
+    }
+
+    mNumMisses++;
+    if (!tree.parseFile(source_path, false))
+    {
+        return false;
+    }
+    if (name.size() < MAX_NAME_LENGTH)
+    {
+        Entry& entry = mEntries[name];
+        entry.mHash = hash;
+        tree.writeBinary(entry.mBuffer);
+        entry.mData = (const U8*)entry.mBuffer.data();
+        entry.mSize = entry.mBuffer.size();
+        mDirty = true;
+    }
+    return true;
+}
+
+bool LLAvatarDefinitionCache::save()
+{
+    if (!mDirty || mCachePath.empty())
+    {
+        return true;
+    }
+
+    FileHeader header;
+    memcpy(header.mMagic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.mVersion = CACHE_VERSION;
+    header.mByteOrder = CACHE_BYTE_ORDER;
+    header.mNumEntries = (U32)mEntries.size();
+    header.mPadding = 0;
+
+    std::string buffer((const char*)&header, sizeof(FileHeader));
+    U64 offset = sizeof(FileHeader) + mEntries.size() * sizeof(FileEntry);
+    for (const auto& pair : mEntries)
+    {
+        FileEntry file_entry;
+        memset(file_entry.mName, 0, MAX_NAME_LENGTH);
+        memcpy(file_entry.mName, pair.first.data(), pair.first.size());
+        file_entry.mHash = pair.second.mHash;
+        file_entry.mOffset = offset;
+        file_entry.mSize = pair.second.mSize;
+        buffer.append((const char*)&file_entry, sizeof(FileEntry));
+        offset += pair.second.mSize;
+    }
+    for (auto& pair : mEntries)
+    {
+        Entry& entry = pair.second;
+        buffer.append((const char*)entry.mData, entry.mSize);
+        // the file can't be replaced while it is mapped
+        if (entry.mData != (const U8*)entry.mBuffer.data())
+        {
+            entry.mBuffer.assign((const char*)entry.mData, entry.mSize);
+            entry.mData = (const U8*)entry.mBuffer.data();
+        }
+    }
+    unmap();
+
+    // unique, another viewer may be saving the same cache right now
+    const std::string temp_path = mCachePath + "." + LLUUID::generateNewID().asString() + ".tmp";
+    LLFILE* fp = LLFile::fopen(temp_path, "wb");
+    if (!fp)
+    {
+        LL_WARNS() << "Can't write avatar definition cache: " << temp_path << LL_ENDL;
+        return false;
+    }
+    bool written = fwrite(buffer.data(), 1, buffer.size(), fp) == buffer.size();
+    written = LLFile::close(fp) == 0 && written;
+    if (written)
+    {
+        LLFile::remove(mCachePath, ENOENT);
+        written = LLFile::rename(temp_path, mCachePath) == 0;
+    }
+    else
+    {
+        LL_WARNS() << "Can't write avatar definition cache: " << temp_path << LL_ENDL;
+        LLFile::remove(temp_path);
+    }
+    mDirty = !written;
+    return written;
+}
+
+bool LLAvatarDefinitionCache::map()
+{
+#if LL_WINDOWS
+    llutf16string utf16path = utf8str_to_utf16str(mCachePath);
+    HANDLE file = CreateFileW(utf16path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+    {
+        HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        void* address = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+        if (address)
+        {
+            mMapping = mapping;
+            mMapped = (const U8*)address;
+            mMappedSize = (size_t)size.QuadPart;
+        }
+        else if (mapping)
+        {
+            CloseHandle(mapping);
+        }
+    }
+    // the mapping keeps the file open
+    CloseHandle(file);
+#else
+    int fd = ::open(mCachePath.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat file_status;
+    if (fstat(fd, &file_status) == 0 && file_status.st_size > 0)
+    {
+        void* address = ::mmap(NULL, file_status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED)
+        {
+            mMapped = (const U8*)address;
+            mMappedSize = (size_t)file_status.st_size;
+        }
+    }
+    ::close(fd);
+#endif
+    return mMapped != NULL;
+}
+
+void LLAvatarDefinitionCache::unmap()
+{
+    if (!mMapped)
+    {
+        return;
+    }
+#if LL_WINDOWS
+    UnmapViewOfFile(mMapped);
+    CloseHandle(mMapping);
+    mMapping = NULL;
+#else
+    ::munmap((void*)mMapped, mMappedSize);
+#endif
+    mMapped = NULL;
+    mMappedSize = 0;
+}
@@ -0,0 +1,90 @@
+/**
+ * @file llavatardefinitioncache.h
+ * @brief Binary cache of the parsed avatar definition files.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLAVATARDEFINITIONCACHE_H
+#define LL_LLAVATARDEFINITIONCACHE_H
+
+#include <map>
+#include <string>
+
+class LLXmlTree;
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// LLAvatarDefinitionCache
+//
+// Keeps the parsed trees of avatar_lad.xml and avatar_skeleton.xml in one
+// binary file, so that LLAvatarAppearance::initClass() can skip the XML
+// parser.  Every tree is stored with the hash of the file it came from and
+// is only used while that file is unchanged.  The cache file is mapped once
+// when the cache is created, trees that had to be parsed are added to it by
+// save().
+//
+// Only the XML tokenizing is saved: the skeleton info and the visual param
+// infos are still built from the trees by their parseXml(), which costs
+// about as much again.
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+class LLAvatarDefinitionCache
+{
+public:
+    LLAvatarDefinitionCache(const std::string& cache_path);
+    ~LLAvatarDefinitionCache();
+
+    // Loads the file into tree without contents, as parseFile(path, false)
+    // would.  Returns false if the file can't be read or parsed.
+    bool loadTree(const std::string& source_path, LLXmlTree& tree);
+
+    // Writes the cache file again if a tree was parsed since it was mapped
+    bool save();
+
+    S32 getNumHits() const { return mNumHits; }
+    S32 getNumMisses() const { return mNumMisses; }
+
+private:
+    struct Entry
+    {
+        U64                 mHash;      // of the source file
+        const U8*           mData;      // tree in LLXmlTree binary form
+        size_t              mSize;
+        std::string         mBuffer;    // holds mData when it isn't mapped
+    };
+
+    bool map();
+    void unmap();
+
+    std::string             mCachePath;
+    std::map<std::string, Entry> mEntries;  // by source file name
+    bool                    mDirty;
+    S32                     mNumHits;
+    S32                     mNumMisses;
+
+    const U8*               mMapped;
+    size_t                  mMappedSize;
+#if LL_WINDOWS
+    void*                   mMapping;
+#endif
+};
+
+#endif // LL_LLAVATARDEFINITIONCACHE_H
@@ -39,6 +39,7 @@
 #include "lldir.h"
 #include "llvolume.h"
 #include "llendianswizzle.h"
+#include "parallelfor.h"
 
 
 #define HEADER_ASCII "Linden Mesh 1.0"
@@ -757,6 +758,7 @@ LLPolyMesh::LLPolyMesh(LLPolyMeshSharedData *shared_data, LLPolyMesh *reference_
     mReferenceMesh = reference_mesh;
     mAvatarp = NULL;
     mVertexData = NULL;
+    mMorphBatchOpen = false;
 
     mCurVertexCount = 0;
     mFaceIndexCount = 0;
@@ -989,6 +991,86 @@ void LLPolyMesh::initializeForMorph()
     }
 }
 
+//-----------------------------------------------------------------------------
+// beginMorphBatch()
+//-----------------------------------------------------------------------------
+void LLPolyMesh::beginMorphBatch()
+{
+    llassert(!isLOD());
+    if (!mMorphBatchOpen)
+    {
+        mMorphedVertices.resize(mSharedData->mNumVertices, 0);
+        mMorphBatchOpen = true;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// endMorphBatch()
+//-----------------------------------------------------------------------------
+void LLPolyMesh::endMorphBatch()
+{
+    if (mMorphBatchOpen)
+    {
+        mMorphBatchOpen = false;
+        updateMorphedNormals(0, (U32)mMorphedVertices.size());
+    }
+}
+
+//-----------------------------------------------------------------------------
+// updateMorphedNormals()
+//-----------------------------------------------------------------------------
+void LLPolyMesh::updateMorphedNormals(U32 begin, U32 end)
+{
+    U8* morphed = mMorphedVertices.data();
+    for (U32 i = begin; i < end; ++i)
+    {
+        if (morphed[i])
+        {
+            morphed[i] = 0;
+            updateNormal(i);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// endMorphBatches()
+//-----------------------------------------------------------------------------
+// static
+void LLPolyMesh::endMorphBatches(const std::vector<LLPolyMesh*>& meshes, const std::string& queue_name)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+
+    // Vertex ranges small enough to balance the meshes over the threads
+    const U32 CHUNK_VERTICES = 2048;
+
+    struct Chunk
+    {
+        LLPolyMesh* mMesh;
+        U32 mBegin;
+        U32 mEnd;
+    };
+    std::vector<Chunk> chunks;
+    for (LLPolyMesh* mesh : meshes)
+    {
+        if (!mesh->mMorphBatchOpen)
+        {
+            continue;
+        }
+        mesh->mMorphBatchOpen = false;
+        const U32 count = (U32)mesh->mMorphedVertices.size();
+        for (U32 begin = 0; begin < count; begin += CHUNK_VERTICES)
+        {
+            chunks.push_back({ mesh, begin, llmin(begin + CHUNK_VERTICES, count) });
+        }
+    }
+
+    LL::parallel_for(queue_name, chunks.size(), [&chunks](size_t i)
+        {
+            const Chunk& chunk = chunks[i];
+            chunk.mMesh->updateMorphedNormals(chunk.mBegin, chunk.mEnd);
+        });
+}
+
 //-----------------------------------------------------------------------------
 // getMorphData()
 //-----------------------------------------------------------------------------
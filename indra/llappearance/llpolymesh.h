@@ -29,6 +29,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 #include "llstl.h"
 
 #include "v3math.h"
@@ -306,6 +307,36 @@ public:
         return mSharedData->mJointNames;
     }
 
+    //--------------------------------------------------------------------
+    // Morph batches
+    //--------------------------------------------------------------------
+    // While a batch is open LLPolyMorphTarget::apply() only accumulates its
+    // deltas and marks the vertices it moved.  The output normals and
+    // binormals only depend on the accumulated ones, so they are computed
+    // once per vertex when the batch ends instead of once per morph.
+    void    beginMorphBatch();
+    void    endMorphBatch();
+    // Ends the batches of several meshes, split over the named work queue
+    // with the calling thread helping, or right here if it isn't running
+    static void endMorphBatches(const std::vector<LLPolyMesh*>& meshes, const std::string& queue_name);
+
+    // Per vertex flags to set while a batch is open, NULL otherwise
+    U8*     getMorphedVertices() { return mMorphBatchOpen ? mMorphedVertices.data() : NULL; }
+
+    // Output normal and binormal of vertex index from the scaled ones
+    void    updateNormal(U32 index)
+    {
+        LLVector4a norm = mScaledNormals[index];
+        norm.normalize3fast();
+        mNormals[index] = norm;
+
+        LLVector4a tangent;
+        tangent.setCross3(mScaledBinormals[index], norm);
+        LLVector4a& normalized_binormal = mBinormals[index];
+        normalized_binormal.setCross3(norm, tangent);
+        normalized_binormal.normalize3fast();
+    }
+
     LLPolyMorphData*    getMorphData(const std::string& morph_name);
 //  void    removeMorphData(LLPolyMorphData *morph_target);
 //  void    deleteAllMorphData();
@@ -330,6 +361,8 @@ public:
     U32             mCurVertexCount;
 private:
     void initializeForMorph();
+    // updateNormal() for the marked vertices in [begin, end), clearing the marks
+    void updateMorphedNormals(U32 begin, U32 end);
 
     // Dumps diagnostic information about the global mesh table
     static void dumpDiagInfo();
@@ -356,6 +389,10 @@ protected:
 
     LLPolyMesh              *mReferenceMesh;
 
+    // see beginMorphBatch()
+    bool                    mMorphBatchOpen;
+    std::vector<U8>         mMorphedVertices;
+
     // global mesh list
     typedef std::map<std::string, LLPolyMeshSharedData*> LLPolyMeshSharedDataTable;
     static LLPolyMeshSharedDataTable sGlobalSharedMeshList;
@@ -569,18 +569,23 @@ void LLPolyMorphTarget::apply( ESex avatar_sex )
     {
         llassert(!mMesh->isLOD());
         LLVector4a *coords = mMesh->getWritableCoords();
-
         LLVector4a *scaled_normals = mMesh->getScaledNormals();
-        LLVector4a *normals = mMesh->getWritableNormals();
-
         LLVector4a *scaled_binormals = mMesh->getScaledBinormals();
-        LLVector4a *binormals = mMesh->getWritableBinormals();
 
         LLVector4a *clothing_weights = mMesh->getWritableClothingWeights();
         LLVector2 *tex_coords = mMesh->getWritableTexCoords();
 
         F32 *maskWeightArray = (mVertMask) ? mVertMask->getMorphMaskWeights() : NULL;
 
+        if (!getInfo()->mIsClothingMorph)
+        {
+            clothing_weights = NULL;
+        }
+
+        // In a morph batch the normals are only accumulated here, see
+        // LLPolyMesh::beginMorphBatch()
+        U8 *morphed_vertices = mMesh->getMorphedVertices();
+
         for(U32 vert_index_morph = 0; vert_index_morph < mMorphData->mNumIndices; vert_index_morph++)
         {
             S32 vert_index_mesh = mMorphData->mVertexIndices[vert_index_morph];
@@ -596,7 +601,7 @@ void LLPolyMorphTarget::apply( ESex avatar_sex )
             pos.mul(delta_weight*maskWeight);
             coords[vert_index_mesh].add(pos);
 
-            if (getInfo()->mIsClothingMorph && clothing_weights)
+            if (clothing_weights)
             {
                 LLVector4a clothing_offset = mMorphData->mCoords[vert_index_morph];
                 clothing_offset.mul(delta_weight * maskWeight);
@@ -609,12 +614,6 @@ void LLPolyMorphTarget::apply( ESex avatar_sex )
             LLVector4a norm = mMorphData->mNormals[vert_index_morph];
             norm.mul(delta_weight*maskWeight*NORMAL_SOFTEN_FACTOR);
             scaled_normals[vert_index_mesh].add(norm);
-            norm = scaled_normals[vert_index_mesh];
-
-            // guard against degenerate input data before we create NaNs below!
-            //
-            norm.normalize3fast();
-            normals[vert_index_mesh] = norm;
 
             // calculate new binormals
             LLVector4a binorm = mMorphData->mBinormals[vert_index_morph];
@@ -628,12 +627,15 @@ void LLPolyMorphTarget::apply( ESex avatar_sex )
 
             binorm.mul(delta_weight*maskWeight*NORMAL_SOFTEN_FACTOR);
             scaled_binormals[vert_index_mesh].add(binorm);
-            LLVector4a tangent;
-            tangent.setCross3(scaled_binormals[vert_index_mesh], norm);
-            LLVector4a& normalized_binormal = binormals[vert_index_mesh];
 
-            normalized_binormal.setCross3(norm, tangent);
-            normalized_binormal.normalize3fast();
+            if (morphed_vertices)
+            {
+                morphed_vertices[vert_index_mesh] = 1;
+            }
+            else
+            {
+                mMesh->updateNormal(vert_index_mesh);
+            }
 
             tex_coords[vert_index_mesh] += mMorphData->mTexCoords[vert_index_morph] * delta_weight * maskWeight;
         }
@@ -528,6 +528,72 @@ void LLTexLayerSet::renderAlphaMaskTextures(S32 x, S32 y, S32 width, S32 height,
     gGL.setSceneBlendType(LLRender::BT_ALPHA);
 }
 
+LLPointer<LLTexLayerCompositor::Job> LLTexLayerSet::createCompositorJob(S32 width, S32 height)
+{
+    LL_PROFILE_ZONE_SCOPED;
+    LLPointer<LLTexLayerCompositor::Job> job = new LLTexLayerCompositor::Job(width, height);
+
+    mIsVisible = true;
+    for (LLTexLayerInterface* layer : mMaskLayerList)
+    {
+        if (layer->isInvisibleAlphaMask())
+        {
+            mIsVisible = false;
+        }
+    }
+    job->mVisible = mIsVisible;
+    if (!mIsVisible)
+    {
+        return job;
+    }
+
+    for (LLTexLayerInterface* layer : mLayerList)
+    {
+        if (layer->getRenderPass() == LLTexLayer::RP_COLOR && !layer->addToCompositorJob(*job))
+        {
+            return NULL;
+        }
+    }
+
+    // See renderAlphaMaskTextures()
+    const LLTexLayerSetInfo *info = getInfo();
+    if (!info->mStaticAlphaFileName.empty())
+    {
+        job->mStaticAlpha = LLTexLayerStaticImageList::getInstance()->getImageRaw(info->mStaticAlphaFileName, true);
+    }
+    else
+    {
+        job->mClearAlpha = info->mClearAlpha || (mMaskLayerList.size() > 0);
+    }
+    for (LLTexLayerInterface* layer : mMaskLayerList)
+    {
+        if (!layer->addMaskToCompositorJob(*job))
+        {
+            return NULL;
+        }
+    }
+
+    return job;
+}
+
+void LLTexLayerSet::finishCompositorJob(const LLTexLayerCompositor::Job& job)
+{
+    LL_PROFILE_ZONE_SCOPED;
+    for (const LLTexLayerCompositor::Layer& job_layer : job.mLayers)
+    {
+        if (!job_layer.mMorphLayer)
+        {
+            continue;
+        }
+        // The layers may have changed while the job ran, only live ones take
+        // their mask
+        for (LLTexLayerInterface* layer : mLayerList)
+        {
+            layer->finishCompositorLayer(job_layer, job.mWidth, job.mHeight);
+        }
+    }
+}
+
 void LLTexLayerSet::applyMorphMask(const U8* tex_data, S32 width, S32 height, S32 num_components)
 {
     mAvatarAppearance->applyMorphMask(tex_data, width, height, num_components, mBakedTexIndex);
@@ -1181,6 +1247,14 @@ bool LLTexLayer::render(S32 x, S32 y, S32 width, S32 height, LLRenderTarget* bou
 }
 
 const U8*   LLTexLayer::getAlphaData() const
+{
+    U32 cache_index = getAlphaCacheIndex();
+
+    alpha_cache_t::const_iterator iter2 = mAlphaCache.find(cache_index);
+    return (iter2 == mAlphaCache.end()) ? 0 : iter2->second;
+}
+
+U32 LLTexLayer::getAlphaCacheIndex() const
 {
     LLCRC alpha_mask_crc;
     const LLUUID& uuid = getUUID();
@@ -1193,10 +1267,19 @@ const U8*   LLTexLayer::getAlphaData() const
         alpha_mask_crc.update((U8*)&param_weight, sizeof(F32));
     }
 
-    U32 cache_index = alpha_mask_crc.getCRC();
+    return alpha_mask_crc.getCRC();
+}
 
-    alpha_cache_t::const_iterator iter2 = mAlphaCache.find(cache_index);
-    return (iter2 == mAlphaCache.end()) ? 0 : iter2->second;
+// clear out a slot if we have filled our cache
+void LLTexLayer::trimAlphaCache()
+{
+    S32 max_cache_entries = getTexLayerSet()->getAvatarAppearance()->isSelf() ? 4 : 1;
+    while ((S32)mAlphaCache.size() >= max_cache_entries)
+    {
+        alpha_cache_t::iterator iter2 = mAlphaCache.begin(); // arbitrarily grab the first entry
+        ll_aligned_free_32(iter2->second);
+        mAlphaCache.erase(iter2);
+    }
 }
 
 bool LLTexLayer::findNetColor(LLColor4* net_color) const
@@ -1388,32 +1471,14 @@ void LLTexLayer::renderMorphMasks(S32 x, S32 y, S32 width, S32 height, const LLC
 
     if (hasMorph() && success)
     {
-        LLCRC alpha_mask_crc;
-        const LLUUID& uuid = getUUID();
-        alpha_mask_crc.update((U8*)(&uuid.mData), UUID_BYTES);
-
-        for (const LLTexLayerParamAlpha* param : mParamAlphaList)
-        {
-            F32 param_weight = param->getWeight();
-            alpha_mask_crc.update((U8*)&param_weight, sizeof(F32));
-        }
-
-        U32 cache_index = alpha_mask_crc.getCRC();
+        U32 cache_index = getAlphaCacheIndex();
         U8* alpha_data = NULL;
                 // We believe we need to generate morph masks, do not assume that the cached version is accurate.
                 // We can get bad morph masks during login, on minimize, and occasional gl errors.
                 // We should only be doing this when we believe something has changed with respect to the user's appearance.
         {
                        LL_DEBUGS("Avatar") << "gl alpha cache of morph mask not found, doing readback: " << getName() << LL_ENDL;
-                        // clear out a slot if we have filled our cache
-            S32 max_cache_entries = getTexLayerSet()->getAvatarAppearance()->isSelf() ? 4 : 1;
-            while ((S32)mAlphaCache.size() >= max_cache_entries)
-            {
-                alpha_cache_t::iterator iter2 = mAlphaCache.begin(); // arbitrarily grab the first entry
-                alpha_data = iter2->second;
-                ll_aligned_free_32(alpha_data);
-                mAlphaCache.erase(iter2);
-            }
+            trimAlphaCache();
 
             // GPUs tend to be very uptight about memory alignment as the DMA used to convey
             // said data to the card works better when well-aligned so plain old default-aligned heap mem is a no-no
@@ -1485,6 +1550,149 @@ void LLTexLayer::renderMorphMasks(S32 x, S32 y, S32 width, S32 height, const LLC
     }
 }
 
+/*virtual*/ bool LLTexLayer::addToCompositorJob(LLTexLayerCompositor::Job& job)
+{
+    // See render() and renderMorphMasks()
+    LLColor4 net_color;
+    bool color_specified = findNetColor(&net_color);
+
+    if (mTexLayerSet->getAvatarAppearance()->mIsDummy)
+    {
+        color_specified = true;
+        net_color = LLAvatarAppearance::getDummyColor();
+    }
+
+    // If you can't see the layer, don't render it.
+    if( is_approx_zero( net_color.mV[VALPHA] ) )
+    {
+        return true;
+    }
+
+    const LLTexLayerInfo* info = getInfo();
+    LLTexLayerStaticImageList* static_images = LLTexLayerStaticImageList::getInstance();
+    LLTexLayerCompositor::Layer layer;
+    layer.mColor = net_color;
+    layer.mWriteAllChannels = info->mWriteAllChannels;
+
+    if (!mParamAlphaList.empty())
+    {
+        layer.mHasAlphaMask = true;
+        LLTexLayerParamAlpha* first_param = *mParamAlphaList.begin();
+        layer.mClearMask = !first_param || !first_param->getMultiplyBlend();
+        for (LLTexLayerParamAlpha* param : mParamAlphaList)
+        {
+            LLTexLayerCompositor::AlphaParam alpha_param;
+            if (param->getCompositorParam(alpha_param))
+            {
+                layer.mAlphaParams.push_back(alpha_param);
+            }
+        }
+
+        if (info->mLocalTexture != -1 && mLocalTextureObject)
+        {
+            LLGLTexture* tex = mLocalTextureObject->getImage();
+            if (tex && (tex->getComponents() == 4))
+            {
+                layer.mMaskTexture = mTexLayerSet->getLocalTextureRaw(tex);
+                if (layer.mMaskTexture.isNull())
+                {
+                    return false;
+                }
+            }
+        }
+
+        if (!info->mStaticImageFileName.empty() && info->mStaticImageIsMask)
+        {
+            layer.mStaticMask = static_images->getImageRaw(info->mStaticImageFileName, info->mStaticImageIsMask);
+        }
+
+        if (hasMorph())
+        {
+            layer.mMorphLayer = this;
+            layer.mAlphaCacheIndex = getAlphaCacheIndex();
+        }
+    }
+
+    if ((info->mLocalTexture != -1) && !info->mUseLocalTextureAlphaOnly &&
+        mLocalTextureObject && mLocalTextureObject->getImage() &&
+        mLocalTextureObject->getID() != IMG_DEFAULT_AVATAR)
+    {
+        layer.mTexture = mTexLayerSet->getLocalTextureRaw(mLocalTextureObject->getImage());
+        if (layer.mTexture.isNull())
+        {
+            return false;
+        }
+    }
+
+    if (!info->mStaticImageFileName.empty())
+    {
+        layer.mStaticImage = static_images->getImageRaw(info->mStaticImageFileName, info->mStaticImageIsMask);
+    }
+
+    layer.mDrawColor = ((-1 == info->mLocalTexture) || info->mUseLocalTextureAlphaOnly) &&
+                       info->mStaticImageFileName.empty() &&
+                       color_specified;
+
+    job.mLayers.push_back(layer);
+    return true;
+}
+
+/*virtual*/ bool LLTexLayer::addMaskToCompositorJob(LLTexLayerCompositor::Job& job)
+{
+    // See blendAlphaTexture()
+    const LLTexLayerInfo* info = getInfo();
+    if (!info->mStaticImageFileName.empty())
+    {
+        LLImageRaw* image = LLTexLayerStaticImageList::getInstance()->getImageRaw(info->mStaticImageFileName, info->mStaticImageIsMask);
+        if (image)
+        {
+            job.mMaskLayers.push_back(image);
+        }
+    }
+    else if (info->mLocalTexture >= 0 && info->mLocalTexture < TEX_NUM_INDICES)
+    {
+        LLGLTexture* tex = mLocalTextureObject->getImage();
+        if (tex)
+        {
+            LLImageRaw* image = mTexLayerSet->getLocalTextureRaw(tex);
+            if (!image)
+            {
+                return false;
+            }
+            job.mMaskLayers.push_back(image);
+        }
+    }
+    return true;
+}
+
+/*virtual*/ void LLTexLayer::finishCompositorLayer(const LLTexLayerCompositor::Layer& layer, S32 width, S32 height)
+{
+    // See the end of renderMorphMasks()
+    if (layer.mMorphLayer != this || !hasMorph() || (S32)layer.mMorphMask.size() < width * height)
+    {
+        return;
+    }
+
+    alpha_cache_t::iterator iter = mAlphaCache.find(layer.mAlphaCacheIndex);
+    if (iter != mAlphaCache.end())
+    {
+        ll_aligned_free_32(iter->second);
+        mAlphaCache.erase(iter);
+    }
+    trimAlphaCache();
+
+    // Same size as a readback
+    size_t row_size = (width + 3) & ~0x3;
+    U8* alpha_data = (U8*)ll_aligned_malloc_32(row_size * height);
+    memcpy(alpha_data, layer.mMorphMask.data(), width * height);
+    mAlphaCache[layer.mAlphaCacheIndex] = alpha_data;
+
+    getTexLayerSet()->getAvatarAppearance()->dirtyMesh();
+
+    mMorphMasksValid = true;
+    getTexLayerSet()->applyMorphMask(alpha_data, width, height, 1);
+}
+
 void LLTexLayer::addAlphaMask(U8 *data, S32 originX, S32 originY, S32 width, S32 height, LLRenderTarget* bound_target)
 {
     LL_PROFILE_ZONE_SCOPED;
@@ -1663,6 +1871,67 @@ LLTexLayer* LLTexLayerTemplate::getLayer(U32 i) const
     return success;
 }
 
+/*virtual*/ bool LLTexLayerTemplate::addToCompositorJob(LLTexLayerCompositor::Job& job)
+{
+    if (!mInfo)
+    {
+        return false;
+    }
+
+    updateWearableCache();
+    for (LLWearable* wearable : mWearableCache)
+    {
+        LLLocalTextureObject *lto = NULL;
+        LLTexLayer *layer = NULL;
+        if (wearable)
+        {
+            lto = wearable->getLocalTextureObject(mInfo->mLocalTexture);
+        }
+        if (lto)
+        {
+            layer = lto->getTexLayer(getName());
+        }
+        if (layer)
+        {
+            wearable->writeToAvatar(mAvatarAppearance);
+            layer->setLTO(lto);
+            if (!layer->addToCompositorJob(job))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/*virtual*/ bool LLTexLayerTemplate::addMaskToCompositorJob(LLTexLayerCompositor::Job& job)
+{
+    U32 num_wearables = updateWearableCache();
+    for (U32 i = 0; i < num_wearables; i++)
+    {
+        LLTexLayer *layer = getLayer(i);
+        if (layer && !layer->addMaskToCompositorJob(job))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*virtual*/ void LLTexLayerTemplate::finishCompositorLayer(const LLTexLayerCompositor::Layer& job_layer, S32 width, S32 height)
+{
+    U32 num_wearables = updateWearableCache();
+    for (U32 i = 0; i < num_wearables; i++)
+    {
+        LLTexLayer *layer = getLayer(i);
+        if (layer)
+        {
+            layer->finishCompositorLayer(job_layer, width, height);
+        }
+    }
+}
+
 /*virtual*/ bool LLTexLayerTemplate::blendAlphaTexture( S32 x, S32 y, S32 width, S32 height) // Multiplies a single alpha texture against the frame buffer
 {
     bool success = true;
@@ -1784,6 +2053,7 @@ void LLTexLayerSet::cloneTemplates(LLLocalTextureObject *lto, LLAvatarAppearance
 LLTexLayerStaticImageList::LLTexLayerStaticImageList() :
     mGLBytes(0),
     mTGABytes(0),
+    mRawBytes(0),
     mImageNames(16384)
 {
 }
@@ -1797,24 +2067,28 @@ void LLTexLayerStaticImageList::dumpByteCount() const
 {
     LL_INFOS() << "Avatar Static Textures " <<
         "KB GL:" << (mGLBytes / 1024) <<
-        "KB TGA:" << (mTGABytes / 1024) << "KB" << LL_ENDL;
+        "KB TGA:" << (mTGABytes / 1024) <<
+        "KB Raw:" << (mRawBytes / 1024) << "KB" << LL_ENDL;
 }
 
 void LLTexLayerStaticImageList::deleteCachedImages()
 {
-    if( mGLBytes || mTGABytes )
+    if( mGLBytes || mTGABytes || mRawBytes )
     {
         LL_INFOS() << "Clearing Static Textures " <<
             "KB GL:" << (mGLBytes / 1024) <<
-            "KB TGA:" << (mTGABytes / 1024) << "KB" << LL_ENDL;
+            "KB TGA:" << (mTGABytes / 1024) <<
+            "KB Raw:" << (mRawBytes / 1024) << "KB" << LL_ENDL;
 
         //mStaticImageLists uses LLPointers, clear() will cause deletion
 
         mStaticImageListTGA.clear();
         mStaticImageList.clear();
+        mStaticImageListRaw.clear();
 
         mGLBytes = 0;
         mTGABytes = 0;
+        mRawBytes = 0;
     }
 }
 
@@ -1873,15 +2147,7 @@ LLGLTexture* LLTexLayerStaticImageList::getTexture(const std::string& file_name,
         {
             if( (image_raw->getComponents() == 1) && is_mask )
             {
-                // Convert grayscale alpha masks from single channel into RGBA.
-                // Fill RGB with black to allow fixed function gl calls
-                // to match shader implementation.
-                LLPointer<LLImageRaw> alpha_image_raw = image_raw;
-                image_raw = new LLImageRaw(image_raw->getWidth(),
-                                           image_raw->getHeight(),
-                                           4);
-
-                image_raw->copyUnscaledAlphaMask(alpha_image_raw, LLColor4U::black);
+                image_raw = convertAlphaMask(image_raw);
             }
             tex->createGLTexture(0, image_raw, 0, true, LLGLTexture::LOCAL);
 
@@ -1900,6 +2166,46 @@ LLGLTexture* LLTexLayerStaticImageList::getTexture(const std::string& file_name,
     return tex;
 }
 
+// Returns the decoded data from a tga file named file_name, converted like
+// getTexture() does.  Caches the result to speed identical subsequent requests.
+LLImageRaw* LLTexLayerStaticImageList::getImageRaw(const std::string& file_name, bool is_mask)
+{
+    LL_PROFILE_ZONE_SCOPED;
+    const char *namekey = mImageNames.addString(file_name);
+    image_raw_map_t::const_iterator iter = mStaticImageListRaw.find(namekey);
+    if( iter != mStaticImageListRaw.end() )
+    {
+        return iter->second;
+    }
+
+    LLPointer<LLImageRaw> image_raw = new LLImageRaw;
+    if( !loadImageRaw( file_name, image_raw ) )
+    {
+        return NULL;
+    }
+    if( (image_raw->getComponents() == 1) && is_mask )
+    {
+        image_raw = convertAlphaMask(image_raw);
+    }
+    mStaticImageListRaw[ namekey ] = image_raw;
+    mRawBytes += image_raw->getDataSize();
+    return image_raw;
+}
+
+// static
+LLPointer<LLImageRaw> LLTexLayerStaticImageList::convertAlphaMask(LLImageRaw* alpha_image_raw)
+{
+    // Convert grayscale alpha masks from single channel into RGBA.
+    // Fill RGB with black to allow fixed function gl calls
+    // to match shader implementation.
+    LLPointer<LLImageRaw> image_raw = new LLImageRaw(alpha_image_raw->getWidth(),
+                                                     alpha_image_raw->getHeight(),
+                                                     4);
+
+    image_raw->copyUnscaledAlphaMask(alpha_image_raw, LLColor4U::black);
+    return image_raw;
+}
+
 // Reads a .tga file, decodes it, and puts the decoded data in image_raw.
 // Returns true if successful.
 bool LLTexLayerStaticImageList::loadImageRaw(const std::string& file_name, LLImageRaw* image_raw)
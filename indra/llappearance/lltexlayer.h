@@ -31,6 +31,7 @@
 #include "llglslshader.h"
 #include "llgltexture.h"
 #include "llavatarappearancedefines.h"
+#include "lltexlayercompositor.h"
 #include "lltexlayerparams.h"
 
 class LLAvatarAppearance;
@@ -70,6 +71,13 @@ public:
     virtual bool            blendAlphaTexture(S32 x, S32 y, S32 width, S32 height) = 0;
     virtual bool            isInvisibleAlphaMask() const = 0;
 
+    // What render() and blendAlphaTexture() would draw, captured for the CPU
+    // compositor.  Return false if an image isn't available in memory.
+    virtual bool            addToCompositorJob(LLTexLayerCompositor::Job& job) = 0;
+    virtual bool            addMaskToCompositorJob(LLTexLayerCompositor::Job& job) = 0;
+    // Takes the morph mask of a finished job's layer if it belongs to this one
+    virtual void            finishCompositorLayer(const LLTexLayerCompositor::Layer& layer, S32 width, S32 height) = 0;
+
     const LLTexLayerInfo*   getInfo() const             { return mInfo; }
     virtual bool            setInfo(const LLTexLayerInfo *info, LLWearable* wearable); // sets mInfo, calls initialization functions
     LLWearableType::EType   getWearableType() const;
@@ -128,6 +136,9 @@ public:
     /*virtual*/ void        setHasMorph(bool newval);
     /*virtual*/ void        deleteCaches();
     /*virtual*/ bool        isInvisibleAlphaMask() const;
+    /*virtual*/ bool        addToCompositorJob(LLTexLayerCompositor::Job& job);
+    /*virtual*/ bool        addMaskToCompositorJob(LLTexLayerCompositor::Job& job);
+    /*virtual*/ void        finishCompositorLayer(const LLTexLayerCompositor::Layer& layer, S32 width, S32 height);
 protected:
     U32                     updateWearableCache() const;
     LLTexLayer*             getLayer(U32 i) const;
@@ -163,6 +174,9 @@ public:
     void                    renderMorphMasks(S32 x, S32 y, S32 width, S32 height, const LLColor4 &layer_color, LLRenderTarget* bound_target, bool force_render);
     void                    addAlphaMask(U8 *data, S32 originX, S32 originY, S32 width, S32 height, LLRenderTarget* bound_target);
     /*virtual*/ bool        isInvisibleAlphaMask() const;
+    /*virtual*/ bool        addToCompositorJob(LLTexLayerCompositor::Job& job);
+    /*virtual*/ bool        addMaskToCompositorJob(LLTexLayerCompositor::Job& job);
+    /*virtual*/ void        finishCompositorLayer(const LLTexLayerCompositor::Layer& layer, S32 width, S32 height);
 
     void                    setLTO(LLLocalTextureObject *lto)   { mLocalTextureObject = lto; }
     LLLocalTextureObject*   getLTO()                            { return mLocalTextureObject; }
@@ -172,6 +186,8 @@ public:
     static void             calculateTexLayerColor(const param_color_list_t &param_list, LLColor4 &net_color);
 protected:
     LLUUID                  getUUID() const;
+    U32                     getAlphaCacheIndex() const;
+    void                    trimAlphaCache();
     typedef std::map<U32, U8*> alpha_cache_t;
     alpha_cache_t           mAlphaCache;
     LLLocalTextureObject*   mLocalTextureObject;
@@ -202,6 +218,14 @@ public:
     bool                        render(S32 x, S32 y, S32 width, S32 height, LLRenderTarget* bound_target = nullptr);
     void                        renderAlphaMaskTextures(S32 x, S32 y, S32 width, S32 height, LLRenderTarget* bound_target = nullptr, bool forceClear = false);
 
+    // Captures what render() would draw for LLTexLayerCompositor, NULL if
+    // some image is only on the GPU.  The finished job's morph masks are
+    // applied by finishCompositorJob(), on the main thread again.
+    LLPointer<LLTexLayerCompositor::Job> createCompositorJob(S32 width, S32 height);
+    void                        finishCompositorJob(const LLTexLayerCompositor::Job& job);
+    // The decoded image of a local texture, if kept in memory
+    virtual LLImageRaw*         getLocalTextureRaw(LLGLTexture* tex) { return NULL; }
+
     bool                        isBodyRegion(const std::string& region) const;
     void                        applyMorphMask(const U8* tex_data, S32 width, S32 height, S32 num_components);
     bool                        isMorphValid() const;
@@ -296,18 +320,24 @@ class LLTexLayerStaticImageList : public LLSingleton<LLTexLayerStaticImageList>
 public:
     LLGLTexture*        getTexture(const std::string& file_name, bool is_mask);
     LLImageTGA*         getImageTGA(const std::string& file_name);
+    // The decoded image that getTexture() would upload, for the CPU compositor
+    LLImageRaw*         getImageRaw(const std::string& file_name, bool is_mask);
     void                deleteCachedImages();
     void                dumpByteCount() const;
 protected:
     bool                loadImageRaw(const std::string& file_name, LLImageRaw* image_raw);
+    static LLPointer<LLImageRaw> convertAlphaMask(LLImageRaw* alpha_image_raw);
 private:
     LLStringTable       mImageNames;
     typedef std::map<const char*, LLPointer<LLGLTexture> > texture_map_t;
     texture_map_t       mStaticImageList;
     typedef std::map<const char*, LLPointer<LLImageTGA> > image_tga_map_t;
     image_tga_map_t     mStaticImageListTGA;
+    typedef std::map<const char*, LLPointer<LLImageRaw> > image_raw_map_t;
+    image_raw_map_t     mStaticImageListRaw;
     S32                 mGLBytes;
     S32                 mTGABytes;
+    S32                 mRawBytes;
 };
 
 #endif  // LL_LLTEXLAYER_H
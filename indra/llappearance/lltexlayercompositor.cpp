@@ -0,0 +1,678 @@
+/**
+ * @file lltexlayercompositor.cpp
+ * @brief CPU compositor for avatar texture layer sets.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "lltexlayercompositor.h"
+
+#include "llexception.h"
+#include "llmath.h"
+#include "llsimdmath.h"
+#include "parallelfor.h"
+#include "workqueue.h"
+
+namespace
+{
+    // Rows composited together, small enough to stay in cache through all
+    // the layers of a 1024 wide bake
+    const S32 BAND_ROWS = 16;
+
+    // a * b / 255, rounded
+    inline U8 mul8(U32 a, U32 b)
+    {
+        U32 t = a * b + 128;
+        return (U8)((t + (t >> 8)) >> 8);
+    }
+
+    // Same on 16 bit lanes holding 0..255
+    inline __m128i mul8(__m128i a, __m128i b)
+    {
+        __m128i t = _mm_add_epi16(_mm_mullo_epi16(a, b), _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+    }
+
+    // Alpha of each of two pixels in 16 bit lanes copied to all four channels
+    inline __m128i splat_alpha(__m128i v)
+    {
+        return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    }
+
+    inline __m128i select(__m128i mask, __m128i a, __m128i b)
+    {
+        return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+    }
+
+    template <LLTexLayerCompositor::EBlend BLEND>
+    inline __m128i blend(__m128i src, __m128i dst)
+    {
+        if (BLEND == LLTexLayerCompositor::BLEND_REPLACE)
+        {
+            return src;
+        }
+        __m128i factor = splat_alpha(BLEND == LLTexLayerCompositor::BLEND_ALPHA ? src : dst);
+        __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(255), factor);
+        return _mm_add_epi16(mul8(src, factor), mul8(dst, inverse));
+    }
+
+    template <LLTexLayerCompositor::EBlend BLEND>
+    inline void blend(const U8* src, U8* dst)
+    {
+        if (BLEND == LLTexLayerCompositor::BLEND_REPLACE)
+        {
+            memcpy(dst, src, 4);
+            return;
+        }
+        const U32 factor = BLEND == LLTexLayerCompositor::BLEND_ALPHA ? src[3] : dst[3];
+        for (S32 c = 0; c < 4; c++)
+        {
+            dst[c] = (U8)llmin(255, mul8(src[c], factor) + mul8(dst[c], 255 - factor));
+        }
+    }
+
+    template <LLTexLayerCompositor::EBlend BLEND>
+    void draw_span_scalar(U8* dst, const U8* tex, const U8 color[4], S32 count, bool alpha_test)
+    {
+        U8 src[4] = { color[0], color[1], color[2], color[3] };
+        for (S32 i = 0; i < count; i++, dst += 4)
+        {
+            if (tex)
+            {
+                for (S32 c = 0; c < 4; c++)
+                {
+                    src[c] = mul8(tex[i * 4 + c], color[c]);
+                }
+            }
+            if (alpha_test && src[3] <= 1)
+            {
+                continue;
+            }
+            blend<BLEND>(src, dst);
+        }
+    }
+
+    template <LLTexLayerCompositor::EBlend BLEND>
+    void draw_span(U8* dst, const U8* tex, const U8 color[4], S32 count, bool alpha_test)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i one = _mm_set1_epi16(1);
+        const __m128i tint = _mm_set_epi16(color[3], color[2], color[1], color[0],
+                                           color[3], color[2], color[1], color[0]);
+        __m128i src_lo = tint;
+        __m128i src_hi = tint;
+
+        S32 i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i d = _mm_loadu_si128((const __m128i*)(dst + i * 4));
+            __m128i dst_lo = _mm_unpacklo_epi8(d, zero);
+            __m128i dst_hi = _mm_unpackhi_epi8(d, zero);
+            if (tex)
+            {
+                __m128i t = _mm_loadu_si128((const __m128i*)(tex + i * 4));
+                src_lo = mul8(_mm_unpacklo_epi8(t, zero), tint);
+                src_hi = mul8(_mm_unpackhi_epi8(t, zero), tint);
+            }
+            __m128i out_lo = blend<BLEND>(src_lo, dst_lo);
+            __m128i out_hi = blend<BLEND>(src_hi, dst_hi);
+            if (alpha_test)
+            {
+                out_lo = select(_mm_cmpgt_epi16(splat_alpha(src_lo), one), out_lo, dst_lo);
+                out_hi = select(_mm_cmpgt_epi16(splat_alpha(src_hi), one), out_hi, dst_hi);
+            }
+            _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_packus_epi16(out_lo, out_hi));
+        }
+        draw_span_scalar<BLEND>(dst + i * 4, tex ? tex + i * 4 : NULL, color, count - i, alpha_test);
+    }
+
+    template <LLTexLayerCompositor::EAlphaOp OP>
+    inline U8 alpha_op(U8 dst, U8 alpha)
+    {
+        switch (OP)
+        {
+        case LLTexLayerCompositor::ALPHA_SET:
+            return alpha;
+        case LLTexLayerCompositor::ALPHA_ADD:
+            return (U8)llmin(255, dst + alpha);
+        default:
+            return mul8(dst, alpha);
+        }
+    }
+
+    template <LLTexLayerCompositor::EAlphaOp OP>
+    void alpha_span_scalar(U8* dst, const U8* alpha, U8 value, S32 count, bool alpha_test)
+    {
+        for (S32 i = 0; i < count; i++)
+        {
+            const U8 a = alpha ? alpha[i] : value;
+            if (!alpha_test || a > 1)
+            {
+                dst[i * 4 + 3] = alpha_op<OP>(dst[i * 4 + 3], a);
+            }
+        }
+    }
+
+    template <LLTexLayerCompositor::EAlphaOp OP>
+    void alpha_span(U8* dst, const U8* alpha, U8 value, S32 count, bool alpha_test)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i one = _mm_set1_epi8(1);
+        const __m128i alpha_bytes = _mm_set1_epi32((S32)0xFF000000);
+        __m128i a = _mm_set1_epi8((char)value);
+
+        S32 i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i d = _mm_loadu_si128((const __m128i*)(dst + i * 4));
+            if (alpha)
+            {
+                // each alpha byte copied to the four bytes of its pixel
+                S32 packed;
+                memcpy(&packed, alpha + i, sizeof(packed));
+                a = _mm_cvtsi32_si128(packed);
+                a = _mm_unpacklo_epi8(a, a);
+                a = _mm_unpacklo_epi16(a, a);
+            }
+            __m128i out;
+            switch (OP)
+            {
+            case LLTexLayerCompositor::ALPHA_SET:
+                out = a;
+                break;
+            case LLTexLayerCompositor::ALPHA_ADD:
+                out = _mm_adds_epu8(d, a);
+                break;
+            default:
+                out = _mm_packus_epi16(mul8(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(a, zero)),
+                                       mul8(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(a, zero)));
+                break;
+            }
+            __m128i mask = alpha_bytes;
+            if (alpha_test)
+            {
+                // only where the alpha is above 1
+                mask = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_subs_epu8(a, one), zero), mask);
+            }
+            _mm_storeu_si128((__m128i*)(dst + i * 4), select(mask, out, d));
+        }
+        alpha_span_scalar<OP>(dst + i * 4, alpha ? alpha + i : NULL, value, count - i, alpha_test);
+    }
+
+    U8 to_u8(F32 value)
+    {
+        return (U8)ll_round(llclamp(value, 0.f, 1.f) * 255.f);
+    }
+
+    // The two texels on either side of each sample of GL_LINEAR filtering
+    // with clamped coordinates, and the weight of the second in 1/256
+    struct Tap
+    {
+        S32 mFirst;
+        S32 mSecond;
+        U32 mWeight;
+    };
+
+    std::vector<Tap> get_taps(S32 src_size, S32 size)
+    {
+        std::vector<Tap> taps(size);
+        for (S32 i = 0; i < size; i++)
+        {
+            const F32 pos = llclamp(((F32)i + 0.5f) * src_size / size - 0.5f, 0.f, (F32)(src_size - 1));
+            const S32 first = (S32)pos;
+            taps[i] = { first, llmin(first + 1, src_size - 1), (U32)ll_round((pos - first) * 256.f) };
+        }
+        return taps;
+    }
+
+    // Stretches a plane like the GPU samples it, filtering the rows first and
+    // then between rows
+    template <S32 CHANNELS>
+    void scale_plane(const std::vector<U8>& src, S32 src_width, S32 src_height, S32 width, S32 height, std::vector<U8>& dst)
+    {
+        const std::vector<Tap> columns = get_taps(src_width, width);
+        const std::vector<Tap> rows = get_taps(src_height, height);
+        const S32 row_size = width * CHANNELS;
+
+        // every source row at the new width, in 1/256
+        std::vector<U16> stretched(src_height * row_size);
+        for (S32 y = 0; y < src_height; y++)
+        {
+            const U8* in = src.data() + y * src_width * CHANNELS;
+            U16* out = stretched.data() + y * row_size;
+            for (const Tap& column : columns)
+            {
+                const U8* first = in + column.mFirst * CHANNELS;
+                const U8* second = in + column.mSecond * CHANNELS;
+                for (S32 c = 0; c < CHANNELS; c++)
+                {
+                    *out++ = (U16)(first[c] * (256 - column.mWeight) + second[c] * column.mWeight);
+                }
+            }
+        }
+
+        dst.resize(height * row_size);
+        for (S32 y = 0; y < height; y++)
+        {
+            const Tap& row = rows[y];
+            const U16* upper = stretched.data() + row.mFirst * row_size;
+            const U16* lower = stretched.data() + row.mSecond * row_size;
+            U8* out = dst.data() + y * row_size;
+            for (S32 i = 0; i < row_size; i++)
+            {
+                out[i] = (U8)((upper[i] * (256 - row.mWeight) + lower[i] * row.mWeight + 32768) >> 16);
+            }
+        }
+    }
+
+    // The image stretched over the whole bake like gl_rect_2d_simple_tex(),
+    // as RGBA, or only its alpha.  A single channel is the alpha of an alpha
+    // texture if is_alpha, luminance otherwise.
+    void to_plane(LLImageRaw* image, S32 width, S32 height, bool alpha_only, bool is_alpha, std::vector<U8>& plane)
+    {
+        LLImageDataSharedLock lock(image);
+        const U8* data = image->getData();
+        const S32 components = image->getComponents();
+        const S32 src_width = image->getWidth();
+        const S32 src_height = image->getHeight();
+        if (!data || src_width <= 0 || src_height <= 0 || (components != 1 && components != 3 && components != 4))
+        {
+            return;
+        }
+
+        // Converted at the image's size first, the conversion is linear so
+        // filtering after it is the same
+        const bool scale = src_width != width || src_height != height;
+        std::vector<U8> converted;
+        std::vector<U8>& out_plane = scale ? converted : plane;
+
+        const S32 pixels = src_width * src_height;
+        if (alpha_only)
+        {
+            out_plane.resize(pixels);
+            for (S32 i = 0; i < pixels; i++)
+            {
+                if (components == 4)
+                {
+                    out_plane[i] = data[i * 4 + 3];
+                }
+                else
+                {
+                    out_plane[i] = (components == 1 && is_alpha) ? data[i] : 255;
+                }
+            }
+        }
+        else
+        {
+            out_plane.resize(pixels * 4);
+            U8* out = out_plane.data();
+            for (S32 i = 0; i < pixels; i++, out += 4)
+            {
+                const U8* in = data + i * components;
+                if (components == 4)
+                {
+                    memcpy(out, in, 4);
+                }
+                else if (components == 3)
+                {
+                    out[0] = in[0];
+                    out[1] = in[1];
+                    out[2] = in[2];
+                    out[3] = 255;
+                }
+                else if (is_alpha)
+                {
+                    out[0] = out[1] = out[2] = 0;
+                    out[3] = in[0];
+                }
+                else
+                {
+                    out[0] = out[1] = out[2] = in[0];
+                    out[3] = 255;
+                }
+            }
+        }
+
+        if (scale)
+        {
+            if (alpha_only)
+            {
+                scale_plane<1>(converted, src_width, src_height, width, height, plane);
+            }
+            else
+            {
+                scale_plane<4>(converted, src_width, src_height, width, height, plane);
+            }
+        }
+    }
+
+    // The job's images converted to the size of the bake
+    struct Planes
+    {
+        struct Layer
+        {
+            std::vector<std::vector<U8> > mAlphaParams;
+            std::vector<U8> mMaskTexture;
+            std::vector<U8> mStaticMask;
+            std::vector<U8> mTexture;
+            std::vector<U8> mStaticImage;
+        };
+        std::vector<Layer> mLayers;
+        std::vector<U8> mStaticAlpha;
+        std::vector<std::vector<U8> > mMaskLayers;
+    };
+
+    inline const U8* plane_at(const std::vector<U8>& plane, S32 offset)
+    {
+        return plane.empty() ? NULL : plane.data() + offset;
+    }
+
+    // See LLTexLayerSet::render()
+    void composite_rows(LLTexLayerCompositor::Job& job, const Planes& planes, S32 first_row, S32 end_row)
+    {
+        typedef LLTexLayerCompositor compositor;
+
+        const S32 begin = first_row * job.mWidth;
+        const S32 count = (end_row - first_row) * job.mWidth;
+        U8* dst = job.mResult->getData() + begin * 4;
+
+        const U8 black[4] = { 0, 0, 0, 255 };
+        const U8 clear[4] = { 0, 0, 0, 0 };
+        compositor::drawSpan(dst, NULL, job.mVisible ? black : clear, count, compositor::BLEND_REPLACE, false);
+        if (!job.mVisible)
+        {
+            return;
+        }
+
+        for (size_t l = 0; l < job.mLayers.size(); l++)
+        {
+            LLTexLayerCompositor::Layer& layer = job.mLayers[l];
+            const Planes::Layer& layer_planes = planes.mLayers[l];
+            const U8 color[4] = { to_u8(layer.mColor.mV[VRED]), to_u8(layer.mColor.mV[VGREEN]),
+                                  to_u8(layer.mColor.mV[VBLUE]), to_u8(layer.mColor.mV[VALPHA]) };
+
+            // LLTexLayer::renderMorphMasks()
+            compositor::EBlend blend = compositor::BLEND_ALPHA;
+            if (layer.mHasAlphaMask)
+            {
+                if (layer.mClearMask)
+                {
+                    compositor::alphaSpan(dst, NULL, 0, count, compositor::ALPHA_SET, false);
+                }
+                for (size_t p = 0; p < layer.mAlphaParams.size(); p++)
+                {
+                    const LLTexLayerCompositor::AlphaParam& param = layer.mAlphaParams[p];
+                    const U8* alpha = plane_at(layer_planes.mAlphaParams[p], begin);
+                    if (param.mImage.notNull() && !alpha)
+                    {
+                        continue;
+                    }
+                    compositor::alphaSpan(dst, alpha, to_u8(param.mWeight), count,
+                                          param.mMultiply ? compositor::ALPHA_MULTIPLY : compositor::ALPHA_ADD, false);
+                }
+                if (const U8* alpha = plane_at(layer_planes.mMaskTexture, begin))
+                {
+                    compositor::alphaSpan(dst, alpha, 0, count, compositor::ALPHA_MULTIPLY, false);
+                }
+                if (const U8* alpha = plane_at(layer_planes.mStaticMask, begin))
+                {
+                    compositor::alphaSpan(dst, alpha, 0, count, compositor::ALPHA_MULTIPLY, false);
+                }
+                if (!is_approx_equal(layer.mColor.mV[VALPHA], 1.f))
+                {
+                    compositor::alphaSpan(dst, NULL, color[3], count, compositor::ALPHA_MULTIPLY, false);
+                }
+                if (layer.mMorphLayer)
+                {
+                    U8* mask = layer.mMorphMask.data() + begin;
+                    for (S32 i = 0; i < count; i++)
+                    {
+                        mask[i] = dst[i * 4 + 3];
+                    }
+                }
+                blend = compositor::BLEND_DEST_ALPHA;
+            }
+            if (layer.mWriteAllChannels)
+            {
+                blend = compositor::BLEND_REPLACE;
+            }
+
+            if (const U8* tex = plane_at(layer_planes.mTexture, begin * 4))
+            {
+                compositor::drawSpan(dst, tex, color, count, blend, !layer.mWriteAllChannels);
+            }
+            if (const U8* tex = plane_at(layer_planes.mStaticImage, begin * 4))
+            {
+                compositor::drawSpan(dst, tex, color, count, blend, true);
+            }
+            if (layer.mDrawColor)
+            {
+                compositor::drawSpan(dst, NULL, color, count, blend, false);
+            }
+        }
+
+        // LLTexLayerSet::renderAlphaMaskTextures()
+        if (job.mStaticAlpha.notNull())
+        {
+            if (const U8* alpha = plane_at(planes.mStaticAlpha, begin))
+            {
+                compositor::alphaSpan(dst, alpha, 0, count, compositor::ALPHA_SET, true);
+            }
+        }
+        else if (job.mClearAlpha)
+        {
+            compositor::alphaSpan(dst, NULL, 255, count, compositor::ALPHA_SET, false);
+        }
+        for (const std::vector<U8>& mask : planes.mMaskLayers)
+        {
+            if (const U8* alpha = plane_at(mask, begin))
+            {
+                compositor::alphaSpan(dst, alpha, 0, count, compositor::ALPHA_MULTIPLY, false);
+            }
+        }
+    }
+}
+
+LLTexLayerCompositor::Layer::Layer() :
+    mColor(LLColor4::white),
+    mWriteAllChannels(false),
+    mHasAlphaMask(false),
+    mClearMask(false),
+    mDrawColor(false),
+    mMorphLayer(NULL),
+    mAlphaCacheIndex(0)
+{
+}
+
+LLTexLayerCompositor::Job::Job(S32 width, S32 height) :
+    mWidth(width),
+    mHeight(height),
+    mVisible(true),
+    mClearAlpha(false),
+    mDone(false)
+{
+}
+
+// static
+void LLTexLayerCompositor::composite(Job& job, const std::string& queue_name)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+
+    const S32 width = job.mWidth;
+    const S32 height = job.mHeight;
+    job.mResult = new LLImageRaw(width, height, 4);
+    if (job.mResult->isBufferInvalid())
+    {
+        job.mResult = NULL;
+        return;
+    }
+
+    // Scale and convert every image first, they are of any size
+    struct Conversion
+    {
+        LLImageRaw* mImage;
+        bool mAlphaOnly;
+        bool mIsAlpha;
+        std::vector<U8>* mPlane;
+    };
+    std::vector<Conversion> conversions;
+    Planes planes;
+    planes.mLayers.resize(job.mLayers.size());
+    planes.mMaskLayers.resize(job.mMaskLayers.size());
+    auto convert = [&](LLImageRaw* image, bool alpha_only, bool is_alpha, std::vector<U8>& plane)
+    {
+        if (image)
+        {
+            conversions.push_back({ image, alpha_only, is_alpha, &plane });
+        }
+    };
+    for (size_t l = 0; l < job.mLayers.size(); l++)
+    {
+        Layer& layer = job.mLayers[l];
+        Planes::Layer& layer_planes = planes.mLayers[l];
+        layer_planes.mAlphaParams.resize(layer.mAlphaParams.size());
+        for (size_t p = 0; p < layer.mAlphaParams.size(); p++)
+        {
+            convert(layer.mAlphaParams[p].mImage, true, true, layer_planes.mAlphaParams[p]);
+        }
+        convert(layer.mMaskTexture, true, false, layer_planes.mMaskTexture);
+        convert(layer.mStaticMask, true, false, layer_planes.mStaticMask);
+        convert(layer.mTexture, false, false, layer_planes.mTexture);
+        convert(layer.mStaticImage, false, false, layer_planes.mStaticImage);
+        if (layer.mMorphLayer)
+        {
+            layer.mMorphMask.resize(width * height);
+        }
+    }
+    convert(job.mStaticAlpha, true, false, planes.mStaticAlpha);
+    for (size_t m = 0; m < job.mMaskLayers.size(); m++)
+    {
+        convert(job.mMaskLayers[m], true, false, planes.mMaskLayers[m]);
+    }
+
+    LL::parallel_for(queue_name, conversions.size(), [&](size_t i)
+        {
+            const Conversion& conversion = conversions[i];
+            to_plane(conversion.mImage, width, height, conversion.mAlphaOnly, conversion.mIsAlpha, *conversion.mPlane);
+        });
+
+    const S32 bands = (height + BAND_ROWS - 1) / BAND_ROWS;
+    LL::parallel_for(queue_name, bands, [&](size_t band)
+        {
+            const S32 first_row = (S32)band * BAND_ROWS;
+            composite_rows(job, planes, first_row, llmin(first_row + BAND_ROWS, height));
+        });
+}
+
+// static
+bool LLTexLayerCompositor::post(const LLPointer<Job>& job, const std::string& queue_name)
+{
+    LL::WorkQueue::ptr_t queue = LL::WorkQueue::getInstance(queue_name);
+    if (!queue)
+    {
+        return false;
+    }
+    return queue->post([job, queue_name]()
+        {
+            try
+            {
+                composite(*job.get(), queue_name);
+            }
+            catch (...)
+            {
+                // the bake is retried when there is no result
+                LOG_UNHANDLED_EXCEPTION("CPU avatar bake");
+                job.get()->mResult = NULL;
+            }
+            job.get()->mDone.store(true, std::memory_order_release);
+        });
+}
+
+// static
+void LLTexLayerCompositor::drawSpan(U8* dst, const U8* tex, const U8 color[4], S32 count, EBlend blend, bool alpha_test)
+{
+    switch (blend)
+    {
+    case BLEND_ALPHA:
+        draw_span<BLEND_ALPHA>(dst, tex, color, count, alpha_test);
+        break;
+    case BLEND_DEST_ALPHA:
+        draw_span<BLEND_DEST_ALPHA>(dst, tex, color, count, alpha_test);
+        break;
+    default:
+        draw_span<BLEND_REPLACE>(dst, tex, color, count, alpha_test);
+        break;
+    }
+}
+
+// static
+void LLTexLayerCompositor::drawSpanScalar(U8* dst, const U8* tex, const U8 color[4], S32 count, EBlend blend, bool alpha_test)
+{
+    switch (blend)
+    {
+    case BLEND_ALPHA:
+        draw_span_scalar<BLEND_ALPHA>(dst, tex, color, count, alpha_test);
+        break;
+    case BLEND_DEST_ALPHA:
+        draw_span_scalar<BLEND_DEST_ALPHA>(dst, tex, color, count, alpha_test);
+        break;
+    default:
+        draw_span_scalar<BLEND_REPLACE>(dst, tex, color, count, alpha_test);
+        break;
+    }
+}
+
+// static
+void LLTexLayerCompositor::alphaSpan(U8* dst, const U8* alpha, U8 value, S32 count, EAlphaOp op, bool alpha_test)
+{
+    switch (op)
+    {
+    case ALPHA_SET:
+        alpha_span<ALPHA_SET>(dst, alpha, value, count, alpha_test);
+        break;
+    case ALPHA_ADD:
+        alpha_span<ALPHA_ADD>(dst, alpha, value, count, alpha_test);
+        break;
+    default:
+        alpha_span<ALPHA_MULTIPLY>(dst, alpha, value, count, alpha_test);
+        break;
+    }
+}
+
+// static
+void LLTexLayerCompositor::alphaSpanScalar(U8* dst, const U8* alpha, U8 value, S32 count, EAlphaOp op, bool alpha_test)
+{
+    switch (op)
+    {
+    case ALPHA_SET:
+        alpha_span_scalar<ALPHA_SET>(dst, alpha, value, count, alpha_test);
+        break;
+    case ALPHA_ADD:
+        alpha_span_scalar<ALPHA_ADD>(dst, alpha, value, count, alpha_test);
+        break;
+    default:
+        alpha_span_scalar<ALPHA_MULTIPLY>(dst, alpha, value, count, alpha_test);
+        break;
+    }
+}
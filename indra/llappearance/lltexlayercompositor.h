@@ -0,0 +1,150 @@
+/**
+ * @file lltexlayercompositor.h
+ * @brief CPU compositor for avatar texture layer sets.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTEXLAYERCOMPOSITOR_H
+#define LL_LLTEXLAYERCOMPOSITOR_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "llimage.h"
+#include "llpointer.h"
+#include "llrefcount.h"
+#include "v4color.h"
+
+class LLTexLayer;
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// LLTexLayerCompositor
+//
+// Composites a texture layer set on the CPU, with the same blending that
+// LLTexLayerSet::render() sets up on the GL thread, in 8 bit fixed point.
+// The main thread captures everything a bake depends on into a Job with
+// LLTexLayerSet::createCompositorJob(), after which compositing only reads
+// the job and can run on any thread.  The rows of the bake are independent,
+// so a job is split into bands that the threads of a work queue share.
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+class LLTexLayerCompositor
+{
+public:
+    // One alpha gradient of a layer's alpha mask, see LLTexLayerParamAlpha::render()
+    struct AlphaParam
+    {
+        LLPointer<LLImageRaw>   mImage;     // processed single channel gradient, NULL for a constant alpha
+        F32                     mWeight;    // the constant alpha
+        bool                    mMultiply;  // multiplied into the mask instead of added
+    };
+
+    // One color layer, see LLTexLayer::render().  Other single channel
+    // images are luminance like GL textures, static masks come converted by
+    // LLTexLayerStaticImageList::getImageRaw().
+    struct Layer
+    {
+        Layer();
+
+        LLColor4                mColor;
+        bool                    mWriteAllChannels;
+        // Alpha mask built in the destination alpha before drawing, starting
+        // from transparent if mClearMask, from the alpha so far otherwise
+        bool                    mHasAlphaMask;
+        bool                    mClearMask;
+        std::vector<AlphaParam> mAlphaParams;
+        LLPointer<LLImageRaw>   mMaskTexture;       // alpha multiplied into the mask
+        LLPointer<LLImageRaw>   mStaticMask;        // alpha multiplied into the mask
+        // What gets drawn tinted by mColor, in this order
+        LLPointer<LLImageRaw>   mTexture;
+        LLPointer<LLImageRaw>   mStaticImage;
+        bool                    mDrawColor;         // a plain rectangle of mColor
+
+        // Layer whose morph masks come from its alpha mask.  Only an identity
+        // for the main thread to find it again, never dereferenced by the job.
+        const LLTexLayer*       mMorphLayer;
+        U32                     mAlphaCacheIndex;
+        std::vector<U8>         mMorphMask;         // output: the alpha mask
+    };
+
+    class Job : public LLThreadSafeRefCount
+    {
+    public:
+        Job(S32 width, S32 height);
+
+        bool                    isDone() const { return mDone.load(std::memory_order_acquire); }
+
+        S32                     mWidth;
+        S32                     mHeight;
+        bool                    mVisible;
+        std::vector<Layer>      mLayers;
+        // Final alpha: replaced by mStaticAlpha or made opaque if mClearAlpha,
+        // then multiplied by every mask layer
+        LLPointer<LLImageRaw>   mStaticAlpha;
+        bool                    mClearAlpha;
+        std::vector<LLPointer<LLImageRaw> > mMaskLayers;
+
+        LLPointer<LLImageRaw>   mResult;            // output: RGBA bake
+        std::atomic<bool>       mDone;
+
+    protected:
+        ~Job() = default;
+    };
+
+    // Composites the job into job.mResult, split over the named work queue
+    // with the calling thread helping, or only on the calling thread if the
+    // queue isn't running
+    static void composite(Job& job, const std::string& queue_name = std::string());
+
+    // Composites the job on the named work queue and sets mDone when
+    // finished, returns false if the queue isn't running
+    static bool post(const LLPointer<Job>& job, const std::string& queue_name);
+
+    // Fixed point blending of one span of RGBA pixels, exposed for the
+    // tests.  tex is RGBA or NULL for the color alone, which tints tex.
+    // alpha_test skips the pixels gAlphaMaskProgram would discard at its
+    // minimum alpha of 0.004.
+    enum EBlend
+    {
+        BLEND_ALPHA,        // BT_ALPHA
+        BLEND_DEST_ALPHA,   // BF_DEST_ALPHA, BF_ONE_MINUS_DEST_ALPHA
+        BLEND_REPLACE       // BT_REPLACE
+    };
+    static void drawSpan(U8* dst, const U8* tex, const U8 color[4], S32 count, EBlend blend, bool alpha_test);
+
+    // Operations on the alpha channel alone.  alpha is one byte per pixel,
+    // or NULL for value everywhere.
+    enum EAlphaOp
+    {
+        ALPHA_SET,
+        ALPHA_ADD,
+        ALPHA_MULTIPLY
+    };
+    static void alphaSpan(U8* dst, const U8* alpha, U8 value, S32 count, EAlphaOp op, bool alpha_test);
+
+    // Reference versions without SIMD
+    static void drawSpanScalar(U8* dst, const U8* tex, const U8 color[4], S32 count, EBlend blend, bool alpha_test);
+    static void alphaSpanScalar(U8* dst, const U8* alpha, U8 value, S32 count, EAlphaOp op, bool alpha_test);
+};
+
+#endif // LL_LLTEXLAYERCOMPOSITOR_H
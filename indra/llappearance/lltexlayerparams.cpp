@@ -289,19 +289,9 @@ bool LLTexLayerParamAlpha::render(S32 x, S32 y, S32 width, S32 height)
 
     if (!info->mStaticImageFileName.empty() && !mStaticImageInvalid)
     {
-        if (mStaticImageTGA.isNull())
+        if (!loadStaticImageTGA())
         {
-            // Don't load the image file until we actually need it the first time.  Like now.
-            mStaticImageTGA = LLTexLayerStaticImageList::getInstance()->getImageTGA(info->mStaticImageFileName);
-            // We now have something in one of our caches
-            LLTexLayerSet::sHasCaches |= mStaticImageTGA.notNull();
-
-            if (mStaticImageTGA.isNull())
-            {
-                LL_WARNS() << "Unable to load static file: " << info->mStaticImageFileName << LL_ENDL;
-                mStaticImageInvalid = true; // don't try again.
-                return false;
-            }
+            return false;
         }
 
         const S32 image_tga_width = mStaticImageTGA->getWidth();
@@ -311,8 +301,6 @@ bool LLTexLayerParamAlpha::render(S32 x, S32 y, S32 width, S32 height)
             (mCachedProcessedTexture->getHeight() != image_tga_height) ||
             (weight_changed))
         {
-            mCachedEffectiveWeight = effective_weight;
-
             if (!mCachedProcessedTexture)
             {
                 llassert(gTextureManagerBridgep);
@@ -324,12 +312,7 @@ bool LLTexLayerParamAlpha::render(S32 x, S32 y, S32 width, S32 height)
                 mCachedProcessedTexture->setExplicitFormat(GL_ALPHA8, GL_ALPHA);
             }
 
-            // Applies domain and effective weight to data as it is decoded. Also resizes the raw image if needed.
-            mStaticImageRaw = NULL;
-            mStaticImageRaw = new LLImageRaw;
-            mStaticImageTGA->decodeAndProcess(mStaticImageRaw, info->mDomain, effective_weight);
-            mNeedsCreateTexture = true;
-            LL_DEBUGS() << "Built Cached Alpha: " << info->mStaticImageFileName << ": (" << mStaticImageRaw->getWidth() << ", " << mStaticImageRaw->getHeight() << ") " << "Domain: " << info->mDomain << " Weight: " << effective_weight << LL_ENDL;
+            processStaticImage(effective_weight);
         }
 
         if (mCachedProcessedTexture)
@@ -368,6 +351,71 @@ bool LLTexLayerParamAlpha::render(S32 x, S32 y, S32 width, S32 height)
     return success;
 }
 
+bool LLTexLayerParamAlpha::getCompositorParam(LLTexLayerCompositor::AlphaParam& param)
+{
+    if (!mTexLayer || getSkip())
+    {
+        return false;
+    }
+
+    const LLTexLayerParamAlphaInfo *info = (LLTexLayerParamAlphaInfo *)getInfo();
+    F32 effective_weight = (mTexLayer->getTexLayerSet()->getAvatarAppearance()->getSex() & getSex()) ? mCurWeight : getDefaultWeight();
+    param.mImage = NULL;
+    param.mWeight = effective_weight;
+    param.mMultiply = info->mMultiplyBlend;
+
+    if (!info->mStaticImageFileName.empty() && !mStaticImageInvalid)
+    {
+        if (!loadStaticImageTGA())
+        {
+            return false;
+        }
+        // The texture, if there is one, gets the new image on its next render()
+        if (mStaticImageRaw.isNull() || effective_weight != mCachedEffectiveWeight)
+        {
+            processStaticImage(effective_weight);
+        }
+        // The job keeps its own reference, processing replaces the image
+        param.mImage = mStaticImageRaw;
+    }
+
+    return true;
+}
+
+bool LLTexLayerParamAlpha::loadStaticImageTGA()
+{
+    if (mStaticImageTGA.isNull())
+    {
+        const LLTexLayerParamAlphaInfo *info = (LLTexLayerParamAlphaInfo *)getInfo();
+
+        // Don't load the image file until we actually need it the first time.  Like now.
+        mStaticImageTGA = LLTexLayerStaticImageList::getInstance()->getImageTGA(info->mStaticImageFileName);
+        // We now have something in one of our caches
+        LLTexLayerSet::sHasCaches |= mStaticImageTGA.notNull();
+
+        if (mStaticImageTGA.isNull())
+        {
+            LL_WARNS() << "Unable to load static file: " << info->mStaticImageFileName << LL_ENDL;
+            mStaticImageInvalid = true; // don't try again.
+            return false;
+        }
+    }
+    return true;
+}
+
+void LLTexLayerParamAlpha::processStaticImage(F32 effective_weight)
+{
+    const LLTexLayerParamAlphaInfo *info = (LLTexLayerParamAlphaInfo *)getInfo();
+    mCachedEffectiveWeight = effective_weight;
+
+    // Applies domain and effective weight to data as it is decoded. Also resizes the raw image if needed.
+    mStaticImageRaw = NULL;
+    mStaticImageRaw = new LLImageRaw;
+    mStaticImageTGA->decodeAndProcess(mStaticImageRaw, info->mDomain, effective_weight);
+    mNeedsCreateTexture = true;
+    LL_DEBUGS() << "Built Cached Alpha: " << info->mStaticImageFileName << ": (" << mStaticImageRaw->getWidth() << ", " << mStaticImageRaw->getHeight() << ") " << "Domain: " << info->mDomain << " Weight: " << effective_weight << LL_ENDL;
+}
+
 //-----------------------------------------------------------------------------
 // LLTexLayerParamAlphaInfo
 //-----------------------------------------------------------------------------
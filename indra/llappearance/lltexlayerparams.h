@@ -30,6 +30,7 @@
 #include "llpointer.h"
 #include "v4color.h"
 #include "llviewervisualparam.h"
+#include "lltexlayercompositor.h"
 
 class LLAvatarAppearance;
 class LLImageRaw;
@@ -90,6 +91,9 @@ public:
 
     // New functions
     bool                    render( S32 x, S32 y, S32 width, S32 height );
+    // What render() would draw, for the CPU compositor.  Returns false if
+    // the param draws nothing.
+    bool                    getCompositorParam(LLTexLayerCompositor::AlphaParam& param);
     bool                    getSkip() const;
     void                    deleteCaches();
     bool                    getMultiplyBlend() const;
@@ -97,6 +101,9 @@ public:
 private:
     LLTexLayerParamAlpha(const LLTexLayerParamAlpha& pOther);
 
+    bool                    loadStaticImageTGA();
+    void                    processStaticImage(F32 effective_weight);
+
     LLPointer<LLGLTexture>  mCachedProcessedTexture;
     LLPointer<LLImageTGA>   mStaticImageTGA;
     LLPointer<LLImageRaw>   mStaticImageRaw;
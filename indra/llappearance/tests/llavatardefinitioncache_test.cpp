@@ -0,0 +1,284 @@
+/**
+ * @file llavatardefinitioncache_test.cpp
+ * @brief Test cases for the binary cache of the avatar definition files
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include <vector>
+
+#include "../llavatardefinitioncache.h"
+#include "lldir.h"
+#include "llxmltree.h"
+
+#include "../test/lltut.h"
+#include "../test/benchmark.h"
+
+namespace
+{
+    std::string binary_of(LLXmlTree& tree)
+    {
+        std::string buffer;
+        tree.writeBinary(buffer);
+        return buffer;
+    }
+
+    void write_file(const std::string& path, const std::string& contents)
+    {
+        LLFILE* fp = LLFile::fopen(path, "wb");
+        tut::ensure("file opened", fp != NULL);
+        fwrite(contents.data(), 1, contents.size(), fp);
+        LLFile::close(fp);
+    }
+}
+
+namespace tut
+{
+    struct avatardefinitioncache
+    {
+        avatardefinitioncache()
+        {
+            // the character files of the viewer next to this library
+            std::string newview_path = __FILE__;
+            newview_path = newview_path.substr(0, newview_path.find_last_of("/\\"));
+            newview_path += "/../../newview";
+            gDirUtilp->initAppDirs("SecondLife", newview_path);
+
+            mLadPath = gDirUtilp->getExpandedFilename(LL_PATH_CHARACTER, "avatar_lad.xml");
+            mSkeletonPath = gDirUtilp->getExpandedFilename(LL_PATH_CHARACTER, "avatar_skeleton.xml");
+            mCachePath = gDirUtilp->getTempFilename();
+        }
+
+        ~avatardefinitioncache()
+        {
+            LLFile::remove(mCachePath, ENOENT);
+            for (const std::string& path : mTempFiles)
+            {
+                LLFile::remove(path, ENOENT);
+            }
+        }
+
+        std::string mLadPath;
+        std::string mSkeletonPath;
+        std::string mCachePath;
+        std::vector<std::string> mTempFiles;
+    };
+    typedef test_group<avatardefinitioncache> avatardefinitioncache_t;
+    typedef avatardefinitioncache_t::object avatardefinitioncache_object_t;
+    tut::avatardefinitioncache_t tut_avatardefinitioncache("LLAvatarDefinitionCache");
+
+    // a tree read back from the cache is the one the parser builds
+    template<> template<>
+    void avatardefinitioncache_object_t::test<1>()
+    {
+        LLXmlTree parsed;
+        ensure("avatar_lad.xml", parsed.parseFile(mLadPath, false));
+
+        {
+            LLAvatarDefinitionCache cache(mCachePath);
+            LLXmlTree tree;
+            ensure("loaded", cache.loadTree(mLadPath, tree));
+            ensure_equals("parsed", cache.getNumMisses(), 1);
+            ensure("same as parsed", binary_of(tree) == binary_of(parsed));
+            ensure("saved", cache.save());
+        }
+
+        LLAvatarDefinitionCache cache(mCachePath);
+        LLXmlTree tree;
+        ensure("loaded", cache.loadTree(mLadPath, tree));
+        ensure_equals("from cache", cache.getNumHits(), 1);
+        ensure_equals("not parsed", cache.getNumMisses(), 0);
+        ensure("same as parsed", binary_of(tree) == binary_of(parsed));
+
+        LLXmlTreeNode* root = tree.getRoot();
+        ensure("root", root && root->hasName("linden_avatar"));
+        std::string version;
+        ensure("attribute", root->getAttributeString("version", version));
+        ensure_equals("version", version, "2.0");
+        LLXmlTreeNode* skeleton = root->getChildByName("skeleton");
+        ensure("named child", skeleton != NULL);
+        std::string file_name;
+        ensure("fast attribute", skeleton->getFastAttributeString(LLXmlTree::addAttributeString("file_name"), file_name));
+        ensure_equals("file name", file_name, "avatar_skeleton.xml");
+        S32 meshes = 0;
+        for (LLXmlTreeNode* child = root->getChildByName("mesh"); child; child = root->getNextNamedChild())
+        {
+            ensure("parent", child->getParent() == root);
+            meshes++;
+        }
+        ensure("meshes", meshes > 10);
+    }
+
+    // both files share the cache file, saving without changes keeps it
+    template<> template<>
+    void avatardefinitioncache_object_t::test<2>()
+    {
+        {
+            LLAvatarDefinitionCache cache(mCachePath);
+            LLXmlTree lad, skeleton;
+            ensure("lad", cache.loadTree(mLadPath, lad));
+            ensure("skeleton", cache.loadTree(mSkeletonPath, skeleton));
+            ensure_equals("parsed", cache.getNumMisses(), 2);
+            ensure("saved", cache.save());
+        }
+        for (S32 i = 0; i < 2; i++)
+        {
+            LLAvatarDefinitionCache cache(mCachePath);
+            LLXmlTree lad, skeleton;
+            ensure("lad", cache.loadTree(mLadPath, lad));
+            ensure("skeleton", cache.loadTree(mSkeletonPath, skeleton));
+            ensure_equals("from cache", cache.getNumHits(), 2);
+            ensure("skeleton root", skeleton.getRoot()->hasName("linden_skeleton"));
+            ensure("nothing to save", cache.save());
+        }
+    }
+
+    // an edited file is parsed again and replaces its entry
+    template<> template<>
+    void avatardefinitioncache_object_t::test<3>()
+    {
+        std::string contents = LLFile::getContents(mSkeletonPath);
+        ensure("skeleton", !contents.empty());
+        const std::string source_path = gDirUtilp->getTempFilename();
+        mTempFiles.push_back(source_path);
+        write_file(source_path, contents);
+        {
+            LLAvatarDefinitionCache cache(mCachePath);
+            LLXmlTree tree;
+            ensure("loaded", cache.loadTree(source_path, tree));
+            ensure("saved", cache.save());
+        }
+
+        // same size, different bone
+        const std::string::size_type pos = contents.find("name=\"mPelvis\"");
+        ensure("pelvis", pos != std::string::npos);
+        contents.replace(pos, 14, "name=\"mPelviz\"");
+        write_file(source_path, contents);
+        {
+            LLAvatarDefinitionCache cache(mCachePath);
+            LLXmlTree tree;
+            ensure("loaded", cache.loadTree(source_path, tree));
+            ensure_equals("stale", cache.getNumMisses(), 1);
+            LLXmlTreeNode* bone = tree.getRoot()->getChildByName("bone");
+            std::string name;
+            ensure("bone", bone && bone->getAttributeString("name", name));
+            ensure_equals("edited", name, "mPelviz");
+            ensure("saved", cache.save());
+        }
+
+        LLAvatarDefinitionCache cache(mCachePath);
+        LLXmlTree tree;
+        ensure("loaded", cache.loadTree(source_path, tree));
+        ensure_equals("from cache", cache.getNumHits(), 1);
+        std::string name;
+        tree.getRoot()->getChildByName("bone")->getAttributeString("name", name);
+        ensure_equals("edited", name, "mPelviz");
+    }
+
+    // damaged data is rejected, the files are parsed instead
+    template<> template<>
+    void avatardefinitioncache_object_t::test<4>()
+    {
+        LLXmlTree parsed;
+        ensure("skeleton", parsed.parseFile(mSkeletonPath, false));
+        const std::string binary = binary_of(parsed);
+
+        LLXmlTree tree;
+        ensure("whole", tree.parseBinary((const U8*)binary.data(), binary.size()));
+        for (size_t size = 0; size < binary.size(); size += 1 + size / 8)
+        {
+            ensure("truncated", !tree.parseBinary((const U8*)binary.data(), size));
+            ensure("no root", tree.getRoot() == NULL);
+        }
+        std::string longer = binary + '\0';
+        ensure("trailing data", !tree.parseBinary((const U8*)longer.data(), longer.size()));
+
+        {
+            LLAvatarDefinitionCache cache(mCachePath);
+            ensure("loaded", cache.loadTree(mSkeletonPath, tree));
+            ensure("saved", cache.save());
+        }
+        const std::string cache_contents = LLFile::getContents(mCachePath);
+        const std::string damaged[] =
+        {
+            cache_contents.substr(0, cache_contents.size() / 2),
+            cache_contents.substr(0, 10),
+            std::string(cache_contents.size(), 'x'),
+            std::string()
+        };
+        for (const std::string& contents : damaged)
+        {
+            write_file(mCachePath, contents);
+            LLAvatarDefinitionCache cache(mCachePath);
+            ensure("loaded", cache.loadTree(mSkeletonPath, tree));
+            ensure_equals("parsed", cache.getNumMisses(), 1);
+            ensure("same as parsed", binary_of(tree) == binary_of(parsed));
+        }
+    }
+
+    // reading the avatar definition files at startup, again and again,
+    // through the cache
+    template<> template<>
+    void avatardefinitioncache_object_t::test<5>()
+    {
+        {
+            LLAvatarDefinitionCache cache(mCachePath);
+            LLXmlTree lad, skeleton;
+            cache.loadTree(mLadPath, lad);
+            cache.loadTree(mSkeletonPath, skeleton);
+            ensure("saved", cache.save());
+        }
+
+        const S32 iterations = Benchmark::size(10, 2);
+        LLXmlTree parsed_lad, parsed_skeleton;
+        parsed_lad.parseFile(mLadPath, false);
+        parsed_skeleton.parseFile(mSkeletonPath, false);
+
+        Benchmark bench("Avatar definition files, ms");
+        for (S32 i = 0; i < iterations; i++)
+        {
+            LLXmlTree lad, skeleton;
+            ensure("lad", lad.parseFile(mLadPath, false));
+            ensure("skeleton", skeleton.parseFile(mSkeletonPath, false));
+        }
+        const F64 parse_ms = bench.elapsed_ms() / iterations;
+
+        bench.start();
+        for (S32 i = 0; i < iterations; i++)
+        {
+            LLAvatarDefinitionCache cache(mCachePath);
+            LLXmlTree lad, skeleton;
+            ensure("lad", cache.loadTree(mLadPath, lad));
+            ensure("skeleton", cache.loadTree(mSkeletonPath, skeleton));
+            ensure_equals("from cache", cache.getNumHits(), 2);
+            ensure("same lad", binary_of(lad) == binary_of(parsed_lad));
+            ensure("same skeleton", binary_of(skeleton) == binary_of(parsed_skeleton));
+        }
+        const F64 cache_ms = bench.elapsed_ms() / iterations;
+
+        bench.report("XML parse ", parse_ms);
+        bench.report("cache     ", cache_ms, " (", parse_ms / cache_ms, "x), cache file ",
+                     LLFile::getContents(mCachePath).size() / 1024, " KB");
+    }
+}
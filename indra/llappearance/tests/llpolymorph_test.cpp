@@ -0,0 +1,338 @@
+/**
+ * @file llpolymorph_test.cpp
+ * @brief Test cases for batched morph target application
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "../llpolymesh.h"
+#include "../llpolymorph.h"
+#include "../llwearabletype.h"
+#include "lldir.h"
+#include "llinvtranslationbrdg.h"
+#include "llxmltree.h"
+#include "stringize.h"
+#include "threadpool.h"
+
+#include "../test/lltut.h"
+#include "../test/benchmark.h"
+
+namespace
+{
+    class TestTranslationBridge : public LLTranslationBridge
+    {
+    public:
+        std::string getString(const std::string& xml_desc) override { return xml_desc; }
+    };
+
+    // The volume morphs are left out, the meshes have no avatar whose
+    // collision volumes they could move
+    class TestMorphInfo : public LLPolyMorphTargetInfo
+    {
+    public:
+        bool parseXml(LLXmlTreeNode* node) override
+        {
+            bool success = LLPolyMorphTargetInfo::parseXml(node);
+            mVolumeInfoList.clear();
+            return success;
+        }
+    };
+
+    // The <param_morph> parameters of one base mesh from avatar_lad.xml
+    struct MeshParams
+    {
+        std::string mFileName;
+        std::vector<std::unique_ptr<TestMorphInfo>> mInfos;
+    };
+
+    // The base meshes of one avatar with every morph target on them
+    class TestAvatar
+    {
+    public:
+        TestAvatar(const std::vector<MeshParams>& params)
+        {
+            for (const MeshParams& mesh_params : params)
+            {
+                LLPolyMesh* mesh = LLPolyMesh::getMesh(mesh_params.mFileName);
+                if (!mesh)
+                {
+                    continue;
+                }
+                mMeshes.emplace_back(mesh);
+                for (const auto& info : mesh_params.mInfos)
+                {
+                    LLPolyMorphTarget* morph = new LLPolyMorphTarget(mesh);
+                    if (morph->setInfo(info.get()))
+                    {
+                        mMorphs.emplace_back(morph);
+                    }
+                    else
+                    {
+                        delete morph;
+                    }
+                }
+            }
+        }
+
+        // Another shape, like a different appearance coming in
+        void setShape(S32 shape)
+        {
+            for (size_t i = 0; i < mMorphs.size(); i++)
+            {
+                LLPolyMorphTarget* morph = mMorphs[i].get();
+                const F32 t = 0.5f + 0.5f*sinf(1.7f*i + 2.3f*shape);
+                morph->setWeight(lerp(morph->getMinWeight(), morph->getMaxWeight(), t));
+            }
+        }
+
+        void apply()
+        {
+            for (auto& morph : mMorphs)
+            {
+                morph->apply(SEX_FEMALE);
+            }
+        }
+
+        // Like LLAvatarAppearance::beginMorphBatch()/endMorphBatch()
+        void applyBatched(const std::string& queue_name)
+        {
+            std::vector<LLPolyMesh*> meshes;
+            for (auto& mesh : mMeshes)
+            {
+                mesh->beginMorphBatch();
+                meshes.push_back(mesh.get());
+            }
+            apply();
+            LLPolyMesh::endMorphBatches(meshes, queue_name);
+        }
+
+        S32 getNumVertices() const
+        {
+            S32 vertices = 0;
+            for (const auto& mesh : mMeshes)
+            {
+                vertices += mesh->getNumVertices();
+            }
+            return vertices;
+        }
+
+        std::vector<std::unique_ptr<LLPolyMesh>> mMeshes;
+        std::vector<std::unique_ptr<LLPolyMorphTarget>> mMorphs;
+    };
+
+    F32 max_difference(const LLVector4a* a, const LLVector4a* b, S32 count)
+    {
+        F32 diff = 0.f;
+        for (S32 i = 0; i < count; i++)
+        {
+            LLVector4a delta;
+            delta.setSub(a[i], b[i]);
+            diff = llmax(diff, delta.getLength3().getF32());
+        }
+        return diff;
+    }
+
+    F32 max_difference(const TestAvatar& a, const TestAvatar& b)
+    {
+        F32 diff = 0.f;
+        for (size_t i = 0; i < a.mMeshes.size(); i++)
+        {
+            LLPolyMesh* ma = a.mMeshes[i].get();
+            LLPolyMesh* mb = b.mMeshes[i].get();
+            const S32 count = ma->getNumVertices();
+            diff = llmax(diff, max_difference(ma->getCoords(), mb->getCoords(), count));
+            diff = llmax(diff, max_difference(ma->getNormals(), mb->getNormals(), count));
+            diff = llmax(diff, max_difference(ma->getBinormals(), mb->getBinormals(), count));
+            for (S32 v = 0; v < count; v++)
+            {
+                diff = llmax(diff, (ma->getTexCoords()[v] - mb->getTexCoords()[v]).length());
+            }
+        }
+        return diff;
+    }
+}
+
+namespace tut
+{
+    struct polymorph
+    {
+        polymorph()
+        {
+            // the character files of the viewer next to this library
+            std::string newview_path = __FILE__;
+            newview_path = newview_path.substr(0, newview_path.find_last_of("/\\"));
+            newview_path += "/../../newview";
+            gDirUtilp->initAppDirs("SecondLife", newview_path);
+            if (!LLWearableType::instanceExists())
+            {
+                LLTranslationBridge::ptr_t trans = std::make_shared<TestTranslationBridge>();
+                LLWearableType::initParamSingleton(trans);
+            }
+
+            LLXmlTree tree;
+            ensure("avatar_lad.xml", tree.parseFile(gDirUtilp->getExpandedFilename(LL_PATH_CHARACTER, "avatar_lad.xml"), false));
+            LLXmlTreeNode* root = tree.getRoot();
+
+            std::set<std::string> loaded;
+            for (LLXmlTreeNode* node = root->getChildByName("mesh"); node; node = root->getNextNamedChild())
+            {
+                S32 lod = 0;
+                MeshParams mesh_params;
+                node->getAttributeS32("lod", lod);
+                node->getAttributeString("file_name", mesh_params.mFileName);
+                if (lod != 0 || !loaded.insert(mesh_params.mFileName).second)
+                {
+                    continue;
+                }
+                for (LLXmlTreeNode* child = node->getChildByName("param"); child; child = node->getNextNamedChild())
+                {
+                    std::unique_ptr<TestMorphInfo> info(new TestMorphInfo());
+                    if (info->parseXml(child))
+                    {
+                        mesh_params.mInfos.push_back(std::move(info));
+                    }
+                }
+                mParams.push_back(std::move(mesh_params));
+            }
+        }
+
+        ~polymorph()
+        {
+            LLPolyMesh::freeAllMeshes();
+        }
+
+        std::vector<MeshParams> mParams;
+    };
+    typedef test_group<polymorph> polymorph_t;
+    typedef polymorph_t::object polymorph_object_t;
+    tut::polymorph_t tut_polymorph("LLPolyMorph");
+
+    // a batch ends with the same meshes as applying the morphs one by one
+    template<> template<>
+    void polymorph_object_t::test<1>()
+    {
+        TestAvatar serial(mParams);
+        TestAvatar batched(mParams);
+        ensure("meshes", !serial.mMeshes.empty());
+        ensure("morphs", serial.mMorphs.size() > 100);
+
+        LL::ThreadPool pool("PolyMorphTest", 3);
+        pool.start();
+
+        for (S32 shape = 0; shape < 4; shape++)
+        {
+            serial.setShape(shape);
+            batched.setShape(shape);
+            serial.apply();
+            batched.applyBatched(shape % 2 ? "PolyMorphTest" : "");
+            ensure("same shape", max_difference(serial, batched) < 1e-6f);
+        }
+
+        // without an open batch the morphs update the normals themselves
+        serial.setShape(5);
+        batched.setShape(5);
+        serial.apply();
+        batched.apply();
+        ensure("unbatched", max_difference(serial, batched) < 1e-6f);
+
+        pool.close();
+    }
+
+    // the whole morph parameter set changing on a crowd of avatars gives the
+    // same shapes one morph after the other, batched, and batched with the
+    // normals computed over a pool
+    template<> template<>
+    void polymorph_object_t::test<2>()
+    {
+        const S32 count = Benchmark::size(16, 3);
+        const S32 shapes = Benchmark::size(10, 2);
+        const S32 threads = llmax(2, (S32)std::thread::hardware_concurrency());
+
+        std::vector<std::unique_ptr<TestAvatar>> serial, batched, parallel;
+        for (S32 i = 0; i < count; i++)
+        {
+            serial.emplace_back(new TestAvatar(mParams));
+            batched.emplace_back(new TestAvatar(mParams));
+            parallel.emplace_back(new TestAvatar(mParams));
+        }
+
+        LL::ThreadPool pool("PolyMorphBenchmark", threads - 1);
+        pool.start();
+
+        Benchmark bench(stringize("Morphs, ", count, " avatars x ", serial[0]->mMorphs.size(), " morphs on ",
+                                  serial[0]->getNumVertices(), " vertices, ms per shape"));
+        F64 serial_ms = 0.0;
+        F64 batched_ms = 0.0;
+        F64 parallel_ms = 0.0;
+        for (S32 shape = 0; shape < shapes; shape++)
+        {
+            for (S32 i = 0; i < count; i++)
+            {
+                serial[i]->setShape(shape + i);
+                batched[i]->setShape(shape + i);
+                parallel[i]->setShape(shape + i);
+            }
+
+            bench.start();
+            for (auto& avatar : serial)
+            {
+                avatar->apply();
+            }
+            serial_ms += bench.elapsed_ms();
+
+            bench.start();
+            for (auto& avatar : batched)
+            {
+                avatar->applyBatched("");
+            }
+            batched_ms += bench.elapsed_ms();
+
+            bench.start();
+            for (auto& avatar : parallel)
+            {
+                avatar->applyBatched("PolyMorphBenchmark");
+            }
+            parallel_ms += bench.elapsed_ms();
+        }
+
+        pool.close();
+
+        F32 diff = 0.f;
+        for (S32 i = 0; i < count; i++)
+        {
+            diff = llmax(diff, max_difference(*serial[i], *batched[i]));
+            diff = llmax(diff, max_difference(*serial[i], *parallel[i]));
+        }
+        ensure("same shapes", diff < 1e-6f);
+
+        bench.report("one by one  ", serial_ms/shapes);
+        bench.report("batched     ", batched_ms/shapes);
+        bench.report(threads, " threads   ", parallel_ms/shapes);
+    }
+}
@@ -0,0 +1,352 @@
+/**
+ * @file lltexlayercompositor_test.cpp
+ * @brief Test cases for the CPU texture layer compositor
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../lltexlayercompositor.h"
+#include "stringize.h"
+#include "threadpool.h"
+
+#include "../test/lltut.h"
+#include "../test/benchmark.h"
+
+namespace
+{
+    typedef LLTexLayerCompositor compositor;
+
+    LLPointer<LLImageRaw> make_image(S32 width, S32 height, S8 components, const U8* pixel)
+    {
+        LLPointer<LLImageRaw> image = new LLImageRaw(width, height, components);
+        U8* data = image->getData();
+        for (S32 i = 0; i < width * height; i++)
+        {
+            memcpy(data + i * components, pixel, components);
+        }
+        return image;
+    }
+
+    LLPointer<LLImageRaw> make_random_image(S32 width, S32 height, S8 components, std::mt19937& rng)
+    {
+        LLPointer<LLImageRaw> image = new LLImageRaw(width, height, components);
+        U8* data = image->getData();
+        for (S32 i = 0; i < width * height * components; i++)
+        {
+            data[i] = (U8)(rng() & 0xff);
+        }
+        return image;
+    }
+
+    const U8* pixel_at(const LLImageRaw* image, S32 x, S32 y)
+    {
+        return image->getData() + (y * image->getWidth() + x) * image->getComponents();
+    }
+
+    // What the GL blend equations give in floating point, for the golden
+    // pixels
+    struct GLPixel
+    {
+        F32 mV[4];
+
+        GLPixel(F32 r, F32 g, F32 b, F32 a) : mV{ r, g, b, a } {}
+
+        void blendDestAlpha(const F32 src[4])
+        {
+            const F32 dst_alpha = mV[3];
+            for (S32 c = 0; c < 4; c++)
+            {
+                mV[c] = src[c] * dst_alpha + mV[c] * (1.f - dst_alpha);
+            }
+        }
+
+        void blendAlpha(const F32 src[4])
+        {
+            for (S32 c = 0; c < 4; c++)
+            {
+                mV[c] = src[c] * src[3] + mV[c] * (1.f - src[3]);
+            }
+        }
+
+        bool matches(const U8* pixel) const
+        {
+            for (S32 c = 0; c < 4; c++)
+            {
+                if (abs((S32)pixel[c] - ll_round(llclamp(mV[c], 0.f, 1.f) * 255.f)) > 1)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    // A bake with every kind of layer, of random images of another size than
+    // the bake so that they get scaled
+    LLPointer<compositor::Job> make_random_job(S32 width, S32 height, S32 layers, std::mt19937& rng)
+    {
+        LLPointer<compositor::Job> job = new compositor::Job(width, height);
+        const S32 image_size = width / 2;
+        for (S32 i = 0; i < layers; i++)
+        {
+            compositor::Layer layer;
+            layer.mColor = LLColor4(0.9f, 0.8f, 0.7f, i % 3 ? 1.f : 0.6f);
+            layer.mTexture = make_random_image(image_size, image_size, i % 2 ? 3 : 4, rng);
+            if (i % 2)
+            {
+                layer.mHasAlphaMask = true;
+                layer.mClearMask = true;
+                layer.mAlphaParams.push_back({ make_random_image(image_size, image_size, 1, rng), 0.f, false });
+                layer.mAlphaParams.push_back({ NULL, 0.25f, false });
+                layer.mStaticMask = make_random_image(image_size, image_size, 4, rng);
+                layer.mMorphLayer = (const LLTexLayer*)job.get();
+            }
+            job->mLayers.push_back(layer);
+        }
+        job->mClearAlpha = true;
+        job->mMaskLayers.push_back(make_random_image(image_size, image_size, 4, rng));
+        return job;
+    }
+}
+
+namespace tut
+{
+    struct texlayercompositor
+    {
+    };
+    typedef test_group<texlayercompositor> texlayercompositor_t;
+    typedef texlayercompositor_t::object texlayercompositor_object_t;
+    tut::texlayercompositor_t tut_texlayercompositor("LLTexLayerCompositor");
+
+    // the SIMD spans give the same bytes as the scalar ones
+    template<> template<>
+    void texlayercompositor_object_t::test<1>()
+    {
+        std::mt19937 rng(35);
+        const S32 count = 67; // not a multiple of the SIMD width
+        std::vector<U8> dst(count * 4), tex(count * 4), alpha(count);
+        std::vector<U8> simd(count * 4), scalar(count * 4);
+
+        for (S32 round = 0; round < 20; round++)
+        {
+            for (U8& value : dst) value = (U8)(rng() & 0xff);
+            for (U8& value : tex) value = (U8)(rng() & 0xff);
+            for (U8& value : alpha) value = (U8)(rng() & 0xff);
+            // plenty of pixels at the alpha test threshold
+            for (S32 i = 0; i < count; i += 3)
+            {
+                tex[i * 4 + 3] = (U8)(i % 3);
+                alpha[i] = (U8)(i % 3);
+            }
+            const U8 color[4] = { (U8)(rng() & 0xff), (U8)(rng() & 0xff), (U8)(rng() & 0xff), (U8)(rng() & 0xff) };
+
+            for (S32 blend = compositor::BLEND_ALPHA; blend <= compositor::BLEND_REPLACE; blend++)
+            {
+                for (S32 variant = 0; variant < 4; variant++)
+                {
+                    const U8* source = variant & 1 ? tex.data() : NULL;
+                    const bool alpha_test = (variant & 2) != 0;
+                    simd = dst;
+                    scalar = dst;
+                    compositor::drawSpan(simd.data(), source, color, count, (compositor::EBlend)blend, alpha_test);
+                    compositor::drawSpanScalar(scalar.data(), source, color, count, (compositor::EBlend)blend, alpha_test);
+                    ensure("draw span", simd == scalar);
+                }
+            }
+
+            for (S32 op = compositor::ALPHA_SET; op <= compositor::ALPHA_MULTIPLY; op++)
+            {
+                for (S32 variant = 0; variant < 4; variant++)
+                {
+                    const U8* source = variant & 1 ? alpha.data() : NULL;
+                    const bool alpha_test = (variant & 2) != 0;
+                    simd = dst;
+                    scalar = dst;
+                    compositor::alphaSpan(simd.data(), source, color[3], count, (compositor::EAlphaOp)op, alpha_test);
+                    compositor::alphaSpanScalar(scalar.data(), source, color[3], count, (compositor::EAlphaOp)op, alpha_test);
+                    ensure("alpha span", simd == scalar);
+                }
+            }
+        }
+    }
+
+    // golden pixels: a layer set small enough to work out what GL gives
+    template<> template<>
+    void texlayercompositor_object_t::test<2>()
+    {
+        const S32 width = 21;
+        const S32 height = 37;
+        LLPointer<compositor::Job> job = new compositor::Job(width, height);
+
+        // an opaque skin texture
+        const U8 skin[4] = { 200, 100, 50, 255 };
+        compositor::Layer base;
+        base.mTexture = make_image(width, height, 4, skin);
+        job->mLayers.push_back(base);
+
+        // a blue layer through a mask that is a half weight gradient, with
+        // its left half cut out by a multiplied gradient
+        compositor::Layer masked;
+        masked.mColor = LLColor4(0.f, 0.f, 1.f, 1.f);
+        masked.mDrawColor = true;
+        masked.mHasAlphaMask = true;
+        masked.mClearMask = true;
+        masked.mAlphaParams.push_back({ NULL, 0.5f, false });
+        LLPointer<LLImageRaw> cut = new LLImageRaw(width, height, 1);
+        for (S32 y = 0; y < height; y++)
+        {
+            for (S32 x = 0; x < width; x++)
+            {
+                cut->getData()[y * width + x] = x < 10 ? 0 : 255;
+            }
+        }
+        masked.mAlphaParams.push_back({ cut, 0.f, true });
+        masked.mMorphLayer = (const LLTexLayer*)job.get();
+        job->mLayers.push_back(masked);
+
+        // a translucent red texture that only shows where its alpha is over
+        // the alpha test threshold
+        const U8 tint[4] = { 255, 0, 0, 64 };
+        compositor::Layer translucent;
+        translucent.mTexture = make_image(width, height, 4, tint);
+        translucent.mColor = LLColor4(1.f, 1.f, 1.f, 1.f);
+        job->mLayers.push_back(translucent);
+
+        // opaque, then the top rows masked out
+        job->mClearAlpha = true;
+        LLPointer<LLImageRaw> mask = make_image(width, height, 3, skin);
+        job->mMaskLayers.push_back(mask);
+        LLPointer<LLImageRaw> top = make_image(width, height, 4, skin);
+        for (S32 y = 30; y < height; y++)
+        {
+            for (S32 x = 0; x < width; x++)
+            {
+                top->getData()[(y * width + x) * 4 + 3] = 0;
+            }
+        }
+        job->mMaskLayers.push_back(top);
+
+        compositor::composite(*job);
+        ensure("result", job->mResult.notNull());
+
+        const F32 red[4] = { 1.f, 0.f, 0.f, 64.f / 255.f };
+        const F32 blue[4] = { 0.f, 0.f, 1.f, 1.f };
+        for (S32 y = 0; y < height; y++)
+        {
+            for (S32 x = 0; x < width; x++)
+            {
+                GLPixel expected(200.f / 255.f, 100.f / 255.f, 50.f / 255.f, 1.f);
+                const F32 mask_alpha = x < 10 ? 0.f : 128.f / 255.f;
+                expected.mV[3] = mask_alpha;
+                expected.blendDestAlpha(blue);
+                expected.blendAlpha(red);
+                expected.mV[3] = y < 30 ? 1.f : 0.f;
+                ensure("golden pixel", expected.matches(pixel_at(job->mResult, x, y)));
+                ensure("morph mask", abs((S32)job->mLayers[1].mMorphMask[y * width + x] - ll_round(mask_alpha * 255.f)) <= 1);
+            }
+        }
+
+        // an invisible set is cleared to transparent
+        LLPointer<compositor::Job> invisible = new compositor::Job(width, height);
+        invisible->mVisible = false;
+        invisible->mLayers.push_back(base);
+        compositor::composite(*invisible);
+        const U8* pixel = pixel_at(invisible->mResult, 5, 5);
+        ensure("invisible", !pixel[0] && !pixel[1] && !pixel[2] && !pixel[3]);
+    }
+
+    // bands and conversions split over a pool give the same bake, also when
+    // posted as a whole
+    template<> template<>
+    void texlayercompositor_object_t::test<3>()
+    {
+        std::mt19937 rng(350);
+        LLPointer<compositor::Job> serial = make_random_job(256, 200, 6, rng);
+        rng.seed(350);
+        LLPointer<compositor::Job> parallel = make_random_job(256, 200, 6, rng);
+        rng.seed(350);
+        LLPointer<compositor::Job> posted = make_random_job(256, 200, 6, rng);
+
+        LL::ThreadPool pool("TexLayerCompositorTest", 3);
+        pool.start();
+
+        compositor::composite(*serial);
+        compositor::composite(*parallel, "TexLayerCompositorTest");
+        ensure("posted", compositor::post(posted, "TexLayerCompositorTest"));
+        while (!posted->isDone())
+        {
+            std::this_thread::yield();
+        }
+
+        pool.close();
+
+        const S32 size = serial->mResult->getDataSize();
+        ensure("parallel", !memcmp(serial->mResult->getData(), parallel->mResult->getData(), size));
+        ensure("posted result", !memcmp(serial->mResult->getData(), posted->mResult->getData(), size));
+        ensure("morph masks", serial->mLayers[1].mMorphMask == parallel->mLayers[1].mMorphMask);
+    }
+
+    // a bake of eight layers on the calling thread matches the same bake
+    // split over a pool
+    template<> template<>
+    void texlayercompositor_object_t::test<4>()
+    {
+        const S32 size = Benchmark::size(1024, 128);
+        const S32 bakes = Benchmark::size(5, 1);
+        const S32 threads = llmax(2, (S32)std::thread::hardware_concurrency());
+
+        std::mt19937 rng(3500);
+        std::vector<LLPointer<compositor::Job> > jobs;
+        for (S32 i = 0; i < bakes * 2; i++)
+        {
+            rng.seed(3500);
+            jobs.push_back(make_random_job(size, size, 8, rng));
+        }
+
+        LL::ThreadPool pool("TexLayerCompositorBenchmark", threads - 1);
+        pool.start();
+
+        Benchmark bench(stringize("CPU bake, ", size, "x", size, " with 8 layers, ms per bake"));
+        for (S32 i = 0; i < bakes; i++)
+        {
+            compositor::composite(*jobs[i]);
+        }
+        bench.report("one thread ", bench.elapsed_ms() / bakes);
+
+        bench.start();
+        for (S32 i = bakes; i < bakes * 2; i++)
+        {
+            compositor::composite(*jobs[i], "TexLayerCompositorBenchmark");
+        }
+        bench.report(threads, " threads  ", bench.elapsed_ms() / bakes);
+
+        pool.close();
+
+        ensure("same bake", !memcmp(jobs[0]->mResult->getData(), jobs[bakes]->mResult->getData(), jobs[0]->mResult->getDataSize()));
+    }
+}
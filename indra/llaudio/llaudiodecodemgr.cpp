@@ -28,6 +28,7 @@
 #include "llaudiodecodemgr.h"
 
 #include "llaudioengine.h"
+#include "llaudiopcmcache.h"
 #include "lllfsthread.h"
 #include "llfilesystem.h"
 #include "llstring.h"
@@ -44,14 +45,25 @@
 #include "vorbis/vorbisfile.h"
 #include <iterator>
 #include <deque>
+#include <unordered_set>
 
 extern LLAudioEngine *gAudiop;
 
 static const S32 WAV_HEADER_SIZE = 44;
 
+// Default budget for decoded sounds kept in memory
+static const size_t PCM_CACHE_DEFAULT_BYTES = 64 * 1024 * 1024;
+
 
 //////////////////////////////////////////////////////////////////////////////
 
+// Ogg stream held in memory, see memory_read() etc.
+struct memory_source_t
+{
+    const U8* mData;
+    size_t mSize;
+    size_t mPos;
+};
 
 class LLVorbisDecodeState : public LLThreadSafeRefCount
 {
@@ -68,9 +80,11 @@ public:
         LLPointer<LLVorbisDecodeState> mDecoder;
     };
 
+    // An empty out_filename skips writing the .dsf file
     LLVorbisDecodeState(const LLUUID &uuid, const std::string &out_filename);
 
-    bool initDecode();
+    bool initDecode();                                  // from the asset cache
+    bool initDecode(const U8* data, size_t size);       // from memory, data must outlive the decode
     bool decodeSection(); // Return true if done.
     bool finishDecode();
 
@@ -81,19 +95,28 @@ public:
     bool isDone() const                 { return mDone; }
     const LLUUID &getUUID() const       { return mUUID; }
 
+    // Finished WAV image, available once finishDecode() has started the
+    // disk write (or completed, when there is nothing to write).
+    const LLAudioPCMCache::data_ptr_t& getWAVData() const { return mWAVData; }
+
 protected:
     virtual ~LLVorbisDecodeState();
 
+    bool openStream(void* datasource, const ov_callbacks& callbacks);
+
     bool mValid;
     bool mDone;
+    bool mOpen;
     LLAtomicS32 mBytesRead;
     LLUUID mUUID;
 
     std::vector<U8> mWAVBuffer;
+    LLAudioPCMCache::data_ptr_t mWAVData;
     std::string mOutFilename;
     LLLFSThread::handle_t mFileHandle;
 
     LLFileSystem *mInFilep;
+    memory_source_t mMemory;
     OggVorbis_File mVF;
     S32 mCurrentSection;
 };
@@ -162,13 +185,68 @@ long cache_tell (void *datasource)
     return file->tell();
 }
 
+size_t memory_read(void *ptr, size_t size, size_t nmemb, void *datasource)
+{
+    memory_source_t *source = (memory_source_t *)datasource;
+    if (!size)
+    {
+        return 0;
+    }
+    size_t count = llmin(nmemb, (source->mSize - source->mPos) / size);
+    memcpy(ptr, source->mData + source->mPos, count * size);   /*Flawfinder: ignore*/
+    source->mPos += count * size;
+    return count;
+}
+
+S32 memory_seek(void *datasource, ogg_int64_t offset, S32 whence)
+{
+    memory_source_t *source = (memory_source_t *)datasource;
+
+    ogg_int64_t origin;
+    switch (whence) {
+    case SEEK_SET:
+        origin = 0;
+        break;
+    case SEEK_END:
+        origin = (ogg_int64_t)source->mSize;
+        break;
+    case SEEK_CUR:
+        origin = (ogg_int64_t)source->mPos;
+        break;
+    default:
+        return -1;
+    }
+
+    ogg_int64_t pos = origin + offset;
+    if (pos < 0 || pos > (ogg_int64_t)source->mSize)
+    {
+        return -1;
+    }
+    source->mPos = (size_t)pos;
+    return 0;
+}
+
+S32 memory_close(void *datasource)
+{
+    // caller owns the memory
+    return 0;
+}
+
+long memory_tell(void *datasource)
+{
+    memory_source_t *source = (memory_source_t *)datasource;
+    return (long)source->mPos;
+}
+
 LLVorbisDecodeState::LLVorbisDecodeState(const LLUUID &uuid, const std::string &out_filename)
 {
     mDone = false;
     mValid = false;
+    mOpen = false;
     mBytesRead = -1;
     mUUID = uuid;
     mInFilep = NULL;
+    mMemory = { NULL, 0, 0 };
     mCurrentSection = 0;
     mOutFilename = out_filename;
     mFileHandle = LLLFSThread::nullHandle();
@@ -207,7 +285,34 @@ bool LLVorbisDecodeState::initDecode()
         return false;
     }
 
-    S32 r = ov_open_callbacks(mInFilep, &mVF, NULL, 0, cache_callbacks);
+    if (!openStream(mInFilep, cache_callbacks))
+    {
+        delete mInFilep;
+        mInFilep = NULL;
+        return false;
+    }
+    return true;
+}
+
+bool LLVorbisDecodeState::initDecode(const U8* data, size_t size)
+{
+    ov_callbacks memory_callbacks;
+    memory_callbacks.read_func = memory_read;
+    memory_callbacks.seek_func = memory_seek;
+    memory_callbacks.close_func = memory_close;
+    memory_callbacks.tell_func = memory_tell;
+
+    if (!data || !size)
+    {
+        return false;
+    }
+    mMemory = { data, size, 0 };
+    return openStream(&mMemory, memory_callbacks);
+}
+
+bool LLVorbisDecodeState::openStream(void* datasource, const ov_callbacks& callbacks)
+{
+    S32 r = ov_open_callbacks(datasource, &mVF, NULL, 0, callbacks);
     if(r < 0)
     {
         LL_WARNS("AudioEngine") << r << " Input to vorbis decode does not appear to be an Ogg bitstream: " << mUUID << LL_ENDL;
@@ -360,14 +465,15 @@ bool LLVorbisDecodeState::initDecode()
 //    fprintf(stderr,"\nDecoded length: %ld samples\n", (long)ov_pcm_total(&vf,-1));
 //    fprintf(stderr,"Encoded by: %s\n\n",ov_comment(&vf,-1)->vendor);
     //}
+    mOpen = true;
     return true;
 }
 
 bool LLVorbisDecodeState::decodeSection()
 {
-    if (!mInFilep)
+    if (!mOpen)
     {
-        LL_WARNS("AudioEngine") << "No cache file to decode in vorbis!" << LL_ENDL;
+        LL_WARNS("AudioEngine") << "No stream to decode in vorbis!" << LL_ENDL;
         return true;
     }
     if (mDone)
@@ -417,7 +523,7 @@ bool LLVorbisDecodeState::finishDecode()
         return true; // We've finished
     }
 
-    if (mFileHandle == LLLFSThread::nullHandle())
+    if (!mWAVData)
     {
         ov_clear(&mVF);
 
@@ -490,9 +596,18 @@ bool LLVorbisDecodeState::finishDecode()
             mValid = false;
             return true; // we've finished
         }
-        mBytesRead = -1;
-        mFileHandle = LLLFSThread::sLocal->write(mOutFilename, &mWAVBuffer[0], 0, static_cast<S32>(mWAVBuffer.size()),
-                             new WriteResponder(this));
+
+        // Hand the finished image over to a shared buffer so the PCM cache
+        // and the disk write below can both use it without a copy
+        mWAVData = std::make_shared<const std::vector<U8>>(std::move(mWAVBuffer));
+        mWAVBuffer.clear();
+
+        if (!mOutFilename.empty())
+        {
+            mBytesRead = -1;
+            mFileHandle = LLLFSThread::sLocal->write(mOutFilename, const_cast<U8*>(mWAVData->data()), 0, static_cast<S32>(mWAVData->size()),
+                                 new WriteResponder(this));
+        }
     }
 
     if (mFileHandle != LLLFSThread::nullHandle())
@@ -544,19 +659,23 @@ class LLAudioDecodeMgr::Impl
 
   protected:
     std::deque<LLUUID> mDecodeQueue;
+    std::unordered_set<LLUUID> mQueued;     // contents of mDecodeQueue, for dedup
     std::map<LLUUID, LLPointer<LLVorbisDecodeState>> mDecodes;
+    // Shared with decode workers, which may outlive us at shutdown
+    std::shared_ptr<LLAudioPCMCache> mPCMCache;
 };
 
 LLAudioDecodeMgr::Impl::Impl()
+    : mPCMCache(std::make_shared<LLAudioPCMCache>(PCM_CACHE_DEFAULT_BYTES))
 {
 }
 
 // Returns the in-progress decode_state, which may be an empty LLPointer if
 // there was an error and there is no more work to be done.
-LLPointer<LLVorbisDecodeState> beginDecodingAndWritingAudio(const LLUUID &decode_id);
+LLPointer<LLVorbisDecodeState> beginDecodingAndWritingAudio(const LLUUID &decode_id, LLAudioPCMCache& pcm_cache);
 
 // Return true if finished
-bool tryFinishAudio(const LLUUID &decode_id, LLPointer<LLVorbisDecodeState> decode_state);
+bool tryFinishAudio(const LLUUID &decode_id, LLPointer<LLVorbisDecodeState> decode_state, const LLAudioPCMCache& pcm_cache);
 
 void LLAudioDecodeMgr::Impl::processQueue()
 {
@@ -594,6 +713,7 @@ void LLAudioDecodeMgr::Impl::startMoreDecodes()
     {
         const LLUUID decode_id = mDecodeQueue.front();
         mDecodeQueue.pop_front();
+        mQueued.erase(decode_id);
 
         // Don't decode the same file twice
         if (mDecodes.find(decode_id) != mDecodes.end())
@@ -607,11 +727,12 @@ void LLAudioDecodeMgr::Impl::startMoreDecodes()
 
         // Kick off a decode
         mDecodes[decode_id] = LLPointer<LLVorbisDecodeState>(NULL);
+        std::shared_ptr<LLAudioPCMCache> pcm_cache = mPCMCache;
         bool posted = main_queue->postTo(
             general_queue,
-            [decode_id]() // Work done on general queue
+            [decode_id, pcm_cache]() // Work done on general queue
             {
-                LLPointer<LLVorbisDecodeState> decode_state = beginDecodingAndWritingAudio(decode_id);
+                LLPointer<LLVorbisDecodeState> decode_state = beginDecodingAndWritingAudio(decode_id, *pcm_cache);
 
                 if (!decode_state)
                 {
@@ -619,7 +740,8 @@ void LLAudioDecodeMgr::Impl::startMoreDecodes()
                     return decode_state;
                 }
 
-                // Disk write of decoded audio is now in progress off-thread
+                // Decoded audio is in the PCM cache and the disk write is
+                // now in progress off-thread
                 return decode_state;
             },
             [decode_id, this](LLPointer<LLVorbisDecodeState> decode_state) // Callback to main thread
@@ -647,7 +769,7 @@ void LLAudioDecodeMgr::Impl::startMoreDecodes()
     }
 }
 
-LLPointer<LLVorbisDecodeState> beginDecodingAndWritingAudio(const LLUUID &decode_id)
+LLPointer<LLVorbisDecodeState> beginDecodingAndWritingAudio(const LLUUID &decode_id, LLAudioPCMCache& pcm_cache)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_MEDIA;
 
@@ -690,13 +812,20 @@ LLPointer<LLVorbisDecodeState> beginDecodingAndWritingAudio(const LLUUID &decode
     // decode_state to prevent it from getting destroyed during write.
     decode_state->finishDecode();
 
+    // The sound is playable from memory right away, the .dsf file is for
+    // later sessions and for sounds the PCM cache has evicted.
+    if (decode_state->isValid())
+    {
+        pcm_cache.insert(decode_id, decode_state->getWAVData());
+    }
+
     return decode_state;
 }
 
 void LLAudioDecodeMgr::Impl::enqueueFinishAudio(const LLUUID &decode_id, LLPointer<LLVorbisDecodeState>& decode_state)
 {
     // Assumed fast
-    if (tryFinishAudio(decode_id, decode_state))
+    if (tryFinishAudio(decode_id, decode_state, *mPCMCache))
     {
         // Done early!
         auto decode_iter = mDecodes.find(decode_id);
@@ -716,7 +845,7 @@ void LLAudioDecodeMgr::Impl::checkDecodesFinished()
     {
         const LLUUID& decode_id = decode_iter->first;
         const LLPointer<LLVorbisDecodeState>& decode_state = decode_iter->second;
-        if (tryFinishAudio(decode_id, decode_state))
+        if (tryFinishAudio(decode_id, decode_state, *mPCMCache))
         {
             decode_iter = mDecodes.erase(decode_iter);
         }
@@ -727,10 +856,13 @@ void LLAudioDecodeMgr::Impl::checkDecodesFinished()
     }
 }
 
-bool tryFinishAudio(const LLUUID &decode_id, LLPointer<LLVorbisDecodeState> decode_state)
+bool tryFinishAudio(const LLUUID &decode_id, LLPointer<LLVorbisDecodeState> decode_state, const LLAudioPCMCache& pcm_cache)
 {
-    // decode_state is a file write in progress unless finished is true
-    bool finished = decode_state && decode_state->finishDecode();
+    // decode_state is a file write in progress unless finished is true.
+    // Sounds in the PCM cache don't need to wait for the write, the
+    // WriteResponder keeps decode_state alive until it completes.
+    bool finished = decode_state &&
+        (decode_state->finishDecode() || (decode_state->isValid() && pcm_cache.contains(decode_id)));
     if (!finished)
     {
         return false;
@@ -792,7 +924,7 @@ bool LLAudioDecodeMgr::addDecodeRequest(const LLUUID &uuid)
     {
         // Just put it on the decode queue it if it's not already in the queue
         LL_DEBUGS("AudioEngine") << "addDecodeRequest for " << uuid << " has local asset file already" << LL_ENDL;
-        if (std::find(mImpl->mDecodeQueue.begin(), mImpl->mDecodeQueue.end(), uuid) == mImpl->mDecodeQueue.end())
+        if (mImpl->mQueued.insert(uuid).second)
         {
             mImpl->mDecodeQueue.emplace_back(uuid);
         }
@@ -802,3 +934,37 @@ bool LLAudioDecodeMgr::addDecodeRequest(const LLUUID &uuid)
     LL_DEBUGS("AudioEngine") << "addDecodeRequest for " << uuid << " no file available" << LL_ENDL;
     return false;
 }
+
+LLAudioPCMCache& LLAudioDecodeMgr::getPCMCache()
+{
+    return *mImpl->mPCMCache;
+}
+
+void LLAudioDecodeMgr::setPCMCacheSize(size_t max_bytes)
+{
+    mImpl->mPCMCache->setMaxBytes(max_bytes);
+}
+
+// static
+bool LLAudioDecodeMgr::decodeVorbis(const U8* data, size_t size, std::vector<U8>& wav_out)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_MEDIA;
+
+    LLPointer<LLVorbisDecodeState> decode_state = new LLVorbisDecodeState(LLUUID::null, std::string());
+    if (!decode_state->initDecode(data, size))
+    {
+        return false;
+    }
+
+    while (!decode_state->decodeSection())
+    {
+    }
+
+    if (!decode_state->isValid() || !decode_state->finishDecode() || !decode_state->isValid())
+    {
+        return false;
+    }
+
+    wav_out = *decode_state->getWAVData();
+    return true;
+}
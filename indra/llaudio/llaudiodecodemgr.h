@@ -28,6 +28,8 @@
 
 #include "stdtypes.h"
 
+#include <vector>
+
 #include "lluuid.h"
 
 #include "llassettype.h"
@@ -35,6 +37,7 @@
 #include "llsingleton.h"
 
 template<class T> class LLPointer;
+class LLAudioPCMCache;
 class LLVorbisDecodeState;
 
 class LLAudioDecodeMgr : public LLSingleton<LLAudioDecodeMgr>
@@ -46,6 +49,15 @@ public:
     bool addDecodeRequest(const LLUUID &uuid);
     void addAudioRequest(const LLUUID &uuid);
 
+    // Recently decoded sounds, filled by the decode workers and used by
+    // LLAudioData::load() ahead of the .dsf files on disk
+    LLAudioPCMCache& getPCMCache();
+    void setPCMCacheSize(size_t max_bytes);
+
+    // Decode an in-memory Ogg Vorbis stream to the WAV image the decode
+    // queue produces.  Thread safe, for tests and tools.
+    static bool decodeVorbis(const U8* data, size_t size, std::vector<U8>& wav_out);
+
 protected:
     class Impl;
     Impl* mImpl;
@@ -38,6 +38,7 @@
 #include "llfilesystem.h"
 #include "lldir.h"
 #include "llaudiodecodemgr.h"
+#include "llaudiopcmcache.h"
 #include "llassetstorage.h"
 
 
@@ -966,6 +967,11 @@ void LLAudioEngine::cleanupAudioSource(LLAudioSource *asp)
 
 bool LLAudioEngine::hasDecodedFile(const LLUUID &uuid)
 {
+    if (LLAudioDecodeMgr::getInstance()->getPCMCache().contains(uuid))
+    {
+        return true;
+    }
+
     std::string uuid_str;
     uuid.toString(uuid_str);
 
@@ -1817,6 +1823,15 @@ bool LLAudioData::load()
         return true;
     }
 
+    // Recently decoded sounds are still in memory
+    LLAudioPCMCache::data_ptr_t pcm = LLAudioDecodeMgr::getInstance()->getPCMCache().find(mID);
+    if (pcm && mBufferp->loadWAVData(pcm->data(), pcm->size()))
+    {
+        mHasWAVLoadFailed = false;
+        mBufferp->mAudioDatap = this;
+        return true;
+    }
+
     std::string uuid_str;
     std::string wav_path;
     mID.toString(uuid_str);
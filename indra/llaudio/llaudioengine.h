@@ -447,6 +447,8 @@ class LLAudioBuffer
 public:
     virtual ~LLAudioBuffer() {};
     virtual bool loadWAV(const std::string& filename) = 0;
+    // Load from a complete WAV image in memory
+    virtual bool loadWAVData(const U8* data, size_t size) = 0;
     virtual U32 getLength() = 0;
 
     friend class LLAudioEngine;
@@ -0,0 +1,152 @@
+/**
+ * @file llaudiopcmcache.cpp
+ * @brief Bounded in-memory cache of decoded sounds.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llaudiopcmcache.h"
+
+LLAudioPCMCache::LLAudioPCMCache(size_t max_bytes)
+    : mBytes(0),
+      mMaxBytes(max_bytes),
+      mHits(0),
+      mMisses(0)
+{
+}
+
+void LLAudioPCMCache::setMaxBytes(size_t max_bytes)
+{
+    LLMutexLock lock(&mMutex);
+    mMaxBytes = max_bytes;
+    evictToFit(mMaxBytes);
+}
+
+size_t LLAudioPCMCache::getMaxBytes() const
+{
+    LLMutexLock lock(&mMutex);
+    return mMaxBytes;
+}
+
+void LLAudioPCMCache::insert(const LLUUID& id, const data_ptr_t& data)
+{
+    if (!data)
+    {
+        return;
+    }
+
+    LLMutexLock lock(&mMutex);
+    auto found = mIndex.find(id);
+    if (found != mIndex.end())
+    {
+        mBytes -= found->second->second->size();
+        mLRU.erase(found->second);
+        mIndex.erase(found);
+    }
+
+    const size_t size = data->size();
+    if (size > mMaxBytes)
+    {
+        return;
+    }
+
+    evictToFit(mMaxBytes - size);
+    mLRU.emplace_front(id, data);
+    mIndex[id] = mLRU.begin();
+    mBytes += size;
+}
+
+LLAudioPCMCache::data_ptr_t LLAudioPCMCache::find(const LLUUID& id)
+{
+    LLMutexLock lock(&mMutex);
+    auto found = mIndex.find(id);
+    if (found == mIndex.end())
+    {
+        ++mMisses;
+        return data_ptr_t();
+    }
+    ++mHits;
+    mLRU.splice(mLRU.begin(), mLRU, found->second);
+    return found->second->second;
+}
+
+bool LLAudioPCMCache::contains(const LLUUID& id) const
+{
+    LLMutexLock lock(&mMutex);
+    return mIndex.find(id) != mIndex.end();
+}
+
+void LLAudioPCMCache::erase(const LLUUID& id)
+{
+    LLMutexLock lock(&mMutex);
+    auto found = mIndex.find(id);
+    if (found != mIndex.end())
+    {
+        mBytes -= found->second->second->size();
+        mLRU.erase(found->second);
+        mIndex.erase(found);
+    }
+}
+
+void LLAudioPCMCache::clear()
+{
+    LLMutexLock lock(&mMutex);
+    mLRU.clear();
+    mIndex.clear();
+    mBytes = 0;
+}
+
+size_t LLAudioPCMCache::getBytes() const
+{
+    LLMutexLock lock(&mMutex);
+    return mBytes;
+}
+
+size_t LLAudioPCMCache::getCount() const
+{
+    LLMutexLock lock(&mMutex);
+    return mIndex.size();
+}
+
+U64 LLAudioPCMCache::getHits() const
+{
+    LLMutexLock lock(&mMutex);
+    return mHits;
+}
+
+U64 LLAudioPCMCache::getMisses() const
+{
+    LLMutexLock lock(&mMutex);
+    return mMisses;
+}
+
+void LLAudioPCMCache::evictToFit(size_t max_bytes)
+{
+    while (mBytes > max_bytes && !mLRU.empty())
+    {
+        mBytes -= mLRU.back().second->size();
+        mIndex.erase(mLRU.back().first);
+        mLRU.pop_back();
+    }
+}
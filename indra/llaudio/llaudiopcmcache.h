@@ -0,0 +1,93 @@
+/**
+ * @file llaudiopcmcache.h
+ * @brief Bounded in-memory cache of decoded sounds.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLAUDIOPCMCACHE_H
+#define LL_LLAUDIOPCMCACHE_H
+
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "llmutex.h"
+#include "lluuid.h"
+
+// Least recently used cache of decoded sounds (complete WAV images, as
+// written to the .dsf files) so that sounds which are played again soon
+// after being decoded can be handed straight to an audio buffer instead of
+// going back through the disk cache.
+//
+// Entries are shared and immutable, a buffer being filled from an entry
+// that is evicted at the same time keeps its own reference.  The total
+// size of the entries is kept at or below the byte budget, entries larger
+// than the whole budget are not cached.
+//
+// Thread safe, decode workers insert while the main thread looks up.
+class LLAudioPCMCache
+{
+public:
+    typedef std::shared_ptr<const std::vector<U8>> data_ptr_t;
+
+    explicit LLAudioPCMCache(size_t max_bytes);
+
+    // Shrinking the budget evicts immediately
+    void setMaxBytes(size_t max_bytes);
+    size_t getMaxBytes() const;
+
+    // Replaces any existing entry for id and marks it most recently used
+    void insert(const LLUUID& id, const data_ptr_t& data);
+
+    // Returns an empty pointer on a miss, marks the entry most recently
+    // used on a hit
+    data_ptr_t find(const LLUUID& id);
+
+    // Presence check, does not affect LRU order or hit counts
+    bool contains(const LLUUID& id) const;
+
+    void erase(const LLUUID& id);
+    void clear();
+
+    size_t getBytes() const;
+    size_t getCount() const;
+    U64 getHits() const;
+    U64 getMisses() const;
+
+private:
+    // Locks:  mMutex
+    void evictToFit(size_t max_bytes);
+
+    typedef std::list<std::pair<LLUUID, data_ptr_t>> lru_list_t;
+
+    mutable LLMutex mMutex;
+    lru_list_t mLRU;    // front is most recently used
+    std::unordered_map<LLUUID, lru_list_t::iterator> mIndex;
+    size_t mBytes;
+    size_t mMaxBytes;
+    U64 mHits;
+    U64 mMisses;
+};
+
+#endif // LL_LLAUDIOPCMCACHE_H
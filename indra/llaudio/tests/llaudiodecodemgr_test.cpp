@@ -0,0 +1,278 @@
+/**
+ * @file llaudiodecodemgr_test.cpp
+ * @brief Test cases for Vorbis decoding and the decoded sound cache
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include <atomic>
+#include <fstream>
+#include <thread>
+
+#include "../llaudiodecodemgr.h"
+#include "../llaudiopcmcache.h"
+#include "../llvorbisencode.h"
+#include "llmath.h"
+#include "lldiriterator.h"
+#include "llfile.h"
+
+#include "../test/lltut.h"
+#include "../test/benchmark.h"
+#include "../test/namedtempfile.h"
+
+namespace
+{
+    typedef std::vector<U8> bytes_t;
+
+    void put_le(std::ostream& out, U32 value, S32 size)
+    {
+        for (S32 i = 0; i < size; ++i)
+        {
+            out.put((char)((value >> (8 * i)) & 0xFF));
+        }
+    }
+
+    // Mono 16 bit 44.1kHz sweep, the only format the uploader accepts
+    void write_wav(std::ostream& out, F32 seconds, F32 base_hz)
+    {
+        const U32 samples = (U32)(seconds * LLVORBIS_CLIP_SAMPLE_RATE);
+        const U32 data_size = samples * 2;
+        out.write("RIFF", 4);
+        put_le(out, data_size + 36, 4);
+        out.write("WAVEfmt ", 8);
+        put_le(out, 16, 4);
+        put_le(out, 1, 2);                                  // PCM
+        put_le(out, 1, 2);                                  // channels
+        put_le(out, LLVORBIS_CLIP_SAMPLE_RATE, 4);
+        put_le(out, LLVORBIS_CLIP_SAMPLE_RATE * 2, 4);
+        put_le(out, 2, 2);                                  // block align
+        put_le(out, 16, 2);                                 // bits per sample
+        out.write("data", 4);
+        put_le(out, data_size, 4);
+        for (U32 i = 0; i < samples; ++i)
+        {
+            const F32 t = (F32)i / LLVORBIS_CLIP_SAMPLE_RATE;
+            const F32 hz = base_hz * (1.f + t);
+            put_le(out, (U32)(S16)(12000.f * sinf(F_TWO_PI * hz * t)), 2);
+        }
+    }
+
+    bool read_file(const std::string& path, bytes_t& out)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+        {
+            return false;
+        }
+        out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        return !out.empty();
+    }
+
+    bytes_t make_ogg(F32 seconds, F32 base_hz)
+    {
+        NamedTempFile wav("llaudiodecodemgr_test",
+                          [seconds, base_hz](std::ostream& out) { write_wav(out, seconds, base_hz); },
+                          ".wav");
+        const std::string ogg_path = NamedTempFile::temp_path("llaudiodecodemgr_test", ".ogg").string();
+        bytes_t ogg;
+        if (encode_vorbis_file(wav.getName(), ogg_path) == LLVORBISENC_NOERR)
+        {
+            read_file(ogg_path, ogg);
+        }
+        LLFile::remove(ogg_path);
+        return ogg;
+    }
+
+    // Real sounds from $LL_AUDIO_DECODE_CORPUS (a directory of .ogg files)
+    // when set, otherwise a synthetic set of short clips.
+    std::vector<bytes_t> load_corpus()
+    {
+        std::vector<bytes_t> corpus;
+        const char* dir = getenv("LL_AUDIO_DECODE_CORPUS");
+        if (dir && *dir)
+        {
+            LLDirIterator iter(dir, "*.ogg");
+            std::string name;
+            while (iter.next(name))
+            {
+                bytes_t ogg;
+                if (read_file(std::string(dir) + "/" + name, ogg))
+                {
+                    corpus.push_back(std::move(ogg));
+                }
+            }
+        }
+        if (corpus.empty())
+        {
+            const S32 clips = Benchmark::size(24, 4);
+            for (S32 i = 0; i < clips; ++i)
+            {
+                corpus.push_back(make_ogg(0.5f + 0.25f * (i % 8), 220.f + 40.f * i));
+            }
+        }
+        return corpus;
+    }
+
+    LLAudioPCMCache::data_ptr_t make_data(size_t size)
+    {
+        return std::make_shared<const bytes_t>(size, (U8)size);
+    }
+}
+
+namespace tut
+{
+    struct llaudiodecodemgr_test
+    {
+    };
+    typedef test_group<llaudiodecodemgr_test> llaudiodecodemgr_test_t;
+    typedef llaudiodecodemgr_test_t::object llaudiodecodemgr_test_object_t;
+    tut::llaudiodecodemgr_test_t tut_llaudiodecodemgr_test("LLAudioDecodeMgr");
+
+    // PCM cache is bounded by bytes and evicts least recently used
+    template<> template<>
+    void llaudiodecodemgr_test_object_t::test<1>()
+    {
+        const LLUUID a = LLUUID::generateNewID("a"), b = LLUUID::generateNewID("b"),
+                     c = LLUUID::generateNewID("c"), d = LLUUID::generateNewID("d");
+        LLAudioPCMCache cache(300);
+        cache.insert(a, make_data(100));
+        cache.insert(b, make_data(100));
+        cache.insert(c, make_data(100));
+        ensure_equals("full", cache.getBytes(), (size_t)300);
+
+        ensure("touch a", cache.find(a) != nullptr);
+        cache.insert(d, make_data(100));
+        ensure("b evicted", !cache.contains(b));
+        ensure("a kept", cache.contains(a));
+        ensure_equals("within budget", cache.getBytes(), (size_t)300);
+
+        cache.insert(b, make_data(1000));
+        ensure("oversized not cached", !cache.contains(b));
+        ensure("miss", !cache.find(b));
+        ensure_equals("hits", cache.getHits(), (U64)1);
+        ensure_equals("misses", cache.getMisses(), (U64)1);
+
+        // replacing an entry accounts for the old size
+        cache.insert(a, make_data(50));
+        ensure_equals("replace", cache.getBytes(), (size_t)250);
+
+        LLAudioPCMCache::data_ptr_t held = cache.find(d);
+        cache.find(a);
+        cache.setMaxBytes(60);
+        ensure("shrink evicts", !cache.contains(d) && cache.contains(a) && cache.getCount() == 1);
+        ensure_equals("evicted data still held", held->size(), (size_t)100);
+    }
+
+    // decodes produce a WAV image of the right length and reject garbage
+    template<> template<>
+    void llaudiodecodemgr_test_object_t::test<2>()
+    {
+        bytes_t ogg = make_ogg(1.f, 440.f);
+        ensure("encoded", !ogg.empty());
+
+        bytes_t wav;
+        ensure("decode", LLAudioDecodeMgr::decodeVorbis(ogg.data(), ogg.size(), wav));
+        ensure("RIFF header", wav.size() > 44 && memcmp(wav.data(), "RIFF", 4) == 0 && memcmp(&wav[36], "data", 4) == 0);
+        const U32 data_size = wav[40] | (wav[41] << 8) | (wav[42] << 16) | (wav[43] << 24);
+        ensure_equals("data chunk size", (size_t)data_size + 44, wav.size());
+        ensure("sample count", llabs((S32)(data_size / 2) - (S32)LLVORBIS_CLIP_SAMPLE_RATE) < 1024);
+
+        bytes_t garbage(4096, 0x5A);
+        ensure("reject garbage", !LLAudioDecodeMgr::decodeVorbis(garbage.data(), garbage.size(), wav));
+        ensure("reject truncated", !LLAudioDecodeMgr::decodeVorbis(ogg.data(), 64, wav));
+    }
+
+    // serial and parallel decodes of the corpus agree, and a request stream
+    // with repeats decodes each sound once through the PCM cache
+    template<> template<>
+    void llaudiodecodemgr_test_object_t::test<3>()
+    {
+        std::vector<bytes_t> corpus = load_corpus();
+        ensure("corpus", !corpus.empty());
+
+        Benchmark bench("Vorbis decode, ms");
+        size_t pcm_bytes = 0;
+        for (const bytes_t& ogg : corpus)
+        {
+            bytes_t wav;
+            ensure("serial decode", LLAudioDecodeMgr::decodeVorbis(ogg.data(), ogg.size(), wav));
+            pcm_bytes += wav.size();
+        }
+        bench.report("serial           ", bench.elapsed_ms());
+
+        const U32 width = llmax(2U, std::thread::hardware_concurrency());
+        std::atomic<size_t> next(0);
+        std::atomic<size_t> parallel_bytes(0);
+        std::atomic<S32> failures(0);
+        bench.start();
+        {
+            std::vector<std::thread> workers;
+            for (U32 i = 0; i < width; ++i)
+            {
+                workers.emplace_back([&]()
+                    {
+                        bytes_t wav;
+                        for (size_t n = next++; n < corpus.size(); n = next++)
+                        {
+                            if (!LLAudioDecodeMgr::decodeVorbis(corpus[n].data(), corpus[n].size(), wav))
+                            {
+                                ++failures;
+                            }
+                            parallel_bytes += wav.size();
+                        }
+                    });
+            }
+            for (std::thread& worker : workers)
+            {
+                worker.join();
+            }
+        }
+        bench.report(width, " threads        ", bench.elapsed_ms());
+        ensure_equals("parallel decode", failures.load(), 0);
+        ensure_equals("parallel PCM", parallel_bytes.load(), pcm_bytes);
+
+        // gesture spam: every sound requested four times, decode on miss
+        LLAudioPCMCache cache(pcm_bytes);
+        S32 decodes = 0;
+        bench.start();
+        for (S32 pass = 0; pass < 4; ++pass)
+        {
+            for (size_t n = 0; n < corpus.size(); ++n)
+            {
+                const LLUUID id = LLUUID::generateNewID(llformat("sound %d", (S32)n));
+                if (!cache.find(id))
+                {
+                    bytes_t wav;
+                    LLAudioDecodeMgr::decodeVorbis(corpus[n].data(), corpus[n].size(), wav);
+                    cache.insert(id, std::make_shared<const bytes_t>(std::move(wav)));
+                    ++decodes;
+                }
+            }
+        }
+        bench.report("4x through cache ", bench.elapsed_ms(), " (", corpus.size(), " sounds, ",
+                     pcm_bytes / 1024, " KB PCM)");
+        ensure_equals("each sound decoded once", decodes, (S32)corpus.size());
+        ensure_equals("cache hits", cache.getHits(), U64(3 * corpus.size()));
+    }
+}
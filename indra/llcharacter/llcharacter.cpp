@@ -50,7 +50,9 @@ LLCharacter::LLCharacter()
     mPreferredPelvisHeight( 0.f ),
     mSex( SEX_FEMALE ),
     mAppearanceSerialNum( 0 ),
-    mSkeletonSerialNum( 0 )
+    mSkeletonSerialNum( 0 ),
+    mDeferVisualParamsUpdate( false ),
+    mVisualParamsUpdateDeferred( false )
 {
     llassert_always(sAllowInstancesChange) ;
 
@@ -192,6 +194,18 @@ void LLCharacter::updateMotions(e_update_t update_type)
     }
 }
 
+//-----------------------------------------------------------------------------
+// beginParallelMotionsUpdate()
+//-----------------------------------------------------------------------------
+bool LLCharacter::beginParallelMotionsUpdate()
+{
+    if (mMotionController.isPaused() && mPauseRequest->getNumRefs() == 1)
+    {
+        mMotionController.unpauseAllMotions();
+    }
+    return mMotionController.beginParallelUpdate(false);
+}
+
 
 //-----------------------------------------------------------------------------
 // deactivateAllMotions()
@@ -475,6 +489,34 @@ void LLCharacter::updateVisualParams()
     }
 }
 
+//-----------------------------------------------------------------------------
+// requestVisualParamsUpdate()
+//-----------------------------------------------------------------------------
+void LLCharacter::requestVisualParamsUpdate()
+{
+    if (mDeferVisualParamsUpdate)
+    {
+        mVisualParamsUpdateDeferred = true;
+    }
+    else
+    {
+        updateVisualParams();
+    }
+}
+
+//-----------------------------------------------------------------------------
+// setDeferVisualParamsUpdate()
+//-----------------------------------------------------------------------------
+void LLCharacter::setDeferVisualParamsUpdate(bool defer)
+{
+    mDeferVisualParamsUpdate = defer;
+    if (!defer && mVisualParamsUpdateDeferred)
+    {
+        mVisualParamsUpdateDeferred = false;
+        updateVisualParams();
+    }
+}
+
 LLAnimPauseRequest LLCharacter::requestPause()
 {
     mMotionController.pauseAllMotions();
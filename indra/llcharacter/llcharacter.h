@@ -117,6 +117,13 @@ public:
     // updates all visual parameters for this character
     virtual void updateVisualParams();
 
+    // Motions call this from onUpdate() instead of updateVisualParams().
+    // While the motion controller is updating off the main thread (see
+    // LLMotionController::beginParallelUpdate()) the update is put off
+    // until it is back.
+    void requestVisualParamsUpdate();
+    void setDeferVisualParamsUpdate(bool defer);
+
     virtual void addDebugText( const std::string& text ) = 0;
 
     virtual const LLUUID&   getID() const = 0;
@@ -155,6 +162,11 @@ public:
     enum e_update_t { NORMAL_UPDATE, HIDDEN_UPDATE, FORCE_UPDATE };
     void updateMotions(e_update_t update_type);
 
+    // NORMAL_UPDATE split up for LLMotionController::updateMotionsParallel().
+    // Returns false if the update was done right here instead, otherwise
+    // the caller must finish it with getMotionController().finishParallelUpdate()
+    bool beginParallelMotionsUpdate();
+
     LLAnimPauseRequest requestPause();
     bool areAnimationsPaused() const { return mMotionController.isPaused(); }
     void setAnimTimeFactor(F32 factor) { mMotionController.setTimeFactor(factor); }
@@ -290,6 +302,8 @@ protected:
     U32                 mAppearanceSerialNum;
     U32                 mSkeletonSerialNum;
     LLAnimPauseRequest  mPauseRequest;
+    bool                mDeferVisualParamsUpdate;
+    bool                mVisualParamsUpdateDeferred;
 
 private:
     // visual parameter stuff
@@ -0,0 +1,243 @@
+/**
+ * @file llcharacterupdatescheduler.cpp
+ * @brief Per frame budget for the full updates of animated characters.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+//-----------------------------------------------------------------------------
+// Header Files
+//-----------------------------------------------------------------------------
+#include "linden_common.h"
+
+#include "llcharacterupdatescheduler.h"
+
+#include <algorithm>
+
+#include "lltrace.h"
+
+static LLTrace::EventStatHandle<F64Milliseconds> sUpdateCost("characterupdatecost", "Time of the full update of one character");
+static LLTrace::CountStatHandle<> sUpdatesDeferred("characterupdatesdeferred", "Character updates put off by the update budget");
+static LLTrace::SampleStatHandle<F64Milliseconds> sPlannedCost("characterupdateplanned", "Estimated time of the character updates planned for a frame");
+
+namespace
+{
+    // Weight of the last measurement in the running averages
+    const F64 COST_SMOOTHING = 0.25;
+    const F64 AVERAGE_COST_SMOOTHING = 0.05;
+
+    // Characters that stopped asking are dropped after this many frames
+    const U32 FORGET_FRAMES = 256;
+
+    // Priority boost of a character the user is chatting with
+    const F32 CHATTING_WEIGHT = 4.f;
+
+    const U32 URGENT_INTEREST = LLCharacterUpdateScheduler::INTEREST_SELECTED | LLCharacterUpdateScheduler::INTEREST_FOCUS;
+}
+
+//-----------------------------------------------------------------------------
+// LLCharacterUpdateScheduler()
+//-----------------------------------------------------------------------------
+LLCharacterUpdateScheduler::LLCharacterUpdateScheduler()
+:   mBudget(0.0),
+    mAverageCost(0.0),
+    mHasAverageCost(false),
+    mPlannedCost(0.0),
+    mUnplannedCost(0.0),
+    mGrantedCost(0.0),
+    mMaxDeferredFrames(16),
+    mFrame(1),  // characters start out as neither asked nor planned
+    mNumGranted(0),
+    mNumDeferred(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+// beginFrame()
+//-----------------------------------------------------------------------------
+void LLCharacterUpdateScheduler::beginFrame()
+{
+    LL_PROFILE_ZONE_SCOPED;
+    const U32 last_frame = mFrame++;
+    mPlannedCost = F64Seconds(0.0);
+    mUnplannedCost = F64Seconds(0.0);
+    mGrantedCost = F64Seconds(0.0);
+    mNumGranted = 0;
+    mNumDeferred = 0;
+
+    mQueue.clear();
+    for (auto iter = mCharacters.begin(); iter != mCharacters.end();)
+    {
+        Character& character = iter->second;
+        if (character.mRequestFrame + FORGET_FRAMES < mFrame)
+        {
+            iter = mCharacters.erase(iter);
+            continue;
+        }
+        if (mBudget > F64Seconds(0.0) && character.mRequestFrame == last_frame)
+        {
+            // the longer a character waits, the more it counts
+            mQueue.emplace_back(character.mWeight * (F32)(character.mDeferredFrames + 1), &character);
+        }
+        ++iter;
+    }
+
+    std::sort(mQueue.begin(), mQueue.end(),
+              [](const std::pair<F32, Character*>& a, const std::pair<F32, Character*>& b)
+              {
+                  return a.first > b.first;
+              });
+
+    // Greedy, a character that doesn't fit leaves the rest of the budget to
+    // cheaper ones further down
+    for (const auto& entry : mQueue)
+    {
+        Character& character = *entry.second;
+        const F64Seconds cost = estimateCost(character);
+        character.mPlanFrame = mFrame;
+        character.mPlanned = mustUpdate(character) || mPlannedCost + cost <= mBudget;
+        if (character.mPlanned)
+        {
+            mPlannedCost += cost;
+        }
+    }
+    mQueue.clear();
+
+    sample(sPlannedCost, mPlannedCost);
+}
+
+//-----------------------------------------------------------------------------
+// requestUpdate()
+//-----------------------------------------------------------------------------
+bool LLCharacterUpdateScheduler::requestUpdate(const LLUUID& id, F32 pixel_area, U32 interest)
+{
+    Character& character = mCharacters[id];
+    character.mWeight = llmax(pixel_area, 1.f);
+    if (interest & INTEREST_CHATTING)
+    {
+        character.mWeight *= CHATTING_WEIGHT;
+    }
+    character.mUrgent = (interest & URGENT_INTEREST) != 0;
+    character.mRequestFrame = mFrame;
+
+    const F64Seconds cost = estimateCost(character);
+    bool granted = true;
+    if (mBudget > F64Seconds(0.0))
+    {
+        if (character.mPlanFrame == mFrame)
+        {
+            // the plan went by last frame's urgency
+            granted = character.mPlanned || mustUpdate(character);
+            if (granted && !character.mPlanned)
+            {
+                mUnplannedCost += cost;
+            }
+        }
+        else if (!mustUpdate(character))
+        {
+            // what the plan left over
+            granted = mPlannedCost + mUnplannedCost + cost <= mBudget;
+            if (granted)
+            {
+                mUnplannedCost += cost;
+            }
+        }
+        // only one update per plan
+        character.mPlanned = false;
+    }
+
+    if (granted)
+    {
+        character.mDeferredFrames = 0;
+        mGrantedCost += cost;
+        mNumGranted++;
+    }
+    else
+    {
+        character.mDeferredFrames++;
+        mNumDeferred++;
+        add(sUpdatesDeferred, 1);
+    }
+    return granted;
+}
+
+//-----------------------------------------------------------------------------
+// recordUpdate()
+//-----------------------------------------------------------------------------
+void LLCharacterUpdateScheduler::recordUpdate(const LLUUID& id, F64Seconds cost)
+{
+    record(sUpdateCost, cost);
+
+    Character& character = mCharacters[id];
+    if (character.mHasCost)
+    {
+        character.mCost += (cost - character.mCost) * COST_SMOOTHING;
+    }
+    else
+    {
+        character.mCost = cost;
+        character.mHasCost = true;
+    }
+
+    if (mHasAverageCost)
+    {
+        mAverageCost += (cost - mAverageCost) * AVERAGE_COST_SMOOTHING;
+    }
+    else
+    {
+        mAverageCost = cost;
+        mHasAverageCost = true;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// removeCharacter()
+//-----------------------------------------------------------------------------
+void LLCharacterUpdateScheduler::removeCharacter(const LLUUID& id)
+{
+    mCharacters.erase(id);
+}
+
+//-----------------------------------------------------------------------------
+// getUpdateCost()
+//-----------------------------------------------------------------------------
+F64Seconds LLCharacterUpdateScheduler::getUpdateCost(const LLUUID& id) const
+{
+    auto found = mCharacters.find(id);
+    return found != mCharacters.end() ? found->second.mCost : F64Seconds(0.0);
+}
+
+//-----------------------------------------------------------------------------
+// estimateCost()
+//-----------------------------------------------------------------------------
+F64Seconds LLCharacterUpdateScheduler::estimateCost(const Character& character) const
+{
+    return character.mHasCost ? character.mCost : mAverageCost;
+}
+
+//-----------------------------------------------------------------------------
+// mustUpdate()
+//-----------------------------------------------------------------------------
+bool LLCharacterUpdateScheduler::mustUpdate(const Character& character) const
+{
+    return character.mUrgent || character.mDeferredFrames >= mMaxDeferredFrames;
+}
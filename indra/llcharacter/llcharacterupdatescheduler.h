@@ -0,0 +1,125 @@
+/**
+ * @file llcharacterupdatescheduler.h
+ * @brief Per frame budget for the full updates of animated characters.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLCHARACTERUPDATESCHEDULER_H
+#define LL_LLCHARACTERUPDATESCHEDULER_H
+
+#include <unordered_map>
+#include <vector>
+
+#include "llunits.h"
+#include "lluuid.h"
+
+//-----------------------------------------------------------------------------
+// class LLCharacterUpdateScheduler
+//
+// Shares a per frame time budget between the characters that are due for a
+// full update (visual params, attachments, animation).  Each frame the
+// characters that asked during the last frame are planned by priority,
+// their screen area raised by what the user is doing with them and by how
+// long they have waited, until the estimated cost fills the budget.  The
+// others are put off to a later frame, but never for more than
+// getMaxDeferredFrames() frames.  Costs are running averages of the times
+// reported through recordUpdate(), which also go to LLTrace.
+//
+// Main thread only.
+//-----------------------------------------------------------------------------
+class LLCharacterUpdateScheduler
+{
+public:
+    // What the user is doing with a character.  Chatting raises its
+    // priority, selected characters and the camera focus are never put off.
+    enum EInterest
+    {
+        INTEREST_NONE       = 0,
+        INTEREST_CHATTING   = 1 << 0,   // typing or speaking
+        INTEREST_SELECTED   = 1 << 1,   // it or one of its attachments
+        INTEREST_FOCUS      = 1 << 2    // the camera focus
+    };
+
+    LLCharacterUpdateScheduler();
+
+    // Time of full updates allowed per frame, 0 for no limit
+    void setBudget(F64Seconds budget) { mBudget = budget; }
+    F64Seconds getBudget() const { return mBudget; }
+
+    void setMaxDeferredFrames(U32 frames) { mMaxDeferredFrames = frames; }
+    U32 getMaxDeferredFrames() const { return mMaxDeferredFrames; }
+
+    // Starts a frame, planning its updates from the last frame's requests
+    void beginFrame();
+
+    // A character is due for a full update, returns whether it gets one
+    // this frame.  Characters that didn't ask last frame get one if what is
+    // left of the budget allows, a character that is put off should ask
+    // again next frame.
+    bool requestUpdate(const LLUUID& id, F32 pixel_area, U32 interest);
+
+    // Time the full update of a character took
+    void recordUpdate(const LLUUID& id, F64Seconds cost);
+
+    void removeCharacter(const LLUUID& id);
+
+    // Running average of the full updates of a character, 0 if unknown
+    F64Seconds getUpdateCost(const LLUUID& id) const;
+
+    // Estimated time of the updates granted this frame so far
+    F64Seconds getGrantedCost() const { return mGrantedCost; }
+    // Characters granted or put off this frame so far
+    U32 getNumGranted() const { return mNumGranted; }
+    U32 getNumDeferred() const { return mNumDeferred; }
+
+private:
+    struct Character
+    {
+        F64Seconds  mCost;
+        bool        mHasCost = false;
+        F32         mWeight = 0.f;          // of the last request
+        bool        mUrgent = false;        // of the last request, never put off
+        U32         mDeferredFrames = 0;    // since the last full update
+        U32         mRequestFrame = 0;      // last frame it asked
+        U32         mPlanFrame = 0;         // last frame it was planned in
+        bool        mPlanned = false;       // granted in mPlanFrame
+    };
+
+    F64Seconds estimateCost(const Character& character) const;
+    bool mustUpdate(const Character& character) const;
+
+    std::unordered_map<LLUUID, Character> mCharacters;
+    std::vector<std::pair<F32, Character*> > mQueue;   // scratch for beginFrame()
+    F64Seconds  mBudget;
+    F64Seconds  mAverageCost;       // of all characters, for the unknown ones
+    bool        mHasAverageCost;
+    F64Seconds  mPlannedCost;       // of the characters planned this frame
+    F64Seconds  mUnplannedCost;     // of the others granted this frame
+    F64Seconds  mGrantedCost;
+    U32         mMaxDeferredFrames;
+    U32         mFrame;
+    U32         mNumGranted;
+    U32         mNumDeferred;
+};
+
+#endif // LL_LLCHARACTERUPDATESCHEDULER_H
@@ -0,0 +1,291 @@
+/**
+ * @file llflatskeleton.cpp
+ * @brief Joint hierarchy flattened for a linear world matrix update.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+//-----------------------------------------------------------------------------
+// Header Files
+//-----------------------------------------------------------------------------
+#include "linden_common.h"
+
+#include "llflatskeleton.h"
+
+#include "lljoint.h"
+#include "llmatrix4a.h"
+
+namespace
+{
+    template <int X, int Y, int Z, int W>
+    inline LLVector4a swizzle(const LLVector4a& v)
+    {
+        LLQuad q = v;
+        return LLVector4a(_mm_shuffle_ps(q, q, _MM_SHUFFLE(W, Z, Y, X)));
+    }
+
+    // Same operations in the same order as operator*(LLQuaternion, LLQuaternion),
+    // a is the local rotation and b the parent's world rotation
+    inline LLVector4a quat_mul(const LLVector4a& a, const LLVector4a& b, const LLVector4a& flip_w)
+    {
+        LLVector4a result, t;
+        result.splat<3>(b);
+        result.mul(a);
+        t.setMul(swizzle<0, 1, 2, 0>(b), flip_w);
+        t.mul(swizzle<3, 3, 3, 0>(a));
+        result.add(t);
+        t.setMul(swizzle<1, 2, 0, 1>(b), flip_w);
+        t.mul(swizzle<2, 0, 1, 1>(a));
+        result.add(t);
+        t.setMul(swizzle<2, 0, 1, 2>(b), swizzle<1, 2, 0, 2>(a));
+        result.sub(t);
+        return result;
+    }
+
+    // Same as operator*(LLVector3, LLQuaternion), the w of the result is
+    // undefined
+    inline LLVector4a quat_rotate(const LLVector4a& v, const LLVector4a& q, const LLVector4a& flip_w)
+    {
+        // r = (rx, ry, rz, rw)
+        LLVector4a r, t;
+        r.setMul(swizzle<3, 3, 3, 0>(q), flip_w);
+        r.mul(swizzle<0, 1, 2, 0>(v));
+        t.setMul(swizzle<1, 2, 0, 1>(q), flip_w);
+        t.mul(swizzle<2, 0, 1, 1>(v));
+        r.add(t);
+        t.setMul(swizzle<2, 0, 1, 2>(q), swizzle<1, 2, 0, 2>(v));
+        r.sub(t);
+
+        LLVector4a result;
+        result.splat<3>(r);
+        result.mul(LLVector4a(-1.f));
+        result.mul(q);
+        t.splat<3>(q);
+        t.mul(r);
+        result.add(t);
+        t.setMul(swizzle<1, 2, 0, 3>(r), swizzle<2, 0, 1, 3>(q));
+        result.sub(t);
+        t.setMul(swizzle<2, 0, 1, 3>(r), swizzle<1, 2, 0, 3>(q));
+        result.add(t);
+        return result;
+    }
+
+    // Same as LLMatrix4::initAll(scale, q, pos)
+    inline void init_matrix(LLMatrix4a& mat, const LLVector4a& scale, const LLVector4a& q, const LLVector4a& pos)
+    {
+        const LLVector4a two(2.f);
+        LLVector4a row, a, b;
+
+        // 1 - 2(yy + zz), 2(xy + zw), 2(xz - yw)
+        a.setMul(swizzle<1, 0, 0, 3>(q), swizzle<1, 1, 2, 3>(q));
+        a.mul(LLVector4a(-1.f, 1.f, 1.f, 0.f));
+        b.setMul(swizzle<2, 2, 1, 3>(q), swizzle<2, 3, 3, 3>(q));
+        b.mul(LLVector4a(-1.f, 1.f, -1.f, 0.f));
+        a.add(b);
+        a.mul(two);
+        row.setAdd(LLVector4a(1.f, 0.f, 0.f, 0.f), a);
+        b.splat<0>(scale);
+        mat.mMatrix[0].setMul(row, b);
+
+        // 2(xy - zw), 1 - 2(xx + zz), 2(yz + xw)
+        a.setMul(swizzle<0, 0, 1, 3>(q), swizzle<1, 0, 2, 3>(q));
+        a.mul(LLVector4a(1.f, -1.f, 1.f, 0.f));
+        b.setMul(swizzle<2, 2, 0, 3>(q), swizzle<3, 2, 3, 3>(q));
+        b.mul(LLVector4a(-1.f, -1.f, 1.f, 0.f));
+        a.add(b);
+        a.mul(two);
+        row.setAdd(LLVector4a(0.f, 1.f, 0.f, 0.f), a);
+        b.splat<1>(scale);
+        mat.mMatrix[1].setMul(row, b);
+
+        // 2(xz + yw), 2(yz - xw), 1 - 2(xx + yy)
+        a.setMul(swizzle<0, 1, 0, 3>(q), swizzle<2, 2, 0, 3>(q));
+        a.mul(LLVector4a(1.f, 1.f, -1.f, 0.f));
+        b.setMul(swizzle<1, 0, 1, 3>(q), swizzle<3, 3, 1, 3>(q));
+        b.mul(LLVector4a(1.f, -1.f, -1.f, 0.f));
+        a.add(b);
+        a.mul(two);
+        row.setAdd(LLVector4a(0.f, 0.f, 1.f, 0.f), a);
+        b.splat<2>(scale);
+        mat.mMatrix[2].setMul(row, b);
+
+        LLVector4Logical w_mask;
+        w_mask.clear();
+        w_mask.setElement<3>();
+        mat.mMatrix[3].setSelectWithMask(w_mask, LLVector4a(1.f), pos);
+    }
+}
+
+LLFlatSkeleton::LLFlatSkeleton() :
+    mRoot(NULL),
+    mSerial(0)
+{
+}
+
+void LLFlatSkeleton::clear()
+{
+    mRoot = NULL;
+    mSerial = 0;
+    mEntries.clear();
+    mWorldRotations.clear();
+    mWorldPositions.clear();
+    mJointIndex.clear();
+}
+
+bool LLFlatSkeleton::isCurrent(const LLJoint* root) const
+{
+    return root && root == mRoot && root->getHierarchySerial() == mSerial;
+}
+
+LLJoint* LLFlatSkeleton::getJoint(S32 joint_num) const
+{
+    if (joint_num < 0 || joint_num >= (S32)mJointIndex.size() || !isCurrent(mRoot))
+    {
+        return NULL;
+    }
+    S32 index = mJointIndex[joint_num];
+    return index < 0 ? NULL : mEntries[index].mJoint;
+}
+
+void LLFlatSkeleton::rebuild(LLJoint* root)
+{
+    clear();
+    mRoot = root;
+    mSerial = root->getHierarchySerial();
+    addJoint(root, -1);
+
+    const S32 count = (S32)mEntries.size();
+    mWorldRotations.resize(count);
+    mWorldPositions.resize(count);
+    for (S32 i = 0; i < count; ++i)
+    {
+        const S32 joint_num = mEntries[i].mJoint->getJointNum();
+        if (joint_num < 0)
+        {
+            continue;
+        }
+        if (joint_num >= (S32)mJointIndex.size())
+        {
+            mJointIndex.resize(joint_num + 1, -1);
+        }
+        if (mJointIndex[joint_num] < 0)
+        {
+            mJointIndex[joint_num] = i;
+        }
+    }
+}
+
+void LLFlatSkeleton::addJoint(LLJoint* joint, S32 parent)
+{
+    const S32 index = (S32)mEntries.size();
+    mEntries.push_back({ joint, parent, 0 });
+    for (LLJoint* child : joint->mChildren)
+    {
+        addJoint(child, index);
+    }
+    mEntries[index].mSubtreeEnd = (S32)mEntries.size();
+}
+
+void LLFlatSkeleton::updateWorldMatrices(LLJoint* root)
+{
+    LL_PROFILE_ZONE_SCOPED;
+
+    if (!root)
+    {
+        return;
+    }
+    if (!isCurrent(root))
+    {
+        rebuild(root);
+    }
+
+    const LLVector4a flip_w(1.f, 1.f, 1.f, -1.f);
+    const S32 count = (S32)mEntries.size();
+    S32 updated = 0;
+
+    LL_ALIGN_16(LLMatrix4a mat);
+    LLVector4a world_rot, world_pos, local, scale;
+
+    S32 i = 0;
+    while (i < count)
+    {
+        const Entry& entry = mEntries[i];
+        LLJoint* joint = entry.mJoint;
+        if (!joint->mUpdateXform)
+        {
+            // like updateWorldMatrixChildren(), skip the whole subtree
+            i = entry.mSubtreeEnd;
+            continue;
+        }
+
+        LLXformMatrix* xform = joint->getXform();
+        if (joint->mDirtyFlags & LLJoint::MATRIX_DIRTY)
+        {
+            if (entry.mParent < 0)
+            {
+                // the root keeps any parent it has outside of the hierarchy
+                joint->updateWorldMatrix();
+                mWorldRotations[i].loadua(xform->getWorldRotation().mQ);
+                mWorldPositions[i].load3(xform->getWorldPosition().mV);
+                ++i;
+                continue;
+            }
+
+            LLXformMatrix* parent_xform = mEntries[entry.mParent].mJoint->getXform();
+            const LLVector4a& parent_rot = mWorldRotations[entry.mParent];
+
+            local.load3(xform->getPosition().mV);
+            if (parent_xform->getScaleChildOffset())
+            {
+                scale.load3(parent_xform->getScale().mV);
+                local.mul(scale);
+            }
+            world_pos = quat_rotate(local, parent_rot, flip_w);
+            world_pos.add(mWorldPositions[entry.mParent]);
+
+            local.loadua(xform->getRotation().mQ);
+            world_rot = quat_mul(local, parent_rot, flip_w);
+
+            scale.load3(xform->getScale().mV);
+            init_matrix(mat, scale, world_rot, world_pos);
+
+            const F32* rot = world_rot.getF32ptr();
+            joint->setWorldTransform(LLVector3(world_pos.getF32ptr()),
+                                     LLQuaternion(rot[VX], rot[VY], rot[VZ], rot[VW]),
+                                     mat);
+            mWorldRotations[i] = world_rot;
+            mWorldPositions[i] = world_pos;
+            ++updated;
+        }
+        else
+        {
+            mWorldRotations[i].loadua(xform->getWorldRotation().mQ);
+            mWorldPositions[i].load3(xform->getWorldPosition().mV);
+        }
+        ++i;
+    }
+
+    if (updated)
+    {
+        LLJoint::sNumUpdates.fetch_add(updated, std::memory_order_relaxed);
+    }
+}
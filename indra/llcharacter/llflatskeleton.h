@@ -0,0 +1,85 @@
+/**
+ * @file llflatskeleton.h
+ * @brief Joint hierarchy flattened for a linear world matrix update.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLFLATSKELETON_H
+#define LL_LLFLATSKELETON_H
+
+#include <vector>
+
+#include "llmath.h"
+#include "llvector4a.h"
+
+class LLJoint;
+
+//-----------------------------------------------------------------------------
+// class LLFlatSkeleton
+//
+// A joint hierarchy flattened into depth first order.  Parents come before
+// their children, so the world transforms of the whole hierarchy can be
+// computed in one pass over the array instead of recursing through
+// LLJoint::mChildren, with the parents' world rotations and positions kept
+// in contiguous arrays.  The order is rebuilt whenever the root's
+// LLJoint::getHierarchySerial() changes.
+//
+// The root has to outlive the flat skeleton, or clear() be called first.
+//-----------------------------------------------------------------------------
+class LLFlatSkeleton
+{
+public:
+    LLFlatSkeleton();
+
+    // Brings the world matrices of every joint under root up to date,
+    // with the same results as root->updateWorldMatrixChildren()
+    void updateWorldMatrices(LLJoint* root);
+
+    // Joint with the given joint number, or NULL if there is none or the
+    // hierarchy changed since the last updateWorldMatrices()
+    LLJoint* getJoint(S32 joint_num) const;
+
+    bool isCurrent(const LLJoint* root) const;
+    S32 getNumJoints() const { return (S32)mEntries.size(); }
+    void clear();
+
+private:
+    void rebuild(LLJoint* root);
+    void addJoint(LLJoint* joint, S32 parent);
+
+    struct Entry
+    {
+        LLJoint* mJoint;
+        S32 mParent;        // index of the parent, -1 for the root
+        S32 mSubtreeEnd;    // index past the last descendant
+    };
+
+    LLJoint* mRoot;
+    U32 mSerial;
+    std::vector<Entry> mEntries;
+    std::vector<LLVector4a> mWorldRotations;
+    std::vector<LLVector4a> mWorldPositions;
+    std::vector<S32> mJointIndex;   // entry index by joint number, -1 if none
+};
+
+#endif // LL_LLFLATSKELETON_H
@@ -153,7 +153,7 @@ bool LLHandMotion::onUpdate(F32 time, U8* joint_mask)
             // Update visual params now if we won't blend
             if (mCurrentPose == HAND_POSE_RELAXED)
             {
-                mCharacter->updateVisualParams();
+                mCharacter->requestVisualParamsUpdate();
             }
         }
         mNewPose = HAND_POSE_RELAXED;
@@ -186,7 +186,7 @@ bool LLHandMotion::onUpdate(F32 time, U8* joint_mask)
                 // Update visual params now if we won't blend
                 if (mCurrentPose == *requestedHandPose)
                 {
-                    mCharacter->updateVisualParams();
+                    mCharacter->requestVisualParamsUpdate();
                 }
             }
             mNewPose = *requestedHandPose;
@@ -225,7 +225,7 @@ bool LLHandMotion::onUpdate(F32 time, U8* joint_mask)
             mCharacter->setVisualParamWeight(gHandPoseNames[mCurrentPose], outgoingWeight);
         }
 
-        mCharacter->updateVisualParams();
+        mCharacter->requestVisualParamsUpdate();
 
         if (incomingWeight == 1.f && outgoingWeight == 0.f)
         {
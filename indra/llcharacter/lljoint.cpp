@@ -34,8 +34,9 @@
 #include "llmath.h"
 #include <boost/algorithm/string.hpp>
 
-S32 LLJoint::sNumUpdates = 0;
-S32 LLJoint::sNumTouches = 0;
+std::atomic<S32> LLJoint::sNumUpdates(0);
+std::atomic<S32> LLJoint::sNumTouches(0);
+std::atomic<U32> LLJoint::sHierarchySerial(0);
 
 template <class T>
 bool attachment_map_iter_compare_key(const T& a, const T& b)
@@ -104,6 +105,7 @@ void LLJoint::init()
 {
     mName = "unnamed";
     mParent = NULL;
+    mHierarchySerial = ++sHierarchySerial;
     mXform.setScaleChildOffset(true);
     mXform.setScale(LLVector3(1.0f, 1.0f, 1.0f));
     mDirtyFlags = MATRIX_DIRTY | ROTATION_DIRTY | POSITION_DIRTY;
@@ -199,7 +201,7 @@ void LLJoint::touch(U32 flags)
 {
     if ((flags | mDirtyFlags) != mDirtyFlags)
     {
-        sNumTouches++;
+        sNumTouches.fetch_add(1, std::memory_order_relaxed);
         mDirtyFlags |= flags;
         U32 child_flags = flags;
         if (flags & ROTATION_DIRTY)
@@ -220,6 +222,7 @@ void LLJoint::touch(U32 flags)
 void LLJoint::setJointNum(S32 joint_num)
 {
     mJointNum = joint_num;
+    hierarchyChanged();
     if (mJointNum + 2 >= LL_CHARACTER_MAX_ANIMATED_JOINTS)
     {
         LL_INFOS() << "LL_CHARACTER_MAX_ANIMATED_JOINTS needs to be increased" << LL_ENDL;
@@ -272,6 +275,7 @@ void LLJoint::addChild(LLJoint* joint)
     joint->mXform.setParent(&mXform);
     joint->mParent = this;
     joint->touch();
+    hierarchyChanged();
 }
 
 
@@ -288,6 +292,7 @@ void LLJoint::removeChild(LLJoint* joint)
         joint->mXform.setParent(NULL);
         joint->mParent = NULL;
         joint->touch();
+        hierarchyChanged();
     }
 }
 
@@ -307,7 +312,24 @@ void LLJoint::removeAllChildren()
             //delete joint;
         }
     }
-    mChildren.clear();
+    if (!mChildren.empty())
+    {
+        mChildren.clear();
+        hierarchyChanged();
+    }
+}
+
+
+//--------------------------------------------------------------------
+// hierarchyChanged()
+//--------------------------------------------------------------------
+void LLJoint::hierarchyChanged()
+{
+    U32 serial = ++sHierarchySerial;
+    for (LLJoint* joint = this; joint; joint = joint->mParent)
+    {
+        joint->mHierarchySerial = serial;
+    }
 }
 
 
@@ -975,6 +997,16 @@ void LLJoint::updateWorldMatrixChildren()
     }
 }
 
+//-----------------------------------------------------------------------------
+// setWorldTransform()
+//-----------------------------------------------------------------------------
+void LLJoint::setWorldTransform(const LLVector3& pos, const LLQuaternion& rot, const LLMatrix4a& mat)
+{
+    mXform.setWorldTransform(pos, rot, mat.asMatrix4());
+    mWorldMatrix = mat;
+    mDirtyFlags = 0x0;
+}
+
 //-----------------------------------------------------------------------------
 // updateWorldMatrix()
 //-----------------------------------------------------------------------------
@@ -982,7 +1014,7 @@ void LLJoint::updateWorldMatrix()
 {
     if (mDirtyFlags & MATRIX_DIRTY)
     {
-        sNumUpdates++;
+        sNumUpdates.fetch_add(1, std::memory_order_relaxed);
         mXform.updateMatrix(false);
         mWorldMatrix.loadu(mXform.getWorldMatrix());
         mDirtyFlags = 0x0;
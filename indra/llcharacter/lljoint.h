@@ -30,6 +30,7 @@
 //-----------------------------------------------------------------------------
 // Header Files
 //-----------------------------------------------------------------------------
+#include <atomic>
 #include <string>
 #include <list>
 
@@ -128,6 +129,11 @@ protected:
     // parent joint
     LLJoint *mParent;
 
+    // see getHierarchySerial()
+    U32 mHierarchySerial;
+    static std::atomic<U32> sHierarchySerial;
+    void hierarchyChanged();
+
     LLVector3       mDefaultPosition;
     LLVector3       mDefaultScale;
 
@@ -148,9 +154,10 @@ public:
     typedef std::vector<LLJoint*> joints_t;
     joints_t mChildren;
 
-    // debug statics
-    static S32      sNumTouches;
-    static S32      sNumUpdates;
+    // debug statics, joints of different characters may be touched on
+    // different threads
+    static std::atomic<S32> sNumTouches;
+    static std::atomic<S32> sNumUpdates;
     typedef std::set<std::string> debug_joint_name_t;
     static debug_joint_name_t s_debugJointNames;
     static void setDebugJointNames(const debug_joint_name_t& names);
@@ -265,6 +272,16 @@ public:
 
     const LLMatrix4a& getWorldMatrix4a();
 
+    // Stores a world transform computed outside of updateWorldMatrix() and
+    // clears the dirty flags, as updateWorldMatrix() would.  Does not count
+    // towards sNumUpdates, see LLFlatSkeleton.
+    void setWorldTransform(const LLVector3& pos, const LLQuaternion& rot, const LLMatrix4a& mat);
+
+    // Changes whenever a joint is added or removed anywhere below this joint
+    // or a joint number changes, so it is meaningful on the root of the
+    // hierarchy.  Values are never reused, not even by other joints.
+    U32 getHierarchySerial() const { return mHierarchySerial; }
+
     void updateWorldMatrixChildren();
     void updateWorldMatrixParent();
 
@@ -39,14 +39,18 @@
 #include "llendianswizzle.h"
 #include "llkeyframemotion.h"
 #include "llquantize.h"
+#include "llvector4a.h"
 #include "m3math.h"
 #include "message.h"
 #include "llfilesystem.h"
+#include "workqueue.h"
 
 //-----------------------------------------------------------------------------
 // Static Definitions
 //-----------------------------------------------------------------------------
 LLKeyframeDataCache::keyframe_data_map_t    LLKeyframeDataCache::sKeyframeDataMap;
+LLKeyframeMotion::asset_load_map_t          LLKeyframeMotion::sAssetLoads;
+std::string                                 LLKeyframeMotion::sDecodeQueue;
 
 //-----------------------------------------------------------------------------
 // Globals
@@ -87,8 +91,6 @@ LLKeyframeMotion::JointMotionList::~JointMotionList()
 
 U32 LLKeyframeMotion::JointMotionList::dumpDiagInfo()
 {
-    S32 total_size = sizeof(JointMotionList);
-
     for (U32 i = 0; i < getNumJointMotions(); i++)
     {
         LLKeyframeMotion::JointMotion* joint_motion_p = mJointMotionArray[i];
@@ -98,27 +100,391 @@ U32 LLKeyframeMotion::JointMotionList::dumpDiagInfo()
         {
             LL_INFOS() << "\t" << joint_motion_p->mScaleCurve.mNumKeys << " scale keys at "
             << joint_motion_p->mScaleCurve.mNumKeys * sizeof(ScaleKey) << " bytes" << LL_ENDL;
+        }
+        if ((joint_motion_p->mUsage & LLJointState::ROT) && i < mRotationRanges.size())
+        {
+            LL_INFOS() << "\t" << mRotationRanges[i].mCount << " rotation keys at "
+            << mRotationRanges[i].mCount * (sizeof(F32) + 4 * sizeof(U16)) << " bytes" << LL_ENDL;
+        }
+        if ((joint_motion_p->mUsage & LLJointState::POS) && i < mPositionRanges.size())
+        {
+            LL_INFOS() << "\t" << mPositionRanges[i].mCount << " position keys at "
+            << mPositionRanges[i].mCount * (sizeof(F32) + 4 * sizeof(U16)) << " bytes" << LL_ENDL;
+        }
+    }
+
+    U32 total_size = getMemoryUsage();
+    LL_INFOS() << "Size: " << total_size << " bytes" << LL_ENDL;
 
-            total_size += joint_motion_p->mScaleCurve.mNumKeys * sizeof(ScaleKey);
+    return total_size;
+}
+
+U32 LLKeyframeMotion::JointMotionList::getMemoryUsage() const
+{
+    size_t total_size = sizeof(JointMotionList);
+    for (const JointMotion* joint_motion_p : mJointMotionArray)
+    {
+        total_size += sizeof(JointMotion) + joint_motion_p->mScaleCurve.mKeys.size() * sizeof(ScaleKey);
+    }
+    total_size += mJointMotionArray.capacity() * sizeof(JointMotion*);
+    total_size += (mRotationRanges.capacity() + mPositionRanges.capacity()) * sizeof(KeyRange);
+    total_size += (mRotationTimes.capacity() + mPositionTimes.capacity()) * sizeof(F32);
+    total_size += (mRotationKeys.capacity() + mPositionKeys.capacity()) * sizeof(U16);
+    return (U32)total_size;
+}
+
+//-----------------------------------------------------------------------------
+// packKeys()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::JointMotionList::packKeys()
+{
+    size_t num_rot_keys = 0;
+    size_t num_pos_keys = 0;
+    for (const JointMotion* joint_motion : mJointMotionArray)
+    {
+        num_rot_keys += joint_motion->mRotationCurve.mKeys.size();
+        num_pos_keys += joint_motion->mPositionCurve.mKeys.size();
+    }
+
+    mRotationRanges.assign(mJointMotionArray.size(), KeyRange());
+    mPositionRanges.assign(mJointMotionArray.size(), KeyRange());
+    mRotationTimes.clear();
+    mRotationTimes.reserve(num_rot_keys);
+    mRotationKeys.clear();
+    mRotationKeys.reserve(num_rot_keys * 4);
+    mPositionTimes.clear();
+    mPositionTimes.reserve(num_pos_keys);
+    mPositionKeys.clear();
+    mPositionKeys.reserve(num_pos_keys * 4);
+
+    for (size_t i = 0; i < mJointMotionArray.size(); i++)
+    {
+        JointMotion* joint_motion = mJointMotionArray[i];
+
+        // the maps are keyed by time, so the keys come out sorted and
+        // without duplicates
+        RotationCurve& rot_curve = joint_motion->mRotationCurve;
+        mRotationRanges[i].mFirst = (U32)mRotationTimes.size();
+        mRotationRanges[i].mCount = (U32)rot_curve.mKeys.size();
+        for (RotationCurve::key_map_t::value_type& rot_pair : rot_curve.mKeys)
+        {
+            // round rather than truncate so that keys read from an asset
+            // quantize back to the values the asset had
+            LLVector3 rot_vec = rot_pair.second.mRotation.packToVector3();
+            mRotationTimes.push_back(rot_pair.first);
+            mRotationKeys.push_back(F32_to_U16_ROUND(rot_vec.mV[VX], -1.f, 1.f));
+            mRotationKeys.push_back(F32_to_U16_ROUND(rot_vec.mV[VY], -1.f, 1.f));
+            mRotationKeys.push_back(F32_to_U16_ROUND(rot_vec.mV[VZ], -1.f, 1.f));
+            mRotationKeys.push_back(0);
+        }
+        rot_curve.mKeys.clear();
+
+        PositionCurve& pos_curve = joint_motion->mPositionCurve;
+        mPositionRanges[i].mFirst = (U32)mPositionTimes.size();
+        mPositionRanges[i].mCount = (U32)pos_curve.mKeys.size();
+        for (PositionCurve::key_map_t::value_type& pos_pair : pos_curve.mKeys)
+        {
+            const LLVector3& pos = pos_pair.second.mPosition;
+            mPositionTimes.push_back(pos_pair.first);
+            mPositionKeys.push_back(F32_to_U16_ROUND(pos.mV[VX], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET));
+            mPositionKeys.push_back(F32_to_U16_ROUND(pos.mV[VY], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET));
+            mPositionKeys.push_back(F32_to_U16_ROUND(pos.mV[VZ], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET));
+            mPositionKeys.push_back(0);
+        }
+        pos_curve.mKeys.clear();
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Packed key sampling
+//-----------------------------------------------------------------------------
+
+// Index of the last key at or before time, or 0 if time is before the
+// first key.  Playback mostly moves forward by a key or so per frame, so
+// start from where the previous call ended up.
+static inline U32 find_key(const F32* times, U32 count, F32 time, U32& cursor)
+{
+    U32 key = cursor < count ? cursor : 0;
+    if (times[key] > time)
+    {
+        // looped or jumped back
+        key = (U32)(std::upper_bound(times, times + count, time) - times);
+        key = key ? key - 1 : 0;
+    }
+    else
+    {
+        const U32 max_scan = 4;
+        U32 scanned = 0;
+        while (key + 1 < count && times[key + 1] <= time && scanned < max_scan)
+        {
+            ++key;
+            ++scanned;
         }
-        if (joint_motion_p->mUsage & LLJointState::ROT)
+        if (scanned == max_scan && key + 1 < count && times[key + 1] <= time)
         {
-            LL_INFOS() << "\t" << joint_motion_p->mRotationCurve.mNumKeys << " rotation keys at "
-            << joint_motion_p->mRotationCurve.mNumKeys * sizeof(RotationKey) << " bytes" << LL_ENDL;
+            key = (U32)(std::upper_bound(times + key, times + count, time) - times) - 1;
+        }
+    }
+    cursor = key;
+    return key;
+}
 
-            total_size += joint_motion_p->mRotationCurve.mNumKeys * sizeof(RotationKey);
+// Finds the keys around time: the key before, the key after and the
+// interpolation factor between them.  Returns false when the value is
+// exactly the key before, which is also the case past either end.
+static inline bool find_keys(const F32* times, U32 count, F32 time, U32& cursor, U32& before, U32& after, F32& u)
+{
+    before = find_key(times, count, time, cursor);
+    if (before + 1 >= count || times[before] >= time)
+    {
+        return false;
+    }
+    after = before + 1;
+    u = (time - times[before]) / (times[after] - times[before]);
+    return true;
+}
+
+// U16_to_F32() on four values at once, including snapping values within
+// one step of zero to zero
+static inline LLVector4a dequantize(const __m128i& values, F32 lower, F32 upper)
+{
+    const F32 delta = upper - lower;
+    LLVector4a value(_mm_cvtepi32_ps(values));
+    value.mul(LLVector4a(OOU16MAX));
+    value.mul(LLVector4a(delta));
+    value.add(LLVector4a(lower));
+
+    LLVector4a magnitude;
+    magnitude.setAbs(value);
+    value.setSelectWithMask(magnitude.lessThan(LLVector4a(delta * OOU16MAX)), LLVector4a::getZero(), value);
+    return value;
+}
+
+// One component of four packed keys
+static inline __m128i gather_component(const U16* const* keys, S32 component)
+{
+    return _mm_set_epi32(keys[3][component], keys[2][component], keys[1][component], keys[0][component]);
+}
+
+// Rotation keys of four joints, one quaternion component per vector
+struct RotationLanes
+{
+    LLVector4a mX, mY, mZ, mW;
+
+    // LLQuaternion::unpackFromVector3() on four packed keys
+    void load(const U16* const* keys)
+    {
+        mX = dequantize(gather_component(keys, VX), -1.f, 1.f);
+        mY = dequantize(gather_component(keys, VY), -1.f, 1.f);
+        mZ = dequantize(gather_component(keys, VZ), -1.f, 1.f);
+
+        LLVector4a sq;
+        mW.setMul(mX, mX);
+        sq.setMul(mY, mY);
+        mW.add(sq);
+        sq.setMul(mZ, mZ);
+        mW.add(sq);
+        mW.setSub(LLVector4a(1.f), mW);
+        mW.setMax(mW, LLVector4a::getZero());
+        mW = _mm_sqrt_ps(mW);
+    }
+
+    LLQuaternion get(S32 lane) const
+    {
+        LLQuaternion rot;
+        rot.mQ[VX] = mX[lane];
+        rot.mQ[VY] = mY[lane];
+        rot.mQ[VZ] = mZ[lane];
+        rot.mQ[VW] = mW[lane];
+        return rot;
+    }
+};
+
+// RotationCurve::getValue() for four joints at once: nlerp() from before
+// to after by u, a u of 0 gives the before key.  Lanes with keys in
+// opposite hemispheres take the scalar slerp() that nlerp() would.
+static void sample_rotations(const U16* const* before, const U16* const* after, const F32* u, LLQuaternion* rotations)
+{
+    RotationLanes rot, rot_after;
+    rot.load(before);
+    rot_after.load(after);
+
+    LLVector4a cos_t, tmp;
+    cos_t.setMul(rot.mX, rot_after.mX);
+    tmp.setMul(rot.mY, rot_after.mY);
+    cos_t.add(tmp);
+    tmp.setMul(rot.mZ, rot_after.mZ);
+    cos_t.add(tmp);
+    tmp.setMul(rot.mW, rot_after.mW);
+    cos_t.add(tmp);
+
+    // lerp(), then LLQuaternion::normalize()
+    LLVector4a t, inv_t;
+    t.loadua(u);
+    inv_t.setSub(LLVector4a(1.f), t);
+    LLVector4a lerped[4];
+    const LLVector4a* from[4] = { &rot.mX, &rot.mY, &rot.mZ, &rot.mW };
+    const LLVector4a* to[4] = { &rot_after.mX, &rot_after.mY, &rot_after.mZ, &rot_after.mW };
+    LLVector4a mag = LLVector4a::getZero();
+    for (S32 i = 0; i < 4; i++)
+    {
+        lerped[i].setMul(t, *to[i]);
+        tmp.setMul(inv_t, *from[i]);
+        lerped[i].add(tmp);
+        tmp.setMul(lerped[i], lerped[i]);
+        mag.add(tmp);
+    }
+    mag = _mm_sqrt_ps(mag);
+
+    LLVector4a oomag, off_unity;
+    oomag.setDiv(LLVector4a(1.f), mag);
+    off_unity.setSub(LLVector4a(1.f), mag);
+    off_unity.setAbs(off_unity);
+    oomag.setSelectWithMask(off_unity.greaterThan(LLVector4a(ONE_PART_IN_A_MILLION)), oomag, LLVector4a(1.f));
+    const LLVector4Logical degenerate = mag.lessThan(LLVector4a(FP_MAG_THRESHOLD));
+    for (S32 i = 0; i < 4; i++)
+    {
+        lerped[i].mul(oomag);
+        lerped[i].setSelectWithMask(degenerate, LLVector4a(i == VW ? 1.f : 0.f), lerped[i]);
+    }
+
+    LLQuad rows[4] = { lerped[0], lerped[1], lerped[2], lerped[3] };
+    _MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+    const U32 flipped = _mm_movemask_ps(cos_t.lessThan(LLVector4a::getZero()));
+    for (S32 lane = 0; lane < 4; lane++)
+    {
+        if (flipped & (1 << lane))
+        {
+            rotations[lane] = slerp(u[lane], rot.get(lane), rot_after.get(lane));
+        }
+        else
+        {
+            _mm_storeu_ps(rotations[lane].mQ, rows[lane]);
         }
-        if (joint_motion_p->mUsage & LLJointState::POS)
+    }
+}
+
+// PositionCurve::getValue() with linear interpolation
+static inline LLVector3 sample_position(const F32* times, const U16* keys, U32 count, F32 time, U32& cursor)
+{
+    U32 before, after;
+    F32 u;
+    const bool between = find_keys(times, count, time, cursor, before, after, u);
+    const __m128i packed = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(keys + before * 4)), _mm_setzero_si128());
+    LLVector4a pos = dequantize(packed, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
+    if (between)
+    {
+        const __m128i packed_after = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(keys + after * 4)), _mm_setzero_si128());
+        pos.setLerp(pos, dequantize(packed_after, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET), u);
+    }
+    return LLVector3(pos.getF32ptr());
+}
+
+//-----------------------------------------------------------------------------
+// sampleKeys()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::JointMotionList::sampleKeys(F32 time, U32* cursors, const LLPointer<LLJointState>* joint_states) const
+{
+    const U32 num_joints = llmin(getNumJointMotions(), (U32)mRotationRanges.size());
+
+    // Find the keys of each joint, then interpolate the rotations of four
+    // joints at a time
+    const U16* before[4];
+    const U16* after[4];
+    LL_ALIGN_16(F32 u[4]);
+    LLJointState* lane_states[4];
+    LLQuaternion rotations[4];
+    S32 lanes = 0;
+    for (U32 i = 0; i < num_joints; i++)
+    {
+        LLJointState* joint_state = joint_states[i].get();
+        const KeyRange& range = mRotationRanges[i];
+        if (!joint_state || !(joint_state->getUsage() & LLJointState::ROT) || !range.mCount)
         {
-            LL_INFOS() << "\t" << joint_motion_p->mPositionCurve.mNumKeys << " position keys at "
-            << joint_motion_p->mPositionCurve.mNumKeys * sizeof(PositionKey) << " bytes" << LL_ENDL;
+            continue;
+        }
 
-            total_size += joint_motion_p->mPositionCurve.mNumKeys * sizeof(PositionKey);
+        U32 key_before, key_after;
+        const U16* keys = &mRotationKeys[range.mFirst * 4];
+        if (!find_keys(&mRotationTimes[range.mFirst], range.mCount, time, cursors[i * 2], key_before, key_after, u[lanes]))
+        {
+            key_after = key_before;
+            u[lanes] = 0.f;
+        }
+        before[lanes] = keys + key_before * 4;
+        after[lanes] = keys + key_after * 4;
+        lane_states[lanes] = joint_state;
+
+        if (++lanes == 4)
+        {
+            sample_rotations(before, after, u, rotations);
+            for (S32 lane = 0; lane < 4; lane++)
+            {
+                lane_states[lane]->setRotation(rotations[lane]);
+            }
+            lanes = 0;
+        }
+    }
+    if (lanes)
+    {
+        for (S32 lane = lanes; lane < 4; lane++)
+        {
+            before[lane] = before[0];
+            after[lane] = after[0];
+            u[lane] = u[0];
+        }
+        sample_rotations(before, after, u, rotations);
+        for (S32 lane = 0; lane < lanes; lane++)
+        {
+            lane_states[lane]->setRotation(rotations[lane]);
         }
     }
-    LL_INFOS() << "Size: " << total_size << " bytes" << LL_ENDL;
 
-    return total_size;
+    // positions are rare, usually just the pelvis
+    for (U32 i = 0; i < num_joints; i++)
+    {
+        LLJointState* joint_state = joint_states[i].get();
+        const KeyRange& range = mPositionRanges[i];
+        if (joint_state && (joint_state->getUsage() & LLJointState::POS) && range.mCount)
+        {
+            joint_state->setPosition(sample_position(&mPositionTimes[range.mFirst], &mPositionKeys[range.mFirst * 4],
+                                                     range.mCount, time, cursors[i * 2 + 1]));
+        }
+    }
+}
+
+LLQuaternion LLKeyframeMotion::JointMotionList::getRotation(U32 joint, F32 time) const
+{
+    if (joint >= mRotationRanges.size() || !mRotationRanges[joint].mCount)
+    {
+        return LLQuaternion::DEFAULT;
+    }
+    const KeyRange& range = mRotationRanges[joint];
+    const U16* keys = &mRotationKeys[range.mFirst * 4];
+    U32 cursor = 0;
+    U32 key_before, key_after;
+    LL_ALIGN_16(F32 u[4]) = { 0.f, 0.f, 0.f, 0.f };
+    if (!find_keys(&mRotationTimes[range.mFirst], range.mCount, time, cursor, key_before, key_after, u[0]))
+    {
+        key_after = key_before;
+    }
+    u[1] = u[2] = u[3] = u[0];
+    const U16* before[4] = { keys + key_before * 4, keys + key_before * 4, keys + key_before * 4, keys + key_before * 4 };
+    const U16* after[4] = { keys + key_after * 4, keys + key_after * 4, keys + key_after * 4, keys + key_after * 4 };
+    LLQuaternion rotations[4];
+    sample_rotations(before, after, u, rotations);
+    return rotations[0];
+}
+
+LLVector3 LLKeyframeMotion::JointMotionList::getPosition(U32 joint, F32 time) const
+{
+    if (joint >= mPositionRanges.size() || !mPositionRanges[joint].mCount)
+    {
+        return LLVector3::zero;
+    }
+    const KeyRange& range = mPositionRanges[joint];
+    U32 cursor = 0;
+    return sample_position(&mPositionTimes[range.mFirst], &mPositionKeys[range.mFirst * 4], range.mCount, time, cursor);
 }
 
 //-----------------------------------------------------------------------------
@@ -400,21 +766,8 @@ void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time,
         joint_state->setScale( mScaleCurve.getValue( time, duration ) );
     }
 
-    //-------------------------------------------------------------------------
-    // update rotation component of joint state
-    //-------------------------------------------------------------------------
-    if ((usage & LLJointState::ROT) && mRotationCurve.mNumKeys)
-    {
-        joint_state->setRotation( mRotationCurve.getValue( time, duration ) );
-    }
-
-    //-------------------------------------------------------------------------
-    // update position component of joint state
-    //-------------------------------------------------------------------------
-    if ((usage & LLJointState::POS) && mPositionCurve.mNumKeys)
-    {
-        joint_state->setPosition( mPositionCurve.getValue( time, duration ) );
-    }
+    // rotation and position keys are packed in the JointMotionList, see
+    // JointMotionList::sampleKeys()
 }
 
 
@@ -521,6 +874,21 @@ LLMotion::LLMotionInitStatus LLKeyframeMotion::onInitialize(LLCharacter *charact
         return STATUS_FAILURE;
     case ASSET_LOADED:
         return STATUS_SUCCESS;
+    case ASSET_DECODING:
+        if (!mAssetLoad->mDone.load(std::memory_order_acquire))
+        {
+            return STATUS_HOLD;
+        }
+        if (!LLKeyframeDataCache::getKeyframeData(getID())
+            && (!mAssetLoad->mSuccess || mAssetLoad->mParsed.mJointMotionList))
+        {
+            return finishDecode();
+        }
+        // another motion of the same asset finished the load, or the cache
+        // was flushed after it did
+        mAssetLoad.reset();
+        mAssetStatus = ASSET_UNDEFINED;
+        break;
     default:
         // we don't know what state the asset is in yet, so keep going
         // check keyframe cache first then file cache then asset request
@@ -604,18 +972,94 @@ LLMotion::LLMotionInitStatus LLKeyframeMotion::onInitialize(LLCharacter *charact
 
     LL_DEBUGS() << "Loading keyframe data for: " << getName() << ":" << getID() << " (" << anim_file_size << " bytes)" << LL_ENDL;
 
-    LLDataPackerBinaryBuffer dp(anim_data, anim_file_size);
+    decodeAsync(anim_data, anim_file_size, getID());
+    delete []anim_data;
+
+    // done already if it was decoded here
+    return onInitialize(character);
+}
+
+//-----------------------------------------------------------------------------
+// decodeAsync()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::decodeAsync(const U8* data, S32 size, const LLUUID& asset_id)
+{
+    mAssetStatus = ASSET_DECODING;
+
+    // join a decode of the same asset for another character
+    for (auto iter = sAssetLoads.begin(); iter != sAssetLoads.end();)
+    {
+        if (iter->second.expired())
+        {
+            iter = sAssetLoads.erase(iter);
+        }
+        else
+        {
+            ++iter;
+        }
+    }
+    auto found = sAssetLoads.find(getID());
+    if (found != sAssetLoads.end())
+    {
+        // unless it was bound already and the cache flushed since
+        std::shared_ptr<AssetLoad> load = found->second.lock();
+        if (!load->mDone.load(std::memory_order_acquire) || !load->mSuccess || load->mParsed.mJointMotionList)
+        {
+            mAssetLoad = load;
+            return;
+        }
+    }
+
+    mAssetLoad = std::make_shared<AssetLoad>();
+    mAssetLoad->mData.assign(data, data + llmax(size, 0));
+    mAssetLoad->mAssetID = asset_id;
+    mAssetLoad->mCharacterID = mCharacter ? mCharacter->getID() : LLUUID::null;
+    sAssetLoads[getID()] = mAssetLoad;
 
-    if (!deserialize(dp, getID()))
+    if (!sDecodeQueue.empty())
+    {
+        LL::WorkQueue::ptr_t queue = LL::WorkQueue::getInstance(sDecodeQueue);
+        if (queue)
+        {
+            std::shared_ptr<AssetLoad> load = mAssetLoad;
+            const LLUUID motion_id = getID();
+            if (queue->post([load, motion_id]() { load->decode(motion_id); }))
+            {
+                return;
+            }
+        }
+    }
+
+    // no queue to decode on
+    mAssetLoad->decode(getID());
+}
+
+//-----------------------------------------------------------------------------
+// AssetLoad::decode()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::AssetLoad::decode(const LLUUID& motion_id)
+{
+    LL_PROFILE_ZONE_SCOPED;
+    LLDataPackerBinaryBuffer dp(mData.data(), (S32)mData.size());
+    mSuccess = parseAsset(dp, motion_id, mAssetID, mCharacterID, mParsed);
+    std::vector<U8>().swap(mData);
+    mDone.store(true, std::memory_order_release);
+}
+
+//-----------------------------------------------------------------------------
+// finishDecode()
+//-----------------------------------------------------------------------------
+LLMotion::LLMotionInitStatus LLKeyframeMotion::finishDecode()
+{
+    std::shared_ptr<AssetLoad> load = std::move(mAssetLoad);
+
+    // a bind that fails leaves the parsed asset to the other characters
+    if (!load->mSuccess || !bindAsset(load->mParsed, load->mAssetID, true))
     {
         LL_WARNS() << "Failed to decode asset for animation " << getName() << ":" << getID() << LL_ENDL;
         mAssetStatus = ASSET_FETCH_FAILED;
         return STATUS_FAILURE;
     }
-
-    delete []anim_data;
-
-    mAssetStatus = ASSET_LOADED;
     return STATUS_SUCCESS;
 }
 
@@ -736,11 +1180,21 @@ bool LLKeyframeMotion::onUpdate(F32 time, U8* joint_mask)
 void LLKeyframeMotion::applyKeyframes(F32 time)
 {
     llassert_always (mJointMotionList->getNumJointMotions() <= mJointStates.size());
+    if (mKeyCursors.size() != mJointMotionList->getNumJointMotions() * 2)
+    {
+        mKeyCursors.assign(mJointMotionList->getNumJointMotions() * 2, 0);
+    }
+    mJointMotionList->sampleKeys(time, mKeyCursors.data(), mJointStates.data());
+
     for (U32 i=0; i<mJointMotionList->getNumJointMotions(); i++)
     {
-        mJointMotionList->getJointMotion(i)->update(mJointStates[i],
-                                                      time,
-                                                      mJointMotionList->mDuration );
+        JointMotion* joint_motion = mJointMotionList->getJointMotion(i);
+        if (joint_motion->mScaleCurve.mNumKeys)
+        {
+            joint_motion->update(mJointStates[i],
+                                 time,
+                                 mJointMotionList->mDuration );
+        }
     }
 
     LLJoint::JointPriority* pose_priority = (LLJoint::JointPriority* )mCharacter->getAnimationData("Hand Pose Priority");
@@ -1227,9 +1681,26 @@ void LLKeyframeMotion::applyConstraint(JointConstraint* constraint, F32 time, U8
 // During upload, we should be more restrictive and reject such animations.
 //-----------------------------------------------------------------------------
 bool LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, bool allow_invalid_joints)
+{
+    ParsedAsset parsed;
+    return parseAsset(dp, mID, asset_id, mCharacter->getID(), parsed)
+        && bindAsset(parsed, asset_id, allow_invalid_joints);
+}
+
+//-----------------------------------------------------------------------------
+// parseAsset()
+//
+// Only reads the asset, so it can run on any thread.
+//-----------------------------------------------------------------------------
+// static
+bool LLKeyframeMotion::parseAsset(LLDataPacker& dp, const LLUUID& motion_id, const LLUUID& asset_id,
+                                  const LLUUID& character_id, ParsedAsset& parsed)
 {
     bool old_version = false;
     std::unique_ptr<LLKeyframeMotion::JointMotionList> joint_motion_list(new LLKeyframeMotion::JointMotionList);
+    parsed.mPositionBounds.clear();
+    parsed.mSourceVolumes.clear();
+    parsed.mTargetVolumes.clear();
 
     //-------------------------------------------------------------------------
     // get base priority
@@ -1241,7 +1712,7 @@ bool LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
     // Amimation identifier for log messages
     auto asset = [&]() -> std::string
         {
-            return asset_id.asString() + ", char " + mCharacter->getID().asString();
+            return asset_id.asString() + ", char " + character_id.asString();
         };
 
     if (!dp.unpackU16(version, "version"))
@@ -1324,7 +1795,7 @@ bool LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
 
     if (!joint_motion_list->mEmoteName.empty())
     {
-        if (joint_motion_list->mEmoteName == mID.asString())
+        if (joint_motion_list->mEmoteName == motion_id.asString())
         {
             LL_WARNS() << "Malformed animation mEmoteName==mID"
                        << " for animation " << asset() << LL_ENDL;
@@ -1451,8 +1922,7 @@ bool LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
 
     joint_motion_list->mJointMotionArray.clear();
     joint_motion_list->mJointMotionArray.reserve(num_motions);
-    mJointStates.clear();
-    mJointStates.reserve(num_motions);
+    parsed.mPositionBounds.resize(num_motions);
 
     //-------------------------------------------------------------------------
     // initialize joint motions
@@ -1478,40 +1948,9 @@ bool LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
             return false;
         }
 
-        //---------------------------------------------------------------------
-        // find the corresponding joint
-        //---------------------------------------------------------------------
-        LLJoint *joint = mCharacter->getJoint( joint_name );
-        if (joint)
-        {
-            S32 joint_num = joint->getJointNum();
-            joint_name = joint->getName(); // canonical name in case this is an alias.
-//          LL_INFOS() << "  joint: " << joint_name << LL_ENDL;
-            if ((joint_num >= (S32)LL_CHARACTER_MAX_ANIMATED_JOINTS) || (joint_num < 0))
-            {
-                LL_WARNS() << "Joint will be omitted from animation: joint_num " << joint_num
-                           << " is outside of legal range [0-"
-                           << LL_CHARACTER_MAX_ANIMATED_JOINTS << ") for joint " << joint->getName()
-                           << " for animation " << asset() << LL_ENDL;
-                joint = NULL;
-            }
-        }
-        else
-        {
-            LL_WARNS() << "invalid joint name: " << joint_name
-                       << " for animation " << asset() << LL_ENDL;
-            if (!allow_invalid_joints)
-            {
-                return false;
-            }
-        }
-
+        // as the asset names it, bindAsset() finds the joint
         joint_motion->mJointName = joint_name;
-
-        LLPointer<LLJointState> joint_state = new LLJointState;
-        mJointStates.push_back(joint_state);
-        joint_state->setJoint( joint ); // note: can accept NULL
-        joint_state->setUsage( 0 );
+        joint_motion->mUsage = 0;
 
         //---------------------------------------------------------------------
         // get joint priority
@@ -1538,7 +1977,6 @@ bool LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
             joint_motion_list->mMaxPriority = (LLJoint::JointPriority)joint_priority;
         }
 
-        joint_state->setPriority((LLJoint::JointPriority)joint_priority);
 
         //---------------------------------------------------------------------
         // scan rotation curve header
@@ -1553,7 +1991,7 @@ bool LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
         joint_motion->mRotationCurve.mInterpolationType = IT_LINEAR;
         if (joint_motion->mRotationCurve.mNumKeys != 0)
         {
-            joint_state->setUsage(joint_state->getUsage() | LLJointState::ROT );
+            joint_motion->mUsage |= LLJointState::ROT;
         }
 
         //---------------------------------------------------------------------
@@ -1685,14 +2123,13 @@ bool LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
         joint_motion->mPositionCurve.mInterpolationType = IT_LINEAR;
         if (joint_motion->mPositionCurve.mNumKeys != 0)
         {
-            joint_state->setUsage(joint_state->getUsage() | LLJointState::POS );
+            joint_motion->mUsage |= LLJointState::POS;
         }
 
         //---------------------------------------------------------------------
         // scan position curve keys
         //---------------------------------------------------------------------
         PositionCurve *pCurve = &joint_motion->mPositionCurve;
-        bool is_pelvis = joint_motion->mJointName == "mPelvis";
         for (S32 k = 0; k < joint_motion->mPositionCurve.mNumKeys; k++)
         {
             U16 time_short;
@@ -1771,11 +2208,7 @@ bool LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
             }
 
             pCurve->mKeys[pos_key.mTime] = pos_key;
-
-            if (is_pelvis)
-            {
-                joint_motion_list->mPelvisBBox.addPoint(pos_key.mPosition);
-            }
+            parsed.mPositionBounds[i].addPoint(pos_key.mPosition);
         }
 
         if (joint_motion->mPositionCurve.mNumKeys > joint_motion->mPositionCurve.mKeys.size())
@@ -1785,8 +2218,6 @@ bool LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
                 << joint_motion->mPositionCurve.mNumKeys << " > " << joint_motion->mPositionCurve.mKeys.size()
                 << " (" << position_duplicates << ")" << LL_ENDL;
         }
-
-        joint_motion->mUsage = joint_state->getUsage();
     }
 
     if (rotation_duplicates > 0)
@@ -1801,6 +2232,8 @@ bool LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
             << " duplicated position keys that were removed" << LL_ENDL;
     }
 
+    joint_motion_list->packKeys();
+
     //-------------------------------------------------------------------------
     // get number of constraints
     //-------------------------------------------------------------------------
@@ -1822,7 +2255,6 @@ bool LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
         //-------------------------------------------------------------------------
         // get constraints
         //-------------------------------------------------------------------------
-        std::string str;
         for(S32 i = 0; i < num_constraints; ++i)
         {
             // read in constraint data
@@ -1869,14 +2301,7 @@ bool LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
             }
 
             bin_data[BIN_DATA_LENGTH] = 0; // Ensure null termination
-            str = (char*)bin_data;
-            constraintp->mSourceConstraintVolume = mCharacter->getCollisionVolumeID(str);
-            if (constraintp->mSourceConstraintVolume == -1)
-            {
-                LL_WARNS() << "not a valid source constraint volume " << str
-                           << " for animation " << asset() << LL_ENDL;
-                return false;
-            }
+            std::string source_volume = (char*)bin_data;
 
             if (!dp.unpackVector3(constraintp->mSourceConstraintOffset, "source_offset"))
             {
@@ -1900,22 +2325,16 @@ bool LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
             }
 
             bin_data[BIN_DATA_LENGTH] = 0; // Ensure null termination
-            str = (char*)bin_data;
-            if (str == "GROUND")
+            std::string target_volume = (char*)bin_data;
+            if (target_volume == "GROUND")
             {
                 // constrain to ground
                 constraintp->mConstraintTargetType = CONSTRAINT_TARGET_TYPE_GROUND;
+                target_volume.clear();
             }
             else
             {
                 constraintp->mConstraintTargetType = CONSTRAINT_TARGET_TYPE_BODY;
-                constraintp->mTargetConstraintVolume = mCharacter->getCollisionVolumeID(str);
-                if (constraintp->mTargetConstraintVolume == -1)
-                {
-                    LL_WARNS() << "not a valid target constraint volume " << str
-                               << " for animation " << asset() << LL_ENDL;
-                    return false;
-                }
             }
 
             if (!dp.unpackVector3(constraintp->mTargetConstraintOffset, "target_offset"))
@@ -1980,58 +2399,167 @@ bool LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
                 return false;
             }
 
-            LLJoint* joint = mCharacter->findCollisionVolume(constraintp->mSourceConstraintVolume);
-            // get joint to which this collision volume is attached
-            if (!joint)
+            // volumes are looked up by bindAsset(), same order as mConstraints
+            parsed.mSourceVolumes.insert(parsed.mSourceVolumes.begin(), source_volume);
+            parsed.mTargetVolumes.insert(parsed.mTargetVolumes.begin(), target_volume);
+            joint_motion_list->mConstraints.push_front(constraintp.release());
+        }
+    }
+
+    parsed.mJointMotionList = std::move(joint_motion_list);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// bindAsset()
+//
+// Finds the joints and collision volumes of a parsed asset on mCharacter and
+// publishes its motion list.  Main thread only.
+//-----------------------------------------------------------------------------
+bool LLKeyframeMotion::bindAsset(ParsedAsset& parsed, const LLUUID& asset_id, bool allow_invalid_joints)
+{
+    JointMotionList* joint_motion_list = parsed.mJointMotionList.get();
+    if (!joint_motion_list)
+    {
+        return false;
+    }
+
+    auto asset = [&]() -> std::string
+        {
+            return asset_id.asString() + ", char " + mCharacter->getID().asString();
+        };
+
+    const U32 num_motions = joint_motion_list->getNumJointMotions();
+    mJointStates.clear();
+    mJointStates.reserve(num_motions);
+    joint_motion_list->mPelvisBBox = LLBBoxLocal();
+
+    for (U32 i = 0; i < num_motions; ++i)
+    {
+        JointMotion* joint_motion = joint_motion_list->getJointMotion(i);
+
+        //---------------------------------------------------------------------
+        // find the corresponding joint
+        //---------------------------------------------------------------------
+        LLJoint *joint = mCharacter->getJoint( joint_motion->mJointName );
+        if (joint)
+        {
+            S32 joint_num = joint->getJointNum();
+            joint_motion->mJointName = joint->getName(); // canonical name in case this is an alias.
+            if ((joint_num >= (S32)LL_CHARACTER_MAX_ANIMATED_JOINTS) || (joint_num < 0))
+            {
+                LL_WARNS() << "Joint will be omitted from animation: joint_num " << joint_num
+                           << " is outside of legal range [0-"
+                           << LL_CHARACTER_MAX_ANIMATED_JOINTS << ") for joint " << joint->getName()
+                           << " for animation " << asset() << LL_ENDL;
+                joint = NULL;
+            }
+        }
+        else
+        {
+            LL_WARNS() << "invalid joint name: " << joint_motion->mJointName
+                       << " for animation " << asset() << LL_ENDL;
+            if (!allow_invalid_joints)
+            {
+                return false;
+            }
+        }
+
+        LLPointer<LLJointState> joint_state = new LLJointState;
+        mJointStates.push_back(joint_state);
+        joint_state->setJoint( joint ); // note: can accept NULL
+        joint_state->setUsage( joint_motion->mUsage );
+        joint_state->setPriority( joint_motion->mPriority );
+
+        if (joint_motion->mJointName == "mPelvis" && i < parsed.mPositionBounds.size())
+        {
+            joint_motion_list->mPelvisBBox.addBBox(parsed.mPositionBounds[i]);
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    // resolve constraints
+    //-------------------------------------------------------------------------
+    U32 constraint_index = 0;
+    for (JointConstraintSharedData* constraintp : joint_motion_list->mConstraints)
+    {
+        if (constraint_index >= parsed.mSourceVolumes.size())
+        {
+            return false;
+        }
+        std::string& source_volume = parsed.mSourceVolumes[constraint_index];
+        std::string& target_volume = parsed.mTargetVolumes[constraint_index];
+        constraint_index++;
+
+        constraintp->mSourceConstraintVolume = mCharacter->getCollisionVolumeID(source_volume);
+        if (constraintp->mSourceConstraintVolume == -1)
+        {
+            LL_WARNS() << "not a valid source constraint volume " << source_volume
+                       << " for animation " << asset() << LL_ENDL;
+            return false;
+        }
+
+        if (constraintp->mConstraintTargetType == CONSTRAINT_TARGET_TYPE_BODY)
+        {
+            constraintp->mTargetConstraintVolume = mCharacter->getCollisionVolumeID(target_volume);
+            if (constraintp->mTargetConstraintVolume == -1)
             {
+                LL_WARNS() << "not a valid target constraint volume " << target_volume
+                           << " for animation " << asset() << LL_ENDL;
                 return false;
             }
+        }
+
+        LLJoint* joint = mCharacter->findCollisionVolume(constraintp->mSourceConstraintVolume);
+        // get joint to which this collision volume is attached
+        if (!joint)
+        {
+            return false;
+        }
 
-            constraintp->mJointStateIndices = new S32[constraintp->mChainLength + 1]; // note: mChainLength is size-limited - comes from a byte
+        delete [] constraintp->mJointStateIndices;
+        constraintp->mJointStateIndices = new S32[constraintp->mChainLength + 1]; // note: mChainLength is size-limited - comes from a byte
 
-            for (S32 i = 0; i < constraintp->mChainLength + 1; i++)
+        for (S32 i = 0; i < constraintp->mChainLength + 1; i++)
+        {
+            LLJoint* parent = joint->getParent();
+            if (!parent)
+            {
+                LL_WARNS() << "Joint with no parent: " << joint->getName()
+                           << " Emote: " << joint_motion_list->mEmoteName
+                           << " for animation " << asset() << LL_ENDL;
+                return false;
+            }
+            joint = parent;
+            constraintp->mJointStateIndices[i] = -1;
+            for (U32 j = 0; j < num_motions; j++)
             {
-                LLJoint* parent = joint->getParent();
-                if (!parent)
+                LLJoint* constraint_joint = getJoint(j);
+
+                if ( !constraint_joint )
                 {
-                    LL_WARNS() << "Joint with no parent: " << joint->getName()
-                               << " Emote: " << joint_motion_list->mEmoteName
+                    LL_WARNS() << "Invalid joint " << j
                                << " for animation " << asset() << LL_ENDL;
                     return false;
                 }
-                joint = parent;
-                constraintp->mJointStateIndices[i] = -1;
-                for (U32 j = 0; j < joint_motion_list->getNumJointMotions(); j++)
-                {
-                    LLJoint* constraint_joint = getJoint(j);
-
-                    if ( !constraint_joint )
-                    {
-                        LL_WARNS() << "Invalid joint " << j
-                                   << " for animation " << asset() << LL_ENDL;
-                        return false;
-                    }
-
-                    if(constraint_joint == joint)
-                    {
-                        constraintp->mJointStateIndices[i] = (S32)j;
-                        break;
-                    }
-                }
-                if (constraintp->mJointStateIndices[i] < 0 )
+
+                if(constraint_joint == joint)
                 {
-                    LL_WARNS() << "No joint index for constraint " << i
-                               << " for animation " << asset() << LL_ENDL;
-                    return false;
+                    constraintp->mJointStateIndices[i] = (S32)j;
+                    break;
                 }
             }
-
-            joint_motion_list->mConstraints.push_front(constraintp.release());
+            if (constraintp->mJointStateIndices[i] < 0 )
+            {
+                LL_WARNS() << "No joint index for constraint " << i
+                           << " for animation " << asset() << LL_ENDL;
+                return false;
+            }
         }
     }
 
     // *FIX: support cleanup of old keyframe data
-    mJointMotionList = joint_motion_list.release(); // release from unique_ptr to member;
+    mJointMotionList = parsed.mJointMotionList.release(); // release from unique_ptr to member;
     LLKeyframeDataCache::addKeyframeData(getID(),  mJointMotionList);
     mAssetStatus = ASSET_LOADED;
 
@@ -2080,49 +2608,42 @@ bool LLKeyframeMotion::serialize(LLDataPacker& dp) const
         JointMotion* joint_motionp = mJointMotionList->getJointMotion(i);
         success &= dp.packString(joint_motionp->mJointName, "joint_name");
         success &= dp.packS32(joint_motionp->mPriority, "joint_priority");
-        success &= dp.packS32(static_cast<S32>(joint_motionp->mRotationCurve.mKeys.size()), "num_rot_keys");
+        const JointMotionList::KeyRange& rot_range = mJointMotionList->mRotationRanges[i];
+        const JointMotionList::KeyRange& pos_range = mJointMotionList->mPositionRanges[i];
+        success &= dp.packS32(static_cast<S32>(rot_range.mCount), "num_rot_keys");
 
         LL_DEBUGS("BVH") << "Joint " << i
             << " name: " << joint_motionp->mJointName
-            << " Rotation keys: " << joint_motionp->mRotationCurve.mKeys.size()
-            << " Position keys: " << joint_motionp->mPositionCurve.mKeys.size() << LL_ENDL;
-        for (RotationCurve::key_map_t::value_type& rot_pair : joint_motionp->mRotationCurve.mKeys)
+            << " Rotation keys: " << rot_range.mCount
+            << " Position keys: " << pos_range.mCount << LL_ENDL;
+        for (U32 k = rot_range.mFirst; k < rot_range.mFirst + rot_range.mCount; k++)
         {
-            RotationKey& rot_key = rot_pair.second;
-            U16 time_short = F32_to_U16(rot_key.mTime, 0.f, mJointMotionList->mDuration);
+            // the packed keys are already quantized like the asset
+            F32 time = mJointMotionList->mRotationTimes[k];
+            U16 time_short = F32_to_U16(time, 0.f, mJointMotionList->mDuration);
             success &= dp.packU16(time_short, "time");
 
-            LLVector3 rot_angles = rot_key.mRotation.packToVector3();
+            const U16* rot_key = &mJointMotionList->mRotationKeys[k * 4];
+            success &= dp.packU16(rot_key[VX], "rot_angle_x");
+            success &= dp.packU16(rot_key[VY], "rot_angle_y");
+            success &= dp.packU16(rot_key[VZ], "rot_angle_z");
 
-            U16 x, y, z;
-            rot_angles.quantize16(-1.f, 1.f, -1.f, 1.f);
-            x = F32_to_U16(rot_angles.mV[VX], -1.f, 1.f);
-            y = F32_to_U16(rot_angles.mV[VY], -1.f, 1.f);
-            z = F32_to_U16(rot_angles.mV[VZ], -1.f, 1.f);
-            success &= dp.packU16(x, "rot_angle_x");
-            success &= dp.packU16(y, "rot_angle_y");
-            success &= dp.packU16(z, "rot_angle_z");
-
-            LL_DEBUGS("BVH") << "  rot: t " << rot_key.mTime << " angles " << rot_angles.mV[VX] <<","<< rot_angles.mV[VY] <<","<< rot_angles.mV[VZ] << LL_ENDL;
+            LL_DEBUGS("BVH") << "  rot: t " << time << " angles " << rot_key[VX] <<","<< rot_key[VY] <<","<< rot_key[VZ] << LL_ENDL;
         }
 
-        success &= dp.packS32(static_cast<S32>(joint_motionp->mPositionCurve.mKeys.size()), "num_pos_keys");
-        for (PositionCurve::key_map_t::value_type& pos_pair : joint_motionp->mPositionCurve.mKeys)
+        success &= dp.packS32(static_cast<S32>(pos_range.mCount), "num_pos_keys");
+        for (U32 k = pos_range.mFirst; k < pos_range.mFirst + pos_range.mCount; k++)
         {
-            PositionKey& pos_key = pos_pair.second;
-            U16 time_short = F32_to_U16(pos_key.mTime, 0.f, mJointMotionList->mDuration);
+            F32 time = mJointMotionList->mPositionTimes[k];
+            U16 time_short = F32_to_U16(time, 0.f, mJointMotionList->mDuration);
             success &= dp.packU16(time_short, "time");
 
-            U16 x, y, z;
-            pos_key.mPosition.quantize16(-LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
-            x = F32_to_U16(pos_key.mPosition.mV[VX], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
-            y = F32_to_U16(pos_key.mPosition.mV[VY], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
-            z = F32_to_U16(pos_key.mPosition.mV[VZ], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
-            success &= dp.packU16(x, "pos_x");
-            success &= dp.packU16(y, "pos_y");
-            success &= dp.packU16(z, "pos_z");
+            const U16* pos_key = &mJointMotionList->mPositionKeys[k * 4];
+            success &= dp.packU16(pos_key[VX], "pos_x");
+            success &= dp.packU16(pos_key[VY], "pos_y");
+            success &= dp.packU16(pos_key[VZ], "pos_z");
 
-            LL_DEBUGS("BVH") << "  pos: t " << pos_key.mTime << " pos " << pos_key.mPosition.mV[VX] <<","<< pos_key.mPosition.mV[VY] <<","<< pos_key.mPosition.mV[VZ] << LL_ENDL;
+            LL_DEBUGS("BVH") << "  pos: t " << time << " pos " << pos_key[VX] <<","<< pos_key[VY] <<","<< pos_key[VZ] << LL_ENDL;
         }
     }
 
@@ -2367,8 +2888,8 @@ void LLKeyframeMotion::setLoopIn(F32 in_point)
             rot_curve->mLoopInKey.mTime = mJointMotionList->mLoopInPoint;
             scale_curve->mLoopInKey.mTime = mJointMotionList->mLoopInPoint;
 
-            pos_curve->mLoopInKey.mPosition = pos_curve->getValue(mJointMotionList->mLoopInPoint, mJointMotionList->mDuration);
-            rot_curve->mLoopInKey.mRotation = rot_curve->getValue(mJointMotionList->mLoopInPoint, mJointMotionList->mDuration);
+            pos_curve->mLoopInKey.mPosition = mJointMotionList->getPosition(i, mJointMotionList->mLoopInPoint);
+            rot_curve->mLoopInKey.mRotation = mJointMotionList->getRotation(i, mJointMotionList->mLoopInPoint);
             scale_curve->mLoopInKey.mScale = scale_curve->getValue(mJointMotionList->mLoopInPoint, mJointMotionList->mDuration);
         }
     }
@@ -2396,8 +2917,8 @@ void LLKeyframeMotion::setLoopOut(F32 out_point)
             rot_curve->mLoopOutKey.mTime = mJointMotionList->mLoopOutPoint;
             scale_curve->mLoopOutKey.mTime = mJointMotionList->mLoopOutPoint;
 
-            pos_curve->mLoopOutKey.mPosition = pos_curve->getValue(mJointMotionList->mLoopOutPoint, mJointMotionList->mDuration);
-            rot_curve->mLoopOutKey.mRotation = rot_curve->getValue(mJointMotionList->mLoopOutPoint, mJointMotionList->mDuration);
+            pos_curve->mLoopOutKey.mPosition = mJointMotionList->getPosition(i, mJointMotionList->mLoopOutPoint);
+            rot_curve->mLoopOutKey.mRotation = mJointMotionList->getRotation(i, mJointMotionList->mLoopOutPoint);
             scale_curve->mLoopOutKey.mScale = scale_curve->getValue(mJointMotionList->mLoopOutPoint, mJointMotionList->mDuration);
         }
     }
@@ -2438,7 +2959,7 @@ void LLKeyframeMotion::onLoadComplete(const LLUUID& asset_uuid,
 
         if (0 == status)
         {
-            if (motionp->mAssetStatus == ASSET_LOADED)
+            if (motionp->mAssetStatus == ASSET_LOADED || motionp->mAssetStatus == ASSET_DECODING)
             {
                 // asset already loaded
                 return;
@@ -2456,16 +2977,8 @@ void LLKeyframeMotion::onLoadComplete(const LLUUID& asset_uuid,
 
             LL_DEBUGS("Animation") << "Loading keyframe data for: " << motionp->getName() << ":" << motionp->getID() << " (" << size << " bytes)" << LL_ENDL;
 
-            LLDataPackerBinaryBuffer dp(buffer, size);
-            if (motionp->deserialize(dp, asset_uuid))
-            {
-                motionp->mAssetStatus = ASSET_LOADED;
-            }
-            else
-            {
-                LL_WARNS() << "Failed to decode asset for animation " << motionp->getName() << ":" << motionp->getID() << LL_ENDL;
-                motionp->mAssetStatus = ASSET_FETCH_FAILED;
-            }
+            // onInitialize() picks it up once it's decoded
+            motionp->decodeAsync(buffer, size, asset_uuid);
 
             delete[] buffer;
         }
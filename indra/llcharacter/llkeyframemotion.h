@@ -31,6 +31,8 @@
 // Header files
 //-----------------------------------------------------------------------------
 
+#include <atomic>
+#include <memory>
 #include <string>
 
 #include "llassetstorage.h"
@@ -158,6 +160,15 @@ public:
     bool    serialize(LLDataPacker& dp) const;
     bool    deserialize(LLDataPacker& dp, const LLUUID& asset_id, bool allow_invalid_joints = true);
     bool    isLoaded() { return mJointMotionList != NULL; }
+
+    // Decodes the asset on the decode queue, onInitialize() finishes the
+    // load once it's done.  Motions of the same asset share one decode.
+    void    decodeAsync(const U8* data, S32 size, const LLUUID& asset_id);
+
+    // Work queue the assets are decoded on, empty to decode them when they
+    // arrive.  Main thread only.
+    static void setDecodeQueue(const std::string& queue_name) { sDecodeQueue = queue_name; }
+    static const std::string& getDecodeQueue() { return sDecodeQueue; }
     bool    dumpToFile(const std::string& name);
 
 
@@ -274,7 +285,7 @@ protected:
     bool    setupPose();
 
 public:
-    enum AssetStatus { ASSET_LOADED, ASSET_FETCHED, ASSET_NEEDS_FETCH, ASSET_FETCH_FAILED, ASSET_UNDEFINED };
+    enum AssetStatus { ASSET_LOADED, ASSET_FETCHED, ASSET_NEEDS_FETCH, ASSET_FETCH_FAILED, ASSET_DECODING, ASSET_UNDEFINED };
 
     enum InterpolationType { IT_STEP, IT_LINEAR, IT_SPLINE };
 
@@ -387,6 +398,7 @@ public:
         U32             mUsage;
         LLJoint::JointPriority  mPriority;
 
+        // Scale only, rotation and position come from JointMotionList::sampleKeys()
         void update(LLJointState* joint_state, F32 time, F32 duration);
     };
 
@@ -415,17 +427,95 @@ public:
         std::string             mEmoteName;
         LLUUID                  mEmoteID;
 
+        // Rotation and position keys of all joints, packed by packKeys() once
+        // the asset is loaded and shared by every instance playing it.  Each
+        // joint's keys are contiguous and sorted by time.  Values stay
+        // quantized the way the .anim format stores them, four U16 per key:
+        // x, y, z and padding.  Rotations keep only x, y and z of a
+        // quaternion with a non-negative w.
+        struct KeyRange
+        {
+            U32 mFirst = 0;
+            U32 mCount = 0;
+        };
+        std::vector<KeyRange>   mRotationRanges;
+        std::vector<KeyRange>   mPositionRanges;
+        std::vector<F32>        mRotationTimes;
+        std::vector<F32>        mPositionTimes;
+        std::vector<U16>        mRotationKeys;
+        std::vector<U16>        mPositionKeys;
+
     public:
         JointMotionList();
         ~JointMotionList();
         U32 dumpDiagInfo();
+        U32 getMemoryUsage() const;
         JointMotion* getJointMotion(U32 index) const { llassert(index < mJointMotionArray.size()); return mJointMotionArray[index]; }
         U32 getNumJointMotions() const { return static_cast<U32>(mJointMotionArray.size()); }
+
+        // Moves the rotation and position curve keys into the packed arrays
+        // above and frees the curve maps
+        void packKeys();
+
+        // Sets the rotation and position of every joint state at time in one
+        // pass.  cursors holds a rotation and a position key index per joint,
+        // it belongs to the caller and makes forward playback a short scan.
+        void sampleKeys(F32 time, U32* cursors, const LLPointer<LLJointState>* joint_states) const;
+
+        LLQuaternion getRotation(U32 joint, F32 time) const;
+        LLVector3 getPosition(U32 joint, F32 time) const;
     };
 
 protected:
+    //-------------------------------------------------------------------------
+    // ParsedAsset
+    //
+    // An asset read by parseAsset(), before the joints and collision volumes
+    // of a character are looked up.  Joint names are as the asset has them.
+    //-------------------------------------------------------------------------
+    class ParsedAsset
+    {
+    public:
+        std::unique_ptr<JointMotionList> mJointMotionList;
+        std::vector<LLBBoxLocal>    mPositionBounds;    // of the position keys, per joint
+        std::vector<std::string>    mSourceVolumes;     // per constraint, in mConstraints order
+        std::vector<std::string>    mTargetVolumes;     // empty for the ground
+    };
+
+    //-------------------------------------------------------------------------
+    // AssetLoad
+    //
+    // A decode in flight, shared by the motions waiting for it
+    //-------------------------------------------------------------------------
+    class AssetLoad
+    {
+    public:
+        std::vector<U8>     mData;
+        LLUUID              mAssetID;
+        LLUUID              mCharacterID;
+        ParsedAsset         mParsed;
+        bool                mSuccess = false;
+        std::atomic<bool>   mDone{ false };    // the fields above are set before
+
+        void decode(const LLUUID& motion_id);
+    };
+
+    // Reads the asset without touching a character, any thread
+    static bool parseAsset(LLDataPacker& dp, const LLUUID& motion_id, const LLUUID& asset_id,
+                           const LLUUID& character_id, ParsedAsset& parsed);
+    // Binds parsed to mCharacter and publishes it to LLKeyframeDataCache,
+    // main thread only
+    bool bindAsset(ParsedAsset& parsed, const LLUUID& asset_id, bool allow_invalid_joints);
+    LLMotionInitStatus finishDecode();
+
+    typedef std::map<LLUUID, std::weak_ptr<AssetLoad> > asset_load_map_t;
+    static asset_load_map_t         sAssetLoads;
+    static std::string              sDecodeQueue;
+
+    std::shared_ptr<AssetLoad>      mAssetLoad;
     JointMotionList*                mJointMotionList;
     std::vector<LLPointer<LLJointState> > mJointStates;
+    std::vector<U32>                mKeyCursors;    // for JointMotionList::sampleKeys()
     LLJoint*                        mPelvisp;
     LLCharacter*                    mCharacter;
     typedef std::list<JointConstraint*> constraint_list_t;
@@ -35,7 +35,9 @@
 #include "llmath.h"
 #include "lltimer.h"
 #include "llanimationstates.h"
+#include "llcriticaldamp.h"
 #include "llstl.h"
+#include "parallelfor.h"
 
 // This is why LL_CHARACTER_MAX_ANIMATED_JOINTS needs to be a multiple of 4.
 const S32 NUM_JOINT_SIGNATURE_STRIDES = LL_CHARACTER_MAX_ANIMATED_JOINTS / 4;
@@ -140,6 +142,7 @@ LLMotionController::LLMotionController()
       mTimeStepCount(0),
       mLastInterp(0.f),
       mIsSelf(false),
+      mDeferMainThreadWork(false),
       mLastCountAfterPurge(0)
 {
 }
@@ -500,7 +503,7 @@ void LLMotionController::updateIdleMotion(LLMotion* motionp)
     LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
     if (motionp->isStopped() && mAnimTime > motionp->getStopTime() + motionp->getEaseOutDuration())
     {
-        deactivateMotionInstance(motionp);
+        deactivateOrDefer(motionp);
     }
     else if (motionp->isStopped() && mAnimTime > motionp->getStopTime())
     {
@@ -517,8 +520,7 @@ void LLMotionController::updateIdleMotion(LLMotion* motionp)
         // this will only be called when an animation stops itself (runs out of time)
         if (mLastTime <= motionp->mSendStopTimestamp)
         {
-            mCharacter->requestStopMotion( motionp );
-            stopMotionInstance(motionp, false);
+            stopMotionAndNotify(motionp);
         }
     }
     else if (mAnimTime >= motionp->mActivationTimestamp)
@@ -619,8 +621,7 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
                 // this will only be called when an animation stops itself (runs out of time)
                 if (mLastTime <= motionp->mSendStopTimestamp)
                 {
-                    mCharacter->requestStopMotion( motionp );
-                    stopMotionInstance(motionp, false);
+                    stopMotionAndNotify(motionp);
                 }
             }
 
@@ -629,7 +630,7 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
                 if (motionp->isStopped() && mAnimTime > motionp->getStopTime() + motionp->getEaseOutDuration())
                 {
                     posep->setWeight(0.f);
-                    deactivateMotionInstance(motionp);
+                    deactivateOrDefer(motionp);
                 }
                 continue;
             }
@@ -656,7 +657,7 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
             else
             {
                 posep->setWeight(0.f);
-                deactivateMotionInstance(motionp);
+                deactivateOrDefer(motionp);
                 continue;
             }
         }
@@ -700,8 +701,7 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
                 // this will only be called when an animation stops itself (runs out of time)
                 if (mLastTime <= motionp->mSendStopTimestamp)
                 {
-                    mCharacter->requestStopMotion( motionp );
-                    stopMotionInstance(motionp, false);
+                    stopMotionAndNotify(motionp);
                 }
             }
 
@@ -746,8 +746,7 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
                 // animation has stopped itself due to internal logic
                 // propagate this to the network
                 // as not all viewers are guaranteed to have access to the same logic
-                mCharacter->requestStopMotion( motionp );
-                stopMotionInstance(motionp, false);
+                stopMotionAndNotify(motionp);
             }
 
         }
@@ -817,6 +816,33 @@ void LLMotionController::updateMotions(bool force_update)
     // Currently setting mTimeStep to nonzero is disabled elsewhere.
     bool use_quantum = (mTimeStep != 0.f);
 
+    if (!updateAnimTime(use_quantum))
+    {
+        return;
+    }
+
+    resetJointSignatures();
+
+    if (mPaused && !force_update)
+    {
+        updateIdleActiveMotions();
+    }
+    else
+    {
+        updateActiveMotions(use_quantum);
+    }
+
+    mHasRunOnce = true;
+//  LL_INFOS() << "Motion controller time " << motionTimer.getElapsedTimeF32() << LL_ENDL;
+}
+
+//-----------------------------------------------------------------------------
+// updateAnimTime()
+// steps the animation clock and finishes loading motions, returns false if
+// there is nothing more to do this frame
+//-----------------------------------------------------------------------------
+bool LLMotionController::updateAnimTime(bool use_quantum)
+{
     // Always update mPrevTimerElapsed
     F32 cur_time = mTimer.getElapsedTimeF32();
     F32 delta_time = cur_time - mPrevTimerElapsed;
@@ -848,7 +874,7 @@ void LLMotionController::updateMotions(bool force_update)
 
                 updateLoadingMotions();
 
-                return;
+                return false;
             }
 
             // is calculating a new keyframe pose, make sure the last one gets applied
@@ -867,34 +893,121 @@ void LLMotionController::updateMotions(bool force_update)
 
     updateLoadingMotions();
 
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// updateActiveMotions()
+//-----------------------------------------------------------------------------
+void LLMotionController::updateActiveMotions(bool use_quantum)
+{
+    // update additive motions
+    updateAdditiveMotions();
+
     resetJointSignatures();
 
-    if (mPaused && !force_update)
+    // update all regular motions
+    updateRegularMotions();
+
+    if (use_quantum)
     {
-        updateIdleActiveMotions();
+        mPoseBlender.blendAndCache(true);
     }
     else
     {
-        // update additive motions
-        updateAdditiveMotions();
+        mPoseBlender.blendAndApply();
+    }
+}
 
-        resetJointSignatures();
+//-----------------------------------------------------------------------------
+// beginParallelUpdate()
+//-----------------------------------------------------------------------------
+bool LLMotionController::beginParallelUpdate(bool force_update)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+    // The first update primes the character state (and the function
+    // statics of its motions) on the main thread.
+    if (mTimeStep != 0.f || !mHasRunOnce || (mPaused && !force_update))
+    {
+        updateMotions(force_update);
+        return false;
+    }
 
-        // update all regular motions
-        updateRegularMotions();
+    updateAnimTime(false);
 
-        if (use_quantum)
-        {
-            mPoseBlender.blendAndCache(true);
-        }
-        else
+    mDeferMainThreadWork = true;
+    mCharacter->setDeferVisualParamsUpdate(true);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// updateParallel()
+//-----------------------------------------------------------------------------
+void LLMotionController::updateParallel()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+    llassert(mDeferMainThreadWork);
+
+    resetJointSignatures();
+    updateActiveMotions(false);
+}
+
+//-----------------------------------------------------------------------------
+// finishParallelUpdate()
+//-----------------------------------------------------------------------------
+void LLMotionController::finishParallelUpdate()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+    mDeferMainThreadWork = false;
+
+    for (LLMotion* motionp : mDeferredStops)
+    {
+        mCharacter->requestStopMotion(motionp);
+    }
+    mDeferredStops.clear();
+
+    for (LLMotion* motionp : mDeferredDeactivations)
+    {
+        if (isMotionActive(motionp))
         {
-            mPoseBlender.blendAndApply();
+            deactivateMotionInstance(motionp);
         }
     }
+    mDeferredDeactivations.clear();
 
+    mCharacter->setDeferVisualParamsUpdate(false);
     mHasRunOnce = true;
-//  LL_INFOS() << "Motion controller time " << motionTimer.getElapsedTimeF32() << LL_ENDL;
+}
+
+//-----------------------------------------------------------------------------
+// updateMotionsParallel()
+//-----------------------------------------------------------------------------
+// static
+void LLMotionController::updateMotionsParallel(const std::vector<LLMotionController*>& controllers,
+                                               const std::string& queue_name)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+    if (controllers.empty())
+    {
+        return;
+    }
+
+    // Motions look up their smoothing constants, keep that cache as it is
+    // while other threads read it
+    LLSmoothInterpolation::setCacheFrozen(true);
+    try
+    {
+        LL::parallel_for(queue_name, controllers.size(), [&controllers](size_t i)
+            {
+                controllers[i]->updateParallel();
+            });
+    }
+    catch (...)
+    {
+        LLSmoothInterpolation::setCacheFrozen(false);
+        throw;
+    }
+    LLSmoothInterpolation::setCacheFrozen(false);
 }
 
 //-----------------------------------------------------------------------------
@@ -916,6 +1029,40 @@ void LLMotionController::updateMotionsMinimal()
     mHasRunOnce = true;
 }
 
+//-----------------------------------------------------------------------------
+// stopMotionAndNotify()
+// motion stopped itself, let the character know
+//-----------------------------------------------------------------------------
+void LLMotionController::stopMotionAndNotify(LLMotion* motionp)
+{
+    if (mDeferMainThreadWork)
+    {
+        // the character may tell the simulator, leave that to the main thread
+        mDeferredStops.push_back(motionp);
+    }
+    else
+    {
+        mCharacter->requestStopMotion(motionp);
+    }
+    stopMotionInstance(motionp, false);
+}
+
+//-----------------------------------------------------------------------------
+// deactivateOrDefer()
+//-----------------------------------------------------------------------------
+void LLMotionController::deactivateOrDefer(LLMotion* motionp)
+{
+    if (mDeferMainThreadWork)
+    {
+        // onDeactivate() may do anything, and deprecated motions get deleted
+        mDeferredDeactivations.push_back(motionp);
+    }
+    else
+    {
+        deactivateMotionInstance(motionp);
+    }
+}
+
 //-----------------------------------------------------------------------------
 // activateMotionInstance()
 //-----------------------------------------------------------------------------
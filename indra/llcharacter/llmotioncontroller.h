@@ -33,6 +33,7 @@
 #include <string>
 #include <map>
 #include <deque>
+#include <vector>
 
 #include "llmotion.h"
 #include "llpose.h"
@@ -135,6 +136,25 @@ public:
     // minimal update (e.g. while hidden)
     void updateMotionsMinimal();
 
+    // updateMotions() split up so that many characters can be animated at
+    // once.  beginParallelUpdate() (main thread) steps the clock and loads
+    // motions; if it returns false the update could not be split (first
+    // update, time step quantization) and was done in full instead.
+    // Otherwise updateParallel() evaluates and blends the active motions
+    // into the joints on any thread, one thread per controller, and
+    // finishParallelUpdate() (main thread) does what it had to put off:
+    // stop requests to the character, deactivations and visual param
+    // updates.
+    bool beginParallelUpdate(bool force_update = false);
+    void updateParallel();
+    void finishParallelUpdate();
+
+    // Runs updateParallel() for each controller on the named work queue,
+    // with the calling thread helping out, and returns once all are done.
+    // Does them here if the queue isn't running.
+    static void updateMotionsParallel(const std::vector<LLMotionController*>& controllers,
+                                      const std::string& queue_name = "General");
+
     void clearBlenders() { mPoseBlender.clearBlenders(); }
 
     // flush motions
@@ -191,6 +211,10 @@ protected:
     void updateIdleActiveMotions();
     void purgeExcessMotions();
     void deactivateStoppedMotions();
+    bool updateAnimTime(bool use_quantum);
+    void updateActiveMotions(bool use_quantum);
+    void stopMotionAndNotify(LLMotion* motion);
+    void deactivateOrDefer(LLMotion* motion);
 
 protected:
     F32                 mTimeFactor;            // 1.f for normal speed
@@ -228,6 +252,11 @@ protected:
     F32                 mLastInterp;
 
     U8                  mJointSignature[2][LL_CHARACTER_MAX_ANIMATED_JOINTS];
+
+    // Main thread work put off by updateParallel()
+    bool                mDeferMainThreadWork;
+    motion_list_t       mDeferredStops;
+    motion_list_t       mDeferredDeactivations;
 private:
     U32                 mLastCountAfterPurge; //for logging and debugging purposes
 };
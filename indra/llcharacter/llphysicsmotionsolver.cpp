@@ -0,0 +1,297 @@
+/**
+ * @file llphysicsmotionsolver.cpp
+ * @brief Batched spring integration of avatar physics params.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+//-----------------------------------------------------------------------------
+// Header Files
+//-----------------------------------------------------------------------------
+#include "linden_common.h"
+
+#include "llphysicsmotionsolver.h"
+
+namespace
+{
+    const F32 MAX_VELOCITY = 100.f;
+
+    // Groups integrated together
+    const S32 BLOCK_GROUPS = 32;
+
+    // Pads the last group, never steps
+    const LLPhysicsMotionSolver::Param EMPTY_LANE =
+    {
+        0.f, 0.f, 0.f, 0.f,
+        0.f, 0.f, 0.f, 0.f,
+        1.f, 0.f, F32_MAX, 0.f,
+        0
+    };
+
+    inline LLQuad select(LLQuad mask, LLQuad if_true, LLQuad if_false)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, if_true), _mm_andnot_ps(mask, if_false));
+    }
+}
+
+//-----------------------------------------------------------------------------
+// LLPhysicsMotionSolver()
+//-----------------------------------------------------------------------------
+LLPhysicsMotionSolver::LLPhysicsMotionSolver()
+:   mNumParams(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+// clear()
+//-----------------------------------------------------------------------------
+void LLPhysicsMotionSolver::clear()
+{
+    mParams.clear();
+    mNumParams = 0;
+}
+
+//-----------------------------------------------------------------------------
+// addParams()
+//-----------------------------------------------------------------------------
+S32 LLPhysicsMotionSolver::addParams(const LLPhysicsMotionSolver& other)
+{
+    const S32 first = mNumParams;
+    mParams.insert(mParams.end(), other.mParams.begin(), other.mParams.end());
+    mNumParams += other.mNumParams;
+    return first;
+}
+
+//-----------------------------------------------------------------------------
+// integrate()
+//-----------------------------------------------------------------------------
+void LLPhysicsMotionSolver::integrate()
+{
+    LL_PROFILE_ZONE_SCOPED;
+    const S32 num_groups = (mNumParams + 3) / 4;
+    mResults.resize(num_groups * 4);
+
+    // The last group is padded with lanes that don't step
+    Param last[4] = { EMPTY_LANE, EMPTY_LANE, EMPTY_LANE, EMPTY_LANE };
+    for (S32 i = (num_groups - 1) * 4; i >= 0 && i < mNumParams; i++)
+    {
+        last[i & 3] = mParams[i];
+    }
+
+    // A block of groups at a time, small enough to stay in cache.  The
+    // groups don't depend on each other, stepping all of them once before
+    // the next step lets their steps overlap.
+    if ((S32)mGroups.size() < num_groups)
+    {
+        mGroups.resize(num_groups);
+    }
+    for (S32 first = 0; first < num_groups; first += BLOCK_GROUPS)
+    {
+        Group* block = &mGroups[first];
+        const S32 count = llmin(BLOCK_GROUPS, num_groups - first);
+        U32 max_steps = 0;
+        for (S32 i = 0; i < count; i++)
+        {
+            const S32 group = first + i;
+            loadGroup(group < num_groups - 1 ? &mParams[group * 4] : last, block[i]);
+            max_steps = llmax(max_steps, block[i].mMaxSteps);
+        }
+
+        for (U32 step = 0; step < max_steps; step++)
+        {
+            for (S32 i = 0; i < count; i++)
+            {
+                if (!block[i].mDone && step < block[i].mMaxSteps)
+                {
+                    stepGroup(block[i]);
+                }
+            }
+        }
+
+        for (S32 i = 0; i < count; i++)
+        {
+            storeGroup(block[i], &mResults[(first + i) * 4]);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// loadGroup()
+//-----------------------------------------------------------------------------
+// static
+void LLPhysicsMotionSolver::loadGroup(const Param* params, Group& group)
+{
+    LLQuad row0 = _mm_loadu_ps(&params[0].mPosition);
+    LLQuad row1 = _mm_loadu_ps(&params[1].mPosition);
+    LLQuad row2 = _mm_loadu_ps(&params[2].mPosition);
+    LLQuad row3 = _mm_loadu_ps(&params[3].mPosition);
+    _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+    group.mPosition = row0;
+    group.mVelocity = row1;
+    group.mPositionLastUpdate = row2;
+    group.mPositionUser = row3;
+
+    // Spring and damping negated, which gives the same products as
+    // negating the spring length and the velocity
+    const LLQuad sign = _mm_set1_ps(-0.f);
+    row0 = _mm_loadu_ps(&params[0].mForce);
+    row1 = _mm_loadu_ps(&params[1].mForce);
+    row2 = _mm_loadu_ps(&params[2].mForce);
+    row3 = _mm_loadu_ps(&params[3].mForce);
+    _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+    group.mForce = row0;
+    group.mForceDrag = row1;
+    group.mSpring = _mm_xor_ps(row2, sign);
+    group.mDamping = _mm_xor_ps(row3, sign);
+
+    row0 = _mm_loadu_ps(&params[0].mMass);
+    row1 = _mm_loadu_ps(&params[1].mMass);
+    row2 = _mm_loadu_ps(&params[2].mMass);
+    row3 = _mm_loadu_ps(&params[3].mMass);
+    _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+    group.mMass = row0;
+    group.mNoEffect = _mm_cmpeq_ps(row1, _mm_setzero_ps());
+    group.mMinDelta = row2;
+    group.mTimeStep = row3;
+
+    group.mSteps = _mm_cvtepi32_ps(_mm_setr_epi32(params[0].mSteps, params[1].mSteps, params[2].mSteps, params[3].mSteps));
+    group.mMaxSteps = llmax(llmax(params[0].mSteps, params[1].mSteps), llmax(params[2].mSteps, params[3].mSteps));
+    group.mDone = false;
+
+    group.mPositionClamped.clear();
+    group.mStepsDone.clear();
+    group.mStopped.clear();
+    group.mUpdateVisuals.clear();
+    group.mReset.clear();
+}
+
+//-----------------------------------------------------------------------------
+// stepGroup()
+//-----------------------------------------------------------------------------
+// static
+void LLPhysicsMotionSolver::stepGroup(Group& group)
+{
+    const LLQuad zero = _mm_setzero_ps();
+    const LLQuad one = _mm_set1_ps(1.f);
+
+    LLQuad active = _mm_andnot_ps(group.mStopped, _mm_cmplt_ps(group.mStepsDone, group.mSteps));
+
+    // Clamps keep NaN, like llclamp()
+    const LLVector4a position(group.mPosition);
+    const LLVector4a velocity(group.mVelocity);
+    const LLVector4a position_current(_mm_min_ps(one, _mm_max_ps(zero, position)));
+
+    // If the effect is turned off, stop once at the user position
+    const LLQuad at_rest = _mm_and_ps(active, _mm_and_ps(group.mNoEffect, _mm_cmpeq_ps(position_current, group.mPositionUser)));
+    group.mStopped = _mm_or_ps(group.mStopped, at_rest);
+    active = _mm_andnot_ps(at_rest, active);
+    if (!_mm_movemask_ps(active))
+    {
+        // the lanes that have steps left are all stopped
+        group.mDone = true;
+        return;
+    }
+
+    // Same order as the per param loop:
+    // accel + gravity + spring + damping + drag
+    LLVector4a spring_length;
+    spring_length.setSub(position_current, group.mPositionUser);
+    LLVector4a force_spring;
+    force_spring.setMul(spring_length, group.mSpring);
+    LLVector4a force_damping;
+    force_damping.setMul(group.mDamping, velocity);
+
+    LLVector4a force_net;
+    force_net.setAdd(group.mForce, force_spring);
+    force_net.add(force_damping);
+    force_net.add(group.mForceDrag);
+
+    LLVector4a acceleration_new;
+    acceleration_new.setDiv(force_net, group.mMass);
+
+    LLVector4a velocity_new;
+    velocity_new.setMul(acceleration_new, group.mTimeStep);
+    velocity_new.add(velocity);
+    velocity_new = _mm_min_ps(_mm_set1_ps(MAX_VELOCITY), _mm_max_ps(_mm_set1_ps(-MAX_VELOCITY), velocity_new));
+
+    LLVector4a position_new;
+    position_new.setMul(velocity_new, group.mTimeStep);
+    position_new.add(position_current);
+    position_new = select(group.mNoEffect, group.mPositionUser, position_new);
+
+    // Zero out the velocity if the param is being pushed beyond its limits
+    const LLQuad below = _mm_and_ps(_mm_cmplt_ps(position_new, zero), _mm_cmplt_ps(velocity_new, zero));
+    const LLQuad above = _mm_and_ps(_mm_cmpgt_ps(position_new, one), _mm_cmpgt_ps(velocity_new, zero));
+    velocity_new = _mm_andnot_ps(_mm_or_ps(below, above), velocity_new);
+
+    // NaN resets the position
+    const LLQuad nan = _mm_or_ps(_mm_or_ps(_mm_cmpunord_ps(position, position),
+                                           _mm_cmpunord_ps(velocity, velocity)),
+                                 _mm_cmpunord_ps(position_new, position_new));
+    position_new = _mm_andnot_ps(nan, position_new);
+    group.mReset = _mm_or_ps(group.mReset, _mm_and_ps(active, nan));
+
+    const LLVector4a position_new_clamped(_mm_min_ps(one, _mm_max_ps(zero, position_new)));
+
+    LLVector4a position_diff;
+    position_diff.setSub(group.mPositionLastUpdate, position_new_clamped);
+    position_diff.setAbs(position_diff);
+    const LLQuad update = _mm_and_ps(active, _mm_cmpgt_ps(position_diff, group.mMinDelta));
+    group.mUpdateVisuals = _mm_or_ps(group.mUpdateVisuals, update);
+    group.mPositionLastUpdate = select(update, position_new, group.mPositionLastUpdate);
+
+    group.mPosition = select(active, position_new, position);
+    group.mVelocity = select(active, velocity_new, velocity);
+    group.mPositionClamped = select(active, position_new_clamped, group.mPositionClamped);
+    group.mStepsDone.add(_mm_and_ps(active, one));
+}
+
+//-----------------------------------------------------------------------------
+// storeGroup()
+//-----------------------------------------------------------------------------
+// static
+void LLPhysicsMotionSolver::storeGroup(const Group& group, Result* results)
+{
+    LLQuad row0 = group.mPosition;
+    LLQuad row1 = group.mVelocity;
+    LLQuad row2 = group.mPositionLastUpdate;
+    LLQuad row3 = group.mPositionClamped;
+    _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+    _mm_storeu_ps(&results[0].mPosition, row0);
+    _mm_storeu_ps(&results[1].mPosition, row1);
+    _mm_storeu_ps(&results[2].mPosition, row2);
+    _mm_storeu_ps(&results[3].mPosition, row3);
+
+    LL_ALIGN_16(S32 steps_done[4]);
+    _mm_store_si128((__m128i*)steps_done, _mm_cvttps_epi32(group.mStepsDone));
+    const U32 stopped = _mm_movemask_ps(group.mStopped);
+    const U32 update_visuals = _mm_movemask_ps(group.mUpdateVisuals);
+    const U32 reset = _mm_movemask_ps(group.mReset);
+    for (U32 lane = 0; lane < 4; lane++)
+    {
+        Result& result = results[lane];
+        result.mStepsDone = steps_done[lane];
+        result.mStopped = (stopped >> lane) & 1;
+        result.mUpdateVisuals = (update_visuals >> lane) & 1;
+        result.mReset = (reset >> lane) & 1;
+    }
+}
@@ -0,0 +1,137 @@
+/**
+ * @file llphysicsmotionsolver.h
+ * @brief Batched spring integration of avatar physics params.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPHYSICSMOTIONSOLVER_H
+#define LL_LLPHYSICSMOTIONSOLVER_H
+
+#include <vector>
+
+#include "llmath.h"
+#include "llvector4a.h"
+
+//-----------------------------------------------------------------------------
+// class LLPhysicsMotionSolver
+//
+// The spring-damper integration of the avatar physics params (breast, belly
+// and butt bounce) of LLPhysicsMotion in the viewer.  Params are added with
+// the forces of their joint already worked out, then integrate() steps them
+// four at a time, each with its own time step and step count, and the
+// results are read back by the index addParam() returned.  The arithmetic
+// is the same as the per param loop, in the same order.  Any number of
+// params can be added, from one avatar or from many.
+//-----------------------------------------------------------------------------
+class LLPhysicsMotionSolver
+{
+public:
+    // One param for one frame.  Everything but the state is constant over
+    // the steps.  The F32 fields are loaded four at a time, keep them in
+    // this order.
+    struct Param
+    {
+        // state, normalized to [0,1]
+        F32     mPosition;
+        F32     mVelocity;
+        F32     mPositionLastUpdate;    // position the visual params were last updated at
+        F32     mPositionUser;          // rest position set by the user
+
+        F32     mForce;                 // torso acceleration plus gravity
+        F32     mForceDrag;
+        F32     mSpring;
+        F32     mDamping;
+
+        F32     mMass;
+        F32     mMaxEffect;
+        F32     mMinDelta;              // movement that updates the visual params, F32_MAX for never
+        F32     mTimeStep;
+
+        U32     mSteps;
+    };
+
+    struct Result
+    {
+        F32     mPosition;
+        F32     mVelocity;
+        F32     mPositionLastUpdate;
+        F32     mPositionClamped;       // of the last step, for the visual params
+
+        U32     mStepsDone;
+        bool    mStopped;               // effect off and at rest, stopped before mSteps
+        bool    mUpdateVisuals;         // moved more than mMinDelta
+        bool    mReset;                 // state went NaN and was reset
+    };
+
+    LLPhysicsMotionSolver();
+
+    void clear();
+    S32 addParam(const Param& param) { mParams.push_back(param); return mNumParams++; }
+    // Adds all the params of other, returns the index of the first
+    S32 addParams(const LLPhysicsMotionSolver& other);
+    S32 getNumParams() const { return mNumParams; }
+
+    void integrate();
+
+    // Valid after integrate()
+    const Result& getResult(S32 index) const { return mResults[index]; }
+
+private:
+    // Four params, one per lane
+    struct Group
+    {
+        LLVector4a  mPosition;
+        LLVector4a  mVelocity;
+        LLVector4a  mPositionLastUpdate;
+        LLVector4a  mPositionUser;
+        LLVector4a  mForce;
+        LLVector4a  mForceDrag;
+        LLVector4a  mSpring;                // negated
+        LLVector4a  mDamping;               // negated
+        LLVector4a  mMass;
+        LLVector4a  mMinDelta;
+        LLVector4a  mTimeStep;
+        LLVector4a  mSteps;
+        LLVector4a  mNoEffect;              // mask
+
+        LLVector4a  mPositionClamped;
+        LLVector4a  mStepsDone;
+        LLVector4a  mStopped;               // masks
+        LLVector4a  mUpdateVisuals;
+        LLVector4a  mReset;
+
+        U32         mMaxSteps;
+        bool        mDone;
+    };
+
+    static void loadGroup(const Param* params, Group& group);
+    static void stepGroup(Group& group);
+    static void storeGroup(const Group& group, Result* results);
+
+    std::vector<Param>  mParams;
+    std::vector<Result> mResults;
+    std::vector<Group>  mGroups;
+    S32                 mNumParams;
+};
+
+#endif // LL_LLPHYSICSMOTIONSOLVER_H
@@ -0,0 +1,319 @@
+/**
+ * @file llcharacterupdatescheduler_test.cpp
+ * @brief Test cases for the budgeted character update scheduler
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include <vector>
+
+#include "../llcharacterupdatescheduler.h"
+#include "llmath.h"
+#include "lltrace.h"
+#include "lltracerecording.h"
+#include "lltracethreadrecorder.h"
+
+#include "../test/lltut.h"
+#include "../test/benchmark.h"
+
+namespace
+{
+    // An avatar of the simulated crowd.  Impostors only ask every
+    // mPeriod frames, like LLVOAvatar::computeNeedsUpdate(), or again the
+    // next frame after they were put off.
+    struct SimAvatar
+    {
+        LLUUID mID;
+        F64Seconds mCost;
+        F32 mPixelArea;
+        U32 mInterest;
+        U32 mPeriod;
+        bool mDeferred = false;
+
+        U32 mUpdates = 0;
+        U32 mLastUpdate = 0;
+        U32 mLongestWait = 0;   // frames between two updates
+    };
+
+    class Crowd
+    {
+    public:
+        Crowd(S32 count, S32 impostors)
+        {
+            for (S32 i = 0; i < count; i++)
+            {
+                SimAvatar avatar;
+                avatar.mID.generate();
+                avatar.mCost = F64Milliseconds(0.2 + 0.1 * (i % 13));
+                avatar.mPixelArea = 200.f + 5000.f * (F32)((i * 7) % count) / (F32)count;
+                avatar.mInterest = LLCharacterUpdateScheduler::INTEREST_NONE;
+                avatar.mPeriod = i < count - impostors ? 1 : 8;
+                mAvatars.push_back(avatar);
+            }
+        }
+
+        // One frame of LLViewerObjectList::update(), returns the time spent
+        // in full updates
+        F64Seconds runFrame(LLCharacterUpdateScheduler& scheduler, U32 frame)
+        {
+            F64Seconds spent(0.0);
+            scheduler.beginFrame();
+            for (SimAvatar& avatar : mAvatars)
+            {
+                if (!avatar.mDeferred && (frame % avatar.mPeriod) != 0)
+                {
+                    continue;
+                }
+                avatar.mDeferred = !scheduler.requestUpdate(avatar.mID, avatar.mPixelArea, avatar.mInterest);
+                if (!avatar.mDeferred)
+                {
+                    if (avatar.mUpdates)
+                    {
+                        avatar.mLongestWait = llmax(avatar.mLongestWait, frame - avatar.mLastUpdate);
+                    }
+                    avatar.mUpdates++;
+                    avatar.mLastUpdate = frame;
+                    spent += avatar.mCost;
+                    scheduler.recordUpdate(avatar.mID, avatar.mCost);
+                }
+            }
+            return spent;
+        }
+
+        bool allUpdated() const
+        {
+            for (const SimAvatar& avatar : mAvatars)
+            {
+                if (!avatar.mUpdates)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        F64Seconds getTotalCost() const
+        {
+            F64Seconds total(0.0);
+            for (const SimAvatar& avatar : mAvatars)
+            {
+                total += avatar.mCost;
+            }
+            return total;
+        }
+
+        std::vector<SimAvatar> mAvatars;
+    };
+}
+
+namespace tut
+{
+    struct characterupdatescheduler
+    {
+        LLTrace::ThreadRecorder mRecorder;
+    };
+    typedef test_group<characterupdatescheduler> characterupdatescheduler_t;
+    typedef characterupdatescheduler_t::object characterupdatescheduler_object_t;
+    tut::characterupdatescheduler_t tut_characterupdatescheduler("LLCharacterUpdateScheduler");
+
+    // without a budget every request gets its update
+    template<> template<>
+    void characterupdatescheduler_object_t::test<1>()
+    {
+        Crowd crowd(30, 10);
+        LLCharacterUpdateScheduler scheduler;
+        for (U32 frame = 0; frame < 64; frame++)
+        {
+            crowd.runFrame(scheduler, frame);
+            ensure_equals("nothing put off", scheduler.getNumDeferred(), 0U);
+        }
+        for (const SimAvatar& avatar : crowd.mAvatars)
+        {
+            ensure_equals("updated on its period", avatar.mUpdates, 64 / avatar.mPeriod);
+            ensure("cost known", is_approx_equal((F32)scheduler.getUpdateCost(avatar.mID).value(), (F32)avatar.mCost.value()));
+        }
+    }
+
+    // a crowd costing several times the budget stays within it, and
+    // everyone still gets updated now and then
+    template<> template<>
+    void characterupdatescheduler_object_t::test<2>()
+    {
+        Crowd crowd(60, 20);
+        const F64Seconds budget = F64Milliseconds(6.0);
+        ensure("crowd over budget", crowd.getTotalCost() > budget * 3.0);
+
+        LLCharacterUpdateScheduler scheduler;
+        scheduler.setBudget(budget);
+        scheduler.setMaxDeferredFrames(1000);
+
+        const U32 frames = 400;
+        F64Seconds worst(0.0);
+        F64Seconds total(0.0);
+        U32 deferred = 0;
+        for (U32 frame = 0; frame < frames; frame++)
+        {
+            // until everyone was updated once, some costs are guesses
+            const bool costs_known = crowd.allUpdated();
+            F64Seconds spent = crowd.runFrame(scheduler, frame);
+            if (costs_known)
+            {
+                worst = llmax(worst, spent);
+                ensure("within budget", spent <= budget + F64Seconds(1e-9));
+                ensure("estimate matches", is_approx_equal((F32)spent.value(), (F32)scheduler.getGrantedCost().value()));
+            }
+            total += spent;
+            deferred += scheduler.getNumDeferred();
+        }
+        ensure("some put off", deferred > 0);
+
+        U32 longest_wait = 0;
+        for (const SimAvatar& avatar : crowd.mAvatars)
+        {
+            ensure("updated", avatar.mUpdates > 1);
+            longest_wait = llmax(longest_wait, avatar.mLongestWait);
+        }
+
+        ensure("worst within budget", worst <= budget + F64Seconds(1e-9));
+
+        Benchmark bench("Character updates");
+        bench.report(crowd.mAvatars.size(), " avatars costing ", F64Milliseconds(crowd.getTotalCost()).value(),
+                     " ms, budget ", F64Milliseconds(budget).value(), " ms: worst frame ",
+                     F64Milliseconds(worst).value(), " ms, average ", F64Milliseconds(total).value() / frames,
+                     " ms, ", deferred, " updates put off, longest wait ", longest_wait, " frames");
+    }
+
+    // nobody waits longer than the limit, even if that goes over budget
+    template<> template<>
+    void characterupdatescheduler_object_t::test<3>()
+    {
+        Crowd crowd(60, 0);
+        LLCharacterUpdateScheduler scheduler;
+        scheduler.setBudget(F64Milliseconds(4.0));
+        scheduler.setMaxDeferredFrames(5);
+
+        for (U32 frame = 0; frame < 200; frame++)
+        {
+            crowd.runFrame(scheduler, frame);
+        }
+        for (const SimAvatar& avatar : crowd.mAvatars)
+        {
+            ensure("waits bounded", avatar.mLongestWait <= 6);
+        }
+    }
+
+    // what the user is looking at or talking to comes first
+    template<> template<>
+    void characterupdatescheduler_object_t::test<4>()
+    {
+        Crowd crowd(40, 0);
+        SimAvatar& focus = crowd.mAvatars[0];
+        focus.mPixelArea = 10.f;
+        focus.mInterest = LLCharacterUpdateScheduler::INTEREST_FOCUS;
+        SimAvatar& small = crowd.mAvatars[1];
+        small.mPixelArea = 10.f;
+        SimAvatar& large = crowd.mAvatars[2];
+        large.mPixelArea = 20000.f;
+        SimAvatar& quiet = crowd.mAvatars[3];
+        quiet.mPixelArea = 1000.f;
+        SimAvatar& chatting = crowd.mAvatars[4];
+        chatting.mPixelArea = 1000.f;
+        chatting.mInterest = LLCharacterUpdateScheduler::INTEREST_CHATTING;
+        chatting.mCost = quiet.mCost;
+
+        LLCharacterUpdateScheduler scheduler;
+        scheduler.setBudget(F64Milliseconds(3.0));
+        scheduler.setMaxDeferredFrames(30);
+
+        const U32 frames = 100;
+        for (U32 frame = 0; frame < frames; frame++)
+        {
+            crowd.runFrame(scheduler, frame);
+        }
+        ensure_equals("focus every frame", focus.mUpdates, frames);
+        ensure("large before small", large.mUpdates > small.mUpdates);
+        ensure("chatting before quiet", chatting.mUpdates > quiet.mUpdates);
+        ensure("small not starved", small.mUpdates > 1);
+    }
+
+    // costs and put off updates go to LLTrace
+    template<> template<>
+    void characterupdatescheduler_object_t::test<5>()
+    {
+        typedef LLTrace::StatType<LLTrace::EventAccumulator> event_stat_t;
+        typedef LLTrace::StatType<LLTrace::CountAccumulator> count_stat_t;
+        auto cost_stat = event_stat_t::getInstance("characterupdatecost");
+        auto deferred_stat = count_stat_t::getInstance("characterupdatesdeferred");
+        ensure("cost stat", cost_stat != nullptr);
+        ensure("deferred stat", deferred_stat != nullptr);
+
+        Crowd crowd(20, 0);
+        LLCharacterUpdateScheduler scheduler;
+        scheduler.setBudget(F64Milliseconds(2.0));
+
+        LLTrace::Recording recording;
+        recording.start();
+        U32 updates = 0;
+        U32 deferred = 0;
+        for (U32 frame = 0; frame < 20; frame++)
+        {
+            crowd.runFrame(scheduler, frame);
+            updates += scheduler.getNumGranted();
+            deferred += scheduler.getNumDeferred();
+        }
+        recording.stop();
+
+        ensure_equals("updates recorded", recording.getSampleCount(*cost_stat), (S32)updates);
+        ensure_equals("put off counted", (U32)recording.getSum(*deferred_stat), deferred);
+    }
+
+    // a character that becomes urgent after the plan still gets its update,
+    // as often as it asks
+    template<> template<>
+    void characterupdatescheduler_object_t::test<6>()
+    {
+        LLUUID large_id;
+        large_id.generate();
+        LLUUID small_id;
+        small_id.generate();
+
+        LLCharacterUpdateScheduler scheduler;
+        scheduler.setBudget(F64Milliseconds(1.0));
+        scheduler.setMaxDeferredFrames(30);
+
+        // learn the costs, only one fits the budget
+        scheduler.beginFrame();
+        ensure("large granted", scheduler.requestUpdate(large_id, 5000.f, LLCharacterUpdateScheduler::INTEREST_NONE));
+        scheduler.recordUpdate(large_id, F64Milliseconds(0.8));
+        scheduler.requestUpdate(small_id, 10.f, LLCharacterUpdateScheduler::INTEREST_NONE);
+        scheduler.recordUpdate(small_id, F64Milliseconds(0.8));
+
+        // the plan leaves the small one out, until the user focuses on it
+        scheduler.beginFrame();
+        ensure("large planned", scheduler.requestUpdate(large_id, 5000.f, LLCharacterUpdateScheduler::INTEREST_NONE));
+        ensure("large only once", !scheduler.requestUpdate(large_id, 5000.f, LLCharacterUpdateScheduler::INTEREST_NONE));
+        ensure("urgent granted", scheduler.requestUpdate(small_id, 10.f, LLCharacterUpdateScheduler::INTEREST_FOCUS));
+        ensure("urgent granted again", scheduler.requestUpdate(small_id, 10.f, LLCharacterUpdateScheduler::INTEREST_FOCUS));
+    }
+}
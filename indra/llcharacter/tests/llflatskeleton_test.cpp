@@ -0,0 +1,284 @@
+/**
+ * @file llflatskeleton_test.cpp
+ * @brief Test cases for the flattened joint hierarchy
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include <memory>
+#include <vector>
+
+#include "../llflatskeleton.h"
+#include "../lljoint.h"
+#include "llmatrix4a.h"
+#include "stringize.h"
+
+#include "../test/lltut.h"
+#include "../test/benchmark.h"
+
+namespace
+{
+    // A skeleton shaped like the bento one: body, face, hands, wings, tail
+    // and hind limbs, plus collision volumes and attachment points as
+    // leaves, and a subtree with mUpdateXform off like mScreenp.
+    class TestSkeleton
+    {
+    public:
+        TestSkeleton()
+        {
+            mRoot = add(NULL);
+            LLJoint* pelvis = add(mRoot);
+            LLJoint* chest = chain(pelvis, 2);
+            LLJoint* head = chain(chest, 2);
+            for (S32 i = 0; i < 20; i++)
+            {
+                chain(head, 1 + i % 3);     // 40 face bones
+            }
+            for (S32 side = 0; side < 2; side++)
+            {
+                LLJoint* wrist = chain(chest, 4);
+                for (S32 finger = 0; finger < 5; finger++)
+                {
+                    chain(wrist, 3);
+                }
+                chain(pelvis, 5);           // leg
+                chain(pelvis, 5);           // hind limb
+                LLJoint* wing = chain(chest, 5);
+                chain(wing, 4);
+            }
+            chain(pelvis, 6);               // tail
+            mNumBones = (S32)mJoints.size();
+
+            // collision volumes and attachment points on every few bones
+            for (S32 i = 1; i < mNumBones; i += 5)
+            {
+                add(mJoints[i].get());
+            }
+            for (S32 i = 2; i < mNumBones; i += 3)
+            {
+                add(mJoints[i].get());
+            }
+
+            mJoints.emplace_back(new LLJoint("mScreen", mRoot));
+            add(mJoints.back().get());
+
+            for (size_t i = 0; i < mJoints.size(); i++)
+            {
+                LLJoint* joint = mJoints[i].get();
+                joint->setJointNum((S32)i);
+                joint->setPosition(LLVector3(0.01f*(i % 7), 0.1f + 0.005f*(i % 11), 0.02f*(i % 5) - 0.04f));
+                if (i % 9 == 4)
+                {
+                    joint->setScale(LLVector3(1.1f, 0.9f, 1.05f));
+                }
+                if (i % 13 == 6)
+                {
+                    joint->getXform()->setScaleChildOffset(false);
+                }
+            }
+            animate(0.f);
+        }
+
+        // new local rotations for every bone, like a playing animation
+        void animate(F32 time)
+        {
+            for (S32 i = 0; i < mNumBones; i++)
+            {
+                const F32 t = time + 0.37f*i;
+                LLQuaternion rot(0.3f*sinf(t), 0.2f*cosf(1.3f*t), 0.25f*sinf(0.7f*t), 1.f);
+                rot.normalize();
+                mJoints[i]->setRotation(rot);
+            }
+        }
+
+        LLJoint* add(LLJoint* parent)
+        {
+            mJoints.emplace_back(new LLJoint());
+            LLJoint* joint = mJoints.back().get();
+            joint->setup(llformat("joint%d", (S32)mJoints.size()), parent);
+            return joint;
+        }
+
+        LLJoint* chain(LLJoint* parent, S32 length)
+        {
+            for (S32 i = 0; i < length; i++)
+            {
+                parent = add(parent);
+            }
+            return parent;
+        }
+
+        LLJoint* mRoot;
+        S32 mNumBones;
+        std::vector<std::unique_ptr<LLJoint>> mJoints;
+    };
+
+    F32 max_difference(const LLMatrix4& a, const LLMatrix4& b)
+    {
+        F32 diff = 0.f;
+        for (S32 row = 0; row < 4; row++)
+        {
+            for (S32 col = 0; col < 4; col++)
+            {
+                diff = llmax(diff, fabsf(a.mMatrix[row][col] - b.mMatrix[row][col]));
+            }
+        }
+        return diff;
+    }
+
+    // compares without updating anything
+    F32 max_difference(TestSkeleton& a, TestSkeleton& b)
+    {
+        F32 diff = 0.f;
+        for (size_t i = 0; i < a.mJoints.size(); i++)
+        {
+            LLJoint* ja = a.mJoints[i].get();
+            LLJoint* jb = b.mJoints[i].get();
+            diff = llmax(diff, max_difference(ja->getXform()->getWorldMatrix(), jb->getXform()->getWorldMatrix()));
+            diff = llmax(diff, (ja->getXform()->getWorldPosition() - jb->getXform()->getWorldPosition()).length());
+            if (ja->mDirtyFlags != jb->mDirtyFlags)
+            {
+                diff = llmax(diff, 1.f);
+            }
+        }
+        return diff;
+    }
+}
+
+namespace tut
+{
+    struct flatskeleton
+    {
+    };
+    typedef test_group<flatskeleton> flatskeleton_t;
+    typedef flatskeleton_t::object flatskeleton_object_t;
+    tut::flatskeleton_t tut_flatskeleton("LLFlatSkeleton");
+
+    // the linear pass matches updateWorldMatrixChildren()
+    template<> template<>
+    void flatskeleton_object_t::test<1>()
+    {
+        TestSkeleton recursive, flat;
+        LLFlatSkeleton flat_skeleton;
+
+        recursive.mRoot->updateWorldMatrixChildren();
+        flat_skeleton.updateWorldMatrices(flat.mRoot);
+        ensure_equals("joints", flat_skeleton.getNumJoints(), (S32)flat.mJoints.size());
+        ensure("first update", max_difference(recursive, flat) < 1e-6f);
+
+        // only the animated bones and what hangs off them are dirty
+        recursive.animate(1.f);
+        flat.animate(1.f);
+        recursive.mRoot->updateWorldMatrixChildren();
+        flat_skeleton.updateWorldMatrices(flat.mRoot);
+        ensure("animated", max_difference(recursive, flat) < 1e-6f);
+
+        // the mUpdateXform subtree was skipped by both
+        LLJoint* screen = flat.mJoints[flat.mJoints.size() - 2].get();
+        ensure("skipped", screen->mDirtyFlags & LLJoint::MATRIX_DIRTY);
+
+        // a joint moving to another parent rebuilds the order
+        LLJoint* joint = flat.mJoints[10].get();
+        ensure_equals("indexed", flat_skeleton.getJoint(10), joint);
+        for (TestSkeleton* skeleton : { &recursive, &flat })
+        {
+            skeleton->mJoints[5]->addChild(skeleton->mJoints[10].get());
+        }
+        ensure("stale", !flat_skeleton.isCurrent(flat.mRoot));
+        ensure("no stale lookups", flat_skeleton.getJoint(10) == NULL);
+        recursive.mRoot->updateWorldMatrixChildren();
+        flat_skeleton.updateWorldMatrices(flat.mRoot);
+        ensure("reparented", max_difference(recursive, flat) < 1e-6f);
+        ensure_equals("indexed again", flat_skeleton.getJoint(10), joint);
+    }
+
+    // world matrices and a 110 joint skinning palette for a crowd of avatars
+    // with bento sized skeletons, animated every frame, match either way
+    template<> template<>
+    void flatskeleton_object_t::test<2>()
+    {
+        const S32 avatars = Benchmark::size(128, 4);
+        const S32 frames = Benchmark::size(60, 3);
+        const S32 palette_joints = 110;
+        std::vector<std::unique_ptr<TestSkeleton>> recursive, flat;
+        std::vector<LLFlatSkeleton> flat_skeletons(avatars);
+        for (S32 i = 0; i < avatars; i++)
+        {
+            recursive.emplace_back(new TestSkeleton());
+            flat.emplace_back(new TestSkeleton());
+        }
+        const S32 joints = (S32)flat[0]->mJoints.size();
+
+        LL_ALIGN_16(LLMatrix4a inv_bind);
+        inv_bind.setIdentity();
+        std::vector<LLMatrix4a> palette(palette_joints);
+
+        Benchmark bench(stringize("World matrices and palettes, ", avatars, " avatars of ", joints,
+                                  " joints, ms per frame"));
+        F64 recursive_ms = 0.0;
+        F64 flat_ms = 0.0;
+        for (S32 frame = 0; frame < frames; frame++)
+        {
+            const F32 time = frame/30.f;
+            for (S32 i = 0; i < avatars; i++)
+            {
+                recursive[i]->animate(time + i);
+                flat[i]->animate(time + i);
+            }
+
+            bench.start();
+            for (S32 i = 0; i < avatars; i++)
+            {
+                TestSkeleton& skeleton = *recursive[i];
+                skeleton.mRoot->updateWorldMatrixChildren();
+                for (S32 j = 0; j < palette_joints; j++)
+                {
+                    matMulUnsafe(inv_bind, skeleton.mJoints[j]->getWorldMatrix4a(), palette[j]);
+                }
+            }
+            recursive_ms += bench.elapsed_ms();
+
+            bench.start();
+            for (S32 i = 0; i < avatars; i++)
+            {
+                flat_skeletons[i].updateWorldMatrices(flat[i]->mRoot);
+                for (S32 j = 0; j < palette_joints; j++)
+                {
+                    matMulUnsafe(inv_bind, flat_skeletons[i].getJoint(j)->getWorldMatrix4a(), palette[j]);
+                }
+            }
+            flat_ms += bench.elapsed_ms();
+        }
+
+        F32 diff = 0.f;
+        for (S32 i = 0; i < avatars; i++)
+        {
+            diff = llmax(diff, max_difference(*recursive[i], *flat[i]));
+        }
+        ensure("same matrices", diff < 1e-6f);
+
+        bench.report("recursive ", recursive_ms / frames);
+        bench.report("flat      ", flat_ms / frames);
+    }
+}
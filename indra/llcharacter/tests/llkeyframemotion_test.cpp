@@ -0,0 +1,642 @@
+/**
+ * @file llkeyframemotion_test.cpp
+ * @brief Test cases for the packed keyframe data of LLKeyframeMotion
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../llcharacter.h"
+#include "../llkeyframemotion.h"
+#include "lldatapacker.h"
+#include "llquantize.h"
+#include "stringize.h"
+#include "threadpool.h"
+
+#include "../test/lltut.h"
+#include "../test/benchmark.h"
+
+namespace
+{
+    const char* SKELETON[] =
+    {
+        "mPelvis", "mTorso", "mChest", "mNeck", "mHead",
+        "mCollarLeft", "mShoulderLeft", "mElbowLeft", "mWristLeft",
+        "mCollarRight", "mShoulderRight", "mElbowRight", "mWristRight",
+        "mHipLeft", "mKneeLeft", "mAnkleLeft",
+        "mHipRight", "mKneeRight", "mAnkleRight",
+    };
+    const S32 NUM_JOINTS = LL_ARRAY_SIZE(SKELETON);
+
+    class LLTestCharacter : public LLCharacter
+    {
+    public:
+        LLTestCharacter()
+        {
+            mID.generate();
+            mRoot.setName("mRoot");
+            for (S32 i = 0; i < NUM_JOINTS; i++)
+            {
+                mJoints.emplace_back(new LLJoint(SKELETON[i], i ? mJoints[0].get() : &mRoot));
+                mJoints.back()->setJointNum(i);
+            }
+        }
+
+        const char* getAnimationPrefix() override { return "avatar"; }
+        LLJoint* getRootJoint() override { return &mRoot; }
+        LLVector3 getCharacterPosition() override { return LLVector3::zero; }
+        LLQuaternion getCharacterRotation() override { return LLQuaternion::DEFAULT; }
+        LLVector3 getCharacterVelocity() override { return LLVector3::zero; }
+        LLVector3 getCharacterAngularVelocity() override { return LLVector3::zero; }
+        void getGround(const LLVector3& in_pos, LLVector3& out_pos, LLVector3& out_norm) override
+        {
+            out_pos = in_pos;
+            out_norm = LLVector3::z_axis;
+        }
+        LLJoint* getCharacterJoint(U32 i) override { return i < (U32)NUM_JOINTS ? mJoints[i].get() : NULL; }
+        F32 getTimeDilation() override { return 1.f; }
+        F32 getPixelArea() const override { return 100000.f; }
+        LLPolyMesh* getHeadMesh() override { return NULL; }
+        LLPolyMesh* getUpperBodyMesh() override { return NULL; }
+        LLVector3d getPosGlobalFromAgent(const LLVector3& position) override { return LLVector3d(position); }
+        LLVector3 getPosAgentFromGlobal(const LLVector3d& position) override { return LLVector3(position); }
+        void addDebugText(const std::string& text) override {}
+        const LLUUID& getID() const override { return mID; }
+
+    private:
+        LLUUID mID;
+        LLJoint mRoot;
+        std::vector<std::unique_ptr<LLJoint>> mJoints;
+    };
+
+    // A captured clip in the .anim format: every joint keyed at 30 fps,
+    // the pelvis moving too.  The head turns through more than a full
+    // circle, so some of its neighbouring keys are in opposite hemispheres.
+    std::vector<U8> record_animation(S32 seed, F32 duration)
+    {
+        const S32 frames = (S32)(duration*30.f) + 1;
+        std::vector<U8> buffer(128 + NUM_JOINTS*(32 + frames*16));
+        LLDataPackerBinaryBuffer dp(buffer.data(), (S32)buffer.size());
+        dp.packU16(KEYFRAME_MOTION_VERSION, "version");
+        dp.packU16(KEYFRAME_MOTION_SUBVERSION, "sub_version");
+        dp.packS32(LLJoint::MEDIUM_PRIORITY, "base_priority");
+        dp.packF32(duration, "duration");
+        dp.packString("", "emote_name");
+        dp.packF32(0.f, "loop_in_point");
+        dp.packF32(duration, "loop_out_point");
+        dp.packS32(0, "loop");
+        dp.packF32(0.3f, "ease_in_duration");
+        dp.packF32(0.3f, "ease_out_duration");
+        dp.packU32(0, "hand_pose");
+        dp.packU32(NUM_JOINTS, "num_joints");
+        for (S32 joint = 0; joint < NUM_JOINTS; joint++)
+        {
+            dp.packString(SKELETON[joint], "joint_name");
+            dp.packS32(LLJoint::MEDIUM_PRIORITY, "joint_priority");
+            // a joint with a single key holds still
+            const S32 rot_keys = joint == 12 ? 1 : frames;
+            dp.packS32(rot_keys, "num_rot_keys");
+            for (S32 frame = 0; frame < rot_keys; frame++)
+            {
+                const F32 t = rot_keys > 1 ? (F32)frame/(F32)(rot_keys - 1) : 0.5f;
+                const F32 angle = joint == 4 ? 2.6f*F_TWO_PI*t : 0.4f*sinf(F_TWO_PI*t + 0.37f*(seed + joint));
+                LLQuaternion rot(angle, LLVector3(sinf(seed + 1.3f*joint), cosf(0.7f*joint), 0.5f));
+                LLVector3 angles = rot.packToVector3();
+                dp.packU16(F32_to_U16(t*duration, 0.f, duration), "time");
+                dp.packU16(F32_to_U16(angles.mV[VX], -1.f, 1.f), "rot_angle_x");
+                dp.packU16(F32_to_U16(angles.mV[VY], -1.f, 1.f), "rot_angle_y");
+                dp.packU16(F32_to_U16(angles.mV[VZ], -1.f, 1.f), "rot_angle_z");
+            }
+            const S32 pos_keys = joint == 0 ? frames/3 + 1 : 0;
+            dp.packS32(pos_keys, "num_pos_keys");
+            for (S32 frame = 0; frame < pos_keys; frame++)
+            {
+                const F32 t = (F32)frame/(F32)(pos_keys - 1);
+                dp.packU16(F32_to_U16(t*duration, 0.f, duration), "time");
+                dp.packU16(F32_to_U16(0.3f*sinf(F_TWO_PI*t), -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET), "pos_x");
+                dp.packU16(F32_to_U16(0.1f*seed, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET), "pos_y");
+                dp.packU16(F32_to_U16(-0.05f*cosf(2.f*F_TWO_PI*t), -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET), "pos_z");
+            }
+        }
+        dp.packS32(0, "num_constraints");
+        buffer.resize(dp.getCurrentSize());
+        return buffer;
+    }
+
+    // The curves as LLKeyframeMotion kept them before the keys were
+    // packed: a map per joint, read back the way deserialize() did
+    struct ReferenceClip
+    {
+        std::vector<std::map<F32, LLQuaternion>> mRotations;
+        std::map<F32, LLVector3> mPelvis;
+
+        ReferenceClip(const std::vector<U8>& data)
+        {
+            LLDataPackerBinaryBuffer dp(const_cast<U8*>(data.data()), (S32)data.size());
+            U16 version, sub_version;
+            S32 priority, loop, num_keys;
+            F32 duration, loop_in, loop_out, ease_in, ease_out;
+            U32 hand_pose, num_joints;
+            std::string name;
+            dp.unpackU16(version, "version");
+            dp.unpackU16(sub_version, "sub_version");
+            dp.unpackS32(priority, "base_priority");
+            dp.unpackF32(duration, "duration");
+            dp.unpackString(name, "emote_name");
+            dp.unpackF32(loop_in, "loop_in_point");
+            dp.unpackF32(loop_out, "loop_out_point");
+            dp.unpackS32(loop, "loop");
+            dp.unpackF32(ease_in, "ease_in_duration");
+            dp.unpackF32(ease_out, "ease_out_duration");
+            dp.unpackU32(hand_pose, "hand_pose");
+            dp.unpackU32(num_joints, "num_joints");
+            mRotations.resize(num_joints);
+            for (U32 joint = 0; joint < num_joints; joint++)
+            {
+                dp.unpackString(name, "joint_name");
+                dp.unpackS32(priority, "joint_priority");
+                dp.unpackS32(num_keys, "num_rot_keys");
+                for (S32 k = 0; k < num_keys; k++)
+                {
+                    U16 time, x, y, z;
+                    dp.unpackU16(time, "time");
+                    dp.unpackU16(x, "rot_angle_x");
+                    dp.unpackU16(y, "rot_angle_y");
+                    dp.unpackU16(z, "rot_angle_z");
+                    LLQuaternion rot;
+                    rot.unpackFromVector3(LLVector3(U16_to_F32(x, -1.f, 1.f), U16_to_F32(y, -1.f, 1.f), U16_to_F32(z, -1.f, 1.f)));
+                    mRotations[joint][U16_to_F32(time, 0.f, duration)] = rot;
+                }
+                dp.unpackS32(num_keys, "num_pos_keys");
+                for (S32 k = 0; k < num_keys; k++)
+                {
+                    U16 time, x, y, z;
+                    dp.unpackU16(time, "time");
+                    dp.unpackU16(x, "pos_x");
+                    dp.unpackU16(y, "pos_y");
+                    dp.unpackU16(z, "pos_z");
+                    mPelvis[U16_to_F32(time, 0.f, duration)] = LLVector3(U16_to_F32(x, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET),
+                                                                         U16_to_F32(y, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET),
+                                                                         U16_to_F32(z, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET));
+                }
+            }
+        }
+
+        // RotationCurve::getValue() and PositionCurve::getValue()
+        template <typename T>
+        static T getValue(const std::map<F32, T>& keys, F32 time)
+        {
+            auto right = keys.lower_bound(time);
+            if (right == keys.end())
+            {
+                return (--right)->second;
+            }
+            if (right == keys.begin() || right->first == time)
+            {
+                return right->second;
+            }
+            auto left = right;
+            --left;
+            const F32 u = (time - left->first) / (right->first - left->first);
+            return interp(u, left->second, right->second);
+        }
+
+        static LLQuaternion interp(F32 u, const LLQuaternion& a, const LLQuaternion& b) { return nlerp(u, a, b); }
+        static LLVector3 interp(F32 u, const LLVector3& a, const LLVector3& b) { return lerp(a, b, u); }
+    };
+
+    F32 difference(const LLQuaternion& a, const LLQuaternion& b)
+    {
+        F32 diff = 0.f;
+        for (S32 i = 0; i < 4; i++)
+        {
+            diff = llmax(diff, fabsf(a.mQ[i] - b.mQ[i]));
+        }
+        return diff;
+    }
+
+    F32 difference(const LLVector3& a, const LLVector3& b)
+    {
+        return llmax(fabsf(a.mV[VX] - b.mV[VX]), llmax(fabsf(a.mV[VY] - b.mV[VY]), fabsf(a.mV[VZ] - b.mV[VZ])));
+    }
+
+    bool same_ranges(const std::vector<LLKeyframeMotion::JointMotionList::KeyRange>& a,
+                     const std::vector<LLKeyframeMotion::JointMotionList::KeyRange>& b)
+    {
+        if (a.size() != b.size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); i++)
+        {
+            if (a[i].mFirst != b[i].mFirst || a[i].mCount != b[i].mCount)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Everything deserialize() fills in
+    bool same_motion_list(const LLKeyframeMotion::JointMotionList& a, const LLKeyframeMotion::JointMotionList& b)
+    {
+        if (a.mDuration != b.mDuration || a.mLoop != b.mLoop
+            || a.mLoopInPoint != b.mLoopInPoint || a.mLoopOutPoint != b.mLoopOutPoint
+            || a.mEaseInDuration != b.mEaseInDuration || a.mEaseOutDuration != b.mEaseOutDuration
+            || a.mBasePriority != b.mBasePriority || a.mMaxPriority != b.mMaxPriority
+            || a.mHandPose != b.mHandPose || a.mEmoteName != b.mEmoteName
+            || a.mConstraints.size() != b.mConstraints.size()
+            || a.getNumJointMotions() != b.getNumJointMotions())
+        {
+            return false;
+        }
+        for (U32 i = 0; i < a.getNumJointMotions(); i++)
+        {
+            const LLKeyframeMotion::JointMotion* joint_a = a.getJointMotion(i);
+            const LLKeyframeMotion::JointMotion* joint_b = b.getJointMotion(i);
+            if (joint_a->mJointName != joint_b->mJointName || joint_a->mUsage != joint_b->mUsage
+                || joint_a->mPriority != joint_b->mPriority)
+            {
+                return false;
+            }
+        }
+        return same_ranges(a.mRotationRanges, b.mRotationRanges)
+            && same_ranges(a.mPositionRanges, b.mPositionRanges)
+            && a.mRotationTimes == b.mRotationTimes && a.mRotationKeys == b.mRotationKeys
+            && a.mPositionTimes == b.mPositionTimes && a.mPositionKeys == b.mPositionKeys
+            && a.mPelvisBBox.getMin() == b.mPelvisBBox.getMin()
+            && a.mPelvisBBox.getMax() == b.mPelvisBBox.getMax();
+    }
+
+    // Polls the motions like LLMotionController::updateLoadingMotions()
+    // until none is waiting, returns how many loaded
+    S32 finish_loading(const std::vector<std::pair<LLKeyframeMotion*, LLCharacter*>>& motions)
+    {
+        std::vector<LLMotion::LLMotionInitStatus> status(motions.size(), LLMotion::STATUS_HOLD);
+        S32 waiting = (S32)motions.size();
+        while (waiting)
+        {
+            waiting = 0;
+            for (size_t i = 0; i < motions.size(); i++)
+            {
+                if (status[i] == LLMotion::STATUS_HOLD)
+                {
+                    status[i] = motions[i].first->onInitialize(motions[i].second);
+                    waiting += status[i] == LLMotion::STATUS_HOLD;
+                }
+            }
+            if (waiting)
+            {
+                std::this_thread::yield();
+            }
+        }
+        return (S32)std::count(status.begin(), status.end(), LLMotion::STATUS_SUCCESS);
+    }
+}
+
+namespace tut
+{
+    struct keyframemotion
+    {
+        LLTestCharacter mCharacter;
+
+        ~keyframemotion()
+        {
+            LLKeyframeMotion::setDecodeQueue("");
+            LLKeyframeDataCache::clear();
+        }
+
+        std::unique_ptr<LLKeyframeMotion> load(const std::vector<U8>& data)
+        {
+            LLUUID id;
+            id.generate();
+            std::unique_ptr<LLKeyframeMotion> motion(new LLKeyframeMotion(id));
+            motion->setCharacter(&mCharacter);
+            LLDataPackerBinaryBuffer dp(const_cast<U8*>(data.data()), (S32)data.size());
+            tut::ensure("deserialize", motion->deserialize(dp, id, false));
+            return motion;
+        }
+
+        // Starts a decode of data for character, onInitialize() finishes it
+        std::unique_ptr<LLKeyframeMotion> loadAsync(const LLUUID& id, const std::vector<U8>& data, LLCharacter* character)
+        {
+            std::unique_ptr<LLKeyframeMotion> motion(new LLKeyframeMotion(id));
+            motion->setCharacter(character);
+            motion->decodeAsync(data.data(), (S32)data.size(), id);
+            return motion;
+        }
+
+        // Plays the motion at each of times and compares every joint with
+        // the reference curves
+        F32 compare(LLKeyframeMotion& motion, const ReferenceClip& clip, const std::vector<F32>& times)
+        {
+            F32 diff = 0.f;
+            for (F32 time : times)
+            {
+                motion.onUpdate(time, NULL);
+                for (S32 joint = 0; joint < NUM_JOINTS; joint++)
+                {
+                    LLJointState* state = motion.getPose()->findJointState(SKELETON[joint]);
+                    tut::ensure("joint state", state != NULL);
+                    diff = llmax(diff, difference(state->getRotation(), ReferenceClip::getValue(clip.mRotations[joint], time)));
+                }
+                LLJointState* pelvis = motion.getPose()->findJointState("mPelvis");
+                diff = llmax(diff, difference(pelvis->getPosition(), ReferenceClip::getValue(clip.mPelvis, time)));
+            }
+            return diff;
+        }
+    };
+    typedef test_group<keyframemotion> keyframemotion_t;
+    typedef keyframemotion_t::object keyframemotion_object_t;
+    tut::keyframemotion_t tut_keyframemotion("LLKeyframeMotion");
+
+    // the packed keys sample like the curves they replaced, playing
+    // forward, backward and jumping around
+    template<> template<>
+    void keyframemotion_object_t::test<1>()
+    {
+        const F32 duration = 2.f;
+        std::vector<U8> data = record_animation(3, duration);
+        ReferenceClip clip(data);
+        std::unique_ptr<LLKeyframeMotion> motion = load(data);
+
+        std::vector<F32> forward, backward, jumps;
+        for (S32 frame = -3; frame < 140; frame++)
+        {
+            forward.push_back(frame*duration/128.f);
+        }
+        backward.assign(forward.rbegin(), forward.rend());
+        for (S32 i = 0; i < 200; i++)
+        {
+            jumps.push_back(fmodf(i*0.7371f, duration + 0.2f));
+        }
+        ensure("forward", compare(*motion, clip, forward) < 1e-5f);
+        ensure("backward", compare(*motion, clip, backward) < 1e-5f);
+        ensure("jumps", compare(*motion, clip, jumps) < 1e-5f);
+
+        // exactly on a key
+        const auto& head_keys = clip.mRotations[4];
+        std::vector<F32> on_keys;
+        for (const auto& key : head_keys)
+        {
+            on_keys.push_back(key.first);
+        }
+        ensure("on keys", compare(*motion, clip, on_keys) < 1e-5f);
+
+        // the curves' maps are gone, what is left is smaller than the keys were
+        LLKeyframeMotion::JointMotionList* list = LLKeyframeDataCache::getKeyframeData(motion->getID());
+        ensure("cached", list != NULL);
+        ensure("maps freed", list->getJointMotion(4)->mRotationCurve.mKeys.empty());
+        ensure_equals("head keys", list->mRotationRanges[4].mCount, (U32)head_keys.size());
+        ensure_equals("still joint", list->mRotationRanges[12].mCount, 1U);
+        ensure("single key", difference(list->getRotation(12, 1.3f), clip.mRotations[12].begin()->second) < 1e-5f);
+    }
+
+    // serializing the packed keys gives back an equivalent asset
+    template<> template<>
+    void keyframemotion_object_t::test<2>()
+    {
+        std::vector<U8> data = record_animation(1, 1.5f);
+        std::unique_ptr<LLKeyframeMotion> motion = load(data);
+        ensure_equals("file size", motion->getFileSize(), (U32)data.size());
+
+        std::vector<U8> saved(motion->getFileSize());
+        LLDataPackerBinaryBuffer dp(saved.data(), (S32)saved.size());
+        ensure("serialize", motion->serialize(dp));
+
+        ReferenceClip clip(data);
+        std::unique_ptr<LLKeyframeMotion> reloaded = load(saved);
+        std::vector<F32> times;
+        for (S32 frame = 0; frame <= 90; frame++)
+        {
+            times.push_back(frame/60.f);
+        }
+        ensure("reloaded", compare(*reloaded, clip, times) < 1e-3f);
+    }
+
+    // sampling through the packed keys gives what sampling through per joint
+    // maps would, and cached animations take less memory than the maps
+    template<> template<>
+    void keyframemotion_object_t::test<3>()
+    {
+        const S32 num_animations = Benchmark::size(1000, 20);
+        const F32 duration = 2.f;
+        std::vector<U8> data = record_animation(0, duration);
+        ReferenceClip clip(data);
+
+        size_t packed_bytes = 0;
+        size_t num_keys = 0;
+        std::unique_ptr<LLKeyframeMotion> motion;
+        for (S32 i = 0; i < num_animations; i++)
+        {
+            motion = load(i ? record_animation(i, duration) : data);
+            LLKeyframeMotion::JointMotionList* list = LLKeyframeDataCache::getKeyframeData(motion->getID());
+            packed_bytes += list->getMemoryUsage();
+            num_keys += list->mRotationTimes.size() + list->mPositionTimes.size();
+        }
+        // a map node is the key and value plus the tree links and color
+        const size_t map_key_bytes = sizeof(std::map<F32, LLKeyframeMotion::RotationKey>::value_type) + 4*sizeof(void*);
+        const size_t packed_key_bytes = sizeof(F32) + 4*sizeof(U16);
+
+        LLKeyframeMotion::JointMotionList* list = LLKeyframeDataCache::getKeyframeData(motion->getID());
+        std::vector<LLPointer<LLJointState>> states;
+        for (S32 joint = 0; joint < NUM_JOINTS; joint++)
+        {
+            states.push_back(new LLJointState);
+            states.back()->setUsage(LLJointState::ROT | LLJointState::POS);
+        }
+        std::vector<U32> cursors(NUM_JOINTS*2, 0);
+
+        const S32 frames = Benchmark::size(20000, 200);
+        const F32 step = 1.f/45.f;
+        Benchmark bench(stringize("Keyframe sampling, ", NUM_JOINTS, " joints, M joints/s"));
+        for (S32 frame = 0; frame < frames; frame++)
+        {
+            list->sampleKeys(fmodf(frame*step, duration), cursors.data(), states.data());
+        }
+        const F64 packed_ms = bench.elapsed_ms();
+        std::vector<LLQuaternion> packed;
+        for (S32 joint = 0; joint < NUM_JOINTS; joint++)
+        {
+            packed.push_back(states[joint]->getRotation());
+        }
+
+        F32 checksum = 0.f;
+        bench.start();
+        for (S32 frame = 0; frame < frames; frame++)
+        {
+            const F32 time = fmodf(frame*step, duration);
+            for (S32 joint = 0; joint < NUM_JOINTS; joint++)
+            {
+                states[joint]->setRotation(ReferenceClip::getValue(clip.mRotations[joint], time));
+            }
+            states[0]->setPosition(ReferenceClip::getValue(clip.mPelvis, time));
+            checksum += states[NUM_JOINTS - 1]->getRotation().mQ[VW];
+        }
+        const F64 map_ms = bench.elapsed_ms();
+        ensure("checksum", llfinite(checksum));
+        for (S32 joint = 0; joint < NUM_JOINTS; joint++)
+        {
+            // q and -q are the same rotation
+            ensure("same last frame", llabs(dot(packed[joint], states[joint]->getRotation())) > 0.9999f);
+        }
+        ensure("packed lists smaller", packed_bytes < num_keys*map_key_bytes);
+
+        const F64 samples = (F64)frames*NUM_JOINTS;
+        bench.report("packed ", samples/packed_ms/1000.0);
+        bench.report("maps   ", samples/map_ms/1000.0);
+        bench.report(num_animations, " cached animations: ", packed_bytes/1024, " KB packed (",
+                     num_keys*packed_key_bytes/1024, " KB of keys), keys in maps would take ",
+                     num_keys*map_key_bytes/1024, " KB");
+    }
+
+    // decoding a corpus on a thread pool gives the same motion lists as
+    // deserializing it serially, characters playing the same asset share
+    // its decode and bad data fails
+    template<> template<>
+    void keyframemotion_object_t::test<4>()
+    {
+        const S32 num_animations = 48;
+        std::vector<std::vector<U8>> corpus;
+        std::vector<std::unique_ptr<LLKeyframeMotion>> serial;
+        for (S32 i = 0; i < num_animations; i++)
+        {
+            corpus.push_back(record_animation(i, 0.5f + 0.25f*(i % 7)));
+            serial.push_back(load(corpus.back()));
+        }
+
+        LL::ThreadPool pool("KeyframeTest", 3);
+        pool.start();
+        LLKeyframeMotion::setDecodeQueue("KeyframeTest");
+
+        LLTestCharacter other;
+        std::vector<std::unique_ptr<LLKeyframeMotion>> parallel;
+        std::vector<std::pair<LLKeyframeMotion*, LLCharacter*>> loading;
+        for (S32 i = 0; i < num_animations; i++)
+        {
+            LLUUID id;
+            id.generate();
+            parallel.push_back(loadAsync(id, corpus[i], &mCharacter));
+            loading.emplace_back(parallel.back().get(), &mCharacter);
+            parallel.push_back(loadAsync(id, corpus[i], &other));
+            loading.emplace_back(parallel.back().get(), &other);
+        }
+        ensure_equals("all loaded", finish_loading(loading), 2*num_animations);
+        ensure_equals("one list per asset", LLKeyframeDataCache::sKeyframeDataMap.size(), (size_t)(2*num_animations));
+
+        for (S32 i = 0; i < num_animations; i++)
+        {
+            LLKeyframeMotion::JointMotionList* expected = LLKeyframeDataCache::getKeyframeData(serial[i]->getID());
+            LLKeyframeMotion::JointMotionList* actual = LLKeyframeDataCache::getKeyframeData(parallel[2*i]->getID());
+            ensure("decoded", expected && actual);
+            ensure("same as serial", same_motion_list(*expected, *actual));
+            ensure("other character loaded", parallel[2*i + 1]->isLoaded());
+            ensure("pose", parallel[2*i + 1]->getPose()->findJointState("mHead") != NULL);
+        }
+
+        // truncated, and garbage after the version
+        LLUUID truncated_id, garbage_id;
+        truncated_id.generate();
+        garbage_id.generate();
+        std::vector<U8> truncated(corpus[0].begin(), corpus[0].begin() + corpus[0].size()/2);
+        std::vector<U8> garbage(300, 0xa5);
+        std::copy(corpus[0].begin(), corpus[0].begin() + 4, garbage.begin());
+        std::unique_ptr<LLKeyframeMotion> bad = loadAsync(truncated_id, truncated, &mCharacter);
+        std::unique_ptr<LLKeyframeMotion> worse = loadAsync(garbage_id, garbage, &mCharacter);
+        ensure_equals("bad data fails", finish_loading({ { bad.get(), &mCharacter }, { worse.get(), &mCharacter } }), 0);
+        ensure("not cached", !LLKeyframeDataCache::getKeyframeData(truncated_id) && !LLKeyframeDataCache::getKeyframeData(garbage_id));
+        ensure("failure sticks", bad->onInitialize(&mCharacter) == LLMotion::STATUS_FAILURE);
+
+        // without a queue the decode happens right away
+        LLKeyframeMotion::setDecodeQueue("");
+        LLUUID inline_id;
+        inline_id.generate();
+        std::unique_ptr<LLKeyframeMotion> inline_motion = loadAsync(inline_id, corpus[1], &mCharacter);
+        ensure("decoded inline", inline_motion->onInitialize(&mCharacter) == LLMotion::STATUS_SUCCESS);
+        ensure("same inline", same_motion_list(*LLKeyframeDataCache::getKeyframeData(serial[1]->getID()),
+                                               *LLKeyframeDataCache::getKeyframeData(inline_id)));
+
+        pool.close();
+    }
+
+    // a corpus of animations decoded on a thread pool matches the same
+    // corpus deserialized on the main thread
+    template<> template<>
+    void keyframemotion_object_t::test<5>()
+    {
+        const S32 num_animations = Benchmark::size(400, 16);
+        std::vector<std::vector<U8>> corpus;
+        size_t bytes = 0;
+        for (S32 i = 0; i < num_animations; i++)
+        {
+            corpus.push_back(record_animation(i, 1.f + 0.5f*(i % 5)));
+            bytes += corpus.back().size();
+        }
+
+        Benchmark bench(stringize("Keyframe decode, ", num_animations, " animations (", bytes/1024, " KB), ms"));
+        std::vector<std::unique_ptr<LLKeyframeMotion>> serial;
+        for (const std::vector<U8>& data : corpus)
+        {
+            serial.push_back(load(data));
+        }
+        const F64 serial_ms = bench.elapsed_ms();
+
+        const S32 threads = llmax(2, (S32)std::thread::hardware_concurrency()) - 1;
+        LL::ThreadPool pool("KeyframeBenchmark", threads);
+        pool.start();
+        LLKeyframeMotion::setDecodeQueue("KeyframeBenchmark");
+
+        bench.start();
+        std::vector<std::unique_ptr<LLKeyframeMotion>> parallel;
+        std::vector<std::pair<LLKeyframeMotion*, LLCharacter*>> loading;
+        for (const std::vector<U8>& data : corpus)
+        {
+            LLUUID id;
+            id.generate();
+            parallel.push_back(loadAsync(id, data, &mCharacter));
+            loading.emplace_back(parallel.back().get(), &mCharacter);
+        }
+        const F64 posted_ms = bench.elapsed_ms();
+        ensure_equals("all loaded", finish_loading(loading), num_animations);
+        const F64 parallel_ms = bench.elapsed_ms();
+
+        LLKeyframeMotion::setDecodeQueue("");
+        pool.close();
+
+        for (S32 i = 0; i < num_animations; i++)
+        {
+            ensure("same as serial",
+                   same_motion_list(*LLKeyframeDataCache::getKeyframeData(serial[i]->getID()),
+                                    *LLKeyframeDataCache::getKeyframeData(parallel[i]->getID())));
+        }
+        bench.report("serial      ", serial_ms);
+        bench.report(threads, " threads   ", parallel_ms, " (", serial_ms/parallel_ms, "x)");
+        bench.report("posting     ", posted_ms, " of main thread time");
+    }
+}
@@ -0,0 +1,391 @@
+/**
+ * @file llmotioncontroller_test.cpp
+ * @brief Test cases for updating motion controllers in parallel
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../llcharacter.h"
+#include "../llkeyframemotion.h"
+#include "../llmotioncontroller.h"
+#include "lldatapacker.h"
+#include "llframetimer.h"
+#include "llquantize.h"
+#include "stringize.h"
+#include "threadpool.h"
+
+#include "../test/lltut.h"
+#include "../test/benchmark.h"
+
+namespace
+{
+    // A cut down avatar skeleton, parent first
+    const struct
+    {
+        const char* mName;
+        S32 mParent;
+    } SKELETON[] =
+    {
+        { "mPelvis", -1 },
+        { "mTorso", 0 },
+        { "mChest", 1 },
+        { "mNeck", 2 },
+        { "mHead", 3 },
+        { "mCollarLeft", 2 },
+        { "mShoulderLeft", 5 },
+        { "mElbowLeft", 6 },
+        { "mWristLeft", 7 },
+        { "mCollarRight", 2 },
+        { "mShoulderRight", 9 },
+        { "mElbowRight", 10 },
+        { "mWristRight", 11 },
+        { "mHipLeft", 0 },
+        { "mKneeLeft", 13 },
+        { "mAnkleLeft", 14 },
+        { "mHipRight", 0 },
+        { "mKneeRight", 16 },
+        { "mAnkleRight", 17 },
+    };
+    const S32 NUM_JOINTS = LL_ARRAY_SIZE(SKELETON);
+
+    class LLTestCharacter : public LLCharacter
+    {
+    public:
+        LLTestCharacter()
+        {
+            mID.generate();
+            mRoot.setName("mRoot");
+            for (S32 i = 0; i < NUM_JOINTS; i++)
+            {
+                LLJoint* parent = SKELETON[i].mParent < 0 ? &mRoot : mJoints[SKELETON[i].mParent].get();
+                mJoints.emplace_back(new LLJoint(SKELETON[i].mName, parent));
+                mJoints.back()->setJointNum(i);
+            }
+        }
+
+        ~LLTestCharacter()
+        {
+            // the motions hold on to the joints
+            flushAllMotions();
+            while (!mJoints.empty())
+            {
+                mJoints.pop_back();
+            }
+        }
+
+        LLJoint* getSkeletonJoint(S32 i) { return mJoints[i].get(); }
+
+        const char* getAnimationPrefix() override { return "avatar"; }
+        LLJoint* getRootJoint() override { return &mRoot; }
+        LLVector3 getCharacterPosition() override { return LLVector3::zero; }
+        LLQuaternion getCharacterRotation() override { return LLQuaternion::DEFAULT; }
+        LLVector3 getCharacterVelocity() override { return LLVector3::zero; }
+        LLVector3 getCharacterAngularVelocity() override { return LLVector3::zero; }
+        void getGround(const LLVector3& in_pos, LLVector3& out_pos, LLVector3& out_norm) override
+        {
+            out_pos = in_pos;
+            out_pos.mV[VZ] = 0.f;
+            out_norm = LLVector3::z_axis;
+        }
+        LLJoint* getCharacterJoint(U32 i) override { return i < (U32)NUM_JOINTS ? mJoints[i].get() : NULL; }
+        F32 getTimeDilation() override { return 1.f; }
+        F32 getPixelArea() const override { return 100000.f; }
+        LLPolyMesh* getHeadMesh() override { return NULL; }
+        LLPolyMesh* getUpperBodyMesh() override { return NULL; }
+        LLVector3d getPosGlobalFromAgent(const LLVector3& position) override { return LLVector3d(position); }
+        LLVector3 getPosAgentFromGlobal(const LLVector3d& position) override { return LLVector3(position); }
+        void addDebugText(const std::string& text) override {}
+        const LLUUID& getID() const override { return mID; }
+
+    private:
+        LLUUID mID;
+        LLJoint mRoot;
+        std::vector<std::unique_ptr<LLJoint>> mJoints;
+    };
+
+    // A looping clip as it would come out of a capture session: every
+    // joint keyed at 30 fps, in the .anim format
+    std::vector<U8> record_animation(S32 seed, F32 duration)
+    {
+        const S32 frames = (S32)(duration*30.f) + 1;
+        std::vector<U8> buffer(64 + NUM_JOINTS*(32 + frames*8));
+        LLDataPackerBinaryBuffer dp(buffer.data(), (S32)buffer.size());
+        dp.packU16(KEYFRAME_MOTION_VERSION, "version");
+        dp.packU16(KEYFRAME_MOTION_SUBVERSION, "sub_version");
+        dp.packS32(LLJoint::MEDIUM_PRIORITY, "base_priority");
+        dp.packF32(duration, "duration");
+        dp.packString("", "emote_name");
+        dp.packF32(0.f, "loop_in_point");
+        dp.packF32(duration, "loop_out_point");
+        dp.packS32(1, "loop");
+        dp.packF32(0.3f, "ease_in_duration");
+        dp.packF32(0.3f, "ease_out_duration");
+        dp.packU32(0, "hand_pose");
+        dp.packU32(NUM_JOINTS, "num_joints");
+        for (S32 joint = 0; joint < NUM_JOINTS; joint++)
+        {
+            dp.packString(SKELETON[joint].mName, "joint_name");
+            dp.packS32(LLJoint::MEDIUM_PRIORITY, "joint_priority");
+            dp.packS32(frames, "num_rot_keys");
+            for (S32 frame = 0; frame < frames; frame++)
+            {
+                const F32 t = (F32)frame/(F32)(frames - 1);
+                const F32 phase = F_TWO_PI*t + 0.37f*(seed + joint);
+                LLQuaternion rot(0.4f*sinf(phase), LLVector3(sinf(seed + 1.3f*joint), cosf(0.7f*joint), 0.5f));
+                LLVector3 angles = rot.packToVector3();
+                dp.packU16(F32_to_U16(t*duration, 0.f, duration), "time");
+                dp.packU16(F32_to_U16(angles.mV[VX], -1.f, 1.f), "rot_angle_x");
+                dp.packU16(F32_to_U16(angles.mV[VY], -1.f, 1.f), "rot_angle_y");
+                dp.packU16(F32_to_U16(angles.mV[VZ], -1.f, 1.f), "rot_angle_z");
+            }
+            dp.packS32(0, "num_pos_keys");
+        }
+        dp.packS32(0, "num_constraints");
+        buffer.resize(dp.getCurrentSize());
+        return buffer;
+    }
+
+    const S32 NUM_ANIMATIONS = 4;
+
+    // Puts the recorded clips in the keyframe cache, which is where
+    // LLKeyframeMotion::onInitialize() looks first
+    std::vector<LLUUID> load_animations(LLTestCharacter& character)
+    {
+        std::vector<LLUUID> ids;
+        for (S32 i = 0; i < NUM_ANIMATIONS; i++)
+        {
+            LLUUID id;
+            id.generate();
+            std::vector<U8> data = record_animation(i, 1.f + 0.25f*i);
+            LLDataPackerBinaryBuffer dp(data.data(), (S32)data.size());
+            LLKeyframeMotion loader(id);
+            loader.setCharacter(&character);
+            if (loader.deserialize(dp, id, false))
+            {
+                ids.push_back(id);
+            }
+        }
+        return ids;
+    }
+
+    struct Crowd
+    {
+        std::vector<std::unique_ptr<LLTestCharacter>> mCharacters;
+
+        Crowd(S32 count, const std::vector<LLUUID>& animations, F32 time_factor = 1.f)
+        {
+            for (S32 i = 0; i < count; i++)
+            {
+                mCharacters.emplace_back(new LLTestCharacter);
+                mCharacters.back()->setAnimTimeFactor(time_factor);
+                mCharacters.back()->startMotion(animations[i % animations.size()], 0.1f*(i % 7));
+            }
+        }
+
+        void updateSerial()
+        {
+            for (auto& character : mCharacters)
+            {
+                character->updateMotions(LLCharacter::NORMAL_UPDATE);
+            }
+        }
+
+        void updateParallel(const std::string& queue_name)
+        {
+            std::vector<LLMotionController*> batch;
+            for (auto& character : mCharacters)
+            {
+                if (character->beginParallelMotionsUpdate())
+                {
+                    batch.push_back(&character->getMotionController());
+                }
+            }
+            LLMotionController::updateMotionsParallel(batch, queue_name);
+            for (LLMotionController* controller : batch)
+            {
+                controller->finishParallelUpdate();
+            }
+        }
+    };
+}
+
+namespace tut
+{
+    struct motioncontroller
+    {
+        LLTestCharacter mLoader;
+        std::vector<LLUUID> mAnimations;
+
+        motioncontroller()
+            : mAnimations(load_animations(mLoader))
+        {
+        }
+
+        ~motioncontroller()
+        {
+            LLKeyframeDataCache::clear();
+        }
+    };
+    typedef test_group<motioncontroller> motioncontroller_t;
+    typedef motioncontroller_t::object motioncontroller_object_t;
+    tut::motioncontroller_t tut_motioncontroller("LLMotionController");
+
+    // the first update is always done in place, after that the update is
+    // split up
+    template<> template<>
+    void motioncontroller_object_t::test<1>()
+    {
+        ensure_equals("recorded animations", (S32)mAnimations.size(), NUM_ANIMATIONS);
+
+        LLTestCharacter character;
+        character.startMotion(mAnimations[0]);
+        ensure("first update in place", !character.beginParallelMotionsUpdate());
+        ensure("active", character.isMotionActive(mAnimations[0]));
+
+        LLFrameTimer::updateFrameTime();
+        ensure("split", character.beginParallelMotionsUpdate());
+        character.getMotionController().updateParallel();
+        character.getMotionController().finishParallelUpdate();
+        ensure("still active", character.isMotionActive(mAnimations[0]));
+    }
+
+    // Same poses whether the crowd is updated one at a time or on a pool,
+    // including stopped motions easing out and being deactivated
+    template<> template<>
+    void motioncontroller_object_t::test<2>()
+    {
+        // Both crowds see the same frame times.  Sped up so that the clips
+        // get through a few loops and the stopped ones finish easing out.
+        const S32 count = 24;
+        const F32 time_factor = 20.f;
+        Crowd serial(count, mAnimations, time_factor);
+        Crowd parallel(count, mAnimations, time_factor);
+
+        LL::ThreadPool pool("MotionTest", 3);
+        pool.start();
+
+        for (S32 frame = 0; frame < 120; frame++)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            LLFrameTimer::updateFrameTime();
+            if (frame == 40)
+            {
+                for (S32 i = 0; i < count; i += 3)
+                {
+                    serial.mCharacters[i]->stopMotion(mAnimations[i % mAnimations.size()]);
+                    parallel.mCharacters[i]->stopMotion(mAnimations[i % mAnimations.size()]);
+                }
+            }
+            serial.updateSerial();
+            parallel.updateParallel("MotionTest");
+
+            for (S32 i = 0; i < count; i++)
+            {
+                for (S32 joint = 0; joint < NUM_JOINTS; joint++)
+                {
+                    const LLQuaternion& expected = serial.mCharacters[i]->getSkeletonJoint(joint)->getRotation();
+                    const LLQuaternion& actual = parallel.mCharacters[i]->getSkeletonJoint(joint)->getRotation();
+                    ensure("same rotation", expected == actual);
+                }
+                ensure_equals("same active motions",
+                              parallel.mCharacters[i]->getMotionController().getActiveMotions().size(),
+                              serial.mCharacters[i]->getMotionController().getActiveMotions().size());
+            }
+        }
+
+        pool.close();
+
+        for (S32 i = 0; i < count; i++)
+        {
+            const bool stopped = (i % 3 == 0);
+            ensure_equals("deactivated", parallel.mCharacters[i]->isMotionActive(mAnimations[i % mAnimations.size()]), !stopped);
+        }
+    }
+
+    // without the queue everything is done on the calling thread
+    template<> template<>
+    void motioncontroller_object_t::test<3>()
+    {
+        Crowd crowd(5, mAnimations);
+        crowd.updateSerial();
+        LLFrameTimer::updateFrameTime();
+        crowd.updateParallel("NoSuchQueue");
+        for (auto& character : crowd.mCharacters)
+        {
+            ensure("no pending work", character->getMotionController().getActiveMotions().size() == 1);
+        }
+    }
+
+    // a crowd playing recorded clips, one controller after the other and
+    // fanned out over a pool, ends up in the same poses
+    template<> template<>
+    void motioncontroller_object_t::test<4>()
+    {
+        const S32 count = Benchmark::size(200, 8);
+        const S32 frames = Benchmark::size(100, 4);
+        const S32 threads = llmax(2, (S32)std::thread::hardware_concurrency());
+
+        Crowd serial(count, mAnimations);
+        Crowd parallel(count, mAnimations);
+        serial.updateSerial();
+        parallel.updateSerial();
+
+        LL::ThreadPool pool("MotionBenchmark", threads - 1);
+        pool.start();
+
+        Benchmark bench(stringize("Motion update, ", count, " characters x ", NUM_JOINTS, " joints, ms per frame"));
+        F64 serial_ms = 0.0;
+        F64 parallel_ms = 0.0;
+        for (S32 frame = 0; frame < frames; frame++)
+        {
+            LLFrameTimer::updateFrameTime();
+
+            bench.start();
+            serial.updateSerial();
+            serial_ms += bench.elapsed_ms();
+
+            bench.start();
+            parallel.updateParallel("MotionBenchmark");
+            parallel_ms += bench.elapsed_ms();
+        }
+
+        pool.close();
+
+        for (S32 i = 0; i < count; i++)
+        {
+            for (S32 joint = 0; joint < NUM_JOINTS; joint++)
+            {
+                ensure("same rotation", serial.mCharacters[i]->getSkeletonJoint(joint)->getRotation() ==
+                                        parallel.mCharacters[i]->getSkeletonJoint(joint)->getRotation());
+            }
+        }
+        bench.report("serial     ", serial_ms/frames);
+        bench.report(threads, " threads  ", parallel_ms/frames);
+    }
+}
@@ -0,0 +1,432 @@
+/**
+ * @file llphysicsmotionsolver_test.cpp
+ * @brief Test cases for the batched avatar physics integration
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include <random>
+#include <vector>
+
+#include "../llphysicsmotionsolver.h"
+#include "stringize.h"
+
+#include "../test/lltut.h"
+#include "../test/benchmark.h"
+
+namespace
+{
+    typedef LLPhysicsMotionSolver::Param Param;
+    typedef LLPhysicsMotionSolver::Result Result;
+
+    // The step loop of LLPhysicsMotion::onUpdate(), one param at a time
+    Result reference_integrate(const Param& param)
+    {
+        F32 position = param.mPosition;
+        F32 velocity = param.mVelocity;
+        Result result;
+        result.mPositionLastUpdate = param.mPositionLastUpdate;
+        result.mPositionClamped = 0.f;
+        result.mStepsDone = 0;
+        result.mStopped = false;
+        result.mUpdateVisuals = false;
+        result.mReset = false;
+
+        for (U32 i = 0; i < param.mSteps; i++)
+        {
+            const F32 position_current = llclamp(position, 0.0f, 1.0f);
+            if ((param.mMaxEffect == 0) && (position_current == param.mPositionUser))
+            {
+                result.mStopped = true;
+                break;
+            }
+
+            const F32 spring_length = position_current - param.mPositionUser;
+            const F32 force_spring = -spring_length * param.mSpring;
+            const F32 force_damping = -param.mDamping * velocity;
+            const F32 force_net = (param.mForce +
+                                   force_spring +
+                                   force_damping +
+                                   param.mForceDrag);
+
+            const F32 acceleration_new = force_net / param.mMass;
+            F32 velocity_new = velocity + acceleration_new * param.mTimeStep;
+            velocity_new = llclamp(velocity_new, -100.f, 100.f);
+
+            F32 position_new = position_current + velocity_new * param.mTimeStep;
+            if (param.mMaxEffect == 0)
+                position_new = param.mPositionUser;
+
+            if ((position_new < 0 && velocity_new < 0) ||
+                (position_new > 1 && velocity_new > 0))
+            {
+                velocity_new = 0;
+            }
+
+            if ((position != position) ||
+                (velocity != velocity) ||
+                (position_new != position_new))
+            {
+                position_new = 0;
+                result.mReset = true;
+            }
+
+            const F32 position_new_clamped = llclamp(position_new, 0.0f, 1.0f);
+            if (llabs(result.mPositionLastUpdate - position_new_clamped) > param.mMinDelta)
+            {
+                result.mUpdateVisuals = true;
+                result.mPositionLastUpdate = position_new;
+            }
+
+            velocity = velocity_new;
+            position = position_new;
+            result.mPositionClamped = position_new_clamped;
+            result.mStepsDone++;
+        }
+        result.mPosition = position;
+        result.mVelocity = velocity;
+        return result;
+    }
+
+    Param random_param(std::mt19937& rng)
+    {
+        std::uniform_real_distribution<F32> unit(0.f, 1.f);
+        std::uniform_real_distribution<F32> force(-20.f, 20.f);
+        const F32 time_delta = 0.005f + 0.3f * unit(rng);
+
+        Param param;
+        param.mPosition = unit(rng) * 1.2f - 0.1f;
+        param.mVelocity = force(rng);
+        param.mPositionLastUpdate = unit(rng);
+        param.mPositionUser = unit(rng);
+        param.mForce = force(rng);
+        param.mForceDrag = force(rng) * 0.1f;
+        param.mSpring = unit(rng) * 100.f;
+        param.mDamping = unit(rng) * 10.f;
+        param.mMass = 0.1f + unit(rng);
+        param.mMaxEffect = unit(rng) < 0.1f ? 0.f : unit(rng);
+        param.mMinDelta = unit(rng) < 0.2f ? F32_MAX : unit(rng) * 0.4f;
+        param.mSteps = (U32)(time_delta / 0.05f) + 1;
+        param.mTimeStep = time_delta / (F32)param.mSteps;
+        return param;
+    }
+
+    bool same(F32 a, F32 b)
+    {
+        return (a != a && b != b) || a == b || is_approx_equal(a, b);
+    }
+
+    void ensure_matches(const std::string& msg, const Result& result, const Result& expected)
+    {
+        tut::ensure(msg + " position", same(result.mPosition, expected.mPosition));
+        tut::ensure(msg + " velocity", same(result.mVelocity, expected.mVelocity));
+        tut::ensure(msg + " last update", same(result.mPositionLastUpdate, expected.mPositionLastUpdate));
+        tut::ensure(msg + " clamped", same(result.mPositionClamped, expected.mPositionClamped));
+        tut::ensure_equals(msg + " steps", result.mStepsDone, expected.mStepsDone);
+        tut::ensure_equals(msg + " stopped", result.mStopped, expected.mStopped);
+        tut::ensure_equals(msg + " update visuals", result.mUpdateVisuals, expected.mUpdateVisuals);
+        tut::ensure_equals(msg + " reset", result.mReset, expected.mReset);
+    }
+}
+
+namespace tut
+{
+    struct physicsmotionsolver
+    {
+    };
+    typedef test_group<physicsmotionsolver> physicsmotionsolver_t;
+    typedef physicsmotionsolver_t::object physicsmotionsolver_object_t;
+    tut::physicsmotionsolver_t tut_physicsmotionsolver("LLPhysicsMotionSolver");
+
+    // batched lanes match the per param loop
+    template<> template<>
+    void physicsmotionsolver_object_t::test<1>()
+    {
+        std::mt19937 rng(1234);
+        std::vector<Param> params;
+        for (S32 i = 0; i < 1001; i++)
+        {
+            params.push_back(random_param(rng));
+        }
+
+        LLPhysicsMotionSolver solver;
+        for (const Param& param : params)
+        {
+            solver.addParam(param);
+        }
+        ensure_equals("params", solver.getNumParams(), (S32)params.size());
+        solver.integrate();
+
+        for (size_t i = 0; i < params.size(); i++)
+        {
+            ensure_matches("param " + std::to_string(i), solver.getResult((S32)i), reference_integrate(params[i]));
+        }
+    }
+
+    // edge cases of the per param loop
+    template<> template<>
+    void physicsmotionsolver_object_t::test<2>()
+    {
+        Param base;
+        base.mPosition = 0.5f;
+        base.mVelocity = 0.f;
+        base.mPositionLastUpdate = 0.5f;
+        base.mPositionUser = 0.5f;
+        base.mForce = 5.f;
+        base.mForceDrag = 0.f;
+        base.mSpring = 10.f;
+        base.mDamping = 0.5f;
+        base.mMass = 0.2f;
+        base.mMaxEffect = 0.5f;
+        base.mMinDelta = 0.01f;
+        base.mTimeStep = 0.025f;
+        base.mSteps = 4;
+
+        std::vector<Param> params;
+
+        Param at_rest = base;               // effect off and at the user position
+        at_rest.mMaxEffect = 0.f;
+        params.push_back(at_rest);
+
+        Param to_rest = at_rest;            // effect off, one step back to the user position
+        to_rest.mPosition = 0.8f;
+        params.push_back(to_rest);
+
+        Param out_of_range = base;
+        out_of_range.mPosition = 3.f;
+        out_of_range.mVelocity = 50.f;
+        params.push_back(out_of_range);
+
+        Param pushed_below = base;
+        pushed_below.mPosition = 0.f;
+        pushed_below.mForce = -50.f;
+        params.push_back(pushed_below);
+
+        Param nan_position = base;
+        nan_position.mPosition = std::numeric_limits<F32>::quiet_NaN();
+        params.push_back(nan_position);
+
+        Param nan_velocity = base;
+        nan_velocity.mVelocity = std::numeric_limits<F32>::quiet_NaN();
+        params.push_back(nan_velocity);
+
+        Param no_mass = base;
+        no_mass.mMass = 0.f;
+        params.push_back(no_mass);
+
+        Param no_steps = base;
+        no_steps.mSteps = 0;
+        params.push_back(no_steps);
+
+        Param many_steps = base;
+        many_steps.mSteps = 21;
+        params.push_back(many_steps);
+
+        Param too_small = base;             // never updates the visual params
+        too_small.mMinDelta = F32_MAX;
+        params.push_back(too_small);
+
+        LLPhysicsMotionSolver solver;
+        for (const Param& param : params)
+        {
+            solver.addParam(param);
+        }
+        solver.integrate();
+
+        std::vector<Result> results;
+        for (size_t i = 0; i < params.size(); i++)
+        {
+            results.push_back(solver.getResult((S32)i));
+            ensure_matches("edge " + std::to_string(i), results.back(), reference_integrate(params[i]));
+        }
+
+        ensure("at rest stops", results[0].mStopped && results[0].mStepsDone == 0);
+        ensure("to rest stops after one step", results[1].mStopped && results[1].mStepsDone == 1);
+        ensure_equals("to rest at user position", results[1].mPosition, 0.5f);
+        ensure("out of range clamped", results[2].mPositionClamped <= 1.f);
+        ensure_equals("pushed below stops", results[3].mVelocity, 0.f);
+        ensure("nan position resets", results[4].mReset && results[4].mPosition == results[4].mPosition);
+        ensure("nan velocity resets", results[5].mReset);
+        ensure_equals("no steps", results[7].mStepsDone, 0U);
+        ensure_equals("many steps", results[8].mStepsDone, 21U);
+        ensure("too small never updates", !results[9].mUpdateVisuals);
+        ensure("visible updates", results[8].mUpdateVisuals);
+    }
+
+    // a lane doesn't depend on its neighbours, and clear() starts over
+    template<> template<>
+    void physicsmotionsolver_object_t::test<3>()
+    {
+        std::mt19937 rng(42);
+        const Param param = random_param(rng);
+
+        LLPhysicsMotionSolver solver;
+        solver.addParam(param);
+        solver.integrate();
+        const Result alone = solver.getResult(0);
+
+        solver.clear();
+        ensure_equals("cleared", solver.getNumParams(), 0);
+        for (S32 i = 0; i < 3; i++)
+        {
+            solver.addParam(random_param(rng));
+        }
+        const S32 index = solver.addParam(param);
+        solver.integrate();
+        ensure_equals("index", index, 3);
+        ensure_matches("with neighbours", solver.getResult(index), alone);
+    }
+
+    // the six params of a crowd of avatars at frame times from 60 to 10 fps
+    // move the same batched as one at a time
+    template<> template<>
+    void physicsmotionsolver_object_t::test<4>()
+    {
+        const S32 avatars = Benchmark::size(1000, 20);
+        const S32 frames = Benchmark::size(100, 10);
+        std::mt19937 rng(7);
+        std::vector<Param> params;
+        for (S32 i = 0; i < avatars * 6; i++)
+        {
+            Param param = random_param(rng);
+            param.mMaxEffect = 0.5f;
+            param.mMass = 0.2f;
+            params.push_back(param);
+        }
+        std::vector<Param> batched_params = params;
+
+        // every avatar sees the same frame time
+        auto set_frame_time = [](std::vector<Param>& params, S32 frame)
+        {
+            const F32 time_delta = 1.f / 60.f + (0.1f - 1.f / 60.f) * (F32)(frame % 7) / 6.f;
+            for (Param& param : params)
+            {
+                param.mSteps = (U32)(time_delta / 0.05f) + 1;
+                param.mTimeStep = time_delta / (F32)param.mSteps;
+            }
+            return params.front().mSteps;
+        };
+
+        Benchmark bench(stringize("Physics params, ", avatars, " avatars x 6 over ", frames, " frames, ms"));
+        U32 steps = 0;
+        for (S32 frame = 0; frame < frames; frame++)
+        {
+            steps += set_frame_time(params, frame);
+            for (Param& param : params)
+            {
+                const Result result = reference_integrate(param);
+                param.mPosition = result.mPosition;
+                param.mVelocity = result.mVelocity;
+                param.mPositionLastUpdate = result.mPositionLastUpdate;
+            }
+        }
+        const F64 scalar_ms = bench.elapsed_ms();
+
+        LLPhysicsMotionSolver solver;
+        bench.start();
+        for (S32 frame = 0; frame < frames; frame++)
+        {
+            set_frame_time(batched_params, frame);
+            solver.clear();
+            for (const Param& param : batched_params)
+            {
+                solver.addParam(param);
+            }
+            solver.integrate();
+            for (S32 i = 0; i < (S32)batched_params.size(); i++)
+            {
+                const Result& result = solver.getResult(i);
+                batched_params[i].mPosition = result.mPosition;
+                batched_params[i].mVelocity = result.mVelocity;
+                batched_params[i].mPositionLastUpdate = result.mPositionLastUpdate;
+            }
+        }
+        const F64 batched_ms = bench.elapsed_ms();
+
+        for (size_t i = 0; i < params.size(); i++)
+        {
+            ensure("same motion", same(params[i].mPosition, batched_params[i].mPosition));
+        }
+
+        bench.report("per param ", scalar_ms, " (", steps, " steps)");
+        bench.report("batched   ", batched_ms);
+    }
+
+    // the params of every avatar gathered into one solver move the same as
+    // one solver per avatar, as LLPhysicsMotionController::finishBatch()
+    // relies on
+    template<> template<>
+    void physicsmotionsolver_object_t::test<5>()
+    {
+        const S32 avatars = Benchmark::size(1000, 20);
+        const S32 frames = Benchmark::size(100, 2);
+        std::mt19937 rng(99);
+        std::vector<LLPhysicsMotionSolver> per_avatar(avatars);
+        for (LLPhysicsMotionSolver& solver : per_avatar)
+        {
+            for (S32 i = 0; i < 6; i++)
+            {
+                solver.addParam(random_param(rng));
+            }
+        }
+
+        Benchmark bench(stringize("Physics params, ", avatars, " avatars x 6 over ", frames, " frames, ms"));
+        for (S32 frame = 0; frame < frames; frame++)
+        {
+            for (LLPhysicsMotionSolver& solver : per_avatar)
+            {
+                solver.integrate();
+            }
+        }
+        const F64 per_avatar_ms = bench.elapsed_ms();
+
+        LLPhysicsMotionSolver gathered;
+        std::vector<S32> first(avatars);
+        bench.start();
+        for (S32 frame = 0; frame < frames; frame++)
+        {
+            gathered.clear();
+            for (S32 i = 0; i < avatars; i++)
+            {
+                first[i] = gathered.addParams(per_avatar[i]);
+            }
+            gathered.integrate();
+        }
+        const F64 gathered_ms = bench.elapsed_ms();
+
+        ensure_equals("params", gathered.getNumParams(), avatars * 6);
+        for (S32 i = 0; i < avatars; i++)
+        {
+            ensure_equals("first", first[i], i * 6);
+            for (S32 j = 0; j < 6; j++)
+            {
+                ensure_matches(stringize("avatar ", i, " param ", j),
+                               gathered.getResult(first[i] + j), per_avatar[i].getResult(j));
+            }
+        }
+
+        bench.report("per avatar ", per_avatar_ms);
+        bench.report("gathered   ", gathered_ms);
+    }
+}
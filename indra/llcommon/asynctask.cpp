@@ -0,0 +1,119 @@
+/**
+ * @file   asynctask.cpp
+ * @brief  Implementation for asynctask.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "asynctask.h"
+// STL headers
+#include <algorithm>
+// std headers
+// external library headers
+// other Linden headers
+
+/*****************************************************************************
+*   CancelToken, CancelSource
+*****************************************************************************/
+void LL::CancelToken::check() const
+{
+    if (cancelled())
+    {
+        LLTHROW(TaskCancelled());
+    }
+}
+
+U64 LL::CancelToken::onCancel(const Callback& callback) const
+{
+    if (! mState)
+    {
+        // never cancelled
+        return 0;
+    }
+    {
+        std::lock_guard<std::mutex> lk(mState->mMutex);
+        // CancelSource::cancel() sets mCancelled under this lock, so either
+        // it will see our callback or we see mCancelled
+        if (! mState->mCancelled.load(std::memory_order_relaxed))
+        {
+            U64 id = mState->mNextId++;
+            mState->mCallbacks.emplace_back(id, callback);
+            return id;
+        }
+    }
+    callback();
+    return 0;
+}
+
+void LL::CancelToken::forget(U64 id) const
+{
+    if (mState)
+    {
+        std::lock_guard<std::mutex> lk(mState->mMutex);
+        auto& callbacks = mState->mCallbacks;
+        auto found = std::find_if(callbacks.begin(), callbacks.end(),
+                                  [id](const auto& pair){ return pair.first == id; });
+        if (found != callbacks.end())
+        {
+            // order doesn't matter
+            *found = std::move(callbacks.back());
+            callbacks.pop_back();
+        }
+    }
+}
+
+LL::CancelSource::CancelSource():
+    mState(std::make_shared<CancelToken::State>())
+{}
+
+void LL::CancelSource::cancel()
+{
+    std::vector<std::pair<U64, CancelToken::Callback>> callbacks;
+    {
+        std::lock_guard<std::mutex> lk(mState->mMutex);
+        if (mState->mCancelled.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+        mState->mCancelled.store(true, std::memory_order_release);
+        callbacks.swap(mState->mCallbacks);
+    }
+    // outside the lock: callbacks may forget() themselves
+    for (auto& pair : callbacks)
+    {
+        pair.second();
+    }
+}
+
+/*****************************************************************************
+*   task_detail
+*****************************************************************************/
+void LL::task_detail::checkWait()
+{
+    if (LLCoros::on_main_thread_main_coro())
+    {
+        LLTHROW(WorkQueueBase::Error("Do not wait for an LL::Task on the main thread's main coroutine"));
+    }
+}
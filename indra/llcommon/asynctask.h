@@ -0,0 +1,576 @@
+/**
+ * @file   asynctask.h
+ * @brief  LL::Task: results of work posted to a WorkQueue or to the main
+ *         thread, which coroutines can wait for without blocking a thread
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#if ! defined(LL_ASYNCTASK_H)
+#define LL_ASYNCTASK_H
+
+#include "llcoros.h"
+#include "llexception.h"
+#include "llmainthreadtask.h"
+#include "llthread.h"               // on_main_thread()
+#include "workqueue.h"
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>                  // std::monostate
+#include <vector>
+
+/*****************************************************************************
+*   Overview
+*****************************************************************************/
+/*
+ * async() posts a callable to a WorkQueue and returns at once with an
+ * LL::Task for its result; asyncMain() does the same for the main thread.
+ * A coroutine calls Task::get() to wait for the result: only that coroutine
+ * is suspended, so the rest of its thread carries on. Unlike waitForResult(),
+ * the caller can post several pieces of work before waiting for any of them,
+ * and wait for all of them with when_all() or the first with when_any().
+ *
+ * A task can be given a CancelToken. Cancelling its CancelSource completes
+ * the task at once with TaskCancelled, and work that hasn't started by then
+ * never runs. Work that's already running may poll the token to stop early:
+ * a callable that accepts a const CancelToken& is passed the task's token.
+ *
+ *     LL::CancelSource cancel;
+ *     auto decoded = LL::async("MeshDecode", [buffer](const LL::CancelToken& token)
+ *                              { return decode(buffer, token); },
+ *                              cancel.getToken());
+ *     // ...
+ *     Mesh mesh = decoded.get();   // on a coroutine, or a worker thread
+ */
+
+namespace LL
+{
+    /// what Task::get() throws for a task that was cancelled
+    struct TaskCancelled: public LLException
+    {
+        TaskCancelled(): LLException("task cancelled") {}
+    };
+
+/*****************************************************************************
+*   CancelSource, CancelToken
+*****************************************************************************/
+    /**
+     * A CancelToken tells work whether the CancelSource it came from has been
+     * cancelled. Tokens are cheap to copy, and safe to use on any thread. A
+     * default-constructed CancelToken is never cancelled.
+     */
+    class LL_COMMON_API CancelToken
+    {
+    public:
+        using Callback = std::function<void()>;
+
+        CancelToken() {}
+
+        bool cancelled() const
+        {
+            return mState && mState->mCancelled.load(std::memory_order_acquire);
+        }
+
+        /// throw TaskCancelled if cancelled: for long-running work to call
+        /// now and then
+        void check() const;
+
+        /**
+         * Call callback once cancelled: on the thread that calls cancel(),
+         * or right away if that's already happened. Returns an id to pass to
+         * forget(), or 0 if callback will never be called later.
+         */
+        U64 onCancel(const Callback& callback) const;
+        /// drop a callback registered with onCancel()
+        void forget(U64 id) const;
+
+    private:
+        friend class CancelSource;
+        struct State
+        {
+            std::atomic<bool> mCancelled{ false };
+            std::mutex mMutex;
+            U64 mNextId{ 1 };
+            std::vector<std::pair<U64, Callback>> mCallbacks;
+        };
+
+        CancelToken(const std::shared_ptr<State>& state): mState(state) {}
+
+        std::shared_ptr<State> mState;
+    };
+
+    class LL_COMMON_API CancelSource
+    {
+    public:
+        CancelSource();
+
+        CancelToken getToken() const { return CancelToken(mState); }
+        bool cancelled() const { return getToken().cancelled(); }
+        /// Cancel every task given one of our tokens. Calling cancel() again
+        /// does nothing.
+        void cancel();
+
+    private:
+        std::shared_ptr<CancelToken::State> mState;
+    };
+
+/*****************************************************************************
+*   Task, TaskPromise
+*****************************************************************************/
+    template <typename T>
+    class Task;
+
+    namespace task_detail
+    {
+        // what a Task<void> stores
+        template <typename T>
+        using stored_t = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+        // Blocking the main thread's main coroutine would stall the frame, and
+        // deadlock if the task needs the main thread to complete.
+        LL_COMMON_API void checkWait();
+
+        // pass the token to a callable that accepts one
+        template <typename CALLABLE>
+        decltype(auto) call(CALLABLE& callable, const CancelToken& token)
+        {
+            if constexpr (std::is_invocable_v<CALLABLE&, const CancelToken&>)
+            {
+                return callable(token);
+            }
+            else
+            {
+                return callable();
+            }
+        }
+
+        // a result goes to another thread: don't let it be a reference
+        template <typename CALLABLE>
+        using result_t = std::decay_t<decltype(call(std::declval<std::decay_t<CALLABLE>&>(),
+                                                    std::declval<const CancelToken&>()))>;
+
+        // shared by a Task and its TaskPromise: one allocation per task
+        template <typename T>
+        struct State
+        {
+            LLCoros::Mutex mMutex;
+            LLCoros::ConditionVariable mCond;
+            bool mDone{ false };
+            std::optional<stored_t<T>> mValue;
+            std::exception_ptr mException;
+            std::vector<std::function<void()>> mContinuations;
+
+            bool isDone()
+            {
+                LLCoros::LockType lk(mMutex);
+                return mDone;
+            }
+
+            // Only the first call completes the task: later ones, such as work
+            // finishing after the task was cancelled, are ignored.
+            template <typename SETTER>
+            bool complete(SETTER&& setter)
+            {
+                std::vector<std::function<void()>> continuations;
+                {
+                    LLCoros::LockType lk(mMutex);
+                    if (mDone)
+                    {
+                        return false;
+                    }
+                    std::forward<SETTER>(setter)(*this);
+                    mDone = true;
+                    continuations.swap(mContinuations);
+                }
+                mCond.notify_all();
+                for (auto& continuation : continuations)
+                {
+                    continuation();
+                }
+                return true;
+            }
+
+            bool fail(std::exception_ptr exc)
+            {
+                return complete([&exc](State& state){ state.mException = std::move(exc); });
+            }
+
+            // call continuation once done, on the thread that completes the
+            // task, or right away if it's already done
+            void then(std::function<void()> continuation)
+            {
+                {
+                    LLCoros::LockType lk(mMutex);
+                    if (! mDone)
+                    {
+                        mContinuations.push_back(std::move(continuation));
+                        return;
+                    }
+                }
+                continuation();
+            }
+
+            void wait()
+            {
+                LLCoros::LockType lk(mMutex);
+                if (! mDone)
+                {
+                    checkWait();
+                    LLCoros::TempStatus st("waiting for LL::Task");
+                    mCond.wait(lk, [this](){ return mDone; });
+                }
+            }
+        };
+    } // namespace task_detail
+
+    /**
+     * The producer end of a Task, for code that completes tasks itself
+     * rather than through async().
+     */
+    template <typename T>
+    class TaskPromise
+    {
+    public:
+        TaskPromise(): mState(std::make_shared<task_detail::State<T>>()) {}
+
+        Task<T> getTask() const { return Task<T>(mState); }
+
+        /// These return false if the task was already complete -- if it was
+        /// cancelled, say.
+        template <typename... ARGS>
+        bool setValue(ARGS&&... args)
+        {
+            return mState->complete(
+                [&args...](task_detail::State<T>& state)
+                { state.mValue.emplace(std::forward<ARGS>(args)...); });
+        }
+        bool setException(std::exception_ptr exc) { return mState->fail(std::move(exc)); }
+
+        /// Complete the task with TaskCancelled as soon as token is cancelled.
+        void cancelOn(const CancelToken& token)
+        {
+            std::weak_ptr<task_detail::State<T>> weak(mState);
+            U64 id = token.onCancel(
+                [weak]()
+                {
+                    if (auto state = weak.lock())
+                    {
+                        state->fail(std::make_exception_ptr(TaskCancelled()));
+                    }
+                });
+            if (id)
+            {
+                // don't leave the callback with a long-lived CancelSource
+                mState->then([token, id](){ token.forget(id); });
+            }
+        }
+
+        /// Call callable -- unless the task has already been cancelled --
+        /// and complete the task with what it returns or throws.
+        template <typename CALLABLE>
+        void run(CALLABLE& callable, const CancelToken& token)
+        {
+            if (token.cancelled())
+            {
+                setException(std::make_exception_ptr(TaskCancelled()));
+                return;
+            }
+            if (mState->isDone())
+            {
+                return;
+            }
+            try
+            {
+                if constexpr (std::is_void_v<T>)
+                {
+                    task_detail::call(callable, token);
+                    setValue();
+                }
+                else
+                {
+                    setValue(task_detail::call(callable, token));
+                }
+            }
+            catch (...)
+            {
+                setException(std::current_exception());
+            }
+        }
+
+    private:
+        std::shared_ptr<task_detail::State<T>> mState;
+    };
+
+    /**
+     * The consumer end: a result that may not be ready yet. Waiting for it
+     * suspends the calling coroutine, not its thread -- unless that's the
+     * thread's only coroutine, as on a plain worker thread. Waiting on the
+     * main thread's main coroutine throws WorkQueueBase::Error, as
+     * waitForResult() does.
+     */
+    template <typename T>
+    class Task
+    {
+    public:
+        /// an invalid Task, for assigning to later
+        Task() {}
+
+        bool valid() const { return bool(mState); }
+        bool ready() const { return mState->isDone(); }
+
+        void wait() const { mState->wait(); }
+
+        /// Returns false if the task still isn't ready after timeout.
+        template <typename Rep, typename Period>
+        bool wait_for(const std::chrono::duration<Rep, Period>& timeout) const
+        {
+            LLCoros::LockType lk(mState->mMutex);
+            if (! mState->mDone)
+            {
+                task_detail::checkWait();
+                LLCoros::TempStatus st("waiting for LL::Task");
+                return mState->mCond.wait_for(lk, timeout, [this](){ return mState->mDone; });
+            }
+            return true;
+        }
+
+        /**
+         * Wait, then return the result or throw what the work threw. Like
+         * std::future::get(), get() moves the result out, after which the
+         * Task is no longer valid().
+         */
+        T get()
+        {
+            wait();
+            auto state{ std::move(mState) };
+            if (state->mException)
+            {
+                std::rethrow_exception(state->mException);
+            }
+            if constexpr (! std::is_void_v<T>)
+            {
+                return std::move(*state->mValue);
+            }
+        }
+
+        /// Call continuation once the task completes, on the thread that
+        /// completes it -- or right away, if it already has.
+        void then(std::function<void()> continuation) const
+        {
+            mState->then(std::move(continuation));
+        }
+
+    private:
+        friend class TaskPromise<T>;
+        Task(const std::shared_ptr<task_detail::State<T>>& state): mState(state) {}
+
+        std::shared_ptr<task_detail::State<T>> mState;
+    };
+
+/*****************************************************************************
+*   async(), asyncMain()
+*****************************************************************************/
+    /**
+     * Post callable to the WorkQueue at target and return a Task for its
+     * result. If the queue is closed or gone, the Task holds
+     * WorkQueueBase::Closed.
+     */
+    template <typename CALLABLE>
+    auto async(WorkQueueBase::weak_t target, CALLABLE&& callable,
+               const CancelToken& token = CancelToken())
+    {
+        using result_t = task_detail::result_t<CALLABLE>;
+        TaskPromise<result_t> promise;
+        Task<result_t> task{ promise.getTask() };
+        promise.cancelOn(token);
+        bool posted = WorkQueueBase::postMaybe(
+            target,
+            [promise, callable = std::forward<CALLABLE>(callable), token]()
+            mutable { promise.run(callable, token); });
+        if (! posted)
+        {
+            promise.setException(std::make_exception_ptr(WorkQueueBase::Closed()));
+        }
+        return task;
+    }
+
+    /// post to the WorkQueue with this name
+    template <typename CALLABLE>
+    auto async(const std::string& queue, CALLABLE&& callable,
+               const CancelToken& token = CancelToken())
+    {
+        return async(WorkQueueBase::weak_t(WorkQueueBase::getInstance(queue)),
+                     std::forward<CALLABLE>(callable), token);
+    }
+
+    /**
+     * Run callable on the main thread and return a Task for its result. On
+     * the main thread, callable runs right away, as with
+     * LLMainThreadTask::dispatch(); otherwise it runs the next time the main
+     * loop calls LLEventTimer::updateClass().
+     */
+    template <typename CALLABLE>
+    auto asyncMain(CALLABLE&& callable, const CancelToken& token = CancelToken())
+    {
+        using result_t = task_detail::result_t<CALLABLE>;
+        TaskPromise<result_t> promise;
+        Task<result_t> task{ promise.getTask() };
+        promise.cancelOn(token);
+        if (on_main_thread())
+        {
+            promise.run(callable, token);
+        }
+        else
+        {
+            LLMainThreadTask::post(
+                [promise, callable = std::forward<CALLABLE>(callable), token]()
+                mutable { promise.run(callable, token); });
+        }
+        return task;
+    }
+
+/*****************************************************************************
+*   when_all(), when_any()
+*****************************************************************************/
+    /**
+     * Wait for every task, then return their results in order. If any
+     * threw, when_all() still waits for the rest before rethrowing the
+     * first one's exception, so no work is left running unobserved.
+     */
+    template <typename T>
+    auto when_all(std::vector<Task<T>>& tasks)
+    {
+        // Count the tasks down rather than wait for each in turn, so the
+        // waiting coroutine is woken once, by the last.
+        struct Remaining
+        {
+            LLCoros::Mutex mMutex;
+            LLCoros::ConditionVariable mCond;
+            size_t mCount;
+        };
+        auto remaining{ std::make_shared<Remaining>() };
+        remaining->mCount = tasks.size();
+        for (const auto& task : tasks)
+        {
+            task.then(
+                [remaining]()
+                {
+                    {
+                        LLCoros::LockType lk(remaining->mMutex);
+                        if (--remaining->mCount)
+                        {
+                            return;
+                        }
+                    }
+                    remaining->mCond.notify_all();
+                });
+        }
+        {
+            LLCoros::LockType lk(remaining->mMutex);
+            if (remaining->mCount)
+            {
+                task_detail::checkWait();
+                LLCoros::TempStatus st("waiting for LL::when_all()");
+                remaining->mCond.wait(lk, [&remaining](){ return ! remaining->mCount; });
+            }
+        }
+        if constexpr (std::is_void_v<T>)
+        {
+            for (auto& task : tasks)
+            {
+                task.get();
+            }
+        }
+        else
+        {
+            std::vector<T> results;
+            results.reserve(tasks.size());
+            for (auto& task : tasks)
+            {
+                results.push_back(task.get());
+            }
+            return results;
+        }
+    }
+
+    /**
+     * Wait for the first of tasks to complete and return its index. The
+     * others carry on: get() the one that completed, and cancel the rest
+     * if they're no longer wanted.
+     */
+    template <typename T>
+    size_t when_any(const std::vector<Task<T>>& tasks)
+    {
+        struct First
+        {
+            LLCoros::Mutex mMutex;
+            LLCoros::ConditionVariable mCond;
+            std::optional<size_t> mIndex;
+        };
+        auto first{ std::make_shared<First>() };
+        for (size_t i = 0; i < tasks.size(); ++i)
+        {
+            tasks[i].then(
+                [first, i]()
+                {
+                    {
+                        LLCoros::LockType lk(first->mMutex);
+                        if (first->mIndex)
+                        {
+                            return;
+                        }
+                        first->mIndex = i;
+                    }
+                    first->mCond.notify_all();
+                });
+        }
+        LLCoros::LockType lk(first->mMutex);
+        if (! first->mIndex)
+        {
+            llassert_always(! tasks.empty());
+            task_detail::checkWait();
+            LLCoros::TempStatus st("waiting for LL::when_any()");
+            first->mCond.wait(lk, [&first](){ return bool(first->mIndex); });
+        }
+        return *first->mIndex;
+    }
+
+    /// when_any(), then cancel the rest through the source they share
+    template <typename T>
+    size_t when_any(const std::vector<Task<T>>& tasks, CancelSource& rest)
+    {
+        size_t index = when_any(tasks);
+        rest.cancel();
+        return index;
+    }
+
+} // namespace LL
+
+#endif /* ! defined(LL_ASYNCTASK_H) */
@@ -344,6 +344,9 @@ void LLApp::setErrorHandler(LLAppErrorHandler handler)
 // static
 void LLApp::runErrorHandler()
 {
+    // the messages leading up to the crash are still queued
+    LLError::crashFlushLogging();
+
     if (LLApp::sErrorHandler)
     {
         LLApp::sErrorHandler();
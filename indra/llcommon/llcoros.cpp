@@ -415,7 +415,7 @@ void LLCoros::checkStop()
 }
 
 LLCoros::CoroData::CoroData(const std::string& name):
-    LLInstanceTracker<CoroData, std::string>(name),
+    LLShardedInstanceTracker<CoroData, std::string>(name),
     mName(name),
     // don't consume events unless specifically directed
     mConsuming(false),
@@ -426,10 +426,10 @@ LLCoros::CoroData::CoroData(const std::string& name):
 LLCoros::CoroData::CoroData(int n):
     // This constructor is used for the thread_local instance belonging to the
     // default coroutine on each thread. We must give each one a different
-    // LLInstanceTracker key because LLInstanceTracker's map spans all
-    // threads, but we want the default coroutine on each thread to have the
-    // empty string as its visible name because some consumers test for that.
-    LLInstanceTracker<CoroData, std::string>("main" + stringize(n)),
+    // LLShardedInstanceTracker key because its map spans all threads, but we
+    // want the default coroutine on each thread to have the empty string as
+    // its visible name because some consumers test for that.
+    LLShardedInstanceTracker<CoroData, std::string>("main" + stringize(n)),
     mName(),
     mConsuming(false),
     mCreationTime(LLTimer::getTotalSeconds())
@@ -36,7 +36,7 @@
 #include <boost/fiber/recursive_mutex.hpp>
 #include "mutex.h"
 #include "llsingleton.h"
-#include "llinstancetracker.h"
+#include "llshardedinstancetracker.h"
 #include <boost/function.hpp>
 #include <string>
 #include <exception>
@@ -344,8 +344,9 @@ private:
 
     S32 mStackSize;
 
-    // coroutine-local storage, as it were: one per coro we track
-    struct CoroData: public LLInstanceTracker<CoroData, std::string>
+    // coroutine-local storage, as it were: one per coro we track. Every
+    // coroutine launch and exit on any thread touches the tracker.
+    struct CoroData: public LLShardedInstanceTracker<CoroData, std::string>
     {
         CoroData(const std::string& name);
         CoroData(int n);
@@ -41,6 +41,10 @@ public:
     // MANIPULATORS
     static void updateInterpolants();
 
+    // While frozen the cache is only read, so getInterpolant() may be
+    // called from several threads.  Main thread only.
+    static void setCacheFrozen(bool frozen) { sCacheFrozen = frozen; }
+
     // ACCESSORS
     static F32 getInterpolant(F32SecondsImplicit time_constant, bool use_cache = true);
 
@@ -66,6 +70,7 @@ protected:
     typedef std::vector<Interpolant> interpolant_vec_t;
     static interpolant_vec_t    sInterpolants;
     static F32                  sTimeDelta;
+    static bool                 sCacheFrozen;
 };
 
 typedef LLSmoothInterpolation LLCriticalDamp;
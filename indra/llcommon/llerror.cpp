@@ -31,11 +31,18 @@
 #include "llerrorcontrol.h"
 #include "llsdutil.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
 #ifdef __GNUC__
 # include <cxxabi.h>
 #endif // __GNUC__
+#include <mutex>
 #include <sstream>
+#include <thread>
 #if !LL_WINDOWS
 # include <syslog.h>
 # include <unistd.h>
@@ -1213,13 +1220,27 @@ namespace
         return out.str();
     }
 
-    void writeToRecorders(const LLError::CallSite& site, const std::string& message)
+    std::string formatUTCTime(time_t when)
+    {
+        const size_t BUF_SIZE = 64;
+        char time_str[BUF_SIZE];    /* Flawfinder: ignore */
+
+        auto chars = strftime(time_str, BUF_SIZE,
+                                  "%Y-%m-%dT%H:%M:%SZ",
+                                  gmtime(&when));
+
+        return chars ? time_str : "time error";
+    }
+
+    // when is the time a queued message was logged, NULL for now
+    void writeToRecorders(SettingsConfig* s, const LLError::CallSite& site, const std::string& message,
+                          const time_t* when = NULL)
     {
         LL_PROFILE_ZONE_SCOPED_CATEGORY_LOGGING;
         LLError::ELevel level = site.mLevel;
-        SettingsConfigPtr s = Globals::getInstance()->getSettingsConfig();
 
         std::string escaped_message;
+        std::string time_string;
 
         std::unique_lock lock(s->mRecorderMutex); LL_PROFILE_MUTEX_LOCK(s->mRecorderMutex);
         for (LLError::RecorderPtr& r : s->mRecorders)
@@ -1233,7 +1254,12 @@ namespace
 
             if (r->wantsTime() && s->mTimeFunction != NULL)
             {
-                message_stream << s->mTimeFunction();
+                if (time_string.empty())
+                {
+                    // a custom time function can only tell the time now
+                    time_string = when && s->mTimeFunction == LLError::utcTime ? formatUTCTime(*when) : s->mTimeFunction();
+                }
+                message_stream << time_string;
             }
             message_stream << " ";
 
@@ -1338,6 +1364,401 @@ namespace {
     }
 }
 
+namespace
+{
+    // What the logging thread queues for the writer, followed by the message
+    struct LogRecordHeader
+    {
+        const LLError::CallSite* mSite;
+        U64     mSequence;  // steady clock, orders the records of all threads
+        time_t  mTime;
+        U32     mSize;
+    };
+
+    //-------------------------------------------------------------------------
+    // LogRing
+    //
+    // The queued messages of one thread.  Only that thread pushes and only
+    // the drain pops, so positions are all the synchronization it needs.
+    //-------------------------------------------------------------------------
+    class LogRing
+    {
+    public:
+        LogRing(size_t capacity):
+            mBuffer(new char[capacity]),
+            mCapacity(capacity),
+            mRetired(false),
+            mHead(0),
+            mTail(0)
+        {
+        }
+
+        size_t getCapacity() const { return mCapacity; }
+
+        // false if it doesn't fit
+        bool push(const LogRecordHeader& header, const std::string& message)
+        {
+            const U64 head = mHead.load(std::memory_order_relaxed);
+            const U64 tail = mTail.load(std::memory_order_acquire);
+            const size_t size = sizeof(header) + message.size();
+            if (head - tail + size > mCapacity)
+            {
+                return false;
+            }
+            copyIn(head, &header, sizeof(header));
+            copyIn(head + sizeof(header), message.data(), message.size());
+            mHead.store(head + size, std::memory_order_release);
+            return true;
+        }
+
+        // Pops records up to end, appending them to records and messages
+        void pop(U64 end, std::vector<LogRecordHeader>& records, std::vector<std::string>& messages)
+        {
+            U64 tail = mTail.load(std::memory_order_relaxed);
+            while (tail < end)
+            {
+                LogRecordHeader header;
+                copyOut(tail, &header, sizeof(header));
+                std::string message(header.mSize, '\0');
+                copyOut(tail + sizeof(header), &message[0], header.mSize);
+                tail += sizeof(header) + header.mSize;
+                records.push_back(header);
+                messages.push_back(std::move(message));
+            }
+            mTail.store(tail, std::memory_order_release);
+        }
+
+        U64 getHead() const { return mHead.load(std::memory_order_acquire); }
+        size_t getUsed() const { return (size_t)(mHead.load(std::memory_order_relaxed) - mTail.load(std::memory_order_relaxed)); }
+        bool empty() const { return getHead() == mTail.load(std::memory_order_relaxed); }
+
+        std::atomic<bool> mRetired;     // its thread exited
+
+    private:
+        void copyIn(U64 pos, const void* data, size_t size)
+        {
+            const size_t offset = (size_t)(pos % mCapacity);
+            const size_t first = std::min(size, mCapacity - offset);
+            memcpy(&mBuffer[offset], data, first);
+            memcpy(&mBuffer[0], (const char*)data + first, size - first);
+        }
+
+        void copyOut(U64 pos, void* data, size_t size) const
+        {
+            const size_t offset = (size_t)(pos % mCapacity);
+            const size_t first = std::min(size, mCapacity - offset);
+            memcpy(data, &mBuffer[offset], first);
+            memcpy((char*)data + first, &mBuffer[0], size - first);
+        }
+
+        std::unique_ptr<char[]> mBuffer;
+        const size_t mCapacity;
+        // on separate cache lines, each written by one side
+        alignas(64) std::atomic<U64> mHead;
+        alignas(64) std::atomic<U64> mTail;
+    };
+    typedef std::shared_ptr<LogRing> LogRingPtr;
+
+    // The ring of the calling thread, retired when the thread exits
+    struct ThreadLogRing
+    {
+        LogRingPtr  mRing;
+        U32         mGeneration = 0;
+
+        ~ThreadLogRing()
+        {
+            if (mRing)
+            {
+                mRing->mRetired = true;
+            }
+        }
+    };
+    thread_local ThreadLogRing tThreadLogRing;
+
+    std::atomic<bool> sAsyncLogging(false);
+
+    //-------------------------------------------------------------------------
+    // AsyncLog
+    //
+    // The rings of all logging threads and the thread writing them out.  The
+    // writer wakes up every WRITE_INTERVAL, or sooner when a ring is half
+    // full, and passes the records to the recorders in the order they were
+    // logged.
+    //-------------------------------------------------------------------------
+    class AsyncLog
+    {
+    public:
+        static AsyncLog& instance()
+        {
+            static AsyncLog sInstance;
+            return sInstance;
+        }
+
+        ~AsyncLog()
+        {
+            stop();
+        }
+
+        void start(size_t queue_size);
+        void stop();
+
+        // false if the message has to be written right away
+        bool push(const LLError::CallSite& site, const std::string& message);
+
+        // s is the settings the caller holds under the log mutex
+        void flush(SettingsConfig* s);
+        void flush();
+        void crashFlush();
+
+        U64 getDropped() const { return mDropped.load(std::memory_order_relaxed); }
+
+    private:
+        AsyncLog();
+
+        void run();
+        // Writes out what was queued when called, true if there was any.
+        // Requires mDrainMutex, which is taken after the log mutex.
+        bool drain(SettingsConfig* s);
+
+        static constexpr std::chrono::milliseconds WRITE_INTERVAL{ 20 };
+
+        std::mutex                  mRingsMutex;
+        std::vector<LogRingPtr>     mRings;
+        std::atomic<U32>            mNumRings;
+        std::atomic<U32>            mGeneration;
+        size_t                      mRingSize;
+
+        std::recursive_timed_mutex  mDrainMutex;    // recorders may log
+        std::atomic<U64>            mDropped;
+        U64                         mReportedDropped;
+
+        std::mutex                  mWakeMutex;
+        std::condition_variable     mWake;
+        bool                        mStop;
+        std::thread                 mWriter;
+    };
+
+    AsyncLog::AsyncLog():
+        mNumRings(0),
+        mGeneration(1),
+        mRingSize(0),
+        mDropped(0),
+        mReportedDropped(0),
+        mStop(false)
+    {
+        // constructed before this, so they are still there when the writer
+        // stops at exit
+        getLogMutex();
+        Globals::getInstance();
+    }
+
+    void AsyncLog::start(size_t queue_size)
+    {
+        stop();
+
+        // large enough for a long message
+        mRingSize = std::max(queue_size, size_t(4096));
+        mReportedDropped = getDropped();
+        mStop = false;
+        mWriter = std::thread([this]() { run(); });
+        sAsyncLogging = true;
+    }
+
+    void AsyncLog::stop()
+    {
+        sAsyncLogging = false;
+        if (mWriter.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mWakeMutex);
+                mStop = true;
+            }
+            mWake.notify_one();
+            mWriter.join();
+        }
+
+        flush();
+
+        // threads get a new ring if it's turned on again
+        std::lock_guard<std::mutex> lock(mRingsMutex);
+        mRings.clear();
+        mNumRings = 0;
+        mGeneration++;
+    }
+
+    bool AsyncLog::push(const LLError::CallSite& site, const std::string& message)
+    {
+        ThreadLogRing& local = tThreadLogRing;
+        const U32 generation = mGeneration.load(std::memory_order_acquire);
+        if (!local.mRing || local.mGeneration != generation)
+        {
+            local.mRing = std::make_shared<LogRing>(mRingSize);
+            local.mGeneration = generation;
+            std::lock_guard<std::mutex> lock(mRingsMutex);
+            mRings.push_back(local.mRing);
+            mNumRings = (U32)mRings.size();
+        }
+        LogRing& ring = *local.mRing;
+
+        if (sizeof(LogRecordHeader) + message.size() > ring.getCapacity() / 4)
+        {
+            // wouldn't leave room for others
+            return false;
+        }
+
+        LogRecordHeader header;
+        header.mSite = &site;
+        header.mSequence = (U64)std::chrono::steady_clock::now().time_since_epoch().count();
+        header.mTime = time(NULL);
+        header.mSize = (U32)message.size();
+        if (!ring.push(header, message))
+        {
+            mDropped.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        if (ring.getUsed() > ring.getCapacity() / 2)
+        {
+            mWake.notify_one();
+        }
+        return true;
+    }
+
+    void AsyncLog::flush(SettingsConfig* s)
+    {
+        if (!mNumRings.load())
+        {
+            return;
+        }
+
+        std::lock_guard<std::recursive_timed_mutex> lock(mDrainMutex);
+        while (drain(s))
+        {
+        }
+    }
+
+    void AsyncLog::flush()
+    {
+        if (!mNumRings.load())
+        {
+            return;
+        }
+
+        std::unique_lock lock(*getLogMutex()); LL_PROFILE_MUTEX_LOCK(*getLogMutex());
+        SettingsConfigPtr s = Globals::getInstance()->getSettingsConfig();
+        flush(s.get());
+    }
+
+    void AsyncLog::crashFlush()
+    {
+        sAsyncLogging = false;
+        if (!mNumRings.load())
+        {
+            return;
+        }
+
+        // Another thread may hold the locks and never let go, or the writer
+        // may be stuck in a recorder
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        std::unique_lock lock(*getLogMutex(), std::defer_lock);
+        while (!lock.try_lock())
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+            {
+                return;
+            }
+            std::this_thread::yield();
+        }
+        std::unique_lock<std::recursive_timed_mutex> drain_lock(mDrainMutex, std::defer_lock);
+        if (drain_lock.try_lock_until(deadline))
+        {
+            SettingsConfigPtr s = Globals::getInstance()->getSettingsConfig();
+            drain(s.get());
+        }
+    }
+
+    void AsyncLog::run()
+    {
+        LL_PROFILER_SET_THREAD_NAME("LogWriter");
+        bool stop = false;
+        while (!stop)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mWakeMutex);
+                if (!mStop)
+                {
+                    mWake.wait_for(lock, WRITE_INTERVAL);
+                }
+                stop = mStop;
+            }
+
+            // LLRefCount isn't thread safe, the settings are only taken
+            // under the log mutex
+            SettingsConfigPtr s;
+            {
+                std::unique_lock lock(*getLogMutex()); LL_PROFILE_MUTEX_LOCK(*getLogMutex());
+                s = Globals::getInstance()->getSettingsConfig();
+            }
+            {
+                std::lock_guard<std::recursive_timed_mutex> lock(mDrainMutex);
+                drain(s.get());
+            }
+            std::unique_lock lock(*getLogMutex()); LL_PROFILE_MUTEX_LOCK(*getLogMutex());
+            s = NULL;
+        }
+    }
+
+    bool AsyncLog::drain(SettingsConfig* s)
+    {
+        LL_PROFILE_ZONE_SCOPED_CATEGORY_LOGGING;
+        std::vector<LogRingPtr> rings;
+        {
+            std::lock_guard<std::mutex> lock(mRingsMutex);
+            // the rings of threads that exited go once they are written out
+            mRings.erase(std::remove_if(mRings.begin(), mRings.end(),
+                                        [](const LogRingPtr& ring) { return ring->mRetired && ring->empty(); }),
+                         mRings.end());
+            mNumRings = (U32)mRings.size();
+            rings = mRings;
+        }
+
+        std::vector<LogRecordHeader> records;
+        std::vector<std::string> messages;
+        for (const LogRingPtr& ring : rings)
+        {
+            ring->pop(ring->getHead(), records, messages);
+        }
+
+        const U64 dropped = getDropped();
+        if (records.empty() && dropped == mReportedDropped)
+        {
+            return false;
+        }
+
+        std::vector<size_t> order(records.size());
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            order[i] = i;
+        }
+        // each ring is in order already
+        std::stable_sort(order.begin(), order.end(),
+                         [&records](size_t a, size_t b) { return records[a].mSequence < records[b].mSequence; });
+
+        for (size_t i : order)
+        {
+            writeToRecorders(s, *records[i].mSite, messages[i], &records[i].mTime);
+        }
+
+        if (dropped != mReportedDropped)
+        {
+            const U64 count = dropped - mReportedDropped;
+            mReportedDropped = dropped;
+            LL_WARNS("Logging") << count << " log messages dropped, the log queue was full" << LL_ENDL;
+        }
+        return true;
+    }
+}
+
 namespace LLError
 {
 
@@ -1389,6 +1810,13 @@ namespace LLError
     void Log::flush(const std::ostringstream& out, const CallSite& site)
     {
         LL_PROFILE_ZONE_SCOPED_CATEGORY_LOGGING;
+        // Queued without taking the lock, unless it needs the settings
+        if (sAsyncLogging && !site.mPrintOnce && site.mLevel != LEVEL_ERROR
+            && AsyncLog::instance().push(site, out.str()))
+        {
+            return;
+        }
+
         std::unique_lock lock(*getLogMutex(), std::try_to_lock); LL_PROFILE_MUTEX_LOCK(*getLogMutex());
         if (!lock)
         {
@@ -1427,7 +1855,12 @@ namespace LLError
             message = message_stream.str();
         }
 
-        writeToRecorders(site, message);
+        if (site.mLevel == LEVEL_ERROR || !sAsyncLogging || !AsyncLog::instance().push(site, message))
+        {
+            // after what was queued before it
+            AsyncLog::instance().flush(s.get());
+            writeToRecorders(s.get(), site, message);
+        }
 
         if (site.mLevel == LEVEL_ERROR)
         {
@@ -1440,6 +1873,41 @@ namespace LLError
     }
 }
 
+namespace LLError
+{
+    void setAsyncLogging(bool async, size_t queue_size)
+    {
+        if (async)
+        {
+            AsyncLog::instance().start(queue_size);
+        }
+        else
+        {
+            AsyncLog::instance().stop();
+        }
+    }
+
+    bool getAsyncLogging()
+    {
+        return sAsyncLogging;
+    }
+
+    void flushAsyncLogging()
+    {
+        AsyncLog::instance().flush();
+    }
+
+    void crashFlushLogging()
+    {
+        AsyncLog::instance().crashFlush();
+    }
+
+    U64 getDroppedLogCount()
+    {
+        return AsyncLog::instance().getDropped();
+    }
+}
+
 namespace LLError
 {
     SettingsStoragePtr saveAndResetSettings()
@@ -1501,15 +1969,7 @@ namespace LLError
 
     std::string utcTime()
     {
-        time_t now = time(NULL);
-        const size_t BUF_SIZE = 64;
-        char time_str[BUF_SIZE];    /* Flawfinder: ignore */
-
-        auto chars = strftime(time_str, BUF_SIZE,
-                                  "%Y-%m-%dT%H:%M:%SZ",
-                                  gmtime(&now));
-
-        return chars ? time_str : "time error";
+        return formatUTCTime(time(NULL));
     }
 }
 
@@ -227,6 +227,20 @@ namespace LLError
     LL_COMMON_API std::string logFileName();
         // returns name of current logging file, empty string if none
 
+    LL_COMMON_API void setAsyncLogging(bool async, size_t queue_size = 256 * 1024);
+        // Queue messages below LEVEL_ERROR on the thread logging them and
+        // have a background thread pass them to the recorders.  Each thread
+        // queues at most queue_size bytes, messages that don't fit are
+        // dropped and counted.  Turning it off writes out what is queued.
+    LL_COMMON_API bool getAsyncLogging();
+    LL_COMMON_API void flushAsyncLogging();
+        // Write out everything queued so far, on the calling thread
+    LL_COMMON_API void crashFlushLogging();
+        // For crash handlers: stop queueing and write out what is queued
+        // without waiting on the background thread
+    LL_COMMON_API U64 getDroppedLogCount();
+        // messages dropped because a thread's queue was full
+
 
     /*
         Utilities for use by the unit tests of LLError itself.
@@ -65,8 +65,8 @@ LLEventAPI::Response::~Response()
 {
     // When you instantiate a stack Response object, if the original
     // request requested a reply, send it when we leave this block, no
-    // matter how.
-    sendReply(mResp, mReq, mKey);
+    // matter how. mResp is done with, no need to copy it.
+    sendReply(std::move(mResp), mReq, mKey);
 }
 
 void LLEventAPI::Response::warn(const std::string& warning)
@@ -824,7 +824,7 @@ void LLDispatchListener::call_one(const LLSD& name, const LLSD& event) const
             // wrap the result in a map as the "data" key
             result = llsd::map("data", result);
         }
-        reply(result, event);
+        reply(std::move(result), event);
     }
 }
 
@@ -878,7 +878,7 @@ void LLDispatchListener::call_map(const LLSD& reqmap, const LLSD& event) const
         }
     }
 
-    reply(result, event);
+    reply(std::move(result), event);
 }
 
 void LLDispatchListener::call_array(const LLSD& reqarray, const LLSD& event) const
@@ -959,13 +959,13 @@ void LLDispatchListener::call_array(const LLSD& reqarray, const LLSD& event) con
         result["data"] = results;
     }
 
-    reply(result, event);
+    reply(std::move(result), event);
 }
 
-void LLDispatchListener::reply(const LLSD& reply, const LLSD& request) const
+void LLDispatchListener::reply(LLSD&& reply, const LLSD& request) const
 {
     // Call sendReply() unconditionally: sendReply() itself tests whether the
     // specified reply key is present in the incoming request, and does
     // nothing if there's no such key.
-    sendReply(reply, request, mReplyKey);
+    sendReply(std::move(reply), request, mReplyKey);
 }
@@ -856,7 +856,7 @@ private:
     void call_one(const LLSD& name, const LLSD& event) const;
     void call_map(const LLSD& reqmap, const LLSD& event) const;
     void call_array(const LLSD& reqarray, const LLSD& event) const;
-    void reply(const LLSD& reply, const LLSD& request) const;
+    void reply(LLSD&& reply, const LLSD& request) const;
 
     LLTempBoundListener mBoundListener;
     static std::string mReplyKey;
@@ -46,7 +46,7 @@
 *****************************************************************************/
 LLEventFilter::LLEventFilter(LLEventPump& source, const std::string& name, bool tweak):
     LLEventStream(name, tweak),
-    mSource(source.listen(getName(), boost::bind(&LLEventFilter::post, this, _1)))
+    mSource(source.listen(getName(), boost::bind(static_cast<LLEventPump::post_t>(&LLEventPump::post), this, _1)))
 {
 }
 
@@ -221,8 +221,8 @@ LLEventBatch::LLEventBatch(LLEventPump& source, std::size_t size):
 
 void LLEventBatch::flush()
 {
-    // copy and clear mBatch BEFORE posting to avoid weird circularity effects
-    LLSD batch(mBatch);
+    // take and clear mBatch BEFORE posting to avoid weird circularity effects
+    LLSD batch(std::move(mBatch));
     mBatch.clear();
     LLEventStream::post(batch);
 }
@@ -235,6 +235,13 @@ bool LLEventBatch::post(const LLSD& event)
     return false;
 }
 
+bool LLEventBatch::post(LLSD&& event)
+{
+    mBatch.append(std::move(event));
+    setSize(mBatchSize);
+    return false;
+}
+
 void LLEventBatch::setSize(std::size_t size)
 {
     mBatchSize = size;
@@ -273,10 +280,9 @@ void LLEventThrottleBase::flush()
         // any notification. This is just to track whether subsequent post()
         // calls fall within this mInterval or not.
         timerSet(mInterval);
-        // copy and clear mPending BEFORE posting to avoid weird circularity
+        // take and clear mPending BEFORE posting to avoid weird circularity
         // effects
-        LLSD pending = mPending;
-        mPending.clear();
+        LLSD pending = takePending();
         LLEventStream::post(pending);
     }
 }
@@ -286,12 +292,24 @@ LLSD LLEventThrottleBase::pending() const
     return mPending;
 }
 
+LLSD LLEventThrottleBase::takePending()
+{
+    LLSD pending(std::move(mPending));
+    mPending.clear();
+    return pending;
+}
+
 bool LLEventThrottleBase::post(const LLSD& event)
+{
+    return LLEventThrottleBase::post(LLSD(event));
+}
+
+bool LLEventThrottleBase::post(LLSD&& event)
 {
     // Always capture most recent post() event data. If caller wants to
     // aggregate multiple events, let them retrieve pending() and modify
     // before calling post().
-    mPending = event;
+    mPending = std::move(event);
     // Always increment mPosts. Unless we count this call, flush() does
     // nothing.
     ++mPosts;
@@ -411,10 +429,16 @@ LLEventBatchThrottle::LLEventBatchThrottle(LLEventPump& source, F32 interval, st
 
 bool LLEventBatchThrottle::post(const LLSD& event)
 {
-    // simply retrieve pending value and append the new event to it
-    LLSD partial = pending();
-    partial.append(event);
-    bool ret = LLEventThrottle::post(partial);
+    return LLEventBatchThrottle::post(LLSD(event));
+}
+
+bool LLEventBatchThrottle::post(LLSD&& event)
+{
+    // simply take the pending value and append the new event to it: a copy
+    // sharing the pending array would have to clone it to append
+    LLSD partial = takePending();
+    partial.append(std::move(event));
+    bool ret = LLEventThrottle::post(std::move(partial));
     // The post() call above MIGHT have called flush() already. If it did,
     // then pending() was reset to empty. If it did not, though, but the batch
     // size has grown to the limit, flush() anyway. If there's a limit at all,
@@ -51,6 +51,7 @@ public:
     /// construct LLEventFilter and connect it to the specified LLEventPump
     LLEventFilter(LLEventPump& source, const std::string& name="filter", bool tweak=true);
 
+    using LLEventStream::post;
     /// Post an event to all listeners
     virtual bool post(const LLSD& event) = 0;
 
@@ -69,6 +70,7 @@ public:
     /// instantiate and connect
     LLEventMatching(LLEventPump& source, const LLSD& pattern);
 
+    using LLEventFilter::post;
     /// Only pass through events matching the pattern
     virtual bool post(const LLSD& event);
 
@@ -175,6 +177,7 @@ public:
      */
     void eventAfter(F32 seconds, const LLSD& event);
 
+    using LLEventFilter::post;
     /// Pass event through, canceling the countdown timer
     virtual bool post(const LLSD& event);
 
@@ -253,6 +256,7 @@ public:
 
     // accumulate an event and flush() when big enough
     virtual bool post(const LLSD& event);
+    virtual bool post(LLSD&& event);
 
     // query or reset batch size
     std::size_t getSize() const { return mBatchSize; }
@@ -313,6 +317,7 @@ public:
 
     // register an event, may be either passed through or deferred
     virtual bool post(const LLSD& event);
+    virtual bool post(LLSD&& event);
 
     // query or reset interval
     F32 getInterval() const { return mInterval; }
@@ -325,6 +330,10 @@ public:
     F32 getDelay() const;
 
 protected:
+    // pending(), leaving it isUndefined(): for a subclass that modifies and
+    // post()s it again
+    LLSD takePending();
+
     // Implement these time-related methods for a valid LLEventThrottleBase
     // subclass (see LLEventThrottle). For testing, we use a subclass that
     // doesn't involve actual elapsed time.
@@ -384,6 +393,7 @@ public:
 
     // append a new event to current batch
     virtual bool post(const LLSD& event);
+    virtual bool post(LLSD&& event);
 
     // query or reset batch size
     std::size_t getSize() const { return mBatchSize; }
@@ -425,6 +435,7 @@ public:
         mConsume(consume)
     {}
 
+    using LLEventFilter::post;
     // Calling post() with an LLSD event extracts the element indicated by
     // path, then stores it to mTarget.
     virtual bool post(const LLSD& event)
@@ -524,6 +535,7 @@ public:
     LLBoundListener listen_impl(const std::string& name, const LLEventListener& target,
                                 const NameList& after, const NameList& before);
 
+    using LLEventFilter::post;
     /// Post an event to all listeners
     virtual bool post(const LLSD& event) /* override */;
 
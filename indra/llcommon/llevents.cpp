@@ -191,6 +191,16 @@ bool LLEventPumps::post(const std::string&name, const LLSD&message)
     return (*found).second->post(message);
 }
 
+bool LLEventPumps::post(const std::string&name, LLSD&&message)
+{
+    PumpMap::iterator found = mPumpMap.find(name);
+
+    if (found == mPumpMap.end())
+        return false;
+
+    return (*found).second->post(std::move(message));
+}
+
 void LLEventPumps::flush()
 {
     // Flush every known LLEventPump instance. Leave it up to each instance to
@@ -651,6 +661,19 @@ bool LLEventMailDrop::post(const LLSD& event)
     return posted;
 }
 
+bool LLEventMailDrop::post(LLSD&& event)
+{
+    // listeners see it as const LLSD&, so it's still ours to keep
+    bool posted = LLEventStream::post(std::as_const(event));
+
+    if (!posted)
+    {
+        mEventHistory.push_back(std::move(event));
+    }
+
+    return posted;
+}
+
 LLBoundListener LLEventMailDrop::listen_impl(const std::string& name,
                                     const LLEventListener& listener,
                                     const NameList& after,
@@ -687,7 +710,7 @@ void LLEventMailDrop::discard()
 *****************************************************************************/
 LLListenerOrPumpName::LLListenerOrPumpName(const std::string& pumpname):
     // Look up the specified pumpname, and bind its post() method as our listener
-    mListener(boost::bind(&LLEventPump::post,
+    mListener(boost::bind(static_cast<LLEventPump::post_t>(&LLEventPump::post),
                           boost::ref(LLEventPumps::instance().obtain(pumpname)),
                           _1))
 {
@@ -695,7 +718,7 @@ LLListenerOrPumpName::LLListenerOrPumpName(const std::string& pumpname):
 
 LLListenerOrPumpName::LLListenerOrPumpName(const char* pumpname):
     // Look up the specified pumpname, and bind its post() method as our listener
-    mListener(boost::bind(&LLEventPump::post,
+    mListener(boost::bind(static_cast<LLEventPump::post_t>(&LLEventPump::post),
                           boost::ref(LLEventPumps::instance().obtain(pumpname)),
                           _1))
 {
@@ -734,6 +757,12 @@ void LLReqID::stamp(LLSD& response) const
 }
 
 bool sendReply(const LLSD& reply, const LLSD& request, const std::string& replyKey)
+{
+    // Copy 'reply' to modify it.
+    return sendReply(LLSD(reply), request, replyKey);
+}
+
+bool sendReply(LLSD&& reply, const LLSD& request, const std::string& replyKey)
 {
     // If the original request has no value for replyKey, it's pointless to
     // construct or send a reply event: on which LLEventPump should we send
@@ -746,13 +775,10 @@ bool sendReply(const LLSD& reply, const LLSD& request, const std::string& replyK
 
     // Here the request definitely contains replyKey; reasonable to proceed.
 
-    // Copy 'reply' to modify it.
-    LLSD newreply(reply);
     // Get the ["reqid"] element from request
     LLReqID reqID(request);
-    // and copy it to 'newreply'.
-    reqID.stamp(newreply);
-    // Send reply on LLEventPump named in request[replyKey]. Don't forget to
-    // send the modified 'newreply' instead of the original 'reply'.
-    return LLEventPumps::instance().obtain(request[replyKey]).post(newreply);
+    // and copy it to 'reply'.
+    reqID.stamp(reply);
+    // Send reply on LLEventPump named in request[replyKey].
+    return LLEventPumps::instance().obtain(request[replyKey]).post(std::move(reply));
 }
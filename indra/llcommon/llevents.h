@@ -38,6 +38,7 @@
 #include <vector>
 #include <deque>
 #include <functional>
+#include <utility>
 
 #include <boost/signals2.hpp>
 #include <boost/bind.hpp>
@@ -310,6 +311,7 @@ public:
      * however if the pump does not already exist it will not be created.
      */
     bool post(const std::string&, const LLSD&);
+    bool post(const std::string&, LLSD&&);
 
     /**
      * Flush all known LLEventPump instances
@@ -571,6 +573,15 @@ public:
     /// it too much! Truthfully, we return @c bool mostly to permit chaining
     /// one LLEventPump as a listener on another.
     virtual bool post(const LLSD&) = 0;
+    /// Post an event the caller has no further use for. Every listener still
+    /// sees it as a const LLSD&; a pump that keeps events, like
+    /// LLEventMailDrop, takes this one over instead of copying it. A
+    /// subclass overriding just post(const LLSD&) wants <tt>using
+    /// LLEventPump::post;</tt> so as not to hide this one.
+    virtual bool post(LLSD&& event) { return post(std::as_const(event)); }
+    /// post(const LLSD&) for boost::bind(), which can't pick an overload:
+    /// <tt>boost::bind(static_cast<LLEventPump::post_t>(&LLEventPump::post), ...)</tt>
+    typedef bool (LLEventPump::*post_t)(const LLSD&);
     /// Enable/disable: while disabled, silently ignore all post() calls
     virtual void enable(bool enabled=true) { mEnabled = enabled; }
     /// query
@@ -634,6 +645,7 @@ public:
     LLEventStream(const std::string& name, bool tweak=false): LLEventPump(name, tweak) {}
     virtual ~LLEventStream() {}
 
+    using LLEventPump::post;
     /// Post an event to all listeners
     virtual bool post(const LLSD& event);
 };
@@ -665,8 +677,10 @@ public:
     LLEventMailDrop(const std::string& name, bool tweak = false) : LLEventStream(name, tweak) {}
     virtual ~LLEventMailDrop() {}
 
+    using LLEventStream::post;
     /// Post an event to all listeners
     virtual bool post(const LLSD& event) override;
+    virtual bool post(LLSD&& event) override;
 
     /// Remove any history stored in the mail drop.
     void discard();
@@ -775,5 +789,8 @@ private:
  */
 LL_COMMON_API bool sendReply(const LLSD& reply, const LLSD& request,
                              const std::string& replyKey="reply");
+/// Stamps the ["reqid"] into @a reply itself, rather than into a copy
+LL_COMMON_API bool sendReply(LLSD&& reply, const LLSD& request,
+                             const std::string& replyKey="reply");
 
 #endif /* ! defined(LL_LLEVENTS_H) */
@@ -0,0 +1,238 @@
+/**
+ * @file llindexedheap.h
+ * @brief Binary max-heap with a key index for O(log n) reprioritization.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLINDEXEDHEAP_H
+#define LL_LLINDEXEDHEAP_H
+
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+//
+// Priority queue where every key appears at most once and can be looked up,
+// reprioritized or removed in O(log n).  Unlike LLPriQueueMap (which erases
+// and reinserts into a std::map) there is no per-node allocation once the
+// heap has grown to its working size.  Greatest priority is on top.
+//
+// Not thread safe, callers provide their own locking.
+//
+template <typename KEY, typename PRIORITY, typename HASH = std::hash<KEY>>
+class LLIndexedHeap
+{
+public:
+    typedef KEY key_type;
+    typedef PRIORITY priority_type;
+
+    bool empty() const      { return mHeap.empty(); }
+    size_t size() const     { return mHeap.size(); }
+
+    void clear()
+    {
+        mHeap.clear();
+        mIndex.clear();
+    }
+
+    void reserve(size_t count)
+    {
+        mHeap.reserve(count);
+        mIndex.reserve(count);
+    }
+
+    bool contains(const KEY& key) const
+    {
+        return mIndex.find(key) != mIndex.end();
+    }
+
+    // Insert key with priority, or reprioritize it if already present.
+    // Returns true if key was newly inserted.
+    bool push(const KEY& key, const PRIORITY& priority)
+    {
+        auto found = mIndex.find(key);
+        if (found != mIndex.end())
+        {
+            update(found->second, priority);
+            return false;
+        }
+
+        size_t pos = mHeap.size();
+        mHeap.emplace_back(key, priority);
+        mIndex.emplace(key, pos);
+        siftUp(pos);
+        return true;
+    }
+
+    // Change priority of a key already in the heap.
+    // Returns false if key is not present.
+    bool reprioritize(const KEY& key, const PRIORITY& priority)
+    {
+        auto found = mIndex.find(key);
+        if (found == mIndex.end())
+        {
+            return false;
+        }
+        update(found->second, priority);
+        return true;
+    }
+
+    bool getPriority(const KEY& key, PRIORITY& priority) const
+    {
+        auto found = mIndex.find(key);
+        if (found == mIndex.end())
+        {
+            return false;
+        }
+        priority = mHeap[found->second].second;
+        return true;
+    }
+
+    bool erase(const KEY& key)
+    {
+        auto found = mIndex.find(key);
+        if (found == mIndex.end())
+        {
+            return false;
+        }
+        size_t pos = found->second;
+        mIndex.erase(found);
+        removeAt(pos);
+        return true;
+    }
+
+    // Undefined if empty()
+    const KEY& top() const              { return mHeap.front().first; }
+    const PRIORITY& topPriority() const { return mHeap.front().second; }
+
+    bool pop(KEY* key = nullptr, PRIORITY* priority = nullptr)
+    {
+        if (mHeap.empty())
+        {
+            return false;
+        }
+        if (key)
+        {
+            *key = mHeap.front().first;
+        }
+        if (priority)
+        {
+            *priority = mHeap.front().second;
+        }
+        mIndex.erase(mHeap.front().first);
+        removeAt(0);
+        return true;
+    }
+
+    // Unordered traversal of (key, priority) pairs
+    typedef typename std::vector<std::pair<KEY, PRIORITY>>::const_iterator const_iterator;
+    const_iterator begin() const    { return mHeap.begin(); }
+    const_iterator end() const      { return mHeap.end(); }
+
+private:
+    void update(size_t pos, const PRIORITY& priority)
+    {
+        const bool raised = mHeap[pos].second < priority;
+        mHeap[pos].second = priority;
+        if (raised)
+        {
+            siftUp(pos);
+        }
+        else
+        {
+            siftDown(pos);
+        }
+    }
+
+    // caller has already removed mHeap[pos] from mIndex
+    void removeAt(size_t pos)
+    {
+        size_t last = mHeap.size() - 1;
+        if (pos != last)
+        {
+            mHeap[pos] = std::move(mHeap[last]);
+            mIndex[mHeap[pos].first] = pos;
+            mHeap.pop_back();
+            // the moved element may need to go either way
+            siftDown(siftUp(pos));
+        }
+        else
+        {
+            mHeap.pop_back();
+        }
+    }
+
+    size_t siftUp(size_t pos)
+    {
+        while (pos > 0)
+        {
+            size_t parent = (pos - 1) / 2;
+            if (!(mHeap[parent].second < mHeap[pos].second))
+            {
+                break;
+            }
+            swapEntries(pos, parent);
+            pos = parent;
+        }
+        return pos;
+    }
+
+    size_t siftDown(size_t pos)
+    {
+        const size_t count = mHeap.size();
+        while (true)
+        {
+            size_t largest = pos;
+            size_t left = pos * 2 + 1;
+            size_t right = left + 1;
+            if (left < count && mHeap[largest].second < mHeap[left].second)
+            {
+                largest = left;
+            }
+            if (right < count && mHeap[largest].second < mHeap[right].second)
+            {
+                largest = right;
+            }
+            if (largest == pos)
+            {
+                break;
+            }
+            swapEntries(pos, largest);
+            pos = largest;
+        }
+        return pos;
+    }
+
+    void swapEntries(size_t a, size_t b)
+    {
+        std::swap(mHeap[a], mHeap[b]);
+        mIndex[mHeap[a].first] = a;
+        mIndex[mHeap[b].first] = b;
+    }
+
+    std::vector<std::pair<KEY, PRIORITY>> mHeap;
+    std::unordered_map<KEY, size_t, HASH> mIndex;
+};
+
+#endif // LL_LLINDEXEDHEAP_H
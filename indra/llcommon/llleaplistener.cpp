@@ -164,7 +164,7 @@ void LLLeapListener::listen(const LLSD& request)
                 LLEventPump & dest = LLEventPumps::instance().obtain(dest_name);
                 saveListener(source_name, listener_name,
                              source.listen(listener_name,
-                                           boost::bind(&LLEventPump::post, &dest, _1)));
+                                           boost::bind(static_cast<LLEventPump::post_t>(&LLEventPump::post), &dest, _1)));
             }
             else
             {
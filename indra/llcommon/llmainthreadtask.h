@@ -48,7 +48,7 @@ private:
     LLMainThreadTask() {}
 
 public:
-    /// dispatch() is the only way to invoke this functionality.
+    /// dispatch() and post() are the only ways to invoke this functionality.
     template <typename CALLABLE>
     static auto dispatch(CALLABLE&& callable) -> decltype(callable())
     {
@@ -70,7 +70,34 @@ public:
         }
     }
 
+    /// post() runs your task on the main thread like dispatch(), but
+    /// returns at once rather than waiting for it, even on the main thread.
+    template <typename CALLABLE>
+    static void post(CALLABLE&& callable)
+    {
+        // LLEventTimer deletes it once it has run, as with dispatch()
+        new Post<std::decay_t<CALLABLE>>(std::forward<CALLABLE>(callable));
+    }
+
 private:
+    template <typename CALLABLE>
+    struct Post: public LLEventTimer
+    {
+        template <typename FUNC>
+        Post(FUNC&& callable):
+            // no wait time: call tick() next chance we get
+            LLEventTimer(0),
+            mCallable(std::forward<FUNC>(callable))
+        {}
+        bool tick() override
+        {
+            mCallable();
+            // one shot
+            return true;
+        }
+        CALLABLE mCallable;
+    };
+
     template <typename CALLABLE>
     struct Task: public LLEventTimer
     {
@@ -110,12 +110,15 @@ extern thread_local bool gProfilerEnabled;
         #define LL_PROFILE_MUTEX_LOCK(varname) { auto& mutex = varname; LockMark(mutex); }
     #endif
     #if LL_PROFILER_CONFIGURATION == LL_PROFILER_CONFIG_FAST_TIMER
-        #define LL_PROFILER_FRAME_END
-        #define LL_PROFILER_SET_THREAD_NAME( name )      (void)(name)
-        #define LL_RECORD_BLOCK_TIME(name)                                                                  const LLTrace::BlockTimer& LL_GLUE_TOKENS(block_time_recorder, __LINE__)(LLTrace::timeThisBlock(name)); (void)LL_GLUE_TOKENS(block_time_recorder, __LINE__);
-        #define LL_PROFILE_ZONE_NAMED(name)             // LL_PROFILE_ZONE_NAMED is a no-op when Tracy is disabled
-        #define LL_PROFILE_ZONE_NAMED_COLOR(name,color) // LL_PROFILE_ZONE_NAMED_COLOR is a no-op when Tracy is disabled
-        #define LL_PROFILE_ZONE_SCOPED                  // LL_PROFILE_ZONE_SCOPED is a no-op when Tracy is disabled
+        // Without Tracy the zones go to the event trace, see lltraceevents.h
+        #include "lltraceevents.h"
+
+        #define LL_PROFILER_FRAME_END                   do { if (LLTrace::EventTrace::isEnabled()) LLTrace::EventTrace::instant("Frame"); } while (0)
+        #define LL_PROFILER_SET_THREAD_NAME( name )     LLTrace::EventTrace::setThreadName( name )
+        #define LL_RECORD_BLOCK_TIME(name)                                                                  LLTrace::EventZone LL_GLUE_TOKENS(block_time_event, __LINE__)((name).getName().c_str()); const LLTrace::BlockTimer& LL_GLUE_TOKENS(block_time_recorder, __LINE__)(LLTrace::timeThisBlock(name)); (void)LL_GLUE_TOKENS(block_time_recorder, __LINE__);
+        #define LL_PROFILE_ZONE_NAMED(name)             LLTrace::EventZone LL_GLUE_TOKENS(trace_event_zone, __LINE__)(name);
+        #define LL_PROFILE_ZONE_NAMED_COLOR(name,color) LLTrace::EventZone LL_GLUE_TOKENS(trace_event_zone, __LINE__)(name); (void)(color);
+        #define LL_PROFILE_ZONE_SCOPED                  LLTrace::EventZone LL_GLUE_TOKENS(trace_event_zone, __LINE__)(__FUNCTION__);
         #define LL_PROFILE_ZONE_COLOR(name,color)       // LL_RECORD_BLOCK_TIME(name)
 
         #define LL_PROFILE_ZONE_NUM( val )              (void)( val );                // Not supported
@@ -37,6 +37,7 @@
 #include "llsdserialize.h"
 #include "stringize.h"
 
+#include <algorithm>
 #include <limits>
 
 // Defend against a caller forcibly passing a negative number into an unsigned
@@ -61,6 +62,103 @@ namespace
 {
     class ImplMap;
     class ImplArray;
+
+#ifdef LLSD_FLAT_MAP
+    typedef LLSD::map_nodes MapData;
+
+    // The part of std::map's interface ImplMap uses, over a vector of
+    // pointers sorted by key. The pairs don't move when the vector does.
+    class FlatMap
+    {
+    public:
+        typedef LLSD::map_iterator iterator;
+        typedef LLSD::map_const_iterator const_iterator;
+
+        FlatMap() = default;
+        FlatMap(const FlatMap& other)
+        {
+            mData.reserve(other.mData.size());
+            for (const auto& node : other.mData)
+            {
+                mData.emplace_back(new LLSD::map_value_type(*node));
+            }
+        }
+
+        iterator        begin()         { return mData.begin(); }
+        iterator        end()           { return mData.end(); }
+        const_iterator  begin() const   { return mData.begin(); }
+        const_iterator  end() const     { return mData.end(); }
+        size_t          size() const    { return mData.size(); }
+        bool            empty() const   { return mData.empty(); }
+
+        std::less<> key_comp() const    { return std::less<>(); }
+
+        iterator lower_bound(std::string_view k)
+        {
+            return iterator(std::lower_bound(mData.begin(), mData.end(), k, KeyLess()));
+        }
+        const_iterator lower_bound(std::string_view k) const
+        {
+            return const_iterator(std::lower_bound(mData.begin(), mData.end(), k, KeyLess()));
+        }
+
+        iterator find(std::string_view k)
+        {
+            iterator i = lower_bound(k);
+            return (i != end() && i->first == k) ? i : end();
+        }
+        const_iterator find(std::string_view k) const
+        {
+            const_iterator i = lower_bound(k);
+            return (i != end() && i->first == k) ? i : end();
+        }
+
+        std::pair<iterator, bool> emplace(std::string_view k, const LLSD& v)
+        {
+            iterator i = lower_bound(k);
+            if (i != end() && i->first == k)
+            {
+                return { i, false };
+            }
+            return { insert(i, new LLSD::map_value_type(k, v)), true };
+        }
+
+        // hint must be where the key belongs
+        iterator emplace_hint(iterator hint, std::pair<std::string_view, LLSD>&& pair)
+        {
+            return insert(hint, new LLSD::map_value_type(pair.first, std::move(pair.second)));
+        }
+
+        size_t erase(std::string_view k)
+        {
+            iterator i = find(k);
+            if (i == end())
+            {
+                return 0;
+            }
+            mData.erase(i.base());
+            return 1;
+        }
+
+    private:
+        iterator insert(iterator where, LLSD::map_value_type* node)
+        {
+            return mData.emplace(where.base(), node);
+        }
+
+        struct KeyLess
+        {
+            bool operator()(const MapData::value_type& node, std::string_view k) const
+            {
+                return node->first < k;
+            }
+        };
+
+        MapData mData;
+    };
+#else
+    typedef std::map<LLSD::String, LLSD, std::less<>> MapData;
+#endif
 }
 
 #ifdef NAME_UNNAMED_NAMESPACE
@@ -123,9 +221,6 @@ public:
     static  void assignUndefined(LLSD::Impl*& var);
     static  void assign(LLSD::Impl*& var, const LLSD::Impl* other);
 
-    virtual void assign(Impl*& var, LLSD::Boolean);
-    virtual void assign(Impl*& var, LLSD::Integer);
-    virtual void assign(Impl*& var, LLSD::Real);
     virtual void assign(Impl*& var, const char*);
     virtual void assign(Impl*& var, const LLSD::String&);
     virtual void assign(Impl*& var, const LLSD::UUID&);
@@ -166,7 +261,7 @@ public:
     virtual const LLSD& ref(size_t) const       { return undef(); }
 
     virtual LLSD::map_const_iterator beginMap() const { return endMap(); }
-    virtual LLSD::map_const_iterator endMap() const { static const std::map<String, LLSD> empty; return empty.end(); }
+    virtual LLSD::map_const_iterator endMap() const { static const MapData empty; return LLSD::map_const_iterator(empty.end()); }
     virtual LLSD::array_const_iterator beginArray() const { return endArray(); }
     virtual LLSD::array_const_iterator endArray() const { static const std::vector<LLSD> empty; return empty.end(); }
 
@@ -176,11 +271,24 @@ public:
     // containing Impl objects. This helper forwards through LLSD.
     void calcStats(const LLSD& llsd, S32 type_counts[], S32 share_counts[]) const
     {
-        safe(llsd.impl).calcStats(type_counts, share_counts);
+        if (llsd.mInline)
+        {
+            type_counts[llsd.mInline]++;
+        }
+        else
+        {
+            safe(llsd.impl).calcStats(type_counts, share_counts);
+        }
     }
 
-    static const Impl& getImpl(const LLSD& llsd)    { return safe(llsd.impl); }
-    static Impl& getImpl(LLSD& llsd)                { return safe(llsd.impl); }
+    static const Impl& getImpl(const LLSD& llsd)    { return container(llsd); }
+
+    // The Impl providing the map and array operations of llsd: an inline
+    // value has none, like Undefined
+    static const Impl& container(const LLSD& llsd)
+    {
+        return safe(llsd.mInline ? static_cast<const Impl*>(nullptr) : llsd.impl);
+    }
 
     static const LLSD& undef();
 
@@ -235,69 +343,57 @@ namespace
     };
 
 
-    class ImplBoolean final
-        : public ImplBase<LLSD::TypeBoolean, LLSD::Boolean, LLSD::Boolean, LLSD::Boolean&&>
-    {
-    public:
-        ImplBoolean(LLSD::Boolean v) : Base(v) { }
-
-        virtual LLSD::Boolean   asBoolean() const   { return mValue; }
-        virtual LLSD::Integer   asInteger() const   { return mValue ? 1 : 0; }
-        virtual LLSD::Real      asReal() const      { return mValue ? 1 : 0; }
-        virtual LLSD::String    asString() const;
+    // Conversions of the inline values, the Boolean, Integer and Real
+    // types have no Impl.
 
-        virtual LLSD::String asXMLRPCValue() const { return mValue ? "<boolean>1</boolean>" : "<boolean>0</boolean>"; }
-    };
-
-    LLSD::String ImplBoolean::asString() const
+    LLSD::String booleanString(LLSD::Boolean v)
         // *NOTE: The reason that false is not converted to "false" is
         // because that would break roundtripping,
         // e.g. LLSD(false).asString().asBoolean().  There are many
         // reasons for wanting LLSD("false").asBoolean() == true, such
         // as "everything else seems to work that way".
-        { return mValue ? "true" : ""; }
+        { return v ? "true" : ""; }
 
+    LLSD::String integerString(LLSD::Integer v)
+        { return llformat("%d", v); }
 
-    class ImplInteger final
-        : public ImplBase<LLSD::TypeInteger, LLSD::Integer, LLSD::Integer, LLSD::Integer&&>
-    {
-    public:
-        ImplInteger(LLSD::Integer v) : Base(v) { }
-
-        virtual LLSD::Boolean   asBoolean() const   { return mValue != 0; }
-        virtual LLSD::Integer   asInteger() const   { return mValue; }
-        virtual LLSD::Real      asReal() const      { return mValue; }
-        virtual LLSD::String    asString() const;
+    LLSD::Boolean realBoolean(LLSD::Real v)
+        { return !llisnan(v)  &&  v != 0.0; }
 
-        virtual LLSD::String asXMLRPCValue() const { return "<int>" + std::to_string(mValue) + "</int>"; }
-    };
+    LLSD::Integer realInteger(LLSD::Real v)
+        { return !llisnan(v) ? (LLSD::Integer)v : 0; }
 
-    LLSD::String ImplInteger::asString() const
-        { return llformat("%d", mValue); }
+    LLSD::String realString(LLSD::Real v)
+        { return llformat("%lg", v); }
 
-
-    class ImplReal final
-        : public ImplBase<LLSD::TypeReal, LLSD::Real, LLSD::Real, LLSD::Real&&>
+    LLSD::Real stringReal(const LLSD::String& v)
     {
-    public:
-        ImplReal(LLSD::Real v) : Base(v) { }
+        F64 real = 0.0;
+        std::istringstream i_stream(v);
+        i_stream >> real;
 
-        virtual LLSD::Boolean   asBoolean() const;
-        virtual LLSD::Integer   asInteger() const;
-        virtual LLSD::Real      asReal() const      { return mValue; }
-        virtual LLSD::String    asString() const;
-
-        virtual LLSD::String asXMLRPCValue() const { return "<double>" + std::to_string(mValue) + "</double>"; }
-    };
+        // we would probably like to ignore all trailing whitespace as
+        // well, but for now, simply eat the next character, and make
+        // sure we reached the end of the string.
+        // *NOTE: gcc 2.95 does not generate an eof() event on the
+        // stream operation above, so we manually get here to force it
+        // across platforms.
+        int c = i_stream.get();
+        return ((EOF ==c) ? real : 0.0);
+    }
 
-    LLSD::Boolean ImplReal::asBoolean() const
-        { return !llisnan(mValue)  &&  mValue != 0.0; }
+    LLSD::Integer stringInteger(const LLSD::String& v)
+    {
+        // This must treat "1.23" not as an error, but as a number, which is
+        // then truncated down to an integer.  Hence, this code doesn't call
+        // std::istringstream::operator>>(int&), which would not consume the
+        // ".23" portion.
 
-    LLSD::Integer ImplReal::asInteger() const
-        { return !llisnan(mValue) ? (LLSD::Integer)mValue : 0; }
+        return (int)stringReal(v);
+    }
 
-    LLSD::String ImplReal::asString() const
-        { return llformat("%lg", mValue); }
+    LLSD::String stringXMLRPCValue(const LLSD::String& v)
+        { return "<string>" + LLStringFn::xml_encode(v) + "</string>"; }
 
 
     class ImplString final
@@ -308,8 +404,8 @@ namespace
         ImplString(LLSD::String&& v) : Base(std::move(v)) {}
 
         virtual LLSD::Boolean   asBoolean() const   { return !mValue.empty(); }
-        virtual LLSD::Integer   asInteger() const;
-        virtual LLSD::Real      asReal() const;
+        virtual LLSD::Integer   asInteger() const   { return stringInteger(mValue); }
+        virtual LLSD::Real      asReal() const      { return stringReal(mValue); }
         virtual LLSD::String    asString() const    { return mValue; }
         virtual LLSD::UUID      asUUID() const  { return LLUUID(mValue); }
         virtual LLSD::Date      asDate() const  { return LLDate(mValue); }
@@ -317,7 +413,7 @@ namespace
         virtual size_t          size() const    { return mValue.size(); }
         virtual const LLSD::String& asStringRef() const { return mValue; }
 
-        virtual LLSD::String asXMLRPCValue() const { return "<string>" + LLStringFn::xml_encode(mValue) + "</string>"; }
+        virtual LLSD::String asXMLRPCValue() const { return stringXMLRPCValue(mValue); }
 
         using LLSD::Impl::assign; // Unhiding base class virtuals...
         virtual void assign(LLSD::Impl*& var, const char* value)
@@ -333,33 +429,6 @@ namespace
         }
     };
 
-    LLSD::Integer ImplString::asInteger() const
-    {
-        // This must treat "1.23" not as an error, but as a number, which is
-        // then truncated down to an integer.  Hence, this code doesn't call
-        // std::istringstream::operator>>(int&), which would not consume the
-        // ".23" portion.
-
-        return (int)asReal();
-    }
-
-    LLSD::Real ImplString::asReal() const
-    {
-        F64 v = 0.0;
-        std::istringstream i_stream(mValue);
-        i_stream >> v;
-
-        // we would probably like to ignore all trailing whitespace as
-        // well, but for now, simply eat the next character, and make
-        // sure we reached the end of the string.
-        // *NOTE: gcc 2.95 does not generate an eof() event on the
-        // stream operation above, so we manually get here to force it
-        // across platforms.
-        int c = i_stream.get();
-        return ((EOF ==c) ? v : 0.0);
-    }
-
-
     class ImplUUID final
         : public ImplBase<LLSD::TypeUUID, LLSD::UUID, const LLSD::UUID&, LLSD::UUID&&>
     {
@@ -431,7 +500,11 @@ namespace
     class ImplMap final : public LLSD::Impl
     {
     private:
-        typedef std::map<LLSD::String, LLSD, std::less<>> DataMap;
+#ifdef LLSD_FLAT_MAP
+        typedef FlatMap DataMap;
+#else
+        typedef MapData DataMap;
+#endif
 
         DataMap mData;
 
@@ -626,6 +699,7 @@ namespace
                 void set(size_t, const LLSD&);
                 void insert(size_t, const LLSD&);
                 LLSD& append(const LLSD&);
+                LLSD& append(LLSD&&);
         virtual void erase(size_t);
                       LLSD& ref(size_t);
         virtual const LLSD& ref(size_t) const;
@@ -696,6 +770,12 @@ namespace
         return mData.back();
     }
 
+    LLSD& ImplArray::append(LLSD&& v)
+    {
+        mData.push_back(std::move(v));
+        return mData.back();
+    }
+
     void ImplArray::erase(size_t i)
     {
         NEGATIVE_EXIT(i);
@@ -824,21 +904,6 @@ void LLSD::Impl::assignUndefined(Impl*& var)
     reset(var, 0);
 }
 
-void LLSD::Impl::assign(Impl*& var, LLSD::Boolean v)
-{
-    reset(var, new ImplBoolean(v));
-}
-
-void LLSD::Impl::assign(Impl*& var, LLSD::Integer v)
-{
-    reset(var, new ImplInteger(v));
-}
-
-void LLSD::Impl::assign(Impl*& var, LLSD::Real v)
-{
-    reset(var, new ImplReal(v));
-}
-
 void LLSD::Impl::assign(Impl*& var, const char* v)
 {
     reset(var, new ImplString(v));
@@ -960,69 +1025,197 @@ namespace
 }
 
 
-LLSD::LLSD() : impl(0)                  { ALLOC_LLSD_OBJECT; }
-LLSD::~LLSD()                           { FREE_LLSD_OBJECT; Impl::reset(impl, 0); }
+LLSD::LLSD() : impl(nullptr), mInline(TypeUndefined)   { ALLOC_LLSD_OBJECT; }
+LLSD::~LLSD()                           { FREE_LLSD_OBJECT; release(); }
+
+void LLSD::release()
+{
+    if (mInline)
+    {
+        mInline = TypeUndefined;
+        impl = nullptr;
+    }
+    else
+    {
+        Impl::reset(impl, nullptr);
+    }
+}
+
+LLSD::Impl*& LLSD::mutableImpl()
+{
+    if (mInline)
+    {
+        release();
+    }
+    return impl;
+}
+
+void LLSD::moveFrom(LLSD& other) noexcept
+{
+    switch (other.mInline)
+    {
+    case TypeUndefined:
+        // steal the impl without touching its use count
+        impl = other.impl;
+        other.impl = nullptr;
+        return;
+    case TypeBoolean:   mBoolean = other.mBoolean;  break;
+    case TypeInteger:   mInteger = other.mInteger;  break;
+    case TypeReal:      mReal = other.mReal;        break;
+    }
+    mInline = other.mInline;
+    other.mInline = TypeUndefined;
+    other.impl = nullptr;
+}
 
-LLSD::LLSD(const LLSD& other) : impl(0) { ALLOC_LLSD_OBJECT;  assign(other); }
-void LLSD::assign(const LLSD& other)    { Impl::assign(impl, other.impl); }
+LLSD::LLSD(const LLSD& other) : impl(nullptr), mInline(TypeUndefined) { ALLOC_LLSD_OBJECT;  assign(other); }
+void LLSD::assign(const LLSD& other)
+{
+    if (! mInline && ! other.mInline)
+    {
+        Impl::assign(impl, other.impl);
+        return;
+    }
+    if (this == &other)
+    {
+        return;
+    }
+    // copy before releasing: other may be an element of this
+    LLSD value;
+    switch (other.mInline)
+    {
+    case TypeUndefined: Impl::assign(value.impl, other.impl);       break;
+    case TypeBoolean:   value.mBoolean = other.mBoolean;            break;
+    case TypeInteger:   value.mInteger = other.mInteger;            break;
+    case TypeReal:      value.mReal = other.mReal;                  break;
+    }
+    value.mInline = other.mInline;
+    release();
+    moveFrom(value);
+}
 
-LLSD::LLSD(LLSD&& other) noexcept : impl(nullptr) { ALLOC_LLSD_OBJECT;  Impl::move(impl, other.impl); }
-void  LLSD::assign(LLSD&& other) { Impl::move(impl, other.impl); }
-LLSD& LLSD::operator=(LLSD&& other) noexcept { Impl::move(impl, other.impl); return *this; }
+LLSD::LLSD(LLSD&& other) noexcept : impl(nullptr), mInline(TypeUndefined) { ALLOC_LLSD_OBJECT;  moveFrom(other); }
+void LLSD::assign(LLSD&& other)
+{
+    if (! mInline && ! other.mInline)
+    {
+        Impl::move(impl, other.impl);
+        return;
+    }
+    if (this == &other)
+    {
+        return;
+    }
+    LLSD value(std::move(other));
+    release();
+    moveFrom(value);
+}
+LLSD& LLSD::operator=(LLSD&& other) noexcept { assign(std::move(other)); return *this; }
 
-void LLSD::clear()                      { Impl::assignUndefined(impl); }
+void LLSD::clear()                      { release(); }
 
-LLSD::Type LLSD::type() const           { return safe(impl).type(); }
+LLSD::Type LLSD::type() const           { return mInline ? Type(mInline) : safe(impl).type(); }
 
 // Scalar Constructors
-LLSD::LLSD(Boolean v) : impl(0)         { ALLOC_LLSD_OBJECT;    assign(v); }
-LLSD::LLSD(Integer v) : impl(0)         { ALLOC_LLSD_OBJECT;    assign(v); }
-LLSD::LLSD(Real v) : impl(0)            { ALLOC_LLSD_OBJECT;    assign(v); }
-LLSD::LLSD(const UUID& v) : impl(0)     { ALLOC_LLSD_OBJECT;    assign(v); }
-LLSD::LLSD(const String& v) : impl(0)   { ALLOC_LLSD_OBJECT;    assign(v); }
-LLSD::LLSD(const Date& v) : impl(0)     { ALLOC_LLSD_OBJECT;    assign(v); }
-LLSD::LLSD(const URI& v) : impl(0)      { ALLOC_LLSD_OBJECT;    assign(v); }
-LLSD::LLSD(const Binary& v) : impl(0)   { ALLOC_LLSD_OBJECT;    assign(v); }
-LLSD::LLSD(UUID&& v) : impl(0)          { ALLOC_LLSD_OBJECT;    assign(std::move(v)); }
-LLSD::LLSD(String&& v) : impl(0)        { ALLOC_LLSD_OBJECT;    assign(std::move(v)); }
-LLSD::LLSD(Date&& v) : impl(0)          { ALLOC_LLSD_OBJECT;    assign(std::move(v)); }
-LLSD::LLSD(URI&& v) : impl(0)           { ALLOC_LLSD_OBJECT;    assign(std::move(v)); }
-LLSD::LLSD(Binary&& v) : impl(0)        { ALLOC_LLSD_OBJECT;    assign(std::move(v)); }
+LLSD::LLSD(Boolean v) : impl(nullptr), mInline(TypeUndefined)       { ALLOC_LLSD_OBJECT;    assign(v); }
+LLSD::LLSD(Integer v) : impl(nullptr), mInline(TypeUndefined)       { ALLOC_LLSD_OBJECT;    assign(v); }
+LLSD::LLSD(Real v) : impl(nullptr), mInline(TypeUndefined)          { ALLOC_LLSD_OBJECT;    assign(v); }
+LLSD::LLSD(const UUID& v) : impl(nullptr), mInline(TypeUndefined)   { ALLOC_LLSD_OBJECT;    assign(v); }
+LLSD::LLSD(const String& v) : impl(nullptr), mInline(TypeUndefined) { ALLOC_LLSD_OBJECT;    assign(v); }
+LLSD::LLSD(const Date& v) : impl(nullptr), mInline(TypeUndefined)   { ALLOC_LLSD_OBJECT;    assign(v); }
+LLSD::LLSD(const URI& v) : impl(nullptr), mInline(TypeUndefined)    { ALLOC_LLSD_OBJECT;    assign(v); }
+LLSD::LLSD(const Binary& v) : impl(nullptr), mInline(TypeUndefined) { ALLOC_LLSD_OBJECT;    assign(v); }
+LLSD::LLSD(UUID&& v) : impl(nullptr), mInline(TypeUndefined)        { ALLOC_LLSD_OBJECT;    assign(std::move(v)); }
+LLSD::LLSD(String&& v) : impl(nullptr), mInline(TypeUndefined)      { ALLOC_LLSD_OBJECT;    assign(std::move(v)); }
+LLSD::LLSD(Date&& v) : impl(nullptr), mInline(TypeUndefined)        { ALLOC_LLSD_OBJECT;    assign(std::move(v)); }
+LLSD::LLSD(URI&& v) : impl(nullptr), mInline(TypeUndefined)         { ALLOC_LLSD_OBJECT;    assign(std::move(v)); }
+LLSD::LLSD(Binary&& v) : impl(nullptr), mInline(TypeUndefined)      { ALLOC_LLSD_OBJECT;    assign(std::move(v)); }
 
 // Scalar Assignment
-void LLSD::assign(Boolean v)            { safe(impl).assign(impl, v); }
-void LLSD::assign(Integer v)            { safe(impl).assign(impl, v); }
-void LLSD::assign(Real v)               { safe(impl).assign(impl, v); }
-void LLSD::assign(const String& v)      { safe(impl).assign(impl, v); }
-void LLSD::assign(const UUID& v)        { safe(impl).assign(impl, v); }
-void LLSD::assign(const Date& v)        { safe(impl).assign(impl, v); }
-void LLSD::assign(const URI& v)         { safe(impl).assign(impl, v); }
-void LLSD::assign(const Binary& v)      { safe(impl).assign(impl, v); }
-void LLSD::assign(String&& v)           { safe(impl).assign(impl, std::move(v)); }
-void LLSD::assign(UUID&& v)             { safe(impl).assign(impl, std::move(v)); }
-void LLSD::assign(Date&& v)             { safe(impl).assign(impl, std::move(v)); }
-void LLSD::assign(URI&& v)              { safe(impl).assign(impl, std::move(v)); }
-void LLSD::assign(Binary&& v)           { safe(impl).assign(impl, std::move(v)); }
+void LLSD::assign(Boolean v)            { release(); mBoolean = v; mInline = TypeBoolean; }
+void LLSD::assign(Integer v)            { release(); mInteger = v; mInline = TypeInteger; }
+void LLSD::assign(Real v)               { release(); mReal = v;    mInline = TypeReal; }
+void LLSD::assign(const String& v)      { safe(mutableImpl()).assign(impl, v); }
+void LLSD::assign(const UUID& v)        { safe(mutableImpl()).assign(impl, v); }
+void LLSD::assign(const Date& v)        { safe(mutableImpl()).assign(impl, v); }
+void LLSD::assign(const URI& v)         { safe(mutableImpl()).assign(impl, v); }
+void LLSD::assign(const Binary& v)      { safe(mutableImpl()).assign(impl, v); }
+void LLSD::assign(String&& v)           { safe(mutableImpl()).assign(impl, std::move(v)); }
+void LLSD::assign(UUID&& v)             { safe(mutableImpl()).assign(impl, std::move(v)); }
+void LLSD::assign(Date&& v)             { safe(mutableImpl()).assign(impl, std::move(v)); }
+void LLSD::assign(URI&& v)              { safe(mutableImpl()).assign(impl, std::move(v)); }
+void LLSD::assign(Binary&& v)           { safe(mutableImpl()).assign(impl, std::move(v)); }
 
 // Scalar Accessors
-LLSD::Boolean   LLSD::asBoolean() const { return safe(impl).asBoolean(); }
-LLSD::Integer   LLSD::asInteger() const { return safe(impl).asInteger(); }
-LLSD::Real      LLSD::asReal() const    { return safe(impl).asReal(); }
-LLSD::String    LLSD::asString() const  { return safe(impl).asString(); }
-LLSD::UUID      LLSD::asUUID() const    { return safe(impl).asUUID(); }
-LLSD::Date      LLSD::asDate() const    { return safe(impl).asDate(); }
-LLSD::URI       LLSD::asURI() const     { return safe(impl).asURI(); }
-const LLSD::Binary& LLSD::asBinary() const  { return safe(impl).asBinary(); }
+LLSD::Boolean LLSD::asBoolean() const
+{
+    switch (mInline)
+    {
+    case TypeBoolean:   return mBoolean;
+    case TypeInteger:   return mInteger != 0;
+    case TypeReal:      return realBoolean(mReal);
+    default:            return safe(impl).asBoolean();
+    }
+}
 
-const LLSD::String& LLSD::asStringRef() const { return safe(impl).asStringRef(); }
+LLSD::Integer LLSD::asInteger() const
+{
+    switch (mInline)
+    {
+    case TypeBoolean:   return mBoolean ? 1 : 0;
+    case TypeInteger:   return mInteger;
+    case TypeReal:      return realInteger(mReal);
+    default:            return safe(impl).asInteger();
+    }
+}
 
-LLSD::String LLSD::asXMLRPCValue() const { return "<value>" + safe(impl).asXMLRPCValue() + "</value>"; }
+LLSD::Real LLSD::asReal() const
+{
+    switch (mInline)
+    {
+    case TypeBoolean:   return mBoolean ? 1 : 0;
+    case TypeInteger:   return mInteger;
+    case TypeReal:      return mReal;
+    default:            return safe(impl).asReal();
+    }
+}
+
+LLSD::String LLSD::asString() const
+{
+    switch (mInline)
+    {
+    case TypeBoolean:   return booleanString(mBoolean);
+    case TypeInteger:   return integerString(mInteger);
+    case TypeReal:      return realString(mReal);
+    default:            return safe(impl).asString();
+    }
+}
+
+// None of the inline types converts to UUID, Date, URI or Binary
+LLSD::UUID LLSD::asUUID() const         { return Impl::container(*this).asUUID(); }
+LLSD::Date LLSD::asDate() const         { return Impl::container(*this).asDate(); }
+LLSD::URI LLSD::asURI() const           { return Impl::container(*this).asURI(); }
+const LLSD::Binary& LLSD::asBinary() const  { return Impl::container(*this).asBinary(); }
+const LLSD::String& LLSD::asStringRef() const { return Impl::container(*this).asStringRef(); }
+
+LLSD::String LLSD::asXMLRPCValue() const
+{
+    std::string value;
+    switch (mInline)
+    {
+    case TypeBoolean:   value = mBoolean ? "<boolean>1</boolean>" : "<boolean>0</boolean>"; break;
+    case TypeInteger:   value = "<int>" + std::to_string(mInteger) + "</int>"; break;
+    case TypeReal:      value = "<double>" + std::to_string(mReal) + "</double>"; break;
+    default:            value = safe(impl).asXMLRPCValue(); break;
+    }
+    return "<value>" + value + "</value>";
+}
 
 // const char * helpers
-LLSD::LLSD(const char* v) : impl(0)     { ALLOC_LLSD_OBJECT;    assign(v); }
+LLSD::LLSD(const char* v) : impl(nullptr), mInline(TypeUndefined)  { ALLOC_LLSD_OBJECT;    assign(v); }
 void LLSD::assign(const char* v)
 {
-    if(v) safe(impl).assign(impl, v);
+    if(v) safe(mutableImpl()).assign(impl, v);
     else assign(std::string());
 }
 
@@ -1034,27 +1227,27 @@ LLSD LLSD::emptyMap()
     return v;
 }
 
-bool LLSD::has(const std::string_view k) const  { return safe(impl).has(k); }
-LLSD LLSD::get(const std::string_view k) const  { return safe(impl).get(k); }
-LLSD LLSD::getKeys() const              { return safe(impl).getKeys(); }
-void LLSD::insert(std::string_view k, const LLSD& v) { makeMap(impl).insert(k, v); }
+bool LLSD::has(const std::string_view k) const  { return Impl::container(*this).has(k); }
+LLSD LLSD::get(const std::string_view k) const  { return Impl::container(*this).get(k); }
+LLSD LLSD::getKeys() const              { return Impl::container(*this).getKeys(); }
+void LLSD::insert(std::string_view k, const LLSD& v) { makeMap(mutableImpl()).insert(k, v); }
 
 LLSD& LLSD::with(std::string_view k, const LLSD& v)
                                         {
-                                            makeMap(impl).insert(k, v);
+                                            makeMap(mutableImpl()).insert(k, v);
                                             return *this;
                                         }
-void LLSD::erase(const String& k)       { makeMap(impl).erase(k); }
+void LLSD::erase(const String& k)       { makeMap(mutableImpl()).erase(k); }
 
 LLSD& LLSD::operator[](const std::string_view k)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_LLSD;
-    return makeMap(impl).ref(k);
+    return makeMap(mutableImpl()).ref(k);
 }
 const LLSD& LLSD::operator[](const std::string_view k) const
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_LLSD;
-    return safe(impl).ref(k);
+    return Impl::container(*this).ref(k);
 }
 
 LLSD LLSD::emptyArray()
@@ -1064,29 +1257,33 @@ LLSD LLSD::emptyArray()
     return v;
 }
 
-size_t LLSD::size() const               { return safe(impl).size(); }
+size_t LLSD::size() const
+{
+    return Impl::container(*this).size();
+}
 
-LLSD LLSD::get(Integer i) const         { return safe(impl).get(i); }
-void LLSD::set(Integer i, const LLSD& v){ makeArray(impl).set(i, v); }
-void LLSD::insert(Integer i, const LLSD& v) { makeArray(impl).insert(i, v); }
+LLSD LLSD::get(Integer i) const         { return Impl::container(*this).get(i); }
+void LLSD::set(Integer i, const LLSD& v){ makeArray(mutableImpl()).set(i, v); }
+void LLSD::insert(Integer i, const LLSD& v) { makeArray(mutableImpl()).insert(i, v); }
 
 LLSD& LLSD::with(Integer i, const LLSD& v)
                                         {
-                                            makeArray(impl).insert(i, v);
+                                            makeArray(mutableImpl()).insert(i, v);
                                             return *this;
                                         }
-LLSD& LLSD::append(const LLSD& v)       { return makeArray(impl).append(v); }
-void LLSD::erase(Integer i)             { makeArray(impl).erase(i); }
+LLSD& LLSD::append(const LLSD& v)       { return makeArray(mutableImpl()).append(v); }
+LLSD& LLSD::append(LLSD&& v)            { return makeArray(mutableImpl()).append(std::move(v)); }
+void LLSD::erase(Integer i)             { makeArray(mutableImpl()).erase(i); }
 
 LLSD& LLSD::operator[](size_t i)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_LLSD;
-    return makeArray(impl).ref(i);
+    return makeArray(mutableImpl()).ref(i);
 }
 const LLSD& LLSD::operator[](size_t i) const
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_LLSD;
-    return safe(impl).ref(i);
+    return Impl::container(*this).ref(i);
 }
 
 static const char *llsd_dump(const LLSD &llsd, bool useXMLFormat)
@@ -1127,18 +1324,18 @@ const char *LLSD::dump(const LLSD &llsd)
     return llsd_dump(llsd, false);
 }
 
-LLSD::map_iterator          LLSD::beginMap()        { return makeMap(impl).beginMap(); }
-LLSD::map_iterator          LLSD::endMap()          { return makeMap(impl).endMap(); }
-LLSD::map_const_iterator    LLSD::beginMap() const  { return safe(impl).beginMap(); }
-LLSD::map_const_iterator    LLSD::endMap() const    { return safe(impl).endMap(); }
+LLSD::map_iterator          LLSD::beginMap()        { return makeMap(mutableImpl()).beginMap(); }
+LLSD::map_iterator          LLSD::endMap()          { return makeMap(mutableImpl()).endMap(); }
+LLSD::map_const_iterator    LLSD::beginMap() const  { return Impl::container(*this).beginMap(); }
+LLSD::map_const_iterator    LLSD::endMap() const    { return Impl::container(*this).endMap(); }
 
-LLSD::array_iterator        LLSD::beginArray()      { return makeArray(impl).beginArray(); }
-LLSD::array_iterator        LLSD::endArray()        { return makeArray(impl).endArray(); }
-LLSD::array_const_iterator  LLSD::beginArray() const{ return safe(impl).beginArray(); }
-LLSD::array_const_iterator  LLSD::endArray() const  { return safe(impl).endArray(); }
+LLSD::array_iterator        LLSD::beginArray()      { return makeArray(mutableImpl()).beginArray(); }
+LLSD::array_iterator        LLSD::endArray()        { return makeArray(mutableImpl()).endArray(); }
+LLSD::array_const_iterator  LLSD::beginArray() const{ return Impl::container(*this).beginArray(); }
+LLSD::array_const_iterator  LLSD::endArray() const  { return Impl::container(*this).endArray(); }
 
-LLSD::reverse_array_iterator    LLSD::rbeginArray()     { return makeArray(impl).rbeginArray(); }
-LLSD::reverse_array_iterator    LLSD::rendArray()       { return makeArray(impl).rendArray(); }
+LLSD::reverse_array_iterator    LLSD::rbeginArray()     { return makeArray(mutableImpl()).rbeginArray(); }
+LLSD::reverse_array_iterator    LLSD::rendArray()       { return makeArray(mutableImpl()).rendArray(); }
 
 namespace llsd
 {
@@ -80,6 +80,19 @@
 
     An array is a sequence of zero or more LLSD values.
 
+    Representation
+
+    Booleans, Integers and Reals are stored in the LLSD object itself,
+    copying them copies the value. Every other value lives in a reference
+    counted implementation object shared by the copies until one of them is
+    modified.
+
+    Maps are std::maps, unless the build sets the LLSD_FLAT_MAP CMake option:
+    then they are vectors of pointers to pairs, sorted by key, which take
+    less memory and are faster to search and walk. References to elements
+    stay valid as with std::map, but adding or erasing a key invalidates
+    every iterator of that map, not just the one erased.
+
     Thread Safety
 
     In general, these LLSD classes offer *less* safety than STL container
@@ -147,6 +160,14 @@
 // Normally undefined, used for diagnostics
 //#define LLSD_DEBUG_INFO   1
 
+// Defined by the LLSD_FLAT_MAP CMake option, keeps map values in sorted
+// vectors, see above
+
+#ifdef LLSD_FLAT_MAP
+#include <memory>
+#include <boost/iterator/indirect_iterator.hpp>
+#endif
+
 class LL_COMMON_API LLSD
 {
 public:
@@ -345,6 +366,7 @@ public:
         void set(Integer, const LLSD&);
         void insert(Integer, const LLSD&);
         LLSD& append(const LLSD&);
+        LLSD& append(LLSD&&);
         void erase(Integer);
         LLSD& with(Integer, const LLSD&);
 
@@ -366,8 +388,16 @@ public:
     //@{
         size_t size() const;
 
+#ifdef LLSD_FLAT_MAP
+        typedef std::pair<const String, LLSD> map_value_type;
+        typedef std::vector<std::unique_ptr<map_value_type>> map_nodes;
+        typedef boost::indirect_iterator<map_nodes::iterator> map_iterator;
+        typedef boost::indirect_iterator<map_nodes::const_iterator, const map_value_type>
+                                                        map_const_iterator;
+#else
         typedef std::map<String, LLSD>::iterator        map_iterator;
         typedef std::map<String, LLSD>::const_iterator  map_const_iterator;
+#endif
 
         map_iterator        beginMap();
         map_iterator        endMap();
@@ -446,7 +476,19 @@ public:
 public:
         class Impl;
 private:
-        Impl* impl;
+        union
+        {
+            Impl*   impl;       ///< when mInline is TypeUndefined, NULL if undefined
+            Boolean mBoolean;
+            Integer mInteger;
+            Real    mReal;
+        };
+        U8 mInline;             ///< type of the inline value, or TypeUndefined
+
+        void release();         ///< resets to Undefined
+        Impl*& mutableImpl();   ///< drops an inline value, for setting impl
+        void moveFrom(LLSD& other) noexcept;    ///< requires Undefined
+
         friend class LLSD::Impl;
     //@}
 
@@ -0,0 +1,321 @@
+/**
+ * @file   llshardedinstancetracker.cpp
+ * @brief  Epoch based reclamation for LLShardedInstanceTracker
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "llshardedinstancetracker.h"
+// STL headers
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+// std headers
+// external library headers
+// other Linden headers
+
+/*
+ * The global epoch only moves on when every thread inside an EpochGuard has
+ * seen its current value. Memory retired in epoch E is unlinked already, so
+ * a guard entered from E + 1 on can't reach it; once the epoch reaches E + 2,
+ * every guard that might have is gone.
+ *
+ * Each thread announces the epoch it entered in a slot of its own. Threads
+ * beyond MAX_READERS share a counter instead, which holds the epoch while
+ * it's not zero. Retired memory waits in a list per slot, so retiring
+ * takes no lock; what's left when a thread ends goes to a shared list.
+ *
+ * Other thread_local destructors may open guards and retire() while their
+ * thread ends, so the per thread state is plain data that outlives them all.
+ */
+namespace
+{
+    const U64 INACTIVE = ~U64(0);
+    const size_t MAX_READERS = 256;
+    // retire() tries to free memory every RETIRE_BATCH calls
+    const size_t RETIRE_BATCH = 64;
+
+    struct Retired
+    {
+        void* mPtr;
+        void (*mDeleter)(void*);
+        U64   mEpoch;
+    };
+    typedef std::vector<Retired> retired_list;
+
+    struct alignas(64) ReaderSlot
+    {
+        std::atomic<U64>  mEpoch{ INACTIVE };
+        std::atomic<bool> mClaimed{ false };
+        // only touched by the thread that claimed the slot
+        retired_list      mRetired;
+    };
+
+    struct Reclaimer
+    {
+        std::atomic<U64>    mEpoch{ 0 };
+        std::atomic<U32>    mOverflow{ 0 };
+        ReaderSlot          mSlots[MAX_READERS];
+
+        // left behind by threads that ended
+        std::mutex          mOrphanMutex;
+        retired_list        mOrphans;
+        std::atomic<size_t> mNumOrphans{ 0 };
+
+        // The epoch, moved on if every reader has seen it
+        U64 advance()
+        {
+            U64 epoch = mEpoch.load(std::memory_order_seq_cst);
+            if (canAdvance(epoch))
+            {
+                // on failure another thread moved it on, epoch is reloaded
+                if (mEpoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst))
+                {
+                    ++epoch;
+                }
+            }
+            return epoch;
+        }
+
+        bool canAdvance(U64 epoch) const
+        {
+            if (mOverflow.load(std::memory_order_seq_cst))
+            {
+                return false;
+            }
+            for (const ReaderSlot& slot : mSlots)
+            {
+                const U64 seen = slot.mEpoch.load(std::memory_order_seq_cst);
+                if (seen != INACTIVE && seen != epoch)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Frees the entries of retired no reader can see any more
+        static void collect(retired_list& retired, U64 epoch)
+        {
+            auto keep = std::partition(retired.begin(), retired.end(),
+                                       [epoch](const Retired& r) { return r.mEpoch + 2 > epoch; });
+            retired_list expired(keep, retired.end());
+            retired.erase(keep, retired.end());
+            // after taking them off the list: a deleter may retire() more
+            for (const Retired& r : expired)
+            {
+                r.mDeleter(r.mPtr);
+            }
+        }
+
+        void collectOrphans(U64 epoch)
+        {
+            retired_list orphans;
+            {
+                std::unique_lock<std::mutex> lock(mOrphanMutex, std::try_to_lock);
+                if (!lock.owns_lock())
+                {
+                    return;
+                }
+                orphans.swap(mOrphans);
+                mNumOrphans.store(0, std::memory_order_relaxed);
+            }
+            collect(orphans, epoch);
+            adopt(orphans);
+        }
+
+        void adopt(retired_list& retired)
+        {
+            if (retired.empty())
+            {
+                return;
+            }
+            std::lock_guard<std::mutex> lock(mOrphanMutex);
+            mOrphans.insert(mOrphans.end(), retired.begin(), retired.end());
+            mNumOrphans.store(mOrphans.size(), std::memory_order_relaxed);
+            retired.clear();
+        }
+    };
+
+    Reclaimer& getReclaimer()
+    {
+        // never destroyed: guards and retire() run from static destructors
+        static Reclaimer* sReclaimer = new Reclaimer;
+        return *sReclaimer;
+    }
+
+    // The slot of this thread and how deep it is nested in guards. Trivially
+    // destructible, so it's still there for the thread_local destructors
+    // that run after ThreadExit.
+    struct ThreadReader
+    {
+        ReaderSlot* mSlot = nullptr;
+        U32         mDepth = 0;
+        bool        mTried = false;
+        bool        mExited = false;
+    };
+    static_assert(std::is_trivially_destructible_v<ThreadReader>);
+
+    thread_local ThreadReader tReader;
+
+    // Gives the slot back when the thread ends. Constructed when the slot is
+    // claimed: thread_locals constructed before it are destroyed after it,
+    // and find mExited set.
+    struct ThreadExit
+    {
+        ~ThreadExit()
+        {
+            ThreadReader& reader = tReader;
+            if (reader.mSlot)
+            {
+                getReclaimer().adopt(reader.mSlot->mRetired);
+                // a guard still open gives the slot back when it closes
+                if (!reader.mDepth)
+                {
+                    release(reader);
+                }
+            }
+            reader.mExited = true;
+        }
+
+        static void release(ThreadReader& reader)
+        {
+            reader.mSlot->mEpoch.store(INACTIVE, std::memory_order_release);
+            reader.mSlot->mClaimed.store(false, std::memory_order_release);
+            reader.mSlot = nullptr;
+        }
+    };
+
+    // The slot of this thread, claimed on first use; nullptr once the thread
+    // is ending or when every slot is taken
+    ReaderSlot* getSlot(ThreadReader& reader)
+    {
+        if (reader.mExited)
+        {
+            return nullptr;
+        }
+        if (reader.mSlot || reader.mTried)
+        {
+            return reader.mSlot;
+        }
+        reader.mTried = true;
+        for (ReaderSlot& slot : getReclaimer().mSlots)
+        {
+            bool claimed = false;
+            if (slot.mClaimed.compare_exchange_strong(claimed, true))
+            {
+                reader.mSlot = &slot;
+                static thread_local ThreadExit sExit;
+                break;
+            }
+        }
+        return reader.mSlot;
+    }
+} // anonymous namespace
+
+LLInstanceTrackerPrivate::EpochGuard::EpochGuard()
+{
+    ThreadReader& reader = tReader;
+    if (reader.mDepth++)
+    {
+        return;
+    }
+    Reclaimer& reclaimer = getReclaimer();
+    if (ReaderSlot* slot = getSlot(reader))
+    {
+        // seq_cst so the store is visible before this thread loads any
+        // pointer it's meant to protect
+        slot->mEpoch.store(reclaimer.mEpoch.load(std::memory_order_seq_cst),
+                           std::memory_order_seq_cst);
+    }
+    else
+    {
+        reclaimer.mOverflow.fetch_add(1, std::memory_order_seq_cst);
+    }
+}
+
+LLInstanceTrackerPrivate::EpochGuard::~EpochGuard()
+{
+    ThreadReader& reader = tReader;
+    if (--reader.mDepth)
+    {
+        return;
+    }
+    if (reader.mSlot && reader.mExited)
+    {
+        ThreadExit::release(reader);
+    }
+    else if (reader.mSlot)
+    {
+        reader.mSlot->mEpoch.store(INACTIVE, std::memory_order_release);
+    }
+    else
+    {
+        getReclaimer().mOverflow.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+void LLInstanceTrackerPrivate::retire(void* ptr, void (*deleter)(void*))
+{
+    Reclaimer& reclaimer = getReclaimer();
+    ThreadReader& reader = tReader;
+    const Retired retired{ ptr, deleter, reclaimer.mEpoch.load(std::memory_order_seq_cst) };
+    ReaderSlot* slot = getSlot(reader);
+    if (!slot)
+    {
+        // ending, or beyond MAX_READERS: straight to the shared list
+        retired_list orphan{ retired };
+        reclaimer.adopt(orphan);
+        if (reclaimer.mNumOrphans.load(std::memory_order_relaxed) % RETIRE_BATCH == 0)
+        {
+            reclaimer.collectOrphans(reclaimer.advance());
+        }
+        return;
+    }
+    slot->mRetired.push_back(retired);
+    if (slot->mRetired.size() % RETIRE_BATCH == 0)
+    {
+        const U64 epoch = reclaimer.advance();
+        Reclaimer::collect(slot->mRetired, epoch);
+        if (reclaimer.mNumOrphans.load(std::memory_order_relaxed))
+        {
+            reclaimer.collectOrphans(epoch);
+        }
+    }
+}
+
+void LLInstanceTrackerPrivate::reclaim()
+{
+    // two steps take the epoch past everything retired so far, unless a
+    // guard holds it back
+    Reclaimer& reclaimer = getReclaimer();
+    reclaimer.advance();
+    const U64 epoch = reclaimer.advance();
+    if (ReaderSlot* slot = getSlot(tReader))
+    {
+        Reclaimer::collect(slot->mRetired, epoch);
+    }
+    reclaimer.collectOrphans(epoch);
+}
@@ -0,0 +1,702 @@
+/**
+ * @file   llshardedinstancetracker.h
+ * @brief  LLInstanceTracker variant for types constructed and looked up
+ *         from many threads
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#if ! defined(LL_LLSHARDEDINSTANCETRACKER_H)
+#define LL_LLSHARDEDINSTANCETRACKER_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/iterator/transform_iterator.hpp>
+#include <boost/iterator/indirect_iterator.hpp>
+
+#include "llinstancetracker.h"
+
+/*****************************************************************************
+*   Epoch based reclamation
+*****************************************************************************/
+namespace LLInstanceTrackerPrivate
+{
+    /**
+     * While an EpochGuard exists on a thread, nothing retire()d after it was
+     * constructed is freed, so the thread can follow pointers it loaded from
+     * a ShardedMap without locking. Guards nest. Constructing one costs a
+     * store to a slot of the thread's own; no state shared between threads
+     * is written.
+     */
+    class LL_COMMON_API EpochGuard
+    {
+    public:
+        EpochGuard();
+        ~EpochGuard();
+
+        EpochGuard(const EpochGuard&) = delete;
+        EpochGuard& operator=(const EpochGuard&) = delete;
+    };
+
+    /// Calls deleter(ptr) once every EpochGuard that might have seen ptr is
+    /// gone
+    LL_COMMON_API void retire(void* ptr, void (*deleter)(void*));
+
+    /// Frees whatever retire()d memory no EpochGuard can still see
+    LL_COMMON_API void reclaim();
+
+    /**
+     * The instances of one LLShardedInstanceTracker class: NUM_SHARDS chained
+     * hash tables, each with its own mutex for changes. Lookups and
+     * traversals take no lock, only an EpochGuard: nodes and tables are
+     * never changed once reachable except for their links, and are retire()d
+     * rather than deleted when they're unlinked or replaced.
+     *
+     * A node holds a weak_ptr, so an instance being destroyed is skipped
+     * even before its node is unlinked.
+     */
+    template <typename KEY, typename T>
+    class ShardedMap
+    {
+    public:
+        using ptr_t  = std::shared_ptr<T>;
+        using weak_t = std::weak_ptr<T>;
+
+        static constexpr size_t NUM_SHARDS = 16;
+
+        struct Node
+        {
+            Node(const KEY& key, const weak_t& weak):
+                mKey(key),
+                mWeak(weak),
+                mNext(nullptr)
+            {}
+
+            const KEY           mKey;
+            const weak_t        mWeak;
+            std::atomic<Node*>  mNext;
+        };
+
+        // Position of a traversal
+        struct Cursor
+        {
+            size_t      mShard = NUM_SHARDS;
+            const void* mTable = nullptr;
+            size_t      mBucket = 0;
+            const Node* mNode = nullptr;
+
+            bool operator==(const Cursor& other) const
+            {
+                return mNode == other.mNode && mShard == other.mShard;
+            }
+        };
+
+        ShardedMap()
+        {
+            for (Shard& shard : mShards)
+            {
+                shard.mTable.store(new Table(MIN_BUCKETS), std::memory_order_relaxed);
+            }
+        }
+
+        ~ShardedMap()
+        {
+            for (Shard& shard : mShards)
+            {
+                delete shard.mTable.load(std::memory_order_relaxed);
+            }
+        }
+
+        size_t size() const
+        {
+            size_t count = 0;
+            for (const Shard& shard : mShards)
+            {
+                count += shard.mCount.load(std::memory_order_relaxed);
+            }
+            return count;
+        }
+
+        ptr_t find(const KEY& key) const
+        {
+            const U64 hash = hashOf(key);
+            EpochGuard guard;
+            const Table* table = shardOf(hash).mTable.load(std::memory_order_acquire);
+            for (const Node* node = table->bucket(hash).load(std::memory_order_acquire);
+                 node; node = node->mNext.load(std::memory_order_acquire))
+            {
+                if (node->mKey == key)
+                {
+                    // skip an instance being destroyed, a replacement may follow
+                    if (ptr_t ptr = node->mWeak.lock())
+                    {
+                        return ptr;
+                    }
+                }
+            }
+            return {};
+        }
+
+        // false if there is already an instance with key and replace is false
+        bool insert(const KEY& key, const weak_t& weak, bool replace)
+        {
+            const U64 hash = hashOf(key);
+            Shard& shard = shardOf(hash);
+            std::lock_guard<std::mutex> lock(shard.mMutex);
+            Table* table = shard.mTable.load(std::memory_order_relaxed);
+            std::atomic<Node*>& bucket = table->bucket(hash);
+            const bool found = findLink(bucket, [&key](const Node* node) { return node->mKey == key; });
+            if (found && !replace)
+            {
+                return false;
+            }
+
+            // Link the new node first so that lookups never miss the key
+            Node* node = new Node(key, weak);
+            node->mNext.store(bucket.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            bucket.store(node, std::memory_order_release);
+            if (found)
+            {
+                unlink(*findLink(node->mNext, [&key](const Node* node) { return node->mKey == key; }));
+                return true;
+            }
+
+            shard.mCount.fetch_add(1, std::memory_order_relaxed);
+            if (++table->mSize > table->mMask + 1)
+            {
+                grow(shard);
+            }
+            return true;
+        }
+
+        // Removes the node of the instance weak refers to
+        void erase(const KEY& key, const weak_t& weak)
+        {
+            const U64 hash = hashOf(key);
+            Shard& shard = shardOf(hash);
+            std::lock_guard<std::mutex> lock(shard.mMutex);
+            Table* table = shard.mTable.load(std::memory_order_relaxed);
+            std::atomic<Node*>* link = findLink(table->bucket(hash), [&key, &weak](const Node* node)
+                {
+                    return node->mKey == key &&
+                        !node->mWeak.owner_before(weak) && !weak.owner_before(node->mWeak);
+                });
+            if (link)
+            {
+                unlink(*link);
+                table->mSize--;
+                shard.mCount.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+
+        // Traversal, requires an EpochGuard while the cursor is in use.
+        // Instances added or removed meanwhile may or may not be visited.
+        void first(Cursor& cursor) const
+        {
+            cursor.mShard = 0;
+            cursor.mTable = mShards[0].mTable.load(std::memory_order_acquire);
+            cursor.mBucket = 0;
+            cursor.mNode = static_cast<const Table*>(cursor.mTable)->mBuckets[0].load(std::memory_order_acquire);
+            settle(cursor);
+        }
+
+        void next(Cursor& cursor) const
+        {
+            cursor.mNode = cursor.mNode->mNext.load(std::memory_order_acquire);
+            settle(cursor);
+        }
+
+    private:
+        static constexpr size_t MIN_BUCKETS = 8;
+
+        struct Table
+        {
+            Table(size_t num_buckets):
+                mBuckets(new std::atomic<Node*>[num_buckets]),
+                mMask(num_buckets - 1),
+                mShift(64),
+                mSize(0)
+            {
+                for (size_t i = 0; i < num_buckets; i++)
+                {
+                    mBuckets[i].store(nullptr, std::memory_order_relaxed);
+                }
+                for (size_t n = num_buckets; n > 1; n >>= 1)
+                {
+                    mShift--;
+                }
+            }
+
+            // deletes the nodes still linked
+            ~Table()
+            {
+                for (size_t i = 0; i <= mMask; i++)
+                {
+                    Node* node = mBuckets[i].load(std::memory_order_relaxed);
+                    while (node)
+                    {
+                        Node* next = node->mNext.load(std::memory_order_relaxed);
+                        delete node;
+                        node = next;
+                    }
+                }
+            }
+
+            // the shard takes the top bits of the hash, the bucket the next
+            std::atomic<Node*>& bucket(U64 hash) { return mBuckets[(hash << 4) >> mShift]; }
+            const std::atomic<Node*>& bucket(U64 hash) const { return mBuckets[(hash << 4) >> mShift]; }
+
+            std::unique_ptr<std::atomic<Node*>[]> mBuckets;
+            const size_t    mMask;
+            U32             mShift;
+            size_t          mSize;      // guarded by the shard mutex
+        };
+
+        struct alignas(64) Shard
+        {
+            std::mutex              mMutex;
+            std::atomic<Table*>     mTable{ nullptr };
+            std::atomic<size_t>     mCount{ 0 };
+        };
+
+        static_assert(NUM_SHARDS == 16, "shardOf() takes four bits of the hash");
+
+        static U64 hashOf(const KEY& key)
+        {
+            // Fibonacci hashing spreads the keys whose hash is the key, like
+            // pointers and enums
+            return (U64)std::hash<KEY>()(key) * 0x9E3779B97F4A7C15ULL;
+        }
+        Shard& shardOf(U64 hash) { return mShards[hash >> 60]; }
+        const Shard& shardOf(U64 hash) const { return mShards[hash >> 60]; }
+
+        // The link pointing to the first node of the chain matching pred,
+        // NULL if none does.  Requires the shard mutex.
+        template <typename PRED>
+        static std::atomic<Node*>* findLink(std::atomic<Node*>& head, const PRED& pred)
+        {
+            for (std::atomic<Node*>* link = &head; Node* node = link->load(std::memory_order_relaxed);
+                 link = &node->mNext)
+            {
+                if (pred(node))
+                {
+                    return link;
+                }
+            }
+            return nullptr;
+        }
+
+        // Unlinks the node link points to.  It keeps its own link, so a
+        // traversal standing on it carries on.
+        static void unlink(std::atomic<Node*>& link)
+        {
+            Node* node = link.load(std::memory_order_relaxed);
+            link.store(node->mNext.load(std::memory_order_relaxed), std::memory_order_release);
+            retire(node, [](void* node) { delete static_cast<Node*>(node); });
+        }
+
+        // Replaces the table of shard with one twice the size.  Requires the
+        // shard mutex.
+        void grow(Shard& shard)
+        {
+            Table* old_table = shard.mTable.load(std::memory_order_relaxed);
+            Table* table = new Table((old_table->mMask + 1) * 2);
+            for (size_t i = 0; i <= old_table->mMask; i++)
+            {
+                for (Node* node = old_table->mBuckets[i].load(std::memory_order_relaxed); node;
+                     node = node->mNext.load(std::memory_order_relaxed))
+                {
+                    std::atomic<Node*>& bucket = table->bucket(hashOf(node->mKey));
+                    Node* copy = new Node(node->mKey, node->mWeak);
+                    copy->mNext.store(bucket.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                    bucket.store(copy, std::memory_order_relaxed);
+                    table->mSize++;
+                }
+            }
+            shard.mTable.store(table, std::memory_order_release);
+            retire(old_table, [](void* table) { delete static_cast<Table*>(table); });
+        }
+
+        // Moves the cursor on to a node if it's not on one, or to the end
+        void settle(Cursor& cursor) const
+        {
+            while (!cursor.mNode)
+            {
+                const Table* table = static_cast<const Table*>(cursor.mTable);
+                if (++cursor.mBucket > table->mMask)
+                {
+                    if (++cursor.mShard == NUM_SHARDS)
+                    {
+                        cursor.mTable = nullptr;
+                        cursor.mBucket = 0;
+                        return;
+                    }
+                    cursor.mTable = table = mShards[cursor.mShard].mTable.load(std::memory_order_acquire);
+                    cursor.mBucket = 0;
+                }
+                cursor.mNode = table->mBuckets[cursor.mBucket].load(std::memory_order_acquire);
+            }
+        }
+
+        Shard mShards[NUM_SHARDS];
+    };
+} // namespace LLInstanceTrackerPrivate
+
+/*****************************************************************************
+*   LLShardedInstanceTracker with key
+*****************************************************************************/
+/**
+ * Drop-in replacement for LLInstanceTracker, for classes whose instances are
+ * created, destroyed or looked up by many threads at once. Instead of one
+ * std::map behind one mutex, instances are kept in a hash map split into
+ * shards: changes lock only their shard, getInstance() and the snapshots
+ * lock nothing.
+ *
+ * The difference to keep in mind: a snapshot is not a copy. It walks the
+ * live instances, so one added while it's being traversed may or may not be
+ * visited. Instances destroyed before they're reached are skipped, as with
+ * LLInstanceTracker. KEY must have std::hash and operator==.
+ */
+template<typename T, typename KEY = void,
+         EInstanceTrackerAllowKeyCollisions KEY_COLLISION_BEHAVIOR = LLInstanceTrackerErrorOnCollision>
+class LLShardedInstanceTracker
+{
+    typedef LLInstanceTrackerPrivate::ShardedMap<KEY, T> InstanceMap;
+
+    static InstanceMap& getMap()
+    {
+        // function-local static for the same reason as LockStatic's
+        static InstanceMap sMap;
+        return sMap;
+    }
+
+public:
+    using ptr_t  = std::shared_ptr<T>;
+    using weak_t = std::weak_ptr<T>;
+
+    weak_t getWeak()
+    {
+        return mSelf;
+    }
+
+    static size_t instanceCount()
+    {
+        return getMap().size();
+    }
+
+    // traversal of std::pair<const KEY, std::shared_ptr<SUBCLASS>> pairs, for
+    // some SUBCLASS derived from T
+    template <typename SUBCLASS>
+    class snapshot_of
+    {
+    public:
+        typedef std::pair<const KEY, std::shared_ptr<SUBCLASS>> strong_pair;
+
+        class iterator: public boost::iterator_facade<iterator, strong_pair,
+                                                      boost::forward_traversal_tag, strong_pair>
+        {
+        public:
+            iterator() {}
+            iterator(bool begin)
+            {
+                if (begin)
+                {
+                    getMap().first(mCursor);
+                    settle();
+                }
+            }
+
+        private:
+            friend class boost::iterator_core_access;
+
+            void increment()
+            {
+                getMap().next(mCursor);
+                settle();
+            }
+            bool equal(const iterator& other) const { return mCursor == other.mCursor; }
+            strong_pair dereference() const { return { mCursor.mNode->mKey, mInstance }; }
+
+            // skip instances that are gone or aren't SUBCLASS
+            void settle()
+            {
+                for ( ; mCursor.mNode; getMap().next(mCursor))
+                {
+                    mInstance = std::dynamic_pointer_cast<SUBCLASS>(mCursor.mNode->mWeak.lock());
+                    if (mInstance)
+                    {
+                        return;
+                    }
+                }
+                mInstance.reset();
+            }
+
+            typename InstanceMap::Cursor mCursor;
+            std::shared_ptr<SUBCLASS> mInstance;
+        };
+
+        iterator begin() { return iterator(true); }
+        iterator end()   { return iterator(false); }
+
+    private:
+        // Keeps the nodes being traversed alive. A shared_ptr rather than a
+        // member so the snapshot stays copyable, see
+        // LLInstanceTracker::snapshot_of.
+        std::shared_ptr<LLInstanceTrackerPrivate::EpochGuard> mGuard{
+            std::make_shared<LLInstanceTrackerPrivate::EpochGuard>() };
+    };
+    using snapshot = snapshot_of<T>;
+
+    // iterate over this for references to each SUBCLASS instance
+    template <typename SUBCLASS>
+    class instance_snapshot_of: public snapshot_of<SUBCLASS>
+    {
+    private:
+        using super = snapshot_of<SUBCLASS>;
+        static T& instance_getter(typename super::iterator::reference pair)
+        {
+            return *pair.second;
+        }
+    public:
+        typedef boost::transform_iterator<decltype(instance_getter)*,
+                                          typename super::iterator> iterator;
+        iterator begin() { return iterator(super::begin(), instance_getter); }
+        iterator end()   { return iterator(super::end(),   instance_getter); }
+
+        void deleteAll()
+        {
+            for (auto it(super::begin()), end(super::end()); it != end; ++it)
+            {
+                delete (*it).second.get();
+            }
+        }
+    };
+    using instance_snapshot = instance_snapshot_of<T>;
+
+    // iterate over this for each key
+    template <typename SUBCLASS>
+    class key_snapshot_of: public snapshot_of<SUBCLASS>
+    {
+    private:
+        using super = snapshot_of<SUBCLASS>;
+        static KEY key_getter(typename super::iterator::reference pair)
+        {
+            return pair.first;
+        }
+    public:
+        typedef boost::transform_iterator<decltype(key_getter)*,
+                                          typename super::iterator> iterator;
+        iterator begin() { return iterator(super::begin(), key_getter); }
+        iterator end()   { return iterator(super::end(),   key_getter); }
+    };
+    using key_snapshot = key_snapshot_of<T>;
+
+    static ptr_t getInstance(const KEY& k)
+    {
+        return getMap().find(k);
+    }
+
+protected:
+    LLShardedInstanceTracker(const KEY& key):
+        // We do not intend to manage the lifespan of this object with
+        // shared_ptr, so give it a no-op deleter. The map stores weak_ptrs,
+        // resetting mOwner is what expires them.
+        mOwner(static_cast<T*>(this), [](T*){}),
+        mSelf(mOwner)
+    {
+        add_(key);
+    }
+public:
+    virtual ~LLShardedInstanceTracker()
+    {
+        // lookups racing with the destructor find nothing from here on
+        mOwner.reset();
+        getMap().erase(mInstanceKey, mSelf);
+    }
+protected:
+    virtual void setKey(KEY key)
+    {
+        getMap().erase(mInstanceKey, mSelf);
+        add_(key);
+    }
+public:
+    virtual const KEY& getKey() const { return mInstanceKey; }
+
+private:
+    LLShardedInstanceTracker( const LLShardedInstanceTracker& ) = delete;
+    LLShardedInstanceTracker& operator=( const LLShardedInstanceTracker& ) = delete;
+
+    void add_(const KEY& key)
+    {
+        mInstanceKey = key;
+        if (! getMap().insert(key, mSelf, KEY_COLLISION_BEHAVIOR == LLInstanceTrackerReplaceOnCollision))
+        {
+            LLInstanceTrackerPrivate::logerrs(typeid(*this).name(), " instance with key ",
+                                              stringize(key), " already exists!");
+        }
+    }
+
+    ptr_t mOwner;
+    weak_t mSelf;
+    KEY mInstanceKey;
+};
+
+/*****************************************************************************
+*   LLShardedInstanceTracker without key
+*****************************************************************************/
+/// explicit specialization for default case where KEY is void, instances
+/// are hashed by address
+template<typename T, EInstanceTrackerAllowKeyCollisions KEY_COLLISION_BEHAVIOR>
+class LLShardedInstanceTracker<T, void, KEY_COLLISION_BEHAVIOR>
+{
+    typedef LLInstanceTrackerPrivate::ShardedMap<const void*, T> InstanceMap;
+
+    static InstanceMap& getMap()
+    {
+        static InstanceMap sMap;
+        return sMap;
+    }
+
+public:
+    using ptr_t  = std::shared_ptr<T>;
+    using weak_t = std::weak_ptr<T>;
+
+    weak_t getWeak()
+    {
+        return mSelf;
+    }
+
+    static size_t instanceCount()
+    {
+        return getMap().size();
+    }
+
+    // traversal of std::shared_ptr<SUBCLASS> pointers
+    template <typename SUBCLASS>
+    class snapshot_of
+    {
+    public:
+        typedef std::shared_ptr<SUBCLASS> strong_ptr;
+
+        class iterator: public boost::iterator_facade<iterator, strong_ptr,
+                                                      boost::forward_traversal_tag, strong_ptr>
+        {
+        public:
+            iterator() {}
+            iterator(bool begin)
+            {
+                if (begin)
+                {
+                    getMap().first(mCursor);
+                    settle();
+                }
+            }
+
+        private:
+            friend class boost::iterator_core_access;
+
+            void increment()
+            {
+                getMap().next(mCursor);
+                settle();
+            }
+            bool equal(const iterator& other) const { return mCursor == other.mCursor; }
+            strong_ptr dereference() const { return mInstance; }
+
+            void settle()
+            {
+                for ( ; mCursor.mNode; getMap().next(mCursor))
+                {
+                    mInstance = std::dynamic_pointer_cast<SUBCLASS>(mCursor.mNode->mWeak.lock());
+                    if (mInstance)
+                    {
+                        return;
+                    }
+                }
+                mInstance.reset();
+            }
+
+            typename InstanceMap::Cursor mCursor;
+            strong_ptr mInstance;
+        };
+
+        iterator begin() { return iterator(true); }
+        iterator end()   { return iterator(false); }
+
+    private:
+        std::shared_ptr<LLInstanceTrackerPrivate::EpochGuard> mGuard{
+            std::make_shared<LLInstanceTrackerPrivate::EpochGuard>() };
+    };
+    using snapshot = snapshot_of<T>;
+
+    // iterate over this for references to each instance
+    template <typename SUBCLASS>
+    class instance_snapshot_of: public snapshot_of<SUBCLASS>
+    {
+    private:
+        using super = snapshot_of<SUBCLASS>;
+
+    public:
+        typedef boost::indirect_iterator<typename super::iterator> iterator;
+        iterator begin() { return iterator(super::begin()); }
+        iterator end()   { return iterator(super::end()); }
+
+        void deleteAll()
+        {
+            for (auto it(super::begin()), end(super::end()); it != end; ++it)
+            {
+                delete (*it).get();
+            }
+        }
+    };
+    using instance_snapshot = instance_snapshot_of<T>;
+    template <typename SUBCLASS>
+    using key_snapshot_of = instance_snapshot_of<SUBCLASS>;
+
+protected:
+    LLShardedInstanceTracker():
+        mOwner(static_cast<T*>(this), [](T*){}),
+        mSelf(mOwner)
+    {
+        getMap().insert(this, mSelf, false);
+    }
+public:
+    virtual ~LLShardedInstanceTracker()
+    {
+        mOwner.reset();
+        getMap().erase(this, mSelf);
+    }
+protected:
+    LLShardedInstanceTracker(const LLShardedInstanceTracker& other):
+        LLShardedInstanceTracker()
+    {}
+
+private:
+    ptr_t mOwner;
+    weak_t mSelf;
+};
+
+#endif /* ! defined(LL_LLSHARDEDINSTANCETRACKER_H) */
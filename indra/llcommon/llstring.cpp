@@ -30,8 +30,11 @@
 #include "llerror.h"
 #include "llfasttimer.h"
 #include "llsd.h"
+#include <bit>
 #include <vector>
 
+#include <emmintrin.h>
+
 #if LL_WINDOWS
 #include "llwin32headers.h"
 #endif
@@ -355,10 +358,15 @@ S32 wchar_utf8_length(const llwchar wc)
     {
         return 5;
     }
-    else
+    else if ((U32)wc < 0x80000000)
     {
         return 6;
     }
+    else
+    {
+        // wchar_to_utf8chars() writes LL_UNKNOWN_CHAR
+        return 1;
+    }
 }
 
 std::string wchar_utf8_preview(const llwchar wc)
@@ -386,117 +394,246 @@ std::string wchar_utf8_preview(const llwchar wc)
     return oss.str();
 }
 
-S32 wstring_utf8_length(const LLWString& wstr)
-{
-    S32 len = 0;
-    for (S32 i = 0; i < (S32)wstr.length(); i++)
-    {
-        len += wchar_utf8_length(wstr[i]);
-    }
-    return len;
-}
+/*
+ * The conversions between UTF-8 and UTF-32 handle sixteen ASCII characters
+ * at a time with SSE2, and anything else one character at a time. They
+ * write into a buffer sized up front rather than appending a character at a
+ * time.
+ */
+static_assert(sizeof(llwchar) == 4, "UTF-32 conversions expect 32 bit llwchar");
 
-LLWString utf8str_to_wstring(const char* utf8str, size_t len)
+namespace
 {
-    LLWString wout;
+    // The smallest value that takes 1 + n bytes of UTF-8
+    const llwchar UTF8_MIN_VALUE[] = { 0, 0x80, 0x800, 0x10000, 0x200000, 0x4000000 };
 
-    S32 i = 0;
-    while (i < len)
+    // Decodes the UTF-8 sequence whose lead byte is in[i] into out and returns
+    // the index following it. A byte that can't lead a sequence, a sequence
+    // cut short and an overlong sequence each decode to LL_UNKNOWN_CHAR. A
+    // sequence cut short by a byte that doesn't continue it resumes at that
+    // byte.
+    inline size_t decode_utf8_sequence(const U8* in, size_t i, size_t len, llwchar& out)
     {
+        const U8 lead = in[i];
         llwchar unichar;
-        U8 cur_char = utf8str[i];
-
-        if (cur_char < 0x80)
+        size_t cont_bytes;
+        if ((lead >> 5) == 0x6)         // Two byte UTF8 -> 1 UTF32
+        {
+            unichar = (0x1F & lead);
+            cont_bytes = 1;
+        }
+        else if ((lead >> 4) == 0xe)    // Three byte UTF8 -> 1 UTF32
+        {
+            unichar = (0x0F & lead);
+            cont_bytes = 2;
+        }
+        else if ((lead >> 3) == 0x1e)   // Four byte UTF8 -> 1 UTF32
+        {
+            unichar = (0x07 & lead);
+            cont_bytes = 3;
+        }
+        else if ((lead >> 2) == 0x3e)   // Five byte UTF8 -> 1 UTF32
+        {
+            unichar = (0x03 & lead);
+            cont_bytes = 4;
+        }
+        else if ((lead >> 1) == 0x7e)   // Six byte UTF8 -> 1 UTF32
         {
-            // Ascii character, just add it
-            unichar = cur_char;
+            unichar = (0x01 & lead);
+            cont_bytes = 5;
         }
         else
         {
-            S32 cont_bytes = 0;
-            if ((cur_char >> 5) == 0x6)         // Two byte UTF8 -> 1 UTF32
-            {
-                unichar = (0x1F&cur_char);
-                cont_bytes = 1;
-            }
-            else if ((cur_char >> 4) == 0xe)    // Three byte UTF8 -> 1 UTF32
-            {
-                unichar = (0x0F&cur_char);
-                cont_bytes = 2;
-            }
-            else if ((cur_char >> 3) == 0x1e)   // Four byte UTF8 -> 1 UTF32
-            {
-                unichar = (0x07&cur_char);
-                cont_bytes = 3;
-            }
-            else if ((cur_char >> 2) == 0x3e)   // Five byte UTF8 -> 1 UTF32
-            {
-                unichar = (0x03&cur_char);
-                cont_bytes = 4;
-            }
-            else if ((cur_char >> 1) == 0x7e)   // Six byte UTF8 -> 1 UTF32
+            out = LL_UNKNOWN_CHAR;
+            return i + 1;
+        }
+
+        for (size_t k = 1; k <= cont_bytes; ++k)
+        {
+            if (i + k >= len || (in[i + k] >> 6) != 0x2)
             {
-                unichar = (0x01&cur_char);
-                cont_bytes = 5;
+                out = LL_UNKNOWN_CHAR;
+                return i + k;
             }
-            else
+            unichar = (unichar << 6) | (0x3F & in[i + k]);
+        }
+        // Handle overlong characters and NULL characters
+        out = (unichar < UTF8_MIN_VALUE[cont_bytes]) ? (llwchar)LL_UNKNOWN_CHAR : unichar;
+        return i + 1 + cont_bytes;
+    }
+
+    // Like wchar_to_utf8chars(), which handles the rare cases out of line
+    inline size_t encode_utf8(llwchar in_char, char* out)
+    {
+        const U32 cur_char = (U32)in_char;
+        if (cur_char < 0x80)
+        {
+            out[0] = (char)cur_char;
+            return 1;
+        }
+        if (cur_char < 0x800)
+        {
+            out[0] = (char)(0xC0 | (cur_char >> 6));
+            out[1] = (char)(0x80 | (cur_char & 0x3F));
+            return 2;
+        }
+        if (cur_char < 0x10000)
+        {
+            out[0] = (char)(0xE0 | (cur_char >> 12));
+            out[1] = (char)(0x80 | ((cur_char >> 6) & 0x3F));
+            out[2] = (char)(0x80 | (cur_char & 0x3F));
+            return 3;
+        }
+        return wchar_to_utf8chars(in_char, out);
+    }
+} // anonymous namespace
+
+size_t wstring_utf8_length(LLWStringView wstr)
+{
+    const llwchar* in = wstr.data();
+    const size_t len = wstr.length();
+    size_t bytes = 0;
+    size_t i = 0;
+    // Each lane counts one byte per threshold its character exceeds. The
+    // compares are signed, so that characters from 0x80000000 up count one
+    // byte, the LL_UNKNOWN_CHAR they're written as.
+    const __m128i thresholds[] =
+    {
+        _mm_set1_epi32(0x7F), _mm_set1_epi32(0x7FF), _mm_set1_epi32(0xFFFF),
+        _mm_set1_epi32(0x1FFFFF), _mm_set1_epi32(0x3FFFFFF)
+    };
+    while (i + 4 <= len)
+    {
+        // lanes count at most 6 bytes a step: flush them before they could
+        // overflow
+        const size_t stop = std::min(len & ~size_t(3), i + (size_t(1) << 26));
+        __m128i counts = _mm_setzero_si128();
+        for ( ; i < stop; i += 4)
+        {
+            const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            counts = _mm_add_epi32(counts, _mm_set1_epi32(1));
+            for (const __m128i& threshold : thresholds)
             {
-                wout += LL_UNKNOWN_CHAR;
-                ++i;
-                continue;
+                counts = _mm_sub_epi32(counts, _mm_cmpgt_epi32(chars, threshold));
             }
+        }
+        alignas(16) U32 lanes[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), counts);
+        bytes += size_t(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+    }
+    for ( ; i < len; ++i)
+    {
+        bytes += wchar_utf8_length(in[i]);
+    }
+    return bytes;
+}
 
-            // Check that this character doesn't go past the end of the string
-            auto end = (len < (i + cont_bytes)) ? len : (i + cont_bytes);
-            do
+size_t utf8str_to_wchars(std::string_view in, std::span<llwchar> out)
+{
+    llassert(out.size() >= in.size());
+    const U8* src = reinterpret_cast<const U8*>(in.data());
+    const size_t len = in.size();
+    llwchar* dst = out.data();
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    while (i < len)
+    {
+        while (i + 16 <= len)
+        {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            const U32 non_ascii = (U32)_mm_movemask_epi8(bytes);
+            if (non_ascii)
             {
-                ++i;
-
-                cur_char = utf8str[i];
-                if ( (cur_char >> 6) == 0x2 )
-                {
-                    unichar <<= 6;
-                    unichar += (0x3F&cur_char);
-                }
-                else
+                // copy the ASCII characters before the first one that isn't
+                for (const size_t ascii = i + std::countr_zero(non_ascii); i < ascii; ++i)
                 {
-                    // Malformed sequence - roll back to look at this as a new char
-                    unichar = LL_UNKNOWN_CHAR;
-                    --i;
-                    break;
+                    *dst++ = src[i];
                 }
-            } while(i < end);
-
-            // Handle overlong characters and NULL characters
-            if ( ((cont_bytes == 1) && (unichar < 0x80))
-                || ((cont_bytes == 2) && (unichar < 0x800))
-                || ((cont_bytes == 3) && (unichar < 0x10000))
-                || ((cont_bytes == 4) && (unichar < 0x200000))
-                || ((cont_bytes == 5) && (unichar < 0x4000000)) )
-            {
-                unichar = LL_UNKNOWN_CHAR;
+                break;
             }
+            // widen sixteen bytes to sixteen llwchars
+            const __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+            const __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst),      _mm_unpacklo_epi16(lo, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4),  _mm_unpackhi_epi16(lo, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 8),  _mm_unpacklo_epi16(hi, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 12), _mm_unpackhi_epi16(hi, zero));
+            i += 16;
+            dst += 16;
+        }
+        if (i >= len)
+        {
+            break;
+        }
+        if (src[i] < 0x80)
+        {
+            *dst++ = src[i++];
+        }
+        else
+        {
+            i = decode_utf8_sequence(src, i, len, *dst++);
         }
-
-        wout += unichar;
-        ++i;
     }
-    return wout;
+    return dst - out.data();
 }
 
-std::string wstring_to_utf8str(const llwchar* utf32str, size_t len)
+size_t wstring_to_utf8chars(LLWStringView in, std::span<char> out)
 {
-    std::string out;
-
-    S32 i = 0;
+    const llwchar* src = in.data();
+    const size_t len = in.size();
+    char* dst = out.data();
+    const __m128i not_ascii = _mm_set1_epi32(~0x7F);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
     while (i < len)
     {
-        char tchars[8];     /* Flawfinder: ignore */
-        auto n = wchar_to_utf8chars(utf32str[i], tchars);
-        tchars[n] = 0;
-        out += tchars;
-        i++;
+        while (i + 16 <= len)
+        {
+            const __m128i* chars = reinterpret_cast<const __m128i*>(src + i);
+            const __m128i a = _mm_loadu_si128(chars);
+            const __m128i b = _mm_loadu_si128(chars + 1);
+            const __m128i c = _mm_loadu_si128(chars + 2);
+            const __m128i d = _mm_loadu_si128(chars + 3);
+            const __m128i high = _mm_and_si128(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)),
+                                               not_ascii);
+            const __m128i nul = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi32(a, zero), _mm_cmpeq_epi32(b, zero)),
+                                             _mm_or_si128(_mm_cmpeq_epi32(c, zero), _mm_cmpeq_epi32(d, zero)));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(high, zero)) != 0xFFFF || _mm_movemask_epi8(nul))
+            {
+                break;
+            }
+            // narrow sixteen llwchars to sixteen bytes
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst),
+                             _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+            i += 16;
+            dst += 16;
+        }
+        // the next sixteen one at a time, if the fast path stopped short
+        for (const size_t stop = std::min(len, i + 16); i < stop; ++i)
+        {
+            // NUL characters have always been dropped
+            if (src[i])
+            {
+                dst += encode_utf8(src[i], dst);
+            }
+        }
     }
+    llassert(size_t(dst - out.data()) <= out.size());
+    return dst - out.data();
+}
+
+LLWString utf8str_to_wstring(const char* utf8str, size_t len)
+{
+    LLWString wout(len, 0);
+    wout.resize(utf8str_to_wchars(std::string_view(utf8str, len), wout));
+    return wout;
+}
+
+std::string wstring_to_utf8str(const llwchar* utf32str, size_t len)
+{
+    const LLWStringView in(utf32str, len);
+    std::string out(wstring_utf8_length(in), 0);
+    out.resize(wstring_to_utf8chars(in, out));
     return out;
 }
 
@@ -29,6 +29,7 @@
 
 #include <boost/call_traits.hpp>
 #include <optional>
+#include <span>
 #include <string>
 #include <string_view>
 #include <cstdio>
@@ -678,8 +679,22 @@ ll_convert_forms(ll_convert_u16_alias, std::string, llutf16string, utf16str_to_u
 // an older alias for utf16str_to_utf8str(llutf16string)
 inline std::string wstring_to_utf8str(const llutf16string &utf16str) { return utf16str_to_utf8str(utf16str);}
 
+// Decodes UTF-8 like utf8str_to_wstring(), but into out rather than a new
+// string. out needs room for in.size() llwchars, one per byte at most.
+// Returns the number of llwchars written.
+LL_COMMON_API size_t utf8str_to_wchars(std::string_view in, std::span<llwchar> out);
+
+// Encodes UTF-32 like wstring_to_utf8str(), but into out rather than a new
+// string. out needs room for wstring_utf8_length(in) chars. Returns the
+// number of chars written.
+LL_COMMON_API size_t wstring_to_utf8chars(LLWStringView in, std::span<char> out);
+
 // Length of this UTF32 string in bytes when transformed to UTF8
-LL_COMMON_API S32 wstring_utf8_length(const LLWString& wstr);
+LL_COMMON_API size_t wstring_utf8_length(LLWStringView wstr);
+inline S32 wstring_utf8_length(const LLWString& wstr)
+{
+    return (S32)wstring_utf8_length(LLWStringView(wstr));
+}
 
 // Length in bytes of this wide char in a UTF8 string
 LL_COMMON_API S32 wchar_utf8_length(const llwchar wc);
@@ -349,3 +349,96 @@ void LLStringTable::removeString(const char *str)
     }
 }
 
+
+//============================================================================
+
+LLConcurrentStringTable::LLConcurrentStringTable(U32 tablesize)
+{
+    // a power of 2, which is kept at most half full
+    size_t size = 256;
+    while (size < 2 * size_t(tablesize))
+    {
+        size <<= 1;
+    }
+    mTables.emplace_back(std::make_unique<Table>(size));
+    mTable.store(mTables.back().get(), std::memory_order_release);
+}
+
+// static
+LLStdStringHandle LLConcurrentStringTable::find(const Table* table, size_t hashval, std::string_view s)
+{
+    for (size_t i = hashval & table->mMask; ; i = (i + 1) & table->mMask)
+    {
+        const Slot& slot = table->mSlots[i];
+        LLStdStringHandle string = slot.mString.load(std::memory_order_acquire);
+        if (! string)
+        {
+            return NULL;
+        }
+        if (slot.mHash.load(std::memory_order_relaxed) == hashval && *string == s)
+        {
+            return string;
+        }
+    }
+}
+
+// static
+void LLConcurrentStringTable::place(Table* table, size_t hashval, LLStdStringHandle string)
+{
+    size_t i = hashval & table->mMask;
+    while (table->mSlots[i].mString.load(std::memory_order_relaxed))
+    {
+        i = (i + 1) & table->mMask;
+    }
+    table->mSlots[i].mHash.store(hashval, std::memory_order_relaxed);
+    table->mSlots[i].mString.store(string, std::memory_order_release);
+}
+
+LLStdStringHandle LLConcurrentStringTable::checkString(std::string_view s) const
+{
+    return find(mTable.load(std::memory_order_acquire), makehash(s), s);
+}
+
+LLStdStringHandle LLConcurrentStringTable::insert(std::string_view s)
+{
+    const size_t hashval = makehash(s);
+    LLStdStringHandle result = find(mTable.load(std::memory_order_acquire), hashval, s);
+    if (result)
+    {
+        return result;
+    }
+
+    std::lock_guard<std::mutex> lock(mInsertMutex);
+    Table* table = mTable.load(std::memory_order_relaxed);
+    // another thread may have inserted s since we looked
+    result = find(table, hashval, s);
+    if (result)
+    {
+        return result;
+    }
+
+    const size_t count = mSize.load(std::memory_order_relaxed) + 1;
+    if (count * 2 > table->mMask + 1)
+    {
+        // Fill a table twice the size before publishing it. A reader still
+        // probing the old one finds everything inserted up to now.
+        auto bigger = std::make_unique<Table>(2 * (table->mMask + 1));
+        for (size_t i = 0; i <= table->mMask; ++i)
+        {
+            const Slot& slot = table->mSlots[i];
+            if (LLStdStringHandle string = slot.mString.load(std::memory_order_relaxed))
+            {
+                place(bigger.get(), slot.mHash.load(std::memory_order_relaxed), string);
+            }
+        }
+        table = bigger.get();
+        mTables.emplace_back(std::move(bigger));
+        mTable.store(table, std::memory_order_release);
+    }
+
+    mStrings.emplace_back(s);
+    result = &mStrings.back();
+    place(table, hashval, result);
+    mSize.store(count, std::memory_order_relaxed);
+    return result;
+}
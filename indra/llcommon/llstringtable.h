@@ -31,8 +31,14 @@
 #include "lldefs.h"
 #include "llformat.h"
 #include "llstl.h"
+#include <atomic>
+#include <deque>
 #include <list>
+#include <memory>
+#include <mutex>
 #include <set>
+#include <string_view>
+#include <vector>
 
 #if LL_WINDOWS
 # if (_MSC_VER >= 1300 && _MSC_VER < 1400)
@@ -206,4 +212,59 @@ private:
 };
 
 
+//============================================================================
+
+// Like LLStdStringTable, but safe to share between threads: lookups take no
+// lock, and inserts from any thread agree on one handle per string.
+// Strings are never removed, so a handle stays valid, and comparing two
+// handles compares the strings, for the life of the table.
+
+class LL_COMMON_API LLConcurrentStringTable
+{
+public:
+    LLConcurrentStringTable(U32 tablesize = 0);
+
+    LLConcurrentStringTable(const LLConcurrentStringTable&) = delete;
+    LLConcurrentStringTable& operator=(const LLConcurrentStringTable&) = delete;
+
+    // NULL unless s has been inserted. Lock free.
+    LLStdStringHandle checkString(std::string_view s) const;
+    LLStdStringHandle lookup(std::string_view s) const { return checkString(s); }
+
+    // Lock free if s is already in the table, otherwise serialized with
+    // other inserts.
+    LLStdStringHandle insert(std::string_view s);
+    LLStdStringHandle addString(std::string_view s) { return insert(s); }
+
+    size_t size() const { return mSize.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot
+    {
+        // mHash is written before mString is published
+        std::atomic<size_t> mHash{ 0 };
+        std::atomic<LLStdStringHandle> mString{ nullptr };
+    };
+    struct Table
+    {
+        Table(size_t size): mMask(size - 1), mSlots(new Slot[size]) {}
+        const size_t mMask;
+        const std::unique_ptr<Slot[]> mSlots;
+    };
+
+    static size_t makehash(std::string_view s) { return std::hash<std::string_view>()(s); }
+    static LLStdStringHandle find(const Table* table, size_t hashval, std::string_view s);
+    static void place(Table* table, size_t hashval, LLStdStringHandle string);
+
+    std::atomic<Table*> mTable;
+    std::atomic<size_t> mSize{ 0 };
+    // the rest belong to inserts, under mInsertMutex
+    std::mutex mInsertMutex;
+    // Readers may still be probing a table that's been outgrown, so tables
+    // are kept until the string table goes.
+    std::vector<std::unique_ptr<Table>> mTables;
+    // append-only: growing a deque never moves what's already in it
+    std::deque<std::string> mStrings;
+};
+
 #endif
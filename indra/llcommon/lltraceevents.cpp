@@ -0,0 +1,440 @@
+/**
+ * @file lltraceevents.cpp
+ * @brief Per thread ring buffers of trace events, exported as a Chrome trace
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "lltraceevents.h"
+
+#include "llfasttimer.h"
+#include "llfile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <limits>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace
+{
+    enum EEventType : U32
+    {
+        EVENT_BEGIN,
+        EVENT_END,
+        EVENT_COUNTER,
+        EVENT_INSTANT
+    };
+
+    struct TraceEvent
+    {
+        U64         mTime;      // fast timer clock
+        const char* mName;
+        F64         mValue;
+        U32         mType;
+    };
+
+    // Threads that exited whose events are kept for the dumps
+    const size_t MAX_RETIRED_BUFFERS = 16;
+
+    //-------------------------------------------------------------------------
+    // EventBuffer
+    //
+    // The events of one thread.  Only that thread writes, overwriting the
+    // oldest event once it's full.  mHead counts the events written and is
+    // all the synchronization there is: a dump copies the events behind it
+    // and then drops the ones the thread may have overwritten meanwhile.
+    //-------------------------------------------------------------------------
+    class EventBuffer
+    {
+    public:
+        EventBuffer(size_t size, U32 thread_id, const std::string& name):
+            mEvents(new TraceEvent[size]),
+            mMask(size - 1),
+            mHead(0),
+            mStart(0),
+            mRetired(false),
+            mThreadID(thread_id),
+            mName(name)
+        {
+        }
+
+        void push(EEventType type, const char* name, F64 value)
+        {
+            const U64 head = mHead.load(std::memory_order_relaxed);
+            TraceEvent& event = mEvents[head & mMask];
+            event.mTime = LLTrace::BlockTimer::getCPUClockCount64();
+            event.mName = name;
+            event.mValue = value;
+            event.mType = type;
+            mHead.store(head + 1, std::memory_order_release);
+        }
+
+        // Appends the events still in the buffer to events
+        void copy(std::vector<TraceEvent>& events) const
+        {
+            const U64 size = mMask + 1;
+            const U64 end = mHead.load(std::memory_order_acquire);
+            const U64 begin = std::max(end > size ? end - size : 0, mStart.load(std::memory_order_relaxed));
+            const size_t first = events.size();
+            for (U64 i = begin; i < end; i++)
+            {
+                events.push_back(mEvents[i & mMask]);
+            }
+
+            // The event being written after the new head overwrites one more
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const U64 head = mHead.load(std::memory_order_relaxed);
+            const U64 valid = head + 1 > size ? head + 1 - size : 0;
+            if (valid > begin)
+            {
+                events.erase(events.begin() + first,
+                             events.begin() + first + (size_t)std::min(valid - begin, end - begin));
+            }
+        }
+
+        void clear() { mStart = mHead.load(std::memory_order_acquire); }
+
+        std::unique_ptr<TraceEvent[]> mEvents;
+        const U64           mMask;
+        std::atomic<U64>    mHead;
+        std::atomic<U64>    mStart;     // events before were cleared
+        std::atomic<bool>   mRetired;   // its thread exited
+        const U32           mThreadID;
+        std::string         mName;      // guarded by the registry mutex
+    };
+    typedef std::shared_ptr<EventBuffer> EventBufferPtr;
+
+    struct Registry
+    {
+        std::mutex                  mMutex;
+        std::vector<EventBufferPtr> mBuffers;
+        size_t                      mBufferSize = LLTrace::EventTrace::DEFAULT_BUFFER_SIZE;
+        U32                         mNextThreadID = 1;
+
+        // Ties the fast timer clock to real time, the dumps work out its rate
+        bool                                    mHasBase = false;
+        U64                                     mBaseClock = 0;
+        std::chrono::steady_clock::time_point   mBaseTime;
+    };
+
+    Registry& getRegistry()
+    {
+        static Registry sRegistry;
+        return sRegistry;
+    }
+
+    // Changes when the buffers are thrown away, threads then make new ones
+    std::atomic<U32> sGeneration(1);
+
+    // The buffer of the calling thread
+    struct ThreadEvents
+    {
+        EventBufferPtr  mBuffer;
+        U32             mGeneration = 0;
+        std::string     mName;
+
+        ~ThreadEvents()
+        {
+            if (mBuffer)
+            {
+                mBuffer->mRetired = true;
+            }
+        }
+    };
+    thread_local ThreadEvents tThreadEvents;
+
+    EventBuffer& getThreadBuffer()
+    {
+        ThreadEvents& local = tThreadEvents;
+        const U32 generation = sGeneration.load(std::memory_order_acquire);
+        if (LL_UNLIKELY(!local.mBuffer || local.mGeneration != generation))
+        {
+            Registry& registry = getRegistry();
+            std::lock_guard<std::mutex> lock(registry.mMutex);
+            const U32 thread_id = local.mBuffer ? local.mBuffer->mThreadID : registry.mNextThreadID++;
+            local.mBuffer = std::make_shared<EventBuffer>(registry.mBufferSize, thread_id, local.mName);
+            local.mGeneration = generation;
+
+            // forget the oldest threads that exited
+            size_t retired = std::count_if(registry.mBuffers.begin(), registry.mBuffers.end(),
+                                           [](const EventBufferPtr& buffer) { return buffer->mRetired.load(); });
+            for (auto it = registry.mBuffers.begin(); it != registry.mBuffers.end() && retired > MAX_RETIRED_BUFFERS; )
+            {
+                if ((*it)->mRetired)
+                {
+                    it = registry.mBuffers.erase(it);
+                    retired--;
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+            registry.mBuffers.push_back(local.mBuffer);
+        }
+        return *local.mBuffer;
+    }
+
+    void writeJSONString(std::ostream& out, const char* str)
+    {
+        out << '"';
+        for (const char* c = str; *c; c++)
+        {
+            if (*c == '"' || *c == '\\')
+            {
+                out << '\\' << *c;
+            }
+            else if ((U8)*c < 0x20)
+            {
+                out << "\\u00" << std::hex << std::setw(2) << std::setfill('0') << (U32)(U8)*c << std::dec;
+            }
+            else
+            {
+                out << *c;
+            }
+        }
+        out << '"';
+    }
+}
+
+namespace LLTrace
+{
+
+std::atomic<bool> EventTrace::sEnabled(false);
+
+//-----------------------------------------------------------------------------
+// setEnabled()
+//-----------------------------------------------------------------------------
+// static
+void EventTrace::setEnabled(bool enabled, size_t buffer_size)
+{
+    Registry& registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mMutex);
+    if (enabled)
+    {
+        size_t size = 16;
+        while (size < buffer_size)
+        {
+            size <<= 1;
+        }
+        if (size != registry.mBufferSize)
+        {
+            registry.mBufferSize = size;
+            registry.mBuffers.clear();
+            sGeneration++;
+        }
+        if (!registry.mHasBase)
+        {
+            registry.mBaseClock = BlockTimer::getCPUClockCount64();
+            registry.mBaseTime = std::chrono::steady_clock::now();
+            registry.mHasBase = true;
+        }
+    }
+    sEnabled = enabled;
+}
+
+//-----------------------------------------------------------------------------
+// beginZone()
+//-----------------------------------------------------------------------------
+// static
+void EventTrace::beginZone(const char* name)
+{
+    getThreadBuffer().push(EVENT_BEGIN, name, 0.0);
+}
+
+//-----------------------------------------------------------------------------
+// endZone()
+//-----------------------------------------------------------------------------
+// static
+void EventTrace::endZone(const char* name)
+{
+    getThreadBuffer().push(EVENT_END, name, 0.0);
+}
+
+//-----------------------------------------------------------------------------
+// counter()
+//-----------------------------------------------------------------------------
+// static
+void EventTrace::counter(const char* name, F64 value)
+{
+    getThreadBuffer().push(EVENT_COUNTER, name, value);
+}
+
+//-----------------------------------------------------------------------------
+// instant()
+//-----------------------------------------------------------------------------
+// static
+void EventTrace::instant(const char* name)
+{
+    getThreadBuffer().push(EVENT_INSTANT, name, 0.0);
+}
+
+//-----------------------------------------------------------------------------
+// setThreadName()
+//-----------------------------------------------------------------------------
+// static
+void EventTrace::setThreadName(const char* name)
+{
+    ThreadEvents& local = tThreadEvents;
+    local.mName = name;
+    if (local.mBuffer)
+    {
+        std::lock_guard<std::mutex> lock(getRegistry().mMutex);
+        local.mBuffer->mName = name;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// dump()
+//-----------------------------------------------------------------------------
+// static
+size_t EventTrace::dump(std::ostream& out, F64 seconds)
+{
+    Registry& registry = getRegistry();
+    std::vector<EventBufferPtr> buffers;
+    std::vector<std::string> names;
+    U64 base_clock = 0;
+    std::chrono::steady_clock::time_point base_time;
+    {
+        std::lock_guard<std::mutex> lock(registry.mMutex);
+        buffers = registry.mBuffers;
+        for (const EventBufferPtr& buffer : buffers)
+        {
+            names.push_back(buffer->mName.empty() ? "Thread " + std::to_string(buffer->mThreadID) : buffer->mName);
+        }
+        base_clock = registry.mBaseClock;
+        base_time = registry.mBaseTime;
+    }
+
+    // Fast timer clock rate, measured over the time since tracing started
+    // when that's long enough to be more accurate than the nominal one
+    const U64 now_clock = BlockTimer::getCPUClockCount64();
+    const F64 elapsed = std::chrono::duration<F64>(std::chrono::steady_clock::now() - base_time).count();
+    const F64 clock_rate = elapsed > 0.1 ? (F64)(now_clock - base_clock) / elapsed : (F64)BlockTimer::countsPerSecond();
+    const S64 window_start = seconds > 0.0 ? (S64)now_clock - (S64)(seconds * clock_rate) : std::numeric_limits<S64>::min();
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    size_t count = 0;
+    std::vector<TraceEvent> events;
+    for (size_t i = 0; i < buffers.size(); i++)
+    {
+        const U32 tid = buffers[i]->mThreadID;
+        out << (count ? ",\n" : "") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+            << ",\"args\":{\"name\":";
+        writeJSONString(out, names[i].c_str());
+        out << "}}";
+        count++;
+
+        events.clear();
+        buffers[i]->copy(events);
+        S32 depth = 0;
+        for (const TraceEvent& event : events)
+        {
+            if ((S64)event.mTime < window_start)
+            {
+                continue;
+            }
+            const char* phase = "i";
+            switch (event.mType)
+            {
+            case EVENT_BEGIN:
+                phase = "B";
+                depth++;
+                break;
+            case EVENT_END:
+                // began before the window or was overwritten
+                if (!depth)
+                {
+                    continue;
+                }
+                phase = "E";
+                depth--;
+                break;
+            case EVENT_COUNTER:
+                phase = "C";
+                break;
+            default:
+                break;
+            }
+
+            const F64 micros = (F64)((S64)(event.mTime - base_clock)) * 1000000.0 / clock_rate;
+            out << ",\n{\"name\":";
+            writeJSONString(out, event.mName);
+            out << ",\"ph\":\"" << phase << "\",\"ts\":" << std::fixed << std::setprecision(3) << micros
+                << ",\"pid\":1,\"tid\":" << tid;
+            if (event.mType == EVENT_COUNTER)
+            {
+                out << ",\"args\":{\"value\":" << std::setprecision(6) << event.mValue << "}";
+            }
+            else if (event.mType == EVENT_INSTANT)
+            {
+                out << ",\"s\":\"t\"";
+            }
+            out << "}";
+            count++;
+        }
+    }
+    out << "\n]}\n";
+
+    // not counting the thread names
+    return count - buffers.size();
+}
+
+// static
+bool EventTrace::dump(const std::string& filename, F64 seconds, size_t* num_events)
+{
+    llofstream out(filename.c_str());
+    if (!out.is_open())
+    {
+        LL_WARNS("EventTrace") << "Unable to open " << filename << LL_ENDL;
+        return false;
+    }
+    const size_t count = dump(out, seconds);
+    out.close();
+    if (num_events)
+    {
+        *num_events = count;
+    }
+    LL_INFOS("EventTrace") << "Wrote " << count << " trace events to " << filename << LL_ENDL;
+    return !out.fail();
+}
+
+//-----------------------------------------------------------------------------
+// clear()
+//-----------------------------------------------------------------------------
+// static
+void EventTrace::clear()
+{
+    Registry& registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mMutex);
+    for (const EventBufferPtr& buffer : registry.mBuffers)
+    {
+        buffer->clear();
+    }
+}
+
+}
@@ -0,0 +1,126 @@
+/**
+ * @file lltraceevents.h
+ * @brief Per thread ring buffers of trace events, exported as a Chrome trace
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTRACEEVENTS_H
+#define LL_LLTRACEEVENTS_H
+
+// Included by llprofiler.h, ahead of everything else in linden_common.h:
+// keep the includes here to a minimum.
+#include "llpreprocessor.h"
+#include "stdtypes.h"
+
+#include <atomic>
+#include <iosfwd>
+#include <string>
+
+// Records a counter sample when event tracing is on
+#define LL_TRACE_COUNTER(name, value) \
+    do { if (LLTrace::EventTrace::isEnabled()) LLTrace::EventTrace::counter(name, (F64)(value)); } while (0)
+
+namespace LLTrace
+{
+
+//-----------------------------------------------------------------------------
+// class EventTrace
+//
+// A flight recorder for the profile zones, fast timers and counters.  While
+// it's on each thread writes begin, end, counter and instant events into its
+// own fixed size ring, overwriting the oldest, and dump() writes the last
+// seconds of all threads out as a Chrome trace (JSON Trace Event Format),
+// which chrome://tracing and the Perfetto UI open.  It needs no profiler
+// attached and costs a relaxed load and a branch per zone while it's off.
+//
+// Event names are not copied, they must live as long as the program, like
+// string literals and __FUNCTION__.
+//-----------------------------------------------------------------------------
+class LL_COMMON_API EventTrace
+{
+public:
+    // Events kept per thread
+    static const size_t DEFAULT_BUFFER_SIZE = 32 * 1024;
+
+    static bool isEnabled() { return sEnabled.load(std::memory_order_relaxed); }
+    // buffer_size events per thread, rounded up to a power of two.  Turning
+    // it on again with another size starts over.
+    static void setEnabled(bool enabled, size_t buffer_size = DEFAULT_BUFFER_SIZE);
+
+    static void beginZone(const char* name);
+    static void endZone(const char* name);
+    static void counter(const char* name, F64 value);
+    static void instant(const char* name);
+
+    // Names the calling thread in the dumps, the name is copied
+    static void setThreadName(const char* name);
+
+    // Writes the events of the last seconds, all of them if seconds <= 0.
+    // Returns the number of events written.
+    static size_t dump(std::ostream& out, F64 seconds = 0.0);
+    // false if the file can't be written
+    static bool dump(const std::string& filename, F64 seconds = 0.0, size_t* num_events = NULL);
+
+    // Drops the events recorded so far
+    static void clear();
+
+private:
+    static std::atomic<bool> sEnabled;
+};
+
+//-----------------------------------------------------------------------------
+// class EventZone
+//
+// Begins a zone for the rest of the scope if event tracing is on.  Used by
+// the LL_PROFILE_ZONE and LL_RECORD_BLOCK_TIME macros.
+//-----------------------------------------------------------------------------
+class EventZone
+{
+public:
+    EventZone(const char* name)
+    :   mName(EventTrace::isEnabled() ? name : NULL)
+    {
+        if (mName)
+        {
+            EventTrace::beginZone(mName);
+        }
+    }
+
+    ~EventZone()
+    {
+        if (mName)
+        {
+            EventTrace::endZone(mName);
+        }
+    }
+
+private:
+    EventZone(const EventZone&) = delete;
+    EventZone& operator=(const EventZone&) = delete;
+
+    const char* mName;
+};
+
+}
+
+#endif // LL_LLTRACEEVENTS_H
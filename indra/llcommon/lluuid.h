@@ -26,6 +26,7 @@
 #ifndef LL_LLUUID_H
 #define LL_LLUUID_H
 
+#include <cstring>
 #include <iostream>
 #include <set>
 #include <vector>
@@ -122,6 +123,20 @@ public:
         return tmp[0] ^ tmp[1];
     }
 
+    // Returns a 64 bits hash of the UUID in which every bit depends on all
+    // of them, unlike getDigest64() which is zero for any UUID with equal
+    // halves. It takes no seed, so it's the same in every build and run.
+    inline U64 getHash64() const
+    {
+        U64 lo, hi;
+        memcpy(&lo, mData, sizeof(lo));
+        memcpy(&hi, mData + sizeof(lo), sizeof(hi));
+        U64 hash = (lo * 0x9e3779b97f4a7c15ULL) ^ hi;
+        hash ^= hash >> 32;
+        hash *= 0xd6e8feb86659fd93ULL;
+        return hash ^ (hash >> 32);
+    }
+
     static bool validate(const std::string& in_string); // Validate that the UUID string is legal.
 
     static const LLUUID null;
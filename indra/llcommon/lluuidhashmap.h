@@ -0,0 +1,577 @@
+/**
+ * @file   lluuidhashmap.h
+ * @brief  LLUUIDHashMap: an open addressing hash map keyed by LLUUID
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#if ! defined(LL_LLUUIDHASHMAP_H)
+#define LL_LLUUIDHASHMAP_H
+
+#include <algorithm>
+#include <bit>
+#include <map>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <emmintrin.h>
+
+#include <boost/iterator/iterator_facade.hpp>
+
+#include "lluuid.h"
+
+namespace LLUUIDHashMapPrivate
+{
+    // Control byte of each slot: the low 7 bits of the key's hash if the
+    // slot is full, else one of these.
+    constexpr S8 EMPTY    = -128;
+    constexpr S8 DELETED  = -2;
+    // follows the last slot so that iteration stops there
+    constexpr S8 SENTINEL = -1;
+
+    constexpr size_t GROUP_WIDTH = 16;
+
+    // The control bytes of an empty map
+    alignas(GROUP_WIDTH) inline const S8 sEmptyGroup[GROUP_WIDTH] =
+    {
+        SENTINEL, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY,
+        EMPTY,    EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY, EMPTY
+    };
+
+    // The control bytes of GROUP_WIDTH slots, compared at once
+    class Group
+    {
+    public:
+        explicit Group(const S8* ctrl):
+            mCtrl(_mm_load_si128(reinterpret_cast<const __m128i*>(ctrl)))
+        {}
+
+        // bit i set if slot i holds hash bits h2
+        U32 match(S8 h2) const
+        {
+            return U32(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), mCtrl)));
+        }
+
+        U32 matchEmpty() const
+        {
+            return match(EMPTY);
+        }
+
+        U32 matchEmptyOrDeleted() const
+        {
+            return U32(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(SENTINEL), mCtrl)));
+        }
+
+    private:
+        __m128i mCtrl;
+    };
+} // namespace LLUUIDHashMapPrivate
+
+/**
+ * A hash map from LLUUID to T that stores its keys and values in one array
+ * rather than a node each, with a byte of the key's hash per slot so that a
+ * lookup compares sixteen slots at a time with SSE2 and usually touches a
+ * single key.
+ *
+ * The interface is the part of std::map's that UUID-keyed code uses. Unlike
+ * std::map:
+ * - iteration is in no particular order, which can change on insert;
+ * - inserting may move every value, invalidating all iterators, pointers and
+ *   references into the map;
+ * - erasing moves nothing, so it invalidates only what refers to the erased
+ *   value, and map.erase(it++) works as it does for std::map.
+ */
+template <typename T>
+class LLUUIDHashMap
+{
+public:
+    typedef LLUUID                      key_type;
+    typedef T                           mapped_type;
+    typedef std::pair<const LLUUID, T>  value_type;
+    typedef size_t                      size_type;
+
+private:
+    template <typename VALUE>
+    class iterator_base:
+        public boost::iterator_facade<iterator_base<VALUE>, VALUE,
+                                      boost::forward_traversal_tag>
+    {
+    public:
+        iterator_base() = default;
+        // an iterator converts to a const_iterator
+        template <typename OTHER,
+                  typename = std::enable_if_t<std::is_convertible_v<OTHER*, VALUE*>>>
+        iterator_base(const iterator_base<OTHER>& other):
+            mCtrl(other.mCtrl),
+            mSlot(other.mSlot)
+        {}
+
+    private:
+        friend class boost::iterator_core_access;
+        friend class LLUUIDHashMap;
+        template <typename OTHER> friend class iterator_base;
+
+        iterator_base(const S8* ctrl, VALUE* slot):
+            mCtrl(ctrl),
+            mSlot(slot)
+        {}
+
+        // moves on to the first full slot from here, or to the sentinel
+        void skipUnused()
+        {
+            while (*mCtrl < LLUUIDHashMapPrivate::SENTINEL)
+            {
+                ++mCtrl;
+                ++mSlot;
+            }
+        }
+
+        void increment()
+        {
+            ++mCtrl;
+            ++mSlot;
+            skipUnused();
+        }
+
+        template <typename OTHER>
+        bool equal(const iterator_base<OTHER>& other) const
+        {
+            return mCtrl == other.mCtrl;
+        }
+
+        VALUE& dereference() const
+        {
+            return *mSlot;
+        }
+
+        const S8* mCtrl = nullptr;
+        VALUE*    mSlot = nullptr;
+    };
+
+public:
+    typedef iterator_base<value_type>       iterator;
+    typedef iterator_base<const value_type> const_iterator;
+
+    LLUUIDHashMap() = default;
+
+    LLUUIDHashMap(const LLUUIDHashMap& other)
+    {
+        reserve(other.size());
+        for (const value_type& value : other)
+        {
+            insertUnique(value.first, value.second);
+        }
+    }
+
+    LLUUIDHashMap(LLUUIDHashMap&& other) noexcept
+    {
+        swap(other);
+    }
+
+    ~LLUUIDHashMap()
+    {
+        destroyAll();
+        deallocate();
+    }
+
+    LLUUIDHashMap& operator=(const LLUUIDHashMap& other)
+    {
+        if (this != &other)
+        {
+            LLUUIDHashMap copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+
+    LLUUIDHashMap& operator=(LLUUIDHashMap&& other) noexcept
+    {
+        LLUUIDHashMap moved(std::move(other));
+        swap(moved);
+        return *this;
+    }
+
+    void swap(LLUUIDHashMap& other) noexcept
+    {
+        std::swap(mCtrl, other.mCtrl);
+        std::swap(mSlots, other.mSlots);
+        std::swap(mCapacity, other.mCapacity);
+        std::swap(mSize, other.mSize);
+        std::swap(mGrowthLeft, other.mGrowthLeft);
+    }
+
+    iterator begin()
+    {
+        iterator it(mCtrl, mSlots);
+        it.skipUnused();
+        return it;
+    }
+    iterator end()                  { return iterator(mCtrl + mCapacity, mSlots + mCapacity); }
+    const_iterator begin() const
+    {
+        const_iterator it(mCtrl, mSlots);
+        it.skipUnused();
+        return it;
+    }
+    const_iterator end() const      { return const_iterator(mCtrl + mCapacity, mSlots + mCapacity); }
+    const_iterator cbegin() const   { return begin(); }
+    const_iterator cend() const     { return end(); }
+
+    bool empty() const              { return mSize == 0; }
+    size_type size() const          { return mSize; }
+    /// Number of slots, full or not
+    size_type capacity() const      { return mCapacity; }
+
+    /// Destroys every value but keeps the slots
+    void clear()
+    {
+        destroyAll();
+        if (mCapacity)
+        {
+            resetCtrl();
+        }
+        mSize = 0;
+        mGrowthLeft = maxLoad(mCapacity);
+    }
+
+    /// Makes room for count values without rehashing
+    void reserve(size_type count)
+    {
+        if (count > mSize + mGrowthLeft)
+        {
+            rehash(count);
+        }
+    }
+
+    iterator find(const LLUUID& key)
+    {
+        size_t slot = findSlot(key);
+        return slot == NOT_FOUND ? end() : iterator(mCtrl + slot, mSlots + slot);
+    }
+
+    const_iterator find(const LLUUID& key) const
+    {
+        size_t slot = findSlot(key);
+        return slot == NOT_FOUND ? end() : const_iterator(mCtrl + slot, mSlots + slot);
+    }
+
+    size_type count(const LLUUID& key) const
+    {
+        return findSlot(key) == NOT_FOUND ? 0 : 1;
+    }
+
+    bool contains(const LLUUID& key) const
+    {
+        return findSlot(key) != NOT_FOUND;
+    }
+
+    T& operator[](const LLUUID& key)
+    {
+        return try_emplace(key).first->second;
+    }
+
+    template <typename... ARGS>
+    std::pair<iterator, bool> try_emplace(const LLUUID& key, ARGS&&... args)
+    {
+        const U64 hash = key.getHash64();
+        size_t slot = findSlot(key, hash);
+        if (slot != NOT_FOUND)
+        {
+            return { iterator(mCtrl + slot, mSlots + slot), false };
+        }
+        slot = insertSlot(hash, std::piecewise_construct, std::forward_as_tuple(key),
+                          std::forward_as_tuple(std::forward<ARGS>(args)...));
+        return { iterator(mCtrl + slot, mSlots + slot), true };
+    }
+
+    template <typename... ARGS>
+    std::pair<iterator, bool> emplace(const LLUUID& key, ARGS&&... args)
+    {
+        return try_emplace(key, std::forward<ARGS>(args)...);
+    }
+
+    std::pair<iterator, bool> insert(const value_type& value)
+    {
+        return try_emplace(value.first, value.second);
+    }
+
+    template <typename VALUE>
+    std::pair<iterator, bool> insert_or_assign(const LLUUID& key, VALUE&& value)
+    {
+        auto result = try_emplace(key, std::forward<VALUE>(value));
+        if (!result.second)
+        {
+            result.first->second = std::forward<VALUE>(value);
+        }
+        return result;
+    }
+
+    /// Returns the iterator following pos
+    iterator erase(const_iterator pos)
+    {
+        const size_t slot = pos.mSlot - mSlots;
+        iterator next(pos.mCtrl, mSlots + slot);
+        ++next;
+        eraseSlot(slot);
+        return next;
+    }
+
+    iterator erase(iterator pos)
+    {
+        return erase(const_iterator(pos));
+    }
+
+    size_type erase(const LLUUID& key)
+    {
+        size_t slot = findSlot(key);
+        if (slot == NOT_FOUND)
+        {
+            return 0;
+        }
+        eraseSlot(slot);
+        return 1;
+    }
+
+private:
+    static constexpr size_t NOT_FOUND = ~size_t(0);
+
+    // values a table of capacity slots takes before it grows: 7/8 of them
+    static size_t maxLoad(size_t capacity)
+    {
+        return capacity - capacity / 8;
+    }
+
+    static S8 h2(U64 hash)
+    {
+        return S8(hash & 0x7f);
+    }
+
+    // the group of slots to probe first
+    size_t firstGroup(U64 hash) const
+    {
+        return size_t(hash >> 7) & (mCapacity / LLUUIDHashMapPrivate::GROUP_WIDTH - 1);
+    }
+
+    size_t findSlot(const LLUUID& key) const
+    {
+        return findSlot(key, key.getHash64());
+    }
+
+    // Groups are probed in triangular steps, which visits each of them once
+    // when their number is a power of 2. A group with an empty slot ends the
+    // probe: key would have gone in there.
+    size_t findSlot(const LLUUID& key, U64 hash) const
+    {
+        using namespace LLUUIDHashMapPrivate;
+        if (!mCapacity)
+        {
+            return NOT_FOUND;
+        }
+        const size_t group_mask = mCapacity / GROUP_WIDTH - 1;
+        size_t group = firstGroup(hash);
+        for (size_t step = 1; ; ++step)
+        {
+            const size_t base = group * GROUP_WIDTH;
+            Group ctrl(mCtrl + base);
+            for (U32 match = ctrl.match(h2(hash)); match; match &= match - 1)
+            {
+                const size_t slot = base + std::countr_zero(match);
+                if (mSlots[slot].first == key)
+                {
+                    return slot;
+                }
+            }
+            if (ctrl.matchEmpty() || step > group_mask)
+            {
+                return NOT_FOUND;
+            }
+            group = (group + step) & group_mask;
+        }
+    }
+
+    // The first empty or deleted slot on the probe sequence for hash. There
+    // is always one: the table never fills up.
+    size_t findFree(U64 hash) const
+    {
+        using namespace LLUUIDHashMapPrivate;
+        const size_t group_mask = mCapacity / GROUP_WIDTH - 1;
+        size_t group = firstGroup(hash);
+        for (size_t step = 1; ; ++step)
+        {
+            U32 free = Group(mCtrl + group * GROUP_WIDTH).matchEmptyOrDeleted();
+            if (free)
+            {
+                return group * GROUP_WIDTH + std::countr_zero(free);
+            }
+            group = (group + step) & group_mask;
+        }
+    }
+
+    template <typename... ARGS>
+    size_t insertSlot(U64 hash, ARGS&&... args)
+    {
+        size_t slot = mCapacity ? findFree(hash) : 0;
+        // reusing a deleted slot doesn't use up an empty one
+        if (!mCapacity || (!mGrowthLeft && mCtrl[slot] == LLUUIDHashMapPrivate::EMPTY))
+        {
+            rehash(mSize + 1);
+            slot = findFree(hash);
+        }
+        ::new (static_cast<void*>(mSlots + slot)) value_type(std::forward<ARGS>(args)...);
+        if (mCtrl[slot] == LLUUIDHashMapPrivate::EMPTY)
+        {
+            --mGrowthLeft;
+        }
+        mCtrl[slot] = h2(hash);
+        ++mSize;
+        return slot;
+    }
+
+    template <typename... ARGS>
+    void insertUnique(const LLUUID& key, ARGS&&... args)
+    {
+        insertSlot(key.getHash64(), std::piecewise_construct, std::forward_as_tuple(key),
+                   std::forward_as_tuple(std::forward<ARGS>(args)...));
+    }
+
+    // A slot whose group has an empty one can be emptied again: no probe
+    // went on past that group. Otherwise it has to stay DELETED.
+    void eraseSlot(size_t slot)
+    {
+        using namespace LLUUIDHashMapPrivate;
+        mSlots[slot].~value_type();
+        --mSize;
+        if (Group(mCtrl + (slot & ~(GROUP_WIDTH - 1))).matchEmpty())
+        {
+            mCtrl[slot] = EMPTY;
+            ++mGrowthLeft;
+        }
+        else
+        {
+            mCtrl[slot] = DELETED;
+        }
+    }
+
+    // Moves every value to a new table with room for count of them, which
+    // also drops the DELETED slots
+    void rehash(size_t count)
+    {
+        using namespace LLUUIDHashMapPrivate;
+        size_t capacity = GROUP_WIDTH;
+        while (maxLoad(capacity) < count)
+        {
+            capacity *= 2;
+        }
+
+        S8* old_ctrl = mCtrl;
+        value_type* old_slots = mSlots;
+        const size_t old_capacity = mCapacity;
+
+        // the control bytes are followed by a group holding the sentinel
+        mCtrl = static_cast<S8*>(::operator new(capacity + GROUP_WIDTH,
+                                                std::align_val_t(GROUP_WIDTH)));
+        mSlots = std::allocator<value_type>().allocate(capacity);
+        mCapacity = capacity;
+        resetCtrl();
+        mGrowthLeft = maxLoad(capacity) - mSize;
+
+        for (size_t slot = 0; slot < old_capacity; ++slot)
+        {
+            if (old_ctrl[slot] >= 0)
+            {
+                value_type& value = old_slots[slot];
+                const U64 hash = value.first.getHash64();
+                const size_t to = findFree(hash);
+                ::new (static_cast<void*>(mSlots + to))
+                    value_type(std::piecewise_construct, std::forward_as_tuple(value.first),
+                               std::forward_as_tuple(std::move(value.second)));
+                mCtrl[to] = h2(hash);
+                value.~value_type();
+            }
+        }
+        deallocate(old_ctrl, old_slots, old_capacity);
+    }
+
+    void resetCtrl()
+    {
+        using namespace LLUUIDHashMapPrivate;
+        std::fill_n(mCtrl, mCapacity + GROUP_WIDTH, EMPTY);
+        mCtrl[mCapacity] = SENTINEL;
+    }
+
+    void destroyAll()
+    {
+        if constexpr (! std::is_trivially_destructible_v<value_type>)
+        {
+            for (size_t slot = 0; slot < mCapacity; ++slot)
+            {
+                if (mCtrl[slot] >= 0)
+                {
+                    mSlots[slot].~value_type();
+                }
+            }
+        }
+    }
+
+    void deallocate()
+    {
+        deallocate(mCtrl, mSlots, mCapacity);
+        mCtrl = const_cast<S8*>(LLUUIDHashMapPrivate::sEmptyGroup);
+        mSlots = nullptr;
+        mCapacity = 0;
+    }
+
+    static void deallocate(S8* ctrl, value_type* slots, size_t capacity)
+    {
+        if (capacity)
+        {
+            ::operator delete(ctrl, std::align_val_t(LLUUIDHashMapPrivate::GROUP_WIDTH));
+            std::allocator<value_type>().deallocate(slots, capacity);
+        }
+    }
+
+    // never written while mCapacity is 0
+    S8*         mCtrl{ const_cast<S8*>(LLUUIDHashMapPrivate::sEmptyGroup) };
+    value_type* mSlots{ nullptr };
+    size_t      mCapacity{ 0 };
+    size_t      mSize{ 0 };
+    // EMPTY slots that may still be filled before the table grows
+    size_t      mGrowthLeft{ 0 };
+};
+
+/**
+ * The viewer's hottest UUID-keyed maps (the object list, the inventory model
+ * and the avatar name cache) are lluuid_hot_map<T>: an LLUUIDHashMap<T> when
+ * the build sets the LL_UUID_HASH_MAP CMake option, else std::map<LLUUID, T>.
+ * Code using a lluuid_hot_map must not depend on key order, nor hold a
+ * reference to a value across an insert.
+ */
+template <typename T>
+#ifdef LL_UUID_HASH_MAP
+using lluuid_hot_map = LLUUIDHashMap<T>;
+#else
+using lluuid_hot_map = std::map<LLUUID, T>;
+#endif
+
+#endif /* ! defined(LL_LLUUIDHASHMAP_H) */
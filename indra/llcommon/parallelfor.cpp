@@ -0,0 +1,123 @@
+/**
+ * @file   parallelfor.cpp
+ * @brief  Implementation for parallelfor.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "parallelfor.h"
+// STL headers
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+// std headers
+// external library headers
+// other Linden headers
+#include "workqueue.h"
+
+namespace
+{
+    // Shared with the helpers, which may only get to run after we are done.
+    // By then every index has been claimed, so they never touch mFunction.
+    struct Batch
+    {
+        std::function<void(size_t)> mFunction;
+        size_t mCount;
+        std::atomic<size_t> mNext{ 0 };
+        std::atomic<size_t> mDone{ 0 };
+        std::atomic<bool> mFailed{ false };
+        std::mutex mMutex;
+        std::exception_ptr mException;
+
+        void run()
+        {
+            for (size_t i = mNext++; i < mCount; i = mNext++)
+            {
+                if (! mFailed)
+                {
+                    try
+                    {
+                        mFunction(i);
+                    }
+                    catch (...)
+                    {
+                        std::lock_guard<std::mutex> lock(mMutex);
+                        if (! mException)
+                        {
+                            mException = std::current_exception();
+                        }
+                        mFailed = true;
+                    }
+                }
+                // skipped indices count too, or the caller would wait forever
+                mDone++;
+            }
+        }
+    };
+} // anonymous namespace
+
+void LL::parallel_for(const std::string& queue_name, size_t count,
+                      const std::function<void(size_t)>& fn)
+{
+    if (! count)
+    {
+        return;
+    }
+
+    auto batch = std::make_shared<Batch>();
+    batch->mFunction = fn;
+    batch->mCount = count;
+
+    WorkQueue::ptr_t queue = queue_name.empty() ? WorkQueue::ptr_t() : WorkQueue::getInstance(queue_name);
+    if (queue && count > 1)
+    {
+        // Each helper takes the next index until there are none left, more
+        // helpers than indices or than cores would only spin
+        const size_t threads = llmax(1u, std::thread::hardware_concurrency());
+        const size_t helpers = llmin(count - 1, threads - 1);
+        for (size_t i = 0; i < helpers; i++)
+        {
+            if (! queue->post([batch]() { batch->run(); }))
+            {
+                break;
+            }
+        }
+    }
+
+    batch->run();
+
+    // The rest are being finished by the helpers
+    while (batch->mDone.load() < count)
+    {
+        std::this_thread::yield();
+    }
+
+    if (batch->mException)
+    {
+        std::rethrow_exception(batch->mException);
+    }
+}
@@ -0,0 +1,52 @@
+/**
+ * @file   parallelfor.h
+ * @brief  LL::parallel_for(): split a loop over the threads of a WorkQueue
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#if ! defined(LL_PARALLELFOR_H)
+#define LL_PARALLELFOR_H
+
+#include <functional>
+#include <string>
+
+namespace LL
+{
+    /**
+     * Call fn(i) for every i in [0, count) and return when all the calls are
+     * done. The threads servicing the WorkQueue named queue_name are asked
+     * to help, and the calling thread takes its share, so even if no helper
+     * gets to run (the queue is busy, closed or missing) every index is still
+     * visited. Pass an empty queue_name to run the loop on the calling thread
+     * alone. Each index is claimed by exactly one thread, in no particular
+     * order, so fn may write to per-index state without locking.
+     *
+     * If fn throws, the indices nobody has claimed yet are skipped and the
+     * first exception is rethrown here once the calls in progress on other
+     * threads have returned.
+     */
+    void parallel_for(const std::string& queue_name, size_t count,
+                      const std::function<void(size_t)>& fn);
+} // namespace LL
+
+#endif /* ! defined(LL_PARALLELFOR_H) */
@@ -0,0 +1,370 @@
+/**
+ * @file   asynctask_test.cpp
+ * @brief  Test for asynctask.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "asynctask.h"
+// STL headers
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+// std headers
+// external library headers
+// other Linden headers
+#include "../test/lltut.h"
+#include "../test/benchmark.h"
+#include "../test/catch_and_store_what_in.h"
+#include "lleventcoro.h"
+#include "lleventtimer.h"
+#include "stringize.h"
+
+using namespace LL;
+using namespace std::literals::chrono_literals; // ms suffix
+using namespace std::literals::string_literals; // s suffix
+
+namespace
+{
+    // Run body on a coroutine, servicing this thread's other coroutines
+    // until it returns or runs out of time. Tasks can't be waited for on the
+    // main coroutine.
+    template <typename BODY>
+    void on_coroutine(const std::string& name, BODY body,
+                      const std::function<void()>& service = {},
+                      std::chrono::seconds limit = 10s)
+    {
+        bool done = false;
+        std::exception_ptr exc;
+        LLCoros::instance().launch(
+            name,
+            [&]()
+            {
+                try
+                {
+                    body();
+                }
+                catch (...)
+                {
+                    exc = std::current_exception();
+                }
+                done = true;
+            });
+        const auto timeout = std::chrono::steady_clock::now() + limit;
+        while (! done)
+        {
+            if (service)
+            {
+                service();
+            }
+            llcoro::suspend();
+            if (std::chrono::steady_clock::now() > timeout)
+            {
+                LLTHROW(LLException(name + " timed out"));
+            }
+        }
+        if (exc)
+        {
+            std::rethrow_exception(exc);
+        }
+    }
+
+    // a WorkQueue serviced by a thread of its own, as a ThreadPool would
+    struct Worker
+    {
+        Worker(const std::string& name):
+            mQueue(std::make_shared<WorkQueue>(name)),
+            mThread([queue = mQueue](){ queue->runUntilClose(); })
+        {}
+        ~Worker()
+        {
+            mQueue->close();
+            mThread.join();
+        }
+        WorkQueueBase::weak_t getWeak() const { return mQueue; }
+
+        std::shared_ptr<WorkQueue> mQueue;
+        std::thread mThread;
+    };
+}
+
+/*****************************************************************************
+*   TUT
+*****************************************************************************/
+namespace tut
+{
+    struct asynctask_data
+    {
+        std::shared_ptr<WorkQueue> queue{ std::make_shared<WorkQueue>("asynctask") };
+
+        asynctask_data()
+        {
+            // cache this as the main thread
+            on_main_thread();
+            // Other threads reach LLCoros: construct it here rather than
+            // have the first of them ask the main thread to do so.
+            LLCoros::instance();
+        }
+    };
+    typedef test_group<asynctask_data> asynctask_group;
+    typedef asynctask_group::object object;
+    asynctask_group asynctaskgrp("asynctask");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("async");
+        std::string stored;
+        bool failed = false;
+        on_coroutine(
+            "async",
+            [this, &stored, &failed]()
+            {
+                Task<std::string> string_task{ async(queue, [](){ return "string result"s; }) };
+                Task<void> void_task{ async("asynctask", [&stored](){ stored += ";void"; }) };
+                Task<int> throwing{ async(queue, []()->int{ LLTHROW(LLException("oops")); }) };
+                stored = string_task.get();
+                void_task.get();
+                failed = ! catch_what<LLException>([&throwing](){ throwing.get(); }).empty();
+                ensure("get() leaves the task invalid", ! string_task.valid());
+            },
+            // These all run on this thread, so nothing has run until we
+            // service the queue.
+            [](){ WorkQueue::getInstance("asynctask")->runPending(); });
+        ensure_equals("string and void", stored, "string result;void");
+        ensure("exception", failed);
+
+        // Tasks that are ready don't need a coroutine to get() them
+        queue->close();
+        Task<int> closed{ async(queue, [](){ return 1; }) };
+        ensure("ready", closed.ready());
+        ensure_not("closed", catch_what<WorkQueueBase::Closed>([&closed](){ closed.get(); }).empty());
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("waiting on the main coroutine");
+        Task<int> task{ async(queue, [](){ return 2; }) };
+        auto what{ catch_what<WorkQueueBase::Error>([&task](){ task.get(); }) };
+        ensure(STRINGIZE("should forbid waiting: " << what),
+               what.find("main coroutine") != std::string::npos);
+        queue->runOne();
+        ensure_equals("once it's ready", task.get(), 2);
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("cancel");
+        CancelSource source;
+        bool ran = false;
+        Task<void> early{ async(queue, [&ran](){ ran = true; }, source.getToken()) };
+        source.cancel();
+        ensure("cancelled at once", early.ready());
+        queue->runPending();
+        ensure("work cancelled before it started ran", ! ran);
+        ensure_not("TaskCancelled", catch_what<TaskCancelled>([&early](){ early.get(); }).empty());
+        ensure("already cancelled", async(queue, [](){ return 0; }, source.getToken()).ready());
+        queue->runPending();
+
+        // cancelling wakes a coroutine waiting for the task, without waiting
+        // for the work
+        CancelSource waiting;
+        std::string what;
+        on_coroutine(
+            "cancel",
+            [this, &waiting, &what]()
+            {
+                Task<int> task{ async(queue, [](){ return 3; }, waiting.getToken()) };
+                what = catch_what<TaskCancelled>([&task](){ task.get(); });
+            },
+            [&waiting](){ waiting.cancel(); });
+        ensure_equals("woke", what, "task cancelled");
+        ensure("work left to run", queue->size() == 1);
+        queue->runPending();
+
+        // work that takes a token can check it as it goes
+        CancelSource polled;
+        size_t steps = 0;
+        Task<size_t> task{ async(
+                queue,
+                [&steps, &polled](const CancelToken& token)
+                {
+                    for ( ; ! token.cancelled(); ++steps)
+                    {
+                        if (steps == 5)
+                        {
+                            polled.cancel();
+                        }
+                    }
+                    return steps;
+                },
+                polled.getToken()) };
+        queue->runOne();
+        ensure_equals("polled", steps, size_t(6));
+        ensure_not("cancelled while running", catch_what<TaskCancelled>([&task](){ task.get(); }).empty());
+
+        // a task that completes takes its callback back from the token
+        CancelSource lasting;
+        S32 called = 0;
+        ensure("never cancelled", ! CancelToken().onCancel([&called](){ ++called; }));
+        for (S32 i = 0; i < 100; ++i)
+        {
+            async(queue, [](){ return 0; }, lasting.getToken());
+        }
+        queue->runPending();
+        U64 id = lasting.getToken().onCancel([&called](){ ++called; });
+        lasting.cancel();
+        lasting.cancel();
+        ensure_equals("callbacks", called, 1);
+        ensure("ids", id > 100);
+    }
+
+    template<> template<>
+    void object::test<4>()
+    {
+        set_test_name("when_all and when_any on another thread");
+        Worker worker("asynctask worker");
+        std::vector<int> squares;
+        size_t first = 99;
+        bool slow_cancelled = false;
+        on_coroutine(
+            "when_all",
+            [&]()
+            {
+                std::vector<Task<int>> tasks;
+                for (int i = 0; i < 50; ++i)
+                {
+                    tasks.push_back(async(worker.getWeak(), [i](){ return i * i; }));
+                }
+                squares = when_all(tasks);
+
+                CancelSource rest;
+                std::vector<Task<std::string>> race;
+                race.push_back(async(worker.getWeak(),
+                                     [](const CancelToken& token)
+                                     {
+                                         // runs first, but finishes last
+                                         for (S32 i = 0; i < 500 && ! token.cancelled(); ++i)
+                                         {
+                                             std::this_thread::sleep_for(1ms);
+                                         }
+                                         return "slow"s;
+                                     },
+                                     rest.getToken()));
+                // posted to a queue nothing services, so it's cancelled
+                race.push_back(async(queue, [](){ return "never"s; }, rest.getToken()));
+                race.push_back(asyncMain([](){ return "main"s; }, rest.getToken()));
+                first = when_any(race, rest);
+                ensure_equals("winner", race[first].get(), "main");
+                slow_cancelled = ! catch_what<TaskCancelled>([&race](){ race[0].get(); }).empty();
+            });
+        ensure_equals("count", squares.size(), size_t(50));
+        for (int i = 0; i < 50; ++i)
+        {
+            ensure_equals("square", squares[i], i * i);
+        }
+        ensure_equals("first", first, size_t(2));
+        ensure("rest cancelled", slow_cancelled);
+    }
+
+    template<> template<>
+    void object::test<5>()
+    {
+        set_test_name("asyncMain from another thread");
+        bool on_main = false;
+        bool done = false;
+        std::thread thread(
+            [&on_main, &done]()
+            {
+                // a plain thread waits for the task on its only coroutine
+                on_main = asyncMain([](){ return on_main_thread(); }).get();
+                done = true;
+            });
+        const auto timeout = std::chrono::steady_clock::now() + 10s;
+        while (! done && std::chrono::steady_clock::now() < timeout)
+        {
+            LLEventTimer::updateClass();
+            std::this_thread::sleep_for(1ms);
+        }
+        thread.join();
+        ensure("ran on the main thread", on_main);
+    }
+
+    template<> template<>
+    void object::test<6>()
+    {
+        set_test_name("thread hop latency");
+        Benchmark bench("main coroutine -> worker thread -> main coroutine, us per hop");
+        Worker worker("asynctask hops");
+        const S32 HOPS = Benchmark::size(1024, 64), BATCH = 64;
+        F64 wait_us = 0, task_us = 0, batch_us = 0;
+        on_coroutine(
+            "hops",
+            [&]()
+            {
+                S32 sum = 0;
+                Benchmark timer;
+                for (S32 i = 0; i < HOPS; ++i)
+                {
+                    sum += worker.mQueue->waitForResult([i](){ return i & 1; });
+                }
+                wait_us = timer.elapsed_us() / HOPS;
+
+                timer.start();
+                for (S32 i = 0; i < HOPS; ++i)
+                {
+                    sum += async(worker.getWeak(), [i](){ return i & 1; }).get();
+                }
+                task_us = timer.elapsed_us() / HOPS;
+
+                // post a batch before waiting for any of it
+                timer.start();
+                for (S32 i = 0; i < HOPS; i += BATCH)
+                {
+                    std::vector<Task<int>> tasks;
+                    for (S32 j = i; j < i + BATCH; ++j)
+                    {
+                        tasks.push_back(async(worker.getWeak(), [j](){ return j & 1; }));
+                    }
+                    for (int result : when_all(tasks))
+                    {
+                        sum += result;
+                    }
+                }
+                batch_us = timer.elapsed_us() / HOPS;
+                ensure_equals("sum", sum, 3 * HOPS / 2);
+            },
+            {},
+            Benchmark::size(120s, 10s));
+        bench.report("waitForResult()           ", wait_us);
+        bench.report("async().get()             ", task_us);
+        bench.report(BATCH, " async(), when_all()   ", batch_us);
+    }
+} // namespace tut
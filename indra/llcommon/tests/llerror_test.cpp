@@ -25,17 +25,23 @@
  * $/LicenseInfo$
  */
 
+#include <atomic>
+#include <sstream>
 #include <vector>
 #include <stdexcept>
+#include <thread>
 
 #include "linden_common.h"
 
 #include "../llerror.h"
 
 #include "../llerrorcontrol.h"
+#include "../llfile.h"
 #include "../llsd.h"
+#include "../stringize.h"
 
 #include "../test/lltut.h"
+#include "../test/benchmark.h"
 
 enum LogFieldIndex
 {
@@ -918,6 +924,180 @@ namespace tut
     }
 }
 
+namespace
+{
+    // Async logging for the length of a test
+    struct AsyncLogging
+    {
+        AsyncLogging(size_t queue_size = 256 * 1024) { LLError::setAsyncLogging(true, queue_size); }
+        ~AsyncLogging() { LLError::setAsyncLogging(false); }
+    };
+
+    void writeNumbered(int thread, int count)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            LL_INFOS("Async") << thread << " " << i << LL_ENDL;
+        }
+    }
+}
+
+namespace tut
+{
+    template<> template<>
+    void ErrorTestObject::test<19>()
+        // queued messages of several threads all get to the recorders, in
+        // the order each thread logged them
+    {
+        AsyncLogging async;
+        ensure("async", LLError::getAsyncLogging());
+
+        const int threads = 4;
+        const int count = 500;
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++)
+        {
+            workers.emplace_back(writeNumbered, t, count);
+        }
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+        LLError::flushAsyncLogging();
+
+        ensure_message_count(threads * count);
+        ensure_message_field_equals(0, LEVEL_FIELD, "INFO");
+        ensure_message_field_equals(0, TAGS_FIELD, "#Async#");
+        std::vector<int> next(threads, 0);
+        for (int n = 0; n < threads * count; n++)
+        {
+            std::istringstream in(message_field(n, MSG_FIELD));
+            int thread = -1, i = -1;
+            in >> thread >> i;
+            ensure("thread", thread >= 0 && thread < threads);
+            ensure_equals("in order", i, next[thread]++);
+        }
+    }
+
+    template<> template<>
+    void ErrorTestObject::test<20>()
+        // a recorder that is stuck doesn't hold up the logging thread, what
+        // doesn't fit is dropped and counted, and errors are written right
+        // away after what was queued before them
+    {
+        std::atomic<bool> blocked(true);
+        std::atomic<bool> entered(false);
+        LLError::RecorderPtr stuck = LLError::addGenericRecorder(
+            [&blocked, &entered](LLError::ELevel, const std::string&)
+            {
+                entered = true;
+                while (blocked)
+                {
+                    std::this_thread::yield();
+                }
+            });
+
+        {
+            AsyncLogging async(4096);
+            const U64 dropped_before = LLError::getDroppedLogCount();
+            LL_INFOS() << "first" << LL_ENDL;
+            while (!entered)
+            {
+                std::this_thread::yield();
+            }
+
+            const int count = 1000;
+            writeNumbered(0, count);
+            const U64 dropped = LLError::getDroppedLogCount() - dropped_before;
+            ensure("dropped", dropped > 0 && dropped < (U64)count);
+
+            blocked = false;
+            LLError::flushAsyncLogging();
+            const int kept = count - (int)dropped;
+            ensure_message_count(kept + 2);
+            ensure_message_field_equals(0, MSG_FIELD, "first");
+            ensure_message_field_equals(kept + 1, LEVEL_FIELD, "WARNING");
+            ensure_contains("reported", message(kept + 1), STRINGIZE(dropped << " log messages dropped"));
+
+            clearMessages();
+            LL_INFOS() << "before the error" << LL_ENDL;
+            CATCH(LL_ERRS(), "the error");
+            ensure("fatal callback called", fatalWasCalled);
+            ensure_message_count(2);
+            ensure_message_field_equals(0, MSG_FIELD, "before the error");
+            ensure_message_field_equals(1, MSG_FIELD, "the error");
+        }
+        LLError::removeRecorder(stuck);
+    }
+
+    template<> template<>
+    void ErrorTestObject::test<21>()
+        // a crash writes out what was queued and stops queueing
+    {
+        AsyncLogging async;
+        writeNumbered(0, 10);
+        LLError::crashFlushLogging();
+        ensure("stopped queueing", !LLError::getAsyncLogging());
+        ensure_message_count(10);
+        ensure_message_field_equals(9, MSG_FIELD, "0 9");
+
+        LL_INFOS() << "after the crash" << LL_ENDL;
+        ensure_message_count(11);
+    }
+
+    template<> template<>
+    void ErrorTestObject::test<22>()
+        // several threads logging to a file, written by each of them and
+        // queued for the writer thread, lose nothing that isn't counted
+    {
+        const std::string filename = STRINGIZE(LLFile::tmpdir() << "llerror_test_async.log");
+        LLError::logToFile(filename);
+
+        const int threads = 4;
+        const int count = Benchmark::size(20000, 500);
+        Benchmark bench(STRINGIZE("Logging, " << threads << " threads x " << count << " messages to a file"));
+        auto run = [&]()
+            {
+                clearMessages();
+                std::vector<std::thread> workers;
+                bench.start();
+                for (int t = 0; t < threads; t++)
+                {
+                    workers.emplace_back(writeNumbered, t, count);
+                }
+                for (std::thread& worker : workers)
+                {
+                    worker.join();
+                }
+                return bench.elapsed_ms();
+            };
+
+        const F64 sync_ms = run();
+        const int sync_written = countMessages();
+
+        F64 async_ms, written_ms;
+        U64 dropped = LLError::getDroppedLogCount();
+        {
+            AsyncLogging async;
+            async_ms = run();
+            bench.start();
+            LLError::flushAsyncLogging();
+            written_ms = async_ms + bench.elapsed_ms();
+        }
+        dropped = LLError::getDroppedLogCount() - dropped;
+        ensure("all accounted for", countMessages() + (int)dropped >= threads * count);
+
+        LLError::logToFile("");
+        LLFile::remove(filename);
+
+        const F64 total = threads * count;
+        bench.report("synchronous ", sync_ms, " ms (", total / sync_ms, " k/s, ",
+                     threads * count - sync_written, " lost to the log lock)");
+        bench.report("async       ", async_ms, " ms on the logging threads (", total / async_ms,
+                     " k/s), ", written_ms, " ms until written, ", dropped, " dropped");
+    }
+}
+
 /* Tests left:
     handling of classes without LOG_CLASS
 
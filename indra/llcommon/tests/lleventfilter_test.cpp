@@ -26,6 +26,8 @@
  * $/LicenseInfo$
  */
 
+// for llsd::allocationCount()
+#define LLSD_DEBUG_INFO
 // Precompiled header
 #include "linden_common.h"
 // associated header
@@ -476,6 +478,39 @@ namespace tut
         set_test_name("LLEventLogProxyFor<LLEventMailDrop>");
         tut::test< LLEventLogProxyFor<LLEventMailDrop> >();
     }
+
+    template<> template<>
+    void filter_object::test<8>()
+    {
+        set_test_name("batches take posted events");
+        LLEventBatch batch(3);
+        LLSD received;
+        LLTempBoundListener conn(
+            batch.listen("batch", [&received](const LLSD& event)
+                         {
+                             received = event;
+                             return false;
+                         }));
+        for (LLSD::Integer i = 0; i < 4; ++i)
+        {
+            LLSD event(llsd::map("i", i));
+            batch.post(std::move(event));
+        }
+        ensure_equals("batch", received, llsd::array(llsd::map("i", 0), llsd::map("i", 1),
+                                                     llsd::map("i", 2)));
+
+        // Only the first post() passes right through, the rest wait for the
+        // interval. Each appends to the pending batch in place: it used to
+        // be copied, and a copy sharing its array clones it to append.
+        LLEventBatchThrottle throttle(60.f);
+        U32 allocations = llsd::allocationCount();
+        for (LLSD::Integer i = 0; i < 1000; ++i)
+        {
+            throttle.post(i);
+        }
+        ensure_equals("pending", throttle.pending().size(), 999u);
+        ensure("pending batch not cloned", llsd::allocationCount() - allocations < 10);
+    }
 } // namespace tut
 
 /*****************************************************************************
@@ -0,0 +1,470 @@
+/**
+ * @file   llshardedinstancetracker_test.cpp
+ * @brief  Test for llshardedinstancetracker.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "llshardedinstancetracker.h"
+// STL headers
+#include <atomic>
+#include <memory>
+#include <new>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+// std headers
+// other Linden headers
+#include "llinstancetrackersubclass.h"
+#include "stringize.h"
+#include "../test/lltut.h"
+#include "../test/benchmark.h"
+
+namespace
+{
+    struct Badness: public std::runtime_error
+    {
+        Badness(const std::string& what): std::runtime_error(what) {}
+    };
+
+    struct Keyed: public LLShardedInstanceTracker<Keyed, std::string>
+    {
+        Keyed(const std::string& name):
+            LLShardedInstanceTracker<Keyed, std::string>(name),
+            mName(name)
+        {}
+        std::string mName;
+    };
+
+    struct Unkeyed: public LLShardedInstanceTracker<Unkeyed>
+    {
+        Unkeyed(const std::string& thrw="")
+        {
+            if (! thrw.empty())
+            {
+                throw Badness(thrw);
+            }
+        }
+    };
+
+    struct Replaced: public LLShardedInstanceTracker<Replaced, S32, LLInstanceTrackerReplaceOnCollision>
+    {
+        using super = LLShardedInstanceTracker<Replaced, S32, LLInstanceTrackerReplaceOnCollision>;
+        Replaced(S32 key): super(key) {}
+        using super::setKey;
+    };
+
+    struct Base: public LLShardedInstanceTracker<Base, std::string>
+    {
+        Base(const std::string& name): LLShardedInstanceTracker<Base, std::string>(name) {}
+    };
+
+    struct Derived: public LLInstanceTrackerSubclass<Derived, Base>
+    {
+        Derived(const std::string& name): LLInstanceTrackerSubclass<Derived, Base>(name) {}
+    };
+
+    struct Churned: public LLShardedInstanceTracker<Churned, S32>
+    {
+        Churned(S32 key): LLShardedInstanceTracker<Churned, S32>(key), mKey(key) {}
+        const S32 mKey;
+    };
+
+    // Constructed before its thread's first guard, so destroyed after the
+    // tracker's own per thread state, and it still creates, looks up and
+    // destroys instances then
+    std::atomic<S32> sLateErrors{ 0 };
+
+    struct LateTracked
+    {
+        ~LateTracked()
+        {
+            for (const auto& instance : mInstances)
+            {
+                Churned neighbour(instance->mKey + 1);
+                if (Churned::getInstance(instance->mKey).get() != instance.get())
+                {
+                    sLateErrors++;
+                }
+            }
+            mInstances.clear();
+        }
+
+        std::vector<std::unique_ptr<Churned>> mInstances;
+    };
+
+    LateTracked& lateTracked()
+    {
+        static thread_local LateTracked sLate;
+        return sLate;
+    }
+
+    // The two trackers under the same load
+    struct LegacyBench: public LLInstanceTracker<LegacyBench, std::string>
+    {
+        LegacyBench(const std::string& name): LLInstanceTracker<LegacyBench, std::string>(name) {}
+    };
+
+    struct ShardedBench: public LLShardedInstanceTracker<ShardedBench, std::string>
+    {
+        ShardedBench(const std::string& name): LLShardedInstanceTracker<ShardedBench, std::string>(name) {}
+    };
+
+    // Each thread creates and destroys instances with keys of its own and
+    // looks up instances that live throughout. Returns operations per
+    // microsecond, all threads together.
+    template <typename INSTANCE>
+    F64 contend(S32 num_threads)
+    {
+        const S32 ITERATIONS = Benchmark::size(20000, 500);
+        const S32 LOOKUPS = 8;
+        const S32 SHARED = 64;
+        std::vector<std::unique_ptr<INSTANCE>> shared;
+        std::vector<std::string> shared_keys;
+        for (S32 i = 0; i < SHARED; i++)
+        {
+            shared_keys.push_back(stringize("shared", i));
+            shared.emplace_back(new INSTANCE(shared_keys.back()));
+        }
+
+        std::atomic<S32> ready{ 0 };
+        std::atomic<S32> found{ 0 };
+        std::vector<std::thread> threads;
+        Benchmark timer;
+        for (S32 t = 0; t < num_threads; t++)
+        {
+            threads.emplace_back([&, t]()
+            {
+                std::vector<std::string> keys;
+                for (S32 i = 0; i < ITERATIONS; i++)
+                {
+                    keys.push_back(stringize("thread", t, "-", i));
+                }
+                ready++;
+                while (ready < num_threads)
+                {
+                    std::this_thread::yield();
+                }
+                S32 hits = 0;
+                for (S32 i = 0; i < ITERATIONS; i++)
+                {
+                    INSTANCE instance(keys[i]);
+                    for (S32 j = 0; j < LOOKUPS; j++)
+                    {
+                        hits += bool(INSTANCE::getInstance(shared_keys[(i * LOOKUPS + j) % SHARED]));
+                    }
+                }
+                found += hits;
+            });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+        const F64 ms = timer.elapsed_ms();
+        tut::ensure_equals("every lookup found", found.load(), num_threads * ITERATIONS * LOOKUPS);
+        return num_threads * ITERATIONS * (LOOKUPS + 2) / (ms * 1000.0);
+    }
+}
+
+/*****************************************************************************
+*   TUT
+*****************************************************************************/
+namespace tut
+{
+    struct llshardedinstancetracker_data
+    {
+        ~llshardedinstancetracker_data()
+        {
+            LLInstanceTrackerPrivate::reclaim();
+        }
+    };
+    typedef test_group<llshardedinstancetracker_data> llshardedinstancetracker_group;
+    typedef llshardedinstancetracker_group::object object;
+    llshardedinstancetracker_group llshardedinstancetrackergrp("llshardedinstancetracker");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("keyed instances");
+        ensure_equals(Keyed::instanceCount(), size_t(0));
+        {
+            Keyed one("one");
+            ensure_equals(Keyed::instanceCount(), size_t(1));
+            auto found = Keyed::getInstance("one");
+            ensure("couldn't find stack Keyed", bool(found));
+            ensure_equals("found wrong Keyed instance", found.get(), &one);
+            {
+                std::unique_ptr<Keyed> two(new Keyed("two"));
+                ensure_equals(Keyed::instanceCount(), size_t(2));
+                auto found = Keyed::getInstance("two");
+                ensure("couldn't find heap Keyed", bool(found));
+                ensure_equals("found wrong Keyed instance", found.get(), two.get());
+            }
+            ensure_equals(Keyed::instanceCount(), size_t(1));
+            ensure("destroyed Keyed still found", ! Keyed::getInstance("two"));
+        }
+        ensure("Keyed key lives too long", ! Keyed::getInstance("one"));
+        ensure_equals(Keyed::instanceCount(), size_t(0));
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("unkeyed instances");
+        ensure_equals(Unkeyed::instanceCount(), size_t(0));
+        std::weak_ptr<Unkeyed> dangling;
+        {
+            Unkeyed one;
+            ensure_equals(Unkeyed::instanceCount(), size_t(1));
+            std::weak_ptr<Unkeyed> found = one.getWeak();
+            ensure(! found.expired());
+            {
+                std::unique_ptr<Unkeyed> two(new Unkeyed);
+                ensure_equals(Unkeyed::instanceCount(), size_t(2));
+                std::set<Unkeyed*> instances;
+                for (auto& instance : Unkeyed::instance_snapshot())
+                {
+                    instances.insert(&instance);
+                }
+                ensure("unkeyed snapshot", instances == std::set<Unkeyed*>{ &one, two.get() });
+            }
+            ensure_equals(Unkeyed::instanceCount(), size_t(1));
+            dangling = found;
+        }
+        ensure("Unkeyed weak_ptr lives too long", dangling.expired());
+        ensure_equals(Unkeyed::instanceCount(), size_t(0));
+
+        // a constructor that throws leaves nothing behind
+        try
+        {
+            Unkeyed thrower("throw");
+            fail("Unkeyed didn't throw");
+        }
+        catch (const Badness&)
+        {
+        }
+        ensure_equals(Unkeyed::instanceCount(), size_t(0));
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("replace on collision, setKey");
+        Replaced first(1);
+        {
+            Replaced second(1);
+            ensure_equals("newest instance wins", Replaced::getInstance(1).get(), &second);
+            ensure_equals("replaced, not added", Replaced::instanceCount(), size_t(1));
+        }
+        ensure("replacement gone", ! Replaced::getInstance(1));
+
+        first.setKey(2);
+        ensure("old key dropped", ! Replaced::getInstance(1));
+        ensure_equals("new key", Replaced::getInstance(2).get(), &first);
+        ensure_equals("getKey", first.getKey(), 2);
+        {
+            Replaced other(3);
+            other.setKey(2);
+            ensure_equals("setKey replaces too", Replaced::getInstance(2).get(), &other);
+        }
+        ensure_equals("replaced instances aren't tracked", Replaced::instanceCount(), size_t(0));
+    }
+
+    template<> template<>
+    void object::test<4>()
+    {
+        set_test_name("snapshots");
+        // enough instances to grow the tables several times
+        const S32 COUNT = 2000;
+        std::set<std::string> expected;
+        for (S32 i = 0; i < COUNT; i++)
+        {
+            expected.insert(stringize("k", i));
+            new Keyed(stringize("k", i));
+        }
+        ensure_equals(Keyed::instanceCount(), size_t(COUNT));
+
+        std::set<std::string> keys;
+        for (const std::string& key : Keyed::key_snapshot())
+        {
+            keys.insert(key);
+        }
+        ensure("key snapshot", keys == expected);
+
+        // destroy instances ahead of and behind the traversal
+        S32 visited = 0;
+        for (const auto& pair : Keyed::snapshot())
+        {
+            ensure_equals("pair key", pair.first, pair.second->mName);
+            const std::string other = "k" + pair.first.substr(1) + "0";
+            if (auto instance = Keyed::getInstance(other))
+            {
+                delete instance.get();
+            }
+            delete pair.second.get();
+            visited++;
+        }
+        ensure("destroyed instances skipped", visited < COUNT);
+        ensure_equals("all deleted", Keyed::instanceCount(), size_t(0));
+
+        for (S32 i = 0; i < 100; i++)
+        {
+            new Keyed(stringize("k", i));
+        }
+        Keyed::instance_snapshot().deleteAll();
+        ensure_equals("deleteAll", Keyed::instanceCount(), size_t(0));
+    }
+
+    template<> template<>
+    void object::test<5>()
+    {
+        set_test_name("LLInstanceTrackerSubclass");
+        Base base("base");
+        Derived derived("derived");
+        ensure_equals("base counts both", Base::instanceCount(), size_t(2));
+        ensure_equals("subclass counts its own", Derived::instanceCount(), size_t(1));
+        ensure("not a Derived", ! Derived::getInstance("base"));
+        ensure_equals("Derived lookup", Derived::getInstance("derived").get(), &derived);
+        ensure_equals("Derived weak", derived.getWeak().lock().get(), &derived);
+        S32 count = 0;
+        for (auto& instance : Derived::instance_snapshot())
+        {
+            ensure_equals("Derived snapshot", &instance, &derived);
+            count++;
+        }
+        ensure_equals("Derived snapshot count", count, 1);
+    }
+
+    template<> template<>
+    void object::test<6>()
+    {
+        set_test_name("concurrent churn, lookups and snapshots");
+        const S32 THREADS = 8;
+        const S32 KEYS = 64;
+        const S32 ITERATIONS = 20000;
+        std::atomic<bool> done{ false };
+        std::atomic<S32> errors{ 0 };
+        // The instance with a given key always lives in the same storage.
+        // A pointer found by another thread may outlive its instance, so
+        // only its address is checked, it is never dereferenced.
+        struct Slot
+        {
+            alignas(Churned) unsigned char mStorage[sizeof(Churned)];
+        };
+        std::vector<Slot> slots(THREADS * KEYS);
+        auto address = [&slots](S32 key)
+        {
+            return reinterpret_cast<const Churned*>(slots[key].mStorage);
+        };
+        std::vector<std::thread> threads;
+        for (S32 t = 0; t < THREADS; t++)
+        {
+            threads.emplace_back([&, t]()
+            {
+                for (S32 i = 0; i < ITERATIONS; i++)
+                {
+                    // keys of this thread, then lookups of every thread's
+                    S32 key = t * KEYS + i % KEYS;
+                    Churned* instance = new (slots[key].mStorage) Churned(key);
+                    if (Churned::getInstance(key).get() != instance || instance->mKey != key)
+                    {
+                        errors++;
+                    }
+                    S32 other = (i * 7919) % (THREADS * KEYS);
+                    if (auto found = Churned::getInstance(other))
+                    {
+                        if (found.get() != address(other))
+                        {
+                            errors++;
+                        }
+                    }
+                    instance->~Churned();
+                }
+            });
+        }
+        std::thread walker([&]()
+        {
+            while (! done)
+            {
+                for (const auto& pair : Churned::snapshot())
+                {
+                    if (&*pair.second != address(pair.first))
+                    {
+                        errors++;
+                    }
+                }
+            }
+        });
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+        done = true;
+        walker.join();
+        ensure_equals("lookups consistent", errors.load(), 0);
+        ensure_equals("all gone", Churned::instanceCount(), size_t(0));
+        ensure("nothing left to find", ! Churned::getInstance(0));
+    }
+
+    template<> template<>
+    void object::test<7>()
+    {
+        set_test_name("contention against LLInstanceTracker");
+        Benchmark bench("Instance tracker contention, create + destroy + 8 getInstance(), operations per us");
+        for (S32 threads : { 1, 2, 4, 8, 16 })
+        {
+            const F64 legacy = contend<LegacyBench>(threads);
+            const F64 sharded = contend<ShardedBench>(threads);
+            bench.report(threads, " threads: LLInstanceTracker ", legacy, ", LLShardedInstanceTracker ", sharded);
+        }
+        ensure_equals("legacy cleaned up", LegacyBench::instanceCount(), size_t(0));
+        ensure_equals("sharded cleaned up", ShardedBench::instanceCount(), size_t(0));
+    }
+
+    template<> template<>
+    void object::test<8>()
+    {
+        set_test_name("thread_local destructors after the thread's own");
+        // more threads than reader slots: each must give its slot back
+        const S32 THREADS = 300;
+        for (S32 t = 0; t < THREADS; t++)
+        {
+            std::thread([t]()
+            {
+                LateTracked& late = lateTracked();
+                for (S32 i = 0; i < 8; i++)
+                {
+                    late.mInstances.emplace_back(new Churned(t * 16 + i * 2));
+                }
+            }).join();
+        }
+        ensure_equals("lookups consistent", sLateErrors.load(), 0);
+        ensure_equals("all gone", Churned::instanceCount(), size_t(0));
+        ensure("nothing left to find", ! Churned::getInstance(0));
+    }
+}
@@ -29,12 +29,132 @@
 #include "linden_common.h"
 
 #include <boost/assign/list_of.hpp>
+#include <iomanip>
+#include <random>
 #include "../llstring.h"
+#include "../stringize.h"
 #include "StringVec.h"                  // must come BEFORE lltut.h
 #include "../test/lltut.h"
+#include "../test/benchmark.h"
 
 using boost::assign::list_of;
 
+namespace
+{
+    // utf8str_to_wstring() as it was before it handled ASCII sixteen bytes
+    // at a time, to check the results against and to time
+    LLWString reference_utf8str_to_wstring(const std::string& utf8str)
+    {
+        LLWString wout;
+        const size_t len = utf8str.size();
+        size_t i = 0;
+        while (i < len)
+        {
+            llwchar unichar;
+            U8 cur_char = utf8str[i];
+            if (cur_char < 0x80)
+            {
+                unichar = cur_char;
+            }
+            else
+            {
+                size_t cont_bytes = 0;
+                if ((cur_char >> 5) == 0x6)         { unichar = (0x1F&cur_char); cont_bytes = 1; }
+                else if ((cur_char >> 4) == 0xe)    { unichar = (0x0F&cur_char); cont_bytes = 2; }
+                else if ((cur_char >> 3) == 0x1e)   { unichar = (0x07&cur_char); cont_bytes = 3; }
+                else if ((cur_char >> 2) == 0x3e)   { unichar = (0x03&cur_char); cont_bytes = 4; }
+                else if ((cur_char >> 1) == 0x7e)   { unichar = (0x01&cur_char); cont_bytes = 5; }
+                else
+                {
+                    wout += LL_UNKNOWN_CHAR;
+                    ++i;
+                    continue;
+                }
+
+                const size_t end = (len < (i + cont_bytes)) ? len : (i + cont_bytes);
+                do
+                {
+                    ++i;
+                    cur_char = utf8str[i];
+                    if ((cur_char >> 6) == 0x2)
+                    {
+                        unichar <<= 6;
+                        unichar += (0x3F&cur_char);
+                    }
+                    else
+                    {
+                        unichar = LL_UNKNOWN_CHAR;
+                        --i;
+                        break;
+                    }
+                } while (i < end);
+
+                if (((cont_bytes == 1) && (unichar < 0x80))
+                    || ((cont_bytes == 2) && (unichar < 0x800))
+                    || ((cont_bytes == 3) && (unichar < 0x10000))
+                    || ((cont_bytes == 4) && (unichar < 0x200000))
+                    || ((cont_bytes == 5) && (unichar < 0x4000000)))
+                {
+                    unichar = LL_UNKNOWN_CHAR;
+                }
+            }
+            wout += unichar;
+            ++i;
+        }
+        return wout;
+    }
+
+    // wstring_to_utf8str() as it was, one character at a time
+    std::string reference_wstring_to_utf8str(const LLWString& utf32str)
+    {
+        std::string out;
+        for (llwchar wc : utf32str)
+        {
+            char tchars[8];
+            tchars[wchar_to_utf8chars(wc, tchars)] = 0;
+            out += tchars;
+        }
+        return out;
+    }
+
+    // Mostly ASCII, with the odd accent, emoji and line in another script
+    std::string chat_corpus(S32 lines)
+    {
+        const char* messages[] =
+        {
+            "hey everyone, is the sim lagging for anyone else or just me?",
+            "caf\xc3\xa9 opening at 6pm slt, bring your friends \xf0\x9f\x98\x80",
+            "\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82, \xd0\xba\xd0\xb0\xd0\xba \xd0\xb4\xd0\xb5\xd0\xbb\xd0\xb0?",
+            "lol yes, the new mesh body finally rezzed",
+            "\xe3\x81\x93\xe3\x82\x93\xe3\x81\xb0\xe3\x82\x93\xe3\x81\xaf\xe3\x80\x81\xe5\x85\x83\xe6\xb0\x97\xef\xbc\x9f",
+            "M\xc3\xbcller's shop has the sale on until Sunday",
+            "ok brb, teleporting home",
+        };
+        std::string text;
+        for (S32 i = 0; i < lines; ++i)
+        {
+            text += stringize("[", i / 60 % 24, ":", i % 60, "] Resident ", i % 37, ": ",
+                              messages[(i * 3) % 7], "\n");
+        }
+        return text;
+    }
+
+    // Long ASCII paragraphs with typographic punctuation
+    std::string notecard_corpus(S32 paragraphs)
+    {
+        std::string text;
+        for (S32 i = 0; i < paragraphs; ++i)
+        {
+            text += stringize("Section ", i, " \xe2\x80\x94 Welcome to the region. Please read the "
+                              "covenant before you rez anything larger than the parcel prim limit, "
+                              "and remember that scripts which run while nobody is around are "
+                              "returned after thirty minutes. Questions go to the estate managers, "
+                              "who are usually online in the evenings \xe2\x80\x9c" "SLT\xe2\x80\x9d.\n\n");
+        }
+        return text;
+    }
+}
+
 namespace tut
 {
     struct string_index
@@ -868,4 +988,166 @@ namespace tut
                       LLStringUtil::getTokens("it's^ up there^", " ", "", "'", "^"),
                       list_of("it's up")("there^"));
     }
+
+    template<> template<>
+    void string_index_object_t::test<43>()
+    {
+        set_test_name("utf8str_to_wstring() against the scalar decoder");
+        const std::string cases[] =
+        {
+            "",
+            "plain ASCII, longer than sixteen characters",
+            "caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80 \xe6\x97\xa5\xe6\x9c\xac",
+            // overlong, stray continuation, invalid lead, five and six bytes
+            "\xc0\x80 \xe0\x80\x80 \x80\xbf \xfe\xff \xf8\x88\x80\x80\x80 \xfc\x84\x80\x80\x80\x80",
+            // cut short by another character, and by the end
+            "0123456789abcdef\xe2\x82x\xf0\x9f\x98",
+            "0123456789abcdef\xc3",
+            std::string("embedded\0NUL in the middle of ASCII", 35),
+        };
+        for (const std::string& utf8 : cases)
+        {
+            ensure(utf8, utf8str_to_wstring(utf8) == reference_utf8str_to_wstring(utf8));
+        }
+
+        // random bytes, weighted towards what text is made of
+        std::mt19937 random(43);
+        const U8 interesting[] = { 0x00, 0x41, 0x7f, 0x80, 0xbf, 0xc0, 0xc3, 0xdf, 0xe0, 0xe2,
+                                   0xef, 0xf0, 0xf4, 0xf8, 0xfc, 0xfe, 0xff };
+        for (S32 round = 0; round < 20000; ++round)
+        {
+            std::string utf8(random() % 80, 'a');
+            for (char& c : utf8)
+            {
+                switch (random() % 4)
+                {
+                case 0:  c = char(0x20 + random() % 0x5f);                  break;
+                case 1:  c = char(0x80 | (random() % 0x40));                break;
+                case 2:  c = char(interesting[random() % sizeof(interesting)]); break;
+                default: c = char(random());                                break;
+                }
+            }
+            const LLWString expected(reference_utf8str_to_wstring(utf8));
+            ensure(stringize("round ", round), utf8str_to_wstring(utf8) == expected);
+
+            // the span form, into a buffer with no room to spare
+            std::vector<llwchar> buffer(utf8.size());
+            const size_t written = utf8str_to_wchars(utf8, buffer);
+            ensure("span form", LLWString(buffer.data(), written) == expected);
+        }
+    }
+
+    template<> template<>
+    void string_index_object_t::test<44>()
+    {
+        set_test_name("wstring_to_utf8str() against the scalar encoder");
+        std::mt19937 random(44);
+        const llwchar ranges[] = { 0x80, 0x800, 0x10000, 0x110000, 0x4000000, 0x7fffffff };
+        for (S32 round = 0; round < 20000; ++round)
+        {
+            LLWString wstr(random() % 80, 'a');
+            for (llwchar& wc : wstr)
+            {
+                switch (random() % 8)
+                {
+                case 0:  wc = llwchar(random() % ranges[random() % 6]); break;
+                case 1:  wc = llwchar(random() % 0x800);                break;
+                case 2:  wc = 0;                                        break;
+                default: wc = llwchar(0x20 + random() % 0x5f);          break;
+                }
+            }
+            const std::string expected(reference_wstring_to_utf8str(wstr));
+            ensure_equals(stringize("round ", round), wstring_to_utf8str(wstr), expected);
+
+            std::vector<char> buffer(wstring_utf8_length(wstr));
+            const size_t written = wstring_to_utf8chars(wstr, buffer);
+            ensure_equals("span form", std::string(buffer.data(), written), expected);
+        }
+
+        // wstring_utf8_length() counts what's written, NULs aside
+        LLWString wstr;
+        for (llwchar wc : { 0x41, 0x7f, 0x80, 0x7ff, 0x800, 0xffff, 0x10000, 0x10ffff,
+                            0x1fffff, 0x200000, 0x3ffffff, 0x4000000, 0x7fffffff })
+        {
+            wstr += wc;
+        }
+        wstr += wstr;
+        ensure_equals("length", size_t(wstring_utf8_length(wstr)), wstring_to_utf8str(wstr).size());
+    }
+
+    template<> template<>
+    void string_index_object_t::test<45>()
+    {
+        set_test_name("conversions of chat and notecard text");
+        struct Corpus
+        {
+            const char* mName;
+            std::string mText;
+        };
+        const Corpus corpora[] =
+        {
+            { "chat log", chat_corpus(Benchmark::size(20000, 200)) },
+            { "notecards", notecard_corpus(Benchmark::size(2000, 20)) },
+        };
+        Benchmark bench("UTF-8 <-> UTF-32, MB of UTF-8 per second");
+        for (const Corpus& corpus : corpora)
+        {
+            const std::string& utf8 = corpus.mText;
+            const F64 mb = utf8.size() / 1e6;
+            const S32 PASSES = Benchmark::size(5, 1);
+            LLWString expected, wide;
+
+            bench.start();
+            for (S32 pass = 0; pass < PASSES; ++pass)
+            {
+                expected = reference_utf8str_to_wstring(utf8);
+            }
+            const F64 old_decode = bench.elapsed_ms();
+            bench.start();
+            for (S32 pass = 0; pass < PASSES; ++pass)
+            {
+                wide = utf8str_to_wstring(utf8);
+            }
+            const F64 new_decode = bench.elapsed_ms();
+            ensure("decode", wide == expected);
+            // line by line into a buffer that's reused, as a widget would
+            std::vector<llwchar> buffer(utf8.size());
+            size_t chars = 0;
+            bench.start();
+            for (S32 pass = 0; pass < PASSES; ++pass)
+            {
+                for (size_t begin = 0, end; begin < utf8.size(); begin = end + 1)
+                {
+                    end = std::min(utf8.find('\n', begin), utf8.size());
+                    chars += utf8str_to_wchars(std::string_view(utf8).substr(begin, end - begin), buffer);
+                }
+            }
+            const F64 span_decode = bench.elapsed_ms();
+            // every character but the newlines
+            const size_t lines = std::count(utf8.begin(), utf8.end(), '\n');
+            ensure_equals("decoded by line", chars, (wide.size() - lines) * PASSES);
+
+            std::string narrow;
+            bench.start();
+            for (S32 pass = 0; pass < PASSES; ++pass)
+            {
+                narrow = reference_wstring_to_utf8str(wide);
+            }
+            const F64 old_encode = bench.elapsed_ms();
+            ensure_equals("reference round trip", narrow, utf8);
+            bench.start();
+            for (S32 pass = 0; pass < PASSES; ++pass)
+            {
+                narrow = wstring_to_utf8str(wide);
+            }
+            const F64 new_encode = bench.elapsed_ms();
+            ensure_equals("round trip", narrow, utf8);
+
+            const F64 mbs = mb * PASSES * 1000.;
+            bench.report(std::left, std::setw(10), corpus.mName, std::right, std::fixed, std::setprecision(0),
+                         " decode ", mbs / old_decode, " -> ", mbs / new_decode,
+                         " (", mbs / span_decode, " by line into a buffer)",
+                         ", encode ", mbs / old_encode, " -> ", mbs / new_encode);
+        }
+    }
 }
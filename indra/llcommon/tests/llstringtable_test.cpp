@@ -0,0 +1,177 @@
+/**
+ * @file   llstringtable_test.cpp
+ * @brief  Test for llstringtable.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "llstringtable.h"
+// STL headers
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+// std headers
+// other Linden headers
+#include "stringize.h"
+#include "../test/lltut.h"
+
+namespace
+{
+    // Names like the joint and attribute names interned by the viewer
+    std::vector<std::string> makeNames(size_t count)
+    {
+        const char* stems[] = { "mPelvis", "mSpine", "mChest", "mNeck", "mHead", "mHand",
+                                "mFaceEyeBrow", "mWing", "mTail", "mHindLimb", "camera_angle" };
+        std::vector<std::string> names;
+        for (size_t i = 0; i < count; ++i)
+        {
+            names.push_back(stringize(stems[i % LL_ARRAY_SIZE(stems)], i, (i % 3) ? "Left" : "Right"));
+        }
+        return names;
+    }
+}
+
+/*****************************************************************************
+*   TUT
+*****************************************************************************/
+namespace tut
+{
+    struct llstringtable_data
+    {
+    };
+    typedef test_group<llstringtable_data> llstringtable_group;
+    typedef llstringtable_group::object object;
+    llstringtable_group llstringtablegrp("llstringtable");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("LLConcurrentStringTable on one thread");
+        LLConcurrentStringTable table;
+        ensure("empty", table.checkString("mPelvis") == NULL);
+        LLStdStringHandle pelvis = table.insert("mPelvis");
+        ensure_equals("string", *pelvis, "mPelvis");
+        ensure("same handle", table.insert(std::string("mPelvis")) == pelvis);
+        ensure("checkString", table.checkString("mPelvis") == pelvis);
+        ensure("prefix", table.checkString("mPelvi") == NULL);
+        LLStdStringHandle empty = table.insert("");
+        ensure("empty string", empty && empty->empty() && table.insert("") == empty);
+        const std::string with_nul("a\0b", 3);
+        ensure("embedded NUL", table.insert(with_nul) != table.insert("a"));
+        ensure_equals("size", table.size(), size_t(4));
+
+        // handles survive the table growing many times over
+        const std::vector<std::string> names(makeNames(50000));
+        std::vector<LLStdStringHandle> handles;
+        for (const std::string& name : names)
+        {
+            handles.push_back(table.insert(name));
+        }
+        ensure_equals("size after growth", table.size(), names.size() + 4);
+        ensure("first handle", table.checkString("mPelvis") == pelvis);
+        for (size_t i = 0; i < names.size(); ++i)
+        {
+            ensure_equals(names[i], *handles[i], names[i]);
+            ensure(names[i], table.checkString(names[i]) == handles[i]);
+        }
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("LLConcurrentStringTable from many threads");
+        const std::vector<std::string> names(makeNames(20000));
+        const size_t WRITERS = 6, READERS = 2;
+        LLConcurrentStringTable table;
+        std::vector<std::vector<LLStdStringHandle>> handles(WRITERS);
+        std::atomic<bool> done{ false };
+        std::atomic<size_t> readers_found{ 0 }, readers_wrong{ 0 };
+
+        std::vector<std::thread> threads;
+        for (size_t w = 0; w < WRITERS; ++w)
+        {
+            threads.emplace_back([&, w]()
+            {
+                // every writer inserts every name, each in its own order,
+                // so that most names are raced for
+                std::vector<size_t> order(names.size());
+                for (size_t i = 0; i < order.size(); ++i)
+                {
+                    order[i] = i;
+                }
+                std::shuffle(order.begin(), order.end(), std::mt19937(U32(w)));
+                handles[w].resize(names.size());
+                for (size_t i : order)
+                {
+                    handles[w][i] = table.insert(names[i]);
+                }
+            });
+        }
+        for (size_t r = 0; r < READERS; ++r)
+        {
+            threads.emplace_back([&, r]()
+            {
+                std::mt19937 random(U32(100 + r));
+                size_t found = 0, wrong = 0;
+                while (! done.load())
+                {
+                    const std::string& name = names[random() % names.size()];
+                    if (LLStdStringHandle handle = table.checkString(name))
+                    {
+                        ++found;
+                        wrong += (*handle != name);
+                    }
+                }
+                readers_found += found;
+                readers_wrong += wrong;
+            });
+        }
+        for (size_t w = 0; w < WRITERS; ++w)
+        {
+            threads[w].join();
+        }
+        done = true;
+        for (size_t r = 0; r < READERS; ++r)
+        {
+            threads[WRITERS + r].join();
+        }
+
+        ensure_equals("size", table.size(), names.size());
+        ensure_equals("readers saw wrong strings", readers_wrong.load(), size_t(0));
+        for (size_t i = 0; i < names.size(); ++i)
+        {
+            ensure_equals(names[i], *handles[0][i], names[i]);
+            for (size_t w = 1; w < WRITERS; ++w)
+            {
+                ensure(stringize("writers disagree on ", names[i]), handles[w][i] == handles[0][i]);
+            }
+            ensure(names[i], table.checkString(names[i]) == handles[0][i]);
+        }
+    }
+}
@@ -0,0 +1,306 @@
+/**
+ * @file   lltraceevents_test.cpp
+ * @brief  Test for lltraceevents.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "lltraceevents.h"
+#include "stringize.h"
+
+#include <chrono>
+#include <map>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "../test/lltut.h"
+#include "../test/benchmark.h"
+
+namespace
+{
+    // One line of a dump, the fields the tests look at
+    struct DumpedEvent
+    {
+        std::string mName;
+        std::string mPhase;
+        std::string mThread;
+        F64         mTime;
+    };
+
+    std::string field(const std::string& line, const std::string& key)
+    {
+        const std::string tag = "\"" + key + "\":";
+        size_t pos = line.find(tag);
+        if (pos == std::string::npos)
+        {
+            return std::string();
+        }
+        pos += tag.size();
+        if (line[pos] == '"')
+        {
+            return line.substr(pos + 1, line.find('"', pos + 1) - pos - 1);
+        }
+        return line.substr(pos, line.find_first_of(",}", pos) - pos);
+    }
+
+    // The events of a dump and the thread names by tid
+    size_t parseDump(const std::string& dump, std::vector<DumpedEvent>& events,
+                     std::map<std::string, std::string>& threads)
+    {
+        std::istringstream in(dump);
+        std::string line;
+        while (std::getline(in, line))
+        {
+            const std::string phase = field(line, "ph");
+            if (phase == "M")
+            {
+                threads[field(line, "tid")] = field(line.substr(line.find("\"args\"")), "name");
+            }
+            else if (!phase.empty())
+            {
+                DumpedEvent event;
+                event.mName = field(line, "name");
+                event.mPhase = phase;
+                event.mThread = field(line, "tid");
+                event.mTime = atof(field(line, "ts").c_str());
+                events.push_back(event);
+            }
+        }
+        return events.size();
+    }
+
+    size_t dumpEvents(std::vector<DumpedEvent>& events, F64 seconds = 0.0)
+    {
+        std::ostringstream out;
+        const size_t count = LLTrace::EventTrace::dump(out, seconds);
+        std::map<std::string, std::string> threads;
+        tut::ensure_equals("dump counts the events it writes", parseDump(out.str(), events, threads), count);
+        return count;
+    }
+
+    void nested(S32 depth)
+    {
+        LL_PROFILE_ZONE_NAMED("nested");
+        if (depth > 1)
+        {
+            nested(depth - 1);
+        }
+    }
+}
+
+namespace tut
+{
+    struct traceevents
+    {
+        traceevents()
+        {
+            LLTrace::EventTrace::setEnabled(true);
+            LLTrace::EventTrace::clear();
+        }
+
+        ~traceevents()
+        {
+            LLTrace::EventTrace::setEnabled(false);
+            LLTrace::EventTrace::clear();
+        }
+    };
+    typedef test_group<traceevents> traceevents_t;
+    typedef traceevents_t::object traceevents_object_t;
+    tut::traceevents_t tut_singleton("LLTraceEvents");
+
+    template<> template<>
+    void traceevents_object_t::test<1>()
+    {
+        set_test_name("zones, counters and instants of several threads");
+        auto work = [](const char* name)
+        {
+            LLTrace::EventTrace::setThreadName(name);
+            for (S32 i = 0; i < 10; i++)
+            {
+                LL_PROFILE_ZONE_NAMED("outer");
+                nested(3);
+                LL_TRACE_COUNTER("count", i);
+            }
+            LL_PROFILER_FRAME_END;
+        };
+        std::thread first(work, "first");
+        std::thread second(work, "second");
+        first.join();
+        second.join();
+
+        std::ostringstream out;
+        LLTrace::EventTrace::dump(out);
+        std::vector<DumpedEvent> events;
+        std::map<std::string, std::string> threads;
+        parseDump(out.str(), events, threads);
+
+        std::map<std::string, S32> depth;
+        std::map<std::string, S32> counters;
+        std::map<std::string, F64> last_time;
+        S32 frames = 0;
+        for (const DumpedEvent& event : events)
+        {
+            ensure("events of a thread are in order", event.mTime >= last_time[event.mThread]);
+            last_time[event.mThread] = event.mTime;
+            if (event.mPhase == "B")
+            {
+                depth[event.mThread]++;
+            }
+            else if (event.mPhase == "E")
+            {
+                ensure("an end follows its begin", --depth[event.mThread] >= 0);
+            }
+            else if (event.mPhase == "C")
+            {
+                ensure_equals("counter name", event.mName, "count");
+                counters[event.mThread]++;
+            }
+            else if (event.mPhase == "i")
+            {
+                ensure_equals("instant name", event.mName, "Frame");
+                frames++;
+            }
+        }
+        ensure_equals("both threads traced", counters.size(), size_t(2));
+        for (const auto& thread : counters)
+        {
+            ensure_equals("every counter sample", thread.second, 10);
+            ensure_equals("every zone ended", depth[thread.first], 0);
+        }
+        ensure_equals("a frame per thread", frames, 2);
+        ensure_equals("zones per thread", events.size(), size_t(2 * (10 * (2 + 3 * 2 + 1) + 1)));
+
+        std::set<std::string> names;
+        for (const auto& thread : threads)
+        {
+            names.insert(thread.second);
+        }
+        ensure("threads named", names.count("first") && names.count("second"));
+
+        LLTrace::EventTrace::clear();
+        LLTrace::EventTrace::instant("say \"hi\"\n");
+        std::ostringstream escaped;
+        LLTrace::EventTrace::dump(escaped);
+        ensure_contains("name escaped", escaped.str(), "\"name\":\"say \\\"hi\\\"\\u000a\"");
+    }
+
+    template<> template<>
+    void traceevents_object_t::test<2>()
+    {
+        set_test_name("a full buffer keeps the newest events");
+        LLTrace::EventTrace::setEnabled(true, 64);
+        for (S32 i = 0; i < 1000; i++)
+        {
+            nested(4);
+        }
+
+        std::vector<DumpedEvent> events;
+        dumpEvents(events);
+        ensure("at most the buffer size", events.size() <= 64);
+        ensure("most of the buffer", events.size() >= 60);
+        S32 depth = 0;
+        for (const DumpedEvent& event : events)
+        {
+            depth += event.mPhase == "B" ? 1 : -1;
+            ensure("ends whose begin was overwritten are dropped", depth >= 0);
+        }
+        ensure_equals("every zone ended", depth, 0);
+    }
+
+    template<> template<>
+    void traceevents_object_t::test<3>()
+    {
+        set_test_name("dump the last seconds, clear, off");
+        {
+            LL_PROFILE_ZONE_NAMED("early");
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        {
+            LL_PROFILE_ZONE_NAMED("late");
+        }
+
+        std::vector<DumpedEvent> events;
+        ensure_equals("everything", dumpEvents(events), size_t(4));
+        events.clear();
+        ensure_equals("the last 100 ms", dumpEvents(events, 0.1), size_t(2));
+        ensure_equals("newest zone", events[0].mName, "late");
+
+        LLTrace::EventTrace::clear();
+        events.clear();
+        ensure_equals("cleared", dumpEvents(events), size_t(0));
+
+        {
+            LL_PROFILE_ZONE_NAMED("open");
+            LLTrace::EventTrace::setEnabled(false);
+            LL_PROFILE_ZONE_NAMED("off");
+            LL_TRACE_COUNTER("off", 1);
+        }
+        events.clear();
+        ensure_equals("a zone open when turned off still ends", dumpEvents(events), size_t(2));
+        ensure_equals("zone begun before", events[0].mName, "open");
+        ensure_equals("and its end", events[1].mPhase, "E");
+    }
+
+    template<> template<>
+    void traceevents_object_t::test<4>()
+    {
+        set_test_name("zones in two threads at once");
+        const S32 ZONES = Benchmark::size(1000000, 1000);
+        Benchmark bench(stringize("Event trace zones, ", ZONES, " per run, ns per zone"));
+        auto time_zones = [ZONES]()
+        {
+            Benchmark timer;
+            for (S32 i = 0; i < ZONES; i++)
+            {
+                LL_PROFILE_ZONE_NAMED("bench");
+            }
+            return timer.elapsed_ms() * 1000000.0 / ZONES;
+        };
+
+        LLTrace::EventTrace::setEnabled(false);
+        const F64 off_ns = time_zones();
+        LLTrace::EventTrace::setEnabled(true);
+        time_zones();
+        const F64 on_ns = time_zones();
+
+        // two threads at once, each writes its own buffer
+        F64 threaded_ns[2] = {};
+        std::thread other([&]() { threaded_ns[1] = time_zones(); });
+        threaded_ns[0] = time_zones();
+        other.join();
+
+        std::ostringstream out;
+        bench.start();
+        const size_t count = LLTrace::EventTrace::dump(out);
+        const F64 dump_ms = bench.elapsed_ms();
+
+        bench.report("off            ", off_ns);
+        bench.report("on             ", on_ns);
+        bench.report("on, 2 threads  ", threaded_ns[0], " / ", threaded_ns[1]);
+        bench.report("dump of ", count, " events ", dump_ms, " ms");
+        ensure("dumped the buffers", count > 0);
+    }
+}
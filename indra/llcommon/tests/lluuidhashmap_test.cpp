@@ -0,0 +1,357 @@
+/**
+ * @file   lluuidhashmap_test.cpp
+ * @brief  Test for lluuidhashmap.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "lluuidhashmap.h"
+// STL headers
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+// std headers
+// other Linden headers
+#include "../test/lltut.h"
+#include "../test/benchmark.h"
+
+namespace
+{
+    // Random version 4 UUIDs, the same on every run
+    std::vector<LLUUID> makeKeys(size_t count, U64 seed)
+    {
+        std::mt19937_64 random(seed);
+        std::vector<LLUUID> keys(count);
+        for (LLUUID& key : keys)
+        {
+            const U64 words[2] = { random(), random() };
+            memcpy(key.mData, words, sizeof(words));
+            key.mData[6] = (key.mData[6] & 0x0f) | 0x40;
+            key.mData[8] = (key.mData[8] & 0x3f) | 0x80;
+        }
+        return keys;
+    }
+
+    // as many lookups at every size
+    const size_t LOOKUPS = Benchmark::size(500000, 5000);
+
+    // Milliseconds to insert, find, miss and iterate over keys in a MAP
+    template <typename MAP>
+    void benchmark(const Benchmark& bench, const char* name, const std::vector<LLUUID>& keys,
+                   const std::vector<LLUUID>& missing)
+    {
+        F64 insert_ms, find_ms, miss_ms, iterate_ms;
+        size_t found = 0, missed = 0;
+        U64 sum = 0;
+        {
+            MAP map;
+            Benchmark timer;
+            for (size_t i = 0; i < keys.size(); ++i)
+            {
+                map[keys[i]] = i;
+            }
+            insert_ms = timer.elapsed_ms();
+
+            timer.start();
+            for (size_t i = 0; i < LOOKUPS; ++i)
+            {
+                found += map.count(keys[(i * 7919) % keys.size()]);
+            }
+            find_ms = timer.elapsed_ms();
+
+            timer.start();
+            for (size_t i = 0; i < LOOKUPS; ++i)
+            {
+                missed += map.count(missing[(i * 7919) % missing.size()]);
+            }
+            miss_ms = timer.elapsed_ms();
+
+            timer.start();
+            for (S32 pass = 0; pass < 10; ++pass)
+            {
+                for (const auto& pair : map)
+                {
+                    sum += pair.second;
+                }
+            }
+            iterate_ms = timer.elapsed_ms();
+        }
+        tut::ensure_equals(name, found, LOOKUPS);
+        tut::ensure_equals(name, missed, size_t(0));
+        tut::ensure_equals(name, sum, U64(keys.size()) * (keys.size() - 1) / 2 * 10);
+        bench.report(std::left, std::setw(20), name, std::right, std::fixed,
+                     std::setprecision(1),
+                     std::setw(10), insert_ms,
+                     std::setw(10), find_ms,
+                     std::setw(10), miss_ms,
+                     std::setw(10), iterate_ms);
+    }
+
+    // counts the live instances, to catch leaks and double destruction
+    struct Counted
+    {
+        static S32 sLive;
+
+        Counted(S32 value=0): mValue(std::make_shared<S32>(value)) { ++sLive; }
+        Counted(const Counted& other): mValue(other.mValue) { ++sLive; }
+        Counted(Counted&& other): mValue(std::move(other.mValue)) { ++sLive; }
+        Counted& operator=(const Counted&) = default;
+        Counted& operator=(Counted&&) = default;
+        ~Counted() { --sLive; }
+
+        std::shared_ptr<S32> mValue;
+    };
+    S32 Counted::sLive = 0;
+}
+
+/*****************************************************************************
+*   TUT
+*****************************************************************************/
+namespace tut
+{
+    struct lluuidhashmap_data
+    {
+    };
+    typedef test_group<lluuidhashmap_data> lluuidhashmap_group;
+    typedef lluuidhashmap_group::object object;
+    lluuidhashmap_group lluuidhashmapgrp("lluuidhashmap");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("getHash64");
+        // stored hashes and the order of hash tables depend on these values
+        // never changing
+        ensure_equals("null", LLUUID::null.getHash64(), U64(0));
+        LLUUID id("2f1b5e5c-8d0a-4f43-9bb5-7d2c6b0e4a91");
+        ensure_equals("hash changed", id.getHash64(), U64(0x09970a445c4df1a6ULL));
+        LLUUID same_halves("01234567-89ab-cdef-0123-456789abcdef");
+        ensure_equals("digest", same_halves.getDigest64(), U64(0));
+        ensure("halves cancel out", same_halves.getHash64() != 0);
+
+        // UUIDs one bit apart spread over every bit of the hash
+        U64 changed = 0;
+        for (S32 bit = 0; bit < 128; ++bit)
+        {
+            LLUUID other(id);
+            other.mData[bit / 8] ^= U8(1 << (bit % 8));
+            changed |= other.getHash64() ^ id.getHash64();
+        }
+        ensure_equals("bits left unchanged", changed, ~U64(0));
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("against std::map");
+        std::vector<LLUUID> keys(makeKeys(2000, 1));
+        std::mt19937 random(2);
+        LLUUIDHashMap<S32> map;
+        std::map<LLUUID, S32> expected;
+        for (S32 op = 0; op < 100000; ++op)
+        {
+            const LLUUID& key = keys[random() % keys.size()];
+            switch (random() % 4)
+            {
+            case 0:
+                map[key] = op;
+                expected[key] = op;
+                break;
+            case 1:
+                ensure_equals("insert", map.insert({ key, op }).second,
+                              expected.insert({ key, op }).second);
+                break;
+            case 2:
+                ensure_equals("erase", map.erase(key), expected.erase(key));
+                break;
+            default:
+            {
+                auto found = map.find(key);
+                auto want = expected.find(key);
+                ensure_equals("find", found == map.end(), want == expected.end());
+                if (want != expected.end())
+                {
+                    ensure_equals("find key", found->first, want->first);
+                    ensure_equals("find value", found->second, want->second);
+                }
+                break;
+            }
+            }
+            ensure_equals("size", map.size(), expected.size());
+        }
+
+        std::map<LLUUID, S32> iterated(map.begin(), map.end());
+        ensure("iterated", iterated == expected);
+        // a long run of inserts and erases reuses slots rather than growing
+        ensure("grew with DELETED slots", map.capacity() <= 4096);
+
+        const LLUUIDHashMap<S32>& const_map(map);
+        size_t count = 0;
+        for (LLUUIDHashMap<S32>::const_iterator it = const_map.begin(); it != const_map.end(); ++it)
+        {
+            ensure("const find", const_map.find(it->first) == it);
+            ++count;
+        }
+        ensure_equals("const iteration", count, expected.size());
+
+        map.clear();
+        ensure("clear", map.empty() && map.begin() == map.end());
+        ensure("cleared key found", ! map.contains(keys[0]));
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("erase while iterating");
+        std::vector<LLUUID> keys(makeKeys(1000, 3));
+        LLUUIDHashMap<size_t> map;
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            map[keys[i]] = i;
+        }
+        for (auto it = map.begin(); it != map.end(); )
+        {
+            if (it->second % 2)
+            {
+                map.erase(it++);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        ensure_equals("erase(it++)", map.size(), keys.size() / 2);
+        for (auto it = map.begin(); it != map.end(); )
+        {
+            it = (it->second % 4) ? ++it : map.erase(it);
+        }
+        ensure_equals("it = erase(it)", map.size(), keys.size() / 4);
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            ensure_equals(std::to_string(i), map.count(keys[i]), size_t(i % 4 == 2));
+        }
+    }
+
+    template<> template<>
+    void object::test<4>()
+    {
+        set_test_name("values are constructed and destroyed once");
+        std::vector<LLUUID> keys(makeKeys(300, 4));
+        {
+            LLUUIDHashMap<Counted> map;
+            for (size_t i = 0; i < keys.size(); ++i)
+            {
+                // grows several times on the way
+                map.try_emplace(keys[i], S32(i));
+            }
+            ensure_equals("after inserts", Counted::sLive, S32(keys.size()));
+            ensure_equals("moved on growth", *map[keys[0]].mValue, 0);
+
+            LLUUIDHashMap<Counted> copy(map);
+            ensure_equals("copy", Counted::sLive, S32(2 * keys.size()));
+            ensure("copy shares values", copy[keys[7]].mValue == map[keys[7]].mValue);
+
+            LLUUIDHashMap<Counted> moved(std::move(copy));
+            ensure("moved-from", copy.empty() && copy.begin() == copy.end());
+            ensure_equals("move", Counted::sLive, S32(2 * keys.size()));
+
+            for (size_t i = 0; i < keys.size(); i += 2)
+            {
+                moved.erase(keys[i]);
+            }
+            ensure_equals("after erase", Counted::sLive, S32(keys.size() + keys.size() / 2));
+
+            map = moved;
+            ensure_equals("assigned", map.size(), keys.size() / 2);
+            ensure_equals("after assignment", Counted::sLive, S32(keys.size()));
+            map.clear();
+            ensure_equals("after clear", Counted::sLive, S32(keys.size() / 2));
+        }
+        ensure_equals("after destruction", Counted::sLive, 0);
+    }
+
+    template<> template<>
+    void object::test<5>()
+    {
+        set_test_name("against std::map and std::unordered_map");
+        Benchmark bench("UUID maps, ms for N inserts, 500k finds, 500k misses, 10 iterations");
+        const std::vector<size_t> counts(Benchmark::size(std::vector<size_t>{ 10000, 100000, 1000000 },
+                                                         std::vector<size_t>{ 1000 }));
+        for (size_t count : counts)
+        {
+            const std::vector<LLUUID> keys(makeKeys(count, count));
+            const std::vector<LLUUID> missing(makeKeys(count, count + 1));
+            bench.report(count, " keys", std::setw(23), "insert",
+                         std::setw(10), "find", std::setw(10), "miss",
+                         std::setw(10), "iterate");
+            benchmark<std::map<LLUUID, size_t>>(bench, "std::map", keys, missing);
+            benchmark<std::unordered_map<LLUUID, size_t>>(bench, "std::unordered_map", keys, missing);
+            benchmark<LLUUIDHashMap<size_t>>(bench, "LLUUIDHashMap", keys, missing);
+        }
+    }
+
+    template<> template<>
+    void object::test<6>()
+    {
+        set_test_name("lluuid_hot_map, as the LL_UUID_HASH_MAP option sets it");
+#ifdef LL_UUID_HASH_MAP
+        ensure("hash map", std::is_same_v<lluuid_hot_map<S32>, LLUUIDHashMap<S32>>);
+#else
+        ensure("std::map", std::is_same_v<lluuid_hot_map<S32>, std::map<LLUUID, S32>>);
+#endif
+        // what the object list, inventory model and avatar name cache do
+        const std::vector<LLUUID> keys(makeKeys(500, 6));
+        lluuid_hot_map<std::shared_ptr<S32>> map;
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            map[keys[i]] = std::make_shared<S32>(S32(i));
+        }
+        map[keys[0]] = std::make_shared<S32>(-2);
+        ensure_equals("size", map.size(), keys.size());
+        ensure_equals("replaced", *map.find(keys[0])->second, -2);
+        ensure("miss", map.find(LLUUID::null) == map.end());
+        for (auto it = map.begin(); it != map.end(); )
+        {
+            if (*it->second % 2)
+            {
+                map.erase(it++);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        ensure_equals("erase(it++)", map.size(), keys.size() / 2);
+        ensure_equals("erase by key", map.erase(keys[2]), size_t(1));
+        ensure("count", ! map.count(keys[2]) && map.count(keys[4]));
+        map.clear();
+        ensure("clear", map.empty());
+    }
+}
@@ -0,0 +1,136 @@
+/**
+ * @file   parallelfor_test.cpp
+ * @brief  Test for parallelfor.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "parallelfor.h"
+// STL headers
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+// std headers
+// external library headers
+// other Linden headers
+#include "../test/lltut.h"
+#include "stringize.h"
+#include "threadpool.h"
+
+/*****************************************************************************
+*   TUT
+*****************************************************************************/
+namespace tut
+{
+    struct parallelfor_data
+    {
+        parallelfor_data():
+            mPool("ParallelForTest", 3)
+        {
+            mPool.start();
+        }
+
+        LL::ThreadPool mPool;
+    };
+    typedef test_group<parallelfor_data> parallelfor_group;
+    typedef parallelfor_group::object object;
+    parallelfor_group parallelforgrp("parallelfor");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("every index exactly once");
+        const size_t count = 1000;
+        std::vector<std::atomic<S32>> visits(count);
+        LL::parallel_for("ParallelForTest", count,
+                         [&visits](size_t i){ visits[i]++; });
+        for (size_t i = 0; i < count; ++i)
+        {
+            ensure_equals(STRINGIZE("index " << i), visits[i].load(), 1);
+        }
+
+        S32 calls = 0;
+        LL::parallel_for("ParallelForTest", 0, [&calls](size_t){ ++calls; });
+        ensure_equals("nothing to do", calls, 0);
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("on the calling thread alone");
+        const std::thread::id self = std::this_thread::get_id();
+        for (const std::string& queue : { std::string(), std::string("NoSuchQueue") })
+        {
+            std::vector<S32> visits(100, 0);
+            LL::parallel_for(queue, visits.size(),
+                             [&visits, self](size_t i)
+                             {
+                                 ensure("other thread", std::this_thread::get_id() == self);
+                                 visits[i]++;
+                             });
+            ensure("every index", std::all_of(visits.begin(), visits.end(),
+                                              [](S32 v){ return v == 1; }));
+        }
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("exceptions reach the caller");
+        std::atomic<S32> running{ 0 };
+        std::atomic<S32> calls{ 0 };
+        std::string what;
+        try
+        {
+            LL::parallel_for("ParallelForTest", 1000,
+                             [&running, &calls](size_t i)
+                             {
+                                 running++;
+                                 calls++;
+                                 std::this_thread::sleep_for(std::chrono::microseconds(50));
+                                 running--;
+                                 if (i == 10)
+                                 {
+                                     throw std::runtime_error("index 10");
+                                 }
+                             });
+        }
+        catch (const std::runtime_error& e)
+        {
+            what = e.what();
+        }
+        ensure_equals("rethrown", what, "index 10");
+        ensure_equals("calls still running", running.load(), 0);
+        ensure("rest skipped", calls.load() < 1000);
+
+        // the queue's threads are still fine
+        std::atomic<S32> visits{ 0 };
+        LL::parallel_for("ParallelForTest", 100, [&visits](size_t){ visits++; });
+        ensure_equals("after exception", visits.load(), 100);
+    }
+} // namespace tut
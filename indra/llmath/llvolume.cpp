@@ -2710,6 +2710,295 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
 }
 
 
+namespace
+{
+    // Decoded face block layout (all offsets relative to start of block, all arrays 16 byte aligned):
+    //   DecodedFacesHeader
+    //   DecodedFaceEntry[face_count]
+    //   per face: positions, normals, texcoords (padded), [tangents], [weights], indices (padded)
+    constexpr U32 DECODED_FACES_MAGIC = 0x4D444C4C; // 'LLDM' in little endian
+
+    enum
+    {
+        DECODED_FACE_HAS_TANGENTS = 0x1,
+        DECODED_FACE_HAS_WEIGHTS  = 0x2,
+    };
+
+    struct DecodedFacesHeader
+    {
+        U32 mMagic;
+        U32 mVersion;
+        U32 mFaceCount;
+        U32 mDataSize;
+    };
+
+    struct DecodedFaceEntry
+    {
+        U32 mOffset;
+        S32 mNumVertices;
+        S32 mNumIndices;
+        U32 mFlags;
+        F32 mExtents[3][4];
+        F32 mTexCoordExtents[4];
+        F32 mNormalizedScale[4];
+    };
+
+    static_assert(sizeof(DecodedFacesHeader) % 16 == 0, "decoded face header must stay 16 byte aligned");
+    static_assert(sizeof(DecodedFaceEntry) % 16 == 0, "decoded face entry must stay 16 byte aligned");
+
+    inline size_t pad16(size_t size)
+    {
+        return (size + 0xF) & ~((size_t)0xF);
+    }
+
+    size_t decoded_face_size(S32 num_verts, S32 num_indices, U32 flags)
+    {
+        size_t size = sizeof(LLVector4a) * 2 * num_verts; // positions + normals
+        size += pad16(sizeof(LLVector2) * num_verts);
+        if (flags & DECODED_FACE_HAS_TANGENTS)
+        {
+            size += sizeof(LLVector4a) * num_verts;
+        }
+        if (flags & DECODED_FACE_HAS_WEIGHTS)
+        {
+            size += sizeof(LLVector4a) * num_verts;
+        }
+        size += pad16(sizeof(U16) * num_indices);
+        return size;
+    }
+}
+
+bool LLVolume::packDecodedFaces(std::vector<U8>& out) const
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
+
+    const U32 face_count = (U32)mVolumeFaces.size();
+    if (face_count == 0)
+    {
+        return false;
+    }
+
+    std::vector<DecodedFaceEntry> entries(face_count);
+    size_t offset = sizeof(DecodedFacesHeader) + sizeof(DecodedFaceEntry) * face_count;
+    for (U32 i = 0; i < face_count; ++i)
+    {
+        const LLVolumeFace& face = mVolumeFaces[i];
+        DecodedFaceEntry& entry = entries[i];
+        memset(&entry, 0, sizeof(DecodedFaceEntry));
+
+        entry.mOffset = (U32)offset;
+        entry.mNumVertices = face.mNumVertices;
+        entry.mNumIndices = face.mNumIndices;
+        entry.mFlags = 0;
+        if (face.mTangents && face.mNumVertices > 0)
+        {
+            entry.mFlags |= DECODED_FACE_HAS_TANGENTS;
+        }
+        if (face.mWeights && face.mNumVertices > 0)
+        {
+            entry.mFlags |= DECODED_FACE_HAS_WEIGHTS;
+        }
+        for (U32 j = 0; j < 3; ++j)
+        {
+            memcpy(entry.mExtents[j], face.mExtents[j].getF32ptr(), sizeof(LLVector4a));
+        }
+        entry.mTexCoordExtents[0] = face.mTexCoordExtents[0].mV[VX];
+        entry.mTexCoordExtents[1] = face.mTexCoordExtents[0].mV[VY];
+        entry.mTexCoordExtents[2] = face.mTexCoordExtents[1].mV[VX];
+        entry.mTexCoordExtents[3] = face.mTexCoordExtents[1].mV[VY];
+        entry.mNormalizedScale[0] = face.mNormalizedScale.mV[VX];
+        entry.mNormalizedScale[1] = face.mNormalizedScale.mV[VY];
+        entry.mNormalizedScale[2] = face.mNormalizedScale.mV[VZ];
+
+        offset += decoded_face_size(face.mNumVertices, face.mNumIndices, entry.mFlags);
+    }
+
+    if (offset > (size_t)S32_MAX)
+    {
+        return false;
+    }
+
+    out.resize(offset);
+    U8* data = out.data();
+
+    DecodedFacesHeader header;
+    header.mMagic = DECODED_FACES_MAGIC;
+    header.mVersion = DECODED_FACES_VERSION;
+    header.mFaceCount = face_count;
+    header.mDataSize = (U32)offset;
+    memcpy(data, &header, sizeof(DecodedFacesHeader));
+    memcpy(data + sizeof(DecodedFacesHeader), entries.data(), sizeof(DecodedFaceEntry) * face_count);
+
+    for (U32 i = 0; i < face_count; ++i)
+    {
+        const LLVolumeFace& face = mVolumeFaces[i];
+        const DecodedFaceEntry& entry = entries[i];
+        const S32 num_verts = entry.mNumVertices;
+        U8* dst = data + entry.mOffset;
+
+        if (num_verts > 0)
+        {
+            memcpy(dst, face.mPositions, sizeof(LLVector4a) * num_verts);
+            dst += sizeof(LLVector4a) * num_verts;
+            memcpy(dst, face.mNormals, sizeof(LLVector4a) * num_verts);
+            dst += sizeof(LLVector4a) * num_verts;
+            const size_t tc_size = sizeof(LLVector2) * num_verts;
+            memcpy(dst, face.mTexCoords, tc_size);
+            memset(dst + tc_size, 0, pad16(tc_size) - tc_size);
+            dst += pad16(tc_size);
+            if (entry.mFlags & DECODED_FACE_HAS_TANGENTS)
+            {
+                memcpy(dst, face.mTangents, sizeof(LLVector4a) * num_verts);
+                dst += sizeof(LLVector4a) * num_verts;
+            }
+            if (entry.mFlags & DECODED_FACE_HAS_WEIGHTS)
+            {
+                memcpy(dst, face.mWeights, sizeof(LLVector4a) * num_verts);
+                dst += sizeof(LLVector4a) * num_verts;
+            }
+        }
+
+        if (entry.mNumIndices > 0)
+        {
+            const size_t idx_size = sizeof(U16) * entry.mNumIndices;
+            memcpy(dst, face.mIndices, idx_size);
+            memset(dst + idx_size, 0, pad16(idx_size) - idx_size);
+        }
+    }
+
+    return true;
+}
+
+bool LLVolume::unpackDecodedFaces(const U8* in_data, S32 size)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
+
+    // the vertex arrays are copied 16 bytes at a time
+    if (!in_data || ((uintptr_t)in_data & 0xF) || size < (S32)sizeof(DecodedFacesHeader))
+    {
+        return false;
+    }
+
+    DecodedFacesHeader header;
+    memcpy(&header, in_data, sizeof(DecodedFacesHeader));
+    if (header.mMagic != DECODED_FACES_MAGIC
+        || header.mVersion != DECODED_FACES_VERSION
+        || header.mDataSize != (U32)size
+        || header.mFaceCount == 0
+        || header.mFaceCount > (U32)LL_SCULPT_MESH_MAX_FACES)
+    {
+        return false;
+    }
+
+    const size_t table_end = sizeof(DecodedFacesHeader) + sizeof(DecodedFaceEntry) * header.mFaceCount;
+    if (table_end > (size_t)size)
+    {
+        return false;
+    }
+
+    std::vector<DecodedFaceEntry> entries(header.mFaceCount);
+    memcpy(entries.data(), in_data + sizeof(DecodedFacesHeader), sizeof(DecodedFaceEntry) * header.mFaceCount);
+
+    // validate the whole table before touching mVolumeFaces
+    for (const DecodedFaceEntry& entry : entries)
+    {
+        if (entry.mNumVertices < 0 || entry.mNumVertices > 65536
+            || entry.mNumIndices < 0 || entry.mNumIndices % 3 != 0
+            || entry.mOffset < table_end || (entry.mOffset & 0xF) != 0
+            || entry.mOffset + decoded_face_size(entry.mNumVertices, entry.mNumIndices, entry.mFlags) > (size_t)size)
+        {
+            LL_WARNS() << "Corrupt decoded face block" << LL_ENDL;
+            return false;
+        }
+
+        // the indices go straight into the face, so every one of them must
+        // name a vertex of that face
+        const U8* indices = in_data + entry.mOffset + decoded_face_size(entry.mNumVertices, 0, entry.mFlags);
+        for (S32 i = 0; i < entry.mNumIndices; ++i)
+        {
+            U16 index;
+            memcpy(&index, indices + sizeof(U16) * i, sizeof(U16));
+            if (index >= entry.mNumVertices)
+            {
+                LL_WARNS() << "Corrupt decoded face block, index " << index
+                           << " of " << entry.mNumVertices << " vertices" << LL_ENDL;
+                return false;
+            }
+        }
+    }
+
+    mVolumeFaces.resize(header.mFaceCount);
+
+    for (U32 i = 0; i < header.mFaceCount; ++i)
+    {
+        const DecodedFaceEntry& entry = entries[i];
+        LLVolumeFace& face = mVolumeFaces[i];
+        const S32 num_verts = entry.mNumVertices;
+        const U8* src = in_data + entry.mOffset;
+
+        face.resizeVertices(num_verts);
+        face.resizeIndices(entry.mNumIndices);
+        if ((num_verts > 0 && !face.mPositions) || (entry.mNumIndices > 0 && !face.mIndices))
+        {
+            LL_WARNS() << "Failed to allocate decoded face " << i << LL_ENDL;
+            mVolumeFaces.clear();
+            return false;
+        }
+
+        if (num_verts > 0)
+        {
+            LLVector4a::memcpyNonAliased16((F32*) face.mPositions, (const F32*) src, sizeof(LLVector4a) * num_verts);
+            src += sizeof(LLVector4a) * num_verts;
+            LLVector4a::memcpyNonAliased16((F32*) face.mNormals, (const F32*) src, sizeof(LLVector4a) * num_verts);
+            src += sizeof(LLVector4a) * num_verts;
+            memcpy(face.mTexCoords, src, sizeof(LLVector2) * num_verts);
+            src += pad16(sizeof(LLVector2) * num_verts);
+            if (entry.mFlags & DECODED_FACE_HAS_TANGENTS)
+            {
+                face.allocateTangents(num_verts);
+                if (!face.mTangents)
+                {
+                    mVolumeFaces.clear();
+                    return false;
+                }
+                LLVector4a::memcpyNonAliased16((F32*) face.mTangents, (const F32*) src, sizeof(LLVector4a) * num_verts);
+                src += sizeof(LLVector4a) * num_verts;
+            }
+            if (entry.mFlags & DECODED_FACE_HAS_WEIGHTS)
+            {
+                face.allocateWeights(num_verts);
+                if (!face.mWeights)
+                {
+                    mVolumeFaces.clear();
+                    return false;
+                }
+                LLVector4a::memcpyNonAliased16((F32*) face.mWeights, (const F32*) src, sizeof(LLVector4a) * num_verts);
+                src += sizeof(LLVector4a) * num_verts;
+            }
+        }
+
+        if (entry.mNumIndices > 0)
+        {
+            memcpy(face.mIndices, src, sizeof(U16) * entry.mNumIndices);
+        }
+
+        for (U32 j = 0; j < 3; ++j)
+        {
+            face.mExtents[j].loadua(entry.mExtents[j]);
+        }
+        face.mTexCoordExtents[0].set(entry.mTexCoordExtents[0], entry.mTexCoordExtents[1]);
+        face.mTexCoordExtents[1].set(entry.mTexCoordExtents[2], entry.mTexCoordExtents[3]);
+        face.mNormalizedScale.set(entry.mNormalizedScale[0], entry.mNormalizedScale[1], entry.mNormalizedScale[2]);
+
+        // data was cache optimized before it was packed
+        face.mOptimized = true;
+    }
+
+    mSculptLevel = 0;  // success!
+
+    return true;
+}
+
 bool LLVolume::isMeshAssetLoaded() const
 {
     return mIsMeshAssetLoaded;
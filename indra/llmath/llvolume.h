@@ -1115,6 +1115,16 @@ protected:
 public:
     bool unpackVolumeFaces(std::istream& is, S32 size);
     bool unpackVolumeFaces(U8* in_data, S32 size);
+
+    // Decoded face cache support.  packDecodedFaces writes the fully unpacked and
+    // cache optimized faces (indices, positions, normals, texcoords, tangents, weights)
+    // into a flat, versioned binary block where every array starts on a 16 byte boundary.
+    // unpackDecodedFaces copies faces back out of such a block, which must itself be
+    // 16 byte aligned, without re-running inflate/LLSD parse/cacheOptimize.
+    // Returns false on version mismatch or corrupt data.
+    static constexpr U32 DECODED_FACES_VERSION = 1;
+    bool packDecodedFaces(std::vector<U8>& out) const;
+    bool unpackDecodedFaces(const U8* in_data, S32 size);
 private:
     bool unpackVolumeFacesInternal(const LLSD& mdl);
 
@@ -0,0 +1,240 @@
+/**
+ * @file llvolume_test.cpp
+ * @brief Test cases for the LLVolume decoded face cache format
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llvolume.h"
+#include "llsdserialize.h"
+#include "stringize.h"
+
+#include "../test/lltut.h"
+#include "../test/benchmark.h"
+
+namespace
+{
+    // Build a compressed mesh LOD block (the format stored in the raw mesh asset)
+    // for a grid of grid_size x grid_size vertices with a wavy surface.
+    std::string make_mesh_lod(U32 grid_size, bool rigged)
+    {
+        LLSD::Binary pos, norm, tc, idx, weights;
+        for (U32 y = 0; y < grid_size; ++y)
+        {
+            for (U32 x = 0; x < grid_size; ++x)
+            {
+                const F32 fx = (F32)x / (grid_size - 1);
+                const F32 fy = (F32)y / (grid_size - 1);
+                const F32 fz = 0.5f + 0.5f * sinf(fx * F_TWO_PI) * cosf(fy * F_TWO_PI);
+                const U16 p[3] = { (U16)(fx * 65535.f), (U16)(fy * 65535.f), (U16)(fz * 65535.f) };
+                const U16 n[3] = { 32767, 32767, 65535 };
+                const U16 t[2] = { (U16)(fx * 65535.f), (U16)(fy * 65535.f) };
+                pos.insert(pos.end(), (U8*)p, (U8*)p + sizeof(p));
+                norm.insert(norm.end(), (U8*)n, (U8*)n + sizeof(n));
+                tc.insert(tc.end(), (U8*)t, (U8*)t + sizeof(t));
+                if (rigged)
+                {
+                    // joint, weight (U16), end of influences
+                    weights.push_back((U8)(x % 8));
+                    weights.push_back(0xFF);
+                    weights.push_back(0x7F);
+                    weights.push_back(0xFF);
+                }
+            }
+        }
+
+        for (U32 y = 0; y < grid_size - 1; ++y)
+        {
+            for (U32 x = 0; x < grid_size - 1; ++x)
+            {
+                const U16 i0 = (U16)(y * grid_size + x);
+                const U16 i1 = (U16)(i0 + 1);
+                const U16 i2 = (U16)(i0 + grid_size);
+                const U16 i3 = (U16)(i2 + 1);
+                const U16 tris[6] = { i0, i1, i2, i1, i3, i2 };
+                idx.insert(idx.end(), (U8*)tris, (U8*)tris + sizeof(tris));
+            }
+        }
+
+        LLSD face;
+        face["PositionDomain"]["Min"] = LLSD::emptyArray();
+        face["PositionDomain"]["Min"].append(-0.5);
+        face["PositionDomain"]["Min"].append(-0.5);
+        face["PositionDomain"]["Min"].append(-0.5);
+        face["PositionDomain"]["Max"] = LLSD::emptyArray();
+        face["PositionDomain"]["Max"].append(0.5);
+        face["PositionDomain"]["Max"].append(0.5);
+        face["PositionDomain"]["Max"].append(0.5);
+        face["TexCoord0Domain"]["Min"] = LLSD::emptyArray();
+        face["TexCoord0Domain"]["Min"].append(0.0);
+        face["TexCoord0Domain"]["Min"].append(0.0);
+        face["TexCoord0Domain"]["Max"] = LLSD::emptyArray();
+        face["TexCoord0Domain"]["Max"].append(1.0);
+        face["TexCoord0Domain"]["Max"].append(1.0);
+        face["Position"] = pos;
+        face["Normal"] = norm;
+        face["TexCoord0"] = tc;
+        face["TriangleList"] = idx;
+        if (rigged)
+        {
+            face["Weights"] = weights;
+        }
+
+        LLSD mdl = LLSD::emptyArray();
+        mdl.append(face);
+        mdl.append(face);
+        return zip_llsd(mdl);
+    }
+
+    LLVolumeParams make_mesh_params()
+    {
+        LLVolumeParams params;
+        params.setType(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE);
+        params.setSculptID(LLUUID::generateNewID("llvolume_test mesh"), LL_SCULPT_TYPE_MESH);
+        return params;
+    }
+
+    bool same_bytes(const void* a, const void* b, size_t size)
+    {
+        return (!a && !b) || (a && b && memcmp(a, b, size) == 0);
+    }
+}
+
+namespace tut
+{
+    struct llvolume_test
+    {
+    };
+    typedef test_group<llvolume_test> llvolume_test_t;
+    typedef llvolume_test_t::object llvolume_test_object_t;
+    tut::llvolume_test_t tut_llvolume_test("LLVolume");
+
+    // decoded faces round trip bit for bit
+    template<> template<>
+    void llvolume_test_object_t::test<1>()
+    {
+        std::string lod = make_mesh_lod(32, true);
+        LLVolumeParams params = make_mesh_params();
+
+        LLPointer<LLVolume> decoded = new LLVolume(params, 1.f);
+        ensure("unpack raw LOD", decoded->unpackVolumeFaces((U8*)lod.data(), (S32)lod.size()));
+
+        std::vector<U8> block;
+        ensure("pack decoded faces", decoded->packDecodedFaces(block));
+        ensure_equals("block is 16 byte granular", block.size() % 16, 0);
+
+        LLPointer<LLVolume> cached = new LLVolume(params, 1.f);
+        ensure("unpack decoded faces", cached->unpackDecodedFaces(block.data(), (S32)block.size()));
+        ensure_equals("face count", cached->getNumVolumeFaces(), decoded->getNumVolumeFaces());
+
+        for (S32 i = 0; i < decoded->getNumVolumeFaces(); ++i)
+        {
+            const LLVolumeFace& a = decoded->getVolumeFace(i);
+            const LLVolumeFace& b = cached->getVolumeFace(i);
+            ensure_equals("vertex count", b.mNumVertices, a.mNumVertices);
+            ensure_equals("index count", b.mNumIndices, a.mNumIndices);
+            ensure("optimized", b.mOptimized);
+            ensure("positions", same_bytes(a.mPositions, b.mPositions, sizeof(LLVector4a) * a.mNumVertices));
+            ensure("normals", same_bytes(a.mNormals, b.mNormals, sizeof(LLVector4a) * a.mNumVertices));
+            ensure("texcoords", same_bytes(a.mTexCoords, b.mTexCoords, sizeof(LLVector2) * a.mNumVertices));
+            ensure("tangents", same_bytes(a.mTangents, b.mTangents, sizeof(LLVector4a) * a.mNumVertices));
+            ensure("weights", same_bytes(a.mWeights, b.mWeights, sizeof(LLVector4a) * a.mNumVertices));
+            ensure("indices", same_bytes(a.mIndices, b.mIndices, sizeof(U16) * a.mNumIndices));
+            ensure("extents", same_bytes(a.mExtents, b.mExtents, sizeof(LLVector4a) * 3));
+            ensure("texcoord extents", a.mTexCoordExtents[0] == b.mTexCoordExtents[0] && a.mTexCoordExtents[1] == b.mTexCoordExtents[1]);
+        }
+    }
+
+    // stale or damaged blocks are rejected
+    template<> template<>
+    void llvolume_test_object_t::test<2>()
+    {
+        std::string lod = make_mesh_lod(8, false);
+        LLVolumeParams params = make_mesh_params();
+
+        LLPointer<LLVolume> decoded = new LLVolume(params, 1.f);
+        ensure("unpack raw LOD", decoded->unpackVolumeFaces((U8*)lod.data(), (S32)lod.size()));
+        std::vector<U8> block;
+        ensure("pack decoded faces", decoded->packDecodedFaces(block));
+
+        LLPointer<LLVolume> cached = new LLVolume(params, 1.f);
+        ensure("truncated", !cached->unpackDecodedFaces(block.data(), (S32)block.size() - 16));
+        ensure("empty", !cached->unpackDecodedFaces(block.data(), 0));
+
+        std::vector<U8> bad_version = block;
+        bad_version[4] ^= 0xFF;
+        ensure("version mismatch", !cached->unpackDecodedFaces(bad_version.data(), (S32)bad_version.size()));
+
+        std::vector<U8> bad_magic = block;
+        bad_magic[0] ^= 0xFF;
+        ensure("bad magic", !cached->unpackDecodedFaces(bad_magic.data(), (S32)bad_magic.size()));
+
+        // the last face's indices end the block, padded to 16 bytes
+        const LLVolumeFace& last = decoded->getVolumeFace(decoded->getNumVolumeFaces() - 1);
+        const size_t indices_size = (sizeof(U16) * last.mNumIndices + 0xF) & ~(size_t)0xF;
+        std::vector<U8> bad_index = block;
+        const U16 past_end = (U16)last.mNumVertices;
+        memcpy(&bad_index[block.size() - indices_size], &past_end, sizeof(U16));
+        const S32 faces_before = cached->getNumVolumeFaces();
+        ensure("index past the vertices", !cached->unpackDecodedFaces(bad_index.data(), (S32)bad_index.size()));
+        ensure_equals("rejected before touching the faces", cached->getNumVolumeFaces(), faces_before);
+
+        ensure("intact block still unpacks", cached->unpackDecodedFaces(block.data(), (S32)block.size()));
+    }
+
+    // "region re-entry" for a set of meshes, cold (inflate, parse, optimize,
+    // tangents) versus warm (decoded cache block), gives the same faces
+    template<> template<>
+    void llvolume_test_object_t::test<3>()
+    {
+        const S32 MESH_COUNT = Benchmark::size(64, 4);
+        LLVolumeParams params = make_mesh_params();
+        std::vector<std::string> lods;
+        std::vector<std::vector<U8>> blocks(MESH_COUNT);
+        for (S32 i = 0; i < MESH_COUNT; ++i)
+        {
+            lods.push_back(make_mesh_lod(48 + (i % 4) * 8, (i % 2) == 0));
+        }
+
+        Benchmark bench(stringize("Region re-entry, ", MESH_COUNT, " meshes, ms"));
+        std::vector<S32> cold_vertices(MESH_COUNT);
+        for (S32 i = 0; i < MESH_COUNT; ++i)
+        {
+            LLPointer<LLVolume> volume = new LLVolume(params, 1.f);
+            ensure("cold unpack", volume->unpackVolumeFaces((U8*)lods[i].data(), (S32)lods[i].size()));
+            ensure("pack", volume->packDecodedFaces(blocks[i]));
+            cold_vertices[i] = volume->getVolumeFace(0).mNumVertices;
+        }
+        bench.report("cold                ", bench.elapsed_ms());
+
+        bench.start();
+        for (S32 i = 0; i < MESH_COUNT; ++i)
+        {
+            LLPointer<LLVolume> volume = new LLVolume(params, 1.f);
+            ensure("warm unpack", volume->unpackDecodedFaces(blocks[i].data(), (S32)blocks[i].size()));
+            ensure_equals("warm vertices", volume->getVolumeFace(0).mNumVertices, cold_vertices[i]);
+        }
+        bench.report("warm decoded cache  ", bench.elapsed_ms());
+    }
+}
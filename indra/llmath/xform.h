@@ -139,6 +139,15 @@ public:
     const LLMatrix4&    getWorldMatrix() const      { return mWorldMatrix; }
     void setWorldMatrix (const LLMatrix4& mat)   { mWorldMatrix = mat; }
 
+    // Stores the results of updateMatrix(false) when they were computed
+    // somewhere else, see LLFlatSkeleton
+    void setWorldTransform(const LLVector3& pos, const LLQuaternion& rot, const LLMatrix4& mat)
+    {
+        mWorldPosition = pos;
+        mWorldRotation = rot;
+        mWorldMatrix = mat;
+    }
+
     void init()
     {
         mWorldMatrix.setIdentity();
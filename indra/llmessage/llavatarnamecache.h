@@ -30,6 +30,7 @@
 
 #include "llavatarname.h"   // for convenience
 #include "llsingleton.h"
+#include "lluuidhashmap.h"
 #include <boost/signals2.hpp>
 #include <set>
 
@@ -177,7 +178,7 @@ private:
     signal_map_t mSignalMap;
 
     // The cache at last, i.e. avatar names we know about.
-    typedef std::map<LLUUID, LLAvatarName> cache_t;
+    typedef lluuid_hot_map<LLAvatarName> cache_t;
     cache_t mCache;
 
     // Time when unrefreshed cached names were checked last.
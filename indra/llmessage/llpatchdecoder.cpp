@@ -0,0 +1,405 @@
+/**
+ * @file llpatchdecoder.cpp
+ * @brief Reentrant decoder for DCT compressed layer patches.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llpatchdecoder.h"
+
+#include "llbitpack.h"
+#include "llmath.h"
+#include "llvector4a.h"
+
+namespace
+{
+    // Reads an LLBitPack through a 64 bit buffer, most significant bit
+    // first like bitUnpack(), and hands the position back when done so
+    // that the bitpack can carry on from there.
+    class BitReader
+    {
+    public:
+        BitReader(LLBitPack& bitpack)
+            : mBitPack(bitpack),
+              mEnd((U64)bitpack.mMaxSize * 8),
+              mBits(0),
+              mCount(0),
+              mOverflow(false)
+        {
+            mPos = (U64)bitpack.mBufferSize * 8 - bitpack.mLoadSize;
+            mByte = bitpack.mBufferSize;
+            if (bitpack.mLoadSize)
+            {
+                // unread bits of the current byte are at the top of mLoad
+                mBits = (U64)bitpack.mLoad << 56;
+                mCount = bitpack.mLoadSize;
+            }
+        }
+
+        ~BitReader()
+        {
+            const U64 pos = llmin(mPos, mEnd);
+            const U32 used = (U32)(pos & 7);
+            mBitPack.mBufferSize = (U32)((pos + 7) >> 3);
+            mBitPack.mLoadSize = used ? 8 - used : 0;
+            mBitPack.mLoad = used ? (U8)(mBitPack.mBuffer[pos >> 3] << used) : 0;
+        }
+
+        // Up to 32 bits, bits past the end of the buffer read as zero
+        U32 peek(U32 bits)
+        {
+            if (mCount < bits)
+            {
+                refill();
+            }
+            return (U32)(mBits >> (64 - bits));
+        }
+
+        void skip(U32 bits)
+        {
+            if (mCount < bits)
+            {
+                refill();
+                if (mCount < bits)
+                {
+                    mOverflow = true;
+                    mCount = bits;
+                }
+            }
+            mBits <<= bits;
+            mCount -= bits;
+            mPos += bits;
+        }
+
+        U32 read(U32 bits)
+        {
+            const U32 value = peek(bits);
+            skip(bits);
+            return value;
+        }
+
+        // Fields wider than a byte are unpacked a byte at a time into
+        // successive little endian bytes, see bitUnpack()
+        U32 readLE(U32 bits)
+        {
+            const U32 raw = read(bits);
+            U32 value = 0;
+            U32 shift = 0;
+            while (bits > 8)
+            {
+                bits -= 8;
+                value |= ((raw >> bits) & 0xFF) << shift;
+                shift += 8;
+            }
+            return value | ((raw & ((1U << bits) - 1)) << shift);
+        }
+
+        // Unread bits sitting in the bit buffer
+        U32 buffered() const { return mCount; }
+        U64 top() const { return mBits; }
+
+        bool overflow() const { return mOverflow; }
+
+    private:
+        void refill()
+        {
+            while (mCount <= 56 && mByte < mBitPack.mMaxSize)
+            {
+                mBits |= (U64)mBitPack.mBuffer[mByte++] << (56 - mCount);
+                mCount += 8;
+            }
+        }
+
+        LLBitPack& mBitPack;
+        U64 mPos;
+        U64 mEnd;
+        U32 mByte;
+        U64 mBits;
+        U32 mCount;
+        bool mOverflow;
+    };
+
+    // acc[0..3] += scalar*row[0..15]
+    inline void madd16(LLVector4a* acc, const F32* row, const LLVector4a& scalar)
+    {
+        LLVector4a t0, t1, t2, t3;
+        t0.load4a(row);
+        t1.load4a(row + 4);
+        t2.load4a(row + 8);
+        t3.load4a(row + 12);
+        t0.mul(scalar);
+        t1.mul(scalar);
+        t2.mul(scalar);
+        t3.mul(scalar);
+        acc[0].add(t0);
+        acc[1].add(t1);
+        acc[2].add(t2);
+        acc[3].add(t3);
+    }
+
+    // In place inverse DCT of a SIZE*SIZE block, only the first rows and
+    // cols coefficients of which can be nonzero, followed by out*scale +
+    // offset.  Works on 16 outputs at a time so the accumulators stay in
+    // registers.
+    template <S32 SIZE>
+    void idct(F32* block, F32* temp, const F32* cosines, S32 rows, S32 cols, F32 scale, F32 offset)
+    {
+        LLVector4a acc[4];
+
+        // Columns: temp[n][c] = sum over u of block[u][c]*cos[u][n]
+        for (S32 n = 0; n < SIZE; n++)
+        {
+            for (S32 c = 0; c < SIZE; c += 16)
+            {
+                acc[0].clear();
+                acc[1].clear();
+                acc[2].clear();
+                acc[3].clear();
+                for (S32 u = 0; u < rows; u++)
+                {
+                    madd16(acc, block + u*SIZE + c, LLVector4a(cosines[u*SIZE + n]));
+                }
+                F32* dst = temp + n*SIZE + c;
+                acc[0].store4a(dst);
+                acc[1].store4a(dst + 4);
+                acc[2].store4a(dst + 8);
+                acc[3].store4a(dst + 12);
+            }
+        }
+
+        // Lines: block[l][n] = sum over u of temp[l][u]*cos[u][n], columns
+        // of temp past the last nonzero coefficient column are zero
+        const LLVector4a scale4(scale);
+        const LLVector4a offset4(offset);
+        for (S32 l = 0; l < SIZE; l++)
+        {
+            const F32* line = temp + l*SIZE;
+            for (S32 n = 0; n < SIZE; n += 16)
+            {
+                acc[0].clear();
+                acc[1].clear();
+                acc[2].clear();
+                acc[3].clear();
+                for (S32 u = 0; u < cols; u++)
+                {
+                    madd16(acc, cosines + u*SIZE + n, LLVector4a(line[u]));
+                }
+                F32* dst = block + l*SIZE + n;
+                for (S32 v = 0; v < 4; v++)
+                {
+                    acc[v].mul(scale4);
+                    acc[v].add(offset4);
+                    acc[v].store4a(dst + v*4);
+                }
+            }
+        }
+    }
+}
+
+LLPatchDecoder::LLPatchDecoder()
+    : mSize(0)
+{
+}
+
+bool LLPatchDecoder::decodeGroupHeader(LLBitPack& bitpack, LLGroupHeader& gopp)
+{
+    BitReader reader(bitpack);
+    gopp.stride = (U16)reader.readLE(16);
+    gopp.patch_size = (U8)reader.read(8);
+    gopp.layer_type = (U8)reader.read(8);
+    return !reader.overflow() && setPatchSize(gopp.patch_size);
+}
+
+bool LLPatchDecoder::setPatchSize(S32 size)
+{
+    if (size != NORMAL_PATCH_SIZE && size != LARGE_PATCH_SIZE)
+    {
+        return false;
+    }
+    if (size == mSize)
+    {
+        return true;
+    }
+    mSize = size;
+
+    const F32 oosob = F_PI*0.5f/size;
+    for (S32 u = 0; u < size; u++)
+    {
+        for (S32 n = 0; n < size; n++)
+        {
+            mDequantize[u*size + n] = 1.f + 2.f*(u + n);
+            mICosines[u*size + n] = u ? cosf((2.f*n + 1.f)*u*oosob) : OO_SQRT2;
+        }
+    }
+
+    // Zigzag order, same walk as build_decopy_matrix()
+    S32 i = 0, j = 0, count = 0;
+    bool b_diag = false;
+    bool b_right = true;
+    while (i < size && j < size)
+    {
+        mDeCopy[j*size + i] = count++;
+
+        if (!b_diag)
+        {
+            if (b_right)
+            {
+                if (i < size - 1)
+                    i++;
+                else
+                    j++;
+            }
+            else
+            {
+                if (j < size - 1)
+                    j++;
+                else
+                    i++;
+            }
+            b_right = !b_right;
+            b_diag = true;
+        }
+        else if (b_right)
+        {
+            i++;
+            j--;
+            b_diag = (i != size - 1) && (j != 0);
+        }
+        else
+        {
+            i--;
+            j++;
+            b_diag = (i != 0) && (j != size - 1);
+        }
+    }
+    return true;
+}
+
+bool LLPatchDecoder::decodePatchHeader(LLBitPack& bitpack, LLPatchHeader& ph)
+{
+    BitReader reader(bitpack);
+    ph.quant_wbits = (U8)reader.read(8);
+    if (END_OF_PATCHES == ph.quant_wbits)
+    {
+        ph.dc_offset = 0.f;
+        ph.range = 0;
+        ph.patchids = 0;
+        return false;
+    }
+
+    const U32 dc_offset = reader.readLE(32);
+    memcpy(&ph.dc_offset, &dc_offset, sizeof(F32));
+    ph.range = (U16)reader.readLE(16);
+    ph.patchids = (U16)reader.readLE(10);
+    return !reader.overflow();
+}
+
+bool LLPatchDecoder::decodePatch(LLBitPack& bitpack, const LLPatchHeader& ph, S32* patch)
+{
+    const S32 count = mSize*mSize;
+    const U32 wbits = (ph.quant_wbits & 0xf) + 2;
+
+    BitReader reader(bitpack);
+    S32 i = 0;
+    while (i < count)
+    {
+        // A whole byte of zero codes at once, the common case once the
+        // low frequencies are done
+        if (reader.buffered() >= 8 && !(reader.top() >> 56))
+        {
+            const S32 run = llmin(8, count - i);
+            reader.skip(run);
+            for (S32 k = 0; k < run; ++k)
+            {
+                patch[i++] = 0;
+            }
+            continue;
+        }
+
+        // 0 zero, 10 end of block, 110 positive value, 111 negative value
+        const U32 code = reader.peek(3);
+        if (!(code & 0x4))
+        {
+            reader.skip(1);
+            patch[i++] = 0;
+        }
+        else if (!(code & 0x2))
+        {
+            reader.skip(2);
+            while (i < count)
+            {
+                patch[i++] = 0;
+            }
+        }
+        else
+        {
+            reader.skip(3);
+            const S32 value = (S32)reader.readLE(wbits);
+            patch[i++] = (code & 0x1) ? -value : value;
+        }
+    }
+    return !reader.overflow();
+}
+
+void LLPatchDecoder::decompressPatch(const S32* patch, const LLPatchHeader& ph, F32* out, S32 stride)
+{
+    const S32 size = mSize;
+    const S32 prequant = (ph.quant_wbits >> 4) + 2;
+    const F32 mult = (F32)ph.range/(F32)(1<<prequant);
+    const F32 addval = mult*(F32)(1<<(prequant - 1)) + ph.dc_offset;
+
+    // Dequantize into natural order, noting how far the nonzero
+    // coefficients extend in each direction
+    S32 rows = 0, cols = 0;
+    for (S32 j = 0; j < size; j++)
+    {
+        for (S32 i = 0; i < size; i++)
+        {
+            const S32 k = j*size + i;
+            const S32 c = patch[mDeCopy[k]];
+            mBlock[k] = c*mDequantize[k];
+            if (c)
+            {
+                rows = llmax(rows, j + 1);
+                cols = llmax(cols, i + 1);
+            }
+        }
+    }
+
+    // The 2/size normalization of the line pass is folded into the scale
+    const F32 scale = 2.f/size*mult;
+    if (size == NORMAL_PATCH_SIZE)
+    {
+        idct<NORMAL_PATCH_SIZE>(mBlock, mTemp, mICosines, rows, cols, scale, addval);
+    }
+    else
+    {
+        idct<LARGE_PATCH_SIZE>(mBlock, mTemp, mICosines, rows, cols, scale, addval);
+    }
+
+    for (S32 l = 0; l < size; l++)
+    {
+        memcpy(out + l*stride, mBlock + l*size, size*sizeof(F32));
+    }
+}
@@ -0,0 +1,85 @@
+/**
+ * @file llpatchdecoder.h
+ * @brief Reentrant decoder for DCT compressed layer patches.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPATCHDECODER_H
+#define LL_LLPATCHDECODER_H
+
+#include "llmemory.h"
+#include "patch_dct.h"
+
+class LLBitPack;
+
+// Does the work of decode_patch_header(), decode_patch() and
+// decompress_patch() without their shared globals, so that each thread
+// can decode LayerData packets with its own instance.
+//
+// Coefficients are read through a 64 bit bit buffer instead of one
+// bitUnpack() call per bit, and the inverse DCT is done four columns at a
+// time with LLVector4a, skipping the rows and columns beyond the last
+// nonzero coefficient.  Output matches the scalar path to within float
+// rounding.
+//
+// Reads are bounds checked against the LLBitPack buffer size, a truncated
+// packet fails the decode instead of reading past the end.
+LL_ALIGN_PREFIX(16)
+class LLPatchDecoder
+{
+public:
+    LLPatchDecoder();
+
+    // Reads the group header and prepares for its patch size.  Returns
+    // false if the patch size is not 16 or 32 or the packet is truncated.
+    bool decodeGroupHeader(LLBitPack& bitpack, LLGroupHeader& gopp);
+
+    bool setPatchSize(S32 size);
+    S32 getPatchSize() const { return mSize; }
+
+    // Returns false at END_OF_PATCHES or if the packet is truncated, check
+    // ph.quant_wbits to tell which.
+    bool decodePatchHeader(LLBitPack& bitpack, LLPatchHeader& ph);
+
+    // Unpacks the size*size quantized coefficients of one patch, in the
+    // order they were sent.  Returns false if the packet is truncated.
+    bool decodePatch(LLBitPack& bitpack, const LLPatchHeader& ph, S32* patch);
+
+    // Dequantizes and inverse transforms one patch, writing size rows of
+    // heights to out, stride floats apart.
+    void decompressPatch(const S32* patch, const LLPatchHeader& ph, F32* out, S32 stride);
+
+private:
+    S32 mSize;
+
+    // Natural order, first row of the cosines is prescaled by 1/sqrt(2)
+    LL_ALIGN_16(F32 mDequantize[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE]);
+    LL_ALIGN_16(F32 mICosines[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE]);
+    S32 mDeCopy[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+
+    // Scratch
+    LL_ALIGN_16(F32 mBlock[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE]);
+    LL_ALIGN_16(F32 mTemp[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE]);
+} LL_ALIGN_POSTFIX(16);
+
+#endif // LL_LLPATCHDECODER_H
@@ -0,0 +1,274 @@
+/**
+ * @file llpatchdecoder_test.cpp
+ * @brief Test cases for LLPatchDecoder against the legacy patch decoder
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include <vector>
+
+#include "../llpatchdecoder.h"
+#include "../patch_code.h"
+#include "../patch_dct.h"
+#include "llbitpack.h"
+#include "llmath.h"
+#include "stringize.h"
+
+#include "../test/lltut.h"
+#include "../test/benchmark.h"
+
+namespace
+{
+    const S32 REGION_WIDTH = 256;
+    const char LAND_LAYER_CODE = 'L';
+
+    // Rolling hills with some high frequency detail, deterministic
+    std::vector<F32> make_heights()
+    {
+        std::vector<F32> heights(REGION_WIDTH*REGION_WIDTH);
+        U32 seed = 4242;
+        for (S32 y = 0; y < REGION_WIDTH; y++)
+        {
+            for (S32 x = 0; x < REGION_WIDTH; x++)
+            {
+                seed = seed*1664525 + 1013904223;
+                heights[y*REGION_WIDTH + x] = 22.f
+                    + 18.f*sinf(x*0.031f)*cosf(y*0.027f)
+                    + 4.f*sinf((x + 2*y)*0.19f)
+                    + (F32)(seed >> 24)/256.f;
+            }
+        }
+        return heights;
+    }
+
+    // Encodes the whole region in one packet, like a terrain upload would
+    // arrive spread over many LayerData messages
+    std::vector<U8> encode_region(const std::vector<F32>& heights, S32 patch_size)
+    {
+        const S32 patches_per_edge = REGION_WIDTH/patch_size;
+        std::vector<U8> buffer(REGION_WIDTH*REGION_WIDTH*4);
+        LLBitPack bitpack(buffer.data(), (U32)buffer.size());
+
+        init_patch_compressor(patch_size, REGION_WIDTH, LAND_LAYER_CODE);
+        LLGroupHeader gh;
+        get_patch_group_header(&gh);
+        init_patch_coding(bitpack);
+        code_patch_group_header(bitpack, &gh);
+
+        S32 cpatch[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+        for (S32 j = 0; j < patches_per_edge; j++)
+        {
+            for (S32 i = 0; i < patches_per_edge; i++)
+            {
+                F32* patch = const_cast<F32*>(&heights[j*patch_size*REGION_WIDTH + i*patch_size]);
+                LLPatchHeader ph;
+                F32 zmax, zmin;
+                prescan_patch(patch, &ph, zmax, zmin);
+                compress_patch(patch, cpatch, &ph, 10);
+                ph.patchids = (U16)((i << 5) | j);
+                code_patch_header(bitpack, &ph, cpatch);
+                code_patch(bitpack, cpatch, 0);
+            }
+        }
+        code_end_of_data(bitpack);
+        buffer.resize(bitpack.flushBitPack());
+        return buffer;
+    }
+
+    S32 decode_legacy(std::vector<U8>& data, std::vector<F32>& out)
+    {
+        LLBitPack bitpack(data.data(), (U32)data.size());
+        LLGroupHeader gh;
+        init_patch_decoding(bitpack);
+        decode_patch_group_header(bitpack, &gh);
+        init_patch_decompressor(gh.patch_size);
+        gh.stride = REGION_WIDTH;
+        set_group_of_patch_header(&gh);
+
+        S32 patch[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+        S32 count = 0;
+        LLPatchHeader ph;
+        while (true)
+        {
+            decode_patch_header(bitpack, &ph);
+            if (ph.quant_wbits == END_OF_PATCHES)
+            {
+                break;
+            }
+            const S32 i = ph.patchids >> 5;
+            const S32 j = ph.patchids & 0x1F;
+            decode_patch(bitpack, patch);
+            decompress_patch(&out[j*gh.patch_size*REGION_WIDTH + i*gh.patch_size], patch, &ph);
+            ++count;
+        }
+        return count;
+    }
+
+    S32 decode_new(LLPatchDecoder& decoder, std::vector<U8>& data, std::vector<F32>& out)
+    {
+        LLBitPack bitpack(data.data(), (U32)data.size());
+        LLGroupHeader gh;
+        if (!decoder.decodeGroupHeader(bitpack, gh))
+        {
+            return -1;
+        }
+
+        S32 patch[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+        S32 count = 0;
+        LLPatchHeader ph;
+        while (decoder.decodePatchHeader(bitpack, ph))
+        {
+            if (!decoder.decodePatch(bitpack, ph, patch))
+            {
+                return -1;
+            }
+            const S32 i = ph.patchids >> 5;
+            const S32 j = ph.patchids & 0x1F;
+            decoder.decompressPatch(patch, ph, &out[j*gh.patch_size*REGION_WIDTH + i*gh.patch_size], REGION_WIDTH);
+            ++count;
+        }
+        return ph.quant_wbits == END_OF_PATCHES ? count : -1;
+    }
+
+    F32 max_difference(const std::vector<F32>& a, const std::vector<F32>& b)
+    {
+        F32 diff = 0.f;
+        for (size_t n = 0; n < a.size(); ++n)
+        {
+            diff = llmax(diff, fabsf(a[n] - b[n]));
+        }
+        return diff;
+    }
+}
+
+namespace tut
+{
+    struct patchdecoder
+    {
+    };
+    typedef test_group<patchdecoder> patchdecoder_t;
+    typedef patchdecoder_t::object patchdecoder_object_t;
+    tut::patchdecoder_t tut_patchdecoder("LLPatchDecoder");
+
+    // matches the legacy decoder for both patch sizes
+    template<> template<>
+    void patchdecoder_object_t::test<1>()
+    {
+        const std::vector<F32> heights = make_heights();
+        for (S32 size : { (S32)NORMAL_PATCH_SIZE, (S32)LARGE_PATCH_SIZE })
+        {
+            std::vector<U8> data = encode_region(heights, size);
+            std::vector<F32> legacy(heights.size()), decoded(heights.size());
+            const S32 patches = (REGION_WIDTH/size)*(REGION_WIDTH/size);
+            ensure_equals("legacy patch count", decode_legacy(data, legacy), patches);
+
+            LLPatchDecoder decoder;
+            ensure_equals("patch count", decode_new(decoder, data, decoded), patches);
+            ensure("matches legacy", max_difference(legacy, decoded) < 0.001f);
+            ensure("close to source", max_difference(heights, decoded) < 2.f);
+        }
+    }
+
+    // truncated or malformed packets fail instead of reading past the end
+    template<> template<>
+    void patchdecoder_object_t::test<2>()
+    {
+        std::vector<U8> data = encode_region(make_heights(), NORMAL_PATCH_SIZE);
+        std::vector<F32> out(REGION_WIDTH*REGION_WIDTH);
+        LLPatchDecoder decoder;
+
+        std::vector<U8> truncated(data.begin(), data.begin() + data.size()/2);
+        truncated.shrink_to_fit();
+        ensure_equals("truncated", decode_new(decoder, truncated, out), -1);
+
+        std::vector<U8> bad_size(data);
+        bad_size[2] = 24;
+        ensure_equals("bad patch size", decode_new(decoder, bad_size, out), -1);
+    }
+
+    // the bitpack position is handed back, so legacy and new calls mix
+    template<> template<>
+    void patchdecoder_object_t::test<3>()
+    {
+        std::vector<U8> data = encode_region(make_heights(), NORMAL_PATCH_SIZE);
+        LLBitPack bitpack(data.data(), (U32)data.size());
+        LLGroupHeader gh;
+        decode_patch_group_header(bitpack, &gh);
+
+        LLPatchDecoder decoder;
+        ensure("patch size", decoder.setPatchSize(gh.patch_size));
+        S32 patch[NORMAL_PATCH_SIZE*NORMAL_PATCH_SIZE];
+        LLPatchHeader ph;
+        S32 count = 0;
+        for (bool legacy = false; ; legacy = !legacy)
+        {
+            if (legacy)
+            {
+                decode_patch_header(bitpack, &ph);
+                if (ph.quant_wbits == END_OF_PATCHES)
+                {
+                    break;
+                }
+                decode_patch(bitpack, patch);
+            }
+            else
+            {
+                if (!decoder.decodePatchHeader(bitpack, ph))
+                {
+                    break;
+                }
+                ensure("patch", decoder.decodePatch(bitpack, ph, patch));
+            }
+            ensure_equals("patch id", (S32)ph.patchids, ((count % 16) << 5) | (count / 16));
+            ++count;
+        }
+        ensure_equals("all patches", count, 256);
+    }
+
+    // a decoder reused for pass after pass over a full 256m region of 16m
+    // patches keeps matching the legacy decoder
+    template<> template<>
+    void patchdecoder_object_t::test<4>()
+    {
+        std::vector<U8> data = encode_region(make_heights(), NORMAL_PATCH_SIZE);
+        std::vector<F32> legacy(REGION_WIDTH*REGION_WIDTH), out(REGION_WIDTH*REGION_WIDTH);
+        const S32 passes = Benchmark::size(50, 2);
+
+        Benchmark bench(stringize("Region layer data decode, ", data.size(), " bytes, 256 patches, ms"));
+        for (S32 pass = 0; pass < passes; ++pass)
+        {
+            ensure_equals("legacy decode", decode_legacy(data, legacy), 256);
+        }
+        bench.report("legacy         ", bench.elapsed_ms() / passes);
+
+        LLPatchDecoder decoder;
+        bench.start();
+        for (S32 pass = 0; pass < passes; ++pass)
+        {
+            ensure_equals("decode", decode_new(decoder, data, out), 256);
+        }
+        bench.report("LLPatchDecoder ", bench.elapsed_ms() / passes);
+        ensure("matches legacy", max_difference(legacy, out) < 0.001f);
+    }
+}
@@ -72,6 +72,36 @@ std::vector<std::pair<LLCoordGL, F32> > LLFontGL::sOriginStack;
 const F32 PAD_UVY = 0.5f; // half of vertical padding between glyphs in the glyph texture
 const F32 DROP_SHADOW_SOFT_STRENGTH = 0.3f;
 
+namespace
+{
+    // Decodes UTF-8 text into a NUL terminated buffer for measuring it, on the
+    // stack unless the text is long, rather than into a new LLWString each time
+    class LLWCharsFromUTF8
+    {
+    public:
+        LLWCharsFromUTF8(const std::string& utf8text)
+        {
+            llwchar* buffer = mStack;
+            if (utf8text.size() >= LL_ARRAY_SIZE(mStack))
+            {
+                mHeap.resize(utf8text.size() + 1);
+                buffer = mHeap.data();
+            }
+            buffer[utf8str_to_wchars(utf8text, std::span<llwchar>(buffer, utf8text.size()))] = 0;
+            mChars = buffer;
+        }
+        LLWCharsFromUTF8(const LLWCharsFromUTF8&) = delete;
+        LLWCharsFromUTF8& operator=(const LLWCharsFromUTF8&) = delete;
+
+        const llwchar* c_str() const { return mChars; }
+
+    private:
+        llwchar mStack[256];
+        std::vector<llwchar> mHeap;
+        const llwchar* mChars;
+    };
+} // anonymous namespace
+
 LLFontGL::LLFontGL()
 {
 }
@@ -482,7 +512,7 @@ S32 LLFontGL::getLineHeight() const
 
 S32 LLFontGL::getWidth(const std::string& utf8text) const
 {
-    LLWString wtext = utf8str_to_wstring(utf8text);
+    LLWCharsFromUTF8 wtext(utf8text);
     return getWidth(wtext.c_str(), 0, S32_MAX);
 }
 
@@ -493,7 +523,7 @@ S32 LLFontGL::getWidth(const llwchar* wchars) const
 
 S32 LLFontGL::getWidth(const std::string& utf8text, S32 begin_offset, S32 max_chars) const
 {
-    LLWString wtext = utf8str_to_wstring(utf8text);
+    LLWCharsFromUTF8 wtext(utf8text);
     return getWidth(wtext.c_str(), begin_offset, max_chars);
 }
 
@@ -505,7 +535,7 @@ S32 LLFontGL::getWidth(const llwchar* wchars, S32 begin_offset, S32 max_chars) c
 
 F32 LLFontGL::getWidthF32(const std::string& utf8text) const
 {
-    LLWString wtext = utf8str_to_wstring(utf8text);
+    LLWCharsFromUTF8 wtext(utf8text);
     return getWidthF32(wtext.c_str(), 0, S32_MAX);
 }
 
@@ -516,7 +546,7 @@ F32 LLFontGL::getWidthF32(const llwchar* wchars) const
 
 F32 LLFontGL::getWidthF32(const std::string& utf8text, S32 begin_offset, S32 max_chars) const
 {
-    LLWString wtext = utf8str_to_wstring(utf8text);
+    LLWCharsFromUTF8 wtext(utf8text);
     return getWidthF32(wtext.c_str(), begin_offset, max_chars);
 }
 
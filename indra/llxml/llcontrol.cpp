@@ -153,7 +153,8 @@ LLControlVariable::LLControlVariable(const std::string& name, eControlType type,
       mComment(comment),
       mType(type),
       mPersist(persist),
-      mHideFromSettingsEditor(hidefromsettingseditor)
+      mHideFromSettingsEditor(hidefromsettingseditor),
+      mChangePending(false)
 {
     if ((persist != PERSIST_NO) && mComment.empty())
     {
@@ -258,6 +259,21 @@ void LLControlVariable::setValue(const LLSD& new_value, bool saved_value)
     }
 }
 
+void LLControlVariable::firePropertyChanged(const LLSD& previous_value)
+{
+    mCacheSignal(this, mValues.back(), previous_value);
+    // a change already held back goes with it, so that listeners see the
+    // changes in order
+    if (LLControlTransaction::sDepth > 0 || mChangePending)
+    {
+        LLControlTransaction::holdBack(this, previous_value);
+    }
+    else
+    {
+        mCommitSignal(this, mValues.back(), previous_value);
+    }
+}
+
 void LLControlVariable::setDefaultValue(const LLSD& value)
 {
     // Set the control variables value and make it
@@ -341,6 +357,56 @@ LLSD LLControlVariable::getSaveValue() const
     return mValues[0];
 }
 
+////////////////////////////////////////////////////////////////////////////
+// LLControlTransaction
+
+S32 LLControlTransaction::sDepth = 0;
+bool LLControlTransaction::sDeliverOnEnd = false;
+std::vector<std::pair<LLControlVariablePtr, LLSD> > LLControlTransaction::sPendingChanges;
+
+LLControlTransaction::LLControlTransaction(eDelivery delivery)
+{
+    ++sDepth;
+    sDeliverOnEnd = sDeliverOnEnd || (delivery == DELIVER_ON_END);
+}
+
+LLControlTransaction::~LLControlTransaction()
+{
+    if (--sDepth == 0 && sDeliverOnEnd)
+    {
+        sDeliverOnEnd = false;
+        deliverPendingChanges();
+    }
+}
+
+// static
+void LLControlTransaction::holdBack(LLControlVariable* control, const LLSD& previous_value)
+{
+    if (!control->mChangePending)
+    {
+        control->mChangePending = true;
+        sPendingChanges.emplace_back(control, previous_value);
+    }
+}
+
+// static
+void LLControlTransaction::deliverPendingChanges()
+{
+    // Listeners may set controls in turn. A control still waiting its turn
+    // here fires once, with the latest value; the rest fire as usual.
+    std::vector<std::pair<LLControlVariablePtr, LLSD> > changes;
+    changes.swap(sPendingChanges);
+    for (auto& [control, previous_value] : changes)
+    {
+        control->mChangePending = false;
+        // nothing to tell if it was set back to where it started
+        if (!control->llsd_compare(control->mValues.back(), previous_value))
+        {
+            control->mCommitSignal(control.get(), control->mValues.back(), previous_value);
+        }
+    }
+}
+
 LLPointer<LLControlVariable> LLControlGroup::getControl(std::string_view name)
 {
     if (mSettingsProfile)
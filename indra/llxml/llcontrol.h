@@ -34,6 +34,9 @@
 #include "llrefcount.h"
 #include "llinstancetracker.h"
 
+#include <atomic>
+#include <mutex>
+#include <type_traits>
 #include <vector>
 
 #include <boost/bind.hpp>
@@ -68,6 +71,8 @@ class LLControlVariable : public LLRefCount
     LOG_CLASS(LLControlVariable);
 
     friend class LLControlGroup;
+    friend class LLControlTransaction;
+    template <class T> friend class LLControlCache;
 
 public:
     typedef boost::signals2::signal<bool(LLControlVariable* control, const LLSD&), boost_boolean_combiner> validate_signal_t;
@@ -90,6 +95,11 @@ private:
 
     commit_signal_t mCommitSignal;
     validate_signal_t mValidateSignal;
+    // LLControlCaches, which are updated even while commit signals are held
+    // back by an LLControlTransaction
+    commit_signal_t mCacheSignal;
+    // whether an LLControlTransaction holds back a commit signal
+    bool            mChangePending;
 
 public:
     LLControlVariable(const std::string& name, eControlType type,
@@ -127,16 +137,47 @@ public:
     void setComment(const std::string& comment);
 
 private:
-    void firePropertyChanged(const LLSD &pPreviousValue)
-    {
-        mCommitSignal(this, mValues.back(), pPreviousValue);
-    }
+    void firePropertyChanged(const LLSD &pPreviousValue);
     LLSD getComparableValue(const LLSD& value);
     bool llsd_compare(const LLSD& a, const LLSD & b);
 };
 
 typedef LLPointer<LLControlVariable> LLControlVariablePtr;
 
+//! Holds back the commit signals of controls set while one is in scope,
+//! for bulk changes such as loading a graphics preset. Each control that
+//! changed fires once, with the value it had before the first change, when
+//! deliverPendingChanges() is next called, once a frame. LLCachedControls
+//! are kept current throughout. Main thread only; transactions nest.
+class LLControlTransaction
+{
+public:
+    enum eDelivery
+    {
+        DELIVER_NEXT_FRAME,         // leave them to the next deliverPendingChanges()
+        DELIVER_ON_END              // deliver them as the outermost transaction ends
+    };
+
+    LLControlTransaction(eDelivery delivery = DELIVER_NEXT_FRAME);
+    ~LLControlTransaction();
+
+    LLControlTransaction(const LLControlTransaction&) = delete;
+    LLControlTransaction& operator=(const LLControlTransaction&) = delete;
+
+    //! Fires the commit signals held back by transactions that have ended.
+    static void deliverPendingChanges();
+    static bool hasPendingChanges() { return !sPendingChanges.empty(); }
+
+private:
+    friend class LLControlVariable;
+    static void holdBack(LLControlVariable* control, const LLSD& previous_value);
+
+    static S32 sDepth;
+    static bool sDeliverOnEnd;
+    // each control with its value from before the first change
+    static std::vector<std::pair<LLControlVariablePtr, LLSD> > sPendingChanges;
+};
+
 //! Helper functions for converting between static types and LLControl values
 template <class T>
 eControlType get_control_type()
@@ -286,6 +327,40 @@ public:
 };
 
 
+//! The value of an LLControlCache as seen from other threads. Reads are
+//! lock free for types that fit in a word, which covers most controls read
+//! every frame; larger types are copied under a lock.
+template <class T, bool LOCK_FREE = std::is_trivially_copyable_v<T> && sizeof(T) <= sizeof(U64)>
+class LLControlSnapshot
+{
+public:
+    T load() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mValue;
+    }
+    void store(const T& value)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mValue = value;
+    }
+
+private:
+    mutable std::mutex mMutex;
+    T mValue{};
+};
+
+template <class T>
+class LLControlSnapshot<T, true>
+{
+public:
+    T load() const { return mValue.load(std::memory_order_acquire); }
+    void store(const T& value) { mValue.store(value, std::memory_order_release); }
+
+private:
+    std::atomic<T> mValue{};
+};
+
 //! Publish/Subscribe object to interact with LLControlGroups.
 
 //! Use an LLCachedControl instance to connect to a LLControlVariable
@@ -331,16 +406,22 @@ public:
 
     const T& getValue() const { return mCachedValue; }
 
+    // These two are safe from any thread.
+    T getSnapshot() const { return mSnapshot.load(); }
+    // changes each time the value does
+    U32 getVersion() const { return mVersion.load(std::memory_order_acquire); }
+
 private:
     void bindToControl(LLControlGroup& group, const std::string& name)
     {
         LLControlVariablePtr controlp = group.getControl(name);
         mType = controlp->type();
         mCachedValue = convert_from_llsd<T>(controlp->get(), mType, name);
+        mSnapshot.store(mCachedValue);
 
         // Add a listener to the controls signal...
-        // NOTE: All listeners connected to 0 group, for guaranty that variable handlers (gSavedSettings) call last
-        mConnection = controlp->getSignal()->connect(0,
+        // NOTE: The cache signal fires before the commit signal, for guaranty that variable handlers (gSavedSettings) read the new value
+        mConnection = controlp->mCacheSignal.connect(
             boost::bind(&LLControlCache<T>::handleValueChange, this, _2)
             );
         mType = controlp->type();
@@ -364,11 +445,15 @@ private:
     bool handleValueChange(const LLSD& newvalue)
     {
         mCachedValue = convert_from_llsd<T>(newvalue, mType, "");
+        mSnapshot.store(mCachedValue);
+        mVersion.fetch_add(1, std::memory_order_release);
         return true;
     }
 
 private:
     T                           mCachedValue;
+    LLControlSnapshot<T>        mSnapshot;
+    std::atomic<U32>            mVersion{ 0 };
     eControlType                mType;
     boost::signals2::scoped_connection  mConnection;
 };
@@ -403,6 +488,11 @@ public:
     operator boost::function<const T&()> () const { return boost::function<const T&()>(*this); }
     const T& operator()() { return mCachedControlPtr->getValue(); }
 
+    // For reading from threads other than the main one, which constructs
+    // the LLCachedControl
+    T getSnapshot() const { return mCachedControlPtr->getSnapshot(); }
+    U32 getVersion() const { return mCachedControlPtr->getVersion(); }
+
 private:
     LLPointer<LLControlCache<T> > mCachedControlPtr;
 };
@@ -36,11 +36,13 @@
 #include "llquaternion.h"
 #include "lluuid.h"
 
+#include <unordered_map>
+
 //////////////////////////////////////////////////////////////
 // LLXmlTree
 
 // static
-LLStdStringTable LLXmlTree::sAttributeKeys(1024);
+LLConcurrentStringTable LLXmlTree::sAttributeKeys(1024);
 
 LLXmlTree::LLXmlTree()
     : mRoot( NULL ),
@@ -96,6 +98,198 @@ void LLXmlTree::dumpNode( LLXmlTreeNode* node, const std::string& prefix )
     }
 }
 
+// The binary form is a table of the distinct strings followed by the nodes
+// in document order.  Each node is the indices of its name and contents,
+// its attributes as pairs of key and value indices, then its number of
+// children, whose nodes follow.  All numbers are U32 in host byte order.
+namespace
+{
+    void write_u32(std::string& buffer, U32 value)
+    {
+        buffer.append((const char*)&value, sizeof(U32));
+    }
+
+    class BinaryReader
+    {
+    public:
+        BinaryReader(const U8* data, size_t size) : mData(data), mEnd(data + size) {}
+
+        bool readU32(U32& value)
+        {
+            if ((size_t)(mEnd - mData) < sizeof(U32))
+            {
+                return false;
+            }
+            memcpy(&value, mData, sizeof(U32));
+            mData += sizeof(U32);
+            return true;
+        }
+
+        bool readString(std::string& value)
+        {
+            U32 length;
+            if (!readU32(length) || (size_t)(mEnd - mData) < length)
+            {
+                return false;
+            }
+            value.assign((const char*)mData, length);
+            mData += length;
+            return true;
+        }
+
+        size_t getRemaining() const { return mEnd - mData; }
+
+    private:
+        const U8* mData;
+        const U8* mEnd;
+    };
+}
+
+void LLXmlTree::writeBinary(std::string& buffer)
+{
+    std::vector<const std::string*> strings;
+    std::unordered_map<std::string, U32> string_indices;
+    auto add_string = [&](const std::string& str)
+    {
+        auto inserted = string_indices.emplace(str, (U32)strings.size());
+        if (inserted.second)
+        {
+            strings.push_back(&inserted.first->first);
+        }
+        return inserted.first->second;
+    };
+
+    std::string nodes;
+    U32 num_nodes = 0;
+    std::vector<LLXmlTreeNode*> stack;
+    if (mRoot)
+    {
+        stack.push_back(mRoot);
+    }
+    while (!stack.empty())
+    {
+        LLXmlTreeNode* node = stack.back();
+        stack.pop_back();
+        num_nodes++;
+
+        write_u32(nodes, add_string(node->mName));
+        write_u32(nodes, add_string(node->mContents));
+        write_u32(nodes, (U32)node->mAttributes.size());
+        for (const auto& attribute : node->mAttributes)
+        {
+            write_u32(nodes, add_string(*attribute.first));
+            write_u32(nodes, add_string(*attribute.second));
+        }
+        write_u32(nodes, (U32)node->mChildren.size());
+        stack.insert(stack.end(), node->mChildren.rbegin(), node->mChildren.rend());
+    }
+
+    buffer.clear();
+    write_u32(buffer, (U32)strings.size());
+    for (const std::string* str : strings)
+    {
+        write_u32(buffer, (U32)str->size());
+        buffer.append(*str);
+    }
+    write_u32(buffer, num_nodes);
+    buffer.append(nodes);
+}
+
+bool LLXmlTree::parseBinary(const U8* data, size_t size)
+{
+    delete mRoot;
+    mRoot = NULL;
+
+    BinaryReader reader(data, size);
+    U32 num_strings;
+    if (!reader.readU32(num_strings) || num_strings > reader.getRemaining() / sizeof(U32))
+    {
+        LL_WARNS() << "LLXmlTree binary parse failed: bad string table" << LL_ENDL;
+        return false;
+    }
+    std::vector<std::string> strings(num_strings);
+    for (std::string& str : strings)
+    {
+        if (!reader.readString(str))
+        {
+            LL_WARNS() << "LLXmlTree binary parse failed: bad string table" << LL_ENDL;
+            return false;
+        }
+    }
+
+    // Attribute keys are interned once per distinct string
+    std::vector<LLStdStringHandle> keys(num_strings, NULL);
+
+    // Nodes still missing children, with how many
+    std::vector<std::pair<LLXmlTreeNode*, U32> > parents;
+    std::vector<std::pair<U32, U32> > attributes;
+    U32 num_nodes = 0;
+    bool success = reader.readU32(num_nodes);
+    for (U32 i = 0; success && i < num_nodes; i++)
+    {
+        U32 name, contents, num_attributes, num_children;
+        success = reader.readU32(name) && name < num_strings
+            && reader.readU32(contents) && contents < num_strings
+            && reader.readU32(num_attributes) && num_attributes <= reader.getRemaining() / (2 * sizeof(U32));
+        attributes.resize(success ? num_attributes : 0);
+        for (auto& attribute : attributes)
+        {
+            success = success
+                && reader.readU32(attribute.first) && attribute.first < num_strings
+                && reader.readU32(attribute.second) && attribute.second < num_strings;
+        }
+        success = success && reader.readU32(num_children)
+            // only the root has no parent
+            && (mRoot == NULL || !parents.empty());
+        if (!success)
+        {
+            break;
+        }
+
+        LLXmlTreeNode* parent = parents.empty() ? NULL : parents.back().first;
+        LLXmlTreeNode* node = new LLXmlTreeNode(strings[name], parent, this);
+        node->mContents = strings[contents];
+        for (const auto& attribute : attributes)
+        {
+            LLStdStringHandle& key = keys[attribute.first];
+            if (!key)
+            {
+                key = sAttributeKeys.addString(strings[attribute.first]);
+            }
+            const std::string*& value = node->mAttributes[key];
+            delete value;
+            value = new std::string(strings[attribute.second]);
+        }
+
+        if (parent)
+        {
+            parent->addChild(node);
+            parents.back().second--;
+        }
+        else
+        {
+            mRoot = node;
+        }
+        if (num_children)
+        {
+            parents.emplace_back(node, num_children);
+        }
+        while (!parents.empty() && !parents.back().second)
+        {
+            parents.pop_back();
+        }
+    }
+
+    if (!success || !parents.empty() || reader.getRemaining())
+    {
+        LL_WARNS() << "LLXmlTree binary parse failed: bad node data" << LL_ENDL;
+        delete mRoot;
+        mRoot = NULL;
+        return false;
+    }
+    return mRoot != NULL;
+}
+
 //////////////////////////////////////////////////////////////
 // LLXmlTreeNode
 
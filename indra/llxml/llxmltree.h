@@ -57,6 +57,11 @@ public:
 
     virtual bool    parseFile(const std::string &path, bool keep_contents = true);
 
+    // Compact binary form of a parsed tree, for caching.  Reading it back
+    // gives the same tree without going through the XML parser.
+    void            writeBinary(std::string& buffer);
+    bool            parseBinary(const U8* data, size_t size);
+
     LLXmlTreeNode*  getRoot() { return mRoot; }
 
     void            dump();
@@ -68,8 +73,8 @@ public:
     }
 
 public:
-    // global
-    static LLStdStringTable sAttributeKeys;
+    // global, shared by trees parsed on any thread
+    static LLConcurrentStringTable sAttributeKeys;
 
 protected:
     LLXmlTreeNode* mRoot;
@@ -33,7 +33,9 @@
 #include "../llcontrol.h"
 
 #include "../test/lltut.h"
+#include <atomic>
 #include <memory>
+#include <thread>
 #include <vector>
 
 namespace tut
@@ -151,4 +153,96 @@ namespace tut
         ensure("listener fired on changed setting", mListenerFired);
     }
 
+    //transactions hold back and coalesce commit signals
+    template<> template<>
+    void control_group_t::test<5>()
+    {
+        mCG->declareU32("Batched", 1, "Batched setting");
+        mCG->declareU32("SetBack", 1, "Setting set back to where it started");
+        LLCachedControl<U32> cached(*mCG, "Batched");
+        std::vector<std::pair<U32, U32> > fired;
+        mCG->getControl("Batched")->getSignal()->connect(
+            [&fired](LLControlVariable*, const LLSD& value, const LLSD& previous)
+            {
+                fired.emplace_back(previous.asInteger(), value.asInteger());
+            });
+        bool set_back_fired = false;
+        mCG->getControl("SetBack")->getSignal()->connect(
+            [&set_back_fired](LLControlVariable*, const LLSD&, const LLSD&) { set_back_fired = true; });
+
+        {
+            LLControlTransaction transaction;
+            mCG->setU32("Batched", 2);
+            mCG->setU32("Batched", 3);
+            mCG->setU32("SetBack", 5);
+            mCG->setU32("SetBack", 1);
+            ensure_equals("cache kept current", U32(cached), 3);
+            ensure_equals("snapshot kept current", cached.getSnapshot(), 3);
+            ensure("held back", fired.empty());
+        }
+        ensure("held back to the next frame", fired.empty() && LLControlTransaction::hasPendingChanges());
+        // another change before the frame joins the one held back
+        mCG->setU32("Batched", 4);
+        ensure("joined", fired.empty());
+        LLControlTransaction::deliverPendingChanges();
+        ensure_equals("fired once", fired.size(), 1);
+        ensure_equals("from the value before", fired[0].first, 1);
+        ensure_equals("to the latest", fired[0].second, 4);
+        ensure("set back", !set_back_fired);
+        ensure("delivered", !LLControlTransaction::hasPendingChanges());
+
+        fired.clear();
+        {
+            LLControlTransaction outer;
+            {
+                LLControlTransaction inner(LLControlTransaction::DELIVER_ON_END);
+                mCG->setU32("Batched", 5);
+            }
+            ensure("nested", fired.empty());
+            mCG->setU32("Batched", 6);
+        }
+        ensure_equals("delivered on end", fired.size(), 1);
+        ensure_equals("delivered on end value", fired[0].second, 6);
+
+        mCG->setU32("Batched", 7);
+        ensure_equals("outside a transaction", fired.size(), 2);
+    }
+
+    //snapshots read from another thread
+    template<> template<>
+    void control_group_t::test<6>()
+    {
+        mCG->declareF32("Threaded", 0.f, "Setting read from another thread");
+        mCG->declareString("ThreadedString", "0", "String setting read from another thread");
+        LLCachedControl<F32> cached(*mCG, "Threaded");
+        LLCachedControl<std::string> cached_string(*mCG, "ThreadedString");
+        const S32 CHANGES = 20000;
+        std::atomic<bool> done{ false };
+        bool in_order = true;
+        std::thread reader([&]()
+        {
+            F32 last = 0.f;
+            U32 last_version = 0;
+            while (! done)
+            {
+                const U32 version = cached.getVersion();
+                const F32 value = cached.getSnapshot();
+                const std::string text = cached_string.getSnapshot();
+                in_order = in_order && value >= last && version >= last_version && !text.empty();
+                last = value;
+                last_version = version;
+            }
+        });
+        for (S32 i = 1; i <= CHANGES; ++i)
+        {
+            mCG->setF32("Threaded", F32(i));
+            mCG->setString("ThreadedString", std::to_string(i));
+        }
+        done = true;
+        reader.join();
+        ensure("reader saw the changes in order", in_order);
+        ensure_equals("version", cached.getVersion(), U32(CHANGES));
+        ensure_equals("snapshot", cached.getSnapshot(), F32(CHANGES));
+        ensure_equals("string snapshot", cached_string.getSnapshot(), std::to_string(CHANGES));
+    }
 }
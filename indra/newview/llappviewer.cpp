@@ -70,6 +70,7 @@
 #include "lltexturestats.h"
 #include "lltrace.h"
 #include "lltracethreadrecorder.h"
+#include "lltraceevents.h"
 #include "llviewerwindow.h"
 #include "llviewerdisplay.h"
 #include "llviewermedia.h"
@@ -768,6 +769,10 @@ bool LLAppViewer::init()
         LLError::setFatalFunction([rc](const std::string&){ _exit(rc); });
     }
 
+    LLError::setAsyncLogging(gSavedSettings.getBOOL("LogAsync"));
+    LLTrace::EventTrace::setEnabled(gSavedSettings.getBOOL("EventTrace"), gSavedSettings.getU32("EventTraceBufferSize"));
+    LLTrace::EventTrace::setThreadName("App");
+
     // Initialize the non-LLCurl libcurl library.  Should be called
     // before consumers (LLTextureFetch).
     mAppCoreHttp.init();
@@ -2023,6 +2028,7 @@ bool LLAppViewer::cleanup()
     sPurgeDiskCacheThread->shutdown();
     if (mGeneralThreadPool)
     {
+        LLKeyframeMotion::setDecodeQueue("");
         mGeneralThreadPool->close();
     }
 
@@ -2141,6 +2147,9 @@ bool LLAppViewer::cleanup()
 
     LL_INFOS() << "Goodbye!" << LL_ENDL;
 
+    // write out the queued messages while there is still a log file
+    LLError::setAsyncLogging(false);
+
     removeDumpDir();
 
     // return 0;
@@ -2156,6 +2165,11 @@ void LLAppViewer::initGeneralThread()
 
     mGeneralThreadPool = new LL::ThreadPool("General", 3);
     mGeneralThreadPool->start();
+
+    if (gSavedSettings.getBOOL("AnimationDecodeAsync"))
+    {
+        LLKeyframeMotion::setDecodeQueue("General");
+    }
 }
 
 bool LLAppViewer::initThreads()
@@ -4664,6 +4678,8 @@ void LLAppViewer::idle()
     LLFrameTimer::updateFrameCount();
     LLEventTimer::updateClass();
     LLPerfStats::updateClass();
+    // settings changes held back since the last frame
+    LLControlTransaction::deliverPendingChanges();
 
     // LLApp::stepFrame() performs the above three calls plus mRunner.run().
     // Not sure why we don't call stepFrame() here, except that LLRunner seems
@@ -35,6 +35,9 @@
 // external library headers
 // other Linden headers
 #include "llappviewer.h"
+#include "lldir.h"
+#include "lltraceevents.h"
+#include "stringize.h"
 
 LLAppViewerListener::LLAppViewerListener(const LLAppViewerGetter& getter):
     LLEventAPI("LLAppViewer",
@@ -48,6 +51,13 @@ LLAppViewerListener::LLAppViewerListener(const LLAppViewerGetter& getter):
     add("forceQuit",
         "Quit abruptly",
         &LLAppViewerListener::forceQuit);
+    add("dumpTrace",
+        "Write the events recorded while the EventTrace setting was on to a Chrome trace file,\n"
+        "for chrome://tracing or the Perfetto UI.\n"
+        "[\"filename\"]: file to write, trace.json in the logs directory if omitted\n"
+        "[\"seconds\"]: only the last seconds, everything still recorded if omitted\n"
+        "Reply contains [\"filename\"] and [\"events\"], the number of events written.",
+        &LLAppViewerListener::dumpTrace);
 }
 
 void LLAppViewerListener::requestQuit(const LLSD& event)
@@ -61,3 +71,20 @@ void LLAppViewerListener::forceQuit(const LLSD& event)
     LL_INFOS() << "Listener requested force quit" << LL_ENDL;
     mAppViewerGetter()->forceQuit();
 }
+
+void LLAppViewerListener::dumpTrace(const LLSD& event)
+{
+    Response response(LLSD(), event);
+    std::string filename(event["filename"]);
+    if (filename.empty())
+    {
+        filename = gDirUtilp->getExpandedFilename(LL_PATH_LOGS, "trace.json");
+    }
+    size_t num_events = 0;
+    if (!LLTrace::EventTrace::dump(filename, event["seconds"].asReal(), &num_events))
+    {
+        return response.error(STRINGIZE("Unable to write " << filename));
+    }
+    response["filename"] = filename;
+    response["events"] = LLSD::Integer(num_events);
+}
@@ -46,6 +46,7 @@ public:
 private:
     void requestQuit(const LLSD& event);
     void forceQuit(const LLSD& event);
+    void dumpTrace(const LLSD& event);
 
     LLAppViewerGetter mAppViewerGetter;
 };
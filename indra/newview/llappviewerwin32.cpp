@@ -119,6 +119,9 @@ namespace
     {
         if (nCode == MDSCB_EXCEPTIONCODE)
         {
+            // what was still queued belongs in the log
+            LLError::crashFlushLogging();
+
             // send the main viewer log file, one per instance
             // widen to wstring, convert to __wchar_t, then pass c_str()
             sBugSplatSender->sendAdditionalFile(
@@ -0,0 +1,52 @@
+/**
+ * @file llavatarcomplexitycache.cpp
+ * @brief Render complexity of an avatar's attachments, kept until they change
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llavatarcomplexitycache.h"
+
+void LLAvatarComplexityCache::beginUpdate()
+{
+    // whatever the last update didn't look up is gone
+    mPrevious.clear();
+    mPrevious.swap(mCurrent);
+    mComputedCount = 0;
+    mReusedCount = 0;
+}
+
+void LLAvatarComplexityCache::markStale(const LLUUID& id)
+{
+    auto current = mCurrent.find(id);
+    if (current != mCurrent.end())
+    {
+        current->second.mStale = true;
+    }
+    auto previous = mPrevious.find(id);
+    if (previous != mPrevious.end())
+    {
+        previous->second.mStale = true;
+    }
+}
@@ -0,0 +1,118 @@
+/**
+ * @file llavatarcomplexitycache.h
+ * @brief Render complexity of an avatar's attachments, kept until they change
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLAVATARCOMPLEXITYCACHE_H
+#define LL_LLAVATARCOMPLEXITYCACHE_H
+
+#include "lluuid.h"
+
+#include <unordered_map>
+
+// LLVOAvatar::calculateUpdateRenderComplexity() runs whenever the avatar or
+// any one of its attachments changes.  Walking the linkset of every other
+// attachment again each time is what made it expensive, so the complexity of
+// each top level object is kept here, by object id, until that object is
+// marked stale.
+//
+// An update calls beginUpdate() and then get() for every object it
+// accounts; objects not looked up since the last beginUpdate() (detached)
+// are forgotten by the next one.
+class LLAvatarComplexityCache
+{
+public:
+    // Complexity of one top level object
+    struct Entry
+    {
+        U32     mVisibleTriangleCount = 0;
+        F32     mEstTriangleCount = 0.f;
+        F32     mSurfaceArea = 0.f;
+        F32     mTotalCost = 0.f;   // before the limit of MaxAttachmentComplexity
+        bool    mHasCost = false;   // false without a volume drawable
+    };
+
+    void beginUpdate();
+
+    // The entry of object id, from the last update unless it was marked
+    // stale since, else filled in by compute(Entry&)
+    template <typename COMPUTE>
+    const Entry& get(const LLUUID& id, COMPUTE&& compute);
+
+    // The object changed, its entry is computed again by the next update
+    void markStale(const LLUUID& id);
+
+    // Objects computed and reused since beginUpdate()
+    U32 getComputedCount() const { return mComputedCount; }
+    U32 getReusedCount() const { return mReusedCount; }
+
+    size_t size() const { return mCurrent.size(); }
+
+private:
+    struct Slot
+    {
+        Entry   mEntry;
+        bool    mStale = false;
+    };
+    typedef std::unordered_map<LLUUID, Slot> slot_map_t;
+
+    slot_map_t  mCurrent;   // looked up by this update
+    slot_map_t  mPrevious;  // from the last update, until looked up again
+    U32         mComputedCount = 0;
+    U32         mReusedCount = 0;
+};
+
+template <typename COMPUTE>
+const LLAvatarComplexityCache::Entry& LLAvatarComplexityCache::get(const LLUUID& id, COMPUTE&& compute)
+{
+    auto current = mCurrent.find(id);
+    if (current != mCurrent.end() && !current->second.mStale)
+    {
+        // accounted twice in one update
+        ++mReusedCount;
+        return current->second.mEntry;
+    }
+
+    Slot& slot = mCurrent[id];
+    auto previous = mPrevious.find(id);
+    if (previous != mPrevious.end() && !previous->second.mStale)
+    {
+        slot = previous->second;
+        ++mReusedCount;
+    }
+    else
+    {
+        slot.mEntry = Entry();
+        compute(slot.mEntry);
+        slot.mStale = false;
+        ++mComputedCount;
+    }
+    if (previous != mPrevious.end())
+    {
+        mPrevious.erase(previous);
+    }
+    return slot.mEntry;
+}
+
+#endif // LL_LLAVATARCOMPLEXITYCACHE_H
@@ -113,7 +113,7 @@ bool LLEmote::onUpdate(F32 time, U8* joint_mask)
             default_param->setWeight( default_param_weight);
         }
 
-        mCharacter->updateVisualParams();
+        mCharacter->requestVisualParamsUpdate();
     }
 
     return true;
@@ -324,20 +324,23 @@ void LLFace::dirtyTexture()
 
     if (mVObjp.notNull() && mVObjp->getVolume())
     {
+        LLVOVolume* vobj = drawablep ? drawablep->getVOVolume() : NULL;
         for (U32 ch = 0; ch < LLRender::NUM_TEXTURE_CHANNELS; ++ch)
         {
             if (mTexture[ch].notNull() && mTexture[ch]->getComponents() == 4)
             { //dirty texture on an alpha object should be treated as an LoD update
-                LLVOVolume* vobj = drawablep->getVOVolume();
                 if (vobj)
                 {
                     vobj->mLODChanged = true;
-
-                    vobj->updateVisualComplexity();
                 }
                 gPipeline.markRebuild(drawablep, LLDrawable::REBUILD_VOLUME);
             }
         }
+        if (vobj)
+        {
+            // texture costs depend on the size of the loaded texture
+            vobj->updateVisualComplexity();
+        }
     }
 
     gPipeline.markTextured(drawablep);
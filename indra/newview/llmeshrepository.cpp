@@ -229,6 +229,8 @@
 //     sCacheBytesWritten              "
 //     sCacheReads                     "
 //     sCacheWrites                    "
+//     sDecodedCacheReads              "
+//     sDecodedCacheWrites             "
 //     mLoadingMeshes                  mMeshMutex [4]  rw.main.none, rw.any.mMeshMutex
 //     mSkinMap                        none            rw.main.none
 //     mDecompositionMap               none            rw.main.none
@@ -264,6 +266,7 @@
 //     mGetMeshCapability       mMutex        rw.main.mMutex, ro.repo.mMutex (was:  [0])
 //     mGetMesh2Capability      mMutex        rw.main.mMutex, ro.repo.mMutex (was:  [0])
 //     mGetMeshVersion          mMutex        rw.main.mMutex, ro.repo.mMutex
+//     mUseDecodedCache         none          wo.main.none (ctor), ro.repo.none
 //     mHttp*                   none          rw.repo.none
 //
 //   LLMeshUploadThread:
@@ -392,6 +395,8 @@ U32 LLMeshRepository::sCacheBytesSkins = 0;
 U32 LLMeshRepository::sCacheBytesDecomps = 0;
 U32 LLMeshRepository::sCacheReads = 0;
 U32 LLMeshRepository::sCacheWrites = 0;
+U32 LLMeshRepository::sDecodedCacheReads = 0;
+U32 LLMeshRepository::sDecodedCacheWrites = 0;
 U32 LLMeshRepository::sMaxLockHoldoffs = 0;
 
 LLDeadmanTimer LLMeshRepository::sQuiescentTimer(15.0, false);  // true -> gather cpu metrics
@@ -408,6 +413,21 @@ namespace {
 
     void NoOpDeletor(LLCore::HttpHandler *)
     { /*NoOp*/ }
+
+    // Disk cache id of the decoded (unpacked and cache optimized) copy of a mesh LOD.
+    // Mesh assets are immutable, so the id is derived from the asset id plus everything
+    // else that changes the decoded result: LOD, size of the raw LOD block, the
+    // mirror/invert sculpt flags and the decoded layout version.  Bumping
+    // LLVolume::DECODED_FACES_VERSION orphans old entries, which the disk cache
+    // then evicts like any other stale file.
+    LLUUID decoded_mesh_cache_id(const LLVolumeParams& mesh_params, S32 lod, S32 lod_size)
+    {
+        const U8 decode_flags = mesh_params.getSculptType() & (LL_SCULPT_FLAG_MIRROR | LL_SCULPT_FLAG_INVERT);
+        return LLUUID::generateNewID(llformat("decoded_mesh/%s/%d/%d/%d/%u",
+                                              mesh_params.getSculptID().asString().c_str(),
+                                              lod, lod_size, (S32)decode_flags,
+                                              LLVolume::DECODED_FACES_VERSION));
+    }
 }
 
 static S32 dump_num = 0;
@@ -831,10 +851,13 @@ LLMeshRepoThread::LLMeshRepoThread()
   mHttpHeaders(),
   mHttpPolicyClass(LLCore::HttpRequest::DEFAULT_POLICY_ID),
   mHttpLargePolicyClass(LLCore::HttpRequest::DEFAULT_POLICY_ID),
+  mUseDecodedCache(false),
   mWorkQueue("MeshRepoThread", 1024*1024)
 {
     LLAppCoreHttp & app_core_http(LLAppViewer::instance()->getAppCoreHttp());
 
+    mUseDecodedCache = gSavedSettings.getBOOL("MeshUseDecodedCache");
+
     mMutex = new LLMutex();
     mHeaderMutex = new LLMutex();
     mSignal = new LLCondition();
@@ -1795,6 +1818,12 @@ bool LLMeshRepoThread::fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod,
 
         if (version <= MAX_MESH_VERSION && offset >= 0 && size > 0)
         {
+            //check decoded cache first, a hit skips inflate, parse and optimize entirely
+            if (mUseDecodedCache && decodedLODFromCache(mesh_params, lod, size))
+            {
+                LL_DEBUGS(LOG_MESH) << "Mesh/Cache: Mesh body for ID " << mesh_id << " - was retrieved from the decoded cache." << LL_ENDL;
+                return true;
+            }
 
             //check cache for mesh asset
             LLFileSystem file(mesh_id, LLAssetType::AT_MESH);
@@ -1994,29 +2023,21 @@ EMeshProcessingResult LLMeshRepoThread::lodReceived(const LLVolumeParams& mesh_p
     {
         if (volume->getNumFaces() > 0)
         {
-            // if we have a valid SkinInfo, cache per-joint bounding boxes for this LOD
-            LLMeshSkinInfo* skin_info = mSkinMap[mesh_params.getSculptID()];
-            if (skin_info && isAgentAvatarValid())
+            if (mUseDecodedCache)
             {
-                for (S32 i = 0; i < volume->getNumFaces(); ++i)
+                std::vector<U8> decoded;
+                if (volume->packDecodedFaces(decoded))
                 {
-                    // NOTE: no need to lock gAgentAvatarp as the state being checked is not changed after initialization
-                    LLVolumeFace& face = volume->getVolumeFace(i);
-                    LLSkinningUtil::updateRiggingInfo(skin_info, gAgentAvatarp, face);
+                    LLFileSystem file(decoded_mesh_cache_id(mesh_params, lod, data_size), LLAssetType::AT_MESH, LLFileSystem::WRITE);
+                    if (file.write(decoded.data(), (S32)decoded.size()))
+                    {
+                        ++LLMeshRepository::sDecodedCacheWrites;
+                        LLMeshRepository::sCacheBytesWritten += (U32)decoded.size();
+                    }
                 }
             }
 
-            LoadedMesh mesh(volume, mesh_params, lod);
-            {
-                LLMutexLock lock(mMutex);
-                mLoadedQ.push_back(mesh);
-                // LLPointer is not thread safe, since we added this pointer into
-                // threaded list, make sure counter gets decreased inside mutex lock
-                // and won't affect mLoadedQ processing
-                volume = NULL;
-                // might be good idea to turn mesh into pointer to avoid making a copy
-                mesh.mVolume = NULL;
-            }
+            lodDecoded(volume, mesh_params, lod);
             return MESH_OK;
         }
     }
@@ -2024,6 +2045,67 @@ EMeshProcessingResult LLMeshRepoThread::lodReceived(const LLVolumeParams& mesh_p
     return MESH_UNKNOWN;
 }
 
+bool LLMeshRepoThread::decodedLODFromCache(const LLVolumeParams& mesh_params, S32 lod, S32 lod_size)
+{
+    LL_PROFILE_ZONE_SCOPED;
+
+    LLFileSystem file(decoded_mesh_cache_id(mesh_params, lod, lod_size), LLAssetType::AT_MESH);
+    const S32 size = file.getSize();
+    if (size <= 0)
+    {
+        return false;
+    }
+
+    // new[] aligns to 16 bytes, as unpackDecodedFaces() needs
+    std::unique_ptr<U8[]> buffer(new(std::nothrow) U8[size]);
+    if (!buffer || !file.read(buffer.get(), size) || file.getLastBytesRead() != size)
+    {
+        return false;
+    }
+
+    LLPointer<LLVolume> volume = new LLVolume(mesh_params, LLVolumeLODGroup::getVolumeScaleFromDetail(lod));
+    if (!volume->unpackDecodedFaces(buffer.get(), size) || volume->getNumFaces() <= 0)
+    {
+        // stale or corrupt, drop it so the next decode rewrites it
+        LL_DEBUGS(LOG_MESH) << "Discarding unusable decoded cache entry for mesh " << mesh_params.getSculptID() << " LOD " << lod << LL_ENDL;
+        file.remove();
+        return false;
+    }
+
+    ++LLMeshRepository::sDecodedCacheReads;
+    LLMeshRepository::sCacheBytesRead += size;
+
+    lodDecoded(volume, mesh_params, lod);
+    return true;
+}
+
+void LLMeshRepoThread::lodDecoded(LLPointer<LLVolume>& volume, const LLVolumeParams& mesh_params, S32 lod)
+{
+    // if we have a valid SkinInfo, cache per-joint bounding boxes for this LOD
+    LLMeshSkinInfo* skin_info = mSkinMap[mesh_params.getSculptID()];
+    if (skin_info && isAgentAvatarValid())
+    {
+        for (S32 i = 0; i < volume->getNumFaces(); ++i)
+        {
+            // NOTE: no need to lock gAgentAvatarp as the state being checked is not changed after initialization
+            LLVolumeFace& face = volume->getVolumeFace(i);
+            LLSkinningUtil::updateRiggingInfo(skin_info, gAgentAvatarp, face);
+        }
+    }
+
+    LoadedMesh mesh(volume, mesh_params, lod);
+    {
+        LLMutexLock lock(mMutex);
+        mLoadedQ.push_back(mesh);
+        // LLPointer is not thread safe, since we added this pointer into
+        // threaded list, make sure counter gets decreased inside mutex lock
+        // and won't affect mLoadedQ processing
+        volume = NULL;
+        // might be good idea to turn mesh into pointer to avoid making a copy
+        mesh.mVolume = NULL;
+    }
+}
+
 bool LLMeshRepoThread::skinInfoReceived(const LLUUID& mesh_id, U8* data, S32 data_size)
 {
     LLSD skin;
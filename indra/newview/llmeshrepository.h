@@ -394,6 +394,9 @@ public:
 
     std::string mGetMeshCapability;
 
+    // if true, decoded LODs are read from and written to the decoded mesh cache (see "MeshUseDecodedCache")
+    bool mUseDecodedCache;
+
     LLMeshRepoThread();
     ~LLMeshRepoThread();
 
@@ -406,6 +409,7 @@ public:
     bool fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod, bool can_retry = true);
     EMeshProcessingResult headerReceived(const LLVolumeParams& mesh_params, U8* data, S32 data_size);
     EMeshProcessingResult lodReceived(const LLVolumeParams& mesh_params, S32 lod, U8* data, S32 data_size);
+    bool decodedLODFromCache(const LLVolumeParams& mesh_params, S32 lod, S32 lod_size);
     bool skinInfoReceived(const LLUUID& mesh_id, U8* data, S32 data_size);
     bool decompositionReceived(const LLUUID& mesh_id, U8* data, S32 data_size);
     EMeshProcessingResult physicsShapeReceived(const LLUUID& mesh_id, U8* data, S32 data_size);
@@ -456,6 +460,11 @@ private:
     LLCore::HttpHandle getByteRange(const std::string & url,
                                     size_t offset, size_t len,
                                     const LLCore::HttpHandler::ptr_t &handler);
+
+    // Hands a freshly unpacked volume over to the main thread via mLoadedQ.
+    //
+    // Threads:  Repo thread only
+    void lodDecoded(LLPointer<LLVolume>& volume, const LLVolumeParams& mesh_params, S32 lod);
 };
 
 
@@ -626,6 +635,8 @@ public:
     static U32 sCacheBytesDecomps;
     static U32 sCacheReads;
     static U32 sCacheWrites;
+    static U32 sDecodedCacheReads;              // LODs restored from the decoded mesh cache
+    static U32 sDecodedCacheWrites;             // LODs written to the decoded mesh cache
     static U32 sMaxLockHoldoffs;                // Maximum sequential locking failures
 
     static LLDeadmanTimer sQuiescentTimer;      // Time-to-complete-mesh-downloads after significant events
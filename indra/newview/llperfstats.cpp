@@ -68,6 +68,8 @@ namespace LLPerfStats
     void Tunables::applyUpdates()
     {
         assert_main_thread();
+        // the settings handlers run once, next frame, however many of these change
+        LLControlTransaction transaction;
         // these following variables are proxies for pipeline statics we do not need a two way update (no llviewercontrol handler)
         if( tuningFlag & NonImpostors ){ gSavedSettings.setU32("RenderAvatarMaxNonImpostors", nonImpostors); };
         if( tuningFlag & ReflectionDetail ){ gSavedSettings.setS32("RenderReflectionDetail", reflectionDetail); };
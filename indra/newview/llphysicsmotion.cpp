@@ -47,6 +47,8 @@ typedef std::map<std::string, F32> default_controller_map_t;
 // we use TIME_ITERATION_STEP_MAX in division operation, make sure this is a simple
 // value and devision result won't end with repeated/recurring tail like 1.333(3)
 #define TIME_ITERATION_STEP_MAX 0.05f // minimal step size will end up as 0.025
+// step size of AvatarPhysicsFixedTimestep
+#define TIME_ITERATION_STEP_FIXED 0.025f
 
 inline F64 llsgn(const F64 a)
 {
@@ -108,9 +110,14 @@ public:
                 mParamControllers(controllers),
                 mCharacter(character),
                 mLastTime(0),
+                mTimeAccumulator(0),
                 mPosition_local(0),
                 mVelocityJoint_local(0),
-                mPositionLastUpdate_local(0)
+                mPositionLastUpdate_local(0),
+                mVelocityJointNew_local(0),
+                mAccelerationJointNew_local(0),
+                mTimeAccumulatorNew(0),
+                mSolverIndex(-1)
         {
                 mJointState = new LLJointState;
 
@@ -124,7 +131,9 @@ public:
 
         ~LLPhysicsMotion() {}
 
-        bool onUpdate(F32 time);
+        // An update is split in two around LLPhysicsMotionSolver::integrate()
+        bool prepareUpdate(F32 time, bool fixed_timestep, LLPhysicsMotionSolver& solver);
+        bool finishUpdate(F32 time, const LLPhysicsMotionSolver& solver, S32 first_param);
 
         LLPointer<LLJointState> getJointState()
         {
@@ -196,6 +205,13 @@ private:
         LLCharacter *mCharacter;
 
         F32 mLastTime;
+        F32 mTimeAccumulator; // time left over by the fixed time step
+
+        // between prepareUpdate() and finishUpdate()
+        F32 mVelocityJointNew_local;
+        F32 mAccelerationJointNew_local;
+        F32 mTimeAccumulatorNew;
+        S32 mSolverIndex;
 
         LLVisualParam* mParamCache[NUM_PARAMS];
 
@@ -233,15 +249,25 @@ bool LLPhysicsMotion::initialize()
         return true;
 }
 
+bool LLPhysicsMotionController::sBatchOpen = false;
+LLPhysicsMotionSolver LLPhysicsMotionController::sBatchSolver;
+std::vector<LLPhysicsMotionController*> LLPhysicsMotionController::sBatch;
+std::mutex LLPhysicsMotionController::sBatchMutex;
+
 LLPhysicsMotionController::LLPhysicsMotionController(const LLUUID &id) :
         LLMotion(id),
-        mCharacter(NULL)
+        mCharacter(NULL),
+        mBatchPending(false),
+        mBatchUpdateVisuals(false),
+        mBatchTime(0.f),
+        mBatchFirstParam(0)
 {
         mName = "breast_motion";
 }
 
 LLPhysicsMotionController::~LLPhysicsMotionController()
 {
+        leaveBatch();
         for (motion_vec_t::iterator iter = mMotions.begin();
              iter != mMotions.end();
              ++iter)
@@ -257,6 +283,50 @@ bool LLPhysicsMotionController::onActivate()
 
 void LLPhysicsMotionController::onDeactivate()
 {
+        leaveBatch();
+}
+
+// static
+void LLPhysicsMotionController::beginBatch()
+{
+        llassert(sBatch.empty());
+        sBatchOpen = true;
+}
+
+// static
+void LLPhysicsMotionController::finishBatch()
+{
+        LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+        sBatchOpen = false;
+        if (sBatch.empty())
+        {
+                return;
+        }
+
+        sBatchSolver.integrate();
+        for (LLPhysicsMotionController* controller : sBatch)
+        {
+                controller->mBatchPending = false;
+                bool update_visuals = controller->mBatchUpdateVisuals;
+                update_visuals |= controller->finishMotions(controller->mBatchTime, sBatchSolver, controller->mBatchFirstParam);
+                if (update_visuals)
+                        controller->mCharacter->requestVisualParamsUpdate();
+        }
+        sBatch.clear();
+        sBatchSolver.clear();
+}
+
+// Drops the params waiting for finishBatch(), the motions keep the state
+// of their last update
+void LLPhysicsMotionController::leaveBatch()
+{
+        if (!mBatchPending)
+        {
+                return;
+        }
+        std::lock_guard<std::mutex> lock(sBatchMutex);
+        sBatch.erase(std::remove(sBatch.begin(), sBatch.end(), this), sBatch.end());
+        mBatchPending = false;
 }
 
 LLMotion::LLMotionInitStatus LLPhysicsMotionController::onInitialize(LLCharacter *character)
@@ -460,26 +530,67 @@ bool LLPhysicsMotionController::onUpdate(F32 time, U8* joint_mask)
     {
             return true;
     }
+    static LLCachedControl<bool> fixed_timestep(gSavedSettings, "AvatarPhysicsFixedTimestep", false);
+    if (mBatchPending)
+    {
+            // updated twice in a frame, finishBatch() has this one
+            return true;
+    }
 
+    // The params of all motions are integrated together
     bool update_visuals = false;
+    mSolver.clear();
     for (motion_vec_t::iterator iter = mMotions.begin();
             iter != mMotions.end();
             ++iter)
     {
             LLPhysicsMotion *motion = (*iter);
-            update_visuals |= motion->onUpdate(time);
+            update_visuals |= motion->prepareUpdate(time, fixed_timestep, mSolver);
+    }
+
+    // and with those of every other avatar, if the frame batches them
+    if (sBatchOpen && mSolver.getNumParams())
+    {
+            std::lock_guard<std::mutex> lock(sBatchMutex);
+            mBatchFirstParam = sBatchSolver.addParams(mSolver);
+            mBatchTime = time;
+            mBatchUpdateVisuals = update_visuals;
+            mBatchPending = true;
+            sBatch.push_back(this);
+            return true;
+    }
+
+    if (mSolver.getNumParams())
+    {
+            mSolver.integrate();
+            update_visuals |= finishMotions(time, mSolver, 0);
     }
 
     if (update_visuals)
-            mCharacter->updateVisualParams();
+            mCharacter->requestVisualParamsUpdate();
 
     return true;
 }
 
 // Return true if character has to update visual params.
-bool LLPhysicsMotion::onUpdate(F32 time)
+bool LLPhysicsMotionController::finishMotions(F32 time, const LLPhysicsMotionSolver& solver, S32 first_param)
+{
+    bool update_visuals = false;
+    for (motion_vec_t::iterator iter = mMotions.begin();
+            iter != mMotions.end();
+            ++iter)
+    {
+            LLPhysicsMotion *motion = (*iter);
+            update_visuals |= motion->finishUpdate(time, solver, first_param);
+    }
+    return update_visuals;
+}
+
+// Adds the param to the solver, or returns true if character has to update
+// visual params without it.
+bool LLPhysicsMotion::prepareUpdate(F32 time, bool fixed_timestep, LLPhysicsMotionSolver& solver)
 {
-        // static FILE *mFileWrite = fopen("c:\\temp\\avatar_data.txt","w");
+        mSolverIndex = -1;
 
         if (!mParamDriver)
                 return false;
@@ -487,6 +598,7 @@ bool LLPhysicsMotion::onUpdate(F32 time)
         if (!mLastTime || mLastTime >= time)
         {
                 mLastTime = time;
+                mTimeAccumulator = 0.f;
                 return false;
         }
 
@@ -500,6 +612,7 @@ bool LLPhysicsMotion::onUpdate(F32 time)
         if (time_delta > 1.0)
         {
                 mLastTime = time;
+                mTimeAccumulator = 0.f;
                 return false;
         }
 
@@ -511,20 +624,13 @@ bool LLPhysicsMotion::onUpdate(F32 time)
                 return true;
         }
 
-        LLJoint *joint = mJointState->getJoint();
-
         const F32 behavior_mass = getParamValue(MASS);
         const F32 behavior_gravity = getParamValue(GRAVITY);
         const F32 behavior_spring = getParamValue(SPRING);
         const F32 behavior_gain = getParamValue(GAIN);
         const F32 behavior_damping = getParamValue(DAMPING);
         const F32 behavior_drag = getParamValue(DRAG);
-        F32 behavior_maxeffect = getParamValue(MAX_EFFECT);
-
-        const bool physics_test = false; // Enable this to simulate bouncing on all parts.
-
-        if (physics_test)
-                behavior_maxeffect = 1.0f;
+        const F32 behavior_maxeffect = getParamValue(MAX_EFFECT);
 
     // Normalize the param position to be from [0,1].
     // We have to use normalized values because there may be more than one driven param,
@@ -542,15 +648,13 @@ bool LLPhysicsMotion::onUpdate(F32 time)
     //
 
     const F32 joint_local_factor = 30.0;
-    const F32 velocity_joint_local = calculateVelocity_local(time_delta * joint_local_factor);
-    const F32 acceleration_joint_local = calculateAcceleration_local(velocity_joint_local, time_delta * joint_local_factor);
+    mVelocityJointNew_local = calculateVelocity_local(time_delta * joint_local_factor);
+    mAccelerationJointNew_local = calculateAcceleration_local(mVelocityJointNew_local, time_delta * joint_local_factor);
 
     //
     // End velocity and acceleration
     ////////////////////////////////////////////////////////////////////////////////
 
-    bool update_visuals = false;
-
     // Break up the physics into a bunch of iterations so that differing framerates will show
     // roughly the same behavior.
     // Explanation/example: Lets assume we have a bouncing object. Said abjects bounces at a
@@ -565,196 +669,130 @@ bool LLPhysicsMotion::onUpdate(F32 time)
     // bounce at right (relatively) position.
     // Note: this doesn't look to be optimal, since it provides only "roughly same" behavior, but
     // irregularity at higher fps looks to be insignificant so it works good enough for low fps.
-    U32 steps = (U32)(time_delta / TIME_ITERATION_STEP_MAX) + 1;
-    F32 time_iteration_step = time_delta / (F32)steps; //minimal step size ends up as 0.025
-    for (U32 i = 0; i < steps; i++)
+    // With a fixed time step the behavior is the same at any framerate, what is left of the
+    // frame's time is carried over to the next frame.
+    U32 steps;
+    F32 time_iteration_step;
+    if (fixed_timestep)
     {
-        // mPositon_local should be in normalized 0,1 range already.  Just making sure...
-        const F32 position_current_local = llclamp(mPosition_local,
-                               0.0f,
-                               1.0f);
-        // If the effect is turned off then don't process unless we need one more update
-        // to set the position to the default (i.e. user) position.
-        if ((behavior_maxeffect == 0) && (position_current_local == position_user_local))
-        {
-            return update_visuals;
-        }
-
-        ////////////////////////////////////////////////////////////////////////////////
-        // Calculate the total force
-        //
-
-        // Spring force is a restoring force towards the original user-set breast position.
-        // F = kx
-        const F32 spring_length = position_current_local - position_user_local;
-        const F32 force_spring = -spring_length * behavior_spring;
-
-        // Acceleration is the force that comes from the change in velocity of the torso.
-        // F = ma
-        const F32 force_accel = behavior_gain * (acceleration_joint_local * behavior_mass);
+        const F32 time_pending = mTimeAccumulator + time_delta;
+        time_iteration_step = TIME_ITERATION_STEP_FIXED;
+        steps = (U32)(time_pending / time_iteration_step);
+        mTimeAccumulatorNew = time_pending - (F32)steps * time_iteration_step;
+    }
+    else
+    {
+        steps = (U32)(time_delta / TIME_ITERATION_STEP_MAX) + 1;
+        time_iteration_step = time_delta / (F32)steps; //minimal step size ends up as 0.025
+        mTimeAccumulatorNew = 0.f;
+    }
 
-        // Gravity always points downward in world space.
-        // F = mg
-        const LLVector3 gravity_world(0,0,1);
-        const F32 force_gravity = (toLocal(gravity_world) * behavior_gravity * behavior_mass);
+    ////////////////////////////////////////////////////////////////////////////////
+    // Calculate the forces that don't change over the steps, the spring
+    // and damping forces are left to the solver.
+    //
 
-        // Damping is a restoring force that opposes the current velocity.
-        // F = -kv
-        const F32 force_damping = -behavior_damping * mVelocity_local;
+    // Acceleration is the force that comes from the change in velocity of the torso.
+    // F = ma
+    const F32 force_accel = behavior_gain * (mAccelerationJointNew_local * behavior_mass);
 
-        // Drag is a force imparted by velocity (intuitively it is similar to wind resistance)
-        // F = .5kv^2
-        const F32 force_drag = (F32)(.5 * behavior_drag * velocity_joint_local * velocity_joint_local * llsgn(velocity_joint_local));
+    // Gravity always points downward in world space.
+    // F = mg
+    const LLVector3 gravity_world(0,0,1);
+    const F32 force_gravity = (toLocal(gravity_world) * behavior_gravity * behavior_mass);
 
-        const F32 force_net = (force_accel +
-                       force_gravity +
-                       force_spring +
-                       force_damping +
-                       force_drag);
+    // Drag is a force imparted by velocity (intuitively it is similar to wind resistance)
+    // F = .5kv^2
+    const F32 force_drag = (F32)(.5 * behavior_drag * mVelocityJointNew_local * mVelocityJointNew_local * llsgn(mVelocityJointNew_local));
 
-        //
-        // End total force
-        ////////////////////////////////////////////////////////////////////////////////
+    //
+    // End forces
+    ////////////////////////////////////////////////////////////////////////////////
 
+    // Updating the visual params (i.e. what the user sees) is fairly expensive.
+    // So only update if the params have changed enough, and also take into account
+    // the graphics LOD settings.
+
+    // For non-self, if the avatar is small enough visually, then don't update.
+    const F32 area_for_max_settings = 0.0;
+    const F32 area_for_min_settings = 1400.0;
+    const F32 area_for_this_setting = area_for_max_settings + (area_for_min_settings-area_for_max_settings)*(1.0f-lod_factor);
+    const F32 pixel_area = sqrtf(mCharacter->getPixelArea());
+    const bool is_self = (dynamic_cast<LLVOAvatarSelf *>(mCharacter) != NULL);
+
+    LLPhysicsMotionSolver::Param param;
+    param.mPosition = mPosition_local;
+    param.mVelocity = mVelocity_local;
+    param.mPositionLastUpdate = mPositionLastUpdate_local;
+    param.mPositionUser = position_user_local;
+    param.mForce = force_accel + force_gravity;
+    param.mForceDrag = force_drag;
+    param.mSpring = behavior_spring;
+    param.mDamping = behavior_damping;
+    param.mMass = behavior_mass;
+    param.mMaxEffect = behavior_maxeffect;
+    param.mMinDelta = ((pixel_area > area_for_this_setting) || is_self) ? (1.0001f-lod_factor)*0.4f : F32_MAX;
+    param.mTimeStep = time_iteration_step;
+    param.mSteps = steps;
+    mSolverIndex = solver.addParam(param);
+
+    return false;
+}
 
-        ////////////////////////////////////////////////////////////////////////////////
-        // Calculate new params
-        //
+// Return true if character has to update visual params.
+bool LLPhysicsMotion::finishUpdate(F32 time, const LLPhysicsMotionSolver& solver, S32 first_param)
+{
+        if (mSolverIndex < 0)
+                return false;
 
-        // Calculate the new acceleration based on the net force.
-        // a = F/m
-        const F32 acceleration_new_local = force_net / behavior_mass;
-        static const F32 max_velocity = 100.0f; // magic number, used to be customizable.
-        F32 velocity_new_local = mVelocity_local + acceleration_new_local*time_iteration_step;
-        velocity_new_local = llclamp(velocity_new_local,
-                         -max_velocity, max_velocity);
+        const LLPhysicsMotionSolver::Result& result = solver.getResult(first_param + mSolverIndex);
+        const F32 behavior_maxeffect = getParamValue(MAX_EFFECT);
 
-        // Temporary debugging setting to cause all avatars to move, for profiling purposes.
-        if (physics_test)
-        {
-            velocity_new_local = sin(time*4.0f);
-        }
-        // Calculate the new parameters, or remain unchanged if max speed is 0.
-        F32 position_new_local = position_current_local + velocity_new_local*time_iteration_step;
-        if (behavior_maxeffect == 0)
-            position_new_local = position_user_local;
-
-        // Zero out the velocity if the param is being pushed beyond its limits.
-        if ((position_new_local < 0 && velocity_new_local < 0) ||
-            (position_new_local > 1 && velocity_new_local > 0))
+        if (result.mReset)
         {
-            velocity_new_local = 0;
+                mVelocityJoint_local = 0;
+                mPosition_world = LLVector3(0,0,0);
         }
 
-        // Check for NaN values.  A NaN value is detected if the variables doesn't equal itself.
-        // If NaN, then reset everything.
-        if ((mPosition_local != mPosition_local) ||
-            (mVelocity_local != mVelocity_local) ||
-            (position_new_local != position_new_local))
+        if (result.mStepsDone)
         {
-            position_new_local = 0;
-            mVelocity_local = 0;
-            mVelocityJoint_local = 0;
-            mAccelerationJoint_local = 0;
-            mPosition_local = 0;
-            mPosition_world = LLVector3(0,0,0);
-        }
-
-        const F32 position_new_local_clamped = llclamp(position_new_local,
-                                   0.0f,
-                                   1.0f);
+                // Only the last step's value is seen, set the params once.
+                LLDriverParam *driver_param = dynamic_cast<LLDriverParam *>(mParamDriver);
+                llassert_always(driver_param);
+                if (driver_param)
+                {
+                        // If this is one of our "hidden" driver params, then make sure it's
+                        // the default value.
+                        if ((driver_param->getGroup() != VISUAL_PARAM_GROUP_TWEAKABLE) &&
+                            (driver_param->getGroup() != VISUAL_PARAM_GROUP_TWEAKABLE_NO_TRANSMIT))
+                        {
+                                mCharacter->setVisualParamWeight(driver_param, 0);
+                        }
+                        S32 num_driven = driver_param->getDrivenParamsCount();
+                        for (S32 i = 0; i < num_driven; ++i)
+                        {
+                                const LLViewerVisualParam *driven_param = driver_param->getDrivenParam(i);
+                                setParamValue(driven_param, result.mPositionClamped, behavior_maxeffect);
+                        }
+                }
 
-        LLDriverParam *driver_param = dynamic_cast<LLDriverParam *>(mParamDriver);
-        llassert_always(driver_param);
-        if (driver_param)
-        {
-            // If this is one of our "hidden" driver params, then make sure it's
-            // the default value.
-            if ((driver_param->getGroup() != VISUAL_PARAM_GROUP_TWEAKABLE) &&
-                (driver_param->getGroup() != VISUAL_PARAM_GROUP_TWEAKABLE_NO_TRANSMIT))
-            {
-                mCharacter->setVisualParamWeight(driver_param, 0);
-            }
-            S32 num_driven = driver_param->getDrivenParamsCount();
-            for (S32 i = 0; i < num_driven; ++i)
-            {
-                const LLViewerVisualParam *driven_param = driver_param->getDrivenParam(i);
-                setParamValue(driven_param,position_new_local_clamped, behavior_maxeffect);
-            }
+                mVelocity_local = result.mVelocity;
+                mAccelerationJoint_local = mAccelerationJointNew_local;
+                mPosition_local = result.mPosition;
+                mPositionLastUpdate_local = result.mPositionLastUpdate;
         }
 
-        //
-        // End calculate new params
-        ////////////////////////////////////////////////////////////////////////////////
-
-        ////////////////////////////////////////////////////////////////////////////////
-        // Conditionally update the visual params
-        //
-
-        // Updating the visual params (i.e. what the user sees) is fairly expensive.
-        // So only update if the params have changed enough, and also take into account
-        // the graphics LOD settings.
-
-        // For non-self, if the avatar is small enough visually, then don't update.
-        const F32 area_for_max_settings = 0.0;
-        const F32 area_for_min_settings = 1400.0;
-        const F32 area_for_this_setting = area_for_max_settings + (area_for_min_settings-area_for_max_settings)*(1.0f-lod_factor);
-            const F32 pixel_area = sqrtf(mCharacter->getPixelArea());
-
-        const bool is_self = (dynamic_cast<LLVOAvatarSelf *>(mCharacter) != NULL);
-        if ((pixel_area > area_for_this_setting) || is_self)
+        // If the effect is turned off the params are left at the user position,
+        // and the time keeps adding up until it moves again.
+        if (!result.mStopped)
         {
-            const F32 position_diff_local = llabs(mPositionLastUpdate_local-position_new_local_clamped);
-            const F32 min_delta = (1.0001f-lod_factor)*0.4f;
-            if (llabs(position_diff_local) > min_delta)
-            {
-                update_visuals = true;
-                mPositionLastUpdate_local = position_new_local;
-            }
+                mLastTime = time;
+                mTimeAccumulator = mTimeAccumulatorNew;
+                mPosition_world = mJointState->getJoint()->getWorldPosition();
+                mVelocityJoint_local = mVelocityJointNew_local;
         }
 
-        //
-        // End update visual params
-        ////////////////////////////////////////////////////////////////////////////////
-
-        mVelocity_local = velocity_new_local;
-        mAccelerationJoint_local = acceleration_joint_local;
-        mPosition_local = position_new_local;
-    }
-    mLastTime = time;
-    mPosition_world = joint->getWorldPosition();
-    mVelocityJoint_local = velocity_joint_local;
-
-
-        /*
-          // Write out debugging info into a spreadsheet.
-          if (mFileWrite != NULL && is_self)
-          {
-          fprintf(mFileWrite,"%f\t%f\t%f \t\t%f \t\t%f\t%f\t%f\t \t\t%f\t%f\t%f\t%f\t%f \t\t%f\t%f\t%f\n",
-          position_new_local,
-          velocity_new_local,
-          acceleration_new_local,
-
-          time_delta,
-
-          mPosition_world[0],
-          mPosition_world[1],
-          mPosition_world[2],
-
-          force_net,
-          force_spring,
-          force_accel,
-          force_damping,
-          force_drag,
-
-          spring_length,
-          velocity_joint_local,
-          acceleration_joint_local
-          );
-          }
-        */
-
-        return update_visuals;
+        return result.mUpdateVisuals;
 }
 
 // Range of new_value_local is assumed to be [0 , 1] normalized.
@@ -30,8 +30,12 @@
 //-----------------------------------------------------------------------------
 // Header files
 //-----------------------------------------------------------------------------
+#include <mutex>
+#include <vector>
+
 #include "llmotion.h"
 #include "llframetimer.h"
+#include "llphysicsmotionsolver.h"
 
 #define PHYSICS_MOTION_FADEIN_TIME 1.0f
 #define PHYSICS_MOTION_FADEOUT_TIME 1.0f
@@ -105,13 +109,36 @@ public:
 
     LLCharacter* getCharacter() { return mCharacter; }
 
+    // Between these (main thread) onUpdate() only gathers the params of
+    // every controller, on any thread, and finishBatch() integrates all of
+    // them at once and sets the visual params.  Otherwise each controller
+    // integrates its own params in onUpdate().
+    static void beginBatch();
+    static void finishBatch();
+
 protected:
     void addMotion(LLPhysicsMotion *motion);
 private:
+    bool finishMotions(F32 time, const LLPhysicsMotionSolver& solver, S32 first_param);
+    void leaveBatch();
+
     LLCharacter*        mCharacter;
 
     typedef std::vector<LLPhysicsMotion *> motion_vec_t;
     motion_vec_t mMotions;
+
+    LLPhysicsMotionSolver mSolver;
+
+    // Waiting for finishBatch()
+    bool                mBatchPending;
+    bool                mBatchUpdateVisuals;
+    F32                 mBatchTime;
+    S32                 mBatchFirstParam;
+
+    static bool                                     sBatchOpen;
+    static LLPhysicsMotionSolver                    sBatchSolver;
+    static std::vector<LLPhysicsMotionController*>  sBatch;
+    static std::mutex                               sBatchMutex;
 };
 
 #endif // LL_LLPHYSICSMOTION_H
@@ -462,7 +462,14 @@ void LLPresetsManager::loadPreset(const std::string& subdirectory, std::string n
     bool edit_camera_movement = gSavedSettings.getBOOL("EditCameraMovement");
 
     mIgnoreChangedSignal = true;
-    if(gSavedSettings.loadFromFile(full_path, false, true) > 0)
+    U32 loaded = 0;
+    {
+        // Each changed setting notifies its listeners once, while they're
+        // still being ignored here.
+        LLControlTransaction transaction(LLControlTransaction::DELIVER_ON_END);
+        loaded = gSavedSettings.loadFromFile(full_path, false, true);
+    }
+    if(loaded > 0)
     {
         mIgnoreChangedSignal = false;
         if(PRESETS_GRAPHIC == subdirectory)
@@ -137,10 +137,19 @@ void LLSkinningUtil::initSkinningMatrixPalette(
 
     LLMatrix4a world[LL_CHARACTER_MAX_ANIMATED_JOINTS];
 
+    // The flat skeleton indexes every joint by number, and its last pass
+    // left their world matrices current, so getWorldMatrix4a() is just a
+    // dirty check.  Falls back to getJoint() if the skeleton changed since.
+    const LLFlatSkeleton& flat_skeleton = avatar->getFlatSkeleton();
+
     for (S32 j = 0; j < count; ++j)
     {
         S32 joint_num = skin->mJointNums[j];
-        LLJoint *joint = avatar->getJoint(joint_num);
+        LLJoint *joint = flat_skeleton.getJoint(joint_num);
+        if (!joint)
+        {
+            joint = avatar->getJoint(joint_num);
+        }
 
         if (joint)
         {
@@ -38,6 +38,7 @@
 
 #include "llviewermedia_streamingaudio.h"
 #include "llaudioengine.h"
+#include "llaudiodecodemgr.h"
 
 #ifdef LL_OPENAL
 #include "llaudioengine_openal.h"
@@ -649,6 +650,10 @@ bool idle_startup()
 
         if (false == gSavedSettings.getBOOL("NoAudio"))
         {
+            // before any engine can queue a decode; later changes go
+            // through the setting's listener
+            LLAudioDecodeMgr::getInstance()->setPCMCacheSize((size_t)gSavedSettings.getU32("AudioPCMCacheSizeMB") * 1024 * 1024);
+
             delete gAudiop;
             gAudiop = NULL;
 
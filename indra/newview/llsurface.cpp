@@ -33,7 +33,7 @@
 #include "llviewertexturelist.h"
 #include "llpatchvertexarray.h"
 #include "patch_dct.h"
-#include "patch_code.h"
+#include "llpatchdecoder.h"
 #include "llbitpack.h"
 #include "llviewerobjectlist.h"
 #include "llregionhandle.h"
@@ -641,31 +641,41 @@ template bool LLSurface::idleUpdate</*PBR=*/true>(F32 max_update_time);
 
 void LLSurface::decompressDCTPatch(LLBitPack &bitpack, LLGroupHeader *gopp, bool b_large_patch)
 {
+    // Main thread only, LLVLManager decodes on workers with their own
+    static LLPatchDecoder decoder;
 
-    LLPatchHeader  ph;
-    S32 j, i;
-    S32 patch[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
-    LLSurfacePatch *patchp;
+    LLDecodedLandPatches patches;
+    if (decoder.setPatchSize(gopp->patch_size))
+    {
+        decodeDCTPatches(bitpack, decoder, mPatchesPerEdge, patches);
+    }
+    else
+    {
+        LL_WARNS() << "Received invalid terrain packet - unsupported patch size " << (S32)gopp->patch_size << LL_ENDL;
+    }
+    applyDecodedPatches(patches);
+}
 
-    init_patch_decompressor(gopp->patch_size);
-    gopp->stride = mGridsPerEdge;
-    set_group_of_patch_header(gopp);
+// static
+bool LLSurface::decodeDCTPatches(LLBitPack &bitpack, LLPatchDecoder &decoder, S32 patches_per_edge, LLDecodedLandPatches &out)
+{
+    LL_PROFILE_ZONE_SCOPED;
 
-    while (1)
-    {
-        decode_patch_header(bitpack, &ph);
-        if (ph.quant_wbits == END_OF_PATCHES)
-        {
-            break;
-        }
+    const S32 size = decoder.getPatchSize();
+    const S32 patch_area = size*size;
+    S32 patch[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+    LLPatchHeader ph;
 
-        i = ph.patchids >> 5;
-        j = ph.patchids & 0x1F;
+    out.mPatchSize = size;
+    while (decoder.decodePatchHeader(bitpack, ph))
+    {
+        S32 i = ph.patchids >> 5;
+        S32 j = ph.patchids & 0x1F;
 
-        if ((i >= mPatchesPerEdge) || (j >= mPatchesPerEdge))
+        if ((i >= patches_per_edge) || (j >= patches_per_edge))
         {
             LL_WARNS() << "Received invalid terrain packet - patch header patch ID incorrect!"
-                << " patches per edge " << mPatchesPerEdge
+                << " patches per edge " << patches_per_edge
                 << " i " << i
                 << " j " << j
                 << " dc_offset " << ph.dc_offset
@@ -673,14 +683,50 @@ void LLSurface::decompressDCTPatch(LLBitPack &bitpack, LLGroupHeader *gopp, bool
                 << " quant_wbits " << (S32)ph.quant_wbits
                 << " patchids " << (S32)ph.patchids
                 << LL_ENDL;
-            return;
+            return false;
+        }
+
+        if (!decoder.decodePatch(bitpack, ph, patch))
+        {
+            LL_WARNS() << "Received invalid terrain packet - truncated patch " << i << "," << j << LL_ENDL;
+            return false;
         }
 
-        patchp = &mPatchList[j*mPatchesPerEdge + i];
+        out.mPatchIDs.push_back(ph.patchids);
+        out.mHeights.resize(out.mHeights.size() + patch_area);
+        decoder.decompressPatch(patch, ph, &out.mHeights[out.mHeights.size() - patch_area], size);
+    }
 
+    if (ph.quant_wbits != END_OF_PATCHES)
+    {
+        LL_WARNS() << "Received invalid terrain packet - truncated patch header" << LL_ENDL;
+        return false;
+    }
+    return true;
+}
+
+void LLSurface::applyDecodedPatches(const LLDecodedLandPatches &patches)
+{
+    LL_PROFILE_ZONE_SCOPED;
 
-        decode_patch(bitpack, patch);
-        decompress_patch(patchp->getDataZ(), patch, &ph);
+    const S32 size = patches.mPatchSize;
+    for (size_t n = 0; n < patches.mPatchIDs.size(); n++)
+    {
+        S32 i = patches.mPatchIDs[n] >> 5;
+        S32 j = patches.mPatchIDs[n] & 0x1F;
+        if ((i >= mPatchesPerEdge) || (j >= mPatchesPerEdge))
+        {
+            continue;
+        }
+
+        LLSurfacePatch *patchp = &mPatchList[j*mPatchesPerEdge + i];
+
+        F32 *data_z = patchp->getDataZ();
+        const F32 *heights = &patches.mHeights[n*size*size];
+        for (S32 row = 0; row < size; row++)
+        {
+            memcpy(data_z + row*mGridsPerEdge, heights + row*size, size*sizeof(F32));
+        }
 
         // Update edges for neighbors.  Need to guarantee that this gets done before we generate vertical stats.
         patchp->updateNorthEdge();
@@ -62,6 +62,17 @@ class LLViewerRegion;
 class LLSurfacePatch;
 class LLBitPack;
 class LLGroupHeader;
+class LLPatchDecoder;
+
+// Land patches decoded from one LayerData packet, waiting to be copied
+// into a surface
+class LLDecodedLandPatches
+{
+public:
+    S32 mPatchSize = 0;
+    std::vector<U16> mPatchIDs;     // (x << 5) | y, as sent
+    std::vector<F32> mHeights;      // mPatchSize*mPatchSize per patch, rows packed
+};
 
 class LLSurface
 {
@@ -85,6 +96,14 @@ public:
     void disconnectAllNeighbors();
 
     virtual void decompressDCTPatch(LLBitPack &bitpack, LLGroupHeader *gopp, bool b_large_patch);
+
+    // Decodes the patches following the group header without touching any
+    // surface, so it can run on a worker with its own decoder.  Returns
+    // false if the packet is malformed, out keeps the patches before that.
+    static bool decodeDCTPatches(LLBitPack &bitpack, LLPatchDecoder &decoder, S32 patches_per_edge, LLDecodedLandPatches &out);
+
+    // Copies decoded heights in, dirtying only those patches and their neighbors
+    void applyDecodedPatches(const LLDecodedLandPatches &patches);
     virtual void updatePatchVisibilities(LLAgent &agent);
 
     inline F32 getZ(const U32 k) const              { return mSurfaceZ[k]; }
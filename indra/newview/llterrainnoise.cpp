@@ -0,0 +1,164 @@
+/**
+ * @file llterrainnoise.cpp
+ * @brief Per region cache of the noise that breaks up terrain composition.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llterrainnoise.h"
+
+#include "noise.h"
+#include "workqueue.h"
+
+namespace
+{
+    // Same constants as the per texel version this replaced
+    const F32 SLOPE_SQUARED = 1.5f*1.5f;
+    const F32 XY_SCALE_INV = 1.f/4.9215f;
+    const F32 LOW_FREQUENCY = 0.2222222222f;
+    const F32 LOW_MAGNITUDE = 6.5f;
+    const F32 NOISE_MAGNITUDE = 2.f;   // Degree to which noise modulates composition layer (versus simple height)
+
+    const S32 CHUNK = 64;
+}
+
+LLTerrainNoise::LLTerrainNoise(F64 origin_x, F64 origin_y, S32 width, F32 scale)
+    : mOriginX(origin_x),
+      mOriginY(origin_y),
+      mWidth(width),
+      mScale(scale),
+      mValues(width*width),
+      mBandCount((width + BAND_ROWS - 1)/BAND_ROWS)
+{
+    mBandState.reset(new std::atomic<U8>[mBandCount]);
+    for (S32 band = 0; band < mBandCount; band++)
+    {
+        mBandState[band] = BAND_EMPTY;
+    }
+}
+
+bool LLTerrainNoise::isReady(S32 y_begin, S32 y_end) const
+{
+    for (S32 band = y_begin/BAND_ROWS; band*BAND_ROWS < y_end; band++)
+    {
+        if (mBandState[band].load(std::memory_order_acquire) != BAND_READY)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LLTerrainNoise::requestRows(S32 y_begin, S32 y_end, bool threaded)
+{
+    if (isReady(y_begin, y_end))
+    {
+        return true;
+    }
+
+    // The tables noise2() builds on first use are shared by the workers
+    init_noise();
+
+    LL::WorkQueue::ptr_t general_queue = threaded ? LL::WorkQueue::getInstance("General") : nullptr;
+    for (S32 band = y_begin/BAND_ROWS; band*BAND_ROWS < y_end; band++)
+    {
+        U8 state = BAND_EMPTY;
+        if (!mBandState[band].compare_exchange_strong(state, BAND_QUEUED))
+        {
+            continue;
+        }
+
+        const S32 band_begin = band*BAND_ROWS;
+        const S32 band_end = llmin(band_begin + BAND_ROWS, mWidth);
+        bool posted = false;
+        if (general_queue)
+        {
+            std::shared_ptr<LLTerrainNoise> self = shared_from_this();
+            posted = general_queue->post(
+                [self, band_begin, band_end]() // Work done on general queue
+                {
+                    LL_PROFILE_ZONE_NAMED("terrain noise band");
+                    self->generateRows(band_begin, band_end);
+                });
+        }
+        if (!posted)
+        {
+            generateRows(band_begin, band_end);
+        }
+    }
+
+    return isReady(y_begin, y_end);
+}
+
+void LLTerrainNoise::generateRows(S32 y_begin, S32 y_end)
+{
+    for (S32 y = y_begin; y < y_end; y++)
+    {
+        generateRow(0, y, mWidth, &mValues[y*mWidth]);
+    }
+
+    for (S32 band = y_begin/BAND_ROWS; band*BAND_ROWS < y_end; band++)
+    {
+        mBandState[band].store(BAND_READY, std::memory_order_release);
+    }
+}
+
+void LLTerrainNoise::generateRow(S32 x_begin, S32 y, S32 count, F32* out) const
+{
+    F32 vx[CHUNK], vy[CHUNK];
+    F32 lx[CHUNK], ly[CHUNK];
+    F32 hx[CHUNK], hy[CHUNK];
+    F32 low[CHUNK], high[CHUNK], base[CHUNK];
+
+    // Not height dependent, noise2() only ever looked at x and y
+    const F32 row = (F32)(mOriginY + (F32)(y*mScale))*XY_SCALE_INV;
+    for (S32 start = 0; start < count; start += CHUNK)
+    {
+        const S32 n = llmin(CHUNK, count - start);
+        for (S32 k = 0; k < n; k++)
+        {
+            const S32 x = x_begin + start + k;
+            vx[k] = (F32)(mOriginX + (F32)(x*mScale))*XY_SCALE_INV;  // Adjust to non-integer lattice
+            vy[k] = row;
+            lx[k] = vx[k]*LOW_FREQUENCY;
+            ly[k] = row*LOW_FREQUENCY;
+            hx[k] = 2.f*vx[k];
+            hy[k] = 2.f*row;
+        }
+
+        noise2v(lx, ly, low, n);    // Low freq component for large divisions
+        noise2v(hx, hy, high, n);   // turbulence2(vec, 2), high frequency component
+        noise2v(vx, vy, base, n);
+
+        F32* dst = out + start;
+        for (S32 k = 0; k < n; k++)
+        {
+            F32 turbulence = high[k]/2.f;
+            turbulence += base[k];
+            F32 twiddle = low[k]*LOW_MAGNITUDE;
+            twiddle += turbulence*SLOPE_SQUARED;
+            dst[k] = twiddle*NOISE_MAGNITUDE;
+        }
+    }
+}
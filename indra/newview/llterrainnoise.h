@@ -0,0 +1,88 @@
+/**
+ * @file llterrainnoise.h
+ * @brief Per region cache of the noise that breaks up terrain composition.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTERRAINNOISE_H
+#define LL_LLTERRAINNOISE_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// The perlin noise LLVLComposition::generateHeights() adds to the terrain
+// height so that the boundaries between terrain textures (or materials)
+// don't follow height contours.  It depends only on the position of the
+// texel, so it is generated once per region, in bands of rows on the
+// General work queue, and reused every time the terrain is edited.
+//
+// Threads:  requestRows() and isReady() on the main thread, the bands are
+// filled by workers.  A band is written by exactly one thread and only
+// read once it is marked ready.
+class LLTerrainNoise : public std::enable_shared_from_this<LLTerrainNoise>
+{
+public:
+    static const S32 BAND_ROWS = 16;
+
+    // origin_x, origin_y: global position of the region, in meters
+    // width: texels per region edge, scale: meters per texel
+    LLTerrainNoise(F64 origin_x, F64 origin_y, S32 width, F32 scale);
+
+    // Returns true if rows [y_begin, y_end) are ready.  Otherwise makes
+    // sure every band covering them is on its way, on the General queue if
+    // threaded (and it is running) or else right here, and returns whether
+    // that made the requested rows ready.
+    bool requestRows(S32 y_begin, S32 y_end, bool threaded);
+    bool isReady(S32 y_begin, S32 y_end) const;
+
+    F32 get(S32 x, S32 y) const { return mValues[y*mWidth + x]; }
+
+    // Fills rows [y_begin, y_end), whole bands, and marks those bands
+    // ready.  Any thread, but not two threads on the same band.
+    void generateRows(S32 y_begin, S32 y_end);
+
+    // Noise for count texels of row y starting at x_begin, without
+    // touching the cache
+    void generateRow(S32 x_begin, S32 y, S32 count, F32* out) const;
+
+    S32 getWidth() const { return mWidth; }
+
+private:
+    enum EBandState : U8
+    {
+        BAND_EMPTY,
+        BAND_QUEUED,
+        BAND_READY
+    };
+
+    F64 mOriginX;
+    F64 mOriginY;
+    S32 mWidth;
+    F32 mScale;
+    std::vector<F32> mValues;
+    std::unique_ptr<std::atomic<U8>[]> mBandState;
+    S32 mBandCount;
+};
+
+#endif // LL_LLTERRAINNOISE_H
@@ -363,16 +363,6 @@ private:
         LLUUID mID;
     };
 
-    struct Compare
-    {
-        // lhs < rhs
-        bool operator()(const LLTextureFetchWorker* lhs, const LLTextureFetchWorker* rhs) const
-        {
-            // greater priority is "less"
-            return lhs->mImagePriority > rhs->mImagePriority;
-        }
-    };
-
 public:
 
     // Threads:  Ttf
@@ -488,7 +478,7 @@ private:
     bool acquireHttpSemaphore()
         {
             llassert(! mHttpHasResource);
-            if (mFetcher->mHttpSemaphore >= mFetcher->mHttpHighWater)
+            if (mFetcher->mHttpSemaphore >= mFetcher->mHttpTargetConcurrency)
             {
                 return false;
             }
@@ -542,6 +532,7 @@ private:
     S32 mLoadedDiscard;
     S32 mDecodedDiscard;
     LLFrameTimer mRequestedDeltaTimer;
+    F64 mHttpStartTime; // LLTimer::getTotalSeconds() when the GET was issued
     LLFrameTimer mFetchDeltaTimer;
     LLTimer mCacheReadTimer;
     LLTimer mDecodeTimer;
@@ -877,6 +868,7 @@ LLTextureFetchWorker::LLTextureFetchWorker(LLTextureFetch* fetcher,
       mCacheWriteTime(0.f),
       mDecodeTime(0.f),
       mFetchTime(0.f),
+      mHttpStartTime(0.0),
       mCacheReadHandle(LLTextureCache::nullHandle()),
       mCacheWriteHandle(LLTextureCache::nullHandle()),
       mRequestedSize(0),
@@ -1345,7 +1337,8 @@ bool LLTextureFetchWorker::doWork(S32 param)
             (mFetcher->getHttpWaitersCount() || ! acquireHttpSemaphore()))
         {
             setState(WAIT_HTTP_RESOURCE2);
-            mFetcher->addHttpWaiter(this->mID);
+            S32 cur_size = mFormattedImage.notNull() ? mFormattedImage->getDataSize() : 0;
+            mFetcher->addHttpWaiter(this->mID, mImagePriority, llmax(mDesiredSize - cur_size, 0));
             ++mResourceWaitCount;
             return false;
         }
@@ -1437,6 +1430,7 @@ bool LLTextureFetchWorker::doWork(S32 param)
         }
 
         mRequestedDeltaTimer.reset();
+        mHttpStartTime = LLTimer::getTotalSeconds();
         mLoaded = false;
         mGetStatus = LLCore::HttpStatus();
         mGetReason.clear();
@@ -2024,6 +2018,10 @@ void LLTextureFetchWorker::onCompleted(LLCore::HttpHandle handle, LLCore::HttpRe
     }
 
     mFetcher->removeFromHTTPQueue(mID, data_size);
+    if (success && data_size > 0)
+    {
+        mFetcher->recordHttpCompleted(data_size, LLTimer::getTotalSeconds() - mHttpStartTime);
+    }
 
     recordTextureDone(true, data_size);
 }                                                                       // -Mw
@@ -2451,6 +2449,23 @@ LLTextureFetch::LLTextureFetch(LLTextureCache* cache, bool threaded, bool qa_mod
     mHttpHighWater = HTTP_NONPIPE_REQUESTS_HIGH_WATER;
     mHttpLowWater = HTTP_NONPIPE_REQUESTS_LOW_WATER;
     mHttpSemaphore = 0;
+    mHttpTargetConcurrency = mHttpHighWater;
+
+    // Optional request trace for replay with LLTextureFetchSimulator
+    std::string trace_file = gSavedSettings.getString("TextureFetchSchedulerTrace");
+    if (!trace_file.empty())
+    {
+        mHttpSchedulerTrace = std::make_unique<llofstream>(gDirUtilp->getExpandedFilename(LL_PATH_LOGS, trace_file));
+        if (mHttpSchedulerTrace->is_open())
+        {
+            LL_INFOS(LOG_TXT) << "Recording texture fetch scheduler trace to " << trace_file << LL_ENDL;
+            mHttpScheduler.setTraceStream(mHttpSchedulerTrace.get());
+        }
+        else
+        {
+            mHttpSchedulerTrace.reset();
+        }
+    }
 
     // If that test log has ben requested but not yet created, create it
     if (LLMetricPerformanceTesterBasic::isMetricLogRequested(sTesterName) && !LLMetricPerformanceTesterBasic::getTester(sTesterName))
@@ -2467,6 +2482,7 @@ LLTextureFetch::LLTextureFetch(LLTextureCache* cache, bool threaded, bool qa_mod
 LLTextureFetch::~LLTextureFetch()
 {
     clearDeleteList();
+    mHttpScheduler.setTraceStream(nullptr);
 
     while (! mCommands.empty())
     {
@@ -2475,7 +2491,7 @@ LLTextureFetch::~LLTextureFetch()
         delete req;
     }
 
-    mHttpWaitResource.clear();
+    mHttpScheduler.clear();
 
     delete mHttpRequest;
     mHttpRequest = NULL;
@@ -2852,7 +2868,10 @@ bool LLTextureFetch::updateRequestPriority(const LLUUID& id, F32 priority)
                 worker->lockWorkMutex();                                        // +Mw
                 worker->setImagePriority(priority);
                 worker->unlockWorkMutex();                                      // -Mw
-            }
+
+                LLMutexLock lock(&mNetworkQueueMutex);                          // +Mfnq
+                mHttpScheduler.reprioritize(id, priority, LLTimer::getTotalSeconds());
+            }                                                                   // -Mfnq
         });
 
     return true;
@@ -3205,11 +3224,11 @@ void LLTextureFetch::dump()
     }
 
     LL_INFOS(LOG_TXT) << "LLTextureFetch WAIT_HTTP_RESOURCE:" << LL_ENDL;
-    for (wait_http_res_queue_t::const_iterator iter(mHttpWaitResource.begin());
-         mHttpWaitResource.end() != iter;
+    for (LLTextureFetchScheduler::const_iterator iter(mHttpScheduler.begin());
+         mHttpScheduler.end() != iter;
          ++iter)
     {
-        LL_INFOS(LOG_TXT) << " ID: " << (*iter) << LL_ENDL;
+        LL_INFOS(LOG_TXT) << " ID: " << iter->first << LL_ENDL;
     }
 }
 
@@ -3218,10 +3237,10 @@ void LLTextureFetch::dump()
 // HTTP Resource Waiting Methods
 
 // Threads:  Ttf
-void LLTextureFetch::addHttpWaiter(const LLUUID & tid)
+void LLTextureFetch::addHttpWaiter(const LLUUID & tid, F32 priority, S32 expected_bytes)
 {
     mNetworkQueueMutex.lock();                                          // +Mfnq
-    mHttpWaitResource.insert(tid);
+    mHttpScheduler.enqueue(tid, priority, LLTimer::getTotalSeconds(), expected_bytes);
     mNetworkQueueMutex.unlock();                                        // -Mfnq
 }
 
@@ -3229,11 +3248,7 @@ void LLTextureFetch::addHttpWaiter(const LLUUID & tid)
 void LLTextureFetch::removeHttpWaiter(const LLUUID & tid)
 {
     mNetworkQueueMutex.lock();                                          // +Mfnq
-    wait_http_res_queue_t::iterator iter(mHttpWaitResource.find(tid));
-    if (mHttpWaitResource.end() != iter)
-    {
-        mHttpWaitResource.erase(iter);
-    }
+    mHttpScheduler.remove(tid, LLTimer::getTotalSeconds());
     mNetworkQueueMutex.unlock();                                        // -Mfnq
 }
 
@@ -3241,8 +3256,7 @@ void LLTextureFetch::removeHttpWaiter(const LLUUID & tid)
 bool LLTextureFetch::isHttpWaiter(const LLUUID & tid)
 {
     mNetworkQueueMutex.lock();                                          // +Mfnq
-    wait_http_res_queue_t::iterator iter(mHttpWaitResource.find(tid));
-    const bool ret(mHttpWaitResource.end() != iter);
+    const bool ret(mHttpScheduler.isQueued(tid));
     mNetworkQueueMutex.unlock();                                        // -Mfnq
     return ret;
 }
@@ -3250,118 +3264,84 @@ bool LLTextureFetch::isHttpWaiter(const LLUUID & tid)
 // Release as many requests as permitted from the WAIT_HTTP_RESOURCE2
 // state to the SEND_HTTP_REQ state based on their current priority.
 //
-// This data structures and code associated with this looks a bit
-// indirect and naive but it's done in the name of safety.  An
-// ordered container may become invalid from time to time due to
-// priority changes caused by actions in other threads.  State itself
-// could also suffer the same fate with canceled operations.  Even
-// done this way, I'm not fully trusting we're truly safe.  This
-// module is due for a major refactoring and we'll deal with it then.
+// mHttpScheduler keeps the waiters in priority order (with starvation
+// aging) and decides how many requests should be in flight from the
+// measured bandwidth-delay product and the decode backlog.  Waiters are
+// popped one at a time under Mfnq and the lock is dropped before a
+// worker is touched, so state changes made by other threads in the
+// meantime are caught by the checks below rather than by a snapshot.
 //
 // Threads:  Ttf
 // Locks:  -Mw (must not hold any worker when called)
 void LLTextureFetch::releaseHttpWaiters()
 {
     LL_PROFILE_ZONE_SCOPED;
-    // Use mHttpSemaphore rather than mHTTPTextureQueue.size()
-    // to avoid a lock.
-    if (mHttpSemaphore >= mHttpLowWater)
-        return;
-    S32 needed(mHttpHighWater - mHttpSemaphore);
-    if (needed <= 0)
-    {
-        // Would only happen if High/LowWater were changed behind
-        // our back.  In that case, defer fill until usage falls within
-        // limits.
-        return;
-    }
-
-    // Quickly make a copy of all the LLUIDs.  Get off the
-    // mutex as early as possible.
-    typedef std::vector<LLUUID> uuid_vec_t;
-    uuid_vec_t tids;
+    const S32 decode_backlog = (S32)LLAppViewer::getImageDecodeThread()->getPending();
 
+    S32 needed(0);
     {
         LLMutexLock lock(&mNetworkQueueMutex);                          // +Mfnq
-
-        if (mHttpWaitResource.empty())
+        mHttpScheduler.setDecodeBacklog(decode_backlog);
+        mHttpTargetConcurrency = mHttpScheduler.getTargetConcurrency(mHttpHighWater);
+        if (mHttpScheduler.getQueuedCount() == 0)
+        {
             return;
-        tids.reserve(mHttpWaitResource.size());
-        tids.assign(mHttpWaitResource.begin(), mHttpWaitResource.end());
+        }
+        // Use mHttpSemaphore rather than mHTTPTextureQueue.size()
+        // to avoid a lock.
+        needed = mHttpScheduler.getAdmissionCount(mHttpSemaphore, mHttpHighWater, mHttpLowWater);
     }                                                                   // -Mfnq
 
-    // Now lookup the UUUIDs to find valid requests and sort
-    // them in priority order, highest to lowest.  We're going
-    // to modify priority later as a side-effect of releasing
-    // these objects.  That, in turn, would violate the partial
-    // ordering assumption of std::set, std::map, etc. so we
-    // don't use those containers.  We use a vector and an explicit
-    // sort to keep the containers valid later.
-    typedef std::vector<LLTextureFetchWorker *> worker_list_t;
-    worker_list_t tids2;
-
-    tids2.reserve(tids.size());
-    for (uuid_vec_t::iterator iter(tids.begin());
-         tids.end() != iter;
-         ++iter)
+    // Release workers up to the admission count.  Since we aren't
+    // holding any locks while a worker is locked, we can be in
+    // competition with other callers.  Do defensive things like
+    // checking if someone else has moved any worker state around....
+    while (needed > 0)
     {
-        LLTextureFetchWorker * worker(getWorker(* iter));
-        if (worker)
+        LLUUID tid;
         {
-            tids2.push_back(worker);
-        }
-        else
+            LLMutexLock lock(&mNetworkQueueMutex);                      // +Mfnq
+            if (!mHttpScheduler.popNext(tid))
+            {
+                break;
+            }
+        }                                                               // -Mfnq
+
+        LLTextureFetchWorker * worker(getWorker(tid));
+        if (!worker)
         {
             // If worker isn't found, this should be due to a request
-            // for deletion.  We signal our recognition that this
-            // uuid shouldn't be used for resource waiting anymore by
-            // erasing it from the resource waiter list.  That allows
-            // deleteOK to do final deletion on the worker.
-            removeHttpWaiter(* iter);
+            // for deletion.  Having popped the uuid from the waiter
+            // list signals our recognition that it shouldn't be used
+            // for resource waiting anymore and allows deleteOK to do
+            // final deletion on the worker.
+            continue;
         }
-    }
-    tids.clear();
-
-    // Sort into priority order, if necessary and only as much as needed
-    if (tids2.size() > needed)
-    {
-        LLTextureFetchWorker::Compare compare;
-        std::partial_sort(tids2.begin(), tids2.begin() + needed, tids2.end(), compare);
-    }
-
-    // Release workers up to the high water mark.  Since we aren't
-    // holding any locks at this point, we can be in competition
-    // with other callers.  Do defensive things like getting
-    // refreshed counts of requests and checking if someone else
-    // has moved any worker state around....
-    for (worker_list_t::iterator iter2(tids2.begin()); tids2.end() != iter2; ++iter2)
-    {
-        LLTextureFetchWorker * worker(* iter2);
 
         worker->lockWorkMutex();                                        // +Mw
         if (LLTextureFetchWorker::WAIT_HTTP_RESOURCE2 != worker->mState)
         {
-            // Not in expected state, remove it, try the next one
+            // Not in expected state, already off the wait list, try the next one
             worker->unlockWorkMutex();                                  // -Mw
             LL_WARNS(LOG_TXT) << "Resource-waited texture " << worker->mID
                               << " in unexpected state:  " << worker->mState
                               << ".  Removing from wait list."
                               << LL_ENDL;
-            removeHttpWaiter(worker->mID);
             continue;
         }
 
         if (! worker->acquireHttpSemaphore())
         {
-            // Out of active slots, quit
+            // Out of active slots, put it back and quit
+            const F32 priority = worker->mImagePriority;
             worker->unlockWorkMutex();                                  // -Mw
+            addHttpWaiter(tid, priority, 0);
             break;
         }
 
         worker->setState(LLTextureFetchWorker::SEND_HTTP_REQ);
         worker->unlockWorkMutex();                                      // -Mw
-
-        removeHttpWaiter(worker->mID);
+        --needed;
     }
 }
 
@@ -3369,7 +3349,7 @@ void LLTextureFetch::releaseHttpWaiters()
 void LLTextureFetch::cancelHttpWaiters()
 {
     mNetworkQueueMutex.lock();                                          // +Mfnq
-    mHttpWaitResource.clear();
+    mHttpScheduler.clear();
     mNetworkQueueMutex.unlock();                                        // -Mfnq
 }
 
@@ -3377,11 +3357,19 @@ void LLTextureFetch::cancelHttpWaiters()
 int LLTextureFetch::getHttpWaitersCount()
 {
     mNetworkQueueMutex.lock();                                          // +Mfnq
-    int ret(static_cast<int>(mHttpWaitResource.size()));
+    int ret(static_cast<int>(mHttpScheduler.getQueuedCount()));
     mNetworkQueueMutex.unlock();                                        // -Mfnq
     return ret;
 }
 
+// Threads:  T*
+void LLTextureFetch::recordHttpCompleted(S32 bytes, F64 latency)
+{
+    mNetworkQueueMutex.lock();                                          // +Mfnq
+    mHttpScheduler.recordCompleted(bytes, latency, LLTimer::getTotalSeconds());
+    mNetworkQueueMutex.unlock();                                        // -Mfnq
+}
+
 
 // Threads:  T*
 void LLTextureFetch::updateStateStats(U32 cache_read, U32 cache_write, U32 res_wait)
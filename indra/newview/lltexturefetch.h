@@ -29,12 +29,15 @@
 
 #include <vector>
 #include <map>
+#include <memory>
 
 #include "lldir.h"
+#include "llfile.h"
 #include "llimage.h"
 #include "lluuid.h"
 #include "llworkerthread.h"
 #include "lltextureinfo.h"
+#include "lltexturefetchscheduler.h"
 #include "llimageworker.h"
 #include "httprequest.h"
 #include "httpoptions.h"
@@ -199,8 +202,12 @@ public:
     // ----------------------------------
     // HTTP resource waiting methods
 
+    // Queue a request for an HTTP slot.  priority is the worker's
+    // image priority, expected_bytes the size of the range to be
+    // requested (informational, used for scheduler traces).
+    //
     // Threads:  T*
-    void addHttpWaiter(const LLUUID & tid);
+    void addHttpWaiter(const LLUUID & tid, F32 priority, S32 expected_bytes);
 
     // Threads:  T*
     void removeHttpWaiter(const LLUUID & tid);
@@ -225,6 +232,12 @@ public:
 
     // Threads:  T*
     int getHttpWaitersCount();
+
+    // Feed a finished HTTP range request into admission control.
+    // latency is seconds from issuing the request to completion.
+    //
+    // Threads:  T*
+    void recordHttpCompleted(S32 bytes, F64 latency);
     // ----------------------------------
     // Stats management
 
@@ -380,8 +393,15 @@ private:
     // exceed the high water level (but not go below zero).
     LLAtomicS32                         mHttpSemaphore;                 // Ttf
 
-    typedef std::set<LLUUID> wait_http_res_queue_t;
-    wait_http_res_queue_t               mHttpWaitResource;              // Mfnq
+    // Requests in WAIT_HTTP_RESOURCE2, ordered by priority with
+    // starvation aging, plus the bandwidth/latency estimate that
+    // sets mHttpTargetConcurrency.
+    LLTextureFetchScheduler             mHttpScheduler;                 // Mfnq
+    std::unique_ptr<llofstream>         mHttpSchedulerTrace;            // Mfnq
+
+    // In-flight request ceiling chosen by mHttpScheduler, never
+    // more than mHttpHighWater.
+    LLAtomicS32                         mHttpTargetConcurrency;         // Ttf
 
     // Cumulative stats on the states/requests issued by
     // textures running through here.
@@ -0,0 +1,479 @@
+/**
+ * @file lltexturefetchscheduler.cpp
+ * @brief Priority and admission control for HTTP texture fetches.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "lltexturefetchscheduler.h"
+
+#include <algorithm>
+#include <deque>
+#include <iostream>
+#include <sstream>
+
+#include "llmath.h"
+
+namespace
+{
+    // smoothing for the average request size estimate
+    constexpr F64 REQUEST_BYTES_ALPHA = 0.1;
+    // assumed request size until something completes
+    constexpr F64 DEFAULT_REQUEST_BYTES = 32.0 * 1024.0;
+}
+
+LLTextureFetchScheduler::LLTextureFetchScheduler()
+    : LLTextureFetchScheduler(Params())
+{
+}
+
+LLTextureFetchScheduler::LLTextureFetchScheduler(const Params& params)
+    : mParams(params),
+      mDecodeBacklog(0),
+      mWindowStart(-1.0),
+      mWindowBytes(0.0),
+      mRateSamples(llmax(params.mRateWindowCount, 1U), 0.0),
+      mRateSampleNext(0),
+      mBottleneckRate(0.0),
+      mEpochStart(-1.0),
+      mEpochMinLatency(0.0),
+      mPrevEpochMinLatency(0.0),
+      mMinLatency(0.0),
+      mAvgRequestBytes(DEFAULT_REQUEST_BYTES),
+      mTrace(nullptr)
+{
+}
+
+F64 LLTextureFetchScheduler::heapKey(F32 priority, F64 enqueue_time) const
+{
+    // effective priority at time t is log2(priority) + (t - enqueue_time) / starvation,
+    // the t term is common to every waiter so it can be dropped from the key
+    const F64 level = log2((F64)llmax(priority, 1.f));
+    return level - enqueue_time / llmax(mParams.mStarvationSeconds, 0.001);
+}
+
+void LLTextureFetchScheduler::enqueue(const LLUUID& id, F32 priority, F64 now, S32 expected_bytes)
+{
+    auto found = mWaiters.find(id);
+    if (found != mWaiters.end())
+    {
+        // already waiting, keep its age
+        found->second.mPriority = priority;
+        mQueue.push(id, heapKey(priority, found->second.mEnqueueTime));
+    }
+    else
+    {
+        mWaiters.emplace(id, Waiter{ priority, now });
+        mQueue.push(id, heapKey(priority, now));
+    }
+
+    if (mTrace)
+    {
+        *mTrace << llformat("%.4f add ", now) << id << ' ' << priority << ' ' << expected_bytes << '\n';
+    }
+}
+
+bool LLTextureFetchScheduler::reprioritize(const LLUUID& id, F32 priority, F64 now)
+{
+    auto found = mWaiters.find(id);
+    if (found == mWaiters.end())
+    {
+        return false;
+    }
+    found->second.mPriority = priority;
+    mQueue.reprioritize(id, heapKey(priority, found->second.mEnqueueTime));
+
+    if (mTrace)
+    {
+        *mTrace << llformat("%.4f pri ", now) << id << ' ' << priority << '\n';
+    }
+    return true;
+}
+
+bool LLTextureFetchScheduler::remove(const LLUUID& id, F64 now)
+{
+    if (!mWaiters.erase(id))
+    {
+        return false;
+    }
+    mQueue.erase(id);
+
+    if (mTrace)
+    {
+        *mTrace << llformat("%.4f del ", now) << id << '\n';
+    }
+    return true;
+}
+
+void LLTextureFetchScheduler::clear()
+{
+    mQueue.clear();
+    mWaiters.clear();
+}
+
+bool LLTextureFetchScheduler::popNext(LLUUID& id)
+{
+    if (!mQueue.pop(&id))
+    {
+        return false;
+    }
+    mWaiters.erase(id);
+    return true;
+}
+
+void LLTextureFetchScheduler::rollRateWindow(F64 now)
+{
+    if (mWindowStart < 0.0)
+    {
+        mWindowStart = now;
+        return;
+    }
+
+    const F64 elapsed = now - mWindowStart;
+    if (elapsed < mParams.mRateWindowSeconds)
+    {
+        return;
+    }
+
+    mRateSamples[mRateSampleNext] = mWindowBytes / elapsed;
+    mRateSampleNext = (mRateSampleNext + 1) % (U32)mRateSamples.size();
+    mBottleneckRate = *std::max_element(mRateSamples.begin(), mRateSamples.end());
+
+    mWindowStart = now;
+    mWindowBytes = 0.0;
+}
+
+void LLTextureFetchScheduler::recordCompleted(S32 bytes, F64 latency, F64 now)
+{
+    rollRateWindow(now);
+    mWindowBytes += llmax(bytes, 0);
+
+    if (bytes > 0)
+    {
+        mAvgRequestBytes += (bytes - mAvgRequestBytes) * REQUEST_BYTES_ALPHA;
+    }
+
+    if (latency > 0.0)
+    {
+        if (mEpochStart < 0.0 || now - mEpochStart >= mParams.mLatencyEpochSeconds)
+        {
+            // start a new epoch, but remember the last one so the
+            // estimate doesn't jump the moment the epoch rolls over
+            mPrevEpochMinLatency = mEpochMinLatency;
+            mEpochMinLatency = latency;
+            mEpochStart = now;
+        }
+        else
+        {
+            mEpochMinLatency = llmin(mEpochMinLatency, latency);
+        }
+        mMinLatency = mPrevEpochMinLatency > 0.0 ? llmin(mPrevEpochMinLatency, mEpochMinLatency) : mEpochMinLatency;
+    }
+}
+
+S32 LLTextureFetchScheduler::getTargetConcurrency(S32 max_active) const
+{
+    const S32 min_active = llmin(mParams.mMinConcurrency, max_active);
+    S32 target = max_active;
+    if (hasEstimate())
+    {
+        const F64 bdp = mBottleneckRate * mMinLatency / llmax(mAvgRequestBytes, 1.0);
+        target = llclamp((S32)ceil(bdp * mParams.mConcurrencyGain), min_active, max_active);
+    }
+
+    // back off while decoding can't keep up
+    if (mDecodeBacklog >= mParams.mDecodeBacklogHardLimit)
+    {
+        target = min_active;
+    }
+    else if (mDecodeBacklog > mParams.mDecodeBacklogSoftLimit)
+    {
+        const F64 range = (F64)llmax(mParams.mDecodeBacklogHardLimit - mParams.mDecodeBacklogSoftLimit, 1);
+        const F64 scale = 1.0 - (mDecodeBacklog - mParams.mDecodeBacklogSoftLimit) / range;
+        target = llmax(min_active, (S32)(target * scale));
+    }
+
+    return target;
+}
+
+S32 LLTextureFetchScheduler::getAdmissionCount(S32 active, S32 max_active, S32 low_water) const
+{
+    const S32 target = getTargetConcurrency(max_active);
+    if (max_active > 0 && low_water < max_active)
+    {
+        // hysteresis, the low-water mark shrinks along with the target
+        const S32 refill_level = (S32)((S64)llmax(low_water, 0) * target / max_active);
+        if (active > refill_level)
+        {
+            return 0;
+        }
+    }
+    return llmax(0, target - active);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LLTextureFetchSimulator
+
+// static
+bool LLTextureFetchSimulator::parseTrace(std::istream& in, std::vector<Event>& events)
+{
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        std::istringstream fields(line);
+        Event event;
+        std::string op, id;
+        if (!(fields >> event.mTime >> op >> id) || !LLUUID::validate(id))
+        {
+            LL_WARNS() << "Bad texture trace line: " << line << LL_ENDL;
+            return false;
+        }
+        event.mID.set(id);
+        event.mPriority = 0.f;
+        event.mBytes = 0;
+
+        if (op == "add")
+        {
+            event.mType = Event::ADD;
+            fields >> event.mPriority >> event.mBytes;
+        }
+        else if (op == "pri")
+        {
+            event.mType = Event::PRIORITY;
+            fields >> event.mPriority;
+        }
+        else if (op == "del")
+        {
+            event.mType = Event::REMOVE;
+        }
+        else
+        {
+            LL_WARNS() << "Unknown texture trace op: " << line << LL_ENDL;
+            return false;
+        }
+        events.push_back(event);
+    }
+
+    std::stable_sort(events.begin(), events.end(),
+                     [](const Event& a, const Event& b) { return a.mTime < b.mTime; });
+    return true;
+}
+
+LLTextureFetchSimulator::LLTextureFetchSimulator(const Params& params, const LLTextureFetchScheduler::Params& scheduler_params)
+    : mParams(params),
+      mSchedulerParams(scheduler_params)
+{
+}
+
+LLTextureFetchSimulator::Results LLTextureFetchSimulator::run(const std::vector<Event>& events)
+{
+    enum EPhase { QUEUED, CONNECTING, TRANSFERRING, DECODE_WAIT, DECODING, DONE, CANCELLED };
+
+    struct Request
+    {
+        EPhase mPhase;
+        F32 mPriority;
+        F64 mAddTime;
+        F64 mAdmitTime;
+        F64 mRemaining;     // latency left while CONNECTING, bytes left while TRANSFERRING/DECODING
+        S32 mBytes;
+    };
+
+    LLTextureFetchScheduler scheduler(mSchedulerParams);
+    std::unordered_map<LLUUID, Request> requests;
+    std::vector<LLUUID> in_flight;
+    std::deque<LLUUID> decode_queue;
+    std::vector<LLUUID> decoding;
+    Results results;
+    S32 admitted = 0;
+    F64 total_wait = 0.0;
+    F64 total_completion = 0.0;
+    F64 total_weight = 0.0;
+    F64 weighted_completion = 0.0;
+
+    size_t next_event = 0;
+    size_t outstanding = 0;
+    const F64 dt = llmax(mParams.mTimeStep, 0.0001);
+    F64 now = 0.0;
+
+    for (S32 tick = 0; now <= mParams.mMaxTime; ++tick)
+    {
+        now = tick * dt;
+
+        // apply trace events due by now
+        for (; next_event < events.size() && events[next_event].mTime <= now; ++next_event)
+        {
+            const Event& event = events[next_event];
+            auto found = requests.find(event.mID);
+            switch (event.mType)
+            {
+            case Event::ADD:
+                if (found == requests.end() || found->second.mPhase == DONE || found->second.mPhase == CANCELLED)
+                {
+                    requests[event.mID] = Request{ QUEUED, event.mPriority, now, 0.0, 0.0, llmax(event.mBytes, 1) };
+                    scheduler.enqueue(event.mID, event.mPriority, now, event.mBytes);
+                    ++outstanding;
+                }
+                break;
+            case Event::PRIORITY:
+                if (found != requests.end())
+                {
+                    found->second.mPriority = event.mPriority;
+                    scheduler.reprioritize(event.mID, event.mPriority, now);
+                }
+                break;
+            case Event::REMOVE:
+                if (found != requests.end() && (found->second.mPhase == QUEUED || found->second.mPhase == CONNECTING || found->second.mPhase == TRANSFERRING))
+                {
+                    if (found->second.mPhase == QUEUED)
+                    {
+                        scheduler.remove(event.mID, now);
+                    }
+                    else
+                    {
+                        in_flight.erase(std::find(in_flight.begin(), in_flight.end(), event.mID));
+                    }
+                    found->second.mPhase = CANCELLED;
+                    ++results.mCancelled;
+                    --outstanding;
+                }
+                break;
+            }
+        }
+
+        if (next_event >= events.size() && outstanding == 0)
+        {
+            break;
+        }
+
+        // admission
+        const S32 backlog = (S32)(decode_queue.size() + decoding.size());
+        scheduler.setDecodeBacklog(backlog);
+        S32 admit = scheduler.getAdmissionCount((S32)in_flight.size(), mParams.mMaxActive, mParams.mLowWater);
+        LLUUID id;
+        while (admit-- > 0 && scheduler.popNext(id))
+        {
+            Request& request = requests[id];
+            request.mPhase = CONNECTING;
+            request.mAdmitTime = now;
+            request.mRemaining = mParams.mLatency;
+            in_flight.push_back(id);
+
+            const F64 wait = now - request.mAddTime;
+            ++admitted;
+            total_wait += wait;
+            results.mMaxQueueWait = llmax(results.mMaxQueueWait, wait);
+        }
+        results.mPeakActive = llmax(results.mPeakActive, (S32)in_flight.size());
+        results.mPeakDecodeBacklog = llmax(results.mPeakDecodeBacklog, backlog);
+
+        // network
+        S32 transferring = 0;
+        for (const LLUUID& flight_id : in_flight)
+        {
+            Request& request = requests[flight_id];
+            if (request.mPhase == CONNECTING)
+            {
+                request.mRemaining -= dt;
+                if (request.mRemaining <= 0.0)
+                {
+                    request.mPhase = TRANSFERRING;
+                    request.mRemaining = request.mBytes;
+                }
+            }
+            else
+            {
+                ++transferring;
+            }
+        }
+
+        if (transferring > 0)
+        {
+            const F64 share = mParams.mBandwidth * dt / transferring;
+            for (auto iter = in_flight.begin(); iter != in_flight.end(); )
+            {
+                Request& request = requests[*iter];
+                if (request.mPhase == TRANSFERRING)
+                {
+                    request.mRemaining -= share;
+                    if (request.mRemaining <= 0.0)
+                    {
+                        scheduler.recordCompleted(request.mBytes, now - request.mAdmitTime, now);
+                        request.mPhase = DECODE_WAIT;
+                        request.mRemaining = request.mBytes;
+                        decode_queue.push_back(*iter);
+                        iter = in_flight.erase(iter);
+                        continue;
+                    }
+                }
+                ++iter;
+            }
+        }
+
+        // decoders
+        while ((S32)decoding.size() < mParams.mDecoders && !decode_queue.empty())
+        {
+            requests[decode_queue.front()].mPhase = DECODING;
+            decoding.push_back(decode_queue.front());
+            decode_queue.pop_front();
+        }
+        for (auto iter = decoding.begin(); iter != decoding.end(); )
+        {
+            Request& request = requests[*iter];
+            request.mRemaining -= mParams.mDecodeRate * dt;
+            if (request.mRemaining <= 0.0)
+            {
+                request.mPhase = DONE;
+                const F64 completion = now - request.mAddTime;
+                const F64 weight = llmax((F64)request.mPriority, 1.0);
+                total_completion += completion;
+                weighted_completion += completion * weight;
+                total_weight += weight;
+                ++results.mCompleted;
+                results.mEndTime = now;
+                --outstanding;
+                iter = decoding.erase(iter);
+                continue;
+            }
+            ++iter;
+        }
+    }
+
+    if (admitted > 0)
+    {
+        results.mMeanQueueWait = total_wait / admitted;
+    }
+    if (results.mCompleted > 0)
+    {
+        results.mMeanCompletion = total_completion / results.mCompleted;
+        results.mWeightedCompletion = weighted_completion / llmax(total_weight, 1.0);
+    }
+
+    return results;
+}
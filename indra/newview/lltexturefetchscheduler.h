@@ -0,0 +1,213 @@
+/**
+ * @file lltexturefetchscheduler.h
+ * @brief Priority and admission control for HTTP texture fetches.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTEXTUREFETCHSCHEDULER_H
+#define LL_LLTEXTUREFETCHSCHEDULER_H
+
+#include <iosfwd>
+#include <unordered_map>
+#include <vector>
+
+#include "llindexedheap.h"
+#include "lluuid.h"
+
+// Decides which texture fetches waiting for an HTTP slot go next and how
+// many may be in flight at once.
+//
+// Ordering:  requests live in an indexed heap so reprioritizing one is
+// O(log n) rather than a re-sort of every waiter.  To prevent starvation
+// a request's effective priority doubles for every mStarvationSeconds it
+// has been waiting.  That bonus is folded into the heap key at enqueue
+// time (log2(priority) - enqueue_time / mStarvationSeconds), so the heap
+// never needs to be rebuilt as time passes.
+//
+// Admission:  the number of requests in flight is steered towards the
+// bandwidth-delay product of the connection, estimated from completed
+// requests (windowed max throughput times windowed min latency, in
+// requests) times mConcurrencyGain.  Admission is throttled further when
+// the decode backlog builds up, since fetching faster than we can decode
+// only adds memory pressure.  Until the first estimate is available the
+// caller's maximum applies.  Once the target is reached nothing more is
+// admitted until the number in flight drains to the caller's low-water
+// mark, scaled down with the target, so requests are released in batches
+// rather than one per completion.
+//
+// All times are passed in by the caller so the scheduler can be driven by
+// LLTimer in the viewer or by simulated time in LLTextureFetchSimulator.
+//
+// Not thread safe, LLTextureFetch guards it with its network queue mutex.
+class LLTextureFetchScheduler
+{
+public:
+    struct Params
+    {
+        F64 mStarvationSeconds = 4.0;       // waiting this long doubles effective priority
+        S32 mMinConcurrency = 2;            // never throttle below this many requests in flight
+        F64 mConcurrencyGain = 2.0;         // in-flight target as a multiple of the bandwidth-delay product
+        S32 mDecodeBacklogSoftLimit = 32;   // start scaling admission down at this decode backlog
+        S32 mDecodeBacklogHardLimit = 96;   // only mMinConcurrency in flight at or above this backlog
+        F64 mRateWindowSeconds = 1.0;       // throughput sample period
+        U32 mRateWindowCount = 8;           // throughput samples kept for the max filter
+        F64 mLatencyEpochSeconds = 10.0;    // min latency filter period
+    };
+
+    LLTextureFetchScheduler();
+    explicit LLTextureFetchScheduler(const Params& params);
+
+    const Params& getParams() const { return mParams; }
+
+    // Waiting requests.  expected_bytes is only used for trace recording.
+    void enqueue(const LLUUID& id, F32 priority, F64 now, S32 expected_bytes = 0);
+    bool reprioritize(const LLUUID& id, F32 priority, F64 now);
+    bool remove(const LLUUID& id, F64 now);
+    bool isQueued(const LLUUID& id) const   { return mQueue.contains(id); }
+    size_t getQueuedCount() const           { return mQueue.size(); }
+    void clear();
+
+    // Unordered traversal of waiting requests, for diagnostics
+    typedef LLIndexedHeap<LLUUID, F64>::const_iterator const_iterator;
+    const_iterator begin() const            { return mQueue.begin(); }
+    const_iterator end() const              { return mQueue.end(); }
+
+    // Take the waiting request with the highest effective priority
+    bool popNext(LLUUID& id);
+
+    // Admission control inputs
+    void setDecodeBacklog(S32 backlog)      { mDecodeBacklog = backlog; }
+    void recordCompleted(S32 bytes, F64 latency, F64 now);
+
+    // Number of additional requests that may be started given 'active'
+    // requests already in flight, a hard ceiling of 'max_active' and a
+    // refill level of 'low_water' at that ceiling.
+    S32 getAdmissionCount(S32 active, S32 max_active, S32 low_water) const;
+    S32 getTargetConcurrency(S32 max_active) const;
+
+    bool hasEstimate() const                { return mBottleneckRate > 0.0 && mMinLatency > 0.0; }
+    F64 getBottleneckRate() const           { return mBottleneckRate; } // bytes/sec
+    F64 getMinLatency() const               { return mMinLatency; }     // seconds
+    F64 getAverageRequestBytes() const      { return mAvgRequestBytes; }
+
+    // Trace recording for offline replay with LLTextureFetchSimulator.
+    // Stream must outlive the scheduler or be reset with nullptr.
+    void setTraceStream(std::ostream* stream) { mTrace = stream; }
+
+private:
+    F64 heapKey(F32 priority, F64 enqueue_time) const;
+    void rollRateWindow(F64 now);
+
+    struct Waiter
+    {
+        F32 mPriority;
+        F64 mEnqueueTime;
+    };
+
+    Params mParams;
+
+    LLIndexedHeap<LLUUID, F64> mQueue;
+    std::unordered_map<LLUUID, Waiter> mWaiters;
+
+    S32 mDecodeBacklog;
+
+    // throughput estimate
+    F64 mWindowStart;
+    F64 mWindowBytes;
+    std::vector<F64> mRateSamples;
+    U32 mRateSampleNext;
+    F64 mBottleneckRate;
+
+    // latency estimate
+    F64 mEpochStart;
+    F64 mEpochMinLatency;
+    F64 mPrevEpochMinLatency;
+    F64 mMinLatency;
+
+    F64 mAvgRequestBytes;
+
+    std::ostream* mTrace;
+};
+
+// Deterministic, offline replay of a texture request trace against a
+// simple network/decoder model, for comparing scheduling policies without
+// a grid.  Trace lines (as written by LLTextureFetchScheduler):
+//
+//   <seconds> add <uuid> <priority> <bytes>
+//   <seconds> pri <uuid> <priority>
+//   <seconds> del <uuid>
+//
+// The network delivers at most mBandwidth bytes/sec shared evenly across
+// requests in flight, each request pays mLatency seconds before its first
+// byte, and finished downloads queue for mDecoders decoders that each
+// process mDecodeRate bytes/sec.  Time advances in fixed mTimeStep ticks.
+class LLTextureFetchSimulator
+{
+public:
+    struct Params
+    {
+        F64 mBandwidth = 4.0 * 1024 * 1024;
+        F64 mLatency = 0.15;
+        S32 mMaxActive = 32;
+        S32 mLowWater = 16;
+        S32 mDecoders = 2;
+        F64 mDecodeRate = 8.0 * 1024 * 1024;
+        F64 mTimeStep = 0.01;
+        F64 mMaxTime = 600.0;
+    };
+
+    struct Event
+    {
+        enum EType { ADD, PRIORITY, REMOVE };
+        F64 mTime;
+        EType mType;
+        LLUUID mID;
+        F32 mPriority;
+        S32 mBytes;
+    };
+
+    struct Results
+    {
+        S32 mCompleted = 0;
+        S32 mCancelled = 0;
+        F64 mEndTime = 0.0;             // time last request finished decoding
+        F64 mMeanQueueWait = 0.0;       // time spent waiting for a slot
+        F64 mMaxQueueWait = 0.0;
+        F64 mMeanCompletion = 0.0;      // add to decoded
+        F64 mWeightedCompletion = 0.0;  // completion weighted by last known priority
+        S32 mPeakActive = 0;
+        S32 mPeakDecodeBacklog = 0;
+    };
+
+    static bool parseTrace(std::istream& in, std::vector<Event>& events);
+
+    LLTextureFetchSimulator(const Params& params, const LLTextureFetchScheduler::Params& scheduler_params);
+
+    Results run(const std::vector<Event>& events);
+
+private:
+    Params mParams;
+    LLTextureFetchScheduler::Params mSchedulerParams;
+};
+
+#endif // LL_LLTEXTUREFETCHSCHEDULER_H
@@ -34,6 +34,7 @@
 
 // For Listeners
 #include "llaudioengine.h"
+#include "llaudiodecodemgr.h"
 #include "llagent.h"
 #include "llagentcamera.h"
 #include "llconsole.h"
@@ -62,6 +63,7 @@
 #include "llparcel.h"
 #include "llkeyboard.h"
 #include "llerrorcontrol.h"
+#include "lltraceevents.h"
 #include "llappviewer.h"
 #include "llvosurfacepatch.h"
 #include "llvowlsky.h"
@@ -399,6 +401,13 @@ static void handleAudioVolumeChanged(const LLSD& newvalue)
     audio_update_volume(true);
 }
 
+static bool handleAudioPCMCacheSizeChanged(const LLSD& newvalue)
+{
+    // shrinking evicts the least recently played sounds right away
+    LLAudioDecodeMgr::getInstance()->setPCMCacheSize((size_t)newvalue.asInteger() * 1024 * 1024);
+    return true;
+}
+
 static bool handleJoystickChanged(const LLSD& newvalue)
 {
     LLViewerJoystick::getInstance()->setCameraNeedsUpdate(true);
@@ -509,6 +518,12 @@ static bool handleLogFileChanged(const LLSD& newvalue)
     return true;
 }
 
+static bool handleEventTraceChanged(const LLSD&)
+{
+    LLTrace::EventTrace::setEnabled(gSavedSettings.getBOOL("EventTrace"), gSavedSettings.getU32("EventTraceBufferSize"));
+    return true;
+}
+
 bool handleHideGroupTitleChanged(const LLSD& newvalue)
 {
     gAgent.setHideGroupTitle(newvalue);
@@ -863,6 +878,7 @@ void settings_setup_listeners()
     setting_setup_signal_listener(gSavedSettings, "MuteVoice", handleAudioVolumeChanged);
     setting_setup_signal_listener(gSavedSettings, "MuteAmbient", handleAudioVolumeChanged);
     setting_setup_signal_listener(gSavedSettings, "MuteUI", handleAudioVolumeChanged);
+    setting_setup_signal_listener(gSavedSettings, "AudioPCMCacheSizeMB", handleAudioPCMCacheSizeChanged);
     setting_setup_signal_listener(gSavedSettings, "WLSkyDetail", handleWLSkyDetailChanged);
     setting_setup_signal_listener(gSavedSettings, "JoystickAxis0", handleJoystickChanged);
     setting_setup_signal_listener(gSavedSettings, "JoystickAxis1", handleJoystickChanged);
@@ -911,6 +927,8 @@ void settings_setup_listeners()
     setting_setup_signal_listener(gSavedSettings, "BuildAxisDeadZone5", handleJoystickChanged);
     setting_setup_signal_listener(gSavedSettings, "DebugViews", handleDebugViewsChanged);
     setting_setup_signal_listener(gSavedSettings, "UserLogFile", handleLogFileChanged);
+    setting_setup_signal_listener(gSavedSettings, "EventTrace", handleEventTraceChanged);
+    setting_setup_signal_listener(gSavedSettings, "EventTraceBufferSize", handleEventTraceChanged);
     setting_setup_signal_listener(gSavedSettings, "RenderHideGroupTitle", handleHideGroupTitleChanged);
     setting_setup_signal_listener(gSavedSettings, "HighResSnapshot", handleHighResSnapshotChanged);
     setting_setup_signal_listener(gSavedSettings, "EnableVoiceChat", handleVoiceClientPrefsChanged);
@@ -60,6 +60,7 @@
 #include "llviewerregion.h"
 #include "llviewerstats.h"
 #include "llviewerstatsrecorder.h"
+#include "llphysicsmotion.h"
 #include "llvovolume.h"
 #include "llvoavatarself.h"
 #include "lltoolmgr.h"
@@ -929,6 +930,9 @@ void LLViewerObjectList::update(LLAgent &agent)
     }
     else
     {
+        LLVOAvatar::beginUpdateFrame();
+        LLVOAvatar::beginParallelAnimation();
+        LLPhysicsMotionController::beginBatch();
         for (std::vector<LLViewerObject*>::iterator idle_iter = idle_list.begin();
             idle_iter != idle_end; idle_iter++)
         {
@@ -936,6 +940,9 @@ void LLViewerObjectList::update(LLAgent &agent)
             llassert(objectp->isActive());
                 objectp->idleUpdate(agent, frame_time);
         }
+        LLVOAvatar::finishParallelAnimation();
+        // avatar physics of the whole crowd, once every motion has run
+        LLPhysicsMotionController::finishBatch();
 
         //update flexible objects
         LLVolumeImplFlexible::updateClass();
@@ -33,6 +33,7 @@
 // common includes
 #include "llstring.h"
 #include "lltrace.h"
+#include "lluuidhashmap.h"
 
 // project includes
 #include "llviewerobject.h"
@@ -204,7 +205,7 @@ protected:
 
     uuid_set_t   mDeadObjects;
 
-    std::map<LLUUID, LLPointer<LLViewerObject> > mUUIDObjectMap;
+    lluuid_hot_map<LLPointer<LLViewerObject> > mUUIDObjectMap;
 
     //set of objects that need to update their cost
     uuid_set_t   mStaleObjectCost;
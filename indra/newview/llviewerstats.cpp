@@ -139,7 +139,9 @@ LLTrace::CountStatHandle<>  FPS("FPS", "Frames rendered"),
                             KILLED("killed", "Number of times killed"),
                             TEX_BAKES("texbakes", "Number of times avatar textures have been baked"),
                             TEX_REBAKES("texrebakes", "Number of times avatar textures have been forced to rebake"),
-                            NUM_NEW_OBJECTS("numnewobjectsstat", "Number of objects in scene that were not previously in cache");
+                            NUM_NEW_OBJECTS("numnewobjectsstat", "Number of objects in scene that were not previously in cache"),
+                            AVATAR_COMPLEXITY_COMPUTED("avatarcomplexitycomputed", "Avatar attachments whose render complexity was computed"),
+                            AVATAR_COMPLEXITY_REUSED("avatarcomplexityreused", "Avatar attachments whose render complexity was reused from the last update");
 
 LLTrace::CountStatHandle<LLUnit<F64, LLUnits::Kilotriangles> >
                             TRIANGLES_DRAWN("trianglesdrawnstat");
@@ -137,7 +137,9 @@ extern LLTrace::CountStatHandle<>           FPS,
                                             KILLED,
                                             TEX_BAKES,
                                             TEX_REBAKES,
-                                            NUM_NEW_OBJECTS;
+                                            NUM_NEW_OBJECTS,
+                                            AVATAR_COMPLEXITY_COMPUTED,
+                                            AVATAR_COMPLEXITY_REUSED;
 
 extern LLTrace::CountStatHandle<LLUnit<F64, LLUnits::Kilotriangles> > TRIANGLES_DRAWN;
 
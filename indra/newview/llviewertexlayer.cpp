@@ -32,6 +32,7 @@
 #include "llimagej2c.h"
 #include "llnotificationsutil.h"
 #include "llviewerregion.h"
+#include "llviewertexture.h"
 #include "llglslshader.h"
 #include "llvoavatarself.h"
 #include "pipeline.h"
@@ -53,6 +54,7 @@ LLViewerTexLayerSetBuffer::LLViewerTexLayerSetBuffer(LLTexLayerSet* const owner,
     // ORDER_LAST => must render these after the hints are created.
     LLTexLayerSetBuffer(owner),
     LLViewerDynamicTexture(width, height, 4, LLViewerDynamicTexture::ORDER_LAST, false),
+    mCompositorJobStale(false),
     mNeedsUpdate(true),
     mNumLowresUpdates(0)
 {
@@ -98,6 +100,10 @@ void LLViewerTexLayerSetBuffer::dumpTotalByteCount()
 
 void LLViewerTexLayerSetBuffer::requestUpdate()
 {
+    if (mCompositorJob.notNull())
+    {
+        mCompositorJobStale = true;
+    }
     restartUpdateTimer();
     mNeedsUpdate = true;
     mNumLowresUpdates = 0;
@@ -115,6 +121,16 @@ bool LLViewerTexLayerSetBuffer::needsRender()
     llassert(mTexLayerSet->getAvatarAppearance() == gAgentAvatarp);
     if (!isAgentAvatarValid()) return false;
 
+    // Wait for a bake on the CPU to finish before starting another
+    if (mCompositorJob.notNull())
+    {
+        if (mCompositorJob->isDone())
+        {
+            finishCompositorJob();
+        }
+        return false;
+    }
+
     const bool update_now = mNeedsUpdate && isReadyToUpdate();
 
     // Don't render if we don't want to (or aren't ready to) update.
@@ -140,6 +156,58 @@ bool LLViewerTexLayerSetBuffer::needsRender()
     return getViewerTexLayerSet()->isLocalTextureDataAvailable();
 }
 
+// virtual
+bool LLViewerTexLayerSetBuffer::render()
+{
+    static LLCachedControl<bool> cpu_bakes(gSavedSettings, "AvatarCPUBakes", false);
+    if (cpu_bakes)
+    {
+        LLPointer<LLTexLayerCompositor::Job> job = mTexLayerSet->createCompositorJob(getCompositeWidth(), getCompositeHeight());
+        if (job.notNull() && LLTexLayerCompositor::post(job, "General"))
+        {
+            // Nothing to copy from the frame buffer, needsRender() uploads
+            // the bake when the job is done
+            mCompositorJob = job;
+            mCompositorJobStale = false;
+            return false;
+        }
+    }
+    return renderTexLayerSet(mBoundTarget);
+}
+
+void LLViewerTexLayerSetBuffer::finishCompositorJob()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+    LLPointer<LLTexLayerCompositor::Job> job = mCompositorJob;
+    mCompositorJob = NULL;
+
+    // On failure mNeedsUpdate is still set and the bake is tried again
+    const LLImageRaw* result = job->mResult;
+    if (!result)
+    {
+        return;
+    }
+    if (mGLTexturep.isNull() || !mGLTexturep->getHasGLTexture() || mGLTexturep->getDiscardLevel() != 0)
+    {
+        generateGLTexture();
+    }
+    if (!mGLTexturep->setSubImage(result, 0, 0, result->getWidth(), result->getHeight()))
+    {
+        return;
+    }
+
+    mTexLayerSet->finishCompositorJob(*job);
+    if (mCompositorJobStale)
+    {
+        // Show it, but leave the update pending
+        mGLTexturep->setGLTextureCreated(true);
+    }
+    else
+    {
+        midRenderTexLayerSet(true);
+    }
+}
+
 // virtual
 void LLViewerTexLayerSetBuffer::preRenderTexLayerSet()
 {
@@ -312,6 +380,23 @@ void LLViewerTexLayerSet::createComposite()
     }
 }
 
+// virtual
+LLImageRaw* LLViewerTexLayerSet::getLocalTextureRaw(LLGLTexture* tex)
+{
+    LLViewerFetchedTexture* fetched = LLViewerTextureManager::staticCastToFetchedTexture(tex);
+    if (!fetched)
+    {
+        return NULL;
+    }
+    if (!fetched->hasSavedRawImage())
+    {
+        // Keep the decoded image from now on, bakes use GL until it is there
+        fetched->forceToSaveRawImage(0);
+        return NULL;
+    }
+    return fetched->getSavedRawImage();
+}
+
 void LLViewerTexLayerSet::setUpdatesEnabled( bool b )
 {
     mUpdatesEnabled = b;
@@ -51,6 +51,7 @@ public:
     bool                        isLocalTextureDataFinal() const;
     void                        updateComposite();
     /*virtual*/void             createComposite();
+    /*virtual*/LLImageRaw*      getLocalTextureRaw(LLGLTexture* tex);
     void                        setUpdatesEnabled(bool b);
     bool                        getUpdatesEnabled() const   { return mUpdatesEnabled; }
 
@@ -111,7 +112,11 @@ protected:
     // Pass these along for tex layer rendering.
     virtual void            preRender(bool clear_depth) { preRenderTexLayerSet(); }
     virtual void            postRender(bool success) { postRenderTexLayerSet(success); }
-    virtual bool            render() { return renderTexLayerSet(mBoundTarget); }
+    virtual bool            render();
+private:
+    void                    finishCompositorJob();
+    LLPointer<LLTexLayerCompositor::Job> mCompositorJob;   // bake in progress on the CPU
+    bool                    mCompositorJobStale;            // an update was requested after it started
 
     //--------------------------------------------------------------------
     // Updates
@@ -39,7 +39,7 @@
 #include "llfetchedgltfmaterial.h"
 #include "llgltfmateriallist.h"
 #include "llviewerregion.h"
-#include "noise.h"
+#include "llterrainnoise.h"
 #include "llregionhandle.h" // for from_region_handle
 #include "llviewercontrol.h"
 
@@ -491,19 +491,25 @@ bool LLVLComposition::generateHeights(const F32 x, const F32 y,
         y_end = mWidth;
     }
 
-    LLVector3d origin_global = from_region_handle(mSurfacep->getRegion()->getHandle());
-
-    // For perlin noise generation...
-    const F32 slope_squared = 1.5f*1.5f;
-    const F32 xyScale = 4.9215f; //0.93284f;
-    const F32 zScale = 4; //0.92165f;
-    const F32 z_offset = 0.f;
-    const F32 noise_magnitude = 2.f;        //  Degree to which noise modulates composition layer (versus
-                                            //  simple height)
+    if (x_begin >= x_end || y_begin >= y_end)
+    {
+        return true;
+    }
 
-    const F32 xyScaleInv = (1.f / xyScale);
-    const F32 zScaleInv = (1.f / zScale);
+    // The noise only depends on position, so it is generated once for the
+    // whole region, off the main thread, and reused when the land changes
+    if (!mNoise)
+    {
+        LLVector3d origin_global = from_region_handle(mSurfacep->getRegion()->getHandle());
+        mNoise = std::make_shared<LLTerrainNoise>(origin_global.mdV[VX], origin_global.mdV[VY], mWidth, mScale);
+    }
+    static LLCachedControl<bool> threaded(gSavedSettings, "TerrainHeightsThreaded", true);
+    if (!mNoise->requestRows(y_begin, y_end, threaded))
+    {
+        return false;
+    }
 
+    const F32 z_offset = 0.f;
     const F32 inv_width = 1.f/mWidth;
 
     // OK, for now, just have the composition value equal the height at the point.
@@ -511,11 +517,6 @@ bool LLVLComposition::generateHeights(const F32 x, const F32 y,
     {
         for (S32 i = x_begin; i < x_end; i++)
         {
-
-            F32 vec[3];
-            F32 vec1[3];
-            F32 twiddle;
-
             // Bilinearly interpolate the start height and height range of the textures
             F32 start_height = bilinear(mStartHeight[SOUTHWEST],
                                         mStartHeight[SOUTHEAST],
@@ -532,20 +533,8 @@ bool LLVLComposition::generateHeights(const F32 x, const F32 y,
 
             F32 height = mSurfacep->resolveHeightRegion(location) + z_offset;
 
-            // Step 0: Measure the exact height at this texel
-            vec[0] = (F32)(origin_global.mdV[VX]+location.mV[VX])*xyScaleInv;   //  Adjust to non-integer lattice
-            vec[1] = (F32)(origin_global.mdV[VY]+location.mV[VY])*xyScaleInv;
-            vec[2] = height*zScaleInv;
-            //
             //  Choose material value by adding to the exact height a random value
-            //
-            vec1[0] = vec[0]*(0.2222222222f);
-            vec1[1] = vec[1]*(0.2222222222f);
-            vec1[2] = vec[2]*(0.2222222222f);
-            twiddle = noise2(vec1)*6.5f;                    //  Low freq component for large divisions
-
-            twiddle += turbulence2(vec, 2)*slope_squared;   //  High frequency component
-            twiddle *= noise_magnitude;
+            F32 twiddle = mNoise->get(i, j);
 
             F32 scaled_noisy_height = (height + twiddle - start_height) * F32(ASSET_COUNT) / height_range;
 
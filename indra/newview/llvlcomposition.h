@@ -27,6 +27,8 @@
 #ifndef LL_LLVLCOMPOSITION_H
 #define LL_LLVLCOMPOSITION_H
 
+#include <memory>
+
 #include "llfetchedgltfmaterial.h"
 #include "llimage.h"
 #include "llpointer.h"
@@ -36,6 +38,7 @@
 #include "llviewertexture.h"
 
 class LLSurface;
+class LLTerrainNoise;
 
 class LLViewerFetchedTexture;
 
@@ -122,7 +125,9 @@ public:
 
     void setSurface(LLSurface *surfacep);
 
-    // Viewer side hack to generate composition values
+    // Viewer side hack to generate composition values.  Returns false if
+    // not ready yet, including while the noise for these rows is being
+    // generated on the General queue.
     bool generateHeights(const F32 x, const F32 y, const F32 width, const F32 height);
     bool generateComposition();
 
@@ -162,6 +167,9 @@ protected:
     F32 mStartHeight[CORNER_COUNT];
     F32 mHeightRange[CORNER_COUNT];
 
+    // Created once the region origin is known, shared with the workers
+    std::shared_ptr<LLTerrainNoise> mNoise;
+
     F32 mTexScaleX = 16.f;
     F32 mTexScaleY = 16.f;
 };
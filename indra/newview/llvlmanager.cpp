@@ -31,10 +31,14 @@
 #include "indra_constants.h"
 #include "patch_code.h"
 #include "patch_dct.h"
+#include "llpatchdecoder.h"
+#include "llviewercontrol.h"
 #include "llviewerregion.h"
 #include "llframetimer.h"
 #include "llsurface.h"
 #include "llbitpack.h"
+#include "llworld.h"
+#include "workqueue.h"
 
 const   char    LAND_LAYER_CODE                 = 'L';
 const   char    WIND_LAYER_CODE                 = '7';
@@ -74,15 +78,49 @@ void LLVLManager::addLayerData(LLVLData *vl_datap, const S32Bytes mesg_size)
     mPacketData.push_back(vl_datap);
 }
 
+namespace
+{
+    // One frame's worth of land packets, decoded together
+    struct LandDecodeBatch
+    {
+        struct Packet
+        {
+            LLVLData *mData;            // deleted by the worker once decoded
+            LLViewerRegion *mRegionp;   // identity only, not dereferenced off the main thread
+            U64 mRegionHandle;
+            S32 mPatchesPerEdge;
+            LLDecodedLandPatches mPatches;
+        };
+        std::vector<Packet> mPackets;
+    };
+}
+
 void LLVLManager::unpackData(const S32 num_packets)
 {
     static LLFrameTimer decode_timer;
+    static LLCachedControl<bool> decode_threaded(gSavedSettings, "TerrainDecodeThreaded", true);
+
+    std::vector<LLVLData *> land;
+    std::vector<LLVLData *> deferred;
 
     S32 i;
     for (i = 0; i < mPacketData.size(); i++)
     {
         LLVLData *datap = mPacketData[i];
 
+        if (LAND_LAYER_CODE == datap->mType && (decode_threaded || mLandDecodePending))
+        {
+            if (mLandDecodePending)
+            {
+                deferred.push_back(datap);
+            }
+            else
+            {
+                land.push_back(datap);
+            }
+            continue;
+        }
+
         LLBitPack bit_pack(datap->mData, datap->mSize);
         LLGroupHeader goph;
 
@@ -100,14 +138,89 @@ void LLVLManager::unpackData(const S32 num_packets)
         {
 
         }
+        delete datap;
     }
+    mPacketData.swap(deferred);
 
-    for (i = 0; i < mPacketData.size(); i++)
+    if (!land.empty() && !decodeLandAsync(land))
     {
-        delete mPacketData[i];
+        // No worker to hand them to (shutting down), decode here
+        for (LLVLData *datap : land)
+        {
+            LLBitPack bit_pack(datap->mData, datap->mSize);
+            LLGroupHeader goph;
+            decode_patch_group_header(bit_pack, &goph);
+            datap->mRegionp->getLand().decompressDCTPatch(bit_pack, &goph, false);
+            delete datap;
+        }
+    }
+}
+
+bool LLVLManager::decodeLandAsync(std::vector<LLVLData *> &packets)
+{
+    LL::WorkQueue::ptr_t main_queue = LL::WorkQueue::getInstance("mainloop");
+    LL::WorkQueue::ptr_t general_queue = LL::WorkQueue::getInstance("General");
+    if (!main_queue || !general_queue)
+    {
+        return false;
+    }
+
+    auto batch = std::make_shared<LandDecodeBatch>();
+    batch->mPackets.resize(packets.size());
+    for (size_t i = 0; i < packets.size(); i++)
+    {
+        LandDecodeBatch::Packet &packet = batch->mPackets[i];
+        packet.mRegionp = packets[i]->mRegionp;
+        packet.mRegionHandle = packet.mRegionp->getHandle();
+        packet.mPatchesPerEdge = packet.mRegionp->getLand().getPatchesPerEdge();
+        packet.mData = packets[i];
+    }
+
+    bool posted = main_queue->postTo(
+        general_queue,
+        [batch]() // Work done on general queue
+        {
+            LL_PROFILE_ZONE_NAMED("decode land patches");
+            std::unique_ptr<LLPatchDecoder> decoder = std::make_unique<LLPatchDecoder>();
+            for (LandDecodeBatch::Packet &packet : batch->mPackets)
+            {
+                LLBitPack bit_pack(packet.mData->mData, packet.mData->mSize);
+                LLGroupHeader goph;
+                if (decoder->decodeGroupHeader(bit_pack, goph))
+                {
+                    LLSurface::decodeDCTPatches(bit_pack, *decoder, packet.mPatchesPerEdge, packet.mPatches);
+                }
+                else
+                {
+                    LL_WARNS() << "Received invalid terrain packet - bad group header, patch size "
+                               << (S32)goph.patch_size << LL_ENDL;
+                }
+                delete packet.mData;
+                packet.mData = NULL;
+            }
+        },
+        [this, batch]() // Callback to main thread
+        {
+            for (LandDecodeBatch::Packet &packet : batch->mPackets)
+            {
+                // The region may have gone away while its packets decoded
+                LLViewerRegion *regionp = LLWorld::getInstance()->getRegionFromHandle(packet.mRegionHandle);
+                if (regionp && regionp == packet.mRegionp)
+                {
+                    regionp->getLand().applyDecodedPatches(packet.mPatches);
+                }
+            }
+            mLandDecodePending = false;
+        });
+
+    if (!posted)
+    {
+        return false;
     }
-    mPacketData.clear();
 
+    mLandDecodePending = true;
+    packets.clear();
+    return true;
 }
 
 void LLVLManager::resetBitCounts()
@@ -53,11 +53,19 @@ public:
 
     void cleanupData(LLViewerRegion *regionp);
 protected:
+    // Decodes land packets on the General queue and applies the heights
+    // back on the main thread.  Takes ownership of the packets and returns
+    // true if the work could be posted.
+    bool decodeLandAsync(std::vector<LLVLData *> &packets);
 
     std::vector<LLVLData *> mPacketData;
     U32Bits mLandBits;
     U32Bits mWindBits;
     U32Bits mCloudBits;
+
+    // A batch of land packets is decoding, later ones wait their turn so
+    // that patches are applied in the order they arrived
+    bool mLandDecodePending = false;
 };
 
 class LLVLData
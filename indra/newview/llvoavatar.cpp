@@ -623,6 +623,9 @@ F32 LLVOAvatar::sGreyUpdateTime = 0.f;
 LLPointer<LLViewerTexture> LLVOAvatar::sCloudTexture = NULL;
 std::vector<LLUUID> LLVOAvatar::sAVsIgnoringARTLimit;
 S32 LLVOAvatar::sAvatarsNearby = 0;
+bool LLVOAvatar::sParallelAnimationOpen = false;
+LLCharacterUpdateScheduler LLVOAvatar::sUpdateScheduler;
+std::vector<LLVOAvatar::ParallelAnimationEntry> LLVOAvatar::sParallelAnimationBatch;
 
 //-----------------------------------------------------------------------------
 // Helper functions
@@ -861,6 +864,7 @@ void LLVOAvatar::markDead()
     }
     mVoiceVisualizer->markDead();
     LLLoadedCallbackEntry::cleanUpCallbackList(&mCallbackTextureList) ;
+    sUpdateScheduler.removeCharacter(mID);
     LLViewerObject::markDead();
 }
 
@@ -2799,8 +2803,29 @@ void LLVOAvatar::idleUpdate(LLAgent &agent, const F64 &time)
     // animate the character
     // store off last frame's root position to be consistent with camera position
     mLastRootPos = mRoot->getWorldPosition();
+    const F64SecondsImplicit update_start = LLTimer::getTotalSeconds();
     bool detailed_update = updateCharacter(agent);
+    if (mUpdateGranted)
+    {
+        // without the motions if finishParallelAnimation() runs them
+        mUpdateGranted = false;
+        sUpdateScheduler.recordUpdate(mID, LLTimer::getTotalSeconds() - update_start);
+    }
+    if (mParallelAnimationPending)
+    {
+        // finishParallelAnimation() takes it from here
+        return;
+    }
+
+    idleUpdateAfterCharacter(detailed_update);
+}
 
+//-----------------------------------------------------------------------------
+// idleUpdateAfterCharacter()
+// the part of idleUpdate() that depends on the animated skeleton
+//-----------------------------------------------------------------------------
+void LLVOAvatar::idleUpdateAfterCharacter(bool detailed_update)
+{
     static LLUICachedControl<bool> visualizers_in_calls("ShowVoiceVisualizersInCalls", false);
     bool voice_enabled = (visualizers_in_calls || LLVoiceClient::getInstance()->inProximalChannel()) &&
                          LLVoiceClient::getInstance()->getVoiceEnabled(mID);
@@ -2964,7 +2989,7 @@ void LLVOAvatar::idleUpdateMisc(bool detailed_update)
     LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
     if (LLVOAvatar::sJointDebug)
     {
-        LL_INFOS() << getFullname() << ": joint touches: " << LLJoint::sNumTouches << " updates: " << LLJoint::sNumUpdates << LL_ENDL;
+        LL_INFOS() << getFullname() << ": joint touches: " << LLJoint::sNumTouches.load() << " updates: " << LLJoint::sNumUpdates.load() << LL_ENDL;
     }
 
     LLJoint::sNumUpdates = 0;
@@ -3847,7 +3872,7 @@ void LLVOAvatar::slamPosition()
     {
         gPipeline.updateMoveNormalAsync(mDrawable);
     }
-    mRoot->updateWorldMatrixChildren();
+    updateWorldMatrices();
 }
 
 bool LLVOAvatar::isVisuallyMuted()
@@ -4006,6 +4031,11 @@ void LLVOAvatar::updateAppearanceMessageDebugText()
         {
             debug_line += " Imp" + llformat("%d[%d]:%.1f", mUpdatePeriod, mLastImpostorUpdateReason, ((F32)(gFrameTimeSeconds-mLastImpostorUpdateFrameTime)));
         }
+        F64Milliseconds update_cost = sUpdateScheduler.getUpdateCost(mID);
+        if (update_cost > F64Milliseconds(0.0))
+        {
+            debug_line += llformat(" Upd%.2fms", update_cost.value());
+        }
 
         addDebugText(debug_line);
 }
@@ -4767,7 +4797,11 @@ bool LLVOAvatar::updateCharacter(LLAgent &agent)
     // Set mUpdatePeriod and visible based on distance and other criteria,
     // and flag for impostor update if needed.
     //--------------------------------------------------------------------
-    bool needs_update = computeNeedsUpdate();
+    bool needs_update = computeNeedsUpdate() || mUpdateDeferred;
+    if (needs_update && !isSelf() && !isUIAvatar())
+    {
+        needs_update = scheduleUpdate();
+    }
 
     //--------------------------------------------------------------------
     // Early out if does not need update and not self
@@ -4843,12 +4877,31 @@ bool LLVOAvatar::updateCharacter(LLAgent &agent)
     {
         updateMotions(LLCharacter::FORCE_UPDATE);
     }
+    else if (sParallelAnimationOpen && !isSelf() && !isUIAvatar() && beginParallelMotionsUpdate())
+    {
+        // the motions are updated with everyone else's, then
+        // finishParallelAnimation() does the rest
+        sParallelAnimationBatch.push_back({ this, visible, was_sit_ground_constrained });
+        mParallelAnimationPending = true;
+        return visible;
+    }
     else
     {
         // Might be better to do HIDDEN_UPDATE if cloud
         updateMotions(LLCharacter::NORMAL_UPDATE);
     }
 
+    updateCharacterJoints(visible, was_sit_ground_constrained);
+
+    return visible;
+}
+
+//-----------------------------------------------------------------------------
+// updateCharacterJoints()
+// the rest of updateCharacter() once the motions have been applied
+//-----------------------------------------------------------------------------
+void LLVOAvatar::updateCharacterJoints(bool visible, bool was_sit_ground_constrained)
+{
     // Special handling for sitting on ground.
     if (!getParent() && (isSitting() || was_sit_ground_constrained))
     {
@@ -4871,15 +4924,108 @@ bool LLVOAvatar::updateCharacter(LLAgent &agent)
     updateFootstepSounds();
 
     // Update child joints as needed.
-    mRoot->updateWorldMatrixChildren();
+    updateWorldMatrices();
 
     if (visible)
     {
         // System avatar mesh vertices need to be reskinned.
         mNeedsSkin = true;
     }
+}
 
-    return visible;
+//-----------------------------------------------------------------------------
+// beginParallelAnimation()
+//-----------------------------------------------------------------------------
+// static
+void LLVOAvatar::beginParallelAnimation()
+{
+    static LLCachedControl<bool> parallel_animation(gSavedSettings, "AvatarParallelAnimation", false);
+    llassert(sParallelAnimationBatch.empty());
+    sParallelAnimationOpen = parallel_animation;
+}
+
+//-----------------------------------------------------------------------------
+// finishParallelAnimation()
+//-----------------------------------------------------------------------------
+// static
+void LLVOAvatar::finishParallelAnimation()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+    sParallelAnimationOpen = false;
+    if (sParallelAnimationBatch.empty())
+    {
+        return;
+    }
+
+    std::vector<LLMotionController*> controllers;
+    controllers.reserve(sParallelAnimationBatch.size());
+    for (const ParallelAnimationEntry& entry : sParallelAnimationBatch)
+    {
+        controllers.push_back(&entry.mAvatar.get()->getMotionController());
+    }
+
+    // Pose blending writes each avatar's own joints, world matrices are
+    // left to the main thread below
+    LLMotionController::updateMotionsParallel(controllers);
+
+    for (const ParallelAnimationEntry& entry : sParallelAnimationBatch)
+    {
+        LLVOAvatar* avatar = entry.mAvatar;
+        avatar->mParallelAnimationPending = false;
+        avatar->getMotionController().finishParallelUpdate();
+        if (avatar->isDead())
+        {
+            continue;
+        }
+        avatar->updateCharacterJoints(entry.mVisible, entry.mWasSitGroundConstrained);
+        avatar->idleUpdateAfterCharacter(entry.mVisible);
+    }
+    sParallelAnimationBatch.clear();
+}
+
+//-----------------------------------------------------------------------------
+// beginUpdateFrame()
+//-----------------------------------------------------------------------------
+// static
+void LLVOAvatar::beginUpdateFrame()
+{
+    static LLCachedControl<F32> update_budget(gSavedSettings, "AvatarUpdateBudget", 0.f);
+    static LLCachedControl<U32> max_deferred_frames(gSavedSettings, "AvatarUpdateMaxDeferredFrames", 16);
+    sUpdateScheduler.setBudget(F64Milliseconds(llmax((F32)update_budget, 0.f)));
+    sUpdateScheduler.setMaxDeferredFrames(max_deferred_frames);
+    sUpdateScheduler.beginFrame();
+}
+
+//-----------------------------------------------------------------------------
+// scheduleUpdate()
+//-----------------------------------------------------------------------------
+bool LLVOAvatar::scheduleUpdate()
+{
+    mUpdateGranted = sUpdateScheduler.requestUpdate(mID, getPixelArea(), getUpdateInterest());
+    mUpdateDeferred = !mUpdateGranted;
+    return mUpdateGranted;
+}
+
+//-----------------------------------------------------------------------------
+// getUpdateInterest()
+//-----------------------------------------------------------------------------
+U32 LLVOAvatar::getUpdateInterest() const
+{
+    U32 interest = LLCharacterUpdateScheduler::INTEREST_NONE;
+    if (mTyping || LLVoiceClient::getInstance()->getIsSpeaking(mID))
+    {
+        interest |= LLCharacterUpdateScheduler::INTEREST_CHATTING;
+    }
+    if (isSelected())
+    {
+        interest |= LLCharacterUpdateScheduler::INTEREST_SELECTED;
+    }
+    const LLViewerObject* focus = gAgentCamera.getFocusObject();
+    if (focus && (focus == this || focus->getAvatar() == this))
+    {
+        interest |= LLCharacterUpdateScheduler::INTEREST_FOCUS;
+    }
+    return interest;
 }
 
 //-----------------------------------------------------------------------------
@@ -4979,7 +5125,7 @@ void LLVOAvatar::debugBodySize() const
 //------------------------------------------------------------------------
 void LLVOAvatar::postPelvisSetRecalc()
 {
-    mRoot->updateWorldMatrixChildren();
+    updateWorldMatrices();
     computeBodySize();
     dirtyMesh(2);
 }
@@ -7164,13 +7310,18 @@ void LLVOAvatar::updateVisualParams()
         }
     }
 
+    // Morphs only accumulate until the end of the batch, then the normals
+    // of every vertex they moved are computed once
+    static LLCachedControl<bool> parallel_morphs(gSavedSettings, "AvatarParallelMorphs", true);
+    beginMorphBatch();
     LLCharacter::updateVisualParams();
+    endMorphBatch(parallel_morphs ? "General" : "");
 
     if (mLastSkeletonSerialNum != mSkeletonSerialNum)
     {
         computeBodySize();
         mLastSkeletonSerialNum = mSkeletonSerialNum;
-        mRoot->updateWorldMatrixChildren();
+        updateWorldMatrices();
     }
 
     dirtyMesh();
@@ -7910,7 +8061,7 @@ void LLVOAvatar::sitOnObject(LLViewerObject *sit_object)
     mRoot->getXform()->setParent(&sit_object->mDrawable->mXform); // LLVOAvatar::sitOnObject
     // SL-315
     mRoot->setPosition(getPosition());
-    mRoot->updateWorldMatrixChildren();
+    updateWorldMatrices();
 
     stopMotion(ANIM_AGENT_BODY_NOISE);
 
@@ -11072,6 +11223,79 @@ void LLVOAvatar::updateVisualComplexity()
     mVisualComplexityStale = true;
 }
 
+void LLVOAvatar::updateVisualComplexity(const LLViewerObject* object)
+{
+    mObjectComplexity.markStale(object->getRootEdit()->getID());
+    mVisualComplexityStale = true;
+}
+
+
+// Complexity of a single top-level object, without the HUD details
+static void calculateObjectComplexity(const LLViewerObject* attached_object,
+                                      LLVOVolume::texture_cost_t& textures,
+                                      LLAvatarComplexityCache::Entry& object_complexity)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+    object_complexity.mVisibleTriangleCount = attached_object->recursiveGetTriangleCount();
+    object_complexity.mEstTriangleCount = attached_object->recursiveGetEstTrianglesMax();
+    object_complexity.mSurfaceArea = attached_object->recursiveGetScaledSurfaceArea();
+    object_complexity.mTotalCost = 0.f;
+    object_complexity.mHasCost = false;
+
+    textures.clear();
+    const LLDrawable* drawable = attached_object->mDrawable;
+    if (drawable)
+    {
+        const LLVOVolume* volume = drawable->getVOVolume();
+        if (volume)
+        {
+            F32 attachment_total_cost = 0;
+            F32 attachment_volume_cost = 0;
+            F32 attachment_texture_cost = 0;
+            F32 attachment_children_cost = 0;
+            const F32 animated_object_attachment_surcharge = 1000;
+
+            if (volume->isAnimatedObjectFast())
+            {
+                attachment_volume_cost += animated_object_attachment_surcharge;
+            }
+            attachment_volume_cost += volume->getRenderCost(textures);
+
+            const LLViewerObject::const_child_list_t children = volume->getChildren();
+            for (LLViewerObject::const_child_list_t::const_iterator child_iter = children.begin();
+                child_iter != children.end();
+                ++child_iter)
+            {
+                LLViewerObject* child_obj = *child_iter;
+                LLVOVolume* child = dynamic_cast<LLVOVolume*>(child_obj);
+                if (child)
+                {
+                    attachment_children_cost += child->getRenderCost(textures);
+                }
+            }
+
+            for (LLVOVolume::texture_cost_t::iterator volume_texture = textures.begin();
+                volume_texture != textures.end();
+                ++volume_texture)
+            {
+                // add the cost of each individual texture in the linkset
+                attachment_texture_cost += LLVOVolume::getTextureCost(*volume_texture);
+            }
+            attachment_total_cost = attachment_volume_cost + attachment_texture_cost + attachment_children_cost;
+            LL_DEBUGS("ARCdetail") << "Attachment costs " << attached_object->getAttachmentItemID()
+                << " total: " << attachment_total_cost
+                << ", volume: " << attachment_volume_cost
+                << ", " << textures.size()
+                << " textures: " << attachment_texture_cost
+                << ", " << volume->numChildren()
+                << " children: " << attachment_children_cost
+                << LL_ENDL;
+
+            object_complexity.mTotalCost = attachment_total_cost;
+            object_complexity.mHasCost = true;
+        }
+    }
+}
 
 // Account for the complexity of a single top-level object associated
 // with an avatar. This will be either an attached object or an animated
@@ -11087,69 +11311,29 @@ void LLVOAvatar::accountRenderComplexityForObject(
     LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
     if (attached_object && !attached_object->isHUDAttachment())
     {
-        mAttachmentVisibleTriangleCount += attached_object->recursiveGetTriangleCount();
-        mAttachmentEstTriangleCount += attached_object->recursiveGetEstTrianglesMax();
-        mAttachmentSurfaceArea += attached_object->recursiveGetScaledSurfaceArea();
-
-        textures.clear();
-        const LLDrawable* drawable = attached_object->mDrawable;
-        if (drawable)
-        {
-            const LLVOVolume* volume = drawable->getVOVolume();
-            if (volume)
+        // Only objects that changed since the last update are accounted again
+        const LLAvatarComplexityCache::Entry& object_complexity = mObjectComplexity.get(attached_object->getID(),
+            [attached_object, &textures](LLAvatarComplexityCache::Entry& entry)
             {
-                F32 attachment_total_cost = 0;
-                F32 attachment_volume_cost = 0;
-                F32 attachment_texture_cost = 0;
-                F32 attachment_children_cost = 0;
-                const F32 animated_object_attachment_surcharge = 1000;
-
-                if (volume->isAnimatedObjectFast())
-                {
-                    attachment_volume_cost += animated_object_attachment_surcharge;
-                }
-                attachment_volume_cost += volume->getRenderCost(textures);
+                calculateObjectComplexity(attached_object, textures, entry);
+            });
 
-                const_child_list_t children = volume->getChildren();
-                for (const_child_list_t::const_iterator child_iter = children.begin();
-                    child_iter != children.end();
-                    ++child_iter)
-                {
-                    LLViewerObject* child_obj = *child_iter;
-                    LLVOVolume* child = dynamic_cast<LLVOVolume*>(child_obj);
-                    if (child)
-                    {
-                        attachment_children_cost += child->getRenderCost(textures);
-                    }
-                }
+        mAttachmentVisibleTriangleCount += object_complexity.mVisibleTriangleCount;
+        mAttachmentEstTriangleCount += object_complexity.mEstTriangleCount;
+        mAttachmentSurfaceArea += object_complexity.mSurfaceArea;
 
-                for (LLVOVolume::texture_cost_t::iterator volume_texture = textures.begin();
-                    volume_texture != textures.end();
-                    ++volume_texture)
-                {
-                    // add the cost of each individual texture in the linkset
-                    attachment_texture_cost += LLVOVolume::getTextureCost(*volume_texture);
-                }
-                attachment_total_cost = attachment_volume_cost + attachment_texture_cost + attachment_children_cost;
-                LL_DEBUGS("ARCdetail") << "Attachment costs " << attached_object->getAttachmentItemID()
-                    << " total: " << attachment_total_cost
-                    << ", volume: " << attachment_volume_cost
-                    << ", " << textures.size()
-                    << " textures: " << attachment_texture_cost
-                    << ", " << volume->numChildren()
-                    << " children: " << attachment_children_cost
-                    << LL_ENDL;
-                // Limit attachment complexity to avoid signed integer flipping of the wearer's ACI
-                cost += (U32)llclamp(attachment_total_cost, MIN_ATTACHMENT_COMPLEXITY, max_attachment_complexity);
+        if (object_complexity.mHasCost)
+        {
+            // Limit attachment complexity to avoid signed integer flipping of the wearer's ACI
+            cost += (U32)llclamp(object_complexity.mTotalCost, MIN_ATTACHMENT_COMPLEXITY, max_attachment_complexity);
 
-                if (isSelf())
-                {
-                    LLObjectComplexity object_complexity;
-                    object_complexity.objectName = attached_object->getAttachmentItemName();
-                    object_complexity.objectId = attached_object->getAttachmentItemID();
-                    object_complexity.objectCost = (U32)attachment_total_cost;
-                    object_complexity_list.push_back(object_complexity);
-                }
+            if (isSelf())
+            {
+                LLObjectComplexity object_info;
+                object_info.objectName = attached_object->getAttachmentItemName();
+                object_info.objectId = attached_object->getAttachmentItemID();
+                object_info.objectCost = (U32)object_complexity.mTotalCost;
+                object_complexity_list.push_back(object_info);
             }
         }
     }
@@ -11284,6 +11468,9 @@ void LLVOAvatar::calculateUpdateRenderComplexity()
         mAttachmentEstTriangleCount = 0.f;
         mAttachmentSurfaceArea = 0.f;
 
+        // Only the objects looked up by this update are kept, which drops the detached ones
+        mObjectComplexity.beginUpdate();
+
         // A standalone animated object needs to be accounted for
         // using its associated volume. Attached animated objects
         // will be covered by the subsequent loop over attachments.
@@ -11331,6 +11518,9 @@ void LLVOAvatar::calculateUpdateRenderComplexity()
         mVisualComplexity = cost;
         mVisualComplexityStale = false;
 
+        add(LLStatViewer::AVATAR_COMPLEXITY_COMPUTED, mObjectComplexity.getComputedCount());
+        add(LLStatViewer::AVATAR_COMPLEXITY_REUSED, mObjectComplexity.getReusedCount());
+
         static LLCachedControl<U32> show_my_complexity_changes(gSavedSettings, "ShowMyComplexityChanges", 20);
 
         if (isSelf() && show_my_complexity_changes)
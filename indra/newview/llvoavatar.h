@@ -36,6 +36,8 @@
 #include <boost/signals2/trackable.hpp>
 
 #include "llavatarappearance.h"
+#include "llavatarcomplexitycache.h"
+#include "llcharacterupdatescheduler.h"
 #include "llchat.h"
 #include "lldrawpoolalpha.h"
 #include "llviewerobject.h"
@@ -273,12 +275,14 @@ public:
     virtual void    updateDebugText();
     virtual bool    computeNeedsUpdate();
     virtual bool    updateCharacter(LLAgent &agent);
+    void            updateCharacterJoints(bool visible, bool was_sit_ground_constrained);
     void            updateFootstepSounds();
     void            computeUpdatePeriod();
     void            updateOrientation(LLAgent &agent, F32 speed, F32 delta_time);
     void            updateTimeStep();
     void            updateRootPositionAndRotation(LLAgent &agent, F32 speed, bool was_sit_ground_constrained);
 
+    void            idleUpdateAfterCharacter(bool detailed_update);
     void            idleUpdateVoiceVisualizer(bool voice_enabled, const LLVector3 &position);
     void            idleUpdateMisc(bool detailed_update);
     virtual void    idleUpdateAppearanceAnimation();
@@ -304,7 +308,11 @@ public:
                                                      object_complexity_list_t& object_complexity_list);
     void            calculateUpdateRenderComplexity();
     static const U32 VISUAL_COMPLEXITY_UNKNOWN;
+    // The avatar or its set of attachments changed, the attachments keep
+    // their cached complexity
     void            updateVisualComplexity();
+    // The top level object that object belongs to changed
+    void            updateVisualComplexity(const LLViewerObject* object);
 
     void placeProfileQuery();
     void readProfileQuery(S32 retries);
@@ -341,6 +349,17 @@ public:
     const LLColor4 &  getMutedAVColor()             { return mMutedAVColor;         };
     static void     updateImpostorRendering(U32 newMaxNonImpostorsValue);
 
+    // Between these, the motion controllers of the avatars getting a normal
+    // update are only stepped, and finishParallelAnimation() runs them all
+    // at once on the General queue and then does the rest of each
+    // avatar's idleUpdate().  Main thread.
+    static void     beginParallelAnimation();
+    static void     finishParallelAnimation();
+
+    // Starts a frame of the avatar update budget, see AvatarUpdateBudget.
+    // Main thread, before the avatars' idleUpdate().
+    static void     beginUpdateFrame();
+
     void            idleUpdateBelowWater();
 
     static void updateNearbyAvatarCount();
@@ -374,6 +393,25 @@ public:
     static std::vector<LLUUID> sAVsIgnoringARTLimit;
     static S32 sAvatarsNearby;
 
+private:
+    struct ParallelAnimationEntry
+    {
+        LLPointer<LLVOAvatar> mAvatar;
+        bool mVisible;
+        bool mWasSitGroundConstrained;
+    };
+    static bool sParallelAnimationOpen;
+    static std::vector<ParallelAnimationEntry> sParallelAnimationBatch;
+    bool mParallelAnimationPending{ false };
+
+    // Asks the budget for this frame's full update
+    bool scheduleUpdate();
+    U32 getUpdateInterest() const;
+    static LLCharacterUpdateScheduler sUpdateScheduler;
+    bool mUpdateDeferred{ false };  // put off by the budget, asks again next frame
+    bool mUpdateGranted{ false };   // to report the time of this frame's update
+public:
+
     //--------------------------------------------------------------------
     // Region state
     //--------------------------------------------------------------------
@@ -582,6 +620,7 @@ private:
     // DEPRECATED -- obsolete avatar render cost values
     mutable U32  mVisualComplexity;
     mutable bool mVisualComplexityStale;
+    LLAvatarComplexityCache mObjectComplexity; // by top level object id
     U32          mReportedVisualComplexity; // from other viewers through the simulator
 
     mutable bool        mCachedInMuteList;
@@ -1223,12 +1223,12 @@ void LLVOVolume::updateVisualComplexity()
     LLVOAvatar* avatar = getAvatarAncestor();
     if (avatar)
     {
-        avatar->updateVisualComplexity();
+        avatar->updateVisualComplexity(this);
     }
     LLVOAvatar* rigged_avatar = getAvatar();
     if(rigged_avatar && (rigged_avatar != avatar))
     {
-        rigged_avatar->updateVisualComplexity();
+        rigged_avatar->updateVisualComplexity(this);
     }
 }
 
@@ -2009,8 +2009,9 @@ bool LLVOVolume::lodOrSculptChanged(LLDrawable *drawable, bool &compiled, bool &
 
     if ((new_lod != old_lod) || mSculptChanged)
     {
-        if (mDrawable->isState(LLDrawable::RIGGED))
+        if (mDrawable->isState(LLDrawable::RIGGED) || isAttachment())
         {
+            // the mesh cost depends on the LOD
             updateVisualComplexity();
         }
 
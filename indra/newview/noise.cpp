@@ -29,6 +29,7 @@
 #include "noise.h"
 
 #include "llrand.h"
+#include "llvector4a.h"
 
 
 // static
@@ -83,3 +84,112 @@ F32 noise2(F32 *vec)
     return lerp_m(sy, a, b);
 }
 
+void init_noise()
+{
+    if (gNoiseStart) {
+        gNoiseStart = 0;
+        init();
+    }
+}
+
+void noise2v(const F32 *x, const F32 *y, F32 *out, S32 count)
+{
+    init_noise();
+
+    // The table lookups stay scalar, everything around them is done the
+    // same way as noise2() but on four points at a time.
+    LL_ALIGN_16(F32 px[4]);
+    LL_ALIGN_16(F32 py[4]);
+    LL_ALIGN_16(S32 ix[4]);
+    LL_ALIGN_16(S32 iy[4]);
+    LL_ALIGN_16(F32 q[8][4]);     // x and y gradients at the four corners
+    LL_ALIGN_16(F32 result[4]);
+
+    const LLVector4a one(1.f);
+    const LLVector4a two(2.f);
+    const LLVector4a three(3.f);
+    const LLVector4a offset(4096.f);     // NF32, undefined by noise.h
+
+    S32 n = 0;
+    while (n < count)
+    {
+        const S32 lanes = llmin(4, count - n);
+        for (S32 k = 0; k < 4; k++)
+        {
+            // pad the last group by repeating its first point
+            const S32 src = n + (k < lanes ? k : 0);
+            px[k] = x[src];
+            py[k] = y[src];
+        }
+
+        // fast_setup(), truncating conversion like lltrunc()
+        LLVector4a vrx0, vry0, vrx1, vry1;
+        vrx1.load4a(px);
+        vry1.load4a(py);
+        vrx1.add(offset);
+        vry1.add(offset);
+        const __m128i tx = _mm_cvttps_epi32(vrx1);
+        const __m128i ty = _mm_cvttps_epi32(vry1);
+        _mm_store_si128((__m128i*)ix, tx);
+        _mm_store_si128((__m128i*)iy, ty);
+        vrx0.setSub(vrx1, LLVector4a(_mm_cvtepi32_ps(tx)));
+        vry0.setSub(vry1, LLVector4a(_mm_cvtepi32_ps(ty)));
+
+        for (S32 k = 0; k < 4; k++)
+        {
+            const U8 bx0 = (U8)ix[k];
+            const U8 bx1 = bx0 + 1;
+            const U8 by0 = (U8)iy[k];
+            const U8 by1 = by0 + 1;
+
+            const S32 i = *(p + bx0);
+            const S32 j = *(p + bx1);
+            const F32 *q00 = *(g2 + *(p + i + by0));
+            const F32 *q10 = *(g2 + *(p + j + by0));
+            const F32 *q01 = *(g2 + *(p + i + by1));
+            const F32 *q11 = *(g2 + *(p + j + by1));
+            q[0][k] = q00[0]; q[1][k] = q00[1];
+            q[2][k] = q10[0]; q[3][k] = q10[1];
+            q[4][k] = q01[0]; q[5][k] = q01[1];
+            q[6][k] = q11[0]; q[7][k] = q11[1];
+        }
+
+        vrx1.setSub(vrx0, one);
+        vry1.setSub(vry0, one);
+
+        // s_curve(t) = t * t * (3 - 2 * t)
+        LLVector4a sx, sy, tmp;
+        sx.setMul(vrx0, vrx0);
+        tmp.setMul(two, vrx0);
+        tmp.setSub(three, tmp);
+        sx.mul(tmp);
+        sy.setMul(vry0, vry0);
+        tmp.setMul(two, vry0);
+        tmp.setSub(three, tmp);
+        sy.mul(tmp);
+
+        LLVector4a qx, qy, u, v, a, b;
+
+        // fast_at2(rx, ry, q) = rx * q[0] + ry * q[1], lerp_m(t, a, b) = a + t * (b - a)
+        qx.load4a(q[0]); qy.load4a(q[1]);
+        u.setMul(vrx0, qx); tmp.setMul(vry0, qy); u.add(tmp);
+        qx.load4a(q[2]); qy.load4a(q[3]);
+        v.setMul(vrx1, qx); tmp.setMul(vry0, qy); v.add(tmp);
+        v.sub(u); v.mul(sx); a.setAdd(u, v);
+
+        qx.load4a(q[4]); qy.load4a(q[5]);
+        u.setMul(vrx0, qx); tmp.setMul(vry1, qy); u.add(tmp);
+        qx.load4a(q[6]); qy.load4a(q[7]);
+        v.setMul(vrx1, qx); tmp.setMul(vry1, qy); v.add(tmp);
+        v.sub(u); v.mul(sx); b.setAdd(u, v);
+
+        b.sub(a); b.mul(sy); a.add(b);
+        a.store4a(result);
+
+        for (S32 k = 0; k < lanes; k++)
+        {
+            out[n + k] = result[k];
+        }
+        n += lanes;
+    }
+}
@@ -0,0 +1,156 @@
+/**
+ * @file llavatarcomplexitycache_test.cpp
+ * @brief Test cases for the per attachment render complexity cache
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include <map>
+
+#include "../llavatarcomplexitycache.h"
+
+#include "../test/lltut.h"
+
+namespace tut
+{
+    struct avatarcomplexitycache
+    {
+        LLAvatarComplexityCache mCache;
+        std::map<LLUUID, U32> mComputed;    // calls to compute, by object
+        const LLUUID mHat{ "a4e7bd1c-1f41-4e6e-9b2a-0d2a6f1f5c01" };
+        const LLUUID mShoes{ "a4e7bd1c-1f41-4e6e-9b2a-0d2a6f1f5c02" };
+        const LLUUID mHair{ "a4e7bd1c-1f41-4e6e-9b2a-0d2a6f1f5c03" };
+
+        // stands in for LLVOAvatar::accountRenderComplexityForObject()
+        F32 account(const LLUUID& id, F32 cost)
+        {
+            return mCache.get(id, [this, &id, cost](LLAvatarComplexityCache::Entry& entry)
+                {
+                    ++mComputed[id];
+                    entry.mTotalCost = cost;
+                    entry.mHasCost = true;
+                }).mTotalCost;
+        }
+    };
+    typedef test_group<avatarcomplexitycache> avatarcomplexitycache_t;
+    typedef avatarcomplexitycache_t::object avatarcomplexitycache_object_t;
+    tut::avatarcomplexitycache_t tut_avatarcomplexitycache("LLAvatarComplexityCache");
+
+    template<> template<>
+    void avatarcomplexitycache_object_t::test<1>()
+    {
+        set_test_name("unchanged attachments are reused");
+        mCache.beginUpdate();
+        ensure_equals("first hat", account(mHat, 10.f), 10.f);
+        ensure_equals("first shoes", account(mShoes, 20.f), 20.f);
+        ensure_equals("computed", mCache.getComputedCount(), 2U);
+        ensure_equals("reused", mCache.getReusedCount(), 0U);
+
+        for (S32 update = 0; update < 3; ++update)
+        {
+            mCache.beginUpdate();
+            // a new cost would show if it were computed again
+            ensure_equals("cached hat", account(mHat, 99.f), 10.f);
+            ensure_equals("cached shoes", account(mShoes, 99.f), 20.f);
+            ensure_equals("counts reset per update", mCache.getComputedCount(), 0U);
+            ensure_equals("reused per update", mCache.getReusedCount(), 2U);
+        }
+        ensure_equals("hat computed", mComputed[mHat], 1U);
+        ensure_equals("shoes computed", mComputed[mShoes], 1U);
+    }
+
+    template<> template<>
+    void avatarcomplexitycache_object_t::test<2>()
+    {
+        set_test_name("a changed attachment alone is computed again");
+        mCache.beginUpdate();
+        account(mHat, 10.f);
+        account(mShoes, 20.f);
+
+        // as LLVOAvatar::updateVisualComplexity(object) between updates
+        mCache.markStale(mHat);
+        mCache.beginUpdate();
+        ensure_equals("stale hat", account(mHat, 15.f), 15.f);
+        ensure_equals("cached shoes", account(mShoes, 99.f), 20.f);
+        ensure_equals("computed", mCache.getComputedCount(), 1U);
+        ensure_equals("reused", mCache.getReusedCount(), 1U);
+
+        // computed again once, then cached again
+        mCache.beginUpdate();
+        ensure_equals("hat cached again", account(mHat, 99.f), 15.f);
+        ensure_equals("hat computed", mComputed[mHat], 2U);
+        ensure_equals("shoes computed", mComputed[mShoes], 1U);
+
+        // unknown objects are ignored
+        mCache.markStale(LLUUID("a4e7bd1c-1f41-4e6e-9b2a-0d2a6f1f5cff"));
+        ensure_equals("size", mCache.size(), 1U);
+    }
+
+    template<> template<>
+    void avatarcomplexitycache_object_t::test<3>()
+    {
+        set_test_name("detached attachments are dropped");
+        mCache.beginUpdate();
+        account(mHat, 10.f);
+        account(mShoes, 20.f);
+        ensure_equals("both", mCache.size(), 2U);
+
+        // the shoes are taken off
+        mCache.beginUpdate();
+        account(mHat, 99.f);
+        ensure_equals("hat only", mCache.size(), 1U);
+
+        // and put back on: not the entry from before they were taken off
+        mCache.beginUpdate();
+        account(mHat, 99.f);
+        ensure_equals("shoes again", account(mShoes, 25.f), 25.f);
+        ensure_equals("shoes computed", mComputed[mShoes], 2U);
+        ensure_equals("hat computed", mComputed[mHat], 1U);
+    }
+
+    template<> template<>
+    void avatarcomplexitycache_object_t::test<4>()
+    {
+        set_test_name("marked stale during the update");
+        mCache.beginUpdate();
+        account(mHat, 10.f);
+        account(mHair, 30.f);
+        // the hair changes while this update is still accounting
+        mCache.markStale(mHair);
+        ensure_equals("hair computed again", account(mHair, 35.f), 35.f);
+
+        mCache.beginUpdate();
+        ensure_equals("hair cached", account(mHair, 99.f), 35.f);
+        ensure_equals("hair computed", mComputed[mHair], 2U);
+
+        // looked up twice in one update, computed once
+        mCache.markStale(mHat);
+        mCache.beginUpdate();
+        account(mHat, 12.f);
+        ensure_equals("hat twice", account(mHat, 99.f), 12.f);
+        ensure_equals("hat computed", mComputed[mHat], 2U);
+        ensure_equals("computed", mCache.getComputedCount(), 1U);
+        ensure_equals("reused", mCache.getReusedCount(), 1U);
+    }
+}
@@ -0,0 +1,262 @@
+/**
+ * @file llterrainnoise_test.cpp
+ * @brief Test cases for the batched terrain composition noise
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../llterrainnoise.h"
+#include "../noise.h"
+#include "stringize.h"
+
+#include "../test/lltut.h"
+#include "../test/benchmark.h"
+
+namespace
+{
+    // 256m region, one texel per meter plus the shared edge
+    const S32 WIDTH = 257;
+    const F32 SCALE = 1.f;
+    const F64 ORIGIN_X = 256000.0;
+    const F64 ORIGIN_Y = 254976.0;
+    const S32 PATCH = 16;
+
+    // The per texel noise LLVLComposition::generateHeights() used to do
+    F32 reference_noise(S32 i, S32 j)
+    {
+        const F32 xyScaleInv = (1.f / 4.9215f);
+        F32 vec[3];
+        F32 vec1[3];
+        vec[0] = (F32)(ORIGIN_X + (F32)(i*SCALE))*xyScaleInv;
+        vec[1] = (F32)(ORIGIN_Y + (F32)(j*SCALE))*xyScaleInv;
+        vec[2] = 0.f;
+        vec1[0] = vec[0]*(0.2222222222f);
+        vec1[1] = vec[1]*(0.2222222222f);
+        vec1[2] = 0.f;
+        F32 twiddle = noise2(vec1)*6.5f;
+        twiddle += turbulence2(vec, 2)*1.5f*1.5f;
+        return twiddle*2.f;
+    }
+
+    // Hills plus a terraformed plateau, deterministic
+    std::vector<F32> make_heights()
+    {
+        std::vector<F32> heights(WIDTH*WIDTH);
+        for (S32 j = 0; j < WIDTH; j++)
+        {
+            for (S32 i = 0; i < WIDTH; i++)
+            {
+                F32 h = 30.f + 25.f*sinf(i*0.023f)*cosf(j*0.031f) + 3.f*sinf((i + j)*0.2f);
+                if (i > 96 && i < 160 && j > 96 && j < 160)
+                {
+                    h = 42.f;
+                }
+                heights[j*WIDTH + i] = h;
+            }
+        }
+        return heights;
+    }
+
+    // The composition blend of generateHeights() over a rectangle
+    template <typename NOISE>
+    void compose(const std::vector<F32>& heights, std::vector<F32>& out, S32 x_begin, S32 y_begin,
+                 S32 x_end, S32 y_end, NOISE noise)
+    {
+        const F32 start_height = 20.f;
+        const F32 height_range = 60.f;
+        for (S32 j = y_begin; j < y_end; j++)
+        {
+            for (S32 i = x_begin; i < x_end; i++)
+            {
+                const F32 twiddle = noise(i, j);
+                F32 scaled = (heights[j*WIDTH + i] + twiddle - start_height)*4.f/height_range;
+                out[j*WIDTH + i] = llclamp(scaled, 0.f, 3.f);
+            }
+        }
+    }
+
+    F32 max_difference(const std::vector<F32>& a, const std::vector<F32>& b)
+    {
+        F32 diff = 0.f;
+        for (size_t n = 0; n < a.size(); n++)
+        {
+            diff = llmax(diff, fabsf(a[n] - b[n]));
+        }
+        return diff;
+    }
+}
+
+namespace tut
+{
+    struct terrainnoise
+    {
+    };
+    typedef test_group<terrainnoise> terrainnoise_t;
+    typedef terrainnoise_t::object terrainnoise_object_t;
+    tut::terrainnoise_t tut_terrainnoise("LLTerrainNoise");
+
+    // noise2v() matches noise2(), including a partial last group
+    template<> template<>
+    void terrainnoise_object_t::test<1>()
+    {
+        const S32 count = 1031;
+        std::vector<F32> x(count), y(count), out(count);
+        for (S32 n = 0; n < count; n++)
+        {
+            x[n] = 0.37f*n + 11.f;
+            y[n] = 52000.f + 0.91f*(n % 97);
+        }
+        noise2v(x.data(), y.data(), out.data(), count);
+        for (S32 n = 0; n < count; n++)
+        {
+            F32 vec[2] = { x[n], y[n] };
+            ensure_approximately_equals("noise2v", out[n], noise2(vec), 20);
+        }
+    }
+
+    // the cached field matches the per texel reference
+    template<> template<>
+    void terrainnoise_object_t::test<2>()
+    {
+        LLTerrainNoise noise(ORIGIN_X, ORIGIN_Y, WIDTH, SCALE);
+        noise.generateRows(0, WIDTH);
+        F32 diff = 0.f;
+        for (S32 j = 0; j < WIDTH; j++)
+        {
+            for (S32 i = 0; i < WIDTH; i++)
+            {
+                diff = llmax(diff, fabsf(noise.get(i, j) - reference_noise(i, j)));
+            }
+        }
+        ensure("matches reference", diff < 1e-5f);
+
+        F32 row[40];
+        noise.generateRow(100, 33, 40, row);
+        for (S32 k = 0; k < 40; k++)
+        {
+            ensure_equals("row", row[k], noise.get(100 + k, 33));
+        }
+    }
+
+    // without a General queue the requested bands are done inline, and
+    // only those
+    template<> template<>
+    void terrainnoise_object_t::test<3>()
+    {
+        std::shared_ptr<LLTerrainNoise> noise = std::make_shared<LLTerrainNoise>(ORIGIN_X, ORIGIN_Y, WIDTH, SCALE);
+        ensure("not ready", !noise->isReady(0, WIDTH));
+        ensure("inline", noise->requestRows(20, 40, false));
+        ensure("requested rows", noise->isReady(16, 48));
+        ensure("other rows", !noise->isReady(0, 16) && !noise->isReady(48, 64));
+        ensure("threaded without queue", noise->requestRows(240, WIDTH, true));
+        ensure("last band", noise->isReady(256, WIDTH));
+        ensure_equals("value", noise->get(255, 250), reference_noise(255, 250));
+    }
+
+    // composing a region with per texel noise, with the batched noise on one
+    // thread and on a thread per band, then recomposing one terraformed
+    // patch, all give the same composition
+    template<> template<>
+    void terrainnoise_object_t::test<4>()
+    {
+        const std::vector<F32> heights = make_heights();
+        std::vector<F32> legacy(WIDTH*WIDTH), composed(WIDTH*WIDTH);
+        const S32 passes = Benchmark::size(5, 1);
+
+        Benchmark bench(stringize("Terrain composition, ", WIDTH, "x", WIDTH, " region"));
+        for (S32 pass = 0; pass < passes; pass++)
+        {
+            compose(heights, legacy, 0, 0, WIDTH, WIDTH, reference_noise);
+        }
+        const F64 legacy_ms = bench.elapsed_ms()/passes;
+
+        bench.start();
+        for (S32 pass = 0; pass < passes; pass++)
+        {
+            LLTerrainNoise noise(ORIGIN_X, ORIGIN_Y, WIDTH, SCALE);
+            noise.generateRows(0, WIDTH);
+            compose(heights, composed, 0, 0, WIDTH, WIDTH,
+                    [&noise](S32 i, S32 j) { return noise.get(i, j); });
+        }
+        const F64 batched_ms = bench.elapsed_ms()/passes;
+        ensure("same composition batched", max_difference(legacy, composed) < 1e-4f);
+
+        const S32 threads = llmax(2, (S32)std::thread::hardware_concurrency());
+        std::unique_ptr<LLTerrainNoise> noise;
+        std::fill(composed.begin(), composed.end(), 0.f);
+        bench.start();
+        for (S32 pass = 0; pass < passes; pass++)
+        {
+            noise = std::make_unique<LLTerrainNoise>(ORIGIN_X, ORIGIN_Y, WIDTH, SCALE);
+            std::vector<std::thread> workers;
+            for (S32 t = 0; t < threads; t++)
+            {
+                workers.emplace_back([&noise, t, threads]()
+                    {
+                        for (S32 y = t*LLTerrainNoise::BAND_ROWS; y < WIDTH; y += threads*LLTerrainNoise::BAND_ROWS)
+                        {
+                            noise->generateRows(y, llmin(y + LLTerrainNoise::BAND_ROWS, WIDTH));
+                        }
+                    });
+            }
+            for (std::thread& worker : workers)
+            {
+                worker.join();
+            }
+            compose(heights, composed, 0, 0, WIDTH, WIDTH,
+                    [&noise](S32 i, S32 j) { return noise->get(i, j); });
+        }
+        const F64 parallel_ms = bench.elapsed_ms()/passes;
+        ensure("all bands", noise->isReady(0, WIDTH));
+        ensure("same composition threaded", max_difference(legacy, composed) < 1e-4f);
+
+        // terraforming dirties one patch, the noise is already cached
+        const S32 patch_passes = Benchmark::size(200, 2);
+        bench.start();
+        for (S32 pass = 0; pass < patch_passes; pass++)
+        {
+            compose(heights, legacy, 128, 128, 128 + PATCH + 1, 128 + PATCH + 1, reference_noise);
+        }
+        const F64 legacy_patch_us = bench.elapsed_us()/patch_passes;
+
+        bench.start();
+        for (S32 pass = 0; pass < patch_passes; pass++)
+        {
+            compose(heights, composed, 128, 128, 128 + PATCH + 1, 128 + PATCH + 1,
+                    [&noise](S32 i, S32 j) { return noise->get(i, j); });
+        }
+        const F64 cached_patch_us = bench.elapsed_us()/patch_passes;
+        ensure("same patch", max_difference(legacy, composed) < 1e-4f);
+
+        bench.report("per texel noise  ", legacy_ms, " ms");
+        bench.report("batched          ", batched_ms, " ms");
+        bench.report(threads, " threads        ", parallel_ms, " ms");
+        bench.report("one terraformed patch: per texel ", legacy_patch_us, " us, cached noise ",
+                     cached_patch_us, " us");
+    }
+}
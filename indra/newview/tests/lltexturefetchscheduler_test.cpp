@@ -0,0 +1,263 @@
+/**
+ * @file lltexturefetchscheduler_test.cpp
+ * @brief Test cases for LLTextureFetchScheduler and LLTextureFetchSimulator
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include <sstream>
+
+#include "../lltexturefetchscheduler.h"
+#include "llindexedheap.h"
+#include "llstring.h"
+
+#include "../test/lltut.h"
+#include "../test/benchmark.h"
+
+namespace
+{
+    LLUUID make_id(S32 n)
+    {
+        return LLUUID::generateNewID(llformat("texture %d", n));
+    }
+
+    // A login-like burst: a few hundred textures arriving over a couple
+    // of seconds, sizes and priorities from a fixed LCG so every run sees
+    // the same trace, with some reprioritization and cancellation mixed in.
+    std::string make_trace(S32 count)
+    {
+        std::ostringstream trace;
+        U32 seed = 12345;
+        auto next = [&seed]() { seed = seed * 1664525 + 1013904223; return seed >> 8; };
+        for (S32 i = 0; i < count; ++i)
+        {
+            const F64 t = (F64)i * 2.0 / count;
+            const F32 priority = (F32)(1 + next() % 100000);
+            const S32 bytes = 4096 + (S32)(next() % (256 * 1024));
+            trace << llformat("%.4f add ", t) << make_id(i) << ' ' << priority << ' ' << bytes << '\n';
+            if (i % 7 == 3)
+            {
+                trace << llformat("%.4f pri ", t + 0.5) << make_id(i) << ' ' << priority * 10.f << '\n';
+            }
+            if (i % 11 == 5)
+            {
+                trace << llformat("%.4f del ", t + 0.25) << make_id(i) << '\n';
+            }
+        }
+        return trace.str();
+    }
+
+    void report_results(const Benchmark& bench, const char* label, const LLTextureFetchSimulator::Results& r)
+    {
+        bench.report(label,
+                     ": completed ", r.mCompleted,
+                     ", cancelled ", r.mCancelled,
+                     ", end ", r.mEndTime, "s",
+                     ", mean wait ", r.mMeanQueueWait, "s",
+                     ", max wait ", r.mMaxQueueWait, "s",
+                     ", mean completion ", r.mMeanCompletion, "s",
+                     ", weighted completion ", r.mWeightedCompletion, "s",
+                     ", peak active ", r.mPeakActive,
+                     ", peak decode backlog ", r.mPeakDecodeBacklog);
+    }
+}
+
+namespace tut
+{
+    struct texturefetchscheduler
+    {
+    };
+    typedef test_group<texturefetchscheduler> texturefetchscheduler_t;
+    typedef texturefetchscheduler_t::object texturefetchscheduler_object_t;
+    tut::texturefetchscheduler_t tut_texturefetchscheduler("LLTextureFetchScheduler");
+
+    // LLIndexedHeap ordering, update and erase
+    template<> template<>
+    void texturefetchscheduler_object_t::test<1>()
+    {
+        LLIndexedHeap<S32, S32> heap;
+        for (S32 i = 0; i < 100; ++i)
+        {
+            ensure("new key", heap.push(i, (i * 37) % 101));
+        }
+        ensure("existing key", !heap.push(10, 1000));
+        ensure_equals("top after raise", heap.top(), 10);
+        ensure("reprioritize", heap.reprioritize(10, -1));
+        ensure("erase", heap.erase(20));
+        ensure("erase missing", !heap.erase(20));
+        ensure_equals("size", heap.size(), (size_t)99);
+
+        S32 last = S32_MAX;
+        S32 key, priority;
+        while (heap.pop(&key, &priority))
+        {
+            ensure("descending", priority <= last);
+            last = priority;
+        }
+        ensure_equals("lowest last", key, 10);
+    }
+
+    // higher priority goes first, reprioritize reorders
+    template<> template<>
+    void texturefetchscheduler_object_t::test<2>()
+    {
+        LLTextureFetchScheduler scheduler;
+        scheduler.enqueue(make_id(1), 10.f, 0.0);
+        scheduler.enqueue(make_id(2), 1000.f, 0.0);
+        scheduler.enqueue(make_id(3), 100.f, 0.0);
+        ensure("reprioritize", scheduler.reprioritize(make_id(1), 5000.f, 0.0));
+        ensure("remove", scheduler.remove(make_id(3), 0.0));
+        ensure("not queued", !scheduler.isQueued(make_id(3)));
+
+        LLUUID id;
+        ensure("pop 1", scheduler.popNext(id));
+        ensure_equals("reprioritized first", id, make_id(1));
+        ensure("pop 2", scheduler.popNext(id));
+        ensure_equals("then highest", id, make_id(2));
+        ensure("empty", !scheduler.popNext(id));
+    }
+
+    // a long waiting low priority request eventually beats new high priority ones
+    template<> template<>
+    void texturefetchscheduler_object_t::test<3>()
+    {
+        LLTextureFetchScheduler::Params params;
+        params.mStarvationSeconds = 1.0;
+        LLTextureFetchScheduler scheduler(params);
+
+        // 2^4 ratio in priority is overcome by 4+ seconds of waiting
+        scheduler.enqueue(make_id(1), 2.f, 0.0);
+        scheduler.enqueue(make_id(2), 32.f, 3.0);
+        scheduler.enqueue(make_id(3), 32.f, 5.0);
+
+        LLUUID id;
+        scheduler.popNext(id);
+        ensure_equals("newer but higher wins", id, make_id(2));
+        scheduler.popNext(id);
+        ensure_equals("starved request beats newest", id, make_id(1));
+
+        // re-enqueueing keeps the original age
+        scheduler.clear();
+        scheduler.enqueue(make_id(4), 2.f, 0.0);
+        scheduler.enqueue(make_id(5), 16.f, 4.0);
+        scheduler.enqueue(make_id(4), 2.f, 10.0);
+        scheduler.popNext(id);
+        ensure_equals("age survives re-enqueue", id, make_id(4));
+    }
+
+    // admission follows the bandwidth-delay product and the decode backlog
+    template<> template<>
+    void texturefetchscheduler_object_t::test<4>()
+    {
+        LLTextureFetchScheduler scheduler;
+        ensure("no estimate yet", !scheduler.hasEstimate());
+        ensure_equals("caller ceiling until estimated", scheduler.getTargetConcurrency(32), 32);
+        ensure_equals("fill from empty", scheduler.getAdmissionCount(0, 32, 16), 32);
+        ensure_equals("no refill above low water", scheduler.getAdmissionCount(20, 32, 16), 0);
+        ensure_equals("refill at low water", scheduler.getAdmissionCount(16, 32, 16), 16);
+        ensure_equals("no hysteresis", scheduler.getAdmissionCount(20, 32, 32), 12);
+
+        // 1MB/s with 100ms latency and 64KB requests is ~1.6 requests in flight
+        const S32 bytes = 64 * 1024;
+        F64 now = 0.0;
+        for (S32 i = 0; i < 64; ++i)
+        {
+            now += bytes / (1024.0 * 1024.0);
+            scheduler.recordCompleted(bytes, 0.1, now);
+        }
+        ensure("estimate", scheduler.hasEstimate());
+        ensure_approximately_equals("latency", (F32)scheduler.getMinLatency(), 0.1f, 8);
+        const S32 target = scheduler.getTargetConcurrency(32);
+        ensure("target near gain times bdp", target >= 2 && target <= 6);
+        ensure_equals("admission", scheduler.getAdmissionCount(1, 32, 16), target - 1);
+        ensure_equals("no admission when full", scheduler.getAdmissionCount(40, 32, 16), 0);
+        // low water scales with the target: half of it here
+        ensure_equals("scaled low water", scheduler.getAdmissionCount(target / 2 + 1, 32, 16), 0);
+
+        scheduler.setDecodeBacklog(1000);
+        ensure_equals("decode backlog throttles", scheduler.getTargetConcurrency(32), scheduler.getParams().mMinConcurrency);
+    }
+
+    // trace recording round trips through the simulator parser
+    template<> template<>
+    void texturefetchscheduler_object_t::test<5>()
+    {
+        std::ostringstream trace;
+        LLTextureFetchScheduler scheduler;
+        scheduler.setTraceStream(&trace);
+        scheduler.enqueue(make_id(1), 10.f, 0.5, 1000);
+        scheduler.reprioritize(make_id(1), 20.f, 0.75);
+        scheduler.remove(make_id(1), 1.0);
+        scheduler.setTraceStream(nullptr);
+
+        std::istringstream in(trace.str());
+        std::vector<LLTextureFetchSimulator::Event> events;
+        ensure("parse", LLTextureFetchSimulator::parseTrace(in, events));
+        ensure_equals("event count", events.size(), (size_t)3);
+        ensure_equals("add", events[0].mType, LLTextureFetchSimulator::Event::ADD);
+        ensure_equals("add bytes", events[0].mBytes, 1000);
+        ensure_equals("pri", events[1].mType, LLTextureFetchSimulator::Event::PRIORITY);
+        ensure_equals("pri value", events[1].mPriority, 20.f);
+        ensure_equals("del", events[2].mType, LLTextureFetchSimulator::Event::REMOVE);
+        ensure_equals("id", events[2].mID, make_id(1));
+
+        std::istringstream bad("0.1 add not-a-uuid 1 1\n");
+        ensure("reject bad line", !LLTextureFetchSimulator::parseTrace(bad, events));
+    }
+
+    // Replay a synthetic trace: results are deterministic, everything that
+    // wasn't cancelled completes, and adaptive admission is compared with
+    // a fixed ceiling (gain high enough that the estimate never binds).
+    template<> template<>
+    void texturefetchscheduler_object_t::test<6>()
+    {
+        std::istringstream in(make_trace(400));
+        std::vector<LLTextureFetchSimulator::Event> events;
+        ensure("parse", LLTextureFetchSimulator::parseTrace(in, events));
+
+        LLTextureFetchSimulator::Params sim_params;
+        LLTextureFetchScheduler::Params adaptive;
+        LLTextureFetchScheduler::Params fixed;
+        fixed.mConcurrencyGain = 1000.0;
+        fixed.mDecodeBacklogSoftLimit = 1000000;
+        fixed.mDecodeBacklogHardLimit = 1000000;
+        fixed.mStarvationSeconds = 1.0e9;
+
+        LLTextureFetchSimulator sim(sim_params, adaptive);
+        LLTextureFetchSimulator::Results first = sim.run(events);
+        LLTextureFetchSimulator::Results second = sim.run(events);
+        ensure_equals("deterministic completed", second.mCompleted, first.mCompleted);
+        ensure_equals("deterministic end", second.mEndTime, first.mEndTime);
+        ensure_equals("deterministic wait", second.mMeanQueueWait, first.mMeanQueueWait);
+        ensure_equals("everything finishes", first.mCompleted + first.mCancelled, 400);
+        ensure("respects ceiling", first.mPeakActive <= sim_params.mMaxActive);
+
+        LLTextureFetchSimulator::Results baseline = LLTextureFetchSimulator(sim_params, fixed).run(events);
+        ensure_equals("baseline finishes", baseline.mCompleted + baseline.mCancelled, 400);
+
+        Benchmark bench("Texture fetch replay, 400 requests");
+        report_results(bench, "Fixed ceiling", baseline);
+        report_results(bench, "Adaptive", first);
+    }
+}
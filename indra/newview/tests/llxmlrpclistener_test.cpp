@@ -128,7 +128,7 @@ namespace tut
         // Connect the timeout filter to the reply pump.
         LLTempBoundListener temp(
             pumps.obtain("reply").
-            listen("watchdog", boost::bind(&LLEventTimeout::post, boost::ref(watchdog), _1)));
+            listen("watchdog", boost::bind(static_cast<LLEventPump::post_t>(&LLEventPump::post), boost::ref(watchdog), _1)));
         // Now connect our target listener to the timeout filter.
         watchdog.listen("captureReply", boost::bind(&data::captureReply, this, _1));
         // Kick off the request...
@@ -165,7 +165,7 @@ namespace tut
         // Connect the timeout filter to the reply pump.
         LLTempBoundListener temp(
             pumps.obtain("reply").
-            listen("watchdog", boost::bind(&LLEventTimeout::post, boost::ref(watchdog), _1)));
+            listen("watchdog", boost::bind(static_cast<LLEventPump::post_t>(&LLEventPump::post), boost::ref(watchdog), _1)));
         // Now connect our target listener to the timeout filter.
         watchdog.listen("captureReply", boost::bind(&data::captureReply, this, _1));
         // Kick off the request...
@@ -201,7 +201,7 @@ namespace tut
         // Connect the timeout filter to the reply pump.
         LLTempBoundListener temp(
             pumps.obtain("reply").
-            listen("watchdog", boost::bind(&LLEventTimeout::post, boost::ref(watchdog), _1)));
+            listen("watchdog", boost::bind(static_cast<LLEventPump::post_t>(&LLEventPump::post), boost::ref(watchdog), _1)));
         // Now connect our target listener to the timeout filter.
         watchdog.listen("captureReply", boost::bind(&data::captureReply, this, _1));
         // Kick off the request...
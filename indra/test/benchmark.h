@@ -0,0 +1,110 @@
+/**
+ * @file   benchmark.h
+ * @brief  Timing for the benchmarks that some test programs carry
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#if ! defined(LL_BENCHMARK_H)
+#define LL_BENCHMARK_H
+
+#include "print.h"
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <utility>
+
+/*****************************************************************************
+*   Benchmark
+*****************************************************************************/
+/**
+ * A test that times something must still check what it computes on every
+ * build, but quickly and quietly. So benchmarks are opt-in: unless the
+ * environment variable LL_BENCHMARK is non-empty, Benchmark::size() picks the
+ * small case and report() prints nothing. With it set, the test runs the full
+ * size case and reports its timings on std::cerr, e.g.
+ *
+ *     Benchmark bench("UUID maps, ms per 500k finds");
+ *     const size_t count = Benchmark::size(1000000, 1000);
+ *     bench.start();
+ *     ... the work, with ensure()s on its results ...
+ *     bench.report("std::map ", bench.elapsed_ms());
+ */
+class Benchmark
+{
+public:
+    /// just a timer, for a part of the benchmark, or another thread
+    Benchmark() { start(); }
+
+    Benchmark(const std::string& title)
+    {
+        if (enabled())
+        {
+            print('\n', title, ':');
+        }
+        start();
+    }
+
+    static bool enabled()
+    {
+        static const bool sEnabled = []()
+        {
+            const char* LL_BENCHMARK = getenv("LL_BENCHMARK");
+            return LL_BENCHMARK && *LL_BENCHMARK;
+        }();
+        return sEnabled;
+    }
+
+    /// full when benchmarking, quick otherwise
+    template <typename T>
+    static T size(T full, T quick)
+    {
+        return enabled()? full : quick;
+    }
+
+    void start() { mStart = std::chrono::steady_clock::now(); }
+
+    /// since the last start()
+    double elapsed_ms() const { return elapsed<std::milli>(); }
+    double elapsed_us() const { return elapsed<std::micro>(); }
+
+    /// print one line of results, indented under the title
+    template <typename... ARGS>
+    void report(ARGS&&... args) const
+    {
+        if (enabled())
+        {
+            print("  ", std::forward<ARGS>(args)...);
+        }
+    }
+
+private:
+    template <typename PERIOD>
+    double elapsed() const
+    {
+        return std::chrono::duration<double, PERIOD>(std::chrono::steady_clock::now() - mStart).count();
+    }
+
+    std::chrono::steady_clock::time_point mStart;
+};
+
+#endif /* ! defined(LL_BENCHMARK_H) */
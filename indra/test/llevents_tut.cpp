@@ -30,6 +30,9 @@
 #pragma warning (disable : 4675) // "resolved by ADL" -- just as I want!
 #endif
 
+// for llsd::allocationCount()
+#define LLSD_DEBUG_INFO
+
 // Precompiled header
 #include "linden_common.h"
 // associated header
@@ -39,8 +42,8 @@
 #include "llevents.h"
 #undef testable
 // STL headers
+#include <vector>
 // std headers
-#include <iostream>
 #include <typeinfo>
 // external library headers
 #include <boost/bind.hpp>
@@ -48,7 +51,9 @@
 // other Linden headers
 #include "tests/listener.h"             // must PRECEDE lltut.h
 #include "lltut.h"
+#include "benchmark.h"
 #include "catch_and_store_what_in.h"
+#include "llsdutil.h"
 #include "stringize.h"
 
 using boost::assign::list_of;
@@ -59,6 +64,26 @@ T make(const T& value)
     return value;
 }
 
+namespace
+{
+    // The kinds of event the viewer posts most: an object update, a chat
+    // message, a progress report
+    LLSD typicalEvent(S32 i, const LLUUID& id)
+    {
+        switch (i % 3)
+        {
+        case 0:
+            return llsd::map("op", "update", "id", id, "name", "Object",
+                             "pos", llsd::array(128.0, 64.0, 22.5 + i));
+        case 1:
+            return llsd::map("from", "Resident Name", "id", id, "type", 1,
+                             "text", "Hello, is anyone going to the meeting later on today?");
+        default:
+            return llsd::map("desc", "Loading world...", "frac", i / 1000.0);
+        }
+    }
+}
+
 /*****************************************************************************
  *   tut test group
  *****************************************************************************/
@@ -253,8 +278,8 @@ void events_object::test<5>()
     // and off in groups.
     LLEventPump& filter0(pumps.obtain("filter0"));
     LLEventPump& filter1(pumps.obtain("filter1"));
-    upstream.listen(filter0.getName(), boost::bind(&LLEventPump::post, boost::ref(filter0), _1));
-    upstream.listen(filter1.getName(), boost::bind(&LLEventPump::post, boost::ref(filter1), _1));
+    upstream.listen(filter0.getName(), boost::bind(static_cast<LLEventPump::post_t>(&LLEventPump::post), boost::ref(filter0), _1));
+    upstream.listen(filter1.getName(), boost::bind(static_cast<LLEventPump::post_t>(&LLEventPump::post), boost::ref(filter1), _1));
     listener0.listenTo(filter0);
     listener1.listenTo(filter1);
     listener0.reset(0);
@@ -508,4 +533,90 @@ void events_object::test<11>()
     heaptest.post(2);
 }
 
+template<> template<>
+void events_object::test<12>()
+{
+    set_test_name("post(LLSD&&) to pumps that keep events");
+    LLEventMailDrop maildrop("maildrop");
+    LLSD event(llsd::map("text", "a message nobody has handled yet", "count", 1));
+    maildrop.post(std::move(event));
+    LLSD received;
+    LLTempBoundListener connection(
+        maildrop.listen("late", [&received](const LLSD& event)
+                        {
+                            received = event;
+                            return true;
+                        }));
+    ensure_equals("kept for a late listener", received["count"].asInteger(), 1);
+
+    // sendReply() stamps the reqid into the reply it's given
+    LLEventStream replies("replies");
+    LLTempBoundListener reply_connection(
+        replies.listen("reply", [&received](const LLSD& event)
+                       {
+                           received = event;
+                           return false;
+                       }));
+    LLSD request(llsd::map("reply", "replies", "reqid", 17));
+    U32 allocations = llsd::allocationCount();
+    LLSD reply(llsd::map("data", "a reply that isn't inline"));
+    sendReply(std::move(reply), request);
+    ensure_equals("reply not cloned to stamp it", llsd::allocationCount() - allocations, 2u);
+    ensure_equals("stamped", received["reqid"].asInteger(), 17);
+    pumps.post("replies", llsd::map("reqid", 18));
+    ensure_equals("posted by name", received["reqid"].asInteger(), 18);
+}
+
+template<> template<>
+void events_object::test<13>()
+{
+    set_test_name("fan-out to 1, 10 and 100 listeners");
+    const S32 POSTS = Benchmark::size(30000, 300);
+    const LLUUID id(LLUUID::generateNewID());
+    Benchmark bench(STRINGIZE("Posting typical events, " << POSTS << " per run"));
+
+    U32 base_allocations = 0;
+    for (size_t count : { 1, 10, 100 })
+    {
+        LLEventStream pump(STRINGIZE("fanout" << count));
+        // each listener reads the event and keeps it, like most do
+        std::vector<LLSD> kept(count);
+        std::vector<LLTempBoundListener> connections;
+        S32 read = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            connections.emplace_back(
+                pump.listen(STRINGIZE("listener" << i),
+                            [&slot = kept[i], &read](const LLSD& event)
+                            {
+                                slot = event;
+                                read += event.has("id") || event["frac"].asReal() >= 0.0;
+                                return false;
+                            }));
+        }
+
+        U32 allocations = llsd::allocationCount();
+        bench.start();
+        for (S32 i = 0; i < POSTS; ++i)
+        {
+            pump.post(typicalEvent(i, id));
+        }
+        const F64 ms = bench.elapsed_ms();
+        allocations = llsd::allocationCount() - allocations;
+        bench.report(count, " listeners: ", ms, " ms, ", F64(allocations) / POSTS,
+                     " LLSD::Impl allocations per post");
+
+        ensure_equals("every listener read every event", read, S32(count) * POSTS);
+        if (count == 1)
+        {
+            base_allocations = allocations;
+        }
+        else
+        {
+            // only building the event allocates: listeners share it
+            ensure_equals("allocations independent of listeners", allocations, base_allocations);
+        }
+    }
+}
+
 } // namespace tut
@@ -29,9 +29,15 @@
 #include <tut/tut.hpp>
 #include "linden_common.h"
 #include "lltut.h"
+#include "benchmark.h"
 
+#include "llsdserialize.h"
 #include "llsdtraits.h"
+#include "llsdutil.h"
 #include "llstring.h"
+#include "stringize.h"
+
+#include <sstream>
 
 using std::fpclassify;
 
@@ -738,35 +744,36 @@ namespace tut
             w = v;
         }
 
+        // scalars are stored inline
         {
-            SDAllocationCheck check("assign integer value", 1);
+            SDAllocationCheck check("assign integer value", 0);
             LLSD v = 45;
             v = 33;
             v = 0;
         }
 
         {
-            SDAllocationCheck check("copy construct integer", 1);
+            SDAllocationCheck check("copy construct integer", 0);
             LLSD v = 45;
             LLSD w = v;
         }
 
         {
-            SDAllocationCheck check("assign integer", 1);
+            SDAllocationCheck check("assign integer", 0);
             LLSD v = 45;
             LLSD w;
             w = v;
         }
 
         {
-            SDAllocationCheck check("avoids extra clone", 2);
+            SDAllocationCheck check("avoids extra clone", 1);
             LLSD v = 45;
             LLSD w = v;
             w = "nice day";
         }
 
         {
-            SDAllocationCheck check("shared values test for threaded work", 9);
+            SDAllocationCheck check("shared values test for threaded work", 4);
 
             //U32 start_llsd_count = LLSD::outstandingCount();
 
@@ -774,7 +781,7 @@ namespace tut
 
             m["one"] = 1;
             m["two"] = 2;
-            m["one_copy"] = m["one"];           // 3 (m, "one" and "two")
+            m["one_copy"] = m["one"];           // 1 (m)
 
             m["undef_one"] = LLSD();
             m["undef_two"] = LLSD();
@@ -784,16 +791,16 @@ namespace tut
                 LLSD first_array = LLSD::emptyArray();
                 first_array.append(1.0f);
                 first_array.append(2.0f);
-                first_array.append(3.0f);           // 7
+                first_array.append(3.0f);           // 2
 
                 m["array"] = first_array;
                 m["array_clone"] = first_array;
-                m["array_copy"] = m["array"];       // 7
+                m["array_copy"] = m["array"];       // 2
             }
 
             m["string_one"] = "string one value";
             m["string_two"] = "string two value";
-            m["string_one_copy"] = m["string_one"];     // 9
+            m["string_one_copy"] = m["string_one"];     // 4
 
             //U32 llsd_object_count = LLSD::outstandingCount();
             //std::cout << "Using " << (llsd_object_count - start_llsd_count) << " LLSD objects" << std::endl;
@@ -811,6 +818,306 @@ namespace tut
         ensure("type is a string", v.isString());
     }
 
+    template<> template<>
+    void SDTestObject::test<15>()
+        // inline values
+    {
+        SDCleanupCheck check;
+
+        ensure_equals("no bigger than a pointer and the inline type", sizeof(LLSD), size_t(16));
+
+        {
+            SDAllocationCheck check("strings are shared", 1);
+            LLSD s("short");
+            LLSD t(s);
+            ensureTypeAndValue("shared string", t, "short");
+            ensure_equals("size", t.size(), size_t(5));
+            ensure_equals("same ref", &s.asStringRef(), &t.asStringRef());
+        }
+
+        {
+            // conversions of the inline values
+            LLSD num("1.5");
+            ensure_equals("string real", num.asReal(), 1.5);
+            ensure_equals("string integer", num.asInteger(), 1);
+            ensure("integer uuid", LLSD(5).asUUID().isNull());
+            ensure_equals("bool string", LLSD(true).asString(), "true");
+            ensure_equals("real string", LLSD(0.5).asString(), "0.5");
+            ensure_equals("real xmlrpc", LLSD(0.5).asXMLRPCValue(), "<value><double>0.500000</double></value>");
+            ensure_equals("integer binary", LLSD(5).asBinary().size(), size_t(0));
+            ensure_equals("integer stringref", LLSD(5).asStringRef(), "");
+            ensure_equals("integer size", LLSD(5).size(), size_t(0));
+            ensure("scalar has no keys", ! LLSD(5).has("x"));
+            const LLSD five(5);
+            ensure("scalar has no elements", five.beginArray() == five.endArray());
+        }
+
+        {
+            SDAllocationCheck check("copies are independent", 2);
+            LLSD v = "abc";
+            LLSD w = v;
+            w = "xyz";
+            ensure_equals("original kept", v.asString(), "abc");
+            LLSD x = std::move(w);
+            ensure_equals("moved", x.asString(), "xyz");
+            ensure("moved from", w.isUndefined());
+            x = 3;
+            ensureTypeAndValue("inline to inline", x, 3);
+            x = x;
+            ensureTypeAndValue("self assignment", x, 3);
+        }
+
+        {
+            // assigning a value from inside the LLSD itself
+            LLSD m;
+            m["a"] = "short";
+            m["b"] = 17;
+            m["a_copy"] = m["a"];
+            ensure_equals("copied element", m["a_copy"].asString(), "short");
+            m = m["b"];
+            ensureTypeAndValue("replaced by inline element", m, 17);
+
+            LLSD n;
+            n["s"] = "short";
+            n = n["s"].asStringRef();
+            ensureTypeAndValue("replaced by own string", n, "short");
+
+            LLSD a;
+            a.append(LLSD::emptyMap());
+            a[0]["x"] = 4.5;
+            a = std::move(a[0]["x"]);
+            ensureTypeAndValue("moved from inside", a, 4.5);
+
+            // a scalar turns into a container when used as one
+            LLSD c = 12;
+            c["key"] = 1;
+            ensure("became a map", c.isMap());
+            c = "text";
+            c.append(2);
+            ensure("became an array", c.isArray());
+            ensure_equals("array size", c.size(), size_t(1));
+        }
+    }
+
+    template<> template<>
+    void SDTestObject::test<16>()
+        // map operations, either map representation
+    {
+        SDCleanupCheck check;
+
+        LLSD m;
+        const char* keys[] = { "zeta", "alpha", "mu", "beta", "omega", "eta" };
+        S32 value = 0;
+        for (const char* key : keys)
+        {
+            m[key] = value++;
+        }
+        m.insert("alpha", 100);     // insert doesn't replace
+        m.insert("gamma", 6);
+        ensure_equals("size", m.size(), size_t(7));
+        ensure_equals("kept", m["alpha"].asInteger(), 1);
+        ensure("has", m.has("gamma") && ! m.has("delta"));
+
+        std::string last;
+        for (LLSD::map_const_iterator it = m.beginMap(); it != m.endMap(); ++it)
+        {
+            ensure("sorted", last < it->first);
+            last = it->first;
+        }
+
+        m.erase("mu");
+        m.erase("missing");
+        ensure_equals("erased", m.size(), size_t(6));
+        ensure("gone", ! m.has("mu"));
+        ensure("const lookup of a missing key", ((const LLSD&)m)["mu"].isUndefined());
+        ensure_equals("size unchanged", m.size(), size_t(6));
+        ensure_equals("keys", m.getKeys().size(), size_t(6));
+        ensure_equals("get", m.get("zeta").asInteger(), 0);
+    }
+
+    // Workloads over LLSD shaped like the viewer's
+    namespace
+    {
+        // like the login.cgi response: inventory skeleton, buddies, categories
+        LLSD makeLoginResponse()
+        {
+            LLSD response;
+            response["login"] = "true";
+            response["agent_id"] = LLUUID::generateNewID();
+            response["session_id"] = LLUUID::generateNewID();
+            response["first_name"] = "\"Resident\"";
+            response["last_name"] = "Resident";
+            response["message"] = "Welcome to Second Life! Please read the community standards.";
+            response["look_at"] = "[r0.9963859999999999939,r-0.084939700000000006863,r0]";
+            response["seconds_since_epoch"] = 1700000000;
+            response["max-agent-groups"] = 42;
+            response["agent_access"] = "M";
+            LLSD& flags = response["login-flags"];
+            flags[0]["stipend_since_login"] = "N";
+            flags[0]["ever_logged_in"] = "Y";
+            flags[0]["gendered"] = "Y";
+            LLSD& skeleton = response["inventory-skeleton"];
+            LLUUID root = LLUUID::generateNewID();
+            for (S32 i = 0; i < 3000; i++)
+            {
+                LLSD folder;
+                folder["folder_id"] = LLUUID::generateNewID();
+                folder["parent_id"] = root;
+                folder["name"] = STRINGIZE("Folder " << i);
+                folder["type_default"] = i % 25 - 1;
+                folder["version"] = i * 7;
+                skeleton.append(folder);
+            }
+            LLSD& buddies = response["buddy-list"];
+            for (S32 i = 0; i < 300; i++)
+            {
+                LLSD buddy;
+                buddy["buddy_id"] = LLUUID::generateNewID();
+                buddy["buddy_rights_given"] = 1;
+                buddy["buddy_rights_has"] = 3;
+                buddies.append(buddy);
+            }
+            LLSD& categories = response["event_categories"];
+            for (S32 i = 0; i < 30; i++)
+            {
+                LLSD category;
+                category["category_id"] = i;
+                category["category_name"] = STRINGIZE("Category " << i);
+                categories.append(category);
+            }
+            return response;
+        }
+
+        // like settings.xml
+        LLSD makeSettings()
+        {
+            static const char* types[] = { "Boolean", "S32", "U32", "F32", "String", "Vector3" };
+            LLSD settings;
+            for (S32 i = 0; i < 2000; i++)
+            {
+                LLSD entry;
+                S32 type = i % LL_ARRAY_SIZE(types);
+                entry["Comment"] = STRINGIZE("What setting number " << i << " does, at some length");
+                entry["Persist"] = 1;
+                entry["Type"] = types[type];
+                switch (type)
+                {
+                case 0:     entry["Value"] = i % 2;                     break;
+                case 1:
+                case 2:     entry["Value"] = i;                         break;
+                case 3:     entry["Value"] = i * 0.25;                  break;
+                case 4:     entry["Value"] = STRINGIZE("value" << i);   break;
+                default:    entry["Value"] = llsd::array(1.0, 2.0, i);  break;
+                }
+                settings[STRINGIZE("Setting" << i)] = entry;
+            }
+            return settings;
+        }
+
+        // reports the time and allocations of its scope
+        struct Measure
+        {
+            Measure(const Benchmark& bench, const std::string& name):
+                mBench(bench), mName(name), mAllocations(llsd::allocationCount())
+            {}
+            ~Measure()
+            {
+                mBench.report(mName, ": ", mTimer.elapsed_ms(), " ms, ",
+                              (llsd::allocationCount() - mAllocations), " LLSD::Impl allocations");
+            }
+            const Benchmark& mBench;
+            std::string mName;
+            U32 mAllocations;
+            Benchmark mTimer;
+        };
+    }
+
+    template<> template<>
+    void SDTestObject::test<17>()
+        // login, event and settings workloads
+    {
+#ifdef LLSD_FLAT_MAP
+        const char* maps = "flat maps";
+#else
+        const char* maps = "std::maps";
+#endif
+        Benchmark bench(STRINGIZE("LLSD workloads, sizeof(LLSD) " << sizeof(LLSD) << ", " << maps));
+        const S32 passes = Benchmark::size(20, 1);
+        const S32 events = Benchmark::size(200000, 2000);
+
+        std::string login_xml;
+        {
+            std::ostringstream out;
+            LLSDSerialize::toXML(makeLoginResponse(), out);
+            login_xml = out.str();
+        }
+        S32 folders = 0;
+        {
+            Measure measure(bench, STRINGIZE("login response, parse " << passes << " and walk the skeleton"));
+            for (S32 i = 0; i < passes; i++)
+            {
+                LLSD response;
+                std::istringstream in(login_xml);
+                LLSDSerialize::fromXML(response, in);
+                for (const LLSD& folder : llsd::inArray(response["inventory-skeleton"]))
+                {
+                    folders += folder["folder_id"].asUUID().notNull() &&
+                        ! folder["name"].asString().empty() && folder["version"].asInteger() >= 0;
+                }
+            }
+        }
+        ensure_equals("every folder", folders, passes * 3000);
+
+        S32 received = 0;
+        {
+            Measure measure(bench, STRINGIZE(events << " event posts to 3 listeners"));
+            for (S32 i = 0; i < events; i++)
+            {
+                LLSD event;
+                event["op"] = "update";
+                event["reply"] = "LLViewerObjectReply";
+                event["reqid"] = i;
+                event["pos"] = llsd::array(128.0, 64.0, 22.5);
+                event["name"] = "Object";
+                event["visible"] = true;
+                // each listener takes a copy and reads it
+                for (S32 listener = 0; listener < 3; listener++)
+                {
+                    const LLSD copy(event);
+                    received += copy["reqid"].asInteger() == i && copy["visible"].asBoolean() &&
+                        copy["pos"][2].asReal() > 0.0 && copy["op"].asStringRef() == "update";
+                }
+            }
+        }
+        ensure_equals("every event", received, 3 * events);
+
+        std::string settings_xml;
+        {
+            std::ostringstream out;
+            LLSDSerialize::toXML(makeSettings(), out);
+            settings_xml = out.str();
+        }
+        S32 loaded = 0;
+        {
+            Measure measure(bench, STRINGIZE("settings, load " << passes << " times"));
+            for (S32 i = 0; i < passes; i++)
+            {
+                LLSD settings;
+                std::istringstream in(settings_xml);
+                LLSDSerialize::fromXML(settings, in);
+                for (const auto& pair : llsd::inMap(settings))
+                {
+                    // what LLControlGroup::loadFromFile() reads
+                    const LLSD& entry = pair.second;
+                    LLSD value = entry["Value"];
+                    loaded += entry["Persist"].asBoolean() && ! entry["Type"].asString().empty() &&
+                        ! entry["Comment"].asString().empty() && value.isDefined();
+                }
+            }
+        }
+        ensure_equals("every setting", loaded, passes * 2000);
+    }
+
     /* TO DO:
         conversion of undefined to UUID, Date, URI and Binary
         conversion of undefined to map and array